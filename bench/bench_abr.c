@@ -0,0 +1,145 @@
+/**
+ * @file bench_abr.c
+ * @brief Per-segment ABR decisions of many simulated sessions sharing a ladder.
+ *
+ * Usage: bench_abr [-s sessions] [-n segments] [-v variants]
+ *
+ *   -s  number of simulated sessions (default 100000)
+ *   -n  segments played by each session (default 100)
+ *   -v  variants of the synthetic ladder (default 12)
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/abr.h"
+#include "../src/variant.h"
+
+#define BENCH_SEGMENT_MS 4000.0
+
+static double bench_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/** @brief xorshift, cheap enough not to show up in the measure */
+static unsigned int bench_random(unsigned int* state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+
+  return *state;
+}
+
+int main(int argc, char** argv) {
+  int                   option = 0;
+  int                   sessions = 100000;
+  int                   segments = 100;
+  int                   variants = 12;
+  long                  switches = 0;
+  double                started = 0.0;
+  double                elapsed = 0.0;
+  m3u8_t*               m3u8_ptr = NULL;
+  m3u8_abr_ladder_t*    ladder = NULL;
+  m3u8_abr_estimator_t* estimators = NULL;
+  int*                  rungs = NULL;
+  double*               links = NULL;
+
+  while ((option = getopt(argc, argv, "s:n:v:")) != -1) {
+    switch (option) {
+      case 's': sessions = atoi(optarg); break;
+      case 'n': segments = atoi(optarg); break;
+      case 'v': variants = atoi(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s [-s sessions] [-n segments] [-v variants]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  if (sessions <= 0 || segments <= 0 || variants <= 0 || m3u8_create(&m3u8_ptr) != M3U8_STATUS_NO_ERROR) {
+    fprintf(stderr, "invalid arguments\n");
+    return 1;
+  }
+
+  // NOTE: a geometric ladder from 300 kbps, appended from the top as masters often are
+  for (int i = variants - 1; i >= 0; i--) {
+    ext_x_stream_inf_t variant = {0};
+    char               uri[32];
+
+    snprintf(uri, sizeof(uri), "v%d.m3u8", i);
+    variant.bandwidth = (int)(300000 * (1 << i / 2) * (i % 2 ? 1.4 : 1.0));
+    variant.uri = strdup(uri);
+    m3u8_variant_append(m3u8_ptr, &variant);
+  }
+
+  if (m3u8_variant_index(m3u8_ptr) != M3U8_VARIANT_STATUS_NO_ERROR ||
+      m3u8_abr_ladder_create(&ladder, m3u8_ptr, NULL) != M3U8_ABR_STATUS_NO_ERROR) {
+    fprintf(stderr, "unable to build the ladder\n");
+    m3u8_destroy(m3u8_ptr);
+    return 1;
+  }
+
+  estimators = calloc(sessions, sizeof(m3u8_abr_estimator_t));
+  rungs = calloc(sessions, sizeof(int));
+  links = calloc(sessions, sizeof(double));
+
+  if (estimators == NULL || rungs == NULL || links == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  for (int i = 0; i < sessions; i++) {
+    unsigned int seed = 2166136261u ^ i;
+
+    m3u8_abr_estimator_init(&estimators[i], 0, 1000000);
+    links[i] = 500000.0 + bench_random(&seed) % 20000000;
+  }
+
+  started = bench_now_ms();
+
+  for (int segment = 0; segment < segments; segment++) {
+    for (int i = 0; i < sessions; i++) {
+      unsigned int seed = (unsigned int)(segment * 2654435761u) ^ (i + 1);
+      int          rung = 0;
+      double       bps = 0.0;
+      size_t       bytes = 0;
+
+      m3u8_abr_select(ladder, m3u8_abr_estimate(&estimators[i]), &rung);
+      switches += rung != rungs[i] && segment > 0;
+      rungs[i] = rung;
+
+      // link capacity wanders by up to +-25% per segment
+      bps = links[i] * (0.75 + (bench_random(&seed) % 1000) / 2000.0);
+      bytes = (size_t)(m3u8_abr_ladder_rung(ladder, rung)->bandwidth * BENCH_SEGMENT_MS / 8000.0);
+      m3u8_abr_sample(&estimators[i], bytes, bytes * 8000.0 / bps);
+    }
+  }
+
+  elapsed = bench_now_ms() - started;
+
+  printf("sessions        : %d\n", sessions);
+  printf("segments        : %d per session\n", segments);
+  printf("ladder          : %d rungs\n", m3u8_abr_ladder_size(ladder));
+  printf("decisions       : %.1f M/s\n", (double)sessions * segments / elapsed / 1000.0);
+  printf("per decision    : %.1f ns (select, estimate and sample)\n",
+         elapsed * 1000000.0 / ((double)sessions * segments));
+  printf("switch rate     : %.2f%% of segments\n",
+         100.0 * switches / ((double)sessions * (segments > 1 ? segments - 1 : 1)));
+  printf("session state   : %zu bytes\n", sizeof(m3u8_abr_estimator_t) + sizeof(int));
+
+  free(links);
+  free(rungs);
+  free(estimators);
+  m3u8_abr_ladder_destroy(ladder);
+  m3u8_destroy(m3u8_ptr);
+
+  return 0;
+}
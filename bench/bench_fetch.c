@@ -0,0 +1,138 @@
+/**
+ * @file bench_fetch.c
+ * @brief End-to-end fetch and parse benchmark against the loopback origin.
+ *
+ * Usage: bench_fetch [-n requests] [-p path] [-r root] [-l latency_ms]
+ *                    [-c chunk_size] [-z]
+ *
+ *   -n  number of fetches (default 1000)
+ *   -p  path requested from the origin (default /fake_sample_master_vod.m3u8,
+ *       /synthetic/media_<n>.m3u8 and /synthetic/master_<n>.m3u8 also work)
+ *   -r  directory served by the origin (default assets)
+ *   -l  latency added by the origin to every response, in milliseconds
+ *   -c  chunked transfer encoding chunk size, 0 disables it
+ *   -z  gzip bodies for clients sending Accept-Encoding: gzip
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/m3u8.h"
+#include "loopback.h"
+
+static double bench_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static int bench_compare(const void* a, const void* b) {
+  double lhs = *(const double*)a;
+  double rhs = *(const double*)b;
+
+  return (lhs > rhs) - (lhs < rhs);
+}
+
+static double bench_percentile(double* sorted, int count, double percentile) {
+  int index = (int)(percentile * (count - 1) + 0.5);
+
+  return count > 0 ? sorted[index] : 0.0;
+}
+
+int main(int argc, char** argv) {
+  int                         option = 0;
+  int                         port = 0;
+  int                         requests = 1000;
+  int                         failures = 0;
+  const char*                 path = "/fake_sample_master_vod.m3u8";
+  char                        uri[1024];
+  double*                     latencies = NULL;
+  double                      started = 0.0;
+  double                      elapsed = 0.0;
+  loopback_t*                 server = NULL;
+  loopback_stats_t            stats;
+  m3u8_transport_t*           transport = NULL;
+  m3u8_transport_curl_stats_t transport_stats = {0};
+  loopback_config_t           config = {.root = "assets", .latency_ms = 0, .chunk_size = 0};
+
+  while ((option = getopt(argc, argv, "n:p:r:l:c:z")) != -1) {
+    switch (option) {
+      case 'n': requests = atoi(optarg); break;
+      case 'p': path = optarg; break;
+      case 'r': config.root = optarg; break;
+      case 'l': config.latency_ms = atoi(optarg); break;
+      case 'c': config.chunk_size = strtoul(optarg, NULL, 10); break;
+      case 'z': config.gzip = true; break;
+      default:
+        fprintf(stderr, "usage: %s [-n requests] [-p path] [-r root] [-l latency_ms] "
+                        "[-c chunk_size] [-z]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  if (requests <= 0 || (latencies = calloc(requests, sizeof(double))) == NULL) {
+    fprintf(stderr, "invalid number of requests\n");
+    return 1;
+  }
+
+  if (loopback_start(&server, &config) != LOOPBACK_STATUS_NO_ERROR) {
+    fprintf(stderr, "unable to start the loopback origin\n");
+    free(latencies);
+    return 1;
+  }
+
+  loopback_port(server, &port);
+  snprintf(uri, sizeof(uri), "http://127.0.0.1:%d%s", port, path);
+
+  started = bench_now_ms();
+
+  for (int i = 0; i < requests; i++) {
+    m3u8_t* m3u8_ptr = NULL;
+    double  before = bench_now_ms();
+
+    if (m3u8_create(&m3u8_ptr) != M3U8_STATUS_NO_ERROR) {
+      failures++;
+      continue;
+    }
+
+    if (m3u8_open_from_remote(uri, m3u8_ptr) != M3U8_STATUS_NO_ERROR) {
+      failures++;
+    }
+
+    m3u8_destroy(m3u8_ptr);
+    latencies[i] = bench_now_ms() - before;
+  }
+
+  elapsed = bench_now_ms() - started;
+  loopback_stats(server, &stats);
+
+  if (m3u8_transport_default(&transport) == M3U8_TRANSPORT_STATUS_NO_ERROR) {
+    m3u8_transport_curl_stats(transport, &transport_stats);
+  }
+
+  loopback_stop(server);
+
+  qsort(latencies, requests, sizeof(double), bench_compare);
+
+  printf("uri             : %s\n", uri);
+  printf("requests        : %d (%d failed)\n", requests, failures);
+  printf("throughput      : %.1f req/s\n", requests / (elapsed / 1000.0));
+  printf("latency p50     : %.3f ms\n", bench_percentile(latencies, requests, 0.50));
+  printf("latency p99     : %.3f ms\n", bench_percentile(latencies, requests, 0.99));
+  printf("connections     : %lu (%.1f%% of requests reused one)\n", stats.connections,
+         stats.requests > 0 ? 100.0 * (stats.requests - stats.connections) / stats.requests : 0.0);
+  printf("client          : %lu new connections, %lu reused, %lu multiplexed\n",
+         transport_stats.connections, transport_stats.reused, transport_stats.multiplexed);
+  printf("bytes served    : %lu\n", stats.bytes);
+
+  free(latencies);
+
+  return failures > 0 ? 1 : 0;
+}
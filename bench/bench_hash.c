@@ -0,0 +1,141 @@
+/**
+ * @file bench_hash.c
+ * @brief Key lookups in the hash map against a scan of the intrusive list.
+ *
+ * Usage: bench_hash [-k keys] [-n lookups]
+ *
+ *   -k  distinct keys, like rendition groups or attribute names (default 64)
+ *   -n  lookups per container, a tenth of them missing (default 2000000)
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/hash.h"
+#include "../src/list.h"
+
+typedef struct {
+  char             key[32]; /**< terminated key */
+  size_t           key_s;   /**< bytes of key */
+  m3u8_list_node_t list;    /**< node on the scanned list */
+} bench_item_t;
+
+static double bench_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+/** @brief xorshift, cheap enough not to show up in the measure */
+static unsigned int bench_random(unsigned int* state) {
+  *state ^= *state << 13;
+  *state ^= *state >> 17;
+  *state ^= *state << 5;
+
+  return *state;
+}
+
+static bench_item_t* bench_list_find(m3u8_list_node_t* head, const char* key, size_t key_s) {
+  bench_item_t* item = NULL;
+
+  m3u8_list_foreach(item, head, bench_item_t, list) {
+    if (item->key_s == key_s && memcmp(item->key, key, key_s) == 0) {
+      return item;
+    }
+  }
+
+  return NULL;
+}
+
+int main(int argc, char** argv) {
+  int              option = 0;
+  int              keys = 64;
+  long             lookups = 2000000;
+  long             hits = 0;
+  double           started = 0.0;
+  double           list_ms = 0.0;
+  double           hash_ms = 0.0;
+  unsigned int     seed = 2166136261u;
+  bench_item_t*    items = NULL;
+  char (*probes)[32] = NULL;
+  m3u8_list_node_t head;
+  m3u8_hash_t*     hash = NULL;
+
+  while ((option = getopt(argc, argv, "k:n:")) != -1) {
+    switch (option) {
+      case 'k': keys = atoi(optarg); break;
+      case 'n': lookups = atol(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s [-k keys] [-n lookups]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  if (keys <= 0 || lookups <= 0) {
+    fprintf(stderr, "invalid arguments\n");
+    return 1;
+  }
+
+  items = calloc(keys, sizeof(bench_item_t));
+  probes = calloc(1024, sizeof(*probes));
+
+  if (items == NULL || probes == NULL || m3u8_hash_create(&hash, NULL) != M3U8_HASH_STATUS_NO_ERROR) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  m3u8_list_init(&head);
+
+  // NOTE: keys share a long prefix, as group ids and uris of one playlist do
+  for (int i = 0; i < keys; i++) {
+    snprintf(items[i].key, sizeof(items[i].key), "group-audio-aac-%d", i);
+    items[i].key_s = strlen(items[i].key);
+    m3u8_list_inb(&head, &items[i].list);
+    m3u8_hash_put(hash, items[i].key, items[i].key_s, &items[i]);
+  }
+
+  for (int i = 0; i < 1024; i++) {
+    int key = (int)(bench_random(&seed) % keys);
+
+    snprintf(probes[i], sizeof(probes[i]), "group-audio-aac-%d", i % 10 == 0 ? keys + key : key);
+  }
+
+  started = bench_now_ms();
+
+  for (long i = 0; i < lookups; i++) {
+    const char* probe = probes[i & 1023];
+
+    hits += bench_list_find(&head, probe, strlen(probe)) != NULL;
+  }
+
+  list_ms = bench_now_ms() - started;
+  started = bench_now_ms();
+
+  for (long i = 0; i < lookups; i++) {
+    const char* probe = probes[i & 1023];
+    void*       value = NULL;
+
+    hits += m3u8_hash_get(hash, probe, strlen(probe), &value) == M3U8_HASH_STATUS_NO_ERROR;
+  }
+
+  hash_ms = bench_now_ms() - started;
+
+  printf("keys            : %d\n", keys);
+  printf("lookups         : %ld per container, %ld hits in total\n", lookups, hits);
+  printf("list scan       : %.1f ns per lookup\n", list_ms * 1000000.0 / lookups);
+  printf("hash map        : %.1f ns per lookup\n", hash_ms * 1000000.0 / lookups);
+  printf("speedup         : %.1fx\n", list_ms / hash_ms);
+
+  m3u8_hash_destroy(hash);
+  free(probes);
+  free(items);
+
+  return 0;
+}
@@ -0,0 +1,77 @@
+/**
+ * @file bench_logger.c
+ * @brief Log lines written through the buffered, rotating file handler.
+ *
+ * Usage: bench_logger [-o path] [-n lines] [-r bytes] [-s]
+ *
+ *   -o  log file, rotated into path.1 and path.2 (default /tmp/bench_logger.log)
+ *   -n  lines to log (default 1000000)
+ *   -r  bytes per file before rotating (default 64 MiB)
+ *   -s  fsync every write of the buffer
+ */
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/logger.h"
+
+static double bench_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+int main(int argc, char** argv) {
+  int          option = 0;
+  long         lines = 1000000;
+  double       started = 0.0;
+  double       logged_ms = 0.0;
+  double       total_ms = 0.0;
+  LogAttribute attr = {.path = "/tmp/bench_logger.log", .max_file_size = 64L << 20, .max_files = 2};
+
+  while ((option = getopt(argc, argv, "o:n:r:s")) != -1) {
+    switch (option) {
+      case 'o': attr.path = optarg; break;
+      case 'n': lines = atol(optarg); break;
+      case 'r': attr.max_file_size = atol(optarg); break;
+      case 's': attr.sync_on_flush = 1; break;
+      default:
+        fprintf(stderr, "usage: %s [-o path] [-n lines] [-r bytes] [-s]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  if (lines <= 0) {
+    fprintf(stderr, "invalid arguments\n");
+    return 1;
+  }
+
+  logger_remove_log_handler("logger_write_stdout_handler");
+  logger_set_log_attribute(attr);
+
+  // NOTE: every line must reach the file for the rate to mean anything
+  logger_set_overflow(LOGGER_OVERFLOW_BLOCK);
+
+  started = bench_now_ms();
+
+  for (long i = 0; i < lines; i++) {
+    INFO("segment %ld of playlist %s fetched in %d ms", i, "media_10000.m3u8", (int)(i % 97));
+  }
+
+  logged_ms = bench_now_ms() - started;
+  logger_flush();
+  total_ms = bench_now_ms() - started;
+
+  printf("lines           : %ld\n", lines);
+  printf("dropped         : %lu\n", logger_dropped());
+  printf("logging thread  : %.2f M lines/s\n", lines / logged_ms / 1000.0);
+  printf("written to disk : %.2f M lines/s\n", lines / total_ms / 1000.0);
+
+  return 0;
+}
@@ -0,0 +1,183 @@
+/**
+ * @file bench_queue.c
+ * @brief Events handed from producer threads to one consumer through the
+ *        lock-free queue against a mutex guarded list.
+ *
+ * Usage: bench_queue [-p producers] [-n events]
+ *
+ *   -p  producer threads, like parser workers or log callers (default 4)
+ *   -n  events per producer (default 1000000)
+ */
+
+#define _GNU_SOURCE
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "../src/list.h"
+
+typedef struct {
+  long                  sequence; /**< payload the consumer sums */
+  m3u8_list_node_t      list;     /**< node on the locked list */
+  m3u8_list_mpsc_node_t queue;    /**< node on the lock-free queue */
+} bench_event_t;
+
+typedef struct {
+  pthread_mutex_t  mutex; /**< guards head */
+  m3u8_list_node_t head;  /**< pending events */
+  m3u8_list_mpsc_t queue; /**< pending events, lock-free */
+  bool             use_queue;
+} bench_channel_t;
+
+typedef struct {
+  bench_channel_t* channel;
+  bench_event_t*   events;
+  long             count;
+  pthread_t        thread;
+} bench_producer_t;
+
+static double bench_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000.0 + ts.tv_nsec / 1000000.0;
+}
+
+static void* bench_produce(void* context) {
+  bench_producer_t* producer = (bench_producer_t*)context;
+  bench_channel_t*  channel = producer->channel;
+
+  for (long i = 0; i < producer->count; i++) {
+    if (channel->use_queue) {
+      m3u8_list_mpsc_push(&channel->queue, &producer->events[i].queue);
+    } else {
+      pthread_mutex_lock(&channel->mutex);
+      m3u8_list_inb(&channel->head, &producer->events[i].list);
+      pthread_mutex_unlock(&channel->mutex);
+    }
+  }
+
+  return NULL;
+}
+
+/** @brief Runs one round, returns the milliseconds until all was consumed */
+static double bench_run(bench_channel_t* channel, bench_producer_t* producers, int count,
+                        long total) {
+  long   received = 0;
+  long   sum = 0;
+  double started = bench_now_ms();
+
+  for (int i = 0; i < count; i++) {
+    pthread_create(&producers[i].thread, NULL, bench_produce, &producers[i]);
+  }
+
+  while (received < total) {
+    bench_event_t* event = NULL;
+
+    if (channel->use_queue) {
+      m3u8_list_mpsc_node_t* first = NULL;
+
+      if (m3u8_list_mpsc_drain(&channel->queue, &first, NULL) != M3U8_LIST_STATUS_NO_ERROR) {
+        continue;
+      }
+
+      m3u8_list_mpsc_foreach(event, first, bench_event_t, queue) {
+        sum += event->sequence;
+        received++;
+      }
+    } else {
+      pthread_mutex_lock(&channel->mutex);
+
+      while (channel->head.next != &channel->head) {
+        event = m3u8_list_container_of(channel->head.next, bench_event_t, list);
+        m3u8_list_remove(&event->list);
+        sum += event->sequence;
+        received++;
+      }
+
+      pthread_mutex_unlock(&channel->mutex);
+    }
+  }
+
+  for (int i = 0; i < count; i++) {
+    pthread_join(producers[i].thread, NULL);
+  }
+
+  if (sum < 0) {
+    fprintf(stderr, "unexpected sum\n");
+  }
+
+  return bench_now_ms() - started;
+}
+
+int main(int argc, char** argv) {
+  int               option = 0;
+  int               count = 4;
+  long              events = 1000000;
+  double            list_ms = 0.0;
+  double            queue_ms = 0.0;
+  bench_producer_t* producers = NULL;
+  bench_channel_t   channel;
+
+  while ((option = getopt(argc, argv, "p:n:")) != -1) {
+    switch (option) {
+      case 'p': count = atoi(optarg); break;
+      case 'n': events = atol(optarg); break;
+      default:
+        fprintf(stderr, "usage: %s [-p producers] [-n events]\n", argv[0]);
+        return 1;
+    }
+  }
+
+  if (count <= 0 || events <= 0) {
+    fprintf(stderr, "invalid arguments\n");
+    return 1;
+  }
+
+  if ((producers = calloc(count, sizeof(bench_producer_t))) == NULL) {
+    fprintf(stderr, "out of memory\n");
+    return 1;
+  }
+
+  pthread_mutex_init(&channel.mutex, NULL);
+  m3u8_list_init(&channel.head);
+  m3u8_list_mpsc_init(&channel.queue);
+
+  for (int i = 0; i < count; i++) {
+    producers[i].channel = &channel;
+    producers[i].count = events;
+
+    if ((producers[i].events = calloc(events, sizeof(bench_event_t))) == NULL) {
+      fprintf(stderr, "out of memory\n");
+      return 1;
+    }
+
+    for (long j = 0; j < events; j++) {
+      producers[i].events[j].sequence = j;
+    }
+  }
+
+  channel.use_queue = false;
+  list_ms = bench_run(&channel, producers, count, count * events);
+  channel.use_queue = true;
+  queue_ms = bench_run(&channel, producers, count, count * events);
+
+  printf("producers       : %d\n", count);
+  printf("events          : %ld per producer\n", events);
+  printf("mutex list      : %.1f M events/s\n", count * events / list_ms / 1000.0);
+  printf("mpsc queue      : %.1f M events/s\n", count * events / queue_ms / 1000.0);
+  printf("speedup         : %.1fx\n", list_ms / queue_ms);
+
+  for (int i = 0; i < count; i++) {
+    free(producers[i].events);
+  }
+
+  free(producers);
+  pthread_mutex_destroy(&channel.mutex);
+
+  return 0;
+}
@@ -0,0 +1,622 @@
+/**
+ * @file loopback.c
+ * @brief Loopback HTTP/1.1 stand-in origin used by the fetch benchmarks.
+ */
+
+#define _GNU_SOURCE
+
+#include "loopback.h"
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <fcntl.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <pthread.h>
+#include <stdarg.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#define LOOPBACK_MAX_EVENTS  64
+#define LOOPBACK_REQUEST_MAX 8192
+#define LOOPBACK_PATH_MAX    1024
+
+/** @brief growable byte buffer used for bodies and responses */
+typedef struct {
+  char*  data;     /**< buffer bytes */
+  size_t size;     /**< bytes in use */
+  size_t capacity; /**< bytes allocated */
+} loopback_buffer_t;
+
+/** @brief one accepted client connection */
+typedef struct loopback_conn {
+  int                   fd;                         /**< client socket */
+  char                  in[LOOPBACK_REQUEST_MAX];   /**< unparsed request bytes */
+  size_t                in_size;                    /**< bytes in the input */
+  loopback_buffer_t     out;                        /**< pending responses */
+  size_t                out_sent;                   /**< bytes of out written */
+  long long             ready_at;                   /**< ms when out may be sent */
+  bool                  is_closing;                 /**< close after out drains */
+  bool                  is_writing;                 /**< registered for EPOLLOUT */
+  struct loopback_conn* next;                       /**< next open connection */
+} loopback_conn_t;
+
+struct loopback {
+  loopback_config_t config;    /**< server behavior */
+  char*             root;      /**< owned copy of config.root */
+  int               listen_fd; /**< listening socket */
+  int               epoll_fd;  /**< epoll instance */
+  int               wake_fd;   /**< eventfd used to stop the loop */
+  int               port;      /**< bound port */
+  pthread_t         thread;    /**< server loop */
+  pthread_mutex_t   mutex;     /**< guards stats */
+  loopback_stats_t  stats;     /**< counters */
+  loopback_conn_t*  conns;     /**< open connections */
+};
+
+static long long loopback_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return (long long)ts.tv_sec * 1000 + ts.tv_nsec / 1000000;
+}
+
+static int loopback_buffer_reserve(loopback_buffer_t* buffer, size_t extra) {
+  size_t capacity = buffer->capacity > 0 ? buffer->capacity : 1024;
+  char*  data = NULL;
+
+  if (buffer->size + extra <= buffer->capacity) {
+    return LOOPBACK_STATUS_NO_ERROR;
+  }
+
+  while (capacity < buffer->size + extra) {
+    capacity *= 2;
+  }
+
+  if ((data = realloc(buffer->data, capacity)) == NULL) {
+    return LOOPBACK_STATUS_MEM_ERROR;
+  }
+
+  buffer->data = data;
+  buffer->capacity = capacity;
+
+  return LOOPBACK_STATUS_NO_ERROR;
+}
+
+static int loopback_buffer_append(loopback_buffer_t* buffer, const void* data, size_t size) {
+  if (loopback_buffer_reserve(buffer, size) != LOOPBACK_STATUS_NO_ERROR) {
+    return LOOPBACK_STATUS_MEM_ERROR;
+  }
+
+  memcpy(buffer->data + buffer->size, data, size);
+  buffer->size += size;
+
+  return LOOPBACK_STATUS_NO_ERROR;
+}
+
+static int loopback_buffer_printf(loopback_buffer_t* buffer, const char* fmt, ...) {
+  va_list ap;
+  int     length = 0;
+
+  va_start(ap, fmt);
+  length = vsnprintf(NULL, 0, fmt, ap);
+  va_end(ap);
+
+  if (length < 0 || loopback_buffer_reserve(buffer, length + 1) != LOOPBACK_STATUS_NO_ERROR) {
+    return LOOPBACK_STATUS_MEM_ERROR;
+  }
+
+  va_start(ap, fmt);
+  vsnprintf(buffer->data + buffer->size, length + 1, fmt, ap);
+  va_end(ap);
+
+  buffer->size += length;
+
+  return LOOPBACK_STATUS_NO_ERROR;
+}
+
+/**
+ * @brief Builds the body of a /synthetic/ path.
+ *
+ * @return true when the path names a synthetic playlist.
+ */
+static bool loopback_synthetic(const char* path, loopback_buffer_t* body) {
+  int count = 0;
+
+  if (sscanf(path, "/synthetic/media_%d.m3u8", &count) == 1 && count >= 0) {
+    loopback_buffer_printf(body,
+                           "#EXTM3U\n#EXT-X-VERSION:7\n#EXT-X-PLAYLIST-TYPE:VOD\n"
+                           "#EXT-X-TARGETDURATION:6\n#EXT-X-MEDIA-SEQUENCE:0\n"
+                           "#EXT-X-MAP:URI=\"init.mp4\"\n");
+
+    for (int i = 0; i < count; i++) {
+      loopback_buffer_printf(body, "#EXTINF:5.994,\nsegment%d.m4s\n", i);
+    }
+
+    loopback_buffer_printf(body, "#EXT-X-ENDLIST\n");
+    return true;
+  }
+
+  if (sscanf(path, "/synthetic/master_%d.m3u8", &count) == 1 && count >= 0) {
+    loopback_buffer_printf(body, "#EXTM3U\n#EXT-X-VERSION:7\n#EXT-X-INDEPENDENT-SEGMENTS\n");
+
+    for (int i = 0; i < count; i++) {
+      loopback_buffer_printf(body,
+                             "#EXT-X-STREAM-INF:BANDWIDTH=%d,AVERAGE-BANDWIDTH=%d,"
+                             "CODECS=\"avc1.4d401f,mp4a.40.2\",RESOLUTION=%dx%d,"
+                             "FRAME-RATE=30.000,AUDIO=\"audio\"\nvariant_%d.m3u8\n",
+                             (i + 1) * 400000, (i + 1) * 380000, 160 * (i + 1), 90 * (i + 1), i);
+    }
+
+    return true;
+  }
+
+  return false;
+}
+
+static int loopback_read_file(loopback_t* server, const char* path, loopback_buffer_t* body) {
+  char   fpath[LOOPBACK_PATH_MAX];
+  char   chunk[16384];
+  size_t nread = 0;
+  FILE*  file = NULL;
+
+  if (strstr(path, "..") != NULL) {
+    return LOOPBACK_STATUS_INVALID_ARG;
+  }
+
+  snprintf(fpath, sizeof(fpath), "%s%s", server->root, path);
+
+  if ((file = fopen(fpath, "rb")) == NULL) {
+    return LOOPBACK_STATUS_INVALID_ARG;
+  }
+
+  while ((nread = fread(chunk, 1, sizeof(chunk), file)) > 0) {
+    loopback_buffer_append(body, chunk, nread);
+  }
+
+  fclose(file);
+
+  return LOOPBACK_STATUS_NO_ERROR;
+}
+
+static int loopback_gzip(const loopback_buffer_t* body, loopback_buffer_t* output) {
+  z_stream stream;
+
+  memset(&stream, 0, sizeof(stream));
+
+  if (deflateInit2(&stream, Z_DEFAULT_COMPRESSION, Z_DEFLATED, 15 + 16, 8, Z_DEFAULT_STRATEGY) !=
+      Z_OK) {
+    return LOOPBACK_STATUS_MEM_ERROR;
+  }
+
+  if (loopback_buffer_reserve(output, deflateBound(&stream, body->size)) !=
+      LOOPBACK_STATUS_NO_ERROR) {
+    deflateEnd(&stream);
+    return LOOPBACK_STATUS_MEM_ERROR;
+  }
+
+  stream.next_in = (Bytef*)body->data;
+  stream.avail_in = body->size;
+  stream.next_out = (Bytef*)output->data;
+  stream.avail_out = output->capacity;
+
+  deflate(&stream, Z_FINISH);
+  output->size = stream.total_out;
+  deflateEnd(&stream);
+
+  return LOOPBACK_STATUS_NO_ERROR;
+}
+
+/**
+ * @brief Finds a request header value, case-insensitively.
+ *
+ * @return pointer to the value inside the request or NULL.
+ */
+static const char* loopback_header(const char* request, const char* name, size_t* size) {
+  size_t      name_s = strlen(name);
+  const char* line = strstr(request, "\r\n");
+
+  while (line != NULL && line[2] != '\r') {
+    line += 2;
+
+    if (strncasecmp(line, name, name_s) == 0 && line[name_s] == ':') {
+      const char* value = line + name_s + 1;
+
+      while (*value == ' ') {
+        value++;
+      }
+
+      *size = strcspn(value, "\r");
+      return value;
+    }
+
+    line = strstr(line, "\r\n");
+  }
+
+  return NULL;
+}
+
+static void loopback_respond(loopback_t* server, loopback_conn_t* conn, char* request) {
+  char              method[16], path[LOOPBACK_PATH_MAX];
+  const char*       value = NULL;
+  size_t            value_s = 0;
+  size_t            header_s = conn->out.size;
+  bool              is_gzip = false;
+  int               code = 200;
+  loopback_buffer_t body = {NULL, 0, 0};
+  loopback_buffer_t encoded = {NULL, 0, 0};
+  loopback_buffer_t* payload = &body;
+
+  if (sscanf(request, "%15s %1023s", method, path) != 2) {
+    conn->is_closing = true;
+    return;
+  }
+
+  if ((value = loopback_header(request, "Connection", &value_s)) != NULL &&
+      strncasecmp(value, "close", 5) == 0) {
+    conn->is_closing = true;
+  }
+
+  if (!loopback_synthetic(path, &body) &&
+      loopback_read_file(server, path, &body) != LOOPBACK_STATUS_NO_ERROR) {
+    code = 404;
+    body.size = 0;
+  }
+
+  if (code == 200 && server->config.gzip &&
+      (value = loopback_header(request, "Accept-Encoding", &value_s)) != NULL &&
+      strstr(value, "gzip") != NULL && loopback_gzip(&body, &encoded) == LOOPBACK_STATUS_NO_ERROR) {
+    payload = &encoded;
+    is_gzip = true;
+  }
+
+  loopback_buffer_printf(&conn->out,
+                         "HTTP/1.1 %d %s\r\nContent-Type: application/vnd.apple.mpegurl\r\n",
+                         code, code == 200 ? "OK" : "Not Found");
+
+  if (is_gzip) {
+    loopback_buffer_printf(&conn->out, "Content-Encoding: gzip\r\n");
+  }
+
+  if (conn->is_closing) {
+    loopback_buffer_printf(&conn->out, "Connection: close\r\n");
+  }
+
+  if (server->config.chunk_size > 0) {
+    loopback_buffer_printf(&conn->out, "Transfer-Encoding: chunked\r\n\r\n");
+
+    for (size_t offset = 0; offset < payload->size; offset += server->config.chunk_size) {
+      size_t chunk_s = payload->size - offset;
+
+      chunk_s = chunk_s < server->config.chunk_size ? chunk_s : server->config.chunk_size;
+
+      loopback_buffer_printf(&conn->out, "%zx\r\n", chunk_s);
+      loopback_buffer_append(&conn->out, payload->data + offset, chunk_s);
+      loopback_buffer_printf(&conn->out, "\r\n");
+    }
+
+    loopback_buffer_printf(&conn->out, "0\r\n\r\n");
+  } else {
+    loopback_buffer_printf(&conn->out, "Content-Length: %zu\r\n\r\n", payload->size);
+    loopback_buffer_append(&conn->out, payload->data, payload->size);
+  }
+
+  if (conn->ready_at == 0) {
+    conn->ready_at = loopback_now_ms() + server->config.latency_ms;
+  }
+
+  pthread_mutex_lock(&server->mutex);
+  server->stats.requests++;
+  server->stats.bytes += conn->out.size - header_s;
+  pthread_mutex_unlock(&server->mutex);
+
+  free(body.data);
+  free(encoded.data);
+}
+
+static void loopback_close(loopback_t* server, loopback_conn_t* conn) {
+  loopback_conn_t** pivot = &server->conns;
+
+  while (*pivot != NULL && *pivot != conn) {
+    pivot = &(*pivot)->next;
+  }
+
+  if (*pivot != NULL) {
+    *pivot = conn->next;
+  }
+
+  epoll_ctl(server->epoll_fd, EPOLL_CTL_DEL, conn->fd, NULL);
+  close(conn->fd);
+  free(conn->out.data);
+  free(conn);
+}
+
+static void loopback_watch(loopback_t* server, loopback_conn_t* conn, bool is_writing) {
+  struct epoll_event event = {.events = EPOLLIN | (is_writing ? EPOLLOUT : 0), .data.ptr = conn};
+
+  if (conn->is_writing != is_writing) {
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_MOD, conn->fd, &event);
+    conn->is_writing = is_writing;
+  }
+}
+
+/**
+ * @brief Writes pending output once its latency elapsed.
+ *
+ * @return false when the connection was closed.
+ */
+static bool loopback_flush(loopback_t* server, loopback_conn_t* conn, long long now) {
+  while (conn->out_sent < conn->out.size && conn->ready_at <= now) {
+    ssize_t written = send(conn->fd, conn->out.data + conn->out_sent,
+                           conn->out.size - conn->out_sent, MSG_NOSIGNAL);
+
+    if (written < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      loopback_watch(server, conn, true);
+      return true;
+    }
+
+    if (written <= 0) {
+      loopback_close(server, conn);
+      return false;
+    }
+
+    conn->out_sent += written;
+  }
+
+  if (conn->out_sent == conn->out.size && conn->out.size > 0) {
+    conn->out.size = 0;
+    conn->out_sent = 0;
+    conn->ready_at = 0;
+    loopback_watch(server, conn, false);
+
+    if (conn->is_closing) {
+      loopback_close(server, conn);
+      return false;
+    }
+  }
+
+  return true;
+}
+
+static void loopback_readable(loopback_t* server, loopback_conn_t* conn) {
+  char*   end = NULL;
+  ssize_t nread = recv(conn->fd, conn->in + conn->in_size, sizeof(conn->in) - conn->in_size - 1, 0);
+
+  if (nread <= 0) {
+    if (nread < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      return;
+    }
+
+    loopback_close(server, conn);
+    return;
+  }
+
+  conn->in_size += nread;
+  conn->in[conn->in_size] = 0;
+
+  while (!conn->is_closing && (end = strstr(conn->in, "\r\n\r\n")) != NULL) {
+    size_t request_s = end - conn->in + 4;
+
+    end[2] = 0;
+    loopback_respond(server, conn, conn->in);
+
+    memmove(conn->in, conn->in + request_s, conn->in_size - request_s + 1);
+    conn->in_size -= request_s;
+  }
+
+  if (conn->in_size == sizeof(conn->in) - 1) {
+    loopback_close(server, conn);
+    return;
+  }
+
+  loopback_flush(server, conn, loopback_now_ms());
+}
+
+static void loopback_accept(loopback_t* server) {
+  int fd = -1;
+  int enable = 1;
+
+  while ((fd = accept4(server->listen_fd, NULL, NULL, SOCK_NONBLOCK)) >= 0) {
+    loopback_conn_t*   conn = calloc(1, sizeof(loopback_conn_t));
+    struct epoll_event event = {.events = EPOLLIN};
+
+    if (conn == NULL) {
+      close(fd);
+      continue;
+    }
+
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &enable, sizeof(enable));
+
+    conn->fd = fd;
+    conn->next = server->conns;
+    server->conns = conn;
+
+    event.data.ptr = conn;
+    epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, fd, &event);
+
+    pthread_mutex_lock(&server->mutex);
+    server->stats.connections++;
+    pthread_mutex_unlock(&server->mutex);
+  }
+}
+
+static void* loopback_loop(void* vargs) {
+  loopback_t*        server = (loopback_t*)vargs;
+  struct epoll_event events[LOOPBACK_MAX_EVENTS];
+
+  for (;;) {
+    long long        now = loopback_now_ms();
+    long long        wait = -1;
+    int              nevents = 0;
+    loopback_conn_t* conn = server->conns;
+
+    for (; conn != NULL; conn = conn->next) {
+      if (conn->out.size > conn->out_sent && conn->ready_at > now) {
+        long long delay = conn->ready_at - now;
+        wait = wait < 0 || delay < wait ? delay : wait;
+      }
+    }
+
+    nevents = epoll_wait(server->epoll_fd, events, LOOPBACK_MAX_EVENTS, (int)wait);
+
+    for (int i = 0; i < nevents; i++) {
+      if (events[i].data.ptr == &server->wake_fd) {
+        return NULL;
+      }
+
+      if (events[i].data.ptr == &server->listen_fd) {
+        loopback_accept(server);
+        continue;
+      }
+
+      conn = (loopback_conn_t*)events[i].data.ptr;
+
+      if (events[i].events & (EPOLLERR | EPOLLHUP)) {
+        loopback_close(server, conn);
+      } else if (events[i].events & EPOLLIN) {
+        loopback_readable(server, conn);
+      } else if (events[i].events & EPOLLOUT) {
+        loopback_flush(server, conn, loopback_now_ms());
+      }
+    }
+
+    now = loopback_now_ms();
+    conn = server->conns;
+
+    while (conn != NULL) {
+      loopback_conn_t* next = conn->next;
+
+      if (conn->out.size > conn->out_sent && conn->ready_at <= now && !conn->is_writing) {
+        loopback_flush(server, conn, now);
+      }
+
+      conn = next;
+    }
+  }
+}
+
+int loopback_start(loopback_t** server_ptr, const loopback_config_t* config) {
+  int                status = LOOPBACK_STATUS_NO_ERROR;
+  int                enable = 1;
+  loopback_t*        server = NULL;
+  struct sockaddr_in address;
+  socklen_t          address_s = sizeof(address);
+  struct epoll_event event = {.events = EPOLLIN};
+
+  if (server_ptr == NULL || config == NULL) {
+    return LOOPBACK_STATUS_INVALID_ARG;
+  }
+
+  if ((server = calloc(1, sizeof(loopback_t))) == NULL) {
+    return LOOPBACK_STATUS_MEM_ERROR;
+  }
+
+  server->config = *config;
+  server->root = strdup(config->root != NULL ? config->root : ".");
+  server->listen_fd = socket(AF_INET, SOCK_STREAM | SOCK_NONBLOCK, 0);
+  server->epoll_fd = epoll_create1(0);
+  server->wake_fd = eventfd(0, EFD_NONBLOCK);
+  pthread_mutex_init(&server->mutex, NULL);
+
+  if (server->listen_fd < 0 || server->epoll_fd < 0 || server->wake_fd < 0) {
+    status = LOOPBACK_STATUS_SOCK_ERROR;
+    goto clean_up;
+  }
+
+  memset(&address, 0, sizeof(address));
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+  address.sin_port = 0;
+
+  setsockopt(server->listen_fd, SOL_SOCKET, SO_REUSEADDR, &enable, sizeof(enable));
+
+  if (bind(server->listen_fd, (struct sockaddr*)&address, sizeof(address)) != 0 ||
+      listen(server->listen_fd, 512) != 0 ||
+      getsockname(server->listen_fd, (struct sockaddr*)&address, &address_s) != 0) {
+    status = LOOPBACK_STATUS_SOCK_ERROR;
+    goto clean_up;
+  }
+
+  server->port = ntohs(address.sin_port);
+
+  event.data.ptr = &server->listen_fd;
+  epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->listen_fd, &event);
+  event.data.ptr = &server->wake_fd;
+  epoll_ctl(server->epoll_fd, EPOLL_CTL_ADD, server->wake_fd, &event);
+
+  if (pthread_create(&server->thread, NULL, loopback_loop, server) != 0) {
+    status = LOOPBACK_STATUS_SOCK_ERROR;
+    goto clean_up;
+  }
+
+  *server_ptr = server;
+
+clean_up:
+  if (status != LOOPBACK_STATUS_NO_ERROR) {
+    close(server->listen_fd);
+    close(server->epoll_fd);
+    close(server->wake_fd);
+    pthread_mutex_destroy(&server->mutex);
+    free(server->root);
+    free(server);
+  }
+
+  return status;
+}
+
+int loopback_port(loopback_t* server, int* port) {
+  if (server == NULL || port == NULL) {
+    return LOOPBACK_STATUS_INVALID_ARG;
+  }
+
+  *port = server->port;
+
+  return LOOPBACK_STATUS_NO_ERROR;
+}
+
+int loopback_stats(loopback_t* server, loopback_stats_t* stats) {
+  if (server == NULL || stats == NULL) {
+    return LOOPBACK_STATUS_INVALID_ARG;
+  }
+
+  pthread_mutex_lock(&server->mutex);
+  *stats = server->stats;
+  pthread_mutex_unlock(&server->mutex);
+
+  return LOOPBACK_STATUS_NO_ERROR;
+}
+
+int loopback_stop(loopback_t* server) {
+  uint64_t one = 1;
+
+  if (server == NULL) {
+    return LOOPBACK_STATUS_INVALID_ARG;
+  }
+
+  if (write(server->wake_fd, &one, sizeof(one)) == sizeof(one)) {
+    pthread_join(server->thread, NULL);
+  }
+
+  while (server->conns != NULL) {
+    loopback_close(server, server->conns);
+  }
+
+  close(server->listen_fd);
+  close(server->epoll_fd);
+  close(server->wake_fd);
+  pthread_mutex_destroy(&server->mutex);
+  free(server->root);
+  free(server);
+
+  return LOOPBACK_STATUS_NO_ERROR;
+}
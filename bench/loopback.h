@@ -0,0 +1,93 @@
+/**
+ * @file loopback.h
+ * @brief Loopback HTTP/1.1 stand-in origin used by the fetch benchmarks.
+ */
+
+#ifndef __H_M3U8_BENCH_LOOPBACK__
+#define __H_M3U8_BENCH_LOOPBACK__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#define LOOPBACK_STATUS_NO_ERROR    0x00
+#define LOOPBACK_STATUS_INVALID_ARG 0x01
+#define LOOPBACK_STATUS_MEM_ERROR   0x02
+#define LOOPBACK_STATUS_SOCK_ERROR  0x03
+
+/**
+ * @struct loopback_config_t
+ * @brief Behavior of the stand-in origin.
+ *
+ * @details Files are served from root. Paths under /synthetic/ are generated
+ *          on the fly: /synthetic/media_<n>.m3u8 is a media playlist with n
+ *          segments and /synthetic/master_<n>.m3u8 a master with n variants.
+ */
+typedef struct {
+  const char* root;       /**< directory served under "/" (e.g., assets) */
+  int         latency_ms; /**< delay added before every response */
+  size_t      chunk_size; /**< chunked transfer encoding size, 0 disables it */
+  bool        gzip;       /**< gzip bodies when the client accepts it */
+} loopback_config_t;
+
+/**
+ * @struct loopback_stats_t
+ * @brief Counters collected since the server started.
+ */
+typedef struct {
+  unsigned long connections; /**< accepted tcp connections */
+  unsigned long requests;    /**< requests answered */
+  unsigned long bytes;       /**< response bytes written, headers included */
+} loopback_stats_t;
+
+/**
+ * @struct loopback_t
+ * @brief Opaque server handle.
+ */
+typedef struct loopback loopback_t;
+
+/**
+ * @brief Binds 127.0.0.1 on an ephemeral port and serves from a thread.
+ *
+ * @param[out] server_ptr Address where the new handle will be stored.
+ * @param[in]  config     Server behavior, copied by the call.
+ *
+ * @retval LOOPBACK_STATUS_NO_ERROR    On success.
+ * @retval LOOPBACK_STATUS_INVALID_ARG If an argument is NULL.
+ * @retval LOOPBACK_STATUS_MEM_ERROR   If memory allocation fails.
+ * @retval LOOPBACK_STATUS_SOCK_ERROR  If the socket or epoll setup fails.
+ */
+int loopback_start(loopback_t** server_ptr, const loopback_config_t* config);
+
+/**
+ * @brief Returns the port the server is listening on.
+ *
+ * @param[in]  server Server handle.
+ * @param[out] port   Listening port.
+ *
+ * @retval LOOPBACK_STATUS_NO_ERROR    On success.
+ * @retval LOOPBACK_STATUS_INVALID_ARG If an argument is NULL.
+ */
+int loopback_port(loopback_t* server, int* port);
+
+/**
+ * @brief Copies the server counters.
+ *
+ * @param[in]  server Server handle.
+ * @param[out] stats  Counters collected so far.
+ *
+ * @retval LOOPBACK_STATUS_NO_ERROR    On success.
+ * @retval LOOPBACK_STATUS_INVALID_ARG If an argument is NULL.
+ */
+int loopback_stats(loopback_t* server, loopback_stats_t* stats);
+
+/**
+ * @brief Stops the server thread, closes every connection and frees it.
+ *
+ * @param[in] server Server handle.
+ *
+ * @retval LOOPBACK_STATUS_NO_ERROR    On success.
+ * @retval LOOPBACK_STATUS_INVALID_ARG If server is NULL.
+ */
+int loopback_stop(loopback_t* server);
+
+#endif  // __H_M3U8_BENCH_LOOPBACK__
@@ -0,0 +1,279 @@
+/**
+ * @file abr.c
+ * @brief Adaptive bitrate: throughput estimation and variant selection.
+ */
+
+#include "abr.h"
+
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+
+struct m3u8_abr_ladder {
+  int*                       bandwidths; /**< BANDWIDTH of each rung, ascending */
+  const ext_x_stream_inf_t** variants;   /**< variant of each rung */
+  int                        rungs_s;    /**< number of rungs */
+  double                     safety;     /**< share of the estimate a rung may use */
+};
+
+int m3u8_abr_estimator_init(m3u8_abr_estimator_t* estimator,
+                            double                half_life_ms,
+                            double                default_bps) {
+  int status = M3U8_ABR_STATUS_NO_ERROR;
+
+  if (estimator == NULL || half_life_ms < 0 || default_bps < 0) {
+    RAISE(M3U8_ABR_STATUS_INVALID_ARG, "Invalid arg estimator, half_life_ms or default_bps");
+  }
+
+  memset(estimator, 0, sizeof(m3u8_abr_estimator_t));
+  estimator->half_life_ms = half_life_ms > 0 ? half_life_ms : M3U8_ABR_DEFAULT_HALF_LIFE_MS;
+  estimator->default_bps = default_bps;
+
+clean_up:
+  return status;
+}
+
+int m3u8_abr_sample(m3u8_abr_estimator_t* estimator, size_t bytes, double elapsed_ms) {
+  int status = M3U8_ABR_STATUS_NO_ERROR;
+
+  double bps = 0;
+  double decay = 0;
+
+  if (estimator == NULL || bytes == 0) {
+    RAISE(M3U8_ABR_STATUS_INVALID_ARG, "Invalid arg estimator (null) or bytes (0)");
+  }
+
+  elapsed_ms = elapsed_ms < 1.0 ? 1.0 : elapsed_ms;
+  bps = bytes * 8000.0 / elapsed_ms;
+
+  // NOTE: a long download moves the average more than a short one
+  decay = exp2(-elapsed_ms / estimator->half_life_ms);
+  estimator->ewma_bps = decay * estimator->ewma_bps + (1.0 - decay) * bps;
+  estimator->ewma_weight = decay * estimator->ewma_weight + (1.0 - decay);
+
+  if (estimator->samples_s == M3U8_ABR_WINDOW) {
+    estimator->inverse_sum -= estimator->inverse[estimator->next];
+  } else {
+    estimator->samples_s++;
+  }
+
+  estimator->inverse[estimator->next] = 1.0 / bps;
+  estimator->inverse_sum += estimator->inverse[estimator->next];
+  estimator->next = (estimator->next + 1) % M3U8_ABR_WINDOW;
+
+clean_up:
+  return status;
+}
+
+double m3u8_abr_estimate(const m3u8_abr_estimator_t* estimator) {
+  double ewma = 0;
+  double harmonic = 0;
+
+  if (estimator == NULL || estimator->samples_s == 0) {
+    return estimator != NULL ? estimator->default_bps : 0;
+  }
+
+  ewma = estimator->ewma_bps / estimator->ewma_weight;
+  harmonic = estimator->samples_s / estimator->inverse_sum;
+
+  return ewma < harmonic ? ewma : harmonic;
+}
+
+/**
+ * @brief Maps an HDCP-LEVEL value to its level.
+ *
+ * @details A level this library does not know may require more than any
+ *          known one, so it ranks above TYPE-1 and only an unconstrained
+ *          output plays it.
+ */
+static m3u8_abr_hdcp_e __m3u8_abr_hdcp(const char* level) {
+  if (level == NULL || strcmp(level, "NONE") == 0) {
+    return M3U8_ABR_HDCP_NONE;
+  }
+
+  if (strcmp(level, "TYPE-0") == 0) {
+    return M3U8_ABR_HDCP_TYPE_0;
+  }
+
+  if (strcmp(level, "TYPE-1") == 0) {
+    return M3U8_ABR_HDCP_TYPE_1;
+  }
+
+  return M3U8_ABR_HDCP_UNKNOWN;
+}
+
+/**
+ * @brief Tells whether every codec of a CODECS list is supported.
+ *
+ * @details Codecs are compared by their sample entry, the part before the
+ *          first dot (e.g., avc1 for avc1.4d401f).
+ */
+static bool __m3u8_abr_is_decodable(const char* codecs, const char* const* supported) {
+  const char* pivot = codecs;
+
+  if (codecs == NULL || supported == NULL) {
+    return true;
+  }
+
+  while (*pivot != 0) {
+    size_t entry_s = 0;
+    bool   is_supported = false;
+
+    pivot += strspn(pivot, "\", ");
+    entry_s = strcspn(pivot, ".,\" ");
+
+    if (entry_s == 0) {
+      pivot += *pivot != 0;
+      continue;
+    }
+
+    for (const char* const* it = supported; *it != NULL && !is_supported; it++) {
+      is_supported = strlen(*it) == entry_s && strncmp(*it, pivot, entry_s) == 0;
+    }
+
+    if (!is_supported) {
+      return false;
+    }
+
+    pivot += strcspn(pivot, ",");
+  }
+
+  return true;
+}
+
+static bool __m3u8_abr_is_playable(const ext_x_stream_inf_t*     variant,
+                                   const m3u8_abr_constraints_t* constraints) {
+  int width = 0;
+  int height = 0;
+
+  if (variant->resolution != NULL && sscanf(variant->resolution, "%dx%d", &width, &height) == 2 &&
+      ((constraints->max_width > 0 && width > constraints->max_width) ||
+       (constraints->max_height > 0 && height > constraints->max_height))) {
+    return false;
+  }
+
+  if (constraints->max_frame_rate > 0 && variant->frame_rate > constraints->max_frame_rate) {
+    return false;
+  }
+
+  if (constraints->max_hdcp != M3U8_ABR_HDCP_ANY &&
+      __m3u8_abr_hdcp(variant->hdcp_level) > constraints->max_hdcp) {
+    return false;
+  }
+
+  return __m3u8_abr_is_decodable(variant->codecs, constraints->codecs);
+}
+
+int m3u8_abr_ladder_create(m3u8_abr_ladder_t**           ladder_ptr,
+                           const m3u8_t*                 m3u8_ptr,
+                           const m3u8_abr_constraints_t* constraints) {
+  int status = M3U8_ABR_STATUS_NO_ERROR;
+
+  m3u8_abr_ladder_t*     ladder = NULL;
+  m3u8_abr_constraints_t none = {0};
+
+  if (ladder_ptr == NULL || *ladder_ptr != NULL || m3u8_ptr == NULL) {
+    RAISE(M3U8_ABR_STATUS_INVALID_ARG, "Invalid arg ladder_ptr, must point to NULL, or m3u8_ptr");
+  }
+
+  if (m3u8_ptr->variants_count > 0 && m3u8_ptr->by_bandwidth == NULL) {
+    RAISE(M3U8_ABR_STATUS_INVALID_ARG, "Bandwidth index not built, see m3u8_variant_index");
+  }
+
+  constraints = constraints != NULL ? constraints : &none;
+
+  if ((ladder = calloc(1, sizeof(m3u8_abr_ladder_t))) == NULL) {
+    RAISE(M3U8_ABR_STATUS_MEM_ALLOC_ERROR, "Unable to allocate ladder");
+  }
+
+  ladder->safety = constraints->safety > 0 ? constraints->safety : M3U8_ABR_DEFAULT_SAFETY;
+
+  if (m3u8_ptr->variants_count > 0 &&
+      ((ladder->bandwidths = malloc(m3u8_ptr->variants_count * sizeof(int))) == NULL ||
+       (ladder->variants = malloc(m3u8_ptr->variants_count * sizeof(ext_x_stream_inf_t*))) == NULL)) {
+    RAISE(M3U8_ABR_STATUS_MEM_ALLOC_ERROR, "Unable to allocate %d rungs", m3u8_ptr->variants_count);
+  }
+
+  // NOTE: the index is already sorted, filtering keeps the ladder sorted
+  for (int i = 0; i < m3u8_ptr->variants_count; i++) {
+    const ext_x_stream_inf_t* variant = &m3u8_ptr->variants[m3u8_ptr->by_bandwidth[i].index];
+
+    if (__m3u8_abr_is_playable(variant, constraints)) {
+      ladder->bandwidths[ladder->rungs_s] = m3u8_ptr->by_bandwidth[i].bandwidth;
+      ladder->variants[ladder->rungs_s] = variant;
+      ladder->rungs_s++;
+    }
+  }
+
+  if (ladder->rungs_s == 0) {
+    RAISE(M3U8_ABR_STATUS_NOT_FOUND, "None of the %d variants is playable", m3u8_ptr->variants_count);
+  }
+
+  *ladder_ptr = ladder;
+
+clean_up:
+  if (status != M3U8_ABR_STATUS_NO_ERROR && ladder != NULL) {
+    m3u8_abr_ladder_destroy(ladder);
+  }
+
+  return status;
+}
+
+int m3u8_abr_ladder_size(const m3u8_abr_ladder_t* ladder) {
+  return ladder != NULL ? ladder->rungs_s : 0;
+}
+
+const ext_x_stream_inf_t* m3u8_abr_ladder_rung(const m3u8_abr_ladder_t* ladder, int rung) {
+  if (ladder == NULL || rung < 0 || rung >= ladder->rungs_s) {
+    return NULL;
+  }
+
+  return ladder->variants[rung];
+}
+
+int m3u8_abr_select(const m3u8_abr_ladder_t* ladder, double estimate_bps, int* rung) {
+  int status = M3U8_ABR_STATUS_NO_ERROR;
+
+  double budget = 0;
+  int    low = 0;
+  int    high = 0;
+
+  if (ladder == NULL || rung == NULL) {
+    RAISE(M3U8_ABR_STATUS_INVALID_ARG, "Invalid arg ladder or rung (null)");
+  }
+
+  budget = estimate_bps * ladder->safety;
+
+  for (high = ladder->rungs_s; low < high;) {
+    int middle = low + (high - low) / 2;
+
+    if (ladder->bandwidths[middle] <= budget) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  *rung = low > 0 ? low - 1 : 0;
+
+clean_up:
+  return status;
+}
+
+int m3u8_abr_ladder_destroy(m3u8_abr_ladder_t* ladder) {
+  int status = M3U8_ABR_STATUS_NO_ERROR;
+
+  if (ladder == NULL) {
+    RAISE(M3U8_ABR_STATUS_INVALID_ARG, "Invalid arg ladder (null)");
+  }
+
+  free(ladder->bandwidths);
+  free(ladder->variants);
+  free(ladder);
+
+clean_up:
+  return status;
+}
@@ -0,0 +1,216 @@
+/**
+ * @file abr.h
+ * @brief Adaptive bitrate: throughput estimation and variant selection.
+ */
+
+#ifndef __H_M3U8_ABR__
+#define __H_M3U8_ABR__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "m3u8.h"
+
+/**
+ * @brief Operation completed successfully.
+ *
+ * @details Returned when a function completes without error.
+ */
+#define M3U8_ABR_STATUS_NO_ERROR        0x03000000
+
+/**
+ * @brief Invalid argument received.
+ *
+ * @details Returned when a parameter is NULL, out of range or the playlist
+ *          has no bandwidth index.
+ */
+#define M3U8_ABR_STATUS_INVALID_ARG     (M3U8_ABR_STATUS_NO_ERROR + 0x01)
+
+/**
+ * @brief Memory allocation failure.
+ *
+ * @details Returned when memory allocation or reallocation fails.
+ */
+#define M3U8_ABR_STATUS_MEM_ALLOC_ERROR (M3U8_ABR_STATUS_NO_ERROR + 0x02)
+
+/**
+ * @brief No variant satisfies the constraints.
+ *
+ * @details Returned when building a ladder left no rung.
+ */
+#define M3U8_ABR_STATUS_NOT_FOUND       (M3U8_ABR_STATUS_NO_ERROR + 0x03)
+
+/**
+ * @brief Unknown error occurred.
+ *
+ * @details Returned when an unexpected or undefined error occurs.
+ */
+#define M3U8_ABR_STATUS_UNKNOWN_ERROR   (M3U8_ABR_STATUS_NO_ERROR + 0x99)
+
+/**
+ * @def M3U8_ABR_WINDOW
+ * @brief Number of most recent samples the harmonic mean is taken over.
+ */
+#define M3U8_ABR_WINDOW                 8
+
+/**
+ * @def M3U8_ABR_DEFAULT_HALF_LIFE_MS
+ * @brief Download time after which a sample weighs half in the EWMA.
+ */
+#define M3U8_ABR_DEFAULT_HALF_LIFE_MS   3000.0
+
+/**
+ * @def M3U8_ABR_DEFAULT_SAFETY
+ * @brief Share of the estimated throughput a variant may use.
+ */
+#define M3U8_ABR_DEFAULT_SAFETY         0.85
+
+/** @brief HDCP levels, ordered so that a higher level satisfies a lower one */
+typedef enum {
+  M3U8_ABR_HDCP_ANY,    /**< as a constraint: the output supports every level */
+  M3U8_ABR_HDCP_NONE,   /**< HDCP-LEVEL=NONE or absent */
+  M3U8_ABR_HDCP_TYPE_0, /**< HDCP-LEVEL=TYPE-0 */
+  M3U8_ABR_HDCP_TYPE_1, /**< HDCP-LEVEL=TYPE-1 */
+  M3U8_ABR_HDCP_UNKNOWN /**< any other HDCP-LEVEL, only played without constraint */
+} m3u8_abr_hdcp_e;
+
+/**
+ * @struct m3u8_abr_estimator_t
+ * @brief Per-session throughput estimator, a plain value without allocations.
+ *
+ * @details Keeps a moving average weighted by download time and the
+ *          harmonic mean of the last M3U8_ABR_WINDOW samples; the estimate
+ *          is the lower of both, so a single fast sample cannot trigger an
+ *          up-switch while a sudden drop shows up quickly. Not thread safe.
+ */
+typedef struct {
+  double half_life_ms;             /**< EWMA half-life in download time */
+  double default_bps;              /**< estimate before the first sample */
+  double ewma_bps;                 /**< biased moving average */
+  double ewma_weight;              /**< bias correction, 1 - product of decays */
+  double inverse[M3U8_ABR_WINDOW]; /**< 1 / bps of the window samples */
+  double inverse_sum;              /**< sum of inverse */
+  int    samples_s;                /**< samples in the window */
+  int    next;                     /**< slot of the next sample */
+} m3u8_abr_estimator_t;
+
+/**
+ * @struct m3u8_abr_constraints_t
+ * @brief What a device can play, zero initialized for no constraint.
+ */
+typedef struct {
+  int                max_width;      /**< widest RESOLUTION allowed, 0 for any */
+  int                max_height;     /**< tallest RESOLUTION allowed, 0 for any */
+  double             max_frame_rate; /**< highest FRAME-RATE allowed, 0 for any */
+  m3u8_abr_hdcp_e    max_hdcp;       /**< highest HDCP-LEVEL the output supports */
+  const char* const* codecs;         /**< supported codec prefixes (e.g., "avc1"),
+                                          NULL terminated; NULL for any */
+  double             safety;         /**< share of throughput to use, 0 for default */
+} m3u8_abr_constraints_t;
+
+/**
+ * @struct m3u8_abr_ladder_t
+ * @brief Opaque, immutable ladder of the playable variants sorted by
+ *        bandwidth; shareable by every session with the same constraints.
+ */
+typedef struct m3u8_abr_ladder m3u8_abr_ladder_t;
+
+/**
+ * @brief Initializes an estimator.
+ *
+ * @param[out] estimator    Estimator to initialize.
+ * @param[in]  half_life_ms EWMA half-life, 0 for M3U8_ABR_DEFAULT_HALF_LIFE_MS.
+ * @param[in]  default_bps  Estimate returned until the first sample.
+ *
+ * @retval M3U8_ABR_STATUS_NO_ERROR    On success.
+ * @retval M3U8_ABR_STATUS_INVALID_ARG If estimator is NULL or a value is negative.
+ */
+int m3u8_abr_estimator_init(m3u8_abr_estimator_t* estimator,
+                            double                half_life_ms,
+                            double                default_bps);
+
+/**
+ * @brief Feeds a segment download into an estimator.
+ *
+ * @param[in,out] estimator  Estimator.
+ * @param[in]     bytes      Bytes downloaded.
+ * @param[in]     elapsed_ms Download time, clamped to at least 1 ms.
+ *
+ * @retval M3U8_ABR_STATUS_NO_ERROR    On success.
+ * @retval M3U8_ABR_STATUS_INVALID_ARG If estimator is NULL or bytes is 0.
+ */
+int m3u8_abr_sample(m3u8_abr_estimator_t* estimator, size_t bytes, double elapsed_ms);
+
+/**
+ * @brief Returns the current throughput estimate.
+ *
+ * @param[in] estimator Estimator.
+ *
+ * @return the estimate in bits per second, default_bps before any sample.
+ */
+double m3u8_abr_estimate(const m3u8_abr_estimator_t* estimator);
+
+/**
+ * @brief Precomputes the ladder of the variants satisfying constraints.
+ *
+ * @param[out] ladder_ptr  Address where the ladder will be stored. Must
+ *                         point to NULL.
+ * @param[in]  m3u8_ptr    Master playlist indexed by m3u8_variant_index; must
+ *                         outlive the ladder.
+ * @param[in]  constraints Device constraints, NULL for none.
+ *
+ * @retval M3U8_ABR_STATUS_NO_ERROR        On success.
+ * @retval M3U8_ABR_STATUS_INVALID_ARG     If an argument is invalid.
+ * @retval M3U8_ABR_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ * @retval M3U8_ABR_STATUS_NOT_FOUND       If no variant is playable.
+ */
+int m3u8_abr_ladder_create(m3u8_abr_ladder_t**           ladder_ptr,
+                           const m3u8_t*                 m3u8_ptr,
+                           const m3u8_abr_constraints_t* constraints);
+
+/**
+ * @brief Returns the number of rungs of a ladder.
+ *
+ * @param[in] ladder Ladder.
+ *
+ * @return the number of playable variants, 0 when ladder is NULL.
+ */
+int m3u8_abr_ladder_size(const m3u8_abr_ladder_t* ladder);
+
+/**
+ * @brief Returns a rung of a ladder.
+ *
+ * @param[in] ladder Ladder.
+ * @param[in] rung   Rung index, 0 being the lowest bandwidth.
+ *
+ * @return the variant of the rung, NULL when out of range.
+ */
+const ext_x_stream_inf_t* m3u8_abr_ladder_rung(const m3u8_abr_ladder_t* ladder, int rung);
+
+/**
+ * @brief Picks the highest rung fitting an estimate.
+ *
+ * @details A binary search over the rung bandwidths, so it is cheap enough
+ *          to run for every segment of every session. When even the lowest
+ *          rung does not fit, the lowest rung is picked.
+ *
+ * @param[in]  ladder       Ladder.
+ * @param[in]  estimate_bps Throughput estimate (e.g., m3u8_abr_estimate).
+ * @param[out] rung         Index of the picked rung.
+ *
+ * @retval M3U8_ABR_STATUS_NO_ERROR    On success.
+ * @retval M3U8_ABR_STATUS_INVALID_ARG If an argument is NULL.
+ */
+int m3u8_abr_select(const m3u8_abr_ladder_t* ladder, double estimate_bps, int* rung);
+
+/**
+ * @brief Releases a ladder.
+ *
+ * @param[in] ladder Ladder to release.
+ *
+ * @retval M3U8_ABR_STATUS_NO_ERROR    On success.
+ * @retval M3U8_ABR_STATUS_INVALID_ARG If ladder is NULL.
+ */
+int m3u8_abr_ladder_destroy(m3u8_abr_ladder_t* ladder);
+
+#endif  // __H_M3U8_ABR__
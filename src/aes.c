@@ -0,0 +1,488 @@
+/**
+ * @file aes.c
+ * @brief AES-128-CBC decryption with an AES-NI path and a table driven fallback.
+ */
+
+#include "aes.h"
+
+#include <pthread.h>
+#include <string.h>
+
+#include "logger.h"
+
+#if defined(__x86_64__) || defined(__i386__)
+#define M3U8_AES_HAS_X86 1
+#include <wmmintrin.h>
+#endif
+
+#define M3U8_AES_ROUNDS 10
+
+static unsigned char  __m3u8_aes_sbox[256];
+static unsigned char  __m3u8_aes_inv_sbox[256];
+static uint32_t       __m3u8_aes_td[4][256];
+static bool           __m3u8_aes_has_aesni = false;
+static pthread_once_t __m3u8_aes_once = PTHREAD_ONCE_INIT;
+
+static inline unsigned char __m3u8_aes_rotl8(unsigned char x, int shift) {
+  return (unsigned char)((x << shift) | (x >> (8 - shift)));
+}
+
+static inline uint32_t __m3u8_aes_ror32(uint32_t x, int shift) {
+  return (x >> shift) | (x << (32 - shift));
+}
+
+static unsigned char __m3u8_aes_mul(unsigned char a, unsigned char b) {
+  unsigned char product = 0;
+
+  while (b != 0) {
+    if (b & 1) {
+      product ^= a;
+    }
+
+    a = (unsigned char)((a << 1) ^ ((a & 0x80) ? 0x1b : 0x00));
+    b >>= 1;
+  }
+
+  return product;
+}
+
+/**
+ * @brief Builds the S-boxes and the inverse round tables once per process.
+ *
+ * @details Each Td[n][x] holds InvSubBytes(x) times column n of the
+ *          InvMixColumns matrix, packed big-endian, so a decryption round is
+ *          sixteen lookups and xors.
+ */
+static void __m3u8_aes_global_init(void) {
+  unsigned char p = 1;
+  unsigned char q = 1;
+
+  // NOTE: walks GF(2^8) with generator 3, q tracks the inverse of p
+  do {
+    p = (unsigned char)(p ^ (p << 1) ^ ((p & 0x80) ? 0x1b : 0x00));
+
+    q ^= q << 1;
+    q ^= q << 2;
+    q ^= q << 4;
+    q ^= (q & 0x80) ? 0x09 : 0x00;
+
+    __m3u8_aes_sbox[p] = q ^ __m3u8_aes_rotl8(q, 1) ^ __m3u8_aes_rotl8(q, 2) ^
+                         __m3u8_aes_rotl8(q, 3) ^ __m3u8_aes_rotl8(q, 4) ^ 0x63;
+  } while (p != 1);
+
+  __m3u8_aes_sbox[0] = 0x63;
+
+  for (int i = 0; i < 256; i++) {
+    __m3u8_aes_inv_sbox[__m3u8_aes_sbox[i]] = (unsigned char)i;
+  }
+
+  for (int i = 0; i < 256; i++) {
+    unsigned char y = __m3u8_aes_inv_sbox[i];
+    uint32_t      word = ((uint32_t)__m3u8_aes_mul(y, 0x0e) << 24) |
+                    ((uint32_t)__m3u8_aes_mul(y, 0x09) << 16) |
+                    ((uint32_t)__m3u8_aes_mul(y, 0x0d) << 8) | (uint32_t)__m3u8_aes_mul(y, 0x0b);
+
+    __m3u8_aes_td[0][i] = word;
+    __m3u8_aes_td[1][i] = __m3u8_aes_ror32(word, 8);
+    __m3u8_aes_td[2][i] = __m3u8_aes_ror32(word, 16);
+    __m3u8_aes_td[3][i] = __m3u8_aes_ror32(word, 24);
+  }
+
+#ifdef M3U8_AES_HAS_X86
+  __builtin_cpu_init();
+  __m3u8_aes_has_aesni = __builtin_cpu_supports("aes");
+#endif
+}
+
+static inline uint32_t __m3u8_aes_load32(const unsigned char* bytes) {
+  return ((uint32_t)bytes[0] << 24) | ((uint32_t)bytes[1] << 16) | ((uint32_t)bytes[2] << 8) |
+         (uint32_t)bytes[3];
+}
+
+static inline void __m3u8_aes_store32(unsigned char* bytes, uint32_t word) {
+  bytes[0] = (unsigned char)(word >> 24);
+  bytes[1] = (unsigned char)(word >> 16);
+  bytes[2] = (unsigned char)(word >> 8);
+  bytes[3] = (unsigned char)word;
+}
+
+static inline uint32_t __m3u8_aes_inv_mix(uint32_t word) {
+  return __m3u8_aes_td[0][__m3u8_aes_sbox[word >> 24]] ^
+         __m3u8_aes_td[1][__m3u8_aes_sbox[(word >> 16) & 0xff]] ^
+         __m3u8_aes_td[2][__m3u8_aes_sbox[(word >> 8) & 0xff]] ^
+         __m3u8_aes_td[3][__m3u8_aes_sbox[word & 0xff]];
+}
+
+/**
+ * @brief Decrypts one block with the equivalent inverse cipher.
+ */
+static void __m3u8_aes_block_portable(const uint32_t* rk, const unsigned char* in,
+                                      unsigned char* out) {
+  uint32_t s0 = __m3u8_aes_load32(in) ^ rk[0];
+  uint32_t s1 = __m3u8_aes_load32(in + 4) ^ rk[1];
+  uint32_t s2 = __m3u8_aes_load32(in + 8) ^ rk[2];
+  uint32_t s3 = __m3u8_aes_load32(in + 12) ^ rk[3];
+  uint32_t t0, t1, t2, t3;
+
+  for (int round = 1; round < M3U8_AES_ROUNDS; round++) {
+    rk += 4;
+
+    t0 = __m3u8_aes_td[0][s0 >> 24] ^ __m3u8_aes_td[1][(s3 >> 16) & 0xff] ^
+         __m3u8_aes_td[2][(s2 >> 8) & 0xff] ^ __m3u8_aes_td[3][s1 & 0xff] ^ rk[0];
+    t1 = __m3u8_aes_td[0][s1 >> 24] ^ __m3u8_aes_td[1][(s0 >> 16) & 0xff] ^
+         __m3u8_aes_td[2][(s3 >> 8) & 0xff] ^ __m3u8_aes_td[3][s2 & 0xff] ^ rk[1];
+    t2 = __m3u8_aes_td[0][s2 >> 24] ^ __m3u8_aes_td[1][(s1 >> 16) & 0xff] ^
+         __m3u8_aes_td[2][(s0 >> 8) & 0xff] ^ __m3u8_aes_td[3][s3 & 0xff] ^ rk[2];
+    t3 = __m3u8_aes_td[0][s3 >> 24] ^ __m3u8_aes_td[1][(s2 >> 16) & 0xff] ^
+         __m3u8_aes_td[2][(s1 >> 8) & 0xff] ^ __m3u8_aes_td[3][s0 & 0xff] ^ rk[3];
+
+    s0 = t0;
+    s1 = t1;
+    s2 = t2;
+    s3 = t3;
+  }
+
+  rk += 4;
+
+#define M3U8_AES_LAST(a, b, c, d)                                        \
+  (((uint32_t)__m3u8_aes_inv_sbox[(a) >> 24] << 24) |                    \
+   ((uint32_t)__m3u8_aes_inv_sbox[((b) >> 16) & 0xff] << 16) |           \
+   ((uint32_t)__m3u8_aes_inv_sbox[((c) >> 8) & 0xff] << 8) |             \
+   (uint32_t)__m3u8_aes_inv_sbox[(d) & 0xff])
+
+  __m3u8_aes_store32(out, M3U8_AES_LAST(s0, s3, s2, s1) ^ rk[0]);
+  __m3u8_aes_store32(out + 4, M3U8_AES_LAST(s1, s0, s3, s2) ^ rk[1]);
+  __m3u8_aes_store32(out + 8, M3U8_AES_LAST(s2, s1, s0, s3) ^ rk[2]);
+  __m3u8_aes_store32(out + 12, M3U8_AES_LAST(s3, s2, s1, s0) ^ rk[3]);
+
+#undef M3U8_AES_LAST
+}
+
+static void __m3u8_aes_cbc_portable(m3u8_aes_t* aes, const unsigned char* in, unsigned char* out,
+                                    size_t blocks) {
+  unsigned char cipher[M3U8_AES_BLOCK_SIZE];
+
+  for (size_t i = 0; i < blocks; i++) {
+    memcpy(cipher, in, M3U8_AES_BLOCK_SIZE);
+    __m3u8_aes_block_portable(aes->round_keys, cipher, out);
+
+    for (int j = 0; j < M3U8_AES_BLOCK_SIZE; j++) {
+      out[j] ^= aes->iv[j];
+    }
+
+    memcpy(aes->iv, cipher, M3U8_AES_BLOCK_SIZE);
+
+    in += M3U8_AES_BLOCK_SIZE;
+    out += M3U8_AES_BLOCK_SIZE;
+  }
+}
+
+#ifdef M3U8_AES_HAS_X86
+
+__attribute__((target("aes,sse2"))) static void __m3u8_aes_schedule_accel(
+    m3u8_aes_t* aes, const unsigned char* encrypt_keys) {
+  __m128i* dk = (__m128i*)aes->accel_keys;
+
+  // NOTE: aesdec expects the encryption keys reversed, middle ones through InvMixColumns
+  _mm_storeu_si128(&dk[0], _mm_loadu_si128((const __m128i*)(encrypt_keys + 16 * 10)));
+
+  for (int round = 1; round < M3U8_AES_ROUNDS; round++) {
+    __m128i key = _mm_loadu_si128((const __m128i*)(encrypt_keys + 16 * (10 - round)));
+    _mm_storeu_si128(&dk[round], _mm_aesimc_si128(key));
+  }
+
+  _mm_storeu_si128(&dk[10], _mm_loadu_si128((const __m128i*)encrypt_keys));
+}
+
+/**
+ * @brief CBC decryption keeping eight blocks in flight to hide aesdec latency.
+ *
+ * @details Every ciphertext block of a batch is loaded before any plaintext
+ *          is stored, so in and out may be the same buffer. The loops are
+ *          unrolled explicitly so -O2 keeps the batch in registers.
+ */
+__attribute__((target("aes,sse2"))) static void __m3u8_aes_cbc_accel(m3u8_aes_t*          aes,
+                                                                   const unsigned char* in,
+                                                                   unsigned char*       out,
+                                                                   size_t               blocks) {
+  __m128i k[11];
+  __m128i iv = _mm_loadu_si128((const __m128i*)aes->iv);
+
+  for (int i = 0; i <= M3U8_AES_ROUNDS; i++) {
+    k[i] = _mm_loadu_si128((const __m128i*)(aes->accel_keys + 16 * i));
+  }
+
+  for (; blocks >= 8; blocks -= 8) {
+    const __m128i* src = (const __m128i*)in;
+    __m128i        c[8];
+    __m128i        x[8];
+
+#pragma GCC unroll 8
+    for (int j = 0; j < 8; j++) {
+      c[j] = _mm_loadu_si128(&src[j]);
+      x[j] = _mm_xor_si128(c[j], k[0]);
+    }
+
+#pragma GCC unroll 9
+    for (int round = 1; round < M3U8_AES_ROUNDS; round++) {
+#pragma GCC unroll 8
+      for (int j = 0; j < 8; j++) {
+        x[j] = _mm_aesdec_si128(x[j], k[round]);
+      }
+    }
+
+    x[0] = _mm_xor_si128(_mm_aesdeclast_si128(x[0], k[10]), iv);
+
+#pragma GCC unroll 7
+    for (int j = 1; j < 8; j++) {
+      x[j] = _mm_xor_si128(_mm_aesdeclast_si128(x[j], k[10]), c[j - 1]);
+    }
+
+#pragma GCC unroll 8
+    for (int j = 0; j < 8; j++) {
+      _mm_storeu_si128((__m128i*)out + j, x[j]);
+    }
+
+    iv = c[7];
+    in += 8 * M3U8_AES_BLOCK_SIZE;
+    out += 8 * M3U8_AES_BLOCK_SIZE;
+  }
+
+  for (; blocks > 0; blocks--) {
+    __m128i c = _mm_loadu_si128((const __m128i*)in);
+    __m128i x = _mm_xor_si128(c, k[0]);
+
+    for (int round = 1; round < M3U8_AES_ROUNDS; round++) {
+      x = _mm_aesdec_si128(x, k[round]);
+    }
+
+    _mm_storeu_si128((__m128i*)out, _mm_xor_si128(_mm_aesdeclast_si128(x, k[10]), iv));
+
+    iv = c;
+    in += M3U8_AES_BLOCK_SIZE;
+    out += M3U8_AES_BLOCK_SIZE;
+  }
+
+  _mm_storeu_si128((__m128i*)aes->iv, iv);
+}
+
+#endif  // M3U8_AES_HAS_X86
+
+static void __m3u8_aes_cbc(m3u8_aes_t* aes, const unsigned char* in, unsigned char* out,
+                           size_t blocks) {
+#ifdef M3U8_AES_HAS_X86
+  if (aes->is_accelerated) {
+    __m3u8_aes_cbc_accel(aes, in, out, blocks);
+    return;
+  }
+#endif
+
+  __m3u8_aes_cbc_portable(aes, in, out, blocks);
+}
+
+static int __m3u8_aes_unpad(const unsigned char* block, size_t* block_s) {
+  unsigned char pad = block[M3U8_AES_BLOCK_SIZE - 1];
+  unsigned char diff = 0;
+
+  if (pad == 0 || pad > M3U8_AES_BLOCK_SIZE) {
+    return M3U8_AES_STATUS_PADDING_ERROR;
+  }
+
+  for (int i = M3U8_AES_BLOCK_SIZE - pad; i < M3U8_AES_BLOCK_SIZE; i++) {
+    diff |= block[i] ^ pad;
+  }
+
+  if (diff != 0) {
+    return M3U8_AES_STATUS_PADDING_ERROR;
+  }
+
+  *block_s = M3U8_AES_BLOCK_SIZE - pad;
+
+  return M3U8_AES_STATUS_NO_ERROR;
+}
+
+bool m3u8_aes_is_accelerated(void) {
+  pthread_once(&__m3u8_aes_once, __m3u8_aes_global_init);
+
+  return __m3u8_aes_has_aesni;
+}
+
+int m3u8_aes_init(m3u8_aes_t* aes, const unsigned char* key, const unsigned char* iv) {
+  int status = M3U8_AES_STATUS_NO_ERROR;
+
+  uint32_t      words[44];
+  unsigned char rcon = 0x01;
+
+  if (aes == NULL || key == NULL || iv == NULL) {
+    RAISE(M3U8_AES_STATUS_INVALID_ARG, "Invalid arg aes, key or iv (null)");
+  }
+
+  pthread_once(&__m3u8_aes_once, __m3u8_aes_global_init);
+
+  for (int i = 0; i < 4; i++) {
+    words[i] = __m3u8_aes_load32(key + 4 * i);
+  }
+
+  for (int i = 4; i < 44; i++) {
+    uint32_t temp = words[i - 1];
+
+    if (i % 4 == 0) {
+      temp = ((uint32_t)__m3u8_aes_sbox[(temp >> 16) & 0xff] << 24) |
+             ((uint32_t)__m3u8_aes_sbox[(temp >> 8) & 0xff] << 16) |
+             ((uint32_t)__m3u8_aes_sbox[temp & 0xff] << 8) | (uint32_t)__m3u8_aes_sbox[temp >> 24];
+      temp ^= (uint32_t)rcon << 24;
+      rcon = __m3u8_aes_mul(rcon, 0x02);
+    }
+
+    words[i] = words[i - 4] ^ temp;
+  }
+
+  // NOTE: decryption walks the schedule backwards, inner round keys get InvMixColumns
+  for (int round = 0; round <= M3U8_AES_ROUNDS; round++) {
+    for (int i = 0; i < 4; i++) {
+      uint32_t word = words[4 * (M3U8_AES_ROUNDS - round) + i];
+
+      aes->round_keys[4 * round + i] =
+          (round == 0 || round == M3U8_AES_ROUNDS) ? word : __m3u8_aes_inv_mix(word);
+    }
+  }
+
+  aes->is_accelerated = __m3u8_aes_has_aesni;
+
+#ifdef M3U8_AES_HAS_X86
+  if (aes->is_accelerated) {
+    unsigned char encrypt_keys[11 * M3U8_AES_BLOCK_SIZE];
+
+    for (int i = 0; i < 44; i++) {
+      __m3u8_aes_store32(encrypt_keys + 4 * i, words[i]);
+    }
+
+    __m3u8_aes_schedule_accel(aes, encrypt_keys);
+  }
+#endif
+
+  memcpy(aes->iv, iv, M3U8_AES_BLOCK_SIZE);
+  aes->pending_s = 0;
+
+clean_up:
+  return status;
+}
+
+int m3u8_aes_update(m3u8_aes_t* aes, const unsigned char* in, size_t in_s, unsigned char* out,
+                    size_t* out_s) {
+  int status = M3U8_AES_STATUS_NO_ERROR;
+
+  size_t total = 0;
+  size_t keep = 0;
+  size_t ready = 0;
+
+  if (aes == NULL || (in == NULL && in_s > 0) || out == NULL || out_s == NULL) {
+    RAISE(M3U8_AES_STATUS_INVALID_ARG, "Invalid arg aes, in, out or out_s (null)");
+  }
+
+  *out_s = 0;
+  total = aes->pending_s + in_s;
+
+  if (total <= M3U8_AES_BLOCK_SIZE) {
+    memcpy(aes->pending + aes->pending_s, in, in_s);
+    aes->pending_s = total;
+    goto clean_up;
+  }
+
+  // NOTE: the trailing block, complete or not, is held back for final
+  keep = total % M3U8_AES_BLOCK_SIZE != 0 ? total % M3U8_AES_BLOCK_SIZE : M3U8_AES_BLOCK_SIZE;
+  ready = total - keep;
+
+  // NOTE: plaintext runs pending_s bytes ahead of the ciphertext it comes
+  // from; overlapping input is first moved to where its plaintext goes, so
+  // every block is decrypted in place and nothing unread is overwritten
+  if ((uintptr_t)in < (uintptr_t)out + in_s + M3U8_AES_BLOCK_SIZE &&
+      (uintptr_t)out < (uintptr_t)in + in_s) {
+    memmove(out + aes->pending_s, in, in_s);
+    in = out + aes->pending_s;
+  }
+
+  if (aes->pending_s > 0) {
+    size_t fill = M3U8_AES_BLOCK_SIZE - aes->pending_s;
+
+    memcpy(aes->pending + aes->pending_s, in, fill);
+    __m3u8_aes_cbc(aes, aes->pending, out, 1);
+
+    in += fill;
+    out += M3U8_AES_BLOCK_SIZE;
+    ready -= M3U8_AES_BLOCK_SIZE;
+    *out_s = M3U8_AES_BLOCK_SIZE;
+  }
+
+  __m3u8_aes_cbc(aes, in, out, ready / M3U8_AES_BLOCK_SIZE);
+  *out_s += ready;
+
+  memcpy(aes->pending, in + ready, keep);
+  aes->pending_s = keep;
+
+clean_up:
+  return status;
+}
+
+int m3u8_aes_final(m3u8_aes_t* aes, unsigned char* out, size_t* out_s) {
+  int status = M3U8_AES_STATUS_NO_ERROR;
+
+  unsigned char block[M3U8_AES_BLOCK_SIZE];
+  size_t        block_s = 0;
+
+  if (aes == NULL || out == NULL || out_s == NULL) {
+    RAISE(M3U8_AES_STATUS_INVALID_ARG, "Invalid arg aes, out or out_s (null)");
+  }
+
+  *out_s = 0;
+
+  if (aes->pending_s != M3U8_AES_BLOCK_SIZE) {
+    RAISE(M3U8_AES_STATUS_INVALID_ARG, "Ciphertext is not block aligned (%zu trailing bytes)",
+          aes->pending_s);
+  }
+
+  __m3u8_aes_cbc(aes, aes->pending, block, 1);
+  aes->pending_s = 0;
+
+  if ((status = __m3u8_aes_unpad(block, &block_s)) != M3U8_AES_STATUS_NO_ERROR) {
+    RAISE(M3U8_AES_STATUS_PADDING_ERROR, "Malformed PKCS#7 padding");
+  }
+
+  memcpy(out, block, block_s);
+  *out_s = block_s;
+
+clean_up:
+  return status;
+}
+
+int m3u8_aes_decrypt(const unsigned char* key, const unsigned char* iv, unsigned char* data,
+                     size_t size, size_t* data_s) {
+  int status = M3U8_AES_STATUS_NO_ERROR;
+
+  m3u8_aes_t aes;
+  size_t     tail_s = 0;
+
+  if (data == NULL || data_s == NULL) {
+    RAISE(M3U8_AES_STATUS_INVALID_ARG, "Invalid arg data or data_s (null)");
+  }
+
+  if (size == 0 || size % M3U8_AES_BLOCK_SIZE != 0) {
+    RAISE(M3U8_AES_STATUS_INVALID_ARG, "Invalid arg size (%zu), must be block aligned", size);
+  }
+
+  if ((status = m3u8_aes_init(&aes, key, iv)) != M3U8_AES_STATUS_NO_ERROR) {
+    goto clean_up;
+  }
+
+  __m3u8_aes_cbc(&aes, data, data, size / M3U8_AES_BLOCK_SIZE);
+
+  if ((status = __m3u8_aes_unpad(data + size - M3U8_AES_BLOCK_SIZE, &tail_s)) !=
+      M3U8_AES_STATUS_NO_ERROR) {
+    RAISE(M3U8_AES_STATUS_PADDING_ERROR, "Malformed PKCS#7 padding");
+  }
+
+  *data_s = size - M3U8_AES_BLOCK_SIZE + tail_s;
+
+clean_up:
+  return status;
+}
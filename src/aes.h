@@ -0,0 +1,131 @@
+/**
+ * @file aes.h
+ * @brief Streaming AES-128-CBC decryption for EXT-X-KEY METHOD=AES-128 segments.
+ */
+
+#ifndef __H_M3U8_AES__
+#define __H_M3U8_AES__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Operation completed successfully.
+ *
+ * @details Returned when a function completes without error.
+ */
+#define M3U8_AES_STATUS_NO_ERROR      0x40000000
+
+/**
+ * @brief Invalid argument received.
+ *
+ * @details Returned when a parameter is NULL or a length is not a multiple of
+ *          the block size where one is required.
+ */
+#define M3U8_AES_STATUS_INVALID_ARG   (M3U8_AES_STATUS_NO_ERROR + 0x01)
+
+/**
+ * @brief The decrypted data does not end in valid PKCS#7 padding.
+ *
+ * @details Returned when the key or IV is wrong or the ciphertext was cut.
+ */
+#define M3U8_AES_STATUS_PADDING_ERROR (M3U8_AES_STATUS_NO_ERROR + 0x02)
+
+/**
+ * @brief Unknown error occurred.
+ *
+ * @details Returned when an unexpected or undefined error occurs.
+ */
+#define M3U8_AES_STATUS_UNKNOWN_ERROR (M3U8_AES_STATUS_NO_ERROR + 0x99)
+
+/**
+ * @def M3U8_AES_BLOCK_SIZE
+ * @brief AES block, key and IV size in bytes.
+ */
+#define M3U8_AES_BLOCK_SIZE           16
+
+/**
+ * @struct m3u8_aes_t
+ * @brief AES-128-CBC decryption context.
+ *
+ * @details Plain data, meant to live on the stack or inside another struct.
+ *          The last ciphertext block is always held back by update because it
+ *          carries the padding removed by final.
+ */
+typedef struct {
+  uint32_t      round_keys[44];                      /**< portable decryption schedule */
+  unsigned char accel_keys[11 * M3U8_AES_BLOCK_SIZE]; /**< AES-NI decryption schedule */
+  unsigned char iv[M3U8_AES_BLOCK_SIZE];              /**< chaining block */
+  unsigned char pending[M3U8_AES_BLOCK_SIZE];         /**< ciphertext not yet decrypted */
+  size_t        pending_s;                            /**< bytes in pending */
+  bool          is_accelerated;                       /**< AES-NI is used, may be cleared */
+} m3u8_aes_t;
+
+/**
+ * @brief Tells whether the CPU supports the AES-NI instructions.
+ *
+ * @return true when init will pick the accelerated path.
+ */
+bool m3u8_aes_is_accelerated(void);
+
+/**
+ * @brief Expands the key and resets the context for a new segment.
+ *
+ * @param[out] aes Context to initialize.
+ * @param[in]  key 16 byte key.
+ * @param[in]  iv  16 byte initialization vector.
+ *
+ * @retval M3U8_AES_STATUS_NO_ERROR    On success.
+ * @retval M3U8_AES_STATUS_INVALID_ARG If an argument is NULL.
+ */
+int m3u8_aes_init(m3u8_aes_t* aes, const unsigned char* key, const unsigned char* iv);
+
+/**
+ * @brief Decrypts the next piece of a segment, of any length.
+ *
+ * @param[in]  aes    Initialized context.
+ * @param[in]  in     Ciphertext chunk.
+ * @param[in]  in_s   Bytes in the chunk.
+ * @param[out] out    Plaintext output, at least in_s + 16 bytes, may be
+ *                    in itself or overlap it.
+ * @param[out] out_s  Bytes written to out.
+ *
+ * @retval M3U8_AES_STATUS_NO_ERROR    On success.
+ * @retval M3U8_AES_STATUS_INVALID_ARG If an argument is NULL.
+ */
+int m3u8_aes_update(m3u8_aes_t* aes, const unsigned char* in, size_t in_s, unsigned char* out,
+                    size_t* out_s);
+
+/**
+ * @brief Decrypts the held back block and strips its PKCS#7 padding.
+ *
+ * @param[in]  aes   Initialized context.
+ * @param[out] out   Plaintext output, at least 16 bytes.
+ * @param[out] out_s Bytes written to out (0 to 15).
+ *
+ * @retval M3U8_AES_STATUS_NO_ERROR      On success.
+ * @retval M3U8_AES_STATUS_INVALID_ARG   If an argument is NULL or the
+ *                                       ciphertext was not block aligned.
+ * @retval M3U8_AES_STATUS_PADDING_ERROR If the padding is malformed.
+ */
+int m3u8_aes_final(m3u8_aes_t* aes, unsigned char* out, size_t* out_s);
+
+/**
+ * @brief Decrypts a whole segment in place and strips its padding.
+ *
+ * @param[in]     key    16 byte key.
+ * @param[in]     iv     16 byte initialization vector.
+ * @param[in,out] data   Ciphertext, replaced by the plaintext.
+ * @param[in]     size   Ciphertext size, a multiple of 16.
+ * @param[out]    data_s Plaintext size.
+ *
+ * @retval M3U8_AES_STATUS_NO_ERROR      On success.
+ * @retval M3U8_AES_STATUS_INVALID_ARG   If an argument is NULL or size is not
+ *                                       block aligned.
+ * @retval M3U8_AES_STATUS_PADDING_ERROR If the padding is malformed.
+ */
+int m3u8_aes_decrypt(const unsigned char* key, const unsigned char* iv, unsigned char* data,
+                     size_t size, size_t* data_s);
+
+#endif  // __H_M3U8_AES__
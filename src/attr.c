@@ -1,21 +1,329 @@
-#include <regex.h>
+#include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "attr.h"
 #include "list.h"
 #include "logger.h"
+#include "slab.h"
+
+/** @brief Names of the known keys, indexed by m3u8_attr_key_e. */
+static const char* const __m3u8_attr_keys[M3U8_ATTR_KEY_UNKNOWN] = {
+    "ASSOC-LANGUAGE", "AUDIO", "AUTOSELECT", "AVERAGE-BANDWIDTH", "BANDWIDTH", "BYTERANGE",
+    "CHANNELS", "CHARACTERISTICS", "CLASS", "CLOSED-CAPTIONS", "CODECS", "DEFAULT", "DURATION",
+    "END-DATE", "END-ON-NEXT", "FORCED", "FRAME-RATE", "GROUP-ID", "HDCP-LEVEL", "ID", "IMPORT",
+    "INSTREAM-ID", "IV", "KEYFORMAT", "KEYFORMATVERSIONS", "LANGUAGE", "METHOD", "NAME",
+    "PATHWAY-ID", "PLANNED-DURATION", "PRECISE", "PROGRAM-ID", "QUERYPARAM", "RESOLUTION",
+    "SCTE35-CMD", "SCTE35-IN", "SCTE35-OUT", "SERVER-URI", "START-DATE", "SUBTITLES", "TIME-OFFSET",
+    "TYPE", "URI", "VALUE", "VIDEO", "VIDEO-RANGE",
+};
+
+static bool __m3u8_attr_is_key(char c) {
+  return (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '_' || c == '-';
+}
 
-int m3u8_attr_parse(char* buffer, m3u8_attr_t* attrs) {
+const char* m3u8_attr_next(const char* cursor, m3u8_attr_token_t* token) {
+  if (cursor == NULL || token == NULL) {
+    return NULL;
+  }
+
+  while (*cursor != 0) {
+    const char* run = cursor;
+    size_t      plain_s = 0;
+    size_t      quoted_s = 0;
+
+    if (!__m3u8_attr_is_key(*cursor)) {
+      cursor++;
+      continue;
+    }
+
+    while (__m3u8_attr_is_key(*cursor)) {
+      cursor++;
+    }
+
+    // NOTE: any later start inside the run ends at the same byte, so it fails too
+    if (*cursor != '=') {
+      continue;
+    }
+
+    cursor++;
+    plain_s = strcspn(cursor, ",");
+
+    if (*cursor == '"') {
+      const char* close = strchr(cursor + 1, '"');
+
+      quoted_s = close != NULL ? (size_t)(close - cursor) + 1 : 0;
+    }
+
+    if (plain_s == 0 && quoted_s == 0) {
+      continue;
+    }
+
+    token->key = run;
+    token->key_s = (size_t)(cursor - 1 - run);
+    token->id = m3u8_attr_key_lookup(run, token->key_s);
+    token->is_quoted = quoted_s >= plain_s;
+    token->value = token->is_quoted ? cursor + 1 : cursor;
+    token->value_s = token->is_quoted ? quoted_s - 2 : plain_s;
+
+    return cursor + (token->is_quoted ? quoted_s : plain_s);
+  }
+
+  return NULL;
+}
+
+/**
+ * @brief Appends an entry, moving the inline entries to the heap when full.
+ */
+static m3u8_attr_entry_t* __m3u8_attrs_append(m3u8_attrs_t* attrs) {
+  m3u8_attr_entry_t* entries = NULL;
+
+  if (attrs->count == attrs->capacity) {
+    if (attrs->entries == attrs->local) {
+      if ((entries = malloc(2 * attrs->capacity * sizeof(m3u8_attr_entry_t))) == NULL) {
+        return NULL;
+      }
+
+      memcpy(entries, attrs->local, attrs->count * sizeof(m3u8_attr_entry_t));
+    } else if ((entries = realloc(attrs->entries, 2 * attrs->capacity * sizeof(m3u8_attr_entry_t))) == NULL) {
+      return NULL;
+    }
+
+    attrs->entries = entries;
+    attrs->capacity *= 2;
+  }
+
+  entries = &attrs->entries[attrs->count++];
+  memset(entries, 0, sizeof(m3u8_attr_entry_t));
+
+  return entries;
+}
+
+m3u8_attr_key_e m3u8_attr_key_lookup(const char* key, size_t key_s) {
+  int low = 0;
+  int high = M3U8_ATTR_KEY_UNKNOWN - 1;
+
+  if (key == NULL) {
+    return M3U8_ATTR_KEY_UNKNOWN;
+  }
+
+  while (low <= high) {
+    int         middle = (low + high) / 2;
+    const char* name = __m3u8_attr_keys[middle];
+    int         compare = strncmp(name, key, key_s);
+
+    if (compare == 0 && name[key_s] != 0) {
+      compare = 1;
+    }
+
+    if (compare == 0) {
+      return (m3u8_attr_key_e)middle;
+    }
+
+    if (compare < 0) {
+      low = middle + 1;
+    } else {
+      high = middle - 1;
+    }
+  }
+
+  return M3U8_ATTR_KEY_UNKNOWN;
+}
+
+const char* m3u8_attr_key_name(m3u8_attr_key_e key) {
+  return key >= 0 && key < M3U8_ATTR_KEY_UNKNOWN ? __m3u8_attr_keys[key] : NULL;
+}
+
+int m3u8_attrs_init(m3u8_attrs_t* attrs) {
+  int status = M3U8_ATTR_STATUS_NO_ERROR;
+
+  if (attrs == NULL) {
+    RAISE(M3U8_ATTR_STATUS_INVALID_ARG, "Invalid arg attrs (null)");
+  }
+
+  attrs->entries = attrs->local;
+  attrs->count = 0;
+  attrs->capacity = M3U8_ATTRS_INITIAL_CAPACITY;
+  attrs->present = 0;
+
+clean_up:
+  return status;
+}
+
+int m3u8_attrs_append(m3u8_attrs_t* attrs, const m3u8_attr_token_t* token) {
   int status = M3U8_ATTR_STATUS_NO_ERROR;
 
-  regex_t    regex;
-  regmatch_t pmatch[3];  // 0: full match, 1: key, 2: value
+  m3u8_attr_entry_t* entry = NULL;
 
-  char* cursor = buffer;
-  char* pattern = "([A-Z0-9_-]+)=(\"[^\"]*\"|[^,]+)";
+  if (attrs == NULL || token == NULL) {
+    RAISE(M3U8_ATTR_STATUS_INVALID_ARG, "Invalid arg attrs or token (null)");
+  }
 
-  memset(&regex, 0, sizeof(regex_t));
+  if ((entry = __m3u8_attrs_append(attrs)) == NULL) {
+    RAISE(M3U8_ATTR_STATUS_MEM_ALLOC_ERROR, "Unable to allocate attribute");
+  }
+
+  entry->id = (unsigned char)token->id;
+  entry->is_quoted = token->is_quoted;
+
+  if (token->id == M3U8_ATTR_KEY_UNKNOWN) {
+    if ((entry->key = strndup(token->key, token->key_s)) == NULL) {
+      RAISE(M3U8_ATTR_STATUS_MEM_ALLOC_ERROR, "Unable to allocate attribute key");
+    }
+  } else if ((attrs->present & (1ULL << token->id)) == 0) {
+    attrs->present |= 1ULL << token->id;
+    attrs->first[token->id] = attrs->count - 1;
+  }
+
+  if (token->value_s < M3U8_ATTR_INLINE_SIZE) {
+    memcpy(entry->inline_value, token->value, token->value_s);
+    entry->inline_value[token->value_s] = 0;
+  } else if ((entry->value = strndup(token->value, token->value_s)) == NULL) {
+    RAISE(M3U8_ATTR_STATUS_MEM_ALLOC_ERROR, "Unable to allocate attribute value");
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_attrs_parse(const char* buffer, m3u8_attrs_t* attrs) {
+  int status = M3U8_ATTR_STATUS_NO_ERROR;
+
+  const char*       cursor = buffer;
+  m3u8_attr_token_t token;
+
+  if (m3u8_attrs_init(attrs) != M3U8_ATTR_STATUS_NO_ERROR) {
+    RAISE(M3U8_ATTR_STATUS_INVALID_ARG, "Invalid arg attrs (null)");
+  }
+
+  if (buffer == NULL) {
+    RAISE(M3U8_ATTR_STATUS_INVALID_ARG, "Invalid arg buffer (null)");
+  }
+
+  while ((cursor = m3u8_attr_next(cursor, &token)) != NULL) {
+    if ((status = m3u8_attrs_append(attrs, &token)) != M3U8_ATTR_STATUS_NO_ERROR) {
+      goto clean_up;
+    }
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_attrs_get(const m3u8_attrs_t* attrs, m3u8_attr_key_e key, const char** value) {
+  int status = M3U8_ATTR_STATUS_NO_ERROR;
+
+  if (attrs == NULL || value == NULL || key < 0 || key >= M3U8_ATTR_KEY_UNKNOWN) {
+    RAISE(M3U8_ATTR_STATUS_INVALID_ARG, "Invalid arg attrs, value (null) or key %d", key);
+  }
+
+  if ((attrs->present & (1ULL << key)) == 0) {
+    status = M3U8_ATTR_STATUS_NOT_FOUND;
+    goto clean_up;
+  }
+
+  *value = m3u8_attrs_value(attrs, attrs->first[key]);
+
+clean_up:
+  return status;
+}
+
+int m3u8_attrs_find(const m3u8_attrs_t* attrs, const char* key, const char** value) {
+  int status = M3U8_ATTR_STATUS_NOT_FOUND;
+
+  m3u8_attr_key_e id = M3U8_ATTR_KEY_UNKNOWN;
+
+  if (attrs == NULL || key == NULL || value == NULL) {
+    RAISE(M3U8_ATTR_STATUS_INVALID_ARG, "Invalid arg attrs, key or value (null)");
+  }
+
+  if ((id = m3u8_attr_key_lookup(key, strlen(key))) != M3U8_ATTR_KEY_UNKNOWN) {
+    return m3u8_attrs_get(attrs, id, value);
+  }
+
+  for (int i = 0; i < attrs->count; i++) {
+    if (attrs->entries[i].key != NULL && strcmp(attrs->entries[i].key, key) == 0) {
+      *value = m3u8_attrs_value(attrs, i);
+      return M3U8_ATTR_STATUS_NO_ERROR;
+    }
+  }
+
+clean_up:
+  return status;
+}
+
+const char* m3u8_attrs_key(const m3u8_attrs_t* attrs, int index) {
+  if (attrs == NULL || index < 0 || index >= attrs->count) {
+    return NULL;
+  }
+
+  return attrs->entries[index].key != NULL ? attrs->entries[index].key
+                                           : __m3u8_attr_keys[attrs->entries[index].id];
+}
+
+const char* m3u8_attrs_value(const m3u8_attrs_t* attrs, int index) {
+  if (attrs == NULL || index < 0 || index >= attrs->count) {
+    return NULL;
+  }
+
+  return attrs->entries[index].value != NULL ? attrs->entries[index].value
+                                             : attrs->entries[index].inline_value;
+}
+
+int m3u8_attrs_take(m3u8_attrs_t* attrs, int index, char** value) {
+  int status = M3U8_ATTR_STATUS_NO_ERROR;
+
+  m3u8_attr_entry_t* entry = NULL;
+
+  if (attrs == NULL || value == NULL || index < 0 || index >= attrs->count) {
+    RAISE(M3U8_ATTR_STATUS_INVALID_ARG, "Invalid arg attrs, value (null) or index %d", index);
+  }
+
+  entry = &attrs->entries[index];
+
+  if (entry->value != NULL) {
+    *value = entry->value;
+    entry->value = NULL;
+    entry->inline_value[0] = 0;
+  } else if ((*value = strdup(entry->inline_value)) == NULL) {
+    RAISE(M3U8_ATTR_STATUS_MEM_ALLOC_ERROR, "Unable to copy attribute value");
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_attrs_destroy(m3u8_attrs_t* attrs) {
+  int status = M3U8_ATTR_STATUS_NO_ERROR;
+
+  if (attrs == NULL) {
+    RAISE(M3U8_ATTR_STATUS_INVALID_ARG, "Invalid arg attrs (null)");
+  }
+
+  for (int i = 0; i < attrs->count; i++) {
+    free(attrs->entries[i].key);
+    free(attrs->entries[i].value);
+  }
+
+  if (attrs->entries != attrs->local) {
+    free(attrs->entries);
+  }
+
+  attrs->entries = attrs->local;
+  attrs->count = 0;
+  attrs->capacity = M3U8_ATTRS_INITIAL_CAPACITY;
+  attrs->present = 0;
+
+clean_up:
+  return status;
+}
+
+int m3u8_attr_parse(char* buffer, m3u8_attr_t* attrs) {
+  int status = M3U8_ATTR_STATUS_NO_ERROR;
+
+  m3u8_attrs_t flat;
+
+  memset(&flat, 0, sizeof(m3u8_attrs_t));
 
   if (buffer == NULL) {
     RAISE(M3U8_ATTR_STATUS_INVALID_ARG, "Invalid arg buffer (null)");
@@ -29,37 +337,45 @@ int m3u8_attr_parse(char* buffer, m3u8_attr_t* attrs) {
     RAISE(M3U8_ATTR_STATUS_LIST_ERROR, "Fail to initialize the attribute list");
   }
 
-  if (regcomp(&regex, pattern, REG_EXTENDED) != 0) {
-    RAISE(M3U8_ATTR_STATUS_MEM_ALLOC_ERROR, "Bad regular expression");
+  attrs->count = 0;
+
+  if ((status = m3u8_attrs_parse(buffer, &flat)) != M3U8_ATTR_STATUS_NO_ERROR) {
+    RAISE(status, "Unable to parse attributes");
   }
 
-  while (regexec(&regex, cursor, 3, pmatch, 0) == 0) {
-    m3u8_attr_t* attr = (m3u8_attr_t*)malloc(sizeof(m3u8_attr_t));
+  for (int i = 0; i < flat.count; i++) {
+    const char*  value = m3u8_attrs_value(&flat, i);
+    m3u8_attr_t* attr = NULL;
 
-    if (attr == NULL) {
+    // NOTE: nodes come from a size class, parse loops skip the malloc lock
+    if (m3u8_slab_alloc(m3u8_slab_class(sizeof(m3u8_attr_t)), (void**)&attr) !=
+        M3U8_SLAB_STATUS_NO_ERROR) {
       RAISE(M3U8_ATTR_STATUS_MEM_ALLOC_ERROR, "Unable to allocate attribute");
     }
 
-    memset(attr, 0, sizeof(m3u8_attr_t));
-
-    size_t key_s = pmatch[1].rm_eo - pmatch[1].rm_so;
-    size_t value_s = pmatch[2].rm_eo - pmatch[2].rm_so;
+    // NOTE: the list view keeps values as written, quotes included; the node
+    // is only linked once filled, so the list never holds a half-built one
+    if ((attr->key = strdup(m3u8_attrs_key(&flat, i))) == NULL ||
+        (attr->value = malloc(strlen(value) + 3)) == NULL) {
+      free(attr->key);
+      m3u8_slab_free(m3u8_slab_class(sizeof(m3u8_attr_t)), attr);
+      RAISE(M3U8_ATTR_STATUS_MEM_ALLOC_ERROR, "Unable to copy attribute");
+    }
 
-    attr->key = strndup(cursor + pmatch[1].rm_so, key_s);
-    attr->value = strndup(cursor + pmatch[2].rm_so, value_s);
+    sprintf(attr->value, flat.entries[i].is_quoted ? "\"%s\"" : "%s", value);
 
     if (m3u8_list_inb(&attrs->list, &attr->list) != M3U8_LIST_STATUS_NO_ERROR) {
+      free(attr->key);
+      free(attr->value);
+      m3u8_slab_free(m3u8_slab_class(sizeof(m3u8_attr_t)), attr);
       RAISE(M3U8_ATTR_STATUS_LIST_ERROR, "Could not insert attribute in list");
     }
 
-    if (pmatch[0].rm_eo == 0)
-      break;
-
-    cursor += pmatch[0].rm_eo;
+    attrs->count++;
   }
 
 clean_up:
-  regfree(&regex);
+  m3u8_attrs_destroy(&flat);
   return status;
 }
 
@@ -92,7 +408,6 @@ clean_up:
 }
 
 int m3u8_attr_count(m3u8_attr_t* attrs, int* size) {
-  int count = 0;
   int status = M3U8_ATTR_STATUS_NO_ERROR;
 
   if (attrs == NULL) {
@@ -103,9 +418,7 @@ int m3u8_attr_count(m3u8_attr_t* attrs, int* size) {
     RAISE(M3U8_ATTR_STATUS_INVALID_ARG, "Invalid arg size (null)");
   }
 
-  m3u8_list_count(&attrs->list, &count);  // NOTE: ignore any errors
-
-  *size = count;
+  *size = attrs->count;
 
 clean_up:
   return status;
@@ -130,11 +443,13 @@ int m3u8_attr_destroy(m3u8_attr_t* attrs) {
 
     free(entry->key);
     free(entry->value);
-    free(entry);
+    m3u8_slab_free(m3u8_slab_class(sizeof(m3u8_attr_t)), entry);
 
     pivot = next;
   }
 
+  attrs->count = 0;
+
 clean_up:
   return status;
 }
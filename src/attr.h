@@ -6,6 +6,10 @@
 #ifndef __H_M3U8_ATTR__
 #define __H_M3U8_ATTR__
 
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
 #include "list.h"
 
 /**
@@ -32,8 +36,8 @@
 /**
  * @brief Regular expression compilation failed.
  *
- * @details Returned when the regular expression used to parse attributes 
- *          cannot be compiled.
+ * @details No longer returned, attributes are scanned without a regular
+ *          expression. Kept so existing callers still compile.
  */
 #define M3U8_ATTR_STATUS_REG_PATTERN_ERROR (M3U8_ATTR_STATUS_NO_ERROR + 0x03)
 
@@ -59,6 +63,239 @@
  */
 #define M3U8_LIST_STATUS_UNKNOWN_ERROR     (M3U8_LIST_STATUS_NO_ERROR + 0x99)
 
+/**
+ * @brief Bytes of a value stored inside its entry, terminator included.
+ */
+#define M3U8_ATTR_INLINE_SIZE              30
+
+/**
+ * @brief Entries held inside the container before spilling to the heap.
+ */
+#define M3U8_ATTRS_INITIAL_CAPACITY        8
+
+/**
+ * @enum m3u8_attr_key_e
+ * @brief Attribute keys known to the parser, in byte order of their names.
+ *
+ * @details Known keys are stored as an id instead of a string and tracked
+ *          in the presence bitmap of m3u8_attrs_t, so there must be at
+ *          most 64 of them.
+ */
+typedef enum {
+  M3U8_ATTR_KEY_ASSOC_LANGUAGE,
+  M3U8_ATTR_KEY_AUDIO,
+  M3U8_ATTR_KEY_AUTOSELECT,
+  M3U8_ATTR_KEY_AVERAGE_BANDWIDTH,
+  M3U8_ATTR_KEY_BANDWIDTH,
+  M3U8_ATTR_KEY_BYTERANGE,
+  M3U8_ATTR_KEY_CHANNELS,
+  M3U8_ATTR_KEY_CHARACTERISTICS,
+  M3U8_ATTR_KEY_CLASS,
+  M3U8_ATTR_KEY_CLOSED_CAPTIONS,
+  M3U8_ATTR_KEY_CODECS,
+  M3U8_ATTR_KEY_DEFAULT,
+  M3U8_ATTR_KEY_DURATION,
+  M3U8_ATTR_KEY_END_DATE,
+  M3U8_ATTR_KEY_END_ON_NEXT,
+  M3U8_ATTR_KEY_FORCED,
+  M3U8_ATTR_KEY_FRAME_RATE,
+  M3U8_ATTR_KEY_GROUP_ID,
+  M3U8_ATTR_KEY_HDCP_LEVEL,
+  M3U8_ATTR_KEY_ID,
+  M3U8_ATTR_KEY_IMPORT,
+  M3U8_ATTR_KEY_INSTREAM_ID,
+  M3U8_ATTR_KEY_IV,
+  M3U8_ATTR_KEY_KEYFORMAT,
+  M3U8_ATTR_KEY_KEYFORMATVERSIONS,
+  M3U8_ATTR_KEY_LANGUAGE,
+  M3U8_ATTR_KEY_METHOD,
+  M3U8_ATTR_KEY_NAME,
+  M3U8_ATTR_KEY_PATHWAY_ID,
+  M3U8_ATTR_KEY_PLANNED_DURATION,
+  M3U8_ATTR_KEY_PRECISE,
+  M3U8_ATTR_KEY_PROGRAM_ID,
+  M3U8_ATTR_KEY_QUERYPARAM,
+  M3U8_ATTR_KEY_RESOLUTION,
+  M3U8_ATTR_KEY_SCTE35_CMD,
+  M3U8_ATTR_KEY_SCTE35_IN,
+  M3U8_ATTR_KEY_SCTE35_OUT,
+  M3U8_ATTR_KEY_SERVER_URI,
+  M3U8_ATTR_KEY_START_DATE,
+  M3U8_ATTR_KEY_SUBTITLES,
+  M3U8_ATTR_KEY_TIME_OFFSET,
+  M3U8_ATTR_KEY_TYPE,
+  M3U8_ATTR_KEY_URI,
+  M3U8_ATTR_KEY_VALUE,
+  M3U8_ATTR_KEY_VIDEO,
+  M3U8_ATTR_KEY_VIDEO_RANGE,
+  M3U8_ATTR_KEY_UNKNOWN /**< any other key, also the number of known keys */
+} m3u8_attr_key_e;
+
+/**
+ * @struct m3u8_attr_entry_t
+ * @brief One attribute of a m3u8_attrs_t, value stored without its quotes.
+ */
+typedef struct {
+  char*         key;                                /**< name of an unknown key, NULL when known */
+  char*         value;                              /**< value too long to be inline, else NULL */
+  unsigned char id;                                 /**< m3u8_attr_key_e of the key */
+  bool          is_quoted;                          /**< value was a quoted string */
+  char          inline_value[M3U8_ATTR_INLINE_SIZE]; /**< value when it fits */
+} m3u8_attr_entry_t;
+
+/**
+ * @struct m3u8_attrs_t
+ * @brief Attributes of a tag in a contiguous array, in tag order.
+ *
+ * @details The first M3U8_ATTRS_INITIAL_CAPACITY entries live inside the
+ *          container, so a typical tag is parsed without touching the heap.
+ *          The container points into itself and must not be copied.
+ */
+typedef struct {
+  m3u8_attr_entry_t* entries;                            /**< attributes in tag order */
+  int                count;                              /**< entries in use */
+  int                capacity;                           /**< entries allocated */
+  uint64_t           present;                            /**< bit per known key found */
+  int                first[M3U8_ATTR_KEY_UNKNOWN];       /**< entry of a known key, if present */
+  m3u8_attr_entry_t  local[M3U8_ATTRS_INITIAL_CAPACITY]; /**< storage before spilling */
+} m3u8_attrs_t;
+
+/**
+ * @struct m3u8_attr_token_t
+ * @brief One KEY=value pair found by m3u8_attr_next, pointing into the buffer.
+ */
+typedef struct {
+  const char*     key;       /**< first byte of the key */
+  size_t          key_s;     /**< bytes in the key */
+  m3u8_attr_key_e id;        /**< the key, M3U8_ATTR_KEY_UNKNOWN when not known */
+  const char*     value;     /**< first byte of the value, after an opening quote */
+  size_t          value_s;   /**< bytes in the value, quotes excluded */
+  bool            is_quoted; /**< value was a quoted string */
+} m3u8_attr_token_t;
+
+/**
+ * @brief Finds the next KEY=value pair at or after cursor.
+ *
+ * @details Matches like the POSIX pattern ([A-Z0-9_-]+)=("[^"]*"|[^,]+):
+ *          the value is the longer of the quoted string and the run up to
+ *          the next comma. Nothing is copied or allocated.
+ *
+ * @param[in]  cursor Position to scan from.
+ * @param[out] token  The pair found.
+ *
+ * @return The byte after the pair, to scan the next one from, or NULL when
+ *         there are no more pairs.
+ */
+const char* m3u8_attr_next(const char* cursor, m3u8_attr_token_t* token);
+
+/**
+ * @brief Prepares an empty container, for m3u8_attrs_append.
+ *
+ * @retval M3U8_ATTR_STATUS_NO_ERROR    On success.
+ * @retval M3U8_ATTR_STATUS_INVALID_ARG If attrs is NULL.
+ */
+int m3u8_attrs_init(m3u8_attrs_t* attrs);
+
+/**
+ * @brief Copies a token at the end of a container.
+ *
+ * @retval M3U8_ATTR_STATUS_NO_ERROR        On success.
+ * @retval M3U8_ATTR_STATUS_INVALID_ARG     If attrs or token is NULL.
+ * @retval M3U8_ATTR_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_attrs_append(m3u8_attrs_t* attrs, const m3u8_attr_token_t* token);
+
+/**
+ * @brief Parses tag attributes into a flat container.
+ *
+ * @details Accepts the same syntax as m3u8_attr_parse. Anything before the
+ *          first KEY=value pair, like the tag name, is skipped. attrs is
+ *          overwritten and must be released with m3u8_attrs_destroy, also
+ *          when parsing fails.
+ *
+ * @param[in]  buffer The null-terminated string containing tag attributes.
+ * @param[out] attrs  Container receiving the attributes.
+ *
+ * @retval M3U8_ATTR_STATUS_NO_ERROR        On success.
+ * @retval M3U8_ATTR_STATUS_INVALID_ARG     If buffer or attrs is NULL.
+ * @retval M3U8_ATTR_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_attrs_parse(const char* buffer, m3u8_attrs_t* attrs);
+
+/**
+ * @brief Looks up the first value of a known key, without comparing strings.
+ *
+ * @param[in]  attrs Parsed attributes.
+ * @param[in]  key   Known key, not M3U8_ATTR_KEY_UNKNOWN.
+ * @param[out] value Unquoted value, owned by attrs.
+ *
+ * @retval M3U8_ATTR_STATUS_NO_ERROR    On success.
+ * @retval M3U8_ATTR_STATUS_INVALID_ARG If attrs or value is NULL or key is unknown.
+ * @retval M3U8_ATTR_STATUS_NOT_FOUND   If the tag has no such attribute.
+ */
+int m3u8_attrs_get(const m3u8_attrs_t* attrs, m3u8_attr_key_e key, const char** value);
+
+/**
+ * @brief Looks up the first value of a key by name, known or not.
+ *
+ * @param[in]  attrs Parsed attributes.
+ * @param[in]  key   Name of the key.
+ * @param[out] value Unquoted value, owned by attrs.
+ *
+ * @retval M3U8_ATTR_STATUS_NO_ERROR    On success.
+ * @retval M3U8_ATTR_STATUS_INVALID_ARG If attrs, key or value is NULL.
+ * @retval M3U8_ATTR_STATUS_NOT_FOUND   If the tag has no such attribute.
+ */
+int m3u8_attrs_find(const m3u8_attrs_t* attrs, const char* key, const char** value);
+
+/**
+ * @brief Name of the key of entry index, NULL when out of range.
+ */
+const char* m3u8_attrs_key(const m3u8_attrs_t* attrs, int index);
+
+/**
+ * @brief Unquoted value of entry index, NULL when out of range.
+ */
+const char* m3u8_attrs_value(const m3u8_attrs_t* attrs, int index);
+
+/**
+ * @brief Hands the unquoted value of entry index over to the caller.
+ *
+ * @details A value stored on the heap is moved out and the entry is left
+ *          with an empty value, an inline one is duplicated.
+ *
+ * @param[in,out] attrs Parsed attributes.
+ * @param[in]     index Entry to take the value of.
+ * @param[out]    value Value, freed by the caller.
+ *
+ * @retval M3U8_ATTR_STATUS_NO_ERROR        On success.
+ * @retval M3U8_ATTR_STATUS_INVALID_ARG     If attrs or value is NULL or index is out of range.
+ * @retval M3U8_ATTR_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_attrs_take(m3u8_attrs_t* attrs, int index, char** value);
+
+/**
+ * @brief Frees the heap storage of a container, which may be parsed again.
+ *
+ * @param[in,out] attrs Container, zeroed or parsed.
+ *
+ * @retval M3U8_ATTR_STATUS_NO_ERROR    On success.
+ * @retval M3U8_ATTR_STATUS_INVALID_ARG If attrs is NULL.
+ */
+int m3u8_attrs_destroy(m3u8_attrs_t* attrs);
+
+/**
+ * @brief Maps a key name of key_s bytes to its id.
+ *
+ * @return The key, or M3U8_ATTR_KEY_UNKNOWN when it is not a known one.
+ */
+m3u8_attr_key_e m3u8_attr_key_lookup(const char* key, size_t key_s);
+
+/**
+ * @brief Name of a known key, NULL for M3U8_ATTR_KEY_UNKNOWN.
+ */
+const char* m3u8_attr_key_name(m3u8_attr_key_e key);
+
 /**
  * @struct m3u8_attr_t
  * @brief Represents a single key-value attribute parsed from an M3U8 tag 
@@ -68,11 +305,15 @@ typedef struct {
   char*            key;   /**< The attribute key (e.g., "BANDWIDTH"). */
   char*            value; /**< The attribute value (e.g., "1280000"). */
   m3u8_list_node_t list;  /**< Embedded node for circular linked list. */
+  int              count; /**< Nodes in the list, kept on the head by m3u8_attr_parse. */
 } m3u8_attr_t;
 
 /**
  * @brief Parses a buffer containing key-value attributes.
  *
+ * @details Builds a list view over m3u8_attrs_parse, with values quoted as
+ *          they appear in the tag. Prefer m3u8_attrs_t in new code.
+ *
  * @param[in]  buffer The null-terminated string containing tag attributes.
  * @param[out] attrs  Pointer to a m3u8_attr_t structure where parsed 
  *                    attributes will be stored.
@@ -80,7 +321,6 @@ typedef struct {
  * @retval M3U8_ATTR_STATUS_NO_ERROR          On success.
  * @retval M3U8_ATTR_STATUS_INVALID_ARG       If buffer or attrs is NULL.
  * @retval M3U8_ATTR_STATUS_MEM_ALLOC_ERROR   If memory allocation fails.
- * @retval M3U8_ATTR_STATUS_REG_PATTERN_ERROR If regex compilation fails.
  * @retval M3U8_ATTR_STATUS_LIST_ERROR        If insertion into the list fails.
  */
 int m3u8_attr_parse(char* buffer, m3u8_attr_t* attrs);
@@ -100,6 +340,9 @@ int m3u8_attr_from_key(m3u8_attr_t* attrs, m3u8_attr_t** attr, char* key);
 /**
  * @brief Counts the number of attributes in the list.
  *
+ * @details Reads the count m3u8_attr_parse kept on the head, without
+ *          walking the list.
+ *
  * @param[in]  attrs Pointer to the attribute list.
  * @param[out] size  Pointer to an integer where the count will be stored.
  *
@@ -5,6 +5,8 @@
 
 #include "conate.h"
 
+#include <ctype.h>
+#include <stdio.h>
 #include <sys/time.h>
 
 /**
@@ -89,3 +91,91 @@ int conate_timefmt_utc(long* tms, char* obuff, int size, const char* fmt) {
 
   return CONATE_NO_ERROR;
 }
+
+/**
+ * @brief Days between the Unix Epoch and a proleptic Gregorian date.
+ */
+static long conate_days_from_civil(long year, int month, int day) {
+  long era = 0;
+  long yoe = 0;
+  long doy = 0;
+
+  year -= month <= 2;
+  era = (year >= 0 ? year : year - 399) / 400;
+  yoe = year - era * 400;
+  doy = (153 * (month + (month > 2 ? -3 : 9)) + 2) / 5 + day - 1;
+
+  return era * 146097 + yoe * 365 + yoe / 4 - yoe / 100 + doy - 719468;
+}
+
+/**
+ * @brief Parses an ISO 8601 date-time, as found in EXT-X-PROGRAM-DATE-TIME.
+ *
+ * Accepts YYYY-MM-DDThh:mm:ss with optional fractional seconds and a time
+ * zone designator (Z, +hh:mm, +hhmm or +hh); without designator the time
+ * is taken as UTC.
+ *
+ * @param[in] text Date-time to parse.
+ * @param[out] obuff Pointer to a double where the seconds since the Unix Epoch will be stored.
+ *
+ * @return CONATE_NO_ERROR on success.
+ * @return CONATE_INVALID_POINTER if a provided pointer is NULL.
+ * @return CONATE_TIME_ERROR if text is not a valid date-time.
+ */
+int conate_parse_iso8601(const char* text, double* obuff) {
+  int    year = 0, month = 0, day = 0, hour = 0, minute = 0, second = 0;
+  int    consumed = 0;
+  double fraction = 0;
+  long   zone = 0;
+
+  if (text == NULL || obuff == NULL) {
+    return CONATE_INVALID_POINTER;
+  }
+
+  if (sscanf(text, "%4d-%2d-%2d%*1[Tt ]%2d:%2d:%2d%n", &year, &month, &day, &hour, &minute, &second,
+             &consumed) != 6 ||
+      consumed == 0 || month < 1 || month > 12 || day < 1 || day > 31 || hour > 23 || minute > 59 ||
+      second > 60) {
+    return CONATE_TIME_ERROR;
+  }
+
+  text += consumed;
+
+  if (*text == '.' || *text == ',') {
+    for (double scale = 0.1; isdigit((unsigned char)*++text); scale /= 10) {
+      fraction += (*text - '0') * scale;
+    }
+  }
+
+  if (*text == '+' || *text == '-') {
+    int zone_hour = 0;
+    int zone_minute = 0;
+    int sign = *text == '-' ? -1 : 1;
+
+    if (!isdigit((unsigned char)text[1]) || !isdigit((unsigned char)text[2])) {
+      return CONATE_TIME_ERROR;
+    }
+
+    zone_hour = (text[1] - '0') * 10 + (text[2] - '0');
+    text += 3;
+    text += *text == ':';
+
+    if (isdigit((unsigned char)text[0]) && isdigit((unsigned char)text[1])) {
+      zone_minute = (text[0] - '0') * 10 + (text[1] - '0');
+      text += 2;
+    }
+
+    zone = sign * (zone_hour * 3600L + zone_minute * 60L);
+  } else if (*text == 'Z' || *text == 'z') {
+    text++;
+  }
+
+  if (*text != 0) {
+    return CONATE_TIME_ERROR;
+  }
+
+  *obuff = conate_days_from_civil(year, month, day) * 86400.0 + hour * 3600L + minute * 60L + second -
+           zone + fraction;
+
+  return CONATE_NO_ERROR;
+}
@@ -9,4 +9,6 @@ int conate_timenow(long* obuff);
 
 int conate_timefmt(long* tms, char* obuff, int size, const char* fmt);
 
+int conate_parse_iso8601(const char* text, double* obuff);
+
 #endif  // __H_CONATE__
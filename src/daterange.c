@@ -0,0 +1,453 @@
+/**
+ * @file daterange.c
+ * @brief EXT-X-DATERANGE parsing and an interval index for overlap queries.
+ */
+
+#include "daterange.h"
+
+#include <math.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "attr.h"
+#include "conate.h"
+#include "logger.h"
+
+#define M3U8_DATERANGE_INITIAL_CAPACITY 8
+
+static int __m3u8_daterange_number(const m3u8_attrs_t* attrs, int index, double* number) {
+  const char* value = m3u8_attrs_value(attrs, index);
+  char*       end = NULL;
+
+  if (attrs->entries[index].is_quoted) {
+    return M3U8_DATERANGE_STATUS_FORMAT_ERROR;
+  }
+
+  *number = strtod(value, &end);
+
+  return end != value && *end == 0 && *number >= 0 ? M3U8_DATERANGE_STATUS_NO_ERROR
+                                                    : M3U8_DATERANGE_STATUS_FORMAT_ERROR;
+}
+
+static int __m3u8_daterange_date(const m3u8_attrs_t* attrs, int index, double* date) {
+  return conate_parse_iso8601(m3u8_attrs_value(attrs, index), date) == CONATE_NO_ERROR
+             ? M3U8_DATERANGE_STATUS_NO_ERROR
+             : M3U8_DATERANGE_STATUS_FORMAT_ERROR;
+}
+
+static double __m3u8_daterange_end(const ext_x_daterange_t* daterange) {
+  if (daterange->end_date > 0) {
+    return daterange->end_date;
+  }
+
+  if (daterange->duration >= 0) {
+    return daterange->start_date + daterange->duration;
+  }
+
+  if (daterange->planned_duration >= 0) {
+    return daterange->start_date + daterange->planned_duration;
+  }
+
+  return daterange->is_end_on_next ? INFINITY : daterange->start_date;
+}
+
+static bool __m3u8_daterange_is_open(const ext_x_daterange_t* daterange) {
+  return daterange->is_end_on_next && daterange->end_date <= 0 && daterange->duration < 0 &&
+         daterange->planned_duration < 0;
+}
+
+static bool __m3u8_daterange_same_class(const ext_x_daterange_t* a, const ext_x_daterange_t* b) {
+  return a->class_name != NULL && b->class_name != NULL && strcmp(a->class_name, b->class_name) == 0;
+}
+
+/**
+ * @brief Refreshes the leaf of range i and its ancestors.
+ */
+static void __m3u8_daterange_bubble(m3u8_media_t* media, int i) {
+  double* ends = media->daterange_ends;
+  int     node = media->daterange_leaves + i;
+
+  ends[node] = i < media->dateranges_count ? media->dateranges[i].end : -INFINITY;
+
+  for (node /= 2; node >= 1; node /= 2) {
+    ends[node] = ends[2 * node] > ends[2 * node + 1] ? ends[2 * node] : ends[2 * node + 1];
+  }
+}
+
+static int __m3u8_daterange_rebuild(m3u8_media_t* media) {
+  int status = M3U8_DATERANGE_STATUS_NO_ERROR;
+
+  int leaves = 1;
+
+  while (leaves < media->dateranges_count) {
+    leaves *= 2;
+  }
+
+  if (leaves != media->daterange_leaves) {
+    double* ends = realloc(media->daterange_ends, 2 * leaves * sizeof(double));
+
+    if (ends == NULL) {
+      RAISE(M3U8_DATERANGE_STATUS_MEM_ALLOC_ERROR, "Unable to allocate %d leaves", leaves);
+    }
+
+    media->daterange_ends = ends;
+    media->daterange_leaves = leaves;
+  }
+
+  for (int i = 0; i < leaves; i++) {
+    media->daterange_ends[leaves + i] = i < media->dateranges_count ? media->dateranges[i].end : -INFINITY;
+  }
+
+  for (int node = leaves - 1; node >= 1; node--) {
+    double left = media->daterange_ends[2 * node];
+    double right = media->daterange_ends[2 * node + 1];
+
+    media->daterange_ends[node] = left > right ? left : right;
+  }
+
+clean_up:
+  return status;
+}
+
+/**
+ * @brief Reports the ranges below node, among [low, high), ending at or after from.
+ */
+static void __m3u8_daterange_collect(const m3u8_media_t*       media,
+                                     int                       node,
+                                     int                       low,
+                                     int                       high,
+                                     int                       limit,
+                                     double                    from,
+                                     const ext_x_daterange_t** found,
+                                     int                       found_s,
+                                     int*                      count) {
+  // NOTE: whole subtrees that ended before the window are skipped
+  if (low >= limit || media->daterange_ends[node] < from) {
+    return;
+  }
+
+  if (high - low == 1) {
+    if (*count < found_s) {
+      found[*count] = &media->dateranges[low];
+    }
+
+    (*count)++;
+    return;
+  }
+
+  __m3u8_daterange_collect(media, 2 * node, low, (low + high) / 2, limit, from, found, found_s, count);
+  __m3u8_daterange_collect(media, 2 * node + 1, (low + high) / 2, high, limit, from, found, found_s, count);
+}
+
+/**
+ * @brief Index of the first range starting after start.
+ */
+static int __m3u8_daterange_after(const m3u8_media_t* media, double start) {
+  int low = 0;
+  int high = media->dateranges_count;
+
+  while (low < high) {
+    int middle = low + (high - low) / 2;
+
+    if (media->dateranges[middle].start_date <= start) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  return low;
+}
+
+static void __m3u8_daterange_move(char** stored, char** incoming) {
+  if (*stored == NULL) {
+    *stored = *incoming;
+    *incoming = NULL;
+  }
+}
+
+int m3u8_daterange_parse(const char* attributes, ext_x_daterange_t* daterange) {
+  int status = M3U8_DATERANGE_STATUS_NO_ERROR;
+
+  m3u8_attrs_t attrs;
+  bool         has_start = false;
+
+  memset(&attrs, 0, sizeof(m3u8_attrs_t));
+
+  if (attributes == NULL || daterange == NULL) {
+    RAISE(M3U8_DATERANGE_STATUS_INVALID_ARG, "Invalid arg attributes or daterange (null)");
+  }
+
+  memset(daterange, 0, sizeof(ext_x_daterange_t));
+  daterange->duration = -1;
+  daterange->planned_duration = -1;
+
+  if (m3u8_attrs_parse(attributes, &attrs) != M3U8_ATTR_STATUS_NO_ERROR) {
+    RAISE(M3U8_DATERANGE_STATUS_MEM_ALLOC_ERROR, "Unable to parse tag attributes");
+  }
+
+  for (int i = 0; i < attrs.count; i++) {
+    char** string = NULL;
+
+    switch (attrs.entries[i].id) {
+      case M3U8_ATTR_KEY_ID:
+        string = &daterange->id;
+        break;
+      case M3U8_ATTR_KEY_CLASS:
+        string = &daterange->class_name;
+        break;
+      case M3U8_ATTR_KEY_SCTE35_CMD:
+        string = &daterange->scte35_cmd;
+        break;
+      case M3U8_ATTR_KEY_SCTE35_OUT:
+        string = &daterange->scte35_out;
+        break;
+      case M3U8_ATTR_KEY_SCTE35_IN:
+        string = &daterange->scte35_in;
+        break;
+      case M3U8_ATTR_KEY_START_DATE:
+        status = __m3u8_daterange_date(&attrs, i, &daterange->start_date);
+        has_start = true;
+        break;
+      case M3U8_ATTR_KEY_END_DATE:
+        status = __m3u8_daterange_date(&attrs, i, &daterange->end_date);
+        break;
+      case M3U8_ATTR_KEY_DURATION:
+        status = __m3u8_daterange_number(&attrs, i, &daterange->duration);
+        break;
+      case M3U8_ATTR_KEY_PLANNED_DURATION:
+        status = __m3u8_daterange_number(&attrs, i, &daterange->planned_duration);
+        break;
+      case M3U8_ATTR_KEY_END_ON_NEXT:
+        daterange->is_end_on_next =
+            !attrs.entries[i].is_quoted && strcmp(m3u8_attrs_value(&attrs, i), "YES") == 0;
+        break;
+      default:
+        break;
+    }
+
+    if (status != M3U8_DATERANGE_STATUS_NO_ERROR) {
+      RAISE(status, "Invalid EXT-X-DATERANGE attribute %s", m3u8_attrs_key(&attrs, i));
+    }
+
+    if (string != NULL) {
+      free(*string);
+      *string = NULL;
+
+      if (m3u8_attrs_take(&attrs, i, string) != M3U8_ATTR_STATUS_NO_ERROR) {
+        RAISE(M3U8_DATERANGE_STATUS_MEM_ALLOC_ERROR, "Unable to copy attribute %s",
+              m3u8_attrs_key(&attrs, i));
+      }
+    }
+  }
+
+  if (daterange->id == NULL || !has_start) {
+    RAISE(M3U8_DATERANGE_STATUS_FORMAT_ERROR, "EXT-X-DATERANGE without ID or START-DATE");
+  }
+
+  if (daterange->end_date > 0 && daterange->end_date < daterange->start_date) {
+    RAISE(M3U8_DATERANGE_STATUS_FORMAT_ERROR, "EXT-X-DATERANGE %s ends before it starts", daterange->id);
+  }
+
+  if (daterange->is_end_on_next &&
+      (daterange->class_name == NULL || daterange->end_date > 0 || daterange->duration >= 0)) {
+    RAISE(M3U8_DATERANGE_STATUS_FORMAT_ERROR, "END-ON-NEXT needs a CLASS and no end of its own");
+  }
+
+  daterange->end = __m3u8_daterange_end(daterange);
+
+clean_up:
+  if (status != M3U8_DATERANGE_STATUS_NO_ERROR && status != M3U8_DATERANGE_STATUS_INVALID_ARG) {
+    m3u8_daterange_destroy(daterange);
+  }
+
+  m3u8_attrs_destroy(&attrs);
+
+  return status;
+}
+
+int m3u8_daterange_update(m3u8_media_t* media, ext_x_daterange_t* daterange) {
+  int status = M3U8_DATERANGE_STATUS_NO_ERROR;
+
+  int                position = 0;
+  ext_x_daterange_t* stored = NULL;
+
+  if (media == NULL || daterange == NULL || daterange->id == NULL) {
+    RAISE(M3U8_DATERANGE_STATUS_INVALID_ARG, "Invalid arg media or daterange (null)");
+  }
+
+  position = __m3u8_daterange_after(media, daterange->start_date);
+
+  // NOTE: an ID keeps its START-DATE, so a known range sits right before position
+  for (int i = position - 1; i >= 0 && media->dateranges[i].start_date == daterange->start_date; i--) {
+    if (strcmp(media->dateranges[i].id, daterange->id) == 0) {
+      stored = &media->dateranges[i];
+      position = i;
+      break;
+    }
+  }
+
+  if (stored != NULL) {
+    __m3u8_daterange_move(&stored->class_name, &daterange->class_name);
+    __m3u8_daterange_move(&stored->scte35_cmd, &daterange->scte35_cmd);
+    __m3u8_daterange_move(&stored->scte35_out, &daterange->scte35_out);
+    __m3u8_daterange_move(&stored->scte35_in, &daterange->scte35_in);
+    stored->end_date = stored->end_date > 0 ? stored->end_date : daterange->end_date;
+    stored->duration = stored->duration >= 0 ? stored->duration : daterange->duration;
+    stored->planned_duration =
+        stored->planned_duration >= 0 ? stored->planned_duration : daterange->planned_duration;
+
+    // NOTE: an end closed by a later range of the class stays closed
+    if (!__m3u8_daterange_is_open(stored) || stored->end == INFINITY) {
+      stored->end = __m3u8_daterange_end(stored);
+    }
+
+    m3u8_daterange_destroy(daterange);
+    __m3u8_daterange_bubble(media, position);
+    goto clean_up;
+  }
+
+  if (media->dateranges_count == media->dateranges_capacity) {
+    int                capacity = media->dateranges_capacity > 0 ? media->dateranges_capacity * 2
+                                                                 : M3U8_DATERANGE_INITIAL_CAPACITY;
+    ext_x_daterange_t* grown = realloc(media->dateranges, capacity * sizeof(ext_x_daterange_t));
+
+    if (grown == NULL) {
+      RAISE(M3U8_DATERANGE_STATUS_MEM_ALLOC_ERROR, "Unable to grow dateranges to %d", capacity);
+    }
+
+    media->dateranges = grown;
+    media->dateranges_capacity = capacity;
+  }
+
+  memmove(&media->dateranges[position + 1], &media->dateranges[position],
+          (media->dateranges_count - position) * sizeof(ext_x_daterange_t));
+  stored = &media->dateranges[position];
+  *stored = *daterange;
+  stored->end = __m3u8_daterange_end(stored);
+  memset(daterange, 0, sizeof(ext_x_daterange_t));
+  media->dateranges_count++;
+
+  // NOTE: END-ON-NEXT ranges end where the next range of their class starts
+  for (int i = position - 1; i >= 0; i--) {
+    ext_x_daterange_t* previous = &media->dateranges[i];
+
+    if (__m3u8_daterange_same_class(previous, stored)) {
+      if (__m3u8_daterange_is_open(previous) && previous->end > stored->start_date) {
+        previous->end = stored->start_date;
+
+        if (position == media->dateranges_count - 1 && media->daterange_leaves >= media->dateranges_count) {
+          __m3u8_daterange_bubble(media, i);
+        }
+      }
+
+      break;
+    }
+  }
+
+  for (int i = position + 1; i < media->dateranges_count && __m3u8_daterange_is_open(stored); i++) {
+    if (__m3u8_daterange_same_class(&media->dateranges[i], stored)) {
+      stored->end = media->dateranges[i].start_date;
+      break;
+    }
+  }
+
+  if (position == media->dateranges_count - 1 && media->daterange_leaves >= media->dateranges_count) {
+    __m3u8_daterange_bubble(media, position);
+  } else {
+    status = __m3u8_daterange_rebuild(media);
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_daterange_query(const m3u8_media_t*       media,
+                         double                    from,
+                         double                    to,
+                         const ext_x_daterange_t** found,
+                         int                       found_s,
+                         int*                      count) {
+  int status = M3U8_DATERANGE_STATUS_NO_ERROR;
+
+  if (media == NULL || count == NULL || from > to || found_s < 0 || (found == NULL && found_s > 0)) {
+    RAISE(M3U8_DATERANGE_STATUS_INVALID_ARG, "Invalid arg media, count, found or window");
+  }
+
+  *count = 0;
+
+  if (media->dateranges_count > 0) {
+    __m3u8_daterange_collect(media, 1, 0, media->daterange_leaves, __m3u8_daterange_after(media, to),
+                             from, found, found_s, count);
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_daterange_expire(m3u8_media_t* media, double before) {
+  int status = M3U8_DATERANGE_STATUS_NO_ERROR;
+
+  int kept = 0;
+
+  if (media == NULL) {
+    RAISE(M3U8_DATERANGE_STATUS_INVALID_ARG, "Invalid arg media (null)");
+  }
+
+  for (int i = 0; i < media->dateranges_count; i++) {
+    if (media->dateranges[i].end < before) {
+      m3u8_daterange_destroy(&media->dateranges[i]);
+    } else {
+      media->dateranges[kept++] = media->dateranges[i];
+    }
+  }
+
+  if (kept != media->dateranges_count) {
+    media->dateranges_count = kept;
+    status = __m3u8_daterange_rebuild(media);
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_daterange_destroy(ext_x_daterange_t* daterange) {
+  int status = M3U8_DATERANGE_STATUS_NO_ERROR;
+
+  if (daterange == NULL) {
+    RAISE(M3U8_DATERANGE_STATUS_INVALID_ARG, "Invalid arg daterange (null)");
+  }
+
+  free(daterange->id);
+  free(daterange->class_name);
+  free(daterange->scte35_cmd);
+  free(daterange->scte35_out);
+  free(daterange->scte35_in);
+  memset(daterange, 0, sizeof(ext_x_daterange_t));
+
+clean_up:
+  return status;
+}
+
+int m3u8_daterange_clear(m3u8_media_t* media) {
+  int status = M3U8_DATERANGE_STATUS_NO_ERROR;
+
+  if (media == NULL) {
+    RAISE(M3U8_DATERANGE_STATUS_INVALID_ARG, "Invalid arg media (null)");
+  }
+
+  for (int i = 0; i < media->dateranges_count; i++) {
+    m3u8_daterange_destroy(&media->dateranges[i]);
+  }
+
+  free(media->dateranges);
+  free(media->daterange_ends);
+  media->dateranges = NULL;
+  media->dateranges_count = 0;
+  media->dateranges_capacity = 0;
+  media->daterange_ends = NULL;
+  media->daterange_leaves = 0;
+
+clean_up:
+  return status;
+}
@@ -0,0 +1,141 @@
+/**
+ * @file daterange.h
+ * @brief EXT-X-DATERANGE parsing and an interval index for overlap queries.
+ */
+
+#ifndef __H_M3U8_DATERANGE__
+#define __H_M3U8_DATERANGE__
+
+#include "m3u8.h"
+
+/**
+ * @brief Operation completed successfully.
+ *
+ * @details Returned when a function completes without error.
+ */
+#define M3U8_DATERANGE_STATUS_NO_ERROR        0x06000000
+
+/**
+ * @brief Invalid argument received.
+ *
+ * @details Returned when a parameter is NULL or out of range.
+ */
+#define M3U8_DATERANGE_STATUS_INVALID_ARG     (M3U8_DATERANGE_STATUS_NO_ERROR + 0x01)
+
+/**
+ * @brief Memory allocation failure.
+ *
+ * @details Returned when memory allocation or reallocation fails.
+ */
+#define M3U8_DATERANGE_STATUS_MEM_ALLOC_ERROR (M3U8_DATERANGE_STATUS_NO_ERROR + 0x02)
+
+/**
+ * @brief Malformed tag.
+ *
+ * @details Returned when ID or START-DATE is missing or a value is invalid.
+ */
+#define M3U8_DATERANGE_STATUS_FORMAT_ERROR    (M3U8_DATERANGE_STATUS_NO_ERROR + 0x03)
+
+/**
+ * @brief Unknown error occurred.
+ *
+ * @details Returned when an unexpected or undefined error occurs.
+ */
+#define M3U8_DATERANGE_STATUS_UNKNOWN_ERROR   (M3U8_DATERANGE_STATUS_NO_ERROR + 0x99)
+
+/**
+ * @brief Parses the attributes of an EXT-X-DATERANGE tag.
+ *
+ * @details The effective end is END-DATE, else START-DATE plus DURATION,
+ *          else plus PLANNED-DURATION. Without any of them the range is an
+ *          instant, or open until the next range of the same CLASS when
+ *          END-ON-NEXT=YES. X- client attributes are ignored.
+ *
+ * @param[in]  attributes Attribute list following "#EXT-X-DATERANGE:".
+ * @param[out] daterange  Parsed tag; release with m3u8_daterange_destroy.
+ *
+ * @retval M3U8_DATERANGE_STATUS_NO_ERROR        On success.
+ * @retval M3U8_DATERANGE_STATUS_INVALID_ARG     If an argument is NULL.
+ * @retval M3U8_DATERANGE_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ * @retval M3U8_DATERANGE_STATUS_FORMAT_ERROR    If the tag is malformed.
+ */
+int m3u8_daterange_parse(const char* attributes, ext_x_daterange_t* daterange);
+
+/**
+ * @brief Adds a daterange to a media playlist, or completes a known one.
+ *
+ * @details Called by the parser for every EXT-X-DATERANGE, on the first
+ *          load and on every live reload. A tag whose ID is already known
+ *          only fills the attributes the stored range lacks (e.g., the
+ *          END-DATE or SCTE35-IN sent once an ad break is over). The
+ *          strings of daterange are moved, not copied, and daterange is
+ *          left empty. Appending a range that starts last, the usual live
+ *          case, updates the index in O(log n).
+ *
+ * @param[in,out] media     Media playlist.
+ * @param[in]     daterange Parsed tag.
+ *
+ * @retval M3U8_DATERANGE_STATUS_NO_ERROR        On success.
+ * @retval M3U8_DATERANGE_STATUS_INVALID_ARG     If an argument is NULL.
+ * @retval M3U8_DATERANGE_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_daterange_update(m3u8_media_t* media, ext_x_daterange_t* daterange);
+
+/**
+ * @brief Finds the dateranges overlapping [from, to].
+ *
+ * @details Costs O(log n) per range reported, ranges come by start date.
+ *          Pointers stay valid until the next update or expire.
+ *
+ * @param[in]  media   Media playlist.
+ * @param[in]  from    Start of the window, seconds since the epoch.
+ * @param[in]  to      End of the window, inclusive.
+ * @param[out] found   Array receiving the first found_s ranges, may be NULL
+ *                     when found_s is 0.
+ * @param[in]  found_s Capacity of found.
+ * @param[out] count   Number of overlapping ranges, even beyond found_s.
+ *
+ * @retval M3U8_DATERANGE_STATUS_NO_ERROR    On success.
+ * @retval M3U8_DATERANGE_STATUS_INVALID_ARG If an argument is invalid.
+ */
+int m3u8_daterange_query(const m3u8_media_t*       media,
+                         double                    from,
+                         double                    to,
+                         const ext_x_daterange_t** found,
+                         int                       found_s,
+                         int*                      count);
+
+/**
+ * @brief Forgets the dateranges that ended before a time.
+ *
+ * @param[in,out] media  Media playlist.
+ * @param[in]     before Seconds since the epoch, usually the start of the
+ *                       live window.
+ *
+ * @retval M3U8_DATERANGE_STATUS_NO_ERROR        On success.
+ * @retval M3U8_DATERANGE_STATUS_INVALID_ARG     If media is NULL.
+ * @retval M3U8_DATERANGE_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_daterange_expire(m3u8_media_t* media, double before);
+
+/**
+ * @brief Releases the strings of a daterange.
+ *
+ * @param[in,out] daterange Daterange to release.
+ *
+ * @retval M3U8_DATERANGE_STATUS_NO_ERROR    On success.
+ * @retval M3U8_DATERANGE_STATUS_INVALID_ARG If daterange is NULL.
+ */
+int m3u8_daterange_destroy(ext_x_daterange_t* daterange);
+
+/**
+ * @brief Releases every daterange of a media playlist and the index.
+ *
+ * @param[in,out] media Media playlist.
+ *
+ * @retval M3U8_DATERANGE_STATUS_NO_ERROR    On success.
+ * @retval M3U8_DATERANGE_STATUS_INVALID_ARG If media is NULL.
+ */
+int m3u8_daterange_clear(m3u8_media_t* media);
+
+#endif  // __H_M3U8_DATERANGE__
@@ -0,0 +1,334 @@
+/**
+ * @file decode.c
+ * @brief Table driven decoding of tag attributes straight into typed structs.
+ */
+
+#include "decode.h"
+
+#include <limits.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+
+#define M3U8_DECODE_FIELD(type_, struct_, field_) \
+  { .type = (type_), .offset = offsetof(struct_, field_) }
+
+static const char* const __m3u8_decode_media_types[] = {"AUDIO", "VIDEO", "SUBTITLES",
+                                                        "CLOSED-CAPTIONS", NULL};
+
+const m3u8_decode_table_t m3u8_decode_stream_inf = {
+    .tag = "EXT-X-STREAM-INF",
+    .fields = {
+        [M3U8_ATTR_KEY_BANDWIDTH] = M3U8_DECODE_FIELD(M3U8_DECODE_INT, ext_x_stream_inf_t, bandwidth),
+        [M3U8_ATTR_KEY_AVERAGE_BANDWIDTH] =
+            M3U8_DECODE_FIELD(M3U8_DECODE_INT, ext_x_stream_inf_t, average_bandwidth),
+        [M3U8_ATTR_KEY_CODECS] = M3U8_DECODE_FIELD(M3U8_DECODE_STRING, ext_x_stream_inf_t, codecs),
+        [M3U8_ATTR_KEY_RESOLUTION] =
+            M3U8_DECODE_FIELD(M3U8_DECODE_RESOLUTION, ext_x_stream_inf_t, resolution),
+        [M3U8_ATTR_KEY_FRAME_RATE] = M3U8_DECODE_FIELD(M3U8_DECODE_DOUBLE, ext_x_stream_inf_t, frame_rate),
+        [M3U8_ATTR_KEY_HDCP_LEVEL] = M3U8_DECODE_FIELD(M3U8_DECODE_STRING, ext_x_stream_inf_t, hdcp_level),
+        [M3U8_ATTR_KEY_AUDIO] = M3U8_DECODE_FIELD(M3U8_DECODE_STRING, ext_x_stream_inf_t, audio),
+        [M3U8_ATTR_KEY_VIDEO] = M3U8_DECODE_FIELD(M3U8_DECODE_STRING, ext_x_stream_inf_t, video),
+        [M3U8_ATTR_KEY_SUBTITLES] = M3U8_DECODE_FIELD(M3U8_DECODE_STRING, ext_x_stream_inf_t, subtitles),
+        [M3U8_ATTR_KEY_CLOSED_CAPTIONS] =
+            M3U8_DECODE_FIELD(M3U8_DECODE_STRING, ext_x_stream_inf_t, closed_captions),
+        [M3U8_ATTR_KEY_PATHWAY_ID] = M3U8_DECODE_FIELD(M3U8_DECODE_STRING, ext_x_stream_inf_t, pathway_id),
+    },
+};
+
+const m3u8_decode_table_t m3u8_decode_media = {
+    .tag = "EXT-X-MEDIA",
+    .fields = {
+        [M3U8_ATTR_KEY_TYPE] = {.type = M3U8_DECODE_ENUM,
+                                .offset = offsetof(ext_x_media_type_t, type),
+                                .names = __m3u8_decode_media_types},
+        [M3U8_ATTR_KEY_GROUP_ID] = M3U8_DECODE_FIELD(M3U8_DECODE_STRING, ext_x_media_type_t, group_id),
+        [M3U8_ATTR_KEY_LANGUAGE] = M3U8_DECODE_FIELD(M3U8_DECODE_STRING, ext_x_media_type_t, language),
+        [M3U8_ATTR_KEY_NAME] = M3U8_DECODE_FIELD(M3U8_DECODE_STRING, ext_x_media_type_t, name),
+        [M3U8_ATTR_KEY_AUTOSELECT] = M3U8_DECODE_FIELD(M3U8_DECODE_BOOL, ext_x_media_type_t, is_autoselect),
+        [M3U8_ATTR_KEY_DEFAULT] = M3U8_DECODE_FIELD(M3U8_DECODE_BOOL, ext_x_media_type_t, is_default),
+        [M3U8_ATTR_KEY_INSTREAM_ID] = M3U8_DECODE_FIELD(M3U8_DECODE_STRING, ext_x_media_type_t, instream_id),
+        [M3U8_ATTR_KEY_ASSOC_LANGUAGE] =
+            M3U8_DECODE_FIELD(M3U8_DECODE_STRING, ext_x_media_type_t, assoc_language),
+        [M3U8_ATTR_KEY_CHANNELS] = M3U8_DECODE_FIELD(M3U8_DECODE_STRING, ext_x_media_type_t, channels),
+        [M3U8_ATTR_KEY_FORCED] = M3U8_DECODE_FIELD(M3U8_DECODE_BOOL, ext_x_media_type_t, is_forced),
+        [M3U8_ATTR_KEY_URI] = M3U8_DECODE_FIELD(M3U8_DECODE_STRING, ext_x_media_type_t, uri),
+    },
+};
+
+const m3u8_decode_table_t m3u8_decode_key = {
+    .tag = "EXT-X-KEY",
+    .fields = {
+        [M3U8_ATTR_KEY_METHOD] = M3U8_DECODE_FIELD(M3U8_DECODE_STRING, ext_x_key, method),
+        [M3U8_ATTR_KEY_URI] = M3U8_DECODE_FIELD(M3U8_DECODE_STRING, ext_x_key, uri),
+        [M3U8_ATTR_KEY_IV] = {.type = M3U8_DECODE_HEX,
+                              .offset = offsetof(ext_x_key, iv),
+                              .size = sizeof(((ext_x_key*)0)->iv),
+                              .has_flag = true,
+                              .flag = offsetof(ext_x_key, has_iv)},
+        [M3U8_ATTR_KEY_KEYFORMAT] = M3U8_DECODE_FIELD(M3U8_DECODE_STRING, ext_x_key, keyformat),
+        [M3U8_ATTR_KEY_KEYFORMATVERSIONS] =
+            M3U8_DECODE_FIELD(M3U8_DECODE_STRING, ext_x_key, key_format_versions),
+    },
+};
+
+const m3u8_decode_table_t m3u8_decode_start = {
+    .tag = "EXT-X-START",
+    .fields = {
+        [M3U8_ATTR_KEY_TIME_OFFSET] = M3U8_DECODE_FIELD(M3U8_DECODE_DOUBLE, ext_x_start_t, time_offset),
+        [M3U8_ATTR_KEY_PRECISE] = M3U8_DECODE_FIELD(M3U8_DECODE_BOOL, ext_x_start_t, precise),
+    },
+};
+
+static bool __m3u8_decode_equals(const m3u8_attr_token_t* token, const char* text) {
+  return strlen(text) == token->value_s && memcmp(token->value, text, token->value_s) == 0;
+}
+
+static int __m3u8_decode_hex(char c) {
+  if (c >= '0' && c <= '9') {
+    return c - '0';
+  }
+
+  if (c >= 'a' && c <= 'f') {
+    return c - 'a' + 10;
+  }
+
+  if (c >= 'A' && c <= 'F') {
+    return c - 'A' + 10;
+  }
+
+  return -1;
+}
+
+/**
+ * @brief Length of the run of decimal digits at the start of a value.
+ */
+static size_t __m3u8_decode_digits(const char* value, size_t value_s) {
+  size_t digits = 0;
+
+  while (digits < value_s && value[digits] >= '0' && value[digits] <= '9') {
+    digits++;
+  }
+
+  return digits;
+}
+
+static int __m3u8_decode_int(const m3u8_attr_token_t* token, int* field) {
+  long value = 0;
+
+  if (__m3u8_decode_digits(token->value, token->value_s) != token->value_s) {
+    return M3U8_DECODE_STATUS_FORMAT_ERROR;
+  }
+
+  for (size_t i = 0; i < token->value_s; i++) {
+    if ((value = value * 10 + (token->value[i] - '0')) > INT_MAX) {
+      return M3U8_DECODE_STATUS_FORMAT_ERROR;
+    }
+  }
+
+  *field = (int)value;
+
+  return M3U8_DECODE_STATUS_NO_ERROR;
+}
+
+static int __m3u8_decode_double(const m3u8_attr_token_t* token, double* field) {
+  char   number[64];
+  char*  end = NULL;
+  double value = 0;
+
+  if (token->value_s >= sizeof(number)) {
+    return M3U8_DECODE_STATUS_FORMAT_ERROR;
+  }
+
+  // NOTE: the value is not terminated inside the tag, strtod needs a copy
+  memcpy(number, token->value, token->value_s);
+  number[token->value_s] = 0;
+  value = strtod(number, &end);
+
+  if (end == number || *end != 0) {
+    return M3U8_DECODE_STATUS_FORMAT_ERROR;
+  }
+
+  *field = value;
+
+  return M3U8_DECODE_STATUS_NO_ERROR;
+}
+
+static int __m3u8_decode_enum(const m3u8_attr_token_t* token, const char* const* names, int* field) {
+  for (int i = 0; names != NULL && names[i] != NULL; i++) {
+    if (__m3u8_decode_equals(token, names[i])) {
+      *field = i;
+      return M3U8_DECODE_STATUS_NO_ERROR;
+    }
+  }
+
+  return M3U8_DECODE_STATUS_FORMAT_ERROR;
+}
+
+static int __m3u8_decode_resolution(const m3u8_attr_token_t* token) {
+  size_t width = __m3u8_decode_digits(token->value, token->value_s);
+  size_t height = 0;
+
+  if (width == 0 || width + 1 >= token->value_s || token->value[width] != 'x') {
+    return M3U8_DECODE_STATUS_FORMAT_ERROR;
+  }
+
+  height = __m3u8_decode_digits(token->value + width + 1, token->value_s - width - 1);
+
+  return width + 1 + height == token->value_s ? M3U8_DECODE_STATUS_NO_ERROR
+                                              : M3U8_DECODE_STATUS_FORMAT_ERROR;
+}
+
+static int __m3u8_decode_string(const m3u8_attr_token_t* token, char** field) {
+  char* value = strndup(token->value, token->value_s);
+
+  if (value == NULL) {
+    return M3U8_DECODE_STATUS_MEM_ALLOC_ERROR;
+  }
+
+  free(*field);
+  *field = value;
+
+  return M3U8_DECODE_STATUS_NO_ERROR;
+}
+
+static int __m3u8_decode_bytes(const m3u8_attr_token_t* token, size_t size, unsigned char* field) {
+  const char* digits = token->value + 2;
+
+  if (token->value_s != 2 + 2 * size || token->value[0] != '0' ||
+      (token->value[1] != 'x' && token->value[1] != 'X')) {
+    return M3U8_DECODE_STATUS_FORMAT_ERROR;
+  }
+
+  for (size_t i = 0; i < size; i++) {
+    int high = __m3u8_decode_hex(digits[2 * i]);
+    int low = __m3u8_decode_hex(digits[2 * i + 1]);
+
+    if (high < 0 || low < 0) {
+      return M3U8_DECODE_STATUS_FORMAT_ERROR;
+    }
+
+    field[i] = (unsigned char)((high << 4) | low);
+  }
+
+  return M3U8_DECODE_STATUS_NO_ERROR;
+}
+
+/**
+ * @brief Writes one token into the field its descriptor names.
+ */
+static int __m3u8_decode_field(const m3u8_decode_field_t* field, const m3u8_attr_token_t* token,
+                               char* object) {
+  int status = M3U8_DECODE_STATUS_NO_ERROR;
+
+  // NOTE: only strings may be quoted, numbers and enumerated strings may not
+  if (token->is_quoted && field->type != M3U8_DECODE_STRING) {
+    return M3U8_DECODE_STATUS_FORMAT_ERROR;
+  }
+
+  switch (field->type) {
+    case M3U8_DECODE_INT:
+      status = __m3u8_decode_int(token, (int*)(object + field->offset));
+      break;
+    case M3U8_DECODE_DOUBLE:
+      status = __m3u8_decode_double(token, (double*)(object + field->offset));
+      break;
+    case M3U8_DECODE_BOOL:
+      if (__m3u8_decode_equals(token, "YES") || __m3u8_decode_equals(token, "NO")) {
+        *(bool*)(object + field->offset) = __m3u8_decode_equals(token, "YES");
+      } else {
+        status = M3U8_DECODE_STATUS_FORMAT_ERROR;
+      }
+      break;
+    case M3U8_DECODE_ENUM:
+      status = __m3u8_decode_enum(token, field->names, (int*)(object + field->offset));
+      break;
+    case M3U8_DECODE_RESOLUTION:
+      if ((status = __m3u8_decode_resolution(token)) != M3U8_DECODE_STATUS_NO_ERROR) {
+        break;
+      }
+      // fall through
+    case M3U8_DECODE_STRING:
+      status = __m3u8_decode_string(token, (char**)(object + field->offset));
+      break;
+    case M3U8_DECODE_HEX:
+      status = __m3u8_decode_bytes(token, field->size, (unsigned char*)(object + field->offset));
+      break;
+    default:
+      break;
+  }
+
+  if (status == M3U8_DECODE_STATUS_NO_ERROR && field->has_flag) {
+    *(bool*)(object + field->flag) = true;
+  }
+
+  return status;
+}
+
+int m3u8_decode(const m3u8_decode_table_t* table, const char* attributes, void* object,
+                m3u8_attrs_t* unknown) {
+  int status = M3U8_DECODE_STATUS_NO_ERROR;
+
+  const char*       cursor = attributes;
+  m3u8_attr_token_t token;
+
+  if (table == NULL || attributes == NULL || object == NULL) {
+    RAISE(M3U8_DECODE_STATUS_INVALID_ARG, "Invalid arg table, attributes or object (null)");
+  }
+
+  if (unknown != NULL) {
+    m3u8_attrs_init(unknown);
+  }
+
+  while ((cursor = m3u8_attr_next(cursor, &token)) != NULL) {
+    const m3u8_decode_field_t* field = NULL;
+
+    if (token.id != M3U8_ATTR_KEY_UNKNOWN && table->fields[token.id].type != M3U8_DECODE_SKIP) {
+      field = &table->fields[token.id];
+    }
+
+    if (field == NULL) {
+      if (unknown != NULL && m3u8_attrs_append(unknown, &token) != M3U8_ATTR_STATUS_NO_ERROR) {
+        RAISE(M3U8_DECODE_STATUS_MEM_ALLOC_ERROR, "Unable to retain %s attribute %.*s", table->tag,
+              (int)token.key_s, token.key);
+      }
+
+      continue;
+    }
+
+    if ((status = __m3u8_decode_field(field, &token, object)) != M3U8_DECODE_STATUS_NO_ERROR) {
+      RAISE(status, "Invalid %s attribute %.*s=%.*s", table->tag, (int)token.key_s, token.key,
+            (int)token.value_s, token.value);
+    }
+  }
+
+clean_up:
+  if (status != M3U8_DECODE_STATUS_NO_ERROR && status != M3U8_DECODE_STATUS_INVALID_ARG) {
+    m3u8_decode_release(table, object);
+  }
+
+  return status;
+}
+
+int m3u8_decode_release(const m3u8_decode_table_t* table, void* object) {
+  int status = M3U8_DECODE_STATUS_NO_ERROR;
+
+  if (table == NULL || object == NULL) {
+    RAISE(M3U8_DECODE_STATUS_INVALID_ARG, "Invalid arg table or object (null)");
+  }
+
+  for (int i = 0; i < M3U8_ATTR_KEY_UNKNOWN; i++) {
+    const m3u8_decode_field_t* field = &table->fields[i];
+
+    if (field->type == M3U8_DECODE_STRING || field->type == M3U8_DECODE_RESOLUTION) {
+      char** string = (char**)((char*)object + field->offset);
+
+      free(*string);
+      *string = NULL;
+    }
+  }
+
+clean_up:
+  return status;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file decode.h
+ * @brief Table driven decoding of tag attributes straight into typed structs.
+ */
+
+#ifndef __H_M3U8_DECODE__
+#define __H_M3U8_DECODE__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "attr.h"
+#include "m3u8.h"
+
+/**
+ * @brief Operation completed successfully.
+ *
+ * @details Returned when a function completes without error.
+ */
+#define M3U8_DECODE_STATUS_NO_ERROR        0x0A000000
+
+/**
+ * @brief Invalid argument received.
+ *
+ * @details Returned when a parameter is NULL or otherwise invalid.
+ */
+#define M3U8_DECODE_STATUS_INVALID_ARG     (M3U8_DECODE_STATUS_NO_ERROR + 0x01)
+
+/**
+ * @brief Memory allocation error.
+ *
+ * @details Returned when a string field or a retained attribute cannot be
+ *          allocated.
+ */
+#define M3U8_DECODE_STATUS_MEM_ALLOC_ERROR (M3U8_DECODE_STATUS_NO_ERROR + 0x02)
+
+/**
+ * @brief Malformed attribute value.
+ *
+ * @details Returned when a value does not have the type its descriptor
+ *          expects, like a quoted BANDWIDTH or an unknown TYPE.
+ */
+#define M3U8_DECODE_STATUS_FORMAT_ERROR    (M3U8_DECODE_STATUS_NO_ERROR + 0x03)
+
+/**
+ * @brief Unknown error occurred.
+ *
+ * @details Returned when an unexpected or undefined error occurs.
+ */
+#define M3U8_DECODE_STATUS_UNKNOWN_ERROR   (M3U8_DECODE_STATUS_NO_ERROR + 0x99)
+
+/**
+ * @enum m3u8_decode_type_e
+ * @brief How the value of an attribute is written into its field.
+ */
+typedef enum {
+  M3U8_DECODE_SKIP,       /**< no descriptor, the attribute is not decoded */
+  M3U8_DECODE_INT,        /**< decimal-integer into an int */
+  M3U8_DECODE_DOUBLE,     /**< decimal-floating-point into a double */
+  M3U8_DECODE_BOOL,       /**< YES or NO into a bool */
+  M3U8_DECODE_ENUM,       /**< enumerated-string into an int sized enum, see names */
+  M3U8_DECODE_STRING,     /**< quoted or enumerated string into an owned char* */
+  M3U8_DECODE_RESOLUTION, /**< WIDTHxHEIGHT, validated, into an owned char* */
+  M3U8_DECODE_HEX         /**< 0x and 2 * size hex digits into an unsigned char[size] */
+} m3u8_decode_type_e;
+
+/**
+ * @struct m3u8_decode_field_t
+ * @brief Where and how one attribute of a tag is decoded.
+ */
+typedef struct {
+  m3u8_decode_type_e type;     /**< value type, M3U8_DECODE_SKIP for none */
+  size_t             offset;   /**< offsetof the field in the struct */
+  size_t             size;     /**< bytes of a M3U8_DECODE_HEX field */
+  const char* const* names;    /**< values of a M3U8_DECODE_ENUM by enum value, NULL ended */
+  bool               has_flag; /**< a bool is set when the attribute is present */
+  size_t             flag;     /**< offsetof that bool */
+} m3u8_decode_field_t;
+
+/**
+ * @struct m3u8_decode_table_t
+ * @brief Descriptors of the attributes of one tag, indexed by key.
+ *
+ * @details Keys without a descriptor are skipped, or retained when the
+ *          caller asks for them.
+ */
+typedef struct {
+  const char*         tag;                           /**< tag name, for logs */
+  m3u8_decode_field_t fields[M3U8_ATTR_KEY_UNKNOWN]; /**< descriptor per known key */
+} m3u8_decode_table_t;
+
+/** @brief EXT-X-STREAM-INF attributes into ext_x_stream_inf_t. */
+extern const m3u8_decode_table_t m3u8_decode_stream_inf;
+
+/** @brief EXT-X-MEDIA attributes into ext_x_media_type_t. */
+extern const m3u8_decode_table_t m3u8_decode_media;
+
+/** @brief EXT-X-KEY attributes into ext_x_key. */
+extern const m3u8_decode_table_t m3u8_decode_key;
+
+/** @brief EXT-X-START attributes into ext_x_start_t. */
+extern const m3u8_decode_table_t m3u8_decode_start;
+
+/**
+ * @brief Decodes tag attributes into a struct, without an intermediate list.
+ *
+ * @details Attributes are tokenized with m3u8_attr_next and written to the
+ *          fields their descriptors name. Fields of absent attributes are
+ *          left untouched. A repeated attribute overwrites the earlier one.
+ *          On failure the string fields of the table are released.
+ *
+ * @param[in]  table      Descriptors of the tag.
+ * @param[in]  attributes The null-terminated attribute list of the tag.
+ * @param[out] object     Struct described by table.
+ * @param[out] unknown    Receives the attributes without a descriptor, to be
+ *                        released with m3u8_attrs_destroy; NULL to drop them.
+ *
+ * @retval M3U8_DECODE_STATUS_NO_ERROR        On success.
+ * @retval M3U8_DECODE_STATUS_INVALID_ARG     If table, attributes or object is NULL.
+ * @retval M3U8_DECODE_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ * @retval M3U8_DECODE_STATUS_FORMAT_ERROR    If a value does not match its type.
+ */
+int m3u8_decode(const m3u8_decode_table_t* table, const char* attributes, void* object,
+                m3u8_attrs_t* unknown);
+
+/**
+ * @brief Frees the string fields a table describes and sets them to NULL.
+ *
+ * @retval M3U8_DECODE_STATUS_NO_ERROR    On success.
+ * @retval M3U8_DECODE_STATUS_INVALID_ARG If table or object is NULL.
+ */
+int m3u8_decode_release(const m3u8_decode_table_t* table, void* object);
+
+#endif  // __H_M3U8_DECODE__
@@ -0,0 +1,475 @@
+/**
+ * @file fetch.c
+ * @brief Whole-body fetches bounded by a deadline, cancellable and hedged.
+ */
+
+#include "fetch.h"
+
+#include <pthread.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "logger.h"
+
+#define M3U8_FETCH_PRIMARY 0
+#define M3U8_FETCH_HEDGE   1
+
+struct m3u8_cancel {
+  pthread_mutex_t mutex;        /**< guards is_triggered and the fetches using the token */
+  pthread_cond_t  cond;         /**< monotonic, signaled on trigger and completions */
+  bool            is_triggered; /**< token was triggered */
+};
+
+struct m3u8_latency {
+  pthread_mutex_t mutex;                        /**< guards the window */
+  long            samples[M3U8_LATENCY_WINDOW]; /**< response times in ms */
+  int             samples_s;                    /**< valid samples */
+  int             next;                         /**< slot overwritten next */
+};
+
+typedef struct m3u8_fetch_ctx m3u8_fetch_ctx_t;
+
+/** @brief one of the requests racing for the body */
+typedef struct {
+  m3u8_transport_request_t request;      /**< request handed to the transport */
+  m3u8_fetch_ctx_t*        ctx;          /**< owning fetch */
+  char*                    data;         /**< body received so far, NUL terminated */
+  size_t                   size;         /**< bytes in data */
+  size_t                   capacity;     /**< bytes allocated in data */
+  long                     started_ms;   /**< submission time */
+  long                     elapsed_ms;   /**< time from submission to done */
+  bool                     is_submitted; /**< handed to the transport */
+  bool                     is_done;      /**< done was called */
+  int                      status;       /**< transport status passed to done */
+} m3u8_fetch_attempt_t;
+
+struct m3u8_fetch_ctx {
+  m3u8_cancel_t*       cancel;      /**< token whose mutex and cond guard the fetch */
+  m3u8_transport_t*    transport;   /**< transport the attempts run on */
+  m3u8_fetch_attempt_t attempts[2]; /**< primary and hedge */
+  int                  winner;      /**< index of the first successful attempt, -1 */
+  int                  running;     /**< submitted attempts not done yet */
+};
+
+static long __m3u8_fetch_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+static void __m3u8_cancel_init(m3u8_cancel_t* cancel) {
+  pthread_condattr_t attr;
+
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&cancel->cond, &attr);
+  pthread_condattr_destroy(&attr);
+  pthread_mutex_init(&cancel->mutex, NULL);
+  cancel->is_triggered = false;
+}
+
+static void __m3u8_cancel_deinit(m3u8_cancel_t* cancel) {
+  pthread_cond_destroy(&cancel->cond);
+  pthread_mutex_destroy(&cancel->mutex);
+}
+
+/**
+ * @brief Transport sink appending a chunk to the attempt body.
+ *
+ * @return 0 to continue, nonzero once another attempt won or on allocation
+ *         failure.
+ */
+static int __m3u8_fetch_write(const char* data, size_t size, void* userdata) {
+  m3u8_fetch_attempt_t* attempt = (m3u8_fetch_attempt_t*)userdata;
+
+  if (__atomic_load_n(&attempt->ctx->winner, __ATOMIC_RELAXED) >= 0) {
+    return 1;
+  }
+
+  if (attempt->size + size + 1 > attempt->capacity) {
+    size_t capacity = attempt->capacity > 0 ? attempt->capacity : 4096;
+    char*  grown = NULL;
+
+    while (capacity < attempt->size + size + 1) {
+      capacity *= 2;
+    }
+
+    if ((grown = realloc(attempt->data, capacity)) == NULL) {
+      ERROR("Out of memory while growing response body");
+      return 1;
+    }
+
+    attempt->data = grown;
+    attempt->capacity = capacity;
+  }
+
+  memcpy(attempt->data + attempt->size, data, size);
+  attempt->size += size;
+  attempt->data[attempt->size] = 0;
+
+  return 0;
+}
+
+/**
+ * @brief Transport completion, the first successful attempt wins.
+ *
+ * @details Nothing of the fetch is touched after the mutex is released, the
+ *          waiting thread may return and drop the context right away.
+ */
+static void __m3u8_fetch_done(m3u8_transport_request_t* request, int status, void* userdata) {
+  m3u8_fetch_attempt_t* attempt = (m3u8_fetch_attempt_t*)userdata;
+  m3u8_fetch_ctx_t*     ctx = attempt->ctx;
+  m3u8_cancel_t*        cancel = ctx->cancel;
+
+  (void)request;
+
+  pthread_mutex_lock(&cancel->mutex);
+
+  attempt->is_done = true;
+  attempt->status = status;
+  attempt->elapsed_ms = __m3u8_fetch_now_ms() - attempt->started_ms;
+  ctx->running--;
+
+  if (status == M3U8_TRANSPORT_STATUS_NO_ERROR && ctx->winner < 0) {
+    __atomic_store_n(&ctx->winner, (int)(attempt - ctx->attempts), __ATOMIC_RELAXED);
+  }
+
+  pthread_cond_broadcast(&cancel->cond);
+  pthread_mutex_unlock(&cancel->mutex);
+}
+
+/**
+ * @brief Submits an attempt; called and returning with the token mutex held.
+ *
+ * @details The mutex is released around the submission since synchronous
+ *          transports complete the request inside m3u8_transport_submit.
+ */
+static void __m3u8_fetch_launch(m3u8_fetch_ctx_t* ctx, int index, long timeout_ms) {
+  m3u8_fetch_attempt_t* attempt = &ctx->attempts[index];
+  int                   result = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  attempt->is_submitted = true;
+  attempt->started_ms = __m3u8_fetch_now_ms();
+  attempt->request.timeout_ms = timeout_ms;
+  ctx->running++;
+
+  pthread_mutex_unlock(&ctx->cancel->mutex);
+  result = m3u8_transport_submit(ctx->transport, &attempt->request);
+  pthread_mutex_lock(&ctx->cancel->mutex);
+
+  if (result != M3U8_TRANSPORT_STATUS_NO_ERROR) {
+    ERROR("Unable to submit %s (0x%x)", attempt->request.uri, result);
+    attempt->is_done = true;
+    attempt->status = result;
+    ctx->running--;
+  }
+}
+
+/**
+ * @brief Waits on the token until signaled or until the monotonic time at.
+ */
+static void __m3u8_fetch_wait(m3u8_cancel_t* cancel, long at_ms) {
+  struct timespec ts;
+
+  if (at_ms < 0) {
+    pthread_cond_wait(&cancel->cond, &cancel->mutex);
+    return;
+  }
+
+  ts.tv_sec = at_ms / 1000;
+  ts.tv_nsec = (at_ms % 1000) * 1000000L;
+  pthread_cond_timedwait(&cancel->cond, &cancel->mutex, &ts);
+}
+
+int m3u8_cancel_create(m3u8_cancel_t** cancel_ptr) {
+  int status = M3U8_FETCH_STATUS_NO_ERROR;
+
+  if (cancel_ptr == NULL || *cancel_ptr != NULL) {
+    RAISE(M3U8_FETCH_STATUS_INVALID_ARG, "Invalid arg cancel_ptr, must point to NULL");
+  }
+
+  if ((*cancel_ptr = malloc(sizeof(m3u8_cancel_t))) == NULL) {
+    RAISE(M3U8_FETCH_STATUS_MEM_ALLOC_ERROR, "Unable to allocate cancellation token");
+  }
+
+  __m3u8_cancel_init(*cancel_ptr);
+
+clean_up:
+  return status;
+}
+
+int m3u8_cancel_trigger(m3u8_cancel_t* cancel) {
+  int status = M3U8_FETCH_STATUS_NO_ERROR;
+
+  if (cancel == NULL) {
+    RAISE(M3U8_FETCH_STATUS_INVALID_ARG, "Invalid arg cancel (null)");
+  }
+
+  pthread_mutex_lock(&cancel->mutex);
+  cancel->is_triggered = true;
+  pthread_cond_broadcast(&cancel->cond);
+  pthread_mutex_unlock(&cancel->mutex);
+
+clean_up:
+  return status;
+}
+
+bool m3u8_cancel_is_triggered(m3u8_cancel_t* cancel) {
+  bool is_triggered = false;
+
+  if (cancel != NULL) {
+    pthread_mutex_lock(&cancel->mutex);
+    is_triggered = cancel->is_triggered;
+    pthread_mutex_unlock(&cancel->mutex);
+  }
+
+  return is_triggered;
+}
+
+int m3u8_cancel_destroy(m3u8_cancel_t* cancel) {
+  int status = M3U8_FETCH_STATUS_NO_ERROR;
+
+  if (cancel == NULL) {
+    RAISE(M3U8_FETCH_STATUS_INVALID_ARG, "Invalid arg cancel (null)");
+  }
+
+  __m3u8_cancel_deinit(cancel);
+  free(cancel);
+
+clean_up:
+  return status;
+}
+
+int m3u8_latency_create(m3u8_latency_t** latency_ptr) {
+  int status = M3U8_FETCH_STATUS_NO_ERROR;
+
+  if (latency_ptr == NULL || *latency_ptr != NULL) {
+    RAISE(M3U8_FETCH_STATUS_INVALID_ARG, "Invalid arg latency_ptr, must point to NULL");
+  }
+
+  if ((*latency_ptr = calloc(1, sizeof(m3u8_latency_t))) == NULL) {
+    RAISE(M3U8_FETCH_STATUS_MEM_ALLOC_ERROR, "Unable to allocate latency tracker");
+  }
+
+  pthread_mutex_init(&(*latency_ptr)->mutex, NULL);
+
+clean_up:
+  return status;
+}
+
+int m3u8_latency_record(m3u8_latency_t* latency, long elapsed_ms) {
+  int status = M3U8_FETCH_STATUS_NO_ERROR;
+
+  if (latency == NULL || elapsed_ms < 0) {
+    RAISE(M3U8_FETCH_STATUS_INVALID_ARG, "Invalid arg latency or elapsed_ms");
+  }
+
+  pthread_mutex_lock(&latency->mutex);
+
+  latency->samples[latency->next] = elapsed_ms;
+  latency->next = (latency->next + 1) % M3U8_LATENCY_WINDOW;
+
+  if (latency->samples_s < M3U8_LATENCY_WINDOW) {
+    latency->samples_s++;
+  }
+
+  pthread_mutex_unlock(&latency->mutex);
+
+clean_up:
+  return status;
+}
+
+static int __m3u8_latency_compare(const void* a, const void* b) {
+  long left = *(const long*)a;
+  long right = *(const long*)b;
+
+  return (left > right) - (left < right);
+}
+
+long m3u8_latency_percentile(m3u8_latency_t* latency, int percentile) {
+  long samples[M3U8_LATENCY_WINDOW];
+  int  samples_s = 0;
+  int  rank = 0;
+
+  if (latency == NULL || percentile < 1 || percentile > 100) {
+    return -1;
+  }
+
+  pthread_mutex_lock(&latency->mutex);
+  samples_s = latency->samples_s;
+  memcpy(samples, latency->samples, samples_s * sizeof(long));
+  pthread_mutex_unlock(&latency->mutex);
+
+  if (samples_s < M3U8_LATENCY_MIN_SAMPLES) {
+    return -1;
+  }
+
+  // NOTE: nearest rank, the smallest sample with percentile% at or below it
+  qsort(samples, samples_s, sizeof(long), __m3u8_latency_compare);
+  rank = (percentile * samples_s + 99) / 100;
+
+  return samples[rank - 1];
+}
+
+int m3u8_latency_destroy(m3u8_latency_t* latency) {
+  int status = M3U8_FETCH_STATUS_NO_ERROR;
+
+  if (latency == NULL) {
+    RAISE(M3U8_FETCH_STATUS_INVALID_ARG, "Invalid arg latency (null)");
+  }
+
+  pthread_mutex_destroy(&latency->mutex);
+  free(latency);
+
+clean_up:
+  return status;
+}
+
+int m3u8_fetch(m3u8_transport_t*           transport,
+               const char*                 uri,
+               const m3u8_fetch_options_t* options,
+               char**                      body,
+               size_t*                     body_s) {
+  int status = M3U8_FETCH_STATUS_NO_ERROR;
+
+  m3u8_fetch_options_t none = {0};
+  m3u8_cancel_t        local;
+  m3u8_fetch_ctx_t     ctx;
+  long                 started_ms = __m3u8_fetch_now_ms();
+  long                 deadline_ms = -1;
+  long                 hedge_ms = -1;
+
+  if (transport == NULL || uri == NULL || body == NULL || body_s == NULL) {
+    RAISE(M3U8_FETCH_STATUS_INVALID_ARG, "Invalid arg transport, uri, body or body_s (null)");
+  }
+
+  options = options != NULL ? options : &none;
+
+  if (options->deadline_ms < 0 || options->hedge_delay_ms < 0) {
+    RAISE(M3U8_FETCH_STATUS_INVALID_ARG, "Invalid arg options, negative delays");
+  }
+
+  if (options->cancel == NULL) {
+    __m3u8_cancel_init(&local);
+  }
+
+  memset(&ctx, 0, sizeof(m3u8_fetch_ctx_t));
+  ctx.cancel = options->cancel != NULL ? options->cancel : &local;
+  ctx.transport = transport;
+  ctx.winner = -1;
+
+  for (int i = M3U8_FETCH_PRIMARY; i <= M3U8_FETCH_HEDGE; i++) {
+    ctx.attempts[i].ctx = &ctx;
+    ctx.attempts[i].request.uri = i == M3U8_FETCH_HEDGE && options->hedge_uri != NULL
+                                      ? options->hedge_uri
+                                      : uri;
+    ctx.attempts[i].request.write = __m3u8_fetch_write;
+    ctx.attempts[i].request.done = __m3u8_fetch_done;
+    ctx.attempts[i].request.userdata = &ctx.attempts[i];
+  }
+
+  if (options->deadline_ms > 0) {
+    deadline_ms = started_ms + options->deadline_ms;
+  }
+
+  if (options->is_hedged) {
+    long p95 = m3u8_latency_percentile(options->latency, 95);
+    hedge_ms = started_ms + (p95 >= 0 ? p95 : options->hedge_delay_ms);
+  }
+
+  pthread_mutex_lock(&ctx.cancel->mutex);
+
+  if (!ctx.cancel->is_triggered) {
+    __m3u8_fetch_launch(&ctx, M3U8_FETCH_PRIMARY, options->deadline_ms);
+  }
+
+  for (;;) {
+    long now_ms = __m3u8_fetch_now_ms();
+    long wake_ms = deadline_ms;
+
+    if (ctx.winner >= 0) {
+      break;
+    }
+
+    if (ctx.cancel->is_triggered) {
+      status = M3U8_FETCH_STATUS_CANCELLED;
+      break;
+    }
+
+    if (deadline_ms >= 0 && now_ms >= deadline_ms) {
+      status = M3U8_FETCH_STATUS_TIMEOUT;
+      break;
+    }
+
+    // NOTE: a failed primary is hedged right away instead of after the delay
+    if (hedge_ms >= 0 && !ctx.attempts[M3U8_FETCH_HEDGE].is_submitted) {
+      if (now_ms >= hedge_ms || ctx.attempts[M3U8_FETCH_PRIMARY].is_done) {
+        __m3u8_fetch_launch(&ctx, M3U8_FETCH_HEDGE, deadline_ms >= 0 ? deadline_ms - now_ms : 0);
+        continue;
+      }
+
+      wake_ms = wake_ms < 0 || hedge_ms < wake_ms ? hedge_ms : wake_ms;
+    }
+
+    if (ctx.running == 0) {
+      status = ctx.attempts[M3U8_FETCH_PRIMARY].status == M3U8_TRANSPORT_STATUS_TIMEOUT ||
+                       ctx.attempts[M3U8_FETCH_HEDGE].status == M3U8_TRANSPORT_STATUS_TIMEOUT
+                   ? M3U8_FETCH_STATUS_TIMEOUT
+                   : M3U8_FETCH_STATUS_FETCH_ERROR;
+      break;
+    }
+
+    __m3u8_fetch_wait(ctx.cancel, wake_ms);
+  }
+
+  // NOTE: the requests live on this stack frame, no loser may outlive it
+  for (int i = M3U8_FETCH_PRIMARY; i <= M3U8_FETCH_HEDGE; i++) {
+    if (ctx.attempts[i].is_submitted && !ctx.attempts[i].is_done) {
+      pthread_mutex_unlock(&ctx.cancel->mutex);
+      m3u8_transport_cancel(transport, &ctx.attempts[i].request);
+      pthread_mutex_lock(&ctx.cancel->mutex);
+    }
+  }
+
+  while (ctx.running > 0) {
+    pthread_cond_wait(&ctx.cancel->cond, &ctx.cancel->mutex);
+  }
+
+  pthread_mutex_unlock(&ctx.cancel->mutex);
+
+  if (ctx.winner >= 0) {
+    m3u8_fetch_attempt_t* winner = &ctx.attempts[ctx.winner];
+
+    // NOTE: the winner may have been decided while the deadline expired
+    status = M3U8_FETCH_STATUS_NO_ERROR;
+
+    if (options->latency != NULL) {
+      m3u8_latency_record(options->latency, winner->elapsed_ms);
+    }
+
+    if (winner->data == NULL && (winner->data = calloc(1, 1)) == NULL) {
+      status = M3U8_FETCH_STATUS_MEM_ALLOC_ERROR;
+    } else {
+      *body = winner->data;
+      *body_s = winner->size;
+      winner->data = NULL;
+    }
+  }
+
+  free(ctx.attempts[M3U8_FETCH_PRIMARY].data);
+  free(ctx.attempts[M3U8_FETCH_HEDGE].data);
+
+  if (options->cancel == NULL) {
+    __m3u8_cancel_deinit(&local);
+  }
+
+  if (status != M3U8_FETCH_STATUS_NO_ERROR) {
+    ERROR("Unable to fetch %s (0x%x)", uri, status);
+  }
+
+clean_up:
+  return status;
+}
@@ -0,0 +1,224 @@
+/**
+ * @file fetch.h
+ * @brief Whole-body fetches bounded by a deadline, cancellable and hedged.
+ */
+
+#ifndef __H_M3U8_FETCH__
+#define __H_M3U8_FETCH__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "transport.h"
+
+/**
+ * @brief Operation completed successfully.
+ *
+ * @details Returned when a function completes without error.
+ */
+#define M3U8_FETCH_STATUS_NO_ERROR        0x70000000
+
+/**
+ * @brief Invalid argument received.
+ *
+ * @details Returned when a parameter is NULL or otherwise invalid.
+ */
+#define M3U8_FETCH_STATUS_INVALID_ARG     (M3U8_FETCH_STATUS_NO_ERROR + 0x01)
+
+/**
+ * @brief Memory allocation failure.
+ *
+ * @details Returned when memory allocation or reallocation fails.
+ */
+#define M3U8_FETCH_STATUS_MEM_ALLOC_ERROR (M3U8_FETCH_STATUS_NO_ERROR + 0x02)
+
+/**
+ * @brief Every request failed.
+ *
+ * @details Returned when neither the primary nor the hedge request produced
+ *          a response before the deadline.
+ */
+#define M3U8_FETCH_STATUS_FETCH_ERROR     (M3U8_FETCH_STATUS_NO_ERROR + 0x03)
+
+/**
+ * @brief The deadline passed before a response arrived.
+ *
+ * @details Requests still in flight are cancelled before returning.
+ */
+#define M3U8_FETCH_STATUS_TIMEOUT         (M3U8_FETCH_STATUS_NO_ERROR + 0x04)
+
+/**
+ * @brief The cancellation token was triggered.
+ *
+ * @details Requests still in flight are cancelled before returning.
+ */
+#define M3U8_FETCH_STATUS_CANCELLED       (M3U8_FETCH_STATUS_NO_ERROR + 0x05)
+
+/**
+ * @brief Unknown error occurred.
+ *
+ * @details Returned when an unexpected or undefined error occurs.
+ */
+#define M3U8_FETCH_STATUS_UNKNOWN_ERROR   (M3U8_FETCH_STATUS_NO_ERROR + 0x99)
+
+/**
+ * @def M3U8_FETCH_DEFAULT_DEADLINE_MS
+ * @brief Deadline applied by m3u8_open_from_remote.
+ */
+#define M3U8_FETCH_DEFAULT_DEADLINE_MS    10000
+
+/**
+ * @def M3U8_LATENCY_WINDOW
+ * @brief Number of most recent response times a latency tracker keeps.
+ */
+#define M3U8_LATENCY_WINDOW               128
+
+/**
+ * @def M3U8_LATENCY_MIN_SAMPLES
+ * @brief Samples needed before a tracker reports percentiles.
+ */
+#define M3U8_LATENCY_MIN_SAMPLES          16
+
+/**
+ * @struct m3u8_cancel_t
+ * @brief Opaque cancellation token, shareable between threads and fetches.
+ */
+typedef struct m3u8_cancel m3u8_cancel_t;
+
+/**
+ * @struct m3u8_latency_t
+ * @brief Opaque rolling window of response times, thread safe.
+ */
+typedef struct m3u8_latency m3u8_latency_t;
+
+/**
+ * @struct m3u8_fetch_options_t
+ * @brief Per-call limits of m3u8_fetch, zero initialized for none.
+ *
+ * @details With is_hedged set a second request goes out once the first one
+ *          has been running for the hedge delay, or right away when it
+ *          fails; the first successful response wins and the other request
+ *          is cancelled. The hedge delay is the p95 of latency once it has
+ *          enough samples and hedge_delay_ms otherwise.
+ */
+typedef struct {
+  long            deadline_ms;    /**< budget of the whole call, 0 for none */
+  bool            is_hedged;      /**< send a backup request when the first is slow */
+  long            hedge_delay_ms; /**< backup delay while latency has too few samples */
+  const char*     hedge_uri;      /**< backup target (e.g., another host), NULL for uri */
+  m3u8_latency_t* latency;        /**< optional tracker fed with every winning response */
+  m3u8_cancel_t*  cancel;         /**< optional token aborting the call */
+} m3u8_fetch_options_t;
+
+/**
+ * @brief Creates a cancellation token.
+ *
+ * @param[out] cancel_ptr Address where the token will be stored. Must point
+ *                        to NULL.
+ *
+ * @retval M3U8_FETCH_STATUS_NO_ERROR        On success.
+ * @retval M3U8_FETCH_STATUS_INVALID_ARG     If cancel_ptr is invalid.
+ * @retval M3U8_FETCH_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_cancel_create(m3u8_cancel_t** cancel_ptr);
+
+/**
+ * @brief Triggers a token, waking every fetch waiting on it.
+ *
+ * @param[in] cancel Token to trigger; stays triggered for good.
+ *
+ * @retval M3U8_FETCH_STATUS_NO_ERROR    On success.
+ * @retval M3U8_FETCH_STATUS_INVALID_ARG If cancel is NULL.
+ */
+int m3u8_cancel_trigger(m3u8_cancel_t* cancel);
+
+/**
+ * @brief Tells whether a token was triggered.
+ *
+ * @param[in] cancel Token to check.
+ *
+ * @return true once m3u8_cancel_trigger was called.
+ */
+bool m3u8_cancel_is_triggered(m3u8_cancel_t* cancel);
+
+/**
+ * @brief Releases a token no fetch is using anymore.
+ *
+ * @param[in] cancel Token to release.
+ *
+ * @retval M3U8_FETCH_STATUS_NO_ERROR    On success.
+ * @retval M3U8_FETCH_STATUS_INVALID_ARG If cancel is NULL.
+ */
+int m3u8_cancel_destroy(m3u8_cancel_t* cancel);
+
+/**
+ * @brief Creates an empty latency tracker.
+ *
+ * @param[out] latency_ptr Address where the tracker will be stored. Must
+ *                         point to NULL.
+ *
+ * @retval M3U8_FETCH_STATUS_NO_ERROR        On success.
+ * @retval M3U8_FETCH_STATUS_INVALID_ARG     If latency_ptr is invalid.
+ * @retval M3U8_FETCH_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_latency_create(m3u8_latency_t** latency_ptr);
+
+/**
+ * @brief Records a response time, evicting the oldest one when full.
+ *
+ * @param[in] latency    Tracker.
+ * @param[in] elapsed_ms Response time in milliseconds.
+ *
+ * @retval M3U8_FETCH_STATUS_NO_ERROR    On success.
+ * @retval M3U8_FETCH_STATUS_INVALID_ARG If latency is NULL or elapsed_ms < 0.
+ */
+int m3u8_latency_record(m3u8_latency_t* latency, long elapsed_ms);
+
+/**
+ * @brief Computes a percentile of the recorded response times.
+ *
+ * @param[in] latency    Tracker.
+ * @param[in] percentile Percentile between 1 and 100 (e.g., 95).
+ *
+ * @return the response time in milliseconds, or -1 when the tracker holds
+ *         fewer than M3U8_LATENCY_MIN_SAMPLES samples.
+ */
+long m3u8_latency_percentile(m3u8_latency_t* latency, int percentile);
+
+/**
+ * @brief Releases a latency tracker.
+ *
+ * @param[in] latency Tracker to release.
+ *
+ * @retval M3U8_FETCH_STATUS_NO_ERROR    On success.
+ * @retval M3U8_FETCH_STATUS_INVALID_ARG If latency is NULL.
+ */
+int m3u8_latency_destroy(m3u8_latency_t* latency);
+
+/**
+ * @brief Downloads a whole body within the limits given by options.
+ *
+ * @details Never returns while a request it submitted is still running:
+ *          losers, timed out and cancelled requests are aborted through
+ *          m3u8_transport_cancel and awaited first.
+ *
+ * @param[in]  transport Transport to fetch with.
+ * @param[in]  uri       Resource to fetch.
+ * @param[in]  options   Deadline, hedging and cancellation, NULL for none.
+ * @param[out] body      NUL terminated body, to be released with free.
+ * @param[out] body_s    Bytes in body, without the NUL.
+ *
+ * @retval M3U8_FETCH_STATUS_NO_ERROR        On success.
+ * @retval M3U8_FETCH_STATUS_INVALID_ARG     If an argument is NULL.
+ * @retval M3U8_FETCH_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ * @retval M3U8_FETCH_STATUS_FETCH_ERROR     If every request failed.
+ * @retval M3U8_FETCH_STATUS_TIMEOUT         If the deadline passed.
+ * @retval M3U8_FETCH_STATUS_CANCELLED       If the token was triggered.
+ */
+int m3u8_fetch(m3u8_transport_t*           transport,
+               const char*                 uri,
+               const m3u8_fetch_options_t* options,
+               char**                      body,
+               size_t*                     body_s);
+
+#endif  // __H_M3U8_FETCH__
@@ -0,0 +1,409 @@
+/**
+ * @file hash.c
+ * @brief Open addressing hash map from string spans to pointers.
+ */
+
+#include "hash.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+
+#define M3U8_HASH_INITIAL_CAPACITY 8
+
+#define M3U8_HASH_EMPTY            0x80
+#define M3U8_HASH_DELETED          0xFE
+
+#define M3U8_HASH_LSBS             0x0101010101010101ULL
+#define M3U8_HASH_MSBS             0x8080808080808080ULL
+
+struct m3u8_hash {
+  unsigned char*     control;  /**< control byte per slot */
+  m3u8_hash_entry_t* slots;    /**< entries, valid where control is full */
+  size_t             capacity; /**< slots, a power of two and a multiple of a group */
+  size_t             count;    /**< full slots */
+  size_t             deleted;  /**< tombstones, reclaimed by the next rehash */
+  m3u8_hash_config_t config;   /**< allocator and key ownership */
+};
+
+static void* __m3u8_hash_alloc(const m3u8_hash_config_t* config, size_t size) {
+  return config->alloc != NULL ? config->alloc(config->context, size) : malloc(size);
+}
+
+static void __m3u8_hash_free(const m3u8_hash_config_t* config, void* block) {
+  if (config->alloc == NULL) {
+    free(block);
+  } else if (config->free != NULL) {
+    config->free(config->context, block);
+  }
+}
+
+/**
+ * @brief Loads the control bytes of a group, first slot in the low byte.
+ */
+static uint64_t __m3u8_hash_group(const unsigned char* control) {
+  uint64_t group = 0;
+
+  memcpy(&group, control, sizeof(group));
+
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_BIG_ENDIAN__
+  group = __builtin_bswap64(group);
+#endif
+
+  return group;
+}
+
+/**
+ * @brief Slots of a group whose control byte is h2, as high bits of their
+ *        bytes. May report a false positive next to a true match, which the
+ *        key comparison rules out.
+ */
+static uint64_t __m3u8_hash_match(uint64_t group, unsigned char h2) {
+  uint64_t x = group ^ (M3U8_HASH_LSBS * h2);
+
+  return (x - M3U8_HASH_LSBS) & ~x & M3U8_HASH_MSBS;
+}
+
+static uint64_t __m3u8_hash_match_empty(uint64_t group) {
+  return group & ~(group << 6) & M3U8_HASH_MSBS;
+}
+
+static uint64_t __m3u8_hash_match_free(uint64_t group) {
+  return group & M3U8_HASH_MSBS;
+}
+
+static size_t __m3u8_hash_first(uint64_t bits) {
+  return (size_t)__builtin_ctzll(bits) / 8;
+}
+
+static bool __m3u8_hash_is_key(const m3u8_hash_entry_t* entry, const char* key, size_t key_s) {
+  return entry->key_s == key_s && (key_s == 0 || memcmp(entry->key, key, key_s) == 0);
+}
+
+/**
+ * @brief Slot holding key, or -1.
+ */
+static long __m3u8_hash_find(const m3u8_hash_t* hash, const char* key, size_t key_s, uint64_t code) {
+  size_t        mask = hash->capacity - 1;
+  size_t        position = (size_t)(code >> 7) & mask & ~(size_t)(M3U8_HASH_GROUP - 1);
+  unsigned char h2 = (unsigned char)(code & 0x7f);
+
+  // NOTE: triangular steps over aligned groups visit every group once
+  for (size_t step = M3U8_HASH_GROUP; step <= hash->capacity; step += M3U8_HASH_GROUP) {
+    uint64_t group = __m3u8_hash_group(&hash->control[position]);
+
+    for (uint64_t bits = __m3u8_hash_match(group, h2); bits != 0; bits &= bits - 1) {
+      size_t slot = position + __m3u8_hash_first(bits);
+
+      if (__m3u8_hash_is_key(&hash->slots[slot], key, key_s)) {
+        return (long)slot;
+      }
+    }
+
+    if (__m3u8_hash_match_empty(group) != 0) {
+      break;
+    }
+
+    position = (position + step) & mask;
+  }
+
+  return -1;
+}
+
+/**
+ * @brief First empty or deleted slot on the probe sequence of code.
+ */
+static size_t __m3u8_hash_free_slot(const m3u8_hash_t* hash, uint64_t code) {
+  size_t mask = hash->capacity - 1;
+  size_t position = (size_t)(code >> 7) & mask & ~(size_t)(M3U8_HASH_GROUP - 1);
+  size_t step = 0;
+
+  for (;;) {
+    uint64_t bits = __m3u8_hash_match_free(__m3u8_hash_group(&hash->control[position]));
+
+    if (bits != 0) {
+      return position + __m3u8_hash_first(bits);
+    }
+
+    step += M3U8_HASH_GROUP;
+    position = (position + step) & mask;
+  }
+}
+
+/**
+ * @brief Moves every entry into a table of capacity slots, dropping tombstones.
+ */
+static int __m3u8_hash_rehash(m3u8_hash_t* hash, size_t capacity) {
+  unsigned char*     control = NULL;
+  m3u8_hash_entry_t* slots = NULL;
+  unsigned char*     previous_control = hash->control;
+  m3u8_hash_entry_t* previous_slots = hash->slots;
+  size_t             previous_capacity = hash->capacity;
+
+  if ((control = __m3u8_hash_alloc(&hash->config, capacity)) == NULL) {
+    return M3U8_HASH_STATUS_MEM_ALLOC_ERROR;
+  }
+
+  if ((slots = __m3u8_hash_alloc(&hash->config, capacity * sizeof(m3u8_hash_entry_t))) == NULL) {
+    __m3u8_hash_free(&hash->config, control);
+    return M3U8_HASH_STATUS_MEM_ALLOC_ERROR;
+  }
+
+  memset(control, M3U8_HASH_EMPTY, capacity);
+  hash->control = control;
+  hash->slots = slots;
+  hash->capacity = capacity;
+  hash->deleted = 0;
+
+  for (size_t i = 0; i < previous_capacity; i++) {
+    if ((previous_control[i] & 0x80) == 0) {
+      uint64_t code = m3u8_hash_bytes(previous_slots[i].key, previous_slots[i].key_s);
+      size_t   slot = __m3u8_hash_free_slot(hash, code);
+
+      control[slot] = (unsigned char)(code & 0x7f);
+      slots[slot] = previous_slots[i];
+    }
+  }
+
+  if (previous_control != NULL) {
+    __m3u8_hash_free(&hash->config, previous_control);
+    __m3u8_hash_free(&hash->config, previous_slots);
+  }
+
+  return M3U8_HASH_STATUS_NO_ERROR;
+}
+
+uint64_t m3u8_hash_bytes(const void* data, size_t size) {
+  const unsigned char* bytes = data;
+  uint64_t             code = 0x9E3779B97F4A7C15ULL ^ (size * 0xFF51AFD7ED558CCDULL);
+  uint64_t             word = 0;
+
+  for (; size >= 8; bytes += 8, size -= 8) {
+    memcpy(&word, bytes, sizeof(word));
+    code = (code ^ word) * 0x9E3779B97F4A7C15ULL;
+    code ^= code >> 32;
+  }
+
+  if (size > 0) {
+    word = 0;
+
+    // NOTE: byte by byte, a memcpy of a variable size is a library call
+    for (size_t i = 0; i < size; i++) {
+      word |= (uint64_t)bytes[i] << (8 * i);
+    }
+
+    code = (code ^ word) * 0x9E3779B97F4A7C15ULL;
+  }
+
+  // NOTE: murmur3 finalizer, the control byte and the group both need good bits
+  code ^= code >> 33;
+  code *= 0xFF51AFD7ED558CCDULL;
+  code ^= code >> 33;
+  code *= 0xC4CEB9FE1A85EC53ULL;
+  code ^= code >> 33;
+
+  return code;
+}
+
+int m3u8_hash_create(m3u8_hash_t** hash_ptr, const m3u8_hash_config_t* config) {
+  int status = M3U8_HASH_STATUS_NO_ERROR;
+
+  m3u8_hash_config_t defaults = {0};
+  m3u8_hash_t*       hash = NULL;
+  size_t             capacity = M3U8_HASH_INITIAL_CAPACITY;
+
+  if (hash_ptr == NULL || *hash_ptr != NULL) {
+    RAISE(M3U8_HASH_STATUS_INVALID_ARG, "Invalid arg hash_ptr, must point to NULL");
+  }
+
+  if (config == NULL) {
+    config = &defaults;
+  }
+
+  // NOTE: at most 7/8 of the slots are ever in use
+  while (capacity - capacity / 8 < config->capacity) {
+    capacity *= 2;
+  }
+
+  if ((hash = __m3u8_hash_alloc(config, sizeof(m3u8_hash_t))) == NULL) {
+    RAISE(M3U8_HASH_STATUS_MEM_ALLOC_ERROR, "Unable to allocate hash map");
+  }
+
+  memset(hash, 0, sizeof(m3u8_hash_t));
+  hash->config = *config;
+
+  if (__m3u8_hash_rehash(hash, capacity) != M3U8_HASH_STATUS_NO_ERROR) {
+    __m3u8_hash_free(config, hash);
+    RAISE(M3U8_HASH_STATUS_MEM_ALLOC_ERROR, "Unable to allocate %zu hash slots", capacity);
+  }
+
+  *hash_ptr = hash;
+
+clean_up:
+  return status;
+}
+
+int m3u8_hash_put(m3u8_hash_t* hash, const char* key, size_t key_s, void* value) {
+  int status = M3U8_HASH_STATUS_NO_ERROR;
+
+  uint64_t code = 0;
+  long     found = -1;
+  size_t   slot = 0;
+  char*    copy = NULL;
+
+  if (hash == NULL || (key == NULL && key_s > 0)) {
+    RAISE(M3U8_HASH_STATUS_INVALID_ARG, "Invalid arg hash or key (null)");
+  }
+
+  code = m3u8_hash_bytes(key, key_s);
+
+  if ((found = __m3u8_hash_find(hash, key, key_s, code)) >= 0) {
+    hash->slots[found].value = value;
+    goto clean_up;
+  }
+
+  if (hash->count + hash->deleted + 1 > hash->capacity - hash->capacity / 8) {
+    // NOTE: mostly tombstones are cleared in place, else the table doubles
+    size_t capacity = hash->count + 1 > hash->capacity / 2 ? 2 * hash->capacity : hash->capacity;
+
+    if (__m3u8_hash_rehash(hash, capacity) != M3U8_HASH_STATUS_NO_ERROR) {
+      RAISE(M3U8_HASH_STATUS_MEM_ALLOC_ERROR, "Unable to grow hash map to %zu slots", capacity);
+    }
+  }
+
+  if (hash->config.copy_keys) {
+    if ((copy = __m3u8_hash_alloc(&hash->config, key_s + 1)) == NULL) {
+      RAISE(M3U8_HASH_STATUS_MEM_ALLOC_ERROR, "Unable to copy hash key");
+    }
+
+    memcpy(copy, key, key_s);
+    copy[key_s] = 0;
+    key = copy;
+  }
+
+  slot = __m3u8_hash_free_slot(hash, code);
+  hash->deleted -= hash->control[slot] == M3U8_HASH_DELETED;
+  hash->control[slot] = (unsigned char)(code & 0x7f);
+  hash->slots[slot].key = key;
+  hash->slots[slot].key_s = key_s;
+  hash->slots[slot].value = value;
+  hash->count++;
+
+clean_up:
+  return status;
+}
+
+int m3u8_hash_get(const m3u8_hash_t* hash, const char* key, size_t key_s, void** value) {
+  int status = M3U8_HASH_STATUS_NO_ERROR;
+
+  long found = -1;
+
+  if (hash == NULL || value == NULL || (key == NULL && key_s > 0)) {
+    RAISE(M3U8_HASH_STATUS_INVALID_ARG, "Invalid arg hash, value or key (null)");
+  }
+
+  if ((found = __m3u8_hash_find(hash, key, key_s, m3u8_hash_bytes(key, key_s))) < 0) {
+    status = M3U8_HASH_STATUS_NOT_FOUND;
+    goto clean_up;
+  }
+
+  *value = hash->slots[found].value;
+
+clean_up:
+  return status;
+}
+
+int m3u8_hash_remove(m3u8_hash_t* hash, const char* key, size_t key_s, void** value) {
+  int status = M3U8_HASH_STATUS_NO_ERROR;
+
+  long   found = -1;
+  size_t group = 0;
+
+  if (hash == NULL || (key == NULL && key_s > 0)) {
+    RAISE(M3U8_HASH_STATUS_INVALID_ARG, "Invalid arg hash or key (null)");
+  }
+
+  if ((found = __m3u8_hash_find(hash, key, key_s, m3u8_hash_bytes(key, key_s))) < 0) {
+    status = M3U8_HASH_STATUS_NOT_FOUND;
+    goto clean_up;
+  }
+
+  if (value != NULL) {
+    *value = hash->slots[found].value;
+  }
+
+  if (hash->config.copy_keys) {
+    __m3u8_hash_free(&hash->config, (void*)hash->slots[found].key);
+  }
+
+  // NOTE: a group that still has an empty slot never sent a probe further
+  group = (size_t)found & ~(size_t)(M3U8_HASH_GROUP - 1);
+
+  if (__m3u8_hash_match_empty(__m3u8_hash_group(&hash->control[group])) != 0) {
+    hash->control[found] = M3U8_HASH_EMPTY;
+  } else {
+    hash->control[found] = M3U8_HASH_DELETED;
+    hash->deleted++;
+  }
+
+  hash->count--;
+
+clean_up:
+  return status;
+}
+
+int m3u8_hash_count(const m3u8_hash_t* hash, size_t* count) {
+  int status = M3U8_HASH_STATUS_NO_ERROR;
+
+  if (hash == NULL || count == NULL) {
+    RAISE(M3U8_HASH_STATUS_INVALID_ARG, "Invalid arg hash or count (null)");
+  }
+
+  *count = hash->count;
+
+clean_up:
+  return status;
+}
+
+int m3u8_hash_next(const m3u8_hash_t* hash, size_t* cursor, const m3u8_hash_entry_t** entry) {
+  int status = M3U8_HASH_STATUS_NOT_FOUND;
+
+  if (hash == NULL || cursor == NULL || entry == NULL) {
+    RAISE(M3U8_HASH_STATUS_INVALID_ARG, "Invalid arg hash, cursor or entry (null)");
+  }
+
+  while (*cursor < hash->capacity) {
+    size_t slot = (*cursor)++;
+
+    if ((hash->control[slot] & 0x80) == 0) {
+      *entry = &hash->slots[slot];
+      status = M3U8_HASH_STATUS_NO_ERROR;
+      break;
+    }
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_hash_destroy(m3u8_hash_t* hash) {
+  int status = M3U8_HASH_STATUS_NO_ERROR;
+
+  if (hash == NULL) {
+    RAISE(M3U8_HASH_STATUS_INVALID_ARG, "Invalid arg hash (null)");
+  }
+
+  for (size_t i = 0; hash->config.copy_keys && i < hash->capacity; i++) {
+    if ((hash->control[i] & 0x80) == 0) {
+      __m3u8_hash_free(&hash->config, (void*)hash->slots[i].key);
+    }
+  }
+
+  __m3u8_hash_free(&hash->config, hash->control);
+  __m3u8_hash_free(&hash->config, hash->slots);
+  __m3u8_hash_free(&hash->config, hash);
+
+clean_up:
+  return status;
+}
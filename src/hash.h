@@ -0,0 +1,173 @@
+/**
+ * @file hash.h
+ * @brief Open addressing hash map from string spans to pointers.
+ */
+
+#ifndef __H_M3U8_HASH__
+#define __H_M3U8_HASH__
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+/**
+ * @brief Operation completed successfully.
+ *
+ * @details Returned when a function completes without error.
+ */
+#define M3U8_HASH_STATUS_NO_ERROR        0x0B000000
+
+/**
+ * @brief Invalid argument received.
+ *
+ * @details Returned when a parameter is NULL or otherwise invalid.
+ */
+#define M3U8_HASH_STATUS_INVALID_ARG     (M3U8_HASH_STATUS_NO_ERROR + 0x01)
+
+/**
+ * @brief Memory allocation error.
+ *
+ * @details Returned when the table or a key copy cannot be allocated.
+ */
+#define M3U8_HASH_STATUS_MEM_ALLOC_ERROR (M3U8_HASH_STATUS_NO_ERROR + 0x02)
+
+/**
+ * @brief Key not found.
+ *
+ * @details Returned when a lookup misses, or when iteration is over.
+ */
+#define M3U8_HASH_STATUS_NOT_FOUND       (M3U8_HASH_STATUS_NO_ERROR + 0x03)
+
+/**
+ * @brief Unknown error occurred.
+ *
+ * @details Returned when an unexpected or undefined error occurs.
+ */
+#define M3U8_HASH_STATUS_UNKNOWN_ERROR   (M3U8_HASH_STATUS_NO_ERROR + 0x99)
+
+/**
+ * @brief Slots probed together through their control bytes.
+ */
+#define M3U8_HASH_GROUP                  8
+
+/**
+ * @brief Allocates size bytes for the map, NULL on failure.
+ */
+typedef void* (*m3u8_hash_alloc_fn)(void* context, size_t size);
+
+/**
+ * @brief Releases a block of the map, may be NULL when blocks live in an
+ *        arena released as a whole.
+ */
+typedef void (*m3u8_hash_free_fn)(void* context, void* block);
+
+/**
+ * @struct m3u8_hash_config_t
+ * @brief Creation options, all zero for defaults.
+ */
+typedef struct {
+  size_t             capacity;  /**< entries expected, to size the table up front */
+  bool               copy_keys; /**< keep a copy of each key, else keys are borrowed
+                                     and must outlive their entry */
+  m3u8_hash_alloc_fn alloc;     /**< allocator, NULL for malloc */
+  m3u8_hash_free_fn  free;      /**< release of alloc blocks, ignored without alloc */
+  void*              context;   /**< passed to alloc and free */
+} m3u8_hash_config_t;
+
+/**
+ * @struct m3u8_hash_entry_t
+ * @brief Slot of the map.
+ *
+ * @details Borrowed keys let the map index objects that carry their own
+ *          key, with value pointing back at the object, without copies.
+ */
+typedef struct {
+  const char* key;   /**< key bytes, not necessarily terminated */
+  size_t      key_s; /**< bytes in the key */
+  void*       value; /**< value stored with the key */
+} m3u8_hash_entry_t;
+
+/**
+ * @brief Opaque hash map.
+ *
+ * @details SwissTable layout: one control byte per slot holds 7 bits of the
+ *          hash of a full slot, or marks it empty or deleted. A lookup tests
+ *          M3U8_HASH_GROUP control bytes at once and only compares the keys
+ *          of slots whose byte matches. Not thread safe.
+ */
+typedef struct m3u8_hash m3u8_hash_t;
+
+/**
+ * @brief Creates an empty map.
+ *
+ * @param[out] hash_ptr Receives the map, must point to NULL.
+ * @param[in]  config   Options, NULL for defaults.
+ *
+ * @retval M3U8_HASH_STATUS_NO_ERROR        On success.
+ * @retval M3U8_HASH_STATUS_INVALID_ARG     If hash_ptr is NULL or points to a map.
+ * @retval M3U8_HASH_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_hash_create(m3u8_hash_t** hash_ptr, const m3u8_hash_config_t* config);
+
+/**
+ * @brief Inserts a key, or replaces the value of an existing one.
+ *
+ * @retval M3U8_HASH_STATUS_NO_ERROR        On success.
+ * @retval M3U8_HASH_STATUS_INVALID_ARG     If hash is NULL, or key is NULL with key_s > 0.
+ * @retval M3U8_HASH_STATUS_MEM_ALLOC_ERROR If the table cannot grow or the key be copied.
+ */
+int m3u8_hash_put(m3u8_hash_t* hash, const char* key, size_t key_s, void* value);
+
+/**
+ * @brief Looks up the value of a key.
+ *
+ * @retval M3U8_HASH_STATUS_NO_ERROR    On success.
+ * @retval M3U8_HASH_STATUS_INVALID_ARG If hash or value is NULL, or key is NULL with key_s > 0.
+ * @retval M3U8_HASH_STATUS_NOT_FOUND   If the key is not in the map.
+ */
+int m3u8_hash_get(const m3u8_hash_t* hash, const char* key, size_t key_s, void** value);
+
+/**
+ * @brief Removes a key.
+ *
+ * @param[out] value Receives the value it had, may be NULL.
+ *
+ * @retval M3U8_HASH_STATUS_NO_ERROR    On success.
+ * @retval M3U8_HASH_STATUS_INVALID_ARG If hash is NULL, or key is NULL with key_s > 0.
+ * @retval M3U8_HASH_STATUS_NOT_FOUND   If the key is not in the map.
+ */
+int m3u8_hash_remove(m3u8_hash_t* hash, const char* key, size_t key_s, void** value);
+
+/**
+ * @brief Number of keys in the map.
+ *
+ * @retval M3U8_HASH_STATUS_NO_ERROR    On success.
+ * @retval M3U8_HASH_STATUS_INVALID_ARG If hash or count is NULL.
+ */
+int m3u8_hash_count(const m3u8_hash_t* hash, size_t* count);
+
+/**
+ * @brief Iterates over the entries, in no particular order.
+ *
+ * @details Start with *cursor 0. The map must not change meanwhile.
+ *
+ * @retval M3U8_HASH_STATUS_NO_ERROR    With the next entry.
+ * @retval M3U8_HASH_STATUS_INVALID_ARG If an argument is NULL.
+ * @retval M3U8_HASH_STATUS_NOT_FOUND   When every entry was visited.
+ */
+int m3u8_hash_next(const m3u8_hash_t* hash, size_t* cursor, const m3u8_hash_entry_t** entry);
+
+/**
+ * @brief Frees the map and its key copies, not the values.
+ *
+ * @retval M3U8_HASH_STATUS_NO_ERROR    On success.
+ * @retval M3U8_HASH_STATUS_INVALID_ARG If hash is NULL.
+ */
+int m3u8_hash_destroy(m3u8_hash_t* hash);
+
+/**
+ * @brief Hash of size bytes, the function the map uses.
+ */
+uint64_t m3u8_hash_bytes(const void* data, size_t size);
+
+#endif  // __H_M3U8_HASH__
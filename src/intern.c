@@ -0,0 +1,379 @@
+/**
+ * @file intern.c
+ * @brief Process-wide, reference counted string interning.
+ */
+
+#include "intern.h"
+
+#include <pthread.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+
+#define M3U8_INTERN_INITIAL_CAPACITY 64
+
+/** @brief interned string, followed by its characters */
+typedef struct {
+  uint32_t hash;     /**< hash of the characters */
+  int      refs;     /**< references handed out */
+  size_t   length;   /**< characters, terminator excluded */
+  char     string[]; /**< terminated characters */
+} m3u8_intern_entry_t;
+
+/** @brief slot of an open addressing shard, the hash avoids touching entries */
+typedef struct {
+  uint32_t             hash;  /**< hash of entry */
+  m3u8_intern_entry_t* entry; /**< entry, NULL when free */
+} m3u8_intern_slot_t;
+
+typedef struct {
+  pthread_mutex_t     mutex;      /**< guards slots and capacity, serializes updates */
+  m3u8_intern_slot_t* slots;      /**< linear probing table */
+  size_t              capacity;   /**< slots, a power of two */
+  size_t              count;      /**< occupied slots, atomic */
+  size_t              references; /**< references handed out, atomic */
+  size_t              bytes;      /**< bytes of the strings, atomic */
+} m3u8_intern_shard_t;
+
+static pthread_once_t      __m3u8_intern_once = PTHREAD_ONCE_INIT;
+static m3u8_intern_shard_t __m3u8_intern_shards[M3U8_INTERN_SHARDS];
+
+static void __m3u8_intern_init(void) {
+  for (int i = 0; i < M3U8_INTERN_SHARDS; i++) {
+    pthread_mutex_init(&__m3u8_intern_shards[i].mutex, NULL);
+  }
+}
+
+/**
+ * @brief FNV-1a with a final avalanche, the top bits pick the shard.
+ */
+static uint32_t __m3u8_intern_hash(const char* string, size_t length) {
+  uint32_t hash = 2166136261u;
+
+  for (size_t i = 0; i < length; i++) {
+    hash = (hash ^ (unsigned char)string[i]) * 16777619u;
+  }
+
+  hash ^= hash >> 16;
+  hash *= 0x85ebca6bu;
+  hash ^= hash >> 13;
+  hash *= 0xc2b2ae35u;
+  hash ^= hash >> 16;
+
+  return hash;
+}
+
+static m3u8_intern_shard_t* __m3u8_intern_shard(uint32_t hash) {
+  return &__m3u8_intern_shards[hash >> 28 & (M3U8_INTERN_SHARDS - 1)];
+}
+
+static m3u8_intern_entry_t* __m3u8_intern_entry(const char* interned) {
+  return (m3u8_intern_entry_t*)(interned - offsetof(m3u8_intern_entry_t, string));
+}
+
+static int __m3u8_intern_grow(m3u8_intern_shard_t* shard) {
+  int status = M3U8_INTERN_STATUS_NO_ERROR;
+
+  size_t              capacity = shard->capacity > 0 ? shard->capacity * 2 : M3U8_INTERN_INITIAL_CAPACITY;
+  m3u8_intern_slot_t* slots = calloc(capacity, sizeof(m3u8_intern_slot_t));
+
+  if (slots == NULL) {
+    RAISE(M3U8_INTERN_STATUS_MEM_ALLOC_ERROR, "Unable to grow an intern shard to %zu slots", capacity);
+  }
+
+  for (size_t i = 0; i < shard->capacity; i++) {
+    if (shard->slots[i].entry != NULL) {
+      size_t slot = shard->slots[i].hash & (capacity - 1);
+
+      while (slots[slot].entry != NULL) {
+        slot = (slot + 1) & (capacity - 1);
+      }
+
+      slots[slot] = shard->slots[i];
+    }
+  }
+
+  free(shard->slots);
+  shard->slots = slots;
+  shard->capacity = capacity;
+
+clean_up:
+  return status;
+}
+
+/**
+ * @brief Empties a slot, shifting back the entries probed past it.
+ */
+static void __m3u8_intern_remove(m3u8_intern_shard_t* shard, size_t hole) {
+  size_t mask = shard->capacity - 1;
+
+  for (size_t next = (hole + 1) & mask; shard->slots[next].entry != NULL; next = (next + 1) & mask) {
+    size_t home = shard->slots[next].hash & mask;
+
+    // NOTE: move next into the hole unless its home lies cyclically in (hole, next]
+    if ((next > hole && (home <= hole || home > next)) || (next < hole && home <= hole && home > next)) {
+      shard->slots[hole] = shard->slots[next];
+      hole = next;
+    }
+  }
+
+  shard->slots[hole].entry = NULL;
+  shard->slots[hole].hash = 0;
+}
+
+int m3u8_intern_n(const char* string, size_t length, const char** interned) {
+  int status = M3U8_INTERN_STATUS_NO_ERROR;
+
+  uint32_t             hash = 0;
+  m3u8_intern_shard_t* shard = NULL;
+  m3u8_intern_entry_t* entry = NULL;
+  size_t               slot = 0;
+
+  if (string == NULL || interned == NULL) {
+    RAISE(M3U8_INTERN_STATUS_INVALID_ARG, "Invalid arg string or interned (null)");
+  }
+
+  pthread_once(&__m3u8_intern_once, __m3u8_intern_init);
+  hash = __m3u8_intern_hash(string, length);
+  shard = __m3u8_intern_shard(hash);
+  pthread_mutex_lock(&shard->mutex);
+
+  if ((shard->count + 1) * 4 > shard->capacity * 3 &&
+      (status = __m3u8_intern_grow(shard)) != M3U8_INTERN_STATUS_NO_ERROR) {
+    pthread_mutex_unlock(&shard->mutex);
+    goto clean_up;
+  }
+
+  for (slot = hash & (shard->capacity - 1); shard->slots[slot].entry != NULL;
+       slot = (slot + 1) & (shard->capacity - 1)) {
+    m3u8_intern_entry_t* candidate = shard->slots[slot].entry;
+
+    if (shard->slots[slot].hash == hash && candidate->length == length &&
+        memcmp(candidate->string, string, length) == 0) {
+      entry = candidate;
+      break;
+    }
+  }
+
+  if (entry == NULL) {
+    if ((entry = malloc(sizeof(m3u8_intern_entry_t) + length + 1)) == NULL) {
+      pthread_mutex_unlock(&shard->mutex);
+      RAISE(M3U8_INTERN_STATUS_MEM_ALLOC_ERROR, "Unable to intern %zu bytes", length);
+    }
+
+    entry->hash = hash;
+    entry->refs = 0;
+    entry->length = length;
+    memcpy(entry->string, string, length);
+    entry->string[length] = 0;
+    shard->slots[slot].hash = hash;
+    shard->slots[slot].entry = entry;
+    __atomic_add_fetch(&shard->count, 1, __ATOMIC_RELAXED);
+    __atomic_add_fetch(&shard->bytes, length + 1, __ATOMIC_RELAXED);
+  }
+
+  __atomic_add_fetch(&entry->refs, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&shard->references, 1, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&shard->mutex);
+  *interned = entry->string;
+
+clean_up:
+  return status;
+}
+
+int m3u8_intern(const char* string, const char** interned) {
+  int status = M3U8_INTERN_STATUS_NO_ERROR;
+
+  if (string == NULL || interned == NULL) {
+    RAISE(M3U8_INTERN_STATUS_INVALID_ARG, "Invalid arg string or interned (null)");
+  }
+
+  status = m3u8_intern_n(string, strlen(string), interned);
+
+clean_up:
+  return status;
+}
+
+int m3u8_intern_retain(const char* interned) {
+  int status = M3U8_INTERN_STATUS_NO_ERROR;
+
+  m3u8_intern_entry_t* entry = NULL;
+
+  if (interned == NULL) {
+    RAISE(M3U8_INTERN_STATUS_INVALID_ARG, "Invalid arg interned (null)");
+  }
+
+  // NOTE: the caller holds a reference, so the entry cannot go away meanwhile
+  entry = __m3u8_intern_entry(interned);
+  __atomic_add_fetch(&entry->refs, 1, __ATOMIC_RELAXED);
+  __atomic_add_fetch(&__m3u8_intern_shard(entry->hash)->references, 1, __ATOMIC_RELAXED);
+
+clean_up:
+  return status;
+}
+
+int m3u8_intern_release(const char* interned) {
+  int status = M3U8_INTERN_STATUS_NO_ERROR;
+
+  m3u8_intern_entry_t* entry = NULL;
+  m3u8_intern_shard_t* shard = NULL;
+  size_t               slot = 0;
+
+  if (interned == NULL) {
+    RAISE(M3U8_INTERN_STATUS_INVALID_ARG, "Invalid arg interned (null)");
+  }
+
+  pthread_once(&__m3u8_intern_once, __m3u8_intern_init);
+  entry = __m3u8_intern_entry(interned);
+  shard = __m3u8_intern_shard(entry->hash);
+  pthread_mutex_lock(&shard->mutex);
+
+  for (slot = entry->hash & (shard->capacity - 1); shard->capacity > 0 && shard->slots[slot].entry != NULL;
+       slot = (slot + 1) & (shard->capacity - 1)) {
+    if (shard->slots[slot].entry == entry) {
+      break;
+    }
+  }
+
+  if (shard->capacity == 0 || shard->slots[slot].entry != entry) {
+    pthread_mutex_unlock(&shard->mutex);
+    RAISE(M3U8_INTERN_STATUS_NOT_FOUND, "String %p is not interned", (const void*)interned);
+  }
+
+  __atomic_sub_fetch(&shard->references, 1, __ATOMIC_RELAXED);
+
+  if (__atomic_sub_fetch(&entry->refs, 1, __ATOMIC_RELAXED) == 0) {
+    __m3u8_intern_remove(shard, slot);
+    __atomic_sub_fetch(&shard->count, 1, __ATOMIC_RELAXED);
+    __atomic_sub_fetch(&shard->bytes, entry->length + 1, __ATOMIC_RELAXED);
+    free(entry);
+  }
+
+  pthread_mutex_unlock(&shard->mutex);
+
+clean_up:
+  return status;
+}
+
+int m3u8_intern_adopt(char** const* strings, int count) {
+  int status = M3U8_INTERN_STATUS_NO_ERROR;
+
+  const char** interned = NULL;
+  int          acquired = 0;
+
+  if (strings == NULL || count < 0) {
+    RAISE(M3U8_INTERN_STATUS_INVALID_ARG, "Invalid arg strings (null) or count %d", count);
+  }
+
+  if ((interned = calloc(count + 1, sizeof(char*))) == NULL) {
+    RAISE(M3U8_INTERN_STATUS_MEM_ALLOC_ERROR, "Unable to allocate %d strings", count);
+  }
+
+  for (; acquired < count; acquired++) {
+    if (*strings[acquired] != NULL &&
+        (status = m3u8_intern(*strings[acquired], &interned[acquired])) != M3U8_INTERN_STATUS_NO_ERROR) {
+      goto clean_up;
+    }
+  }
+
+  for (int i = 0; i < count; i++) {
+    free(*strings[i]);
+    *strings[i] = (char*)interned[i];
+  }
+
+clean_up:
+  if (status != M3U8_INTERN_STATUS_NO_ERROR && interned != NULL) {
+    for (int i = 0; i < acquired; i++) {
+      if (interned[i] != NULL) {
+        m3u8_intern_release(interned[i]);
+      }
+    }
+  }
+
+  free(interned);
+
+  return status;
+}
+
+int m3u8_intern_playlist(m3u8_t* m3u8_ptr) {
+  int status = M3U8_INTERN_STATUS_NO_ERROR;
+
+  char*** strings = NULL;
+  int     count = 0;
+
+  if (m3u8_ptr == NULL) {
+    RAISE(M3U8_INTERN_STATUS_INVALID_ARG, "Invalid arg m3u8_ptr (null)");
+  }
+
+  if (m3u8_ptr->is_interned) {
+    goto clean_up;
+  }
+
+  if ((strings = malloc((9 * m3u8_ptr->variants_count + 7 * m3u8_ptr->renditions_count + 1) *
+                        sizeof(char**))) == NULL) {
+    RAISE(M3U8_INTERN_STATUS_MEM_ALLOC_ERROR, "Unable to allocate the playlist strings");
+  }
+
+  for (int i = 0; i < m3u8_ptr->variants_count; i++) {
+    ext_x_stream_inf_t* variant = &m3u8_ptr->variants[i];
+
+    strings[count++] = &variant->audio;
+    strings[count++] = &variant->subtitles;
+    strings[count++] = &variant->closed_captions;
+    strings[count++] = &variant->resolution;
+    strings[count++] = &variant->codecs;
+    strings[count++] = &variant->video;
+    strings[count++] = &variant->hdcp_level;
+    strings[count++] = &variant->pathway_id;
+    strings[count++] = &variant->uri;
+  }
+
+  for (int i = 0; i < m3u8_ptr->renditions_count; i++) {
+    ext_x_media_type_t* rendition = &m3u8_ptr->renditions[i];
+
+    strings[count++] = &rendition->group_id;
+    strings[count++] = &rendition->language;
+    strings[count++] = &rendition->name;
+    strings[count++] = &rendition->instream_id;
+    strings[count++] = &rendition->assoc_language;
+    strings[count++] = &rendition->channels;
+    strings[count++] = &rendition->uri;
+  }
+
+  if ((status = m3u8_intern_adopt(strings, count)) != M3U8_INTERN_STATUS_NO_ERROR) {
+    goto clean_up;
+  }
+
+  m3u8_ptr->is_interned = true;
+
+clean_up:
+  free(strings);
+
+  return status;
+}
+
+int m3u8_intern_stats(m3u8_intern_stats_t* stats) {
+  int status = M3U8_INTERN_STATUS_NO_ERROR;
+
+  if (stats == NULL) {
+    RAISE(M3U8_INTERN_STATUS_INVALID_ARG, "Invalid arg stats (null)");
+  }
+
+  pthread_once(&__m3u8_intern_once, __m3u8_intern_init);
+  memset(stats, 0, sizeof(m3u8_intern_stats_t));
+
+  // NOTE: the totals are read without the shard locks, so a concurrent
+  // intern may be counted in one of them and not yet in the others
+  for (int i = 0; i < M3U8_INTERN_SHARDS; i++) {
+    m3u8_intern_shard_t* shard = &__m3u8_intern_shards[i];
+
+    stats->strings += __atomic_load_n(&shard->count, __ATOMIC_RELAXED);
+    stats->references += __atomic_load_n(&shard->references, __ATOMIC_RELAXED);
+    stats->bytes += __atomic_load_n(&shard->bytes, __ATOMIC_RELAXED);
+  }
+
+clean_up:
+  return status;
+}
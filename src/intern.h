@@ -0,0 +1,158 @@
+/**
+ * @file intern.h
+ * @brief Process-wide, reference counted string interning.
+ */
+
+#ifndef __H_M3U8_INTERN__
+#define __H_M3U8_INTERN__
+
+#include <stddef.h>
+
+#include "m3u8.h"
+
+/**
+ * @brief Operation completed successfully.
+ *
+ * @details Returned when a function completes without error.
+ */
+#define M3U8_INTERN_STATUS_NO_ERROR        0x07000000
+
+/**
+ * @brief Invalid argument received.
+ *
+ * @details Returned when a parameter is NULL.
+ */
+#define M3U8_INTERN_STATUS_INVALID_ARG     (M3U8_INTERN_STATUS_NO_ERROR + 0x01)
+
+/**
+ * @brief Memory allocation failure.
+ *
+ * @details Returned when memory allocation or reallocation fails.
+ */
+#define M3U8_INTERN_STATUS_MEM_ALLOC_ERROR (M3U8_INTERN_STATUS_NO_ERROR + 0x02)
+
+/**
+ * @brief String not interned.
+ *
+ * @details Returned when releasing a pointer the table did not hand out.
+ */
+#define M3U8_INTERN_STATUS_NOT_FOUND       (M3U8_INTERN_STATUS_NO_ERROR + 0x03)
+
+/**
+ * @brief Unknown error occurred.
+ *
+ * @details Returned when an unexpected or undefined error occurs.
+ */
+#define M3U8_INTERN_STATUS_UNKNOWN_ERROR   (M3U8_INTERN_STATUS_NO_ERROR + 0x99)
+
+/**
+ * @def M3U8_INTERN_SHARDS
+ * @brief Independently locked parts of the table, a power of two.
+ */
+#define M3U8_INTERN_SHARDS                 16
+
+/**
+ * @struct m3u8_intern_stats_t
+ * @brief Occupancy of the intern table.
+ */
+typedef struct {
+  size_t strings;    /**< distinct strings held */
+  size_t references; /**< references handed out */
+  size_t bytes;      /**< bytes of the strings, terminators included */
+} m3u8_intern_stats_t;
+
+/**
+ * @brief Returns the interned copy of a string, adding it when new.
+ *
+ * @details Thread safe. Equal strings get the same pointer, so interned
+ *          strings compare with ==. Each call takes a reference the caller
+ *          gives back with m3u8_intern_release.
+ *
+ * @param[in]  string   String to intern.
+ * @param[out] interned Shared, read-only copy.
+ *
+ * @retval M3U8_INTERN_STATUS_NO_ERROR        On success.
+ * @retval M3U8_INTERN_STATUS_INVALID_ARG     If an argument is NULL.
+ * @retval M3U8_INTERN_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_intern(const char* string, const char** interned);
+
+/**
+ * @brief Same as m3u8_intern for the first length bytes of string.
+ *
+ * @param[in]  string   Characters to intern, need not be terminated.
+ * @param[in]  length   Number of characters.
+ * @param[out] interned Shared, read-only and terminated copy.
+ *
+ * @retval M3U8_INTERN_STATUS_NO_ERROR        On success.
+ * @retval M3U8_INTERN_STATUS_INVALID_ARG     If an argument is NULL.
+ * @retval M3U8_INTERN_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_intern_n(const char* string, size_t length, const char** interned);
+
+/**
+ * @brief Takes one more reference on an interned string.
+ *
+ * @param[in] interned String returned by m3u8_intern.
+ *
+ * @retval M3U8_INTERN_STATUS_NO_ERROR    On success.
+ * @retval M3U8_INTERN_STATUS_INVALID_ARG If interned is NULL.
+ */
+int m3u8_intern_retain(const char* interned);
+
+/**
+ * @brief Gives back a reference; the last one frees the string.
+ *
+ * @param[in] interned String returned by m3u8_intern.
+ *
+ * @retval M3U8_INTERN_STATUS_NO_ERROR    On success.
+ * @retval M3U8_INTERN_STATUS_INVALID_ARG If interned is NULL.
+ * @retval M3U8_INTERN_STATUS_NOT_FOUND   If interned is not in the table.
+ */
+int m3u8_intern_release(const char* interned);
+
+/**
+ * @brief Replaces heap strings by their interned copies, all or none.
+ *
+ * @details Each non NULL *strings[i] is interned then freed. On failure
+ *          nothing changes.
+ *
+ * @param[in,out] strings Addresses of the strings to replace.
+ * @param[in]     count   Number of addresses.
+ *
+ * @retval M3U8_INTERN_STATUS_NO_ERROR        On success.
+ * @retval M3U8_INTERN_STATUS_INVALID_ARG     If strings is NULL.
+ * @retval M3U8_INTERN_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_intern_adopt(char** const* strings, int count);
+
+/**
+ * @brief Moves the variant and rendition strings of a playlist into the table.
+ *
+ * @details Sets m3u8_t.is_interned: variants and renditions appended later
+ *          are interned as well and m3u8_destroy releases instead of
+ *          freeing. Codecs, group ids and uri prefixes repeated across many
+ *          playlists are then stored once.
+ *
+ * @param[in,out] m3u8_ptr Playlist.
+ *
+ * @retval M3U8_INTERN_STATUS_NO_ERROR        On success, or if already interned.
+ * @retval M3U8_INTERN_STATUS_INVALID_ARG     If m3u8_ptr is NULL.
+ * @retval M3U8_INTERN_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_intern_playlist(m3u8_t* m3u8_ptr);
+
+/**
+ * @brief Reports the occupancy of the table.
+ *
+ * @details Takes no lock: each shard keeps atomic totals, so the sums may
+ *          mix the states before and after a concurrent intern or release.
+ *
+ * @param[out] stats Occupancy, summed over the shards.
+ *
+ * @retval M3U8_INTERN_STATUS_NO_ERROR    On success.
+ * @retval M3U8_INTERN_STATUS_INVALID_ARG If stats is NULL.
+ */
+int m3u8_intern_stats(m3u8_intern_stats_t* stats);
+
+#endif  // __H_M3U8_INTERN__
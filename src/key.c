@@ -0,0 +1,441 @@
+/**
+ * @file key.c
+ * @brief EXT-X-KEY helpers and the process-wide AES-128 key cache.
+ */
+
+#include "key.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "hash.h"
+#include "list.h"
+#include "logger.h"
+
+#define M3U8_KEY_ENTRY_LOADING 0
+#define M3U8_KEY_ENTRY_READY   1
+#define M3U8_KEY_ENTRY_FAILED  2
+
+/** @brief how often a waiter holding a cancellation token looks at it */
+#define M3U8_KEY_CANCEL_POLL_MS 50
+
+/** @brief cached key, also the request downloading it */
+typedef struct {
+  char*                    uri;                      /**< key uri */
+  unsigned char            key[M3U8_AES_BLOCK_SIZE]; /**< key bytes once ready */
+  size_t                   size;                     /**< bytes received so far */
+  int                      state;                    /**< loading, ready or failed */
+  int                      waiters;                  /**< threads blocked on the entry */
+  long                     loaded_ms;                /**< monotonic time key became ready */
+  m3u8_transport_request_t request;                  /**< request filling key */
+  m3u8_list_node_t         list;                     /**< node in the cache */
+} m3u8_key_entry_t;
+
+static pthread_once_t   __m3u8_key_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t  __m3u8_key_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t   __m3u8_key_ready;
+static m3u8_list_node_t __m3u8_key_entries = {&__m3u8_key_entries, &__m3u8_key_entries};
+static m3u8_hash_t*     __m3u8_key_index = NULL;
+static size_t           __m3u8_key_count = 0;
+static size_t           __m3u8_key_capacity = M3U8_KEY_CACHE_CAPACITY;
+static long             __m3u8_key_ttl_ms = M3U8_KEY_CACHE_TTL_MS;
+
+static void __m3u8_key_init(void) {
+  pthread_condattr_t attr;
+
+  pthread_condattr_init(&attr);
+  pthread_condattr_setclock(&attr, CLOCK_MONOTONIC);
+  pthread_cond_init(&__m3u8_key_ready, &attr);
+  pthread_condattr_destroy(&attr);
+}
+
+static long __m3u8_key_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+/**
+ * @brief Waits on the cache until signaled or until the monotonic time at.
+ */
+static void __m3u8_key_wait(long at_ms) {
+  struct timespec ts;
+
+  if (at_ms < 0) {
+    pthread_cond_wait(&__m3u8_key_ready, &__m3u8_key_mutex);
+    return;
+  }
+
+  ts.tv_sec = at_ms / 1000;
+  ts.tv_nsec = (at_ms % 1000) * 1000000L;
+  pthread_cond_timedwait(&__m3u8_key_ready, &__m3u8_key_mutex, &ts);
+}
+
+static int __m3u8_key_hex(char digit) {
+  if (digit >= '0' && digit <= '9') {
+    return digit - '0';
+  }
+
+  if (digit >= 'a' && digit <= 'f') {
+    return digit - 'a' + 10;
+  }
+
+  if (digit >= 'A' && digit <= 'F') {
+    return digit - 'A' + 10;
+  }
+
+  return -1;
+}
+
+static int __m3u8_key_write(const char* data, size_t size, void* userdata) {
+  m3u8_key_entry_t* entry = (m3u8_key_entry_t*)userdata;
+
+  if (entry->size + size > M3U8_AES_BLOCK_SIZE) {
+    return 1;
+  }
+
+  memcpy(entry->key + entry->size, data, size);
+  entry->size += size;
+
+  return 0;
+}
+
+static void __m3u8_key_done(m3u8_transport_request_t* request, int status, void* userdata) {
+  m3u8_key_entry_t* entry = (m3u8_key_entry_t*)userdata;
+
+  (void)request;
+
+  pthread_mutex_lock(&__m3u8_key_mutex);
+
+  if (status == M3U8_TRANSPORT_STATUS_NO_ERROR && entry->size == M3U8_AES_BLOCK_SIZE) {
+    entry->state = M3U8_KEY_ENTRY_READY;
+    entry->loaded_ms = __m3u8_key_now_ms();
+  } else {
+    ERROR("Unable to fetch key %s (0x%x, %zu bytes)", entry->uri, status, entry->size);
+    entry->state = M3U8_KEY_ENTRY_FAILED;
+  }
+
+  pthread_cond_broadcast(&__m3u8_key_ready);
+  pthread_mutex_unlock(&__m3u8_key_mutex);
+}
+
+/**
+ * @brief Unlinks and frees an idle entry.
+ *
+ * @details Must be called with the cache mutex held.
+ */
+static void __m3u8_key_release(m3u8_key_entry_t* entry) {
+  m3u8_hash_remove(__m3u8_key_index, entry->uri, strlen(entry->uri), NULL);
+  m3u8_list_remove(&entry->list);
+  __m3u8_key_count--;
+
+  free(entry->uri);
+  free(entry);
+}
+
+/**
+ * @brief Evicts idle entries, least recently used first, down to capacity.
+ *
+ * @details Must be called with the cache mutex held. Entries being
+ *          downloaded or waited on are skipped, so the cache may stay over
+ *          capacity until they settle, and so is keep, the entry a lookup is
+ *          about to hand out (NULL for none).
+ */
+static void __m3u8_key_evict(const m3u8_key_entry_t* keep) {
+  m3u8_list_node_t* pivot = __m3u8_key_entries.next;
+
+  while (__m3u8_key_count > __m3u8_key_capacity && pivot != &__m3u8_key_entries) {
+    m3u8_list_node_t* next = pivot->next;
+    m3u8_key_entry_t* entry = m3u8_list_container_of(pivot, m3u8_key_entry_t, list);
+
+    if (entry != keep && entry->state != M3U8_KEY_ENTRY_LOADING && entry->waiters == 0) {
+      __m3u8_key_release(entry);
+    }
+
+    pivot = next;
+  }
+}
+
+/**
+ * @brief Finds the entry of uri, creating or restarting it when needed.
+ *
+ * @details Must be called with the cache mutex held. Sets *is_submit when
+ *          the caller has to submit the entry request after unlocking. The
+ *          entry found moves to the most recently used end of the list.
+ */
+static m3u8_key_entry_t* __m3u8_key_lookup(const char* uri, bool* is_submit) {
+  m3u8_hash_config_t config = {.capacity = M3U8_KEY_CACHE_CAPACITY};
+  m3u8_key_entry_t*  entry = NULL;
+  size_t             uri_s = strlen(uri);
+
+  *is_submit = false;
+
+  pthread_once(&__m3u8_key_once, __m3u8_key_init);
+
+  if (__m3u8_key_index == NULL &&
+      m3u8_hash_create(&__m3u8_key_index, &config) != M3U8_HASH_STATUS_NO_ERROR) {
+    return NULL;
+  }
+
+  if (m3u8_hash_get(__m3u8_key_index, uri, uri_s, (void**)&entry) == M3U8_HASH_STATUS_NO_ERROR) {
+    m3u8_list_remove(&entry->list);
+    m3u8_list_inb(&__m3u8_key_entries, &entry->list);
+  } else {
+    if ((entry = calloc(1, sizeof(m3u8_key_entry_t))) == NULL) {
+      return NULL;
+    }
+
+    // NOTE: the index borrows entry->uri as its key
+    if ((entry->uri = strdup(uri)) == NULL ||
+        m3u8_hash_put(__m3u8_key_index, entry->uri, uri_s, entry) != M3U8_HASH_STATUS_NO_ERROR) {
+      free(entry->uri);
+      free(entry);
+      return NULL;
+    }
+
+    entry->request.uri = entry->uri;
+    entry->request.write = __m3u8_key_write;
+    entry->request.done = __m3u8_key_done;
+    entry->request.userdata = entry;
+    entry->state = M3U8_KEY_ENTRY_FAILED;
+
+    m3u8_list_inb(&__m3u8_key_entries, &entry->list);
+    __m3u8_key_count++;
+  }
+
+  if (entry->state == M3U8_KEY_ENTRY_READY && __m3u8_key_ttl_ms > 0 &&
+      __m3u8_key_now_ms() - entry->loaded_ms >= __m3u8_key_ttl_ms) {
+    entry->state = M3U8_KEY_ENTRY_FAILED;
+  }
+
+  if (entry->state == M3U8_KEY_ENTRY_FAILED) {
+    entry->state = M3U8_KEY_ENTRY_LOADING;
+    entry->size = 0;
+    *is_submit = true;
+  }
+
+  __m3u8_key_evict(entry);
+
+  return entry;
+}
+
+static void __m3u8_key_submit(m3u8_transport_t* transport, m3u8_key_entry_t* entry,
+                              long timeout_ms) {
+  entry->request.timeout_ms = timeout_ms;
+
+  if (transport == NULL && m3u8_transport_default(&transport) != M3U8_TRANSPORT_STATUS_NO_ERROR) {
+    __m3u8_key_done(&entry->request, M3U8_TRANSPORT_STATUS_INIT_ERROR, entry);
+    return;
+  }
+
+  if (m3u8_transport_submit(transport, &entry->request) != M3U8_TRANSPORT_STATUS_NO_ERROR) {
+    __m3u8_key_done(&entry->request, M3U8_TRANSPORT_STATUS_IO_ERROR, entry);
+  }
+}
+
+int m3u8_key_parse_iv(const char* value, unsigned char* iv) {
+  int status = M3U8_KEY_STATUS_NO_ERROR;
+
+  if (value == NULL || iv == NULL) {
+    RAISE(M3U8_KEY_STATUS_INVALID_ARG, "Invalid arg value or iv (null)");
+  }
+
+  if (value[0] != '0' || (value[1] != 'x' && value[1] != 'X') ||
+      strlen(value + 2) != 2 * M3U8_AES_BLOCK_SIZE) {
+    RAISE(M3U8_KEY_STATUS_FORMAT_ERROR, "Invalid IV %s, expected 0x and 32 hex digits", value);
+  }
+
+  for (int i = 0; i < M3U8_AES_BLOCK_SIZE; i++) {
+    int high = __m3u8_key_hex(value[2 + 2 * i]);
+    int low = __m3u8_key_hex(value[3 + 2 * i]);
+
+    if (high < 0 || low < 0) {
+      RAISE(M3U8_KEY_STATUS_FORMAT_ERROR, "Invalid hex digit in IV %s", value);
+    }
+
+    iv[i] = (unsigned char)((high << 4) | low);
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_key_sequence_iv(uint64_t sequence, unsigned char* iv) {
+  int status = M3U8_KEY_STATUS_NO_ERROR;
+
+  if (iv == NULL) {
+    RAISE(M3U8_KEY_STATUS_INVALID_ARG, "Invalid arg iv (null)");
+  }
+
+  memset(iv, 0, M3U8_AES_BLOCK_SIZE);
+
+  for (int i = M3U8_AES_BLOCK_SIZE - 1; i >= M3U8_AES_BLOCK_SIZE - 8; i--) {
+    iv[i] = (unsigned char)(sequence & 0xff);
+    sequence >>= 8;
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_key_segment_iv(const ext_x_key* key, uint64_t sequence, unsigned char* iv) {
+  int status = M3U8_KEY_STATUS_NO_ERROR;
+
+  if (key == NULL || iv == NULL) {
+    RAISE(M3U8_KEY_STATUS_INVALID_ARG, "Invalid arg key or iv (null)");
+  }
+
+  if (key->has_iv) {
+    memcpy(iv, key->iv, M3U8_AES_BLOCK_SIZE);
+  } else {
+    status = m3u8_key_sequence_iv(sequence, iv);
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_key_fetch(m3u8_transport_t* transport, const char* uri, long deadline_ms,
+                   m3u8_cancel_t* cancel, unsigned char* key) {
+  int status = M3U8_KEY_STATUS_NO_ERROR;
+
+  m3u8_key_entry_t* entry = NULL;
+  bool              is_submit = false;
+  long              at_ms = -1;
+
+  if (uri == NULL || key == NULL || deadline_ms < 0) {
+    RAISE(M3U8_KEY_STATUS_INVALID_ARG, "Invalid arg uri, key (null) or deadline_ms (negative)");
+  }
+
+  if (deadline_ms > 0) {
+    at_ms = __m3u8_key_now_ms() + deadline_ms;
+  }
+
+  pthread_mutex_lock(&__m3u8_key_mutex);
+
+  if ((entry = __m3u8_key_lookup(uri, &is_submit)) == NULL) {
+    pthread_mutex_unlock(&__m3u8_key_mutex);
+    RAISE(M3U8_KEY_STATUS_MEM_ALLOC_ERROR, "Unable to allocate key entry");
+  }
+
+  entry->waiters++;
+
+  if (is_submit) {
+    pthread_mutex_unlock(&__m3u8_key_mutex);
+    __m3u8_key_submit(transport, entry, deadline_ms);
+    pthread_mutex_lock(&__m3u8_key_mutex);
+  }
+
+  // NOTE: the download owner may be stuck, every waiter keeps its own clock
+  while (entry->state == M3U8_KEY_ENTRY_LOADING) {
+    long now_ms = __m3u8_key_now_ms();
+    long wake_ms = at_ms;
+
+    if (m3u8_cancel_is_triggered(cancel)) {
+      status = M3U8_KEY_STATUS_CANCELLED;
+      break;
+    }
+
+    if (at_ms >= 0 && now_ms >= at_ms) {
+      status = M3U8_KEY_STATUS_TIMEOUT;
+      break;
+    }
+
+    if (cancel != NULL && (wake_ms < 0 || now_ms + M3U8_KEY_CANCEL_POLL_MS < wake_ms)) {
+      wake_ms = now_ms + M3U8_KEY_CANCEL_POLL_MS;
+    }
+
+    __m3u8_key_wait(wake_ms);
+  }
+
+  if (status != M3U8_KEY_STATUS_NO_ERROR) {
+    WARN("Gave up waiting for key %s (0x%x)", uri, status);
+  } else if (entry->state == M3U8_KEY_ENTRY_READY) {
+    memcpy(key, entry->key, M3U8_AES_BLOCK_SIZE);
+  } else {
+    status = M3U8_KEY_STATUS_FETCH_ERROR;
+  }
+
+  entry->waiters--;
+
+  pthread_mutex_unlock(&__m3u8_key_mutex);
+
+clean_up:
+  return status;
+}
+
+int m3u8_key_prefetch(m3u8_transport_t* transport, const char* uri) {
+  int status = M3U8_KEY_STATUS_NO_ERROR;
+
+  m3u8_key_entry_t* entry = NULL;
+  bool              is_submit = false;
+
+  if (uri == NULL) {
+    RAISE(M3U8_KEY_STATUS_INVALID_ARG, "Invalid arg uri (null)");
+  }
+
+  pthread_mutex_lock(&__m3u8_key_mutex);
+  entry = __m3u8_key_lookup(uri, &is_submit);
+  pthread_mutex_unlock(&__m3u8_key_mutex);
+
+  if (entry == NULL) {
+    RAISE(M3U8_KEY_STATUS_MEM_ALLOC_ERROR, "Unable to allocate key entry");
+  }
+
+  if (is_submit) {
+    __m3u8_key_submit(transport, entry, M3U8_FETCH_DEFAULT_DEADLINE_MS);
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_key_cache_configure(size_t capacity, long ttl_ms) {
+  int status = M3U8_KEY_STATUS_NO_ERROR;
+
+  if (capacity == 0 || ttl_ms < 0) {
+    RAISE(M3U8_KEY_STATUS_INVALID_ARG, "Invalid arg capacity (0) or ttl_ms (negative)");
+  }
+
+  pthread_mutex_lock(&__m3u8_key_mutex);
+  __m3u8_key_capacity = capacity;
+  __m3u8_key_ttl_ms = ttl_ms;
+  __m3u8_key_evict(NULL);
+  pthread_mutex_unlock(&__m3u8_key_mutex);
+
+clean_up:
+  return status;
+}
+
+int m3u8_key_cache_clear(void) {
+  m3u8_list_node_t* pivot = NULL;
+
+  pthread_mutex_lock(&__m3u8_key_mutex);
+
+  pivot = __m3u8_key_entries.next;
+
+  while (pivot != &__m3u8_key_entries) {
+    m3u8_list_node_t* next = pivot->next;
+    m3u8_key_entry_t* entry = m3u8_list_container_of(pivot, m3u8_key_entry_t, list);
+
+    if (entry->state != M3U8_KEY_ENTRY_LOADING && entry->waiters == 0) {
+      __m3u8_key_release(entry);
+    }
+
+    pivot = next;
+  }
+
+  if (__m3u8_key_count == 0 && __m3u8_key_index != NULL) {
+    m3u8_hash_destroy(__m3u8_key_index);
+    __m3u8_key_index = NULL;
+  }
+
+  pthread_mutex_unlock(&__m3u8_key_mutex);
+
+  return M3U8_KEY_STATUS_NO_ERROR;
+}
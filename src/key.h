@@ -0,0 +1,179 @@
+/**
+ * @file key.h
+ * @brief EXT-X-KEY helpers and the process-wide AES-128 key cache.
+ */
+
+#ifndef __H_M3U8_KEY__
+#define __H_M3U8_KEY__
+
+#include <stdint.h>
+
+#include "aes.h"
+#include "fetch.h"
+#include "m3u8.h"
+#include "transport.h"
+
+/**
+ * @brief Keys the cache holds before evicting the least recently used.
+ */
+#define M3U8_KEY_CACHE_CAPACITY 64
+
+/**
+ * @brief Lifetime of a cached key in milliseconds, 0 keeps keys until evicted.
+ */
+#define M3U8_KEY_CACHE_TTL_MS   0
+
+/**
+ * @brief Operation completed successfully.
+ *
+ * @details Returned when a function completes without error.
+ */
+#define M3U8_KEY_STATUS_NO_ERROR        0x50000000
+
+/**
+ * @brief Invalid argument received.
+ *
+ * @details Returned when a parameter is NULL or otherwise invalid.
+ */
+#define M3U8_KEY_STATUS_INVALID_ARG     (M3U8_KEY_STATUS_NO_ERROR + 0x01)
+
+/**
+ * @brief Memory allocation failure.
+ *
+ * @details Returned when memory allocation or reallocation fails.
+ */
+#define M3U8_KEY_STATUS_MEM_ALLOC_ERROR (M3U8_KEY_STATUS_NO_ERROR + 0x02)
+
+/**
+ * @brief The key could not be downloaded.
+ *
+ * @details Returned when the transport fails or the key is not 16 bytes.
+ */
+#define M3U8_KEY_STATUS_FETCH_ERROR     (M3U8_KEY_STATUS_NO_ERROR + 0x03)
+
+/**
+ * @brief Malformed attribute value.
+ *
+ * @details Returned when an IV is not a 0x prefixed 128-bit hex string.
+ */
+#define M3U8_KEY_STATUS_FORMAT_ERROR    (M3U8_KEY_STATUS_NO_ERROR + 0x04)
+
+/**
+ * @brief The key did not arrive in time.
+ *
+ * @details Returned when the deadline passed before the download finished.
+ */
+#define M3U8_KEY_STATUS_TIMEOUT         (M3U8_KEY_STATUS_NO_ERROR + 0x05)
+
+/**
+ * @brief The wait was aborted.
+ *
+ * @details Returned when the cancellation token was triggered.
+ */
+#define M3U8_KEY_STATUS_CANCELLED       (M3U8_KEY_STATUS_NO_ERROR + 0x06)
+
+/**
+ * @brief Unknown error occurred.
+ *
+ * @details Returned when an unexpected or undefined error occurs.
+ */
+#define M3U8_KEY_STATUS_UNKNOWN_ERROR   (M3U8_KEY_STATUS_NO_ERROR + 0x99)
+
+/**
+ * @brief Parses the IV attribute of an EXT-X-KEY tag.
+ *
+ * @param[in]  value Attribute value (e.g., 0x9c7db8778570d05c3177c349fd9236aa).
+ * @param[out] iv    16 byte initialization vector.
+ *
+ * @retval M3U8_KEY_STATUS_NO_ERROR     On success.
+ * @retval M3U8_KEY_STATUS_INVALID_ARG  If an argument is NULL.
+ * @retval M3U8_KEY_STATUS_FORMAT_ERROR If value is not 0x followed by 32
+ *                                      hex digits.
+ */
+int m3u8_key_parse_iv(const char* value, unsigned char* iv);
+
+/**
+ * @brief Builds the implicit IV of a segment from its media sequence number.
+ *
+ * @param[in]  sequence Media sequence number of the segment.
+ * @param[out] iv       16 byte initialization vector (big-endian sequence).
+ *
+ * @retval M3U8_KEY_STATUS_NO_ERROR    On success.
+ * @retval M3U8_KEY_STATUS_INVALID_ARG If iv is NULL.
+ */
+int m3u8_key_sequence_iv(uint64_t sequence, unsigned char* iv);
+
+/**
+ * @brief Returns the IV a segment must be decrypted with.
+ *
+ * @param[in]  key      EXT-X-KEY in effect for the segment.
+ * @param[in]  sequence Media sequence number of the segment.
+ * @param[out] iv       16 byte initialization vector.
+ *
+ * @retval M3U8_KEY_STATUS_NO_ERROR    On success.
+ * @retval M3U8_KEY_STATUS_INVALID_ARG If an argument is NULL.
+ */
+int m3u8_key_segment_iv(const ext_x_key* key, uint64_t sequence, unsigned char* iv);
+
+/**
+ * @brief Returns a key from the cache, downloading it on a miss.
+ *
+ * @details Concurrent callers asking for the same uri share one download.
+ *          Failed downloads are not cached, the next call retries. A caller
+ *          giving up leaves the shared download running for the others.
+ *
+ * @param[in]  transport   Transport used on a miss, NULL for the default.
+ * @param[in]  uri         Absolute key uri.
+ * @param[in]  deadline_ms Longest wait for the key, 0 for none.
+ * @param[in]  cancel      Optional token aborting the wait.
+ * @param[out] key         16 byte key.
+ *
+ * @retval M3U8_KEY_STATUS_NO_ERROR        On success.
+ * @retval M3U8_KEY_STATUS_INVALID_ARG     If uri or key is NULL or deadline_ms
+ *                                         is negative.
+ * @retval M3U8_KEY_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ * @retval M3U8_KEY_STATUS_FETCH_ERROR     If the download fails.
+ * @retval M3U8_KEY_STATUS_TIMEOUT         If deadline_ms passed first.
+ * @retval M3U8_KEY_STATUS_CANCELLED       If cancel was triggered first.
+ */
+int m3u8_key_fetch(m3u8_transport_t* transport, const char* uri, long deadline_ms,
+                   m3u8_cancel_t* cancel, unsigned char* key);
+
+/**
+ * @brief Starts downloading a key ahead of its first use, without waiting.
+ *
+ * @details Used on key rotation so the next key is cached by the time the
+ *          first segment encrypted with it is decrypted.
+ *
+ * @param[in] transport Transport used on a miss, NULL for the default.
+ * @param[in] uri       Absolute key uri.
+ *
+ * @retval M3U8_KEY_STATUS_NO_ERROR        On success or if already cached.
+ * @retval M3U8_KEY_STATUS_INVALID_ARG     If uri is NULL.
+ * @retval M3U8_KEY_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_key_prefetch(m3u8_transport_t* transport, const char* uri);
+
+/**
+ * @brief Bounds the key cache.
+ *
+ * @details Past capacity, the least recently used keys that are not being
+ *          downloaded or waited on are evicted. A key older than ttl_ms is
+ *          downloaded again on its next use, so rotated keys do not linger.
+ *
+ * @param[in] capacity Keys kept, M3U8_KEY_CACHE_CAPACITY by default.
+ * @param[in] ttl_ms   Lifetime of a key, 0 for none (the default).
+ *
+ * @retval M3U8_KEY_STATUS_NO_ERROR    On success.
+ * @retval M3U8_KEY_STATUS_INVALID_ARG If capacity is 0 or ttl_ms is negative.
+ */
+int m3u8_key_cache_configure(size_t capacity, long ttl_ms);
+
+/**
+ * @brief Drops every cached key that is not being downloaded or waited on.
+ *
+ * @retval M3U8_KEY_STATUS_NO_ERROR On success.
+ */
+int m3u8_key_cache_clear(void);
+
+#endif  // __H_M3U8_KEY__
@@ -129,3 +129,120 @@ int m3u8_list_count(const m3u8_list_node_t* head, int* size) {
 clean_up:
   return status;
 }
+
+int m3u8_list_mpsc_init(m3u8_list_mpsc_t* queue) {
+  int status = M3U8_LIST_STATUS_NO_ERROR;
+
+  if (queue == NULL) {
+    RAISE(M3U8_LIST_STATUS_INVALID_ARGS, "Invalid argument queue is NULL");
+  }
+
+  memset(queue, 0, sizeof(m3u8_list_mpsc_t));
+  queue->head = &queue->stub;
+  queue->tail = &queue->stub;
+
+clean_up:
+  return status;
+}
+
+int m3u8_list_mpsc_push(m3u8_list_mpsc_t* queue, m3u8_list_mpsc_node_t* node) {
+  int status = M3U8_LIST_STATUS_NO_ERROR;
+
+  m3u8_list_mpsc_node_t* prev = NULL;
+
+  if (queue == NULL || node == NULL) {
+    RAISE(M3U8_LIST_STATUS_INVALID_ARGS, "Invalid argument: queue or node is NULL");
+  }
+
+  __atomic_store_n(&node->next, NULL, __ATOMIC_RELAXED);
+
+  // NOTE: until prev->next is set, the consumer sees the queue end at prev
+  prev = __atomic_exchange_n(&queue->head, node, __ATOMIC_ACQ_REL);
+  __atomic_store_n(&prev->next, node, __ATOMIC_RELEASE);
+
+clean_up:
+  return status;
+}
+
+int m3u8_list_mpsc_pop(m3u8_list_mpsc_t* queue, m3u8_list_mpsc_node_t** node) {
+  int status = M3U8_LIST_STATUS_NO_ERROR;
+
+  m3u8_list_mpsc_node_t* tail = NULL;
+  m3u8_list_mpsc_node_t* next = NULL;
+
+  if (queue == NULL || node == NULL) {
+    RAISE(M3U8_LIST_STATUS_INVALID_ARGS, "Invalid argument: queue or node is NULL");
+  }
+
+  tail = queue->tail;
+  next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+
+  if (tail == &queue->stub) {
+    if (next == NULL) {
+      return M3U8_LIST_STATUS_NOT_FOUND;
+    }
+
+    queue->tail = next;
+    tail = next;
+    next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE);
+  }
+
+  // NOTE: the last node stays until another one follows it, requeue the
+  // stub behind it so it can be handed out
+  if (next == NULL) {
+    if (tail != __atomic_load_n(&queue->head, __ATOMIC_ACQUIRE)) {
+      return M3U8_LIST_STATUS_NOT_FOUND;
+    }
+
+    m3u8_list_mpsc_push(queue, &queue->stub);
+
+    if ((next = __atomic_load_n(&tail->next, __ATOMIC_ACQUIRE)) == NULL) {
+      return M3U8_LIST_STATUS_NOT_FOUND;
+    }
+  }
+
+  queue->tail = next;
+  *node = tail;
+
+clean_up:
+  return status;
+}
+
+int m3u8_list_mpsc_drain(m3u8_list_mpsc_t* queue, m3u8_list_mpsc_node_t** first, int* count) {
+  int status = M3U8_LIST_STATUS_NO_ERROR;
+
+  m3u8_list_mpsc_node_t* node = NULL;
+  m3u8_list_mpsc_node_t* last = NULL;
+  int                    taken = 0;
+
+  if (queue == NULL || first == NULL) {
+    RAISE(M3U8_LIST_STATUS_INVALID_ARGS, "Invalid argument: queue or first is NULL");
+  }
+
+  *first = NULL;
+
+  // NOTE: popped nodes are no longer written by producers, relink them
+  while (m3u8_list_mpsc_pop(queue, &node) == M3U8_LIST_STATUS_NO_ERROR) {
+    node->next = NULL;
+
+    if (last == NULL) {
+      *first = node;
+    } else {
+      last->next = node;
+    }
+
+    last = node;
+    taken++;
+  }
+
+  if (count != NULL) {
+    *count = taken;
+  }
+
+  if (taken == 0) {
+    status = M3U8_LIST_STATUS_NOT_FOUND;
+  }
+
+clean_up:
+  return status;
+}
@@ -166,4 +166,98 @@ int m3u8_list_is_empty(const m3u8_list_node_t* head, bool* is_empty);
  */
 int m3u8_list_count(const m3u8_list_node_t* head, int* size);
 
+/**
+ * @brief Bytes keeping the producer and consumer ends of a queue on separate
+ *        cache lines.
+ */
+#define M3U8_LIST_CACHE_LINE 64
+
+/**
+ * @brief Iterates over a chain taken by m3u8_list_mpsc_drain, in push order.
+ *
+ * @details The next node is read before the body runs, so the body may free
+ *          entry.
+ *
+ * @param entry  Loop variable of type (type*).
+ * @param first  First node of the chain, NULL when empty.
+ * @param type   Structure type.
+ * @param member Queue node field name.
+ */
+#define m3u8_list_mpsc_foreach(entry, first, type, member)       \
+  for (m3u8_list_mpsc_node_t *_pos = (first), *_next = NULL;     \
+       _pos != NULL && ((_next = _pos->next), true) &&           \
+       ((entry) = m3u8_list_container_of(_pos, type, member));   \
+       _pos = _next)
+
+/**
+ * @struct m3u8_list_mpsc_node_t
+ * @brief Node of a multi-producer, single-consumer queue.
+ */
+typedef struct m3u8_list_mpsc_node {
+  struct m3u8_list_mpsc_node* next; /**< Node pushed after this one. */
+} m3u8_list_mpsc_node_t;
+
+/**
+ * @struct m3u8_list_mpsc_t
+ * @brief Lock-free intrusive queue, pushed by any thread and popped by one.
+ *
+ * @details A push is one atomic exchange and never waits. The consumer
+ *          never blocks producers; it may see the queue empty while a
+ *          push is halfway and then gets the node on a later pop.
+ */
+typedef struct {
+  m3u8_list_mpsc_node_t* head;                                   /**< Last node pushed. */
+  char                   pad[M3U8_LIST_CACHE_LINE - sizeof(void*)]; /**< Keeps tail off its line. */
+  m3u8_list_mpsc_node_t* tail;                                   /**< Next node to pop. */
+  m3u8_list_mpsc_node_t  stub;                                   /**< Queued while empty. */
+} m3u8_list_mpsc_t;
+
+/**
+ * @brief Initializes an empty queue.
+ *
+ * @param[out] queue Pointer to the queue to initialize.
+ *
+ * @retval M3U8_LIST_STATUS_NO_ERROR      On success.
+ * @retval M3U8_LIST_STATUS_INVALID_ARGS  If queue is NULL.
+ */
+int m3u8_list_mpsc_init(m3u8_list_mpsc_t* queue);
+
+/**
+ * @brief Appends a node, from any thread.
+ *
+ * @param[in] queue Pointer to the queue.
+ * @param[in] node  Pointer to the node to push, not on any queue.
+ *
+ * @retval M3U8_LIST_STATUS_NO_ERROR      On success.
+ * @retval M3U8_LIST_STATUS_INVALID_ARGS  If any pointer is NULL.
+ */
+int m3u8_list_mpsc_push(m3u8_list_mpsc_t* queue, m3u8_list_mpsc_node_t* node);
+
+/**
+ * @brief Takes the oldest node, from the consumer thread only.
+ *
+ * @param[in]  queue Pointer to the queue.
+ * @param[out] node  Receives the node.
+ *
+ * @retval M3U8_LIST_STATUS_NO_ERROR      On success.
+ * @retval M3U8_LIST_STATUS_INVALID_ARGS  If any pointer is NULL.
+ * @retval M3U8_LIST_STATUS_NOT_FOUND     If the queue is empty, or its next
+ *                                        push has not been linked yet.
+ */
+int m3u8_list_mpsc_pop(m3u8_list_mpsc_t* queue, m3u8_list_mpsc_node_t** node);
+
+/**
+ * @brief Takes every node pushed so far as one chain, from the consumer
+ *        thread only. Walk it with m3u8_list_mpsc_foreach.
+ *
+ * @param[in]  queue Pointer to the queue.
+ * @param[out] first Receives the oldest node, the chain ends with NULL.
+ * @param[out] count Receives the nodes taken, may be NULL.
+ *
+ * @retval M3U8_LIST_STATUS_NO_ERROR      On success.
+ * @retval M3U8_LIST_STATUS_INVALID_ARGS  If queue or first is NULL.
+ * @retval M3U8_LIST_STATUS_NOT_FOUND     If no node could be taken.
+ */
+int m3u8_list_mpsc_drain(m3u8_list_mpsc_t* queue, m3u8_list_mpsc_node_t** first, int* count);
+
 #endif  // __H_M3U8_LIST__
@@ -4,17 +4,26 @@
  */
 #include "logger.h"
 
+#include <errno.h>
+#include <fcntl.h>
 #include <pthread.h>
+#include <sched.h>
 #include <stdarg.h>
+#include <stdbool.h>
 #include <stdio.h>
 #include <stdlib.h>
 #include <string.h>
+#include <sys/stat.h>
 #include <sys/time.h>
+#include <time.h>
+#include <unistd.h>
 
 #include "conate.h"
 
 static LogAttribute* __log_attribute = NULL;
 
+int logger_level = VERBOSE;
+
 static const char* str_log_severities[] = {
   "VERBOSE", "INFO", "DEBUG", "WARN", "ERROR", "CRIT",
 };
@@ -68,93 +77,452 @@ static void logger_write_stdout_handler(LogEvent event) {
   pthread_mutex_unlock(&write_stdout_handler_mutex);
 }
 
+/**
+ * @struct LogFile
+ * @brief Open log file and the lines not written to it yet.
+ */
+typedef struct {
+  int       fd;                              /**< Open file, -1 until needed */
+  long      bytes;                           /**< Size of the file, buffer included */
+  int       lines;                           /**< Lines in the file */
+  size_t    used;                            /**< Bytes pending in buffer */
+  long long flushed_ms;                      /**< Monotonic time of the last write */
+  long      stamp;                           /**< Second formatted in time */
+  char      time[64];                        /**< Formatted stamp, reused within a second */
+  char      buffer[LOGGER_FILE_BUFFER_SIZE]; /**< Lines pending */
+} LogFile;
+
+static LogFile __log_file = {.fd = -1, .stamp = -1};
+
+static long long logger_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000LL + ts.tv_nsec / 1000000;
+}
+
+/**
+ * @brief Writes the pending lines, then syncs them if asked to. Lines that
+ *        cannot be written are dropped. Called with the file mutex held.
+ */
+static void logger_file_write(void) {
+  size_t written = 0;
+
+  while (__log_file.fd >= 0 && written < __log_file.used) {
+    ssize_t count = write(__log_file.fd, __log_file.buffer + written, __log_file.used - written);
+
+    if (count < 0 && errno == EINTR) {
+      continue;
+    }
+
+    if (count <= 0) {
+      break;
+    }
+
+    written += count;
+  }
+
+  if (__log_file.fd >= 0 && written > 0 && __log_attribute->sync_on_flush) {
+    fsync(__log_file.fd);
+  }
+
+  __log_file.used = 0;
+  __log_file.flushed_ms = logger_now_ms();
+}
+
+/**
+ * @brief Shifts path.N-1 to path.N down to path to path.1, dropping the
+ *        oldest, and starts a new file. Called with the file mutex held.
+ */
+static void logger_file_rotate(void) {
+  char from[256];
+  char to[256];
+
+  logger_file_write();
+  close(__log_file.fd);
+  __log_file.fd = -1;
+
+  for (int i = __log_attribute->max_files - 1; i >= 0; i--) {
+    if (i == 0) {
+      snprintf(from, sizeof(from), "%s", __log_attribute->path);
+    } else {
+      snprintf(from, sizeof(from), "%s.%d", __log_attribute->path, i);
+    }
+
+    snprintf(to, sizeof(to), "%s.%d", __log_attribute->path, i + 1);
+    rename(from, to);
+  }
+
+  if (__log_attribute->max_files <= 0) {
+    unlink(__log_attribute->path);
+  }
+}
+
+/**
+ * @brief Writes the pending lines when they are old enough, or at once
+ *        without an interval. Run by the worker when the ring is empty.
+ *
+ * @return Milliseconds until the pending lines are due, or 1000 when there
+ *         are none.
+ */
+static long logger_file_idle(void) {
+  long wait_ms = 1000;
+
+  pthread_mutex_lock(&write_file_handler_mutex);
+
+  if (__log_file.used > 0) {
+    long long age = logger_now_ms() - __log_file.flushed_ms;
+
+    if (age >= __log_attribute->flush_interval_ms) {
+      logger_file_write();
+    } else {
+      wait_ms = (long)(__log_attribute->flush_interval_ms - age);
+    }
+  }
+
+  pthread_mutex_unlock(&write_file_handler_mutex);
+
+  return wait_ms;
+}
+
 /**
  * @brief Writes a log event to a file.
  *
- * This function writes a log message to a file specified in the log 
- * attributes, including the date, time, severity, source file, line number, 
- * and the log message.
+ * This function appends a log line to a buffer and writes it to the file
+ * of the log attributes, which stays open, once the buffer is full or its
+ * oldest line is older than the flush interval. The file rotates by size or
+ * by line count into a bounded set of files.
  *
  * @param event The log event to write.
  */
 static void logger_write_file_handler(LogEvent event) {
   pthread_mutex_lock(&write_file_handler_mutex);
 
-  char         fpath[256];
-  static FILE* file = NULL;
-  static int   lcount = 0, fcount = 0;
+  const char* msg = "[%s][%s] - %s:%d - %s\n";
+  const char* cseverity = str_log_severities[event.severity];
+  size_t      room = 0;
+  int         count = 0;
+  struct stat st;
 
   if (__log_attribute == NULL || __log_attribute->path == NULL) {
     pthread_mutex_unlock(&write_file_handler_mutex);
     return;
   }
 
-  if (lcount >= __log_attribute->max_line_size) {
-    fclose(file);
-    lcount = 0;
-    fcount++;
+  if (__log_file.fd < 0) {
+    if ((__log_file.fd = open(__log_attribute->path, O_WRONLY | O_APPEND | O_CREAT, 0644)) < 0) {
+      pthread_mutex_unlock(&write_file_handler_mutex);
+      return;
+    }
+
+    __log_file.bytes = fstat(__log_file.fd, &st) == 0 ? (long)st.st_size : 0;
+    __log_file.lines = 0;
+    __log_file.flushed_ms = logger_now_ms();
   }
 
-  if (fcount == 0) {
-    snprintf(fpath, sizeof(fpath), "%s", __log_attribute->path);
-  } else {
-    snprintf(fpath, sizeof(fpath), "%s.%d", __log_attribute->path, fcount);
+  // NOTE: strftime is too slow per line, the stamp only changes every second
+  if (event.timestamp != __log_file.stamp) {
+    long tms = (long)event.timestamp;
+
+    if (conate_timefmt(&tms, __log_file.time, sizeof(__log_file.time), TIME_FMT) !=
+        CONATE_NO_ERROR) {
+      snprintf(__log_file.time, sizeof(__log_file.time), "UNKNOWN_TIME");
+    }
+
+    __log_file.stamp = tms;
   }
 
-  if ((file = fopen(fpath, "a")) == NULL) {
-    pthread_mutex_unlock(&write_file_handler_mutex);
-    return;
+  if (LOGGER_FILE_BUFFER_SIZE - __log_file.used < LOGGER_BUFFER_SIZE + LOGGER_PATH_SIZE + 128) {
+    logger_file_write();
   }
 
-  char        obuff[64];
-  const char* msg = "[%s][%s] - %s:%d - %s\n";
-  const char* cseverity = str_log_severities[event.severity];
+  room = LOGGER_FILE_BUFFER_SIZE - __log_file.used;
+  count = snprintf(__log_file.buffer + __log_file.used, room, msg, __log_file.time, cseverity,
+                   event.rlt, event.line, event.msg);
 
-  long tms;
+  if (count > 0) {
+    count = (size_t)count < room ? count : (int)room - 1;
+    __log_file.used += count;
+    __log_file.bytes += count;
+    __log_file.lines++;
+  }
 
-  if (conate_timenow(&tms) != CONATE_NO_ERROR) {
-    tms = 0;
+  if ((__log_attribute->max_file_size > 0 && __log_file.bytes >= __log_attribute->max_file_size) ||
+      (__log_attribute->max_line_size > 0 && __log_file.lines >= __log_attribute->max_line_size)) {
+    logger_file_rotate();
+  } else if (__log_attribute->flush_interval_ms > 0 &&
+             logger_now_ms() - __log_file.flushed_ms >= __log_attribute->flush_interval_ms) {
+    logger_file_write();
   }
 
-  if (conate_timefmt(&tms, obuff, sizeof(obuff), TIME_FMT) != CONATE_NO_ERROR) {
-    snprintf(obuff, sizeof(obuff), "UNKNOWN_TIME");
+  pthread_mutex_unlock(&write_file_handler_mutex);
+}
+
+/**
+ * @struct LogSlot
+ * @brief Slot of the event ring, holding the event and its strings inline.
+ */
+typedef struct {
+  unsigned long sequence;                /**< Position the slot is ready for */
+  LogEvent      event;                   /**< Event, pointing into the slot */
+  char          rlt[LOGGER_PATH_SIZE];   /**< Source path of the event */
+  char          msg[LOGGER_BUFFER_SIZE]; /**< Formatted message */
+} LogSlot;
+
+static LogSlot         __log_ring[LOGGER_RING_SIZE];
+static unsigned long   __log_enqueue __attribute__((aligned(64))) = 0;
+static unsigned long   __log_dequeue __attribute__((aligned(64))) = 0;
+static unsigned long   __log_done = 0;
+static unsigned long   __log_dropped = 0;
+static LogOverflow     __log_overflow = LOGGER_OVERFLOW_DROP_NEW;
+static int             __log_sleeping = 0;
+static int             __log_waiting = 0;
+static pthread_once_t  __log_once = PTHREAD_ONCE_INIT;
+static pthread_mutex_t __log_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t  __log_wakeup = PTHREAD_COND_INITIALIZER;
+static pthread_cond_t  __log_space = PTHREAD_COND_INITIALIZER;
+static pthread_mutex_t __log_handlers_mutex = PTHREAD_MUTEX_INITIALIZER;
+static int             __log_is_async = 0;
+
+static __thread int __log_is_worker = 0;
+
+/**
+ * @brief Claims the oldest published slot, or returns NULL when there is
+ *        none. The slot stays taken until logger_ring_release.
+ *
+ * Producers dropping the oldest event claim slots this way as well.
+ */
+static LogSlot* logger_ring_claim(unsigned long* position) {
+  unsigned long pos = __atomic_load_n(&__log_dequeue, __ATOMIC_RELAXED);
+
+  for (;;) {
+    LogSlot* slot = &__log_ring[pos & (LOGGER_RING_SIZE - 1)];
+    long     diff = (long)(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - (pos + 1));
+
+    if (diff < 0) {
+      return NULL;
+    }
+
+    if (diff == 0 &&
+        __atomic_compare_exchange_n(&__log_dequeue, &pos, pos + 1, true, __ATOMIC_RELAXED,
+                                    __ATOMIC_RELAXED)) {
+      *position = pos;
+      return slot;
+    }
+
+    if (diff > 0) {
+      pos = __atomic_load_n(&__log_dequeue, __ATOMIC_RELAXED);
+    }
   }
+}
 
-  fprintf(file, msg, obuff, cseverity, event.rlt, event.line, event.msg);
-  fclose(file);
+static void logger_ring_release(LogSlot* slot, unsigned long position) {
+  __atomic_store_n(&slot->sequence, position + LOGGER_RING_SIZE, __ATOMIC_RELEASE);
 
-  lcount++;
+  // NOTE: blocked producers are woken every quarter of the ring released,
+  // not per slot; their wait is bounded anyway
+  if (position % (LOGGER_RING_SIZE / 4) == 0 &&
+      __atomic_load_n(&__log_waiting, __ATOMIC_SEQ_CST) > 0) {
+    pthread_mutex_lock(&__log_mutex);
+    pthread_cond_broadcast(&__log_space);
+    pthread_mutex_unlock(&__log_mutex);
+  }
+}
 
-  pthread_mutex_unlock(&write_file_handler_mutex);
+/**
+ * @brief Hands one event to every registered handler.
+ */
+static void logger_dispatch(LogEvent event) {
+  pthread_mutex_lock(&__log_handlers_mutex);
+
+  for (LogHandler* handler = __log_handlers; handler->name != NULL && handler->fnp != NULL;
+       handler++) {
+    ((log_handler)handler->fnp)(event);
+  }
+
+  pthread_mutex_unlock(&__log_handlers_mutex);
 }
 
 /**
- * @brief Thread callback function to handle log events.
+ * @brief Dispatches every event of the ring to the handlers, one at a time.
  *
- * This function is executed in a separate thread to handle log events by 
- * invoking the appropriate log handler function.
- *
- * @param vargs The arguments passed to the thread, containing the log event 
- *              handler and the log event.
- * @return NULL
+ * This is the only thread running handlers, which therefore no longer race
+ * each other for the same event.
  */
-static void* logger_pthread_handler_fn(void* vargs) {
-  LogEventHandler* ptr_log_event_handler = (LogEventHandler*)(vargs);
-  LogEvent         event = *ptr_log_event_handler->event;
-  log_handler      handler = (*ptr_log_event_handler).handler->fnp;
+static void* logger_worker_fn(void* vargs) {
+  LogSlot event;
+
+  __log_is_worker = 1;
+
+  for (;;) {
+    unsigned long position = 0;
+    LogSlot*      slot = logger_ring_claim(&position);
 
-  // Calls the function with the appropriate injected event
-  ((log_handler)handler)(event);
+    if (slot == NULL) {
+      struct timespec deadline;
+      long            wait_ms = logger_file_idle();
+
+      pthread_mutex_lock(&__log_mutex);
+      __atomic_store_n(&__log_sleeping, 1, __ATOMIC_SEQ_CST);
+
+      // NOTE: re-checked once flagged, a producer seeing the flag signals
+      if (__atomic_load_n(&__log_dequeue, __ATOMIC_SEQ_CST) ==
+          __atomic_load_n(&__log_enqueue, __ATOMIC_SEQ_CST)) {
+        clock_gettime(CLOCK_REALTIME, &deadline);
+        deadline.tv_sec += wait_ms / 1000;
+        deadline.tv_nsec += (wait_ms % 1000) * 1000000;
+
+        if (deadline.tv_nsec >= 1000000000) {
+          deadline.tv_sec++;
+          deadline.tv_nsec -= 1000000000;
+        }
+
+        pthread_cond_timedwait(&__log_wakeup, &__log_mutex, &deadline);
+      }
+
+      __atomic_store_n(&__log_sleeping, 0, __ATOMIC_SEQ_CST);
+      pthread_mutex_unlock(&__log_mutex);
+      continue;
+    }
+
+    // NOTE: copied out so a slow handler never holds a slot of the ring
+    event.event = slot->event;
+    memcpy(event.rlt, slot->rlt, strlen(slot->rlt) + 1);
+    memcpy(event.msg, slot->msg, strlen(slot->msg) + 1);
+    event.event.rlt = event.rlt;
+    event.event.msg = event.msg;
+    logger_ring_release(slot, position);
+
+    logger_dispatch(event.event);
+    __atomic_add_fetch(&__log_done, 1, __ATOMIC_RELEASE);
+  }
 
   return NULL;
 }
 
+static void logger_init(void) {
+  pthread_t thread_id;
+
+  for (unsigned long i = 0; i < LOGGER_RING_SIZE; i++) {
+    __log_ring[i].sequence = i;
+  }
+
+  // NOTE: without a worker every caller runs the handlers itself
+  if (pthread_create(&thread_id, NULL, logger_worker_fn, NULL) == 0) {
+    pthread_detach(thread_id);
+    __log_is_async = 1;
+  } else {
+    fprintf(stderr, "logger: unable to start the worker thread, logging synchronously\n");
+  }
+
+  atexit(logger_flush);
+}
+
+/**
+ * @brief Formats and dispatches an event on the calling thread, used when
+ *        the worker thread could not be started.
+ *
+ * A handler logging from inside the dispatch would wait on the handlers
+ * mutex it already holds, so such events are dropped.
+ */
+static void logger_sync(char* msg, char* rlt, int line, LogSeverity severity, va_list ap) {
+  LogSlot slot;
+
+  if (__log_is_worker) {
+    __atomic_add_fetch(&__log_dropped, 1, __ATOMIC_RELAXED);
+    return;
+  }
+
+  vsnprintf(slot.msg, LOGGER_BUFFER_SIZE, msg, ap);
+  snprintf(slot.rlt, LOGGER_PATH_SIZE, "%s", rlt);
+
+  slot.event.line = line;
+  slot.event.rlt = slot.rlt;
+  slot.event.msg = slot.msg;
+  slot.event.severity = severity;
+  slot.event.timestamp = (int)time(NULL);
+
+  __log_is_worker = 1;
+  logger_dispatch(slot.event);
+  __log_is_worker = 0;
+}
+
+/**
+ * @brief Claims a free slot for a new event, applying the overflow policy
+ *        when the ring is full.
+ *
+ * @return The slot, or NULL when the event is dropped.
+ */
+static LogSlot* logger_ring_reserve(unsigned long* position) {
+  unsigned long pos = __atomic_load_n(&__log_enqueue, __ATOMIC_RELAXED);
+
+  for (;;) {
+    LogSlot*    slot = &__log_ring[pos & (LOGGER_RING_SIZE - 1)];
+    long        diff = (long)(__atomic_load_n(&slot->sequence, __ATOMIC_ACQUIRE) - pos);
+    LogOverflow policy = __atomic_load_n(&__log_overflow, __ATOMIC_RELAXED);
+
+    if (diff == 0) {
+      if (__atomic_compare_exchange_n(&__log_enqueue, &pos, pos + 1, true, __ATOMIC_RELAXED,
+                                      __ATOMIC_RELAXED)) {
+        *position = pos;
+        return slot;
+      }
+
+      continue;
+    }
+
+    if (diff > 0) {
+      pos = __atomic_load_n(&__log_enqueue, __ATOMIC_RELAXED);
+      continue;
+    }
+
+    // NOTE: a handler waiting on its own worker would never wake up
+    if (policy == LOGGER_OVERFLOW_DROP_NEW || __log_is_worker) {
+      __atomic_add_fetch(&__log_dropped, 1, __ATOMIC_RELAXED);
+      return NULL;
+    }
+
+    if (policy == LOGGER_OVERFLOW_DROP_OLDEST) {
+      unsigned long oldest = 0;
+      LogSlot*      dropped = logger_ring_claim(&oldest);
+
+      if (dropped != NULL) {
+        __atomic_add_fetch(&__log_dropped, 1, __ATOMIC_RELAXED);
+        logger_ring_release(dropped, oldest);
+        __atomic_add_fetch(&__log_done, 1, __ATOMIC_RELEASE);
+      } else {
+        sched_yield();
+      }
+    } else {
+      struct timespec deadline;
+
+      clock_gettime(CLOCK_REALTIME, &deadline);
+      deadline.tv_nsec += 1000000;
+
+      if (deadline.tv_nsec >= 1000000000) {
+        deadline.tv_sec++;
+        deadline.tv_nsec -= 1000000000;
+      }
+
+      pthread_mutex_lock(&__log_mutex);
+      __atomic_add_fetch(&__log_waiting, 1, __ATOMIC_SEQ_CST);
+      pthread_cond_timedwait(&__log_space, &__log_mutex, &deadline);
+      __atomic_sub_fetch(&__log_waiting, 1, __ATOMIC_SEQ_CST);
+      pthread_mutex_unlock(&__log_mutex);
+    }
+
+    pos = __atomic_load_n(&__log_enqueue, __ATOMIC_RELAXED);
+  }
+}
+
 /**
  * @brief Logs a message with the specified severity and details.
  *
- * This function logs a message with the specified severity, source file, 
- * and line number. It creates a log event and dispatches it to all registered 
- * log handlers.
+ * This function formats the message straight into a slot of the event ring
+ * and leaves the dispatch to the registered log handlers to the worker
+ * thread. It allocates nothing and never creates a thread past the first
+ * call.
  *
  * @param msg The log message format string.
  * @param rlt The source file name.
@@ -163,40 +531,46 @@ static void* logger_pthread_handler_fn(void* vargs) {
  * @param ... Additional arguments for the log message format string.
  */
 void logger(char* msg, char* rlt, int line, LogSeverity severity, ...) {
-  va_list ap;
-  va_start(ap, severity);
+  va_list       ap;
+  unsigned long position = 0;
+  LogSlot*      slot = NULL;
 
-  char buffer[LOGGER_BUFFER_SIZE];
-  vsnprintf(buffer, LOGGER_BUFFER_SIZE, msg, ap);
+  // NOTE: the macros check first, this covers direct callers
+  if (!LOGGER_IS_ENABLED(severity)) {
+    return;
+  }
 
-  va_end(ap);
+  pthread_once(&__log_once, logger_init);
 
-  LogHandler* ptr_log_handler = __log_handlers;
-  LogEvent*   ptr_log_event = malloc(sizeof(LogEvent));
+  if (!__log_is_async) {
+    va_start(ap, severity);
+    logger_sync(msg, rlt, line, severity, ap);
+    va_end(ap);
+    return;
+  }
 
-  ptr_log_event->line = line;
-  ptr_log_event->rlt = strdup(rlt);
-  ptr_log_event->msg = strdup(buffer);
-  ptr_log_event->severity = severity;
-  ptr_log_event->timestamp = (int)time(NULL);
+  if ((slot = logger_ring_reserve(&position)) == NULL) {
+    return;
+  }
 
-  while (ptr_log_handler->name != NULL && ptr_log_handler->fnp != NULL) {
-    pthread_t        thread_id;
-    LogEventHandler* log_event_handler = malloc(sizeof(LogEventHandler));
+  va_start(ap, severity);
+  vsnprintf(slot->msg, LOGGER_BUFFER_SIZE, msg, ap);
+  va_end(ap);
 
-    if (log_event_handler == NULL) {
-      free(ptr_log_event->msg);
-      free(ptr_log_event->rlt);
-      return;
-    }
+  snprintf(slot->rlt, LOGGER_PATH_SIZE, "%s", rlt);
 
-    log_event_handler->event = ptr_log_event;
-    log_event_handler->handler = ptr_log_handler;
+  slot->event.line = line;
+  slot->event.rlt = slot->rlt;
+  slot->event.msg = slot->msg;
+  slot->event.severity = severity;
+  slot->event.timestamp = (int)time(NULL);
 
-    pthread_create(&thread_id, NULL, logger_pthread_handler_fn,
-                   (void*)log_event_handler);
-    pthread_detach(thread_id);
-    ptr_log_handler++;
+  __atomic_store_n(&slot->sequence, position + 1, __ATOMIC_RELEASE);
+
+  if (__atomic_load_n(&__log_sleeping, __ATOMIC_SEQ_CST)) {
+    pthread_mutex_lock(&__log_mutex);
+    pthread_cond_signal(&__log_wakeup);
+    pthread_mutex_unlock(&__log_mutex);
   }
 }
 
@@ -220,6 +594,8 @@ int logger_add_log_handler(char* name, log_handler fnp) {
   LogHandler handler = {.name = name, .fnp = (log_handler*)fnp};
   int        nhandlers = sizeof(__log_handlers) / sizeof(__log_handlers[0]);
 
+  pthread_mutex_lock(&__log_handlers_mutex);
+
   for (int i = 0; i < nhandlers; i++) {
     if (__log_handlers[i].name == NULL && __log_handlers[i].fnp == NULL) {
       sent_index = i;
@@ -241,6 +617,7 @@ int logger_add_log_handler(char* name, log_handler fnp) {
   __log_handlers[sent_index] = handler;
 
 clean_up:
+  pthread_mutex_unlock(&__log_handlers_mutex);
   return status;
 }
 
@@ -261,6 +638,8 @@ int logger_remove_log_handler(char* name) {
   int n = 0;
   int found_index = -1;
 
+  pthread_mutex_lock(&__log_handlers_mutex);
+
   while (__log_handlers[n].name != NULL && __log_handlers[n].fnp != NULL) {
     if (strcmp(__log_handlers[n].name, name) == 0) {
       found_index = n;
@@ -283,6 +662,7 @@ int logger_remove_log_handler(char* name) {
   __log_handlers[n].fnp = NULL;
 
 clean_up:
+  pthread_mutex_unlock(&__log_handlers_mutex);
   return status;
 }
 
@@ -327,7 +707,88 @@ int logger_set_log_attribute(LogAttribute attr) {
   }
 
   __log_attribute->max_line_size = attr.max_line_size;
+  __log_attribute->max_file_size = attr.max_file_size;
+  __log_attribute->max_files = attr.max_files;
+  __log_attribute->flush_interval_ms = attr.flush_interval_ms;
+  __log_attribute->sync_on_flush = attr.sync_on_flush;
+
+clean_up:
+  return status;
+}
+
+/**
+ * @brief Sets the lowest severity logged.
+ *
+ * @param severity The lowest severity to log.
+ * @return int Status code indicating the result of the operation.
+ * @retval LOGGER_NO_ERROR Success.
+ * @retval LOGGER_INVALID_ARG Unknown severity.
+ */
+int logger_set_level(LogSeverity severity) {
+  int status = LOGGER_NO_ERROR;
+
+  if ((int)severity < VERBOSE || severity > CRIT) {
+    status = LOGGER_INVALID_ARG;
+    goto clean_up;
+  }
+
+  __atomic_store_n(&logger_level, (int)severity, __ATOMIC_RELAXED);
+
+clean_up:
+  return status;
+}
+
+/**
+ * @brief Sets what log calls do when the event ring is full.
+ *
+ * @param policy The overflow policy.
+ * @return int Status code indicating the result of the operation.
+ * @retval LOGGER_NO_ERROR Success.
+ * @retval LOGGER_INVALID_ARG Unknown policy.
+ */
+int logger_set_overflow(LogOverflow policy) {
+  int status = LOGGER_NO_ERROR;
+
+  if (policy != LOGGER_OVERFLOW_DROP_NEW && policy != LOGGER_OVERFLOW_DROP_OLDEST &&
+      policy != LOGGER_OVERFLOW_BLOCK) {
+    status = LOGGER_INVALID_ARG;
+    goto clean_up;
+  }
+
+  __atomic_store_n(&__log_overflow, policy, __ATOMIC_RELAXED);
 
 clean_up:
   return status;
 }
+
+/**
+ * @brief Waits until every event reserved before the call was handled or
+ *        dropped, then writes the lines the file handler buffered.
+ */
+void logger_flush(void) {
+  unsigned long target = __atomic_load_n(&__log_enqueue, __ATOMIC_ACQUIRE);
+
+  if (__log_is_worker) {
+    return;
+  }
+
+  while (__atomic_load_n(&__log_done, __ATOMIC_ACQUIRE) < target) {
+    pthread_mutex_lock(&__log_mutex);
+    pthread_cond_signal(&__log_wakeup);
+    pthread_mutex_unlock(&__log_mutex);
+    sched_yield();
+  }
+
+  pthread_mutex_lock(&write_file_handler_mutex);
+  logger_file_write();
+  pthread_mutex_unlock(&write_file_handler_mutex);
+}
+
+/**
+ * @brief Counts the events discarded because the ring was full.
+ *
+ * @return unsigned long Events dropped since the process started.
+ */
+unsigned long logger_dropped(void) {
+  return __atomic_load_n(&__log_dropped, __ATOMIC_RELAXED);
+}
@@ -8,6 +8,7 @@
 #define LOGGER_HANDLER_LIMIT_ERROR          LOGGER_NO_ERROR + 0x02
 #define LOGGER_HANDLER_NOT_FOUND            LOGGER_NO_ERROR + 0x03
 #define LOGGER_LOG_ATTR_ALREADY_INITIALIZED LOGGER_NO_ERROR + 0x04
+#define LOGGER_INVALID_ARG                  LOGGER_NO_ERROR + 0x05
 
 /**
  * @enum LogSeverity
@@ -27,8 +28,12 @@ typedef enum {
  * @brief Attributes for configuring log files.
  */
 typedef struct {
-  char* path;          /**< Path to the log file */
-  int   max_line_size; /**< Maximum size of a log lines in file */
+  char* path;              /**< Path to the log file */
+  int   max_line_size;     /**< Lines per file before rotating, 0 for no limit */
+  long  max_file_size;     /**< Bytes per file before rotating, 0 for no limit */
+  int   max_files;         /**< Rotated files kept as path.1 to path.N */
+  int   flush_interval_ms; /**< Age of buffered lines forcing a write, 0 to write when idle */
+  int   sync_on_flush;     /**< Calls fsync after every write when not 0 */
 } LogAttribute;
 
 /**
@@ -43,6 +48,16 @@ typedef struct {
   LogSeverity severity;  /**< Severity of the log event */
 } LogEvent;
 
+/**
+ * @enum LogOverflow
+ * @brief What a log call does when the event ring is full.
+ */
+typedef enum {
+  LOGGER_OVERFLOW_DROP_NEW,    /**< Discards the event being logged */
+  LOGGER_OVERFLOW_DROP_OLDEST, /**< Discards the oldest pending event */
+  LOGGER_OVERFLOW_BLOCK,       /**< Waits for the worker to free a slot */
+} LogOverflow;
+
 /**
  * @struct LogHandler
  * @brief Structure representing a log handler.
@@ -52,15 +67,6 @@ typedef struct {
   void* fnp;  /**< Function pointer to the handler */
 } LogHandler;
 
-/**
- * @struct LogEventHandler
- * @brief Structure representing an event and its handler.
- */
-typedef struct {
-  LogEvent*   event;   /**< Pointer to the log event */
-  LogHandler* handler; /**< Log handler */
-} LogEventHandler;
-
 /**
  * @typedef log_handler
  * @brief Function pointer type for log handlers.
@@ -75,6 +81,24 @@ typedef void (*log_handler)(LogEvent event);
  */
 #define LOGGER_BUFFER_SIZE      1024
 
+/**
+ * @def LOGGER_RING_SIZE
+ * @brief Events waiting for the worker thread, a power of two.
+ */
+#define LOGGER_RING_SIZE        256
+
+/**
+ * @def LOGGER_FILE_BUFFER_SIZE
+ * @brief Bytes of log lines the file handler buffers before writing.
+ */
+#define LOGGER_FILE_BUFFER_SIZE (64 * 1024)
+
+/**
+ * @def LOGGER_PATH_SIZE
+ * @brief Bytes kept of the source path of an event.
+ */
+#define LOGGER_PATH_SIZE        128
+
 /**
  * @def LOGGER_SET_MAX_HANDLERS
  * @brief Maximum number of global log handlers.
@@ -106,6 +130,63 @@ typedef void (*log_handler)(LogEvent event);
 #define __RLT__ \
   (strstr(__FILE__, PFX_SRC_PATH) ? strstr(__FILE__, PFX_SRC_PATH) : __FILE__)
 
+/**
+ * @def M3U8_LOG_LEVEL
+ * @brief Lowest severity compiled in, as a LogSeverity value (0 for VERBOSE
+ *        up to 5 for CRIT).
+ *
+ * Log macros below it expand to a constant false branch the compiler drops,
+ * so neither the call nor its arguments cost anything. RAISE still sets the
+ * status and jumps to clean up.
+ */
+#ifndef M3U8_LOG_LEVEL
+#define M3U8_LOG_LEVEL 0
+#endif
+
+/**
+ * @brief Lowest severity logged at runtime, see logger_set_level.
+ *
+ * Read by the log macros before the arguments are evaluated.
+ */
+extern int logger_level;
+
+/**
+ * @def LOGGER_IS_ENABLED
+ * @brief Whether a severity passes both the compile-time and the runtime
+ *        threshold.
+ *
+ * @param severity The LogSeverity to check.
+ */
+#define LOGGER_IS_ENABLED(severity) \
+  ((severity) >= M3U8_LOG_LEVEL &&  \
+   (int)(severity) >= __atomic_load_n(&logger_level, __ATOMIC_RELAXED))
+
+/**
+ * @def LOGGER_LOG
+ * @brief Macro to log a message when its severity is enabled.
+ *
+ * @param severity The LogSeverity of the message.
+ * @param message The message.
+ * @param ... Additional arguments for the message, only evaluated when the
+ * severity is enabled.
+ */
+#define LOGGER_LOG(severity, message, ...)                         \
+  do {                                                             \
+    if (LOGGER_IS_ENABLED(severity)) {                             \
+      logger(message, __RLT__, __LINE__, severity, ##__VA_ARGS__); \
+    }                                                              \
+  } while (0)
+
+/**
+ * @def VERBOSE
+ * @brief Macro to log a verbose message, meant for hot paths.
+ *
+ * @param message The verbose message.
+ * @param ... Additional arguments for the verbose message.
+ */
+#define VERBOSE(message, ...) \
+  LOGGER_LOG(VERBOSE, message, ##__VA_ARGS__);
+
 /**
  * @def DEBUG
  * @brief Macro to log a debug message.
@@ -114,7 +195,7 @@ typedef void (*log_handler)(LogEvent event);
  * @param ... Additional arguments for the debug message.
  */
 #define DEBUG(message, ...) \
-  logger(message, __RLT__, __LINE__, DEBUG, ##__VA_ARGS__);
+  LOGGER_LOG(DEBUG, message, ##__VA_ARGS__);
 
 /**
  * @def INFO
@@ -124,7 +205,7 @@ typedef void (*log_handler)(LogEvent event);
  * @param ... Additional arguments for the informational message.
  */
 #define INFO(message, ...) \
-  logger(message, __RLT__, __LINE__, INFO, ##__VA_ARGS__);
+  LOGGER_LOG(INFO, message, ##__VA_ARGS__);
 
 /**
  * @def WARN
@@ -134,7 +215,7 @@ typedef void (*log_handler)(LogEvent event);
  * @param ... Additional arguments for the warning message.
  */
 #define WARN(message, ...) \
-  logger(message, __RLT__, __LINE__, WARN, ##__VA_ARGS__);
+  LOGGER_LOG(WARN, message, ##__VA_ARGS__);
 
 /**
  * @def ERROR
@@ -144,7 +225,7 @@ typedef void (*log_handler)(LogEvent event);
  * @param ... Additional arguments for the error message.
  */
 #define ERROR(message, ...) \
-  logger(message, __RLT__, __LINE__, ERROR, ##__VA_ARGS__);
+  LOGGER_LOG(ERROR, message, ##__VA_ARGS__);
 
 /**
  * @def CRIT
@@ -154,7 +235,7 @@ typedef void (*log_handler)(LogEvent event);
  * @param ... Additional arguments for the critical message.
  */
 #define CRIT(message, ...) \
-  logger(message, __RLT__, __LINE__, CRIT, ##__VA_ARGS__);
+  LOGGER_LOG(CRIT, message, ##__VA_ARGS__);
 
 /**
  * @def RAISE
@@ -164,9 +245,9 @@ typedef void (*log_handler)(LogEvent event);
  * @param message The critical message.
  * @param ... Additional arguments for the critical message.
  */
-#define RAISE(__status, message, ...)                       \
-  logger(message, __RLT__, __LINE__, ERROR, ##__VA_ARGS__); \
-  status = __status;                                        \
+#define RAISE(__status, message, ...)          \
+  LOGGER_LOG(ERROR, message, ##__VA_ARGS__);   \
+  status = __status;                           \
   goto clean_up
 
 /**  */
@@ -179,22 +260,19 @@ typedef void (*log_handler)(LogEvent event);
 static void logger_write_stdout_handler(LogEvent event) __attribute__((used));
 
 /**
- * @brief Dummy function for handling log events to a file.
+ * @brief Appends a log event to the file of the log attribute.
  *
  * @param event The log event to handle.
  */
 static void logger_write_file_handler(LogEvent event) __attribute__((used));
 
-/**
- * @brief Call the thread-handler function with this wrapper.
- *
- * @param vargs The `LogEventHandler` will be injected here.
- */
-static void* logger_pthread_handler_fn(void* vargs) __attribute__((used));
-
 /**
  * @brief Logs a msg with the specified severity.
  *
+ * @details The event is formatted into a slot of a bounded ring without any
+ *          heap allocation, and a single worker thread hands it to the
+ *          handlers. A full ring is dealt with per logger_set_overflow.
+ *
  * @param msg The log msg.
  * @param rlt The relative path of the source file.
  * @param line The line number in the source file.
@@ -238,4 +316,44 @@ extern int logger_remove_log_handler(char* name);
  */
 extern int logger_set_log_attribute(LogAttribute attr);
 
+/**
+ * @brief Sets the lowest severity logged, VERBOSE by default.
+ *
+ * @details Severities below M3U8_LOG_LEVEL stay compiled out whatever the
+ *          runtime level.
+ *
+ * @param severity The lowest severity to log.
+ * @return int Status code indicating the result of the operation.
+ * @retval LOGGER_NO_ERROR Success.
+ * @retval LOGGER_INVALID_ARG Unknown severity.
+ */
+extern int logger_set_level(LogSeverity severity);
+
+/**
+ * @brief Sets what log calls do when the event ring is full.
+ *
+ * @param policy The overflow policy, LOGGER_OVERFLOW_DROP_NEW by default.
+ * @return int Status code indicating the result of the operation.
+ * @retval LOGGER_NO_ERROR Success.
+ * @retval LOGGER_INVALID_ARG Unknown policy.
+ */
+extern int logger_set_overflow(LogOverflow policy);
+
+/**
+ * @brief Waits until the handlers have seen every event logged before, then
+ *        writes the lines the file handler buffered.
+ *
+ * @details Registered with atexit on the first log call. Returns at once
+ *          from within a handler.
+ */
+extern void logger_flush(void);
+
+/**
+ * @brief Counts the events discarded because the ring was full, or, when
+ *        the worker thread could not be started, because a handler logged.
+ *
+ * @return unsigned long Events dropped since the process started.
+ */
+extern unsigned long logger_dropped(void);
+
 #endif  // __H_LOGGER__
@@ -1,43 +1,47 @@
-#include <curl/curl.h>
+#include <ctype.h>
 #include <stdlib.h>
 #include <string.h>
 
 #include "ext.h"
+#include "fetch.h"
 #include "logger.h"
 #include "m3u8.h"
+#include "memory_usage.h"
+#include "rendition.h"
+#include "steering.h"
+#include "transport.h"
+#include "variant.h"
 
-/** @brief response buffer used to store data received from an HTTP request. */
+/** @brief response buffer used to store data received from a transport. */
 typedef struct {
   char*  data; /**< pointer to the response data buffer */
   size_t size; /**< number of bytes currently stored in the buffer */
 } response_t;
 
 /**
- * @brief Callback used by libcurl to write downloaded data into memory.
+ * @brief Appends a transport chunk to a response buffer.
  *
- * @param contents   pointer to the incoming data buffer;
- * @param size       size of each data unit;
- * @param nmemb      number of data units;
- * @param userp      pointer to a response_t structure that accumulates the data.
+ * @param response response_t accumulating the data;
+ * @param chunk    pointer to the incoming data buffer;
+ * @param size     number of bytes in chunk.
  *
- * @return The number of bytes successfully handled, or 0 on memory allocation failure.
+ * @return M3U8_STATUS_NO_ERROR        on success;
+ *         M3U8_STATUS_MEM_ALLOC_ERROR on memory allocation failure.
  */
-static size_t __m3u8_download_handler(void* contents, size_t size, size_t nmemb, void* userp) {
-  size_t      total_size = size * nmemb;
-  response_t* memory_ptr = (response_t*)userp;
-
-  memory_ptr->data = realloc(memory_ptr->data, memory_ptr->size + total_size + 1);
+static int __m3u8_response_append(response_t* response, const char* chunk, size_t size) {
+  char* data = realloc(response->data, response->size + size + 1);
 
-  if (memory_ptr->data == NULL) {
+  if (data == NULL) {
     ERROR("Out of memory while reallocating buffer");
-    return 0;
+    return M3U8_STATUS_MEM_ALLOC_ERROR;
   }
 
-  memcpy(&(memory_ptr->data[memory_ptr->size]), contents, total_size);
-  memory_ptr->size += total_size;
-  memory_ptr->data[memory_ptr->size] = 0;
+  memcpy(&data[response->size], chunk, size);
+  response->data = data;
+  response->size += size;
+  response->data[response->size] = 0;
 
-  return total_size;
+  return M3U8_STATUS_NO_ERROR;
 }
 
 /**
@@ -57,7 +61,7 @@ int m3u8_create(m3u8_t** m3u8_ptr) {
     RAISE_STATUS(M3U8_STATUS_INVALID_ARG, "Invalid argument m3u8_ptr, this pointer must be null");
   }
 
-  if ((*m3u8_ptr = (m3u8_t*)malloc(sizeof(m3u8_t*))) == NULL) {
+  if ((*m3u8_ptr = (m3u8_t*)malloc(sizeof(m3u8_t))) == NULL) {
     RAISE_STATUS(M3U8_STATUS_MEM_ALLOC_ERROR, "Unable to allocate memory for m3u8_ptr");
   }
 
@@ -65,6 +69,8 @@ int m3u8_create(m3u8_t** m3u8_ptr) {
     RAISE_STATUS(M3U8_STATUS_MEM_ALLOC_ERROR, "Fail to memset m3u8_ptr");
   }
 
+  m3u8_memory_count(M3U8_MEMORY_PLAYLIST, 1);
+
 clean_up:
   if (status != M3U8_STATUS_NO_ERROR && *m3u8_ptr != NULL) {
     free(*m3u8_ptr);
@@ -88,48 +94,90 @@ int m3u8_destroy(m3u8_t* m3u8_ptr) {
     RAISE_STATUS(M3U8_STATUS_INVALID_ARG, "Unable to deallocate a null pointer");
   }
 
+  m3u8_rendition_clear(m3u8_ptr);
+  m3u8_variant_clear(m3u8_ptr);
+
+  if (m3u8_ptr->content_steering != NULL) {
+    m3u8_steering_tag_destroy(m3u8_ptr->content_steering);
+    free(m3u8_ptr->content_steering);
+  }
+
+  m3u8_memory_count(M3U8_MEMORY_PLAYLIST, -1);
   free(m3u8_ptr);
 
 clean_up:
   return status;
 }
 
-int m3u8_open_from_remote(char* uri, m3u8_t* m3u8_ptr) {
+int m3u8_open_from_transport(m3u8_transport_t* transport, const char* uri, m3u8_t* m3u8_ptr) {
   int status = M3U8_STATUS_NO_ERROR;
 
-  CURLcode   status_code = CURLE_OK;
-  CURL*      curl = curl_easy_init();
-  response_t response = {.data = NULL, .size = 0};
+  m3u8_transport_stream_t stream = {.transport = NULL, .handle = NULL};
+  response_t              response = {.data = NULL, .size = 0};
+  const char*             chunk = NULL;
+  size_t                  size = 0;
+  int                     result = M3U8_TRANSPORT_STATUS_NO_ERROR;
 
-  if (uri == NULL) {
-    RAISE_STATUS(M3U8_STATUS_INVALID_ARG, "Invalid argument uri and m3u8_ptr cannot to be NULL");
+  if (transport == NULL || uri == NULL || m3u8_ptr == NULL) {
+    RAISE_STATUS(M3U8_STATUS_INVALID_ARG, "Invalid argument transport, uri and m3u8_ptr cannot to be NULL");
   }
 
-  if (curl == NULL) {
-    RAISE_STATUS(M3U8_STATUS_INIT_CURL_ERROR, "Curl was bad initialized with curl_easy_init");
+  if ((result = m3u8_transport_open(transport, uri, &stream)) == M3U8_TRANSPORT_STATUS_NOT_FOUND) {
+    RAISE_STATUS(M3U8_STATUS_NOT_FOUND, "Nothing found at %s on transport", uri);
   }
 
-  curl_easy_setopt(curl, CURLOPT_URL, uri);
-  curl_easy_setopt(curl, CURLOPT_FAILONERROR, 1L);
-  curl_easy_setopt(curl, CURLOPT_WRITEFUNCTION, __m3u8_download_handler);
-  curl_easy_setopt(curl, CURLOPT_WRITEDATA, (void*)&response);
+  if (result != M3U8_TRANSPORT_STATUS_NO_ERROR) {
+    RAISE_STATUS(M3U8_STATUS_TRANSPORT_ERROR, "Unable to open %s on transport (0x%x)", uri, result);
+  }
+
+  for (;;) {
+    if ((result = m3u8_transport_read(&stream, &chunk, &size)) != M3U8_TRANSPORT_STATUS_NO_ERROR) {
+      RAISE_STATUS(M3U8_STATUS_TRANSPORT_ERROR, "Something went wrong in manifest download (0x%x)", result);
+    }
+
+    if (size == 0) {
+      break;
+    }
+
+    // NOTE: a whole NUL terminated body is parsed where it lies, without a
+    // copy, only when the backend lets the parser write into it; caller-owned
+    // regions of the memory backend are copied first
+    if (response.size == 0 && stream.is_terminated && stream.is_writable && chunk[size] == 0) {
+      const char* next = NULL;
+      size_t      next_s = 0;
 
-  status_code = curl_easy_perform(curl);
+      if ((result = m3u8_transport_read(&stream, &next, &next_s)) == M3U8_TRANSPORT_STATUS_NO_ERROR &&
+          next_s == 0) {
+        m3u8_ext_parse((char*)chunk, m3u8_ptr);
+        goto clean_up;
+      }
 
-  if (status_code != CURLE_OK) {
-    ERROR("The request was failed: %s", curl_easy_strerror(status_code));
-    RAISE_STATUS(M3U8_STATUS_INIT_CURL_ERROR, "Something went wrong in manifest download");
+      if (result != M3U8_TRANSPORT_STATUS_NO_ERROR) {
+        RAISE_STATUS(M3U8_STATUS_TRANSPORT_ERROR, "Something went wrong in manifest download (0x%x)", result);
+      }
+
+      if ((status = __m3u8_response_append(&response, chunk, size)) != M3U8_STATUS_NO_ERROR) {
+        goto clean_up;
+      }
+
+      chunk = next;
+      size = next_s;
+    }
+
+    if ((status = __m3u8_response_append(&response, chunk, size)) != M3U8_STATUS_NO_ERROR) {
+      goto clean_up;
+    }
   }
 
   if (response.size == 0) {
-    RAISE_STATUS(M3U8_STATUS_CURL_OP_ERROR, "Received an empty respomse from remote");
+    RAISE_STATUS(M3U8_STATUS_TRANSPORT_ERROR, "Received an empty respomse from remote");
   }
 
   m3u8_ext_parse(response.data, m3u8_ptr);
 
 clean_up:
-  if (curl != NULL) {
-    curl_easy_cleanup(curl);
+  if (stream.transport != NULL) {
+    m3u8_transport_close(&stream);
   }
 
   if (response.data != NULL) {
@@ -138,3 +186,297 @@ clean_up:
 
   return status;
 }
+
+int m3u8_open_with_options(m3u8_transport_t*           transport,
+                           const char*                 uri,
+                           const m3u8_fetch_options_t* options,
+                           m3u8_t*                     m3u8_ptr) {
+  int status = M3U8_STATUS_NO_ERROR;
+
+  char*  body = NULL;
+  size_t body_s = 0;
+  int    result = M3U8_FETCH_STATUS_NO_ERROR;
+
+  if (transport == NULL || uri == NULL || m3u8_ptr == NULL) {
+    RAISE_STATUS(M3U8_STATUS_INVALID_ARG, "Invalid argument transport, uri and m3u8_ptr cannot to be NULL");
+  }
+
+  result = m3u8_fetch(transport, uri, options, &body, &body_s);
+
+  if (result == M3U8_FETCH_STATUS_TIMEOUT) {
+    RAISE_STATUS(M3U8_STATUS_TIMEOUT, "Manifest download of %s timed out", uri);
+  }
+
+  if (result == M3U8_FETCH_STATUS_CANCELLED) {
+    RAISE_STATUS(M3U8_STATUS_CANCELLED, "Manifest download of %s was cancelled", uri);
+  }
+
+  if (result == M3U8_FETCH_STATUS_MEM_ALLOC_ERROR) {
+    RAISE_STATUS(M3U8_STATUS_MEM_ALLOC_ERROR, "Out of memory while downloading %s", uri);
+  }
+
+  if (result != M3U8_FETCH_STATUS_NO_ERROR) {
+    RAISE_STATUS(M3U8_STATUS_TRANSPORT_ERROR, "Something went wrong in manifest download (0x%x)", result);
+  }
+
+  if (body_s == 0) {
+    RAISE_STATUS(M3U8_STATUS_TRANSPORT_ERROR, "Received an empty respomse from remote");
+  }
+
+  m3u8_ext_parse(body, m3u8_ptr);
+
+clean_up:
+  free(body);
+
+  return status;
+}
+
+int m3u8_open_from_remote(char* uri, m3u8_t* m3u8_ptr) {
+  int status = M3U8_STATUS_NO_ERROR;
+
+  m3u8_transport_t*    transport = NULL;
+  m3u8_fetch_options_t options = {.deadline_ms = M3U8_FETCH_DEFAULT_DEADLINE_MS};
+
+  if (uri == NULL) {
+    RAISE_STATUS(M3U8_STATUS_INVALID_ARG, "Invalid argument uri and m3u8_ptr cannot to be NULL");
+  }
+
+  if (m3u8_transport_default(&transport) != M3U8_TRANSPORT_STATUS_NO_ERROR) {
+    RAISE_STATUS(M3U8_STATUS_INIT_CURL_ERROR, "Curl was bad initialized for the default transport");
+  }
+
+  // NOTE: the default transport is curl, keep reporting its failures as such
+  if ((status = m3u8_open_with_options(transport, uri, &options, m3u8_ptr)) ==
+      M3U8_STATUS_TRANSPORT_ERROR) {
+    status = M3U8_STATUS_CURL_OP_ERROR;
+  }
+
+clean_up:
+  return status;
+}
+
+/** @brief components of a uri reference (RFC 3986 section 3), unset when NULL. */
+typedef struct {
+  const char* scheme;      /**< scheme without ':' */
+  size_t      scheme_s;    /**< length of scheme */
+  const char* authority;   /**< authority without the leading "//" */
+  size_t      authority_s; /**< length of authority */
+  const char* path;        /**< path, possibly empty */
+  size_t      path_s;      /**< length of path */
+  const char* query;       /**< query including its '?' */
+  size_t      query_s;     /**< length of query */
+  const char* fragment;    /**< fragment including its '#' */
+  size_t      fragment_s;  /**< length of fragment */
+} uri_parts_t;
+
+/**
+ * @brief Splits a uri reference into its components.
+ *
+ * @param uri   uri reference to split;
+ * @param parts components pointing into uri.
+ */
+static void __m3u8_uri_split(const char* uri, uri_parts_t* parts) {
+  size_t n = strcspn(uri, ":/?#");
+
+  memset(parts, 0, sizeof(*parts));
+
+  if (n > 0 && uri[n] == ':' && isalpha((unsigned char)uri[0])) {
+    parts->scheme = uri;
+    parts->scheme_s = n;
+    uri += n + 1;
+  }
+
+  if (uri[0] == '/' && uri[1] == '/') {
+    parts->authority = uri + 2;
+    parts->authority_s = strcspn(parts->authority, "/?#");
+    uri = parts->authority + parts->authority_s;
+  }
+
+  parts->path = uri;
+  parts->path_s = strcspn(uri, "?#");
+  uri += parts->path_s;
+
+  if (uri[0] == '?') {
+    parts->query = uri;
+    parts->query_s = strcspn(uri, "#");
+    uri += parts->query_s;
+  }
+
+  if (uri[0] == '#') {
+    parts->fragment = uri;
+    parts->fragment_s = strlen(uri);
+  }
+}
+
+/**
+ * @brief Removes "." and ".." segments of a path in place (RFC 3986 section 5.2.4).
+ *
+ * @param path   path to normalize;
+ * @param path_s length of path.
+ *
+ * @return length of the normalized path.
+ */
+static size_t __m3u8_uri_remove_dots(char* path, size_t path_s) {
+  size_t r = 0;
+  size_t w = 0;
+
+  // NOTE: the output never grows past the input, so w trails r
+  while (r < path_s) {
+    const char* in = &path[r];
+    size_t      in_s = path_s - r;
+
+    if (in_s >= 3 && strncmp(in, "../", 3) == 0) {
+      r += 3;
+    } else if (in_s >= 2 && strncmp(in, "./", 2) == 0) {
+      r += 2;
+    } else if (in_s >= 3 && strncmp(in, "/./", 3) == 0) {
+      r += 2;
+    } else if (in_s == 2 && strncmp(in, "/.", 2) == 0) {
+      path[w++] = '/';
+      r = path_s;
+    } else if ((in_s >= 4 && strncmp(in, "/../", 4) == 0) ||
+               (in_s == 3 && strncmp(in, "/..", 3) == 0)) {
+      // drops the last output segment with its leading '/'
+      while (w > 0 && path[w - 1] != '/') {
+        w--;
+      }
+
+      w = w > 0 ? w - 1 : 0;
+
+      if (in_s == 3) {
+        path[w++] = '/';
+        r = path_s;
+      } else {
+        r += 3;
+      }
+    } else if ((in_s == 1 && in[0] == '.') || (in_s == 2 && strncmp(in, "..", 2) == 0)) {
+      r = path_s;
+    } else {
+      do {
+        path[w++] = path[r++];
+      } while (r < path_s && path[r] != '/');
+    }
+  }
+
+  return w;
+}
+
+/**
+ * @brief Appends n bytes of s to output, keeping room for the terminating NUL.
+ *
+ * @return false when output is too small.
+ */
+static bool __m3u8_uri_append(char* output, size_t size, size_t* offset, const char* s, size_t n) {
+  if (*offset + n + 1 > size) {
+    return false;
+  }
+
+  memcpy(&output[*offset], s, n);
+  *offset += n;
+
+  return true;
+}
+
+/**
+ * @brief Resolves a playlist reference against the uri it was loaded from
+ *        (RFC 3986 section 5.2).
+ *
+ * @param base      uri of the playlist containing the reference;
+ * @param reference uri found in the playlist;
+ * @param output    buffer where the resolved uri will be written;
+ * @param size      size of the output buffer.
+ *
+ * @return M3U8_STATUS_NO_ERROR    on success;
+ *         M3U8_STATUS_INVALID_ARG if an argument is NULL or output is too small.
+ */
+int m3u8_resolve_uri(const char* base, const char* reference, char* output, size_t size) {
+  int status = M3U8_STATUS_NO_ERROR;
+
+  uri_parts_t b;
+  uri_parts_t r;
+  uri_parts_t t;
+  size_t      offset = 0;
+  size_t      path = 0;
+  size_t      dir_s = 0;
+  bool        fits = true;
+
+  if (base == NULL || reference == NULL || output == NULL) {
+    RAISE_STATUS(M3U8_STATUS_INVALID_ARG, "Invalid argument base, reference and output cannot be NULL");
+  }
+
+  __m3u8_uri_split(base, &b);
+  __m3u8_uri_split(reference, &r);
+
+  // NOTE: the reference keeps whatever it defines, the base fills the rest
+  t = r.scheme != NULL ? r : b;
+  t.query = r.query;
+  t.query_s = r.query_s;
+  t.fragment = r.fragment;
+  t.fragment_s = r.fragment_s;
+
+  if (r.scheme == NULL && r.authority != NULL) {
+    t.authority = r.authority;
+    t.authority_s = r.authority_s;
+  }
+
+  if (r.scheme != NULL || r.authority != NULL || r.path_s > 0) {
+    t.path = r.path;
+    t.path_s = r.path_s;
+  } else if (r.query == NULL) {
+    t.query = b.query;
+    t.query_s = b.query_s;
+  }
+
+  if (t.scheme != NULL) {
+    fits = __m3u8_uri_append(output, size, &offset, t.scheme, t.scheme_s) &&
+           __m3u8_uri_append(output, size, &offset, ":", 1);
+  }
+
+  if (fits && t.authority != NULL) {
+    fits = __m3u8_uri_append(output, size, &offset, "//", 2) &&
+           __m3u8_uri_append(output, size, &offset, t.authority, t.authority_s);
+  }
+
+  path = offset;
+
+  // NOTE: a relative path is merged with the directory of base, which is
+  // "/" for a base made of an authority alone
+  if (fits && r.scheme == NULL && r.authority == NULL && r.path_s > 0 && r.path[0] != '/') {
+    if (b.authority != NULL && b.path_s == 0) {
+      fits = __m3u8_uri_append(output, size, &offset, "/", 1);
+    } else {
+      dir_s = b.path_s;
+
+      while (dir_s > 0 && b.path[dir_s - 1] != '/') {
+        dir_s--;
+      }
+
+      fits = __m3u8_uri_append(output, size, &offset, b.path, dir_s);
+    }
+  }
+
+  if (fits) {
+    fits = __m3u8_uri_append(output, size, &offset, t.path, t.path_s);
+  }
+
+  if (fits && t.path == r.path) {
+    offset = path + __m3u8_uri_remove_dots(&output[path], offset - path);
+  }
+
+  if (fits && t.query != NULL) {
+    fits = __m3u8_uri_append(output, size, &offset, t.query, t.query_s);
+  }
+
+  if (fits && t.fragment != NULL) {
+    fits = __m3u8_uri_append(output, size, &offset, t.fragment, t.fragment_s);
+  }
+
+  if (!fits) {
+    RAISE_STATUS(M3U8_STATUS_INVALID_ARG, "Output buffer too small to resolve %s", reference);
+  }
+
+  output[offset] = '\0';
+
+clean_up:
+  return status;
+}
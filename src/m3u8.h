@@ -6,6 +6,10 @@
 #define __H_M3U8__
 
 #include <stdbool.h>
+#include <stddef.h>
+
+#include "fetch.h"
+#include "transport.h"
 
 #define M3U8_STATUS_NO_ERROR        0x00
 #define M3U8_STATUS_INVALID_ARG     0x01
@@ -13,6 +17,10 @@
 #define M3U8_STATUS_INIT_CURL_ERROR 0x03
 #define M3U8_STATUS_FILE_IO_ERROR   0x04
 #define M3U8_STATUS_CURL_OP_ERROR   0x05
+#define M3U8_STATUS_TIMEOUT         0x06
+#define M3U8_STATUS_CANCELLED       0x07
+#define M3U8_STATUS_TRANSPORT_ERROR 0x08
+#define M3U8_STATUS_NOT_FOUND       0x09
 #define M3U8_STATUS_UNKNOWN_ERROR   0x99
 
 /** @brief type of M3U8 playlist: media or master */
@@ -37,29 +45,98 @@ typedef enum {
 /** @brief media types defined in ext-x-media */
 typedef enum { AUDIO, VIDEO, SUBTITLES, CLOSED_CAPTIONS } m3u8_media_type_e;
 
+/** @brief sub-range of a resource, from ext-x-byterange or a byterange attribute */
+typedef struct {
+  size_t offset; /**< first byte of the range */
+  size_t length; /**< bytes in the range, 0 for the whole resource */
+} m3u8_byte_range_t;
+
 /** @brief represents an ext-x-map directive */
 typedef struct {
-  char* uri;        /**< uri of the initialization segment */
-  char* byte_range; /**< optional byte range of the segment */
+  char*             uri;        /**< uri of the initialization segment */
+  m3u8_byte_range_t byte_range; /**< optional byte range of the segment */
 } ext_x_map_t;
 
 /** @brief represents an ext-x-key directive */
 typedef struct {
-  char* method;              /**< encryption method */
-  char* uri;                 /**< uri of the key */
-  char  iv;                  /**< initialization vector */
-  char* keyformat;           /**< key format */
-  char* key_format_versions; /**< key format versions */
+  char*         method;              /**< encryption method */
+  char*         uri;                 /**< uri of the key */
+  unsigned char iv[16];              /**< initialization vector (see m3u8_key_parse_iv) */
+  bool          has_iv;              /**< iv was given, else derived from the sequence */
+  char*         keyformat;           /**< key format */
+  char*         key_format_versions; /**< key format versions */
 } ext_x_key;
 
+/** @brief uri shared by numbered segments: prefix, decimal number, suffix */
+typedef struct {
+  char* prefix; /**< text before the number, not ending with a digit */
+  char* suffix; /**< text after the number, not starting with a digit */
+  int   width;  /**< digits of a zero padded number, 0 when not padded */
+} m3u8_uri_template_t;
+
+/** @brief represents a media segment: an extinf followed by its uri */
+typedef struct {
+  double             duration;          /**< segment duration in seconds */
+  char*              title;             /**< optional title from the extinf line */
+  char*              uri;               /**< uri of the media segment, NULL when
+                                             templated (see m3u8_timeline_uri) */
+  int                uri_template;      /**< 1 + index in m3u8_media_t.uri_templates,
+                                             0 for a literal uri */
+  bool               is_discontinuity;  /**< preceded by an ext-x-discontinuity */
+  unsigned long long uri_number;        /**< number completing the uri template */
+  ext_x_key*         key;               /**< ext-x-key in effect, NULL when clear */
+  m3u8_byte_range_t  byte_range;        /**< ext-x-byterange, length 0 when absent */
+  double             program_date_time; /**< ext-x-program-date-time in seconds since
+                                             the epoch, 0 when absent */
+} m3u8_media_segment_t;
+
+/** @brief represents an ext-x-daterange tag, dates in seconds since the epoch */
+typedef struct {
+  char*  id;               /**< unique identifier of the range */
+  char*  class_name;       /**< CLASS, NULL when absent */
+  double start_date;       /**< START-DATE */
+  double end_date;         /**< END-DATE, 0 when absent */
+  double duration;         /**< DURATION in seconds, -1 when absent */
+  double planned_duration; /**< PLANNED-DURATION in seconds, -1 when absent */
+  char*  scte35_cmd;       /**< SCTE35-CMD hexadecimal splice info, or NULL */
+  char*  scte35_out;       /**< SCTE35-OUT hexadecimal splice info, or NULL */
+  char*  scte35_in;        /**< SCTE35-IN hexadecimal splice info, or NULL */
+  bool   is_end_on_next;   /**< END-ON-NEXT=YES */
+  double end;              /**< effective end used by the index, may be INFINITY */
+} ext_x_daterange_t;
+
+/** @brief run of segments whose wall-clock time follows one program-date-time */
+typedef struct {
+  int    first;     /**< media sequence number of the tagged segment */
+  int    end;       /**< media sequence number after the last segment of the run */
+  double start;     /**< timeline position of the tagged segment, seconds */
+  double wallclock; /**< program-date-time of the tagged segment */
+} m3u8_timeline_anchor_t;
+
 /** @brief metadata for a media playlist */
 typedef struct {
-  int                  version;                 /**< playlist version */
-  bool                 is_independent_segments; /**< independent segments flag */
-  m3u8_playlist_type_e type;                    /**< playlist type (live or vod) */
-  int                  target_duration;         /**< target duration in seconds */
-  int                  media_sequence;          /**< media sequence number */
-  ext_x_map_t*         map;                     /**< initialization segment map */
+  int                     version;                 /**< playlist version */
+  bool                    is_independent_segments; /**< independent segments flag */
+  m3u8_playlist_type_e    type;                    /**< playlist type (live or vod) */
+  int                     target_duration;         /**< target duration in seconds */
+  int                     media_sequence;          /**< media sequence number */
+  ext_x_map_t*            map;                     /**< initialization segment map */
+  m3u8_media_segment_t*   segments;                /**< contiguous array of segments */
+  int                     segments_count;          /**< number of segments */
+  int                     segments_capacity;       /**< segments allocated by the timeline */
+  m3u8_uri_template_t*    uri_templates;           /**< uri patterns of numbered segments */
+  int                     uri_templates_count;     /**< number of uri templates */
+  int                     uri_templates_capacity;  /**< uri templates allocated */
+  double*                 starts;                  /**< timeline position of each segment */
+  m3u8_timeline_anchor_t* anchors;                 /**< program-date-time runs, in order */
+  int                     anchors_count;           /**< number of anchors */
+  int                     anchors_capacity;        /**< anchors allocated */
+  ext_x_daterange_t*      dateranges;              /**< ext-x-daterange tags by start date */
+  int                     dateranges_count;        /**< number of dateranges */
+  int                     dateranges_capacity;     /**< dateranges allocated */
+  double*                 daterange_ends;          /**< latest end below each node of a
+                                                        segment tree over dateranges */
+  int                     daterange_leaves;        /**< leaves of daterange_ends, a power of two */
 } m3u8_media_t;
 
 /** @brief represents an ext-x-start directive */
@@ -104,16 +181,57 @@ typedef struct _ext_x_stream_inf {
   char*  codecs;            /**< codec string */
   char*  video;             /**< video group id (se aplicável) */
   char*  hdcp_level;        /**< HDCP level: "TYPE-0" or "NONE" */
+  char*  pathway_id;        /**< content steering pathway, NULL for "." */
   char*  uri;               /**< uri for the media playlist */
+
+  int audio_group;           /**< audio group in m3u8_t.rendition_groups, -1 for none */
+  int video_group;           /**< video group in m3u8_t.rendition_groups, -1 for none */
+  int subtitles_group;       /**< subtitles group in m3u8_t.rendition_groups, -1 for none */
+  int closed_captions_group; /**< closed captions group in m3u8_t.rendition_groups, -1 for none */
 } ext_x_stream_inf_t;
 
+/** @brief entry of the bandwidth index of the variants */
+typedef struct {
+  int bandwidth; /**< peak bandwidth of the variant */
+  int index;     /**< position of the variant in m3u8_t.variants */
+} m3u8_variant_rank_t;
+
+/** @brief renditions sharing a TYPE and GROUP-ID, contiguous in m3u8_t.renditions */
+typedef struct {
+  const char*       group_id; /**< GROUP-ID, owned by the first rendition */
+  m3u8_media_type_e type;     /**< TYPE of the renditions */
+  int               first;    /**< index of the first rendition */
+  int               count;    /**< number of renditions */
+  int               fallback; /**< DEFAULT=YES rendition, else the first one */
+} m3u8_rendition_group_t;
+
+/** @brief represents an ext-x-content-steering tag */
+typedef struct {
+  char* server_uri; /**< uri of the steering manifest */
+  char* pathway_id; /**< pathway to start with, NULL to let the client pick */
+} ext_x_content_steering_t;
+
 /** @brief root structure for an m3u8 manifest */
 typedef struct {
   bool isigned;
 
-  int                 version;                 /**< playlist version */
-  bool                is_independent_segments; /**< flag for independent segments */
-  ext_x_stream_inf_t* x_stream_inf;            /**< stream information with segments */
+  int                       version;                 /**< playlist version */
+  bool                      is_independent_segments; /**< flag for independent segments */
+  ext_x_stream_inf_t*       x_stream_inf;            /**< list view of variants, playlist order */
+  ext_x_stream_inf_t*       variants;                /**< contiguous array of variants */
+  int                       variants_count;          /**< number of variants */
+  int                       variants_capacity;       /**< variants allocated */
+  m3u8_variant_rank_t*      by_bandwidth;            /**< variants by ascending bandwidth */
+  ext_x_media_type_t*       renditions;              /**< ext-x-media renditions, by group */
+  int                       renditions_count;        /**< number of renditions */
+  int                       renditions_capacity;     /**< renditions allocated */
+  m3u8_rendition_group_t*   rendition_groups;        /**< distinct TYPE and GROUP-ID pairs */
+  int                       rendition_groups_count;  /**< number of rendition groups */
+  int*                      rendition_hash;          /**< group indexes by hash, -1 when empty */
+  int                       rendition_hash_s;        /**< slots of rendition_hash, a power of two */
+  ext_x_content_steering_t* content_steering;        /**< ext-x-content-steering, or NULL */
+  bool                      is_interned;             /**< variant and rendition strings live in
+                                                          the intern table (see intern.h) */
 } m3u8_t;
 
 /**
@@ -141,6 +259,9 @@ int m3u8_destroy(m3u8_t* m3u8_ptr);
 /**
  * @brief Fetches and parses an M3U8 playlist from a remote URI.
  *
+ * The download gives up after M3U8_FETCH_DEFAULT_DEADLINE_MS; use
+ * m3u8_open_with_options for other limits.
+ *
  * @param uri        remote M3U8 URI (null-terminated string).
  * @param m3u8_ptr   pointer to a valid m3u8_t structure to be filled.
  *
@@ -148,11 +269,76 @@ int m3u8_destroy(m3u8_t* m3u8_ptr);
  *         M3U8_STATUS_INVALID_ARG     if uri or m3u8_ptr is NULL.
  *         M3U8_STATUS_INIT_CURL_ERROR if curl initialization or setup fails.
  *         M3U8_STATUS_CURL_OP_ERROR   if the download fails.
+ *         M3U8_STATUS_TIMEOUT         if the deadline passed.
  *         M3U8_STATUS_MEM_ALLOC_ERROR on memory allocation failure.
  *         M3U8_STATUS_UNKNOWN_ERROR   on unexpected failure.
  */
 int m3u8_open_from_remote(char* uri, m3u8_t* m3u8_ptr);
 
+/**
+ * @brief Fetches and parses an M3U8 playlist through a transport.
+ *
+ * When the transport hands back the whole body as a single NUL terminated
+ * chunk the stream marks writable, it is parsed in place; otherwise chunks
+ * are gathered into a private copy first, so regions registered with
+ * m3u8_transport_memory_put are never modified.
+ *
+ * @param transport  transport used to fetch uri (see transport.h).
+ * @param uri        M3U8 URI understood by the transport.
+ * @param m3u8_ptr   pointer to a valid m3u8_t structure to be filled.
+ *
+ * @return M3U8_STATUS_NO_ERROR        on success.
+ *         M3U8_STATUS_INVALID_ARG     if an argument is NULL.
+ *         M3U8_STATUS_NOT_FOUND       if the transport has nothing at uri.
+ *         M3U8_STATUS_TRANSPORT_ERROR if uri cannot be opened or read, or is empty.
+ *         M3U8_STATUS_MEM_ALLOC_ERROR on memory allocation failure.
+ */
+int m3u8_open_from_transport(m3u8_transport_t* transport, const char* uri, m3u8_t* m3u8_ptr);
+
+/**
+ * @brief Fetches and parses an M3U8 playlist within a deadline.
+ *
+ * The download may be hedged and cancelled as described by options (see
+ * fetch.h); it never outlives the deadline, so one slow edge cannot stall
+ * a refresh loop.
+ *
+ * @param transport  transport used to fetch uri (see transport.h).
+ * @param uri        M3U8 URI understood by the transport.
+ * @param options    deadline, hedging and cancellation, NULL for none.
+ * @param m3u8_ptr   pointer to a valid m3u8_t structure to be filled.
+ *
+ * @return M3U8_STATUS_NO_ERROR        on success.
+ *         M3U8_STATUS_INVALID_ARG     if an argument is NULL.
+ *         M3U8_STATUS_TRANSPORT_ERROR if every request failed or the body is empty.
+ *         M3U8_STATUS_TIMEOUT         if the deadline passed.
+ *         M3U8_STATUS_CANCELLED       if the cancellation token was triggered.
+ *         M3U8_STATUS_MEM_ALLOC_ERROR on memory allocation failure.
+ */
+int m3u8_open_with_options(m3u8_transport_t*           transport,
+                           const char*                 uri,
+                           const m3u8_fetch_options_t* options,
+                           m3u8_t*                     m3u8_ptr);
+
+/**
+ * @brief Resolves a playlist reference against the uri it was loaded from.
+ *
+ * Follows RFC 3986 section 5.2: absolute references are copied, network
+ * paths ("//host/...") keep the scheme of base, absolute paths keep its
+ * scheme and authority and relative paths replace the last path segment
+ * of base ("/" for a base without path). "." and ".." segments are removed
+ * and an empty reference keeps the path and query of base.
+ *
+ * @param base      uri of the playlist containing the reference.
+ * @param reference uri found in the playlist (e.g., segment4560.m4s).
+ * @param output    buffer where the resolved uri will be written.
+ * @param size      size of the output buffer.
+ *
+ * @return M3U8_STATUS_NO_ERROR    on success.
+ *         M3U8_STATUS_INVALID_ARG if an argument is NULL or output is too
+ *                                 small for the resolved uri.
+ */
+int m3u8_resolve_uri(const char* base, const char* reference, char* output, size_t size);
+
 /**
  * @brief Displays parsed stream information from the M3U8 playlist.
  *
@@ -0,0 +1,234 @@
+/**
+ * @file memory_usage.c
+ * @brief Memory accounting of parsed playlists and live library objects.
+ */
+
+#include "memory_usage.h"
+
+#include <string.h>
+
+#include "intern.h"
+#include "logger.h"
+
+static long __m3u8_memory_live[M3U8_MEMORY_OBJECTS] = {0};
+
+/**
+ * @brief Charges a heap block of bytes to category, and the allocator
+ *        rounding and header to overhead.
+ */
+static void __m3u8_memory_block(m3u8_memory_usage_t* usage, size_t* category, size_t bytes) {
+  size_t block = 0;
+
+  if (bytes == 0) {
+    return;
+  }
+
+  block = (bytes + M3U8_MEMORY_BLOCK_HEADER + M3U8_MEMORY_ALIGNMENT - 1) & ~(size_t)(M3U8_MEMORY_ALIGNMENT - 1);
+  block = block < 2 * M3U8_MEMORY_ALIGNMENT ? 2 * M3U8_MEMORY_ALIGNMENT : block;
+
+  *category += bytes;
+  usage->overhead += block - bytes;
+}
+
+static void __m3u8_memory_string(m3u8_memory_usage_t* usage, const char* string, bool is_interned) {
+  if (string == NULL) {
+    return;
+  }
+
+  if (is_interned) {
+    usage->interned += strlen(string) + 1;
+  } else {
+    __m3u8_memory_block(usage, &usage->strings, strlen(string) + 1);
+  }
+}
+
+static void __m3u8_memory_total(m3u8_memory_usage_t* usage) {
+  usage->total = usage->strings + usage->attributes + usage->variants + usage->renditions +
+                 usage->segments + usage->overhead;
+}
+
+int m3u8_memory_usage(const m3u8_t* m3u8_ptr, m3u8_memory_usage_t* usage) {
+  int status = M3U8_MEMORY_STATUS_NO_ERROR;
+
+  bool is_interned = false;
+
+  if (m3u8_ptr == NULL || usage == NULL) {
+    RAISE(M3U8_MEMORY_STATUS_INVALID_ARG, "Invalid arg m3u8_ptr or usage (null)");
+  }
+
+  memset(usage, 0, sizeof(m3u8_memory_usage_t));
+  is_interned = m3u8_ptr->is_interned;
+
+  __m3u8_memory_block(usage, &usage->overhead, sizeof(m3u8_t));
+
+  if (m3u8_ptr->variants != NULL) {
+    __m3u8_memory_block(usage, &usage->variants, m3u8_ptr->variants_capacity * sizeof(ext_x_stream_inf_t));
+  }
+
+  if (m3u8_ptr->by_bandwidth != NULL) {
+    __m3u8_memory_block(usage, &usage->overhead, m3u8_ptr->variants_count * sizeof(m3u8_variant_rank_t));
+  }
+
+  for (int i = 0; i < m3u8_ptr->variants_count; i++) {
+    const ext_x_stream_inf_t* variant = &m3u8_ptr->variants[i];
+
+    __m3u8_memory_string(usage, variant->audio, is_interned);
+    __m3u8_memory_string(usage, variant->subtitles, is_interned);
+    __m3u8_memory_string(usage, variant->closed_captions, is_interned);
+    __m3u8_memory_string(usage, variant->resolution, is_interned);
+    __m3u8_memory_string(usage, variant->codecs, is_interned);
+    __m3u8_memory_string(usage, variant->video, is_interned);
+    __m3u8_memory_string(usage, variant->hdcp_level, is_interned);
+    __m3u8_memory_string(usage, variant->pathway_id, is_interned);
+    __m3u8_memory_string(usage, variant->uri, is_interned);
+  }
+
+  if (m3u8_ptr->renditions != NULL) {
+    __m3u8_memory_block(usage, &usage->renditions, m3u8_ptr->renditions_capacity * sizeof(ext_x_media_type_t));
+  }
+
+  // NOTE: the group index is sized after the renditions, see m3u8_rendition_index
+  if (m3u8_ptr->rendition_groups != NULL) {
+    __m3u8_memory_block(usage, &usage->overhead,
+                        (m3u8_ptr->renditions_count + 1) * sizeof(m3u8_rendition_group_t));
+  }
+
+  if (m3u8_ptr->rendition_hash != NULL) {
+    __m3u8_memory_block(usage, &usage->overhead, m3u8_ptr->rendition_hash_s * sizeof(int));
+  }
+
+  for (int i = 0; i < m3u8_ptr->renditions_count; i++) {
+    const ext_x_media_type_t* rendition = &m3u8_ptr->renditions[i];
+
+    __m3u8_memory_string(usage, rendition->group_id, is_interned);
+    __m3u8_memory_string(usage, rendition->language, is_interned);
+    __m3u8_memory_string(usage, rendition->name, is_interned);
+    __m3u8_memory_string(usage, rendition->instream_id, is_interned);
+    __m3u8_memory_string(usage, rendition->assoc_language, is_interned);
+    __m3u8_memory_string(usage, rendition->channels, is_interned);
+    __m3u8_memory_string(usage, rendition->uri, is_interned);
+  }
+
+  if (m3u8_ptr->content_steering != NULL) {
+    __m3u8_memory_block(usage, &usage->attributes, sizeof(ext_x_content_steering_t));
+    __m3u8_memory_string(usage, m3u8_ptr->content_steering->server_uri, false);
+    __m3u8_memory_string(usage, m3u8_ptr->content_steering->pathway_id, false);
+  }
+
+  __m3u8_memory_total(usage);
+
+clean_up:
+  return status;
+}
+
+int m3u8_memory_media_usage(const m3u8_media_t* media, m3u8_memory_usage_t* usage) {
+  int status = M3U8_MEMORY_STATUS_NO_ERROR;
+
+  const ext_x_key* key = NULL;
+  int              capacity = 0;
+
+  if (media == NULL || usage == NULL) {
+    RAISE(M3U8_MEMORY_STATUS_INVALID_ARG, "Invalid arg media or usage (null)");
+  }
+
+  memset(usage, 0, sizeof(m3u8_memory_usage_t));
+  __m3u8_memory_block(usage, &usage->overhead, sizeof(m3u8_media_t));
+
+  if (media->map != NULL) {
+    __m3u8_memory_block(usage, &usage->attributes, sizeof(ext_x_map_t));
+    __m3u8_memory_string(usage, media->map->uri, false);
+  }
+
+  // NOTE: segments handed over without the timeline have no capacity recorded
+  capacity = media->segments_capacity > media->segments_count ? media->segments_capacity
+                                                              : media->segments_count;
+
+  if (media->segments != NULL) {
+    __m3u8_memory_block(usage, &usage->segments, capacity * sizeof(m3u8_media_segment_t));
+  }
+
+  if (media->starts != NULL) {
+    __m3u8_memory_block(usage, &usage->segments, capacity * sizeof(double));
+  }
+
+  if (media->anchors != NULL) {
+    __m3u8_memory_block(usage, &usage->segments, media->anchors_capacity * sizeof(m3u8_timeline_anchor_t));
+  }
+
+  if (media->uri_templates != NULL) {
+    __m3u8_memory_block(usage, &usage->segments, media->uri_templates_capacity * sizeof(m3u8_uri_template_t));
+  }
+
+  for (int i = 0; i < media->uri_templates_count; i++) {
+    __m3u8_memory_string(usage, media->uri_templates[i].prefix, false);
+    __m3u8_memory_string(usage, media->uri_templates[i].suffix, false);
+  }
+
+  for (int i = 0; i < media->segments_count; i++) {
+    const m3u8_media_segment_t* segment = &media->segments[i];
+
+    __m3u8_memory_string(usage, segment->title, false);
+    __m3u8_memory_string(usage, segment->uri, false);
+
+    // NOTE: a key stays in effect for the following segments until the next one
+    if (segment->key != NULL && segment->key != key) {
+      __m3u8_memory_block(usage, &usage->attributes, sizeof(ext_x_key));
+      __m3u8_memory_string(usage, segment->key->method, false);
+      __m3u8_memory_string(usage, segment->key->uri, false);
+      __m3u8_memory_string(usage, segment->key->keyformat, false);
+      __m3u8_memory_string(usage, segment->key->key_format_versions, false);
+    }
+
+    key = segment->key;
+  }
+
+  if (media->dateranges != NULL) {
+    __m3u8_memory_block(usage, &usage->attributes, media->dateranges_capacity * sizeof(ext_x_daterange_t));
+  }
+
+  if (media->daterange_ends != NULL) {
+    __m3u8_memory_block(usage, &usage->overhead, 2 * media->daterange_leaves * sizeof(double));
+  }
+
+  for (int i = 0; i < media->dateranges_count; i++) {
+    const ext_x_daterange_t* daterange = &media->dateranges[i];
+
+    __m3u8_memory_string(usage, daterange->id, false);
+    __m3u8_memory_string(usage, daterange->class_name, false);
+    __m3u8_memory_string(usage, daterange->scte35_cmd, false);
+    __m3u8_memory_string(usage, daterange->scte35_out, false);
+    __m3u8_memory_string(usage, daterange->scte35_in, false);
+  }
+
+  __m3u8_memory_total(usage);
+
+clean_up:
+  return status;
+}
+
+int m3u8_memory_counters(m3u8_memory_counters_t* counters) {
+  int status = M3U8_MEMORY_STATUS_NO_ERROR;
+
+  m3u8_intern_stats_t intern = {0};
+
+  if (counters == NULL) {
+    RAISE(M3U8_MEMORY_STATUS_INVALID_ARG, "Invalid arg counters (null)");
+  }
+
+  for (int i = 0; i < M3U8_MEMORY_OBJECTS; i++) {
+    counters->live[i] = __atomic_load_n(&__m3u8_memory_live[i], __ATOMIC_RELAXED);
+  }
+
+  m3u8_intern_stats(&intern);
+  counters->interned_strings = intern.strings;
+  counters->interned_bytes = intern.bytes;
+
+clean_up:
+  return status;
+}
+
+void m3u8_memory_count(m3u8_memory_object_e object, int delta) {
+  if (object >= 0 && object < M3U8_MEMORY_OBJECTS) {
+    __atomic_add_fetch(&__m3u8_memory_live[object], delta, __ATOMIC_RELAXED);
+  }
+}
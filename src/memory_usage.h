@@ -0,0 +1,133 @@
+/**
+ * @file memory_usage.h
+ * @brief Memory accounting of parsed playlists and live library objects.
+ */
+
+#ifndef __H_M3U8_MEMORY_USAGE__
+#define __H_M3U8_MEMORY_USAGE__
+
+#include <stddef.h>
+
+#include "m3u8.h"
+
+/**
+ * @brief Operation completed successfully.
+ *
+ * @details Returned when a function completes without error.
+ */
+#define M3U8_MEMORY_STATUS_NO_ERROR      0x09000000
+
+/**
+ * @brief Invalid argument received.
+ *
+ * @details Returned when a parameter is NULL or otherwise invalid.
+ */
+#define M3U8_MEMORY_STATUS_INVALID_ARG   (M3U8_MEMORY_STATUS_NO_ERROR + 0x01)
+
+/**
+ * @brief Unknown error occurred.
+ *
+ * @details Returned when an unexpected or undefined error occurs.
+ */
+#define M3U8_MEMORY_STATUS_UNKNOWN_ERROR (M3U8_MEMORY_STATUS_NO_ERROR + 0x99)
+
+/**
+ * @def M3U8_MEMORY_ALIGNMENT
+ * @brief Granularity of heap blocks assumed when estimating allocator
+ *        bookkeeping.
+ */
+#define M3U8_MEMORY_ALIGNMENT            16
+
+/**
+ * @def M3U8_MEMORY_BLOCK_HEADER
+ * @brief Bytes the allocator keeps in front of every heap block.
+ */
+#define M3U8_MEMORY_BLOCK_HEADER         sizeof(size_t)
+
+/**
+ * @brief bytes held by one playlist, by category
+ *
+ * Arrays are counted by capacity, not by count, since that is what they
+ * hold on to. Each allocation is charged to its category for the bytes
+ * requested; the rounding and header added by the allocator go to overhead.
+ */
+typedef struct {
+  size_t strings;    /**< owned strings, terminators included */
+  size_t attributes; /**< tag structures: keys, map, content steering, dateranges */
+  size_t variants;   /**< variant array */
+  size_t renditions; /**< rendition array */
+  size_t segments;   /**< segment array, timeline positions, anchors and uri templates */
+  size_t overhead;   /**< root structure, lookup indexes and allocator bookkeeping */
+  size_t interned;   /**< interned strings referenced, shared so not in total */
+  size_t total;      /**< sum of every category but interned */
+} m3u8_memory_usage_t;
+
+/** @brief objects counted by the library while they are alive */
+typedef enum {
+  M3U8_MEMORY_PLAYLIST,   /**< m3u8_t, from m3u8_create to m3u8_destroy */
+  M3U8_MEMORY_SNAPSHOT,   /**< m3u8_snapshot_t, until the last release */
+  M3U8_MEMORY_PUBLISHER,  /**< m3u8_publisher_t */
+  M3U8_MEMORY_TRANSPORT,  /**< m3u8_transport_t, the default one included */
+  M3U8_MEMORY_PREFETCHER, /**< m3u8_prefetch_t */
+  M3U8_MEMORY_OBJECTS     /**< number of counted kinds */
+} m3u8_memory_object_e;
+
+/** @brief process-wide counters, read with atomic loads and no lock */
+typedef struct {
+  long   live[M3U8_MEMORY_OBJECTS]; /**< live objects by m3u8_memory_object_e */
+  size_t interned_strings;          /**< distinct strings in the intern table */
+  size_t interned_bytes;            /**< bytes of those strings */
+} m3u8_memory_counters_t;
+
+/**
+ * @brief Reports what a master playlist holds.
+ *
+ * @details Walks the variants and renditions once, calling strlen on their
+ *          strings; nothing is allocated and no lock is taken, so it can be
+ *          run periodically over every playlist held. m3u8_ptr must not be
+ *          modified meanwhile (e.g., a published snapshot).
+ *
+ * @param[in]  m3u8_ptr Playlist allocated by m3u8_create.
+ * @param[out] usage    Bytes by category.
+ *
+ * @retval M3U8_MEMORY_STATUS_NO_ERROR    On success.
+ * @retval M3U8_MEMORY_STATUS_INVALID_ARG If an argument is NULL.
+ */
+int m3u8_memory_usage(const m3u8_t* m3u8_ptr, m3u8_memory_usage_t* usage);
+
+/**
+ * @brief Reports what a media playlist holds.
+ *
+ * @details Segments sharing an ext-x-key count it once per run. The
+ *          m3u8_media_t itself is counted as if it were heap allocated.
+ *
+ * @param[in]  media Media playlist.
+ * @param[out] usage Bytes by category.
+ *
+ * @retval M3U8_MEMORY_STATUS_NO_ERROR    On success.
+ * @retval M3U8_MEMORY_STATUS_INVALID_ARG If an argument is NULL.
+ */
+int m3u8_memory_media_usage(const m3u8_media_t* media, m3u8_memory_usage_t* usage);
+
+/**
+ * @brief Reads the process-wide counters.
+ *
+ * @param[out] counters Live objects and intern table size.
+ *
+ * @retval M3U8_MEMORY_STATUS_NO_ERROR    On success.
+ * @retval M3U8_MEMORY_STATUS_INVALID_ARG If counters is NULL.
+ */
+int m3u8_memory_counters(m3u8_memory_counters_t* counters);
+
+/**
+ * @brief Records an object of the library being created or destroyed.
+ *
+ * @details Called by the modules owning the object, with 1 after it is
+ *          allocated and -1 before it is freed.
+ *
+ * @param[in] object Kind of object.
+ * @param[in] delta  1 or -1.
+ */
+void m3u8_memory_count(m3u8_memory_object_e object, int delta);
+
+#endif  // __H_M3U8_MEMORY_USAGE__
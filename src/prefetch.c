@@ -0,0 +1,498 @@
+/**
+ * @file prefetch.c
+ * @brief Bounded look-ahead segment downloader backed by a recycled buffer ring.
+ */
+
+#include "prefetch.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "key.h"
+#include "logger.h"
+#include "memory_usage.h"
+#include "range.h"
+#include "timeline.h"
+
+#define M3U8_PREFETCH_SLOT_FREE    0
+#define M3U8_PREFETCH_SLOT_LOADING 1
+#define M3U8_PREFETCH_SLOT_READY   2
+#define M3U8_PREFETCH_SLOT_FAILED  3
+
+#define M3U8_PREFETCH_URI_SIZE     2048
+#define M3U8_PREFETCH_AES_128      "AES-128"
+
+/** @brief transport request bound to one ring buffer */
+typedef struct {
+  m3u8_transport_request_t request;                         /**< request in flight */
+  char                     uri[M3U8_PREFETCH_URI_SIZE];     /**< resolved segment uri */
+  char                     key_uri[M3U8_PREFETCH_URI_SIZE]; /**< resolved key uri, empty if clear */
+  m3u8_prefetch_t*         prefetch;                        /**< owning prefetcher */
+  m3u8_prefetch_buffer_t*  buffer;                          /**< buffer being filled */
+  int                      count;                           /**< segments served, 0 if merged */
+  size_t                   received;                        /**< window bytes already routed */
+} m3u8_prefetch_slot_t;
+
+struct m3u8_prefetch {
+  m3u8_media_t*           media;     /**< playlist whose segments are fetched */
+  char*                   base_uri;  /**< uri used to resolve segment uris */
+  int                     depth;     /**< number of slots in the ring */
+  m3u8_prefetch_buffer_t* ring;      /**< recycled segment buffers */
+  m3u8_prefetch_slot_t*   slots;     /**< one reusable request per buffer */
+  m3u8_transport_t*       transport; /**< transport segments are fetched with */
+
+  pthread_mutex_t mutex;       /**< guards cursor, next and slot states */
+  pthread_cond_t  ready;       /**< signaled when a slot finishes */
+  bool            is_started;  /**< scheduling has begun */
+  bool            is_stopping; /**< in-flight requests must abort */
+
+  int                     cursor; /**< next segment handed to the consumer */
+  int                     next;   /**< next segment to be scheduled */
+  m3u8_prefetch_buffer_t* held;   /**< buffer currently owned by consumer */
+};
+
+/**
+ * @brief Appends bytes to a ring buffer, growing it by doubling.
+ *
+ * @return 0 on success, nonzero on memory allocation failure.
+ */
+static int __m3u8_prefetch_append(m3u8_prefetch_buffer_t* buffer, const char* data, size_t size) {
+  if (buffer->size + size > buffer->capacity) {
+    size_t capacity = buffer->capacity > 0 ? buffer->capacity : 4096;
+    char*  grown = NULL;
+
+    while (capacity < buffer->size + size) {
+      capacity *= 2;
+    }
+
+    if ((grown = realloc(buffer->data, capacity)) == NULL) {
+      ERROR("Out of memory while growing segment buffer");
+      return 1;
+    }
+
+    buffer->data = grown;
+    buffer->capacity = capacity;
+  }
+
+  memcpy(buffer->data + buffer->size, data, size);
+  buffer->size += size;
+
+  return 0;
+}
+
+/**
+ * @brief Transport sink appending a segment chunk to its slot buffer.
+ *
+ * @details A merged Range request spans the buffers of the consecutive
+ *          slots it serves; each chunk is cut at the segment boundaries and
+ *          every piece lands in the buffer of the segment owning it.
+ *
+ * @param data     pointer to the incoming data buffer;
+ * @param size     number of bytes in data;
+ * @param userdata pointer to the m3u8_prefetch_slot_t being filled.
+ *
+ * @return 0 to continue, nonzero on memory allocation failure or shutdown.
+ */
+static int __m3u8_prefetch_write(const char* data, size_t size, void* userdata) {
+  m3u8_prefetch_slot_t* slot = (m3u8_prefetch_slot_t*)userdata;
+  m3u8_prefetch_t*      prefetch = slot->prefetch;
+  size_t                received = slot->received;
+
+  if (__atomic_load_n(&prefetch->is_stopping, __ATOMIC_RELAXED)) {
+    return 1;
+  }
+
+  if (slot->count <= 1) {
+    return __m3u8_prefetch_append(slot->buffer, data, size);
+  }
+
+  slot->received += size;
+
+  for (int i = 0; i < slot->count; i++) {
+    m3u8_prefetch_buffer_t*  buffer = &prefetch->ring[(slot->buffer->index + i) % prefetch->depth];
+    const m3u8_byte_range_t* range = &prefetch->media->segments[buffer->index].byte_range;
+    size_t                   start = range->offset - slot->request.range_offset;
+    size_t                   end = start + range->length;
+
+    start = start > received ? start : received;
+    end = end < received + size ? end : received + size;
+
+    if (start < end && __m3u8_prefetch_append(buffer, data + start - received, end - start) != 0) {
+      return 1;
+    }
+  }
+
+  return 0;
+}
+
+/**
+ * @brief Transport completion marking the slot ready or failed.
+ */
+static void __m3u8_prefetch_done(m3u8_transport_request_t* request, int status, void* userdata) {
+  m3u8_prefetch_slot_t* slot = (m3u8_prefetch_slot_t*)userdata;
+  m3u8_prefetch_t*      prefetch = slot->prefetch;
+
+  (void)request;
+
+  pthread_mutex_lock(&prefetch->mutex);
+
+  for (int i = 0; i < slot->count; i++) {
+    m3u8_prefetch_buffer_t* buffer = &prefetch->ring[(slot->buffer->index + i) % prefetch->depth];
+
+    if (status == M3U8_TRANSPORT_STATUS_NO_ERROR) {
+      buffer->state = M3U8_PREFETCH_SLOT_READY;
+    } else {
+      ERROR("Segment %d download failed (0x%x)", buffer->index, status);
+      buffer->state = M3U8_PREFETCH_SLOT_FAILED;
+    }
+  }
+
+  pthread_cond_broadcast(&prefetch->ready);
+  pthread_mutex_unlock(&prefetch->mutex);
+}
+
+/**
+ * @brief Decrypts an AES-128 segment in place once the consumer acquired it.
+ *
+ * @details Runs on the consumer thread so waiting on the key cache never
+ *          stalls the transport delivering that very key.
+ *
+ * @param prefetch prefetcher handle;
+ * @param slot     slot holding the downloaded ciphertext.
+ *
+ * @return M3U8_PREFETCH_STATUS_NO_ERROR    on success;
+ *         M3U8_PREFETCH_STATUS_FETCH_ERROR if the key or the ciphertext is bad.
+ */
+static int __m3u8_prefetch_decrypt(m3u8_prefetch_t* prefetch, m3u8_prefetch_slot_t* slot) {
+  m3u8_prefetch_buffer_t* buffer = slot->buffer;
+  m3u8_media_segment_t*   segment = &prefetch->media->segments[buffer->index];
+  unsigned char           key[M3U8_AES_BLOCK_SIZE];
+  unsigned char           iv[M3U8_AES_BLOCK_SIZE];
+  uint64_t                sequence = (uint64_t)prefetch->media->media_sequence + buffer->index;
+
+  if (m3u8_key_fetch(prefetch->transport, slot->key_uri, M3U8_FETCH_DEFAULT_DEADLINE_MS, NULL,
+                     key) != M3U8_KEY_STATUS_NO_ERROR ||
+      m3u8_key_segment_iv(segment->key, sequence, iv) != M3U8_KEY_STATUS_NO_ERROR) {
+    return M3U8_PREFETCH_STATUS_FETCH_ERROR;
+  }
+
+  if (m3u8_aes_decrypt(key, iv, (unsigned char*)buffer->data, buffer->size, &buffer->size) !=
+      M3U8_AES_STATUS_NO_ERROR) {
+    ERROR("Segment %d could not be decrypted", buffer->index);
+    return M3U8_PREFETCH_STATUS_FETCH_ERROR;
+  }
+
+  return M3U8_PREFETCH_STATUS_NO_ERROR;
+}
+
+/**
+ * @brief Hands free ring slots to the segments ahead of the cursor.
+ *
+ * @details Slots are claimed under the prefetch mutex but submitted after it
+ *          is released, since synchronous transports complete the request
+ *          inside m3u8_transport_submit. A segment is only scheduled once the
+ *          consumer released the segment that previously used its slot, which
+ *          is what throttles the downloads when the consumer falls behind.
+ *          Consecutive claimed segments whose byte ranges follow each other
+ *          in the same resource are fetched with one merged Range request,
+ *          owned by the slot of the first of them.
+ *
+ * @param prefetch prefetcher handle.
+ */
+static void __m3u8_prefetch_schedule(m3u8_prefetch_t* prefetch) {
+  m3u8_prefetch_slot_t* claimed[M3U8_PREFETCH_MAX_DEPTH];
+  m3u8_prefetch_slot_t* leader = NULL;
+  int                   claimed_s = 0;
+
+  pthread_mutex_lock(&prefetch->mutex);
+
+  while (!prefetch->is_stopping && prefetch->next < prefetch->media->segments_count &&
+         prefetch->next < prefetch->cursor + prefetch->depth) {
+    int                     index = prefetch->next % prefetch->depth;
+    m3u8_prefetch_buffer_t* buffer = &prefetch->ring[index];
+    m3u8_prefetch_slot_t*   slot = &prefetch->slots[index];
+    m3u8_media_segment_t*   segment = &prefetch->media->segments[prefetch->next];
+    char                    uri[M3U8_PREFETCH_URI_SIZE];
+
+    if (buffer->state != M3U8_PREFETCH_SLOT_FREE) {
+      break;
+    }
+
+    buffer->index = prefetch->next++;
+    buffer->size = 0;
+
+    if (m3u8_timeline_uri(prefetch->media, buffer->index, uri, sizeof(uri)) != M3U8_TIMELINE_STATUS_NO_ERROR ||
+        m3u8_resolve_uri(prefetch->base_uri, uri, slot->uri, sizeof(slot->uri)) != M3U8_STATUS_NO_ERROR) {
+      buffer->state = M3U8_PREFETCH_SLOT_FAILED;
+      pthread_cond_broadcast(&prefetch->ready);
+      continue;
+    }
+
+    slot->key_uri[0] = 0;
+
+    if (segment->key != NULL && segment->key->method != NULL &&
+        strcmp(segment->key->method, M3U8_PREFETCH_AES_128) == 0 &&
+        (segment->key->uri == NULL ||
+         m3u8_resolve_uri(prefetch->base_uri, segment->key->uri, slot->key_uri,
+                          sizeof(slot->key_uri)) != M3U8_STATUS_NO_ERROR)) {
+      buffer->state = M3U8_PREFETCH_SLOT_FAILED;
+      pthread_cond_broadcast(&prefetch->ready);
+      continue;
+    }
+
+    buffer->state = M3U8_PREFETCH_SLOT_LOADING;
+    slot->count = 1;
+    slot->received = 0;
+    slot->request.range_offset = segment->byte_range.offset;
+    slot->request.range_length = segment->byte_range.length;
+
+    if (claimed_s > 0 && leader->buffer->index + leader->count == buffer->index &&
+        m3u8_range_is_mergeable(&prefetch->media->segments[buffer->index - 1], segment, 0)) {
+      leader->request.range_length += segment->byte_range.length;
+      leader->count++;
+      slot->count = 0;
+    } else {
+      leader = slot;
+    }
+
+    claimed[claimed_s++] = slot;
+  }
+
+  pthread_mutex_unlock(&prefetch->mutex);
+
+  for (int i = 0; i < claimed_s; i++) {
+    // NOTE: a rotated key starts downloading alongside the first segment using it
+    if (claimed[i]->key_uri[0] != 0) {
+      m3u8_key_prefetch(prefetch->transport, claimed[i]->key_uri);
+    }
+
+    if (claimed[i]->count == 0) {
+      continue;
+    }
+
+    if (m3u8_transport_submit(prefetch->transport, &claimed[i]->request) !=
+        M3U8_TRANSPORT_STATUS_NO_ERROR) {
+      __m3u8_prefetch_done(&claimed[i]->request, M3U8_TRANSPORT_STATUS_IO_ERROR, claimed[i]);
+    }
+  }
+}
+
+int m3u8_prefetch_create(m3u8_prefetch_t**             prefetch_ptr,
+                         m3u8_media_t*                 media,
+                         const char*                   base_uri,
+                         const m3u8_prefetch_config_t* config) {
+  int status = M3U8_PREFETCH_STATUS_NO_ERROR;
+
+  m3u8_prefetch_t* prefetch = NULL;
+  int              depth = config != NULL ? config->depth : 0;
+  size_t           buffer_size = config != NULL ? config->buffer_size : 0;
+
+  if (prefetch_ptr == NULL || *prefetch_ptr != NULL) {
+    RAISE(M3U8_PREFETCH_STATUS_INVALID_ARG, "Invalid arg prefetch_ptr, must point to NULL");
+  }
+
+  if (media == NULL || base_uri == NULL) {
+    RAISE(M3U8_PREFETCH_STATUS_INVALID_ARG, "Invalid arg media or base_uri (null)");
+  }
+
+  if (depth < 0 || depth > M3U8_PREFETCH_MAX_DEPTH) {
+    RAISE(M3U8_PREFETCH_STATUS_INVALID_ARG, "Invalid arg depth (%d)", depth);
+  }
+
+  depth = depth == 0 ? M3U8_PREFETCH_DEFAULT_DEPTH : depth;
+
+  if ((prefetch = calloc(1, sizeof(m3u8_prefetch_t))) == NULL) {
+    RAISE(M3U8_PREFETCH_STATUS_MEM_ALLOC_ERROR, "Unable to allocate prefetcher");
+  }
+
+  m3u8_memory_count(M3U8_MEMORY_PREFETCHER, 1);
+
+  pthread_mutex_init(&prefetch->mutex, NULL);
+  pthread_cond_init(&prefetch->ready, NULL);
+
+  prefetch->media = media;
+  prefetch->depth = depth;
+  prefetch->base_uri = strdup(base_uri);
+  prefetch->ring = calloc(depth, sizeof(m3u8_prefetch_buffer_t));
+  prefetch->slots = calloc(depth, sizeof(m3u8_prefetch_slot_t));
+  prefetch->transport = config != NULL ? config->transport : NULL;
+
+  if (prefetch->base_uri == NULL || prefetch->ring == NULL || prefetch->slots == NULL) {
+    RAISE(M3U8_PREFETCH_STATUS_MEM_ALLOC_ERROR, "Unable to allocate the buffer ring");
+  }
+
+  if (prefetch->transport == NULL &&
+      m3u8_transport_default(&prefetch->transport) != M3U8_TRANSPORT_STATUS_NO_ERROR) {
+    RAISE(M3U8_PREFETCH_STATUS_INIT_ERROR, "Unable to obtain the default transport");
+  }
+
+  for (int i = 0; i < depth; i++) {
+    m3u8_prefetch_buffer_t* buffer = &prefetch->ring[i];
+    m3u8_prefetch_slot_t*   slot = &prefetch->slots[i];
+
+    buffer->index = -1;
+
+    if (buffer_size > 0 && (buffer->data = malloc(buffer_size)) == NULL) {
+      RAISE(M3U8_PREFETCH_STATUS_MEM_ALLOC_ERROR, "Unable to allocate segment buffer");
+    }
+
+    buffer->capacity = buffer->data != NULL ? buffer_size : 0;
+
+    slot->prefetch = prefetch;
+    slot->buffer = buffer;
+    slot->request.uri = slot->uri;
+    slot->request.write = __m3u8_prefetch_write;
+    slot->request.done = __m3u8_prefetch_done;
+    slot->request.userdata = slot;
+  }
+
+  *prefetch_ptr = prefetch;
+
+clean_up:
+  if (status != M3U8_PREFETCH_STATUS_NO_ERROR && prefetch != NULL) {
+    m3u8_prefetch_destroy(prefetch);
+  }
+
+  return status;
+}
+
+int m3u8_prefetch_start(m3u8_prefetch_t* prefetch, int cursor) {
+  int status = M3U8_PREFETCH_STATUS_NO_ERROR;
+
+  if (prefetch == NULL) {
+    RAISE(M3U8_PREFETCH_STATUS_INVALID_ARG, "Invalid arg prefetch (null)");
+  }
+
+  if (prefetch->is_started) {
+    RAISE(M3U8_PREFETCH_STATUS_INVALID_ARG, "Prefetcher was already started");
+  }
+
+  if (cursor < 0 || cursor > prefetch->media->segments_count) {
+    RAISE(M3U8_PREFETCH_STATUS_INVALID_ARG, "Invalid arg cursor (%d)", cursor);
+  }
+
+  prefetch->cursor = cursor;
+  prefetch->next = cursor;
+  prefetch->is_started = true;
+
+  __m3u8_prefetch_schedule(prefetch);
+
+clean_up:
+  return status;
+}
+
+int m3u8_prefetch_acquire(m3u8_prefetch_t* prefetch, m3u8_prefetch_buffer_t** buffer) {
+  int status = M3U8_PREFETCH_STATUS_NO_ERROR;
+
+  m3u8_prefetch_buffer_t* slot = NULL;
+
+  if (prefetch == NULL || buffer == NULL) {
+    RAISE(M3U8_PREFETCH_STATUS_INVALID_ARG, "Invalid arg prefetch or buffer (null)");
+  }
+
+  if (!prefetch->is_started) {
+    RAISE(M3U8_PREFETCH_STATUS_INVALID_ARG, "Prefetcher was not started");
+  }
+
+  pthread_mutex_lock(&prefetch->mutex);
+
+  if (prefetch->held != NULL) {
+    pthread_mutex_unlock(&prefetch->mutex);
+    RAISE(M3U8_PREFETCH_STATUS_INVALID_ARG, "Release the held buffer before acquiring");
+  }
+
+  if (prefetch->cursor >= prefetch->media->segments_count) {
+    pthread_mutex_unlock(&prefetch->mutex);
+    status = M3U8_PREFETCH_STATUS_END;
+    goto clean_up;
+  }
+
+  slot = &prefetch->ring[prefetch->cursor % prefetch->depth];
+
+  while (slot->index != prefetch->cursor || slot->state == M3U8_PREFETCH_SLOT_LOADING ||
+         slot->state == M3U8_PREFETCH_SLOT_FREE) {
+    pthread_cond_wait(&prefetch->ready, &prefetch->mutex);
+  }
+
+  if (slot->state == M3U8_PREFETCH_SLOT_FAILED) {
+    status = M3U8_PREFETCH_STATUS_FETCH_ERROR;
+  }
+
+  prefetch->held = slot;
+  *buffer = slot;
+
+  pthread_mutex_unlock(&prefetch->mutex);
+
+  if (status == M3U8_PREFETCH_STATUS_NO_ERROR &&
+      prefetch->slots[slot - prefetch->ring].key_uri[0] != 0) {
+    status = __m3u8_prefetch_decrypt(prefetch, &prefetch->slots[slot - prefetch->ring]);
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_prefetch_release(m3u8_prefetch_t* prefetch, m3u8_prefetch_buffer_t* buffer) {
+  int status = M3U8_PREFETCH_STATUS_NO_ERROR;
+
+  if (prefetch == NULL || buffer == NULL) {
+    RAISE(M3U8_PREFETCH_STATUS_INVALID_ARG, "Invalid arg prefetch or buffer (null)");
+  }
+
+  pthread_mutex_lock(&prefetch->mutex);
+
+  if (prefetch->held != buffer) {
+    pthread_mutex_unlock(&prefetch->mutex);
+    RAISE(M3U8_PREFETCH_STATUS_INVALID_ARG, "Buffer is not held by the consumer");
+  }
+
+  buffer->state = M3U8_PREFETCH_SLOT_FREE;
+  buffer->size = 0;
+  prefetch->held = NULL;
+  prefetch->cursor++;
+
+  pthread_mutex_unlock(&prefetch->mutex);
+
+  __m3u8_prefetch_schedule(prefetch);
+
+clean_up:
+  return status;
+}
+
+int m3u8_prefetch_destroy(m3u8_prefetch_t* prefetch) {
+  int status = M3U8_PREFETCH_STATUS_NO_ERROR;
+
+  if (prefetch == NULL) {
+    RAISE(M3U8_PREFETCH_STATUS_INVALID_ARG, "Invalid arg prefetch (null)");
+  }
+
+  pthread_mutex_lock(&prefetch->mutex);
+  __atomic_store_n(&prefetch->is_stopping, true, __ATOMIC_RELAXED);
+
+  // NOTE: requests in flight still write into the ring until they complete
+  for (int i = 0; prefetch->ring != NULL && i < prefetch->depth; i++) {
+    while (prefetch->ring[i].state == M3U8_PREFETCH_SLOT_LOADING) {
+      pthread_cond_wait(&prefetch->ready, &prefetch->mutex);
+    }
+  }
+
+  pthread_mutex_unlock(&prefetch->mutex);
+
+  for (int i = 0; prefetch->ring != NULL && i < prefetch->depth; i++) {
+    free(prefetch->ring[i].data);
+  }
+
+  pthread_cond_destroy(&prefetch->ready);
+  pthread_mutex_destroy(&prefetch->mutex);
+
+  free(prefetch->slots);
+  free(prefetch->ring);
+  free(prefetch->base_uri);
+  m3u8_memory_count(M3U8_MEMORY_PREFETCHER, -1);
+  free(prefetch);
+
+clean_up:
+  return status;
+}
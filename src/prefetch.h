@@ -0,0 +1,184 @@
+/**
+ * @file prefetch.h
+ * @brief Bounded look-ahead segment downloader backed by a recycled buffer ring.
+ */
+
+#ifndef __H_M3U8_PREFETCH__
+#define __H_M3U8_PREFETCH__
+
+#include <stddef.h>
+
+#include "m3u8.h"
+#include "transport.h"
+
+/**
+ * @brief Operation completed successfully.
+ *
+ * @details Returned when a function completes without error.
+ */
+#define M3U8_PREFETCH_STATUS_NO_ERROR        0x20000000
+
+/**
+ * @brief Invalid argument received.
+ *
+ * @details Returned when a parameter is NULL or otherwise invalid.
+ */
+#define M3U8_PREFETCH_STATUS_INVALID_ARG     (M3U8_PREFETCH_STATUS_NO_ERROR + 0x01)
+
+/**
+ * @brief Memory allocation failure.
+ *
+ * @details Returned when memory allocation or reallocation fails.
+ */
+#define M3U8_PREFETCH_STATUS_MEM_ALLOC_ERROR (M3U8_PREFETCH_STATUS_NO_ERROR + 0x02)
+
+/**
+ * @brief Fetch backend could not be initialized.
+ *
+ * @details Returned when the transport cannot be obtained or rejects a
+ *          segment request.
+ */
+#define M3U8_PREFETCH_STATUS_INIT_ERROR      (M3U8_PREFETCH_STATUS_NO_ERROR + 0x03)
+
+/**
+ * @brief The segment download failed.
+ *
+ * @details Returned by acquire when the segment under the cursor could not be
+ *          downloaded. The buffer is still handed out and must be released.
+ */
+#define M3U8_PREFETCH_STATUS_FETCH_ERROR     (M3U8_PREFETCH_STATUS_NO_ERROR + 0x04)
+
+/**
+ * @brief The cursor moved past the last segment.
+ *
+ * @details Returned by acquire when every segment was already consumed.
+ */
+#define M3U8_PREFETCH_STATUS_END             (M3U8_PREFETCH_STATUS_NO_ERROR + 0x05)
+
+/**
+ * @brief Unknown error occurred.
+ *
+ * @details Returned when an unexpected or undefined error occurs.
+ */
+#define M3U8_PREFETCH_STATUS_UNKNOWN_ERROR   (M3U8_PREFETCH_STATUS_NO_ERROR + 0x99)
+
+/**
+ * @def M3U8_PREFETCH_DEFAULT_DEPTH
+ * @brief Number of segments fetched ahead of the cursor when depth is 0.
+ */
+#define M3U8_PREFETCH_DEFAULT_DEPTH          3
+
+/**
+ * @def M3U8_PREFETCH_MAX_DEPTH
+ * @brief Largest depth accepted by m3u8_prefetch_create.
+ */
+#define M3U8_PREFETCH_MAX_DEPTH              256
+
+/**
+ * @struct m3u8_prefetch_config_t
+ * @brief Tuning knobs for a prefetcher.
+ */
+typedef struct {
+  int               depth;       /**< segments fetched ahead of the cursor (ring size), at
+                                      most M3U8_PREFETCH_MAX_DEPTH */
+  size_t            buffer_size; /**< initial capacity of each ring buffer in bytes */
+  m3u8_transport_t* transport;   /**< transport segments are fetched with, NULL for default */
+} m3u8_prefetch_config_t;
+
+/**
+ * @struct m3u8_prefetch_buffer_t
+ * @brief One slot of the buffer ring, handed to the consumer by acquire.
+ *
+ * @details The memory is owned by the prefetcher and reused for a later
+ *          segment once the consumer releases it.
+ */
+typedef struct {
+  int    index;    /**< index of the segment in m3u8_media_t.segments */
+  char*  data;     /**< downloaded segment bytes */
+  size_t size;     /**< number of valid bytes in data */
+  size_t capacity; /**< allocated bytes in data, kept across reuses */
+  int    state;    /**< internal slot state, do not modify */
+} m3u8_prefetch_buffer_t;
+
+/**
+ * @struct m3u8_prefetch_t
+ * @brief Opaque prefetcher handle.
+ */
+typedef struct m3u8_prefetch m3u8_prefetch_t;
+
+/**
+ * @brief Creates a prefetcher for the segments of a parsed media playlist.
+ *
+ * @param[out] prefetch_ptr Address where the new handle will be stored. Must
+ *                          point to NULL.
+ * @param[in]  media        Parsed media playlist; must outlive the handle.
+ * @param[in]  base_uri     Uri of the media playlist, used to resolve
+ *                          relative segment uris.
+ * @param[in]  config       Optional configuration, NULL for defaults.
+ *
+ * @retval M3U8_PREFETCH_STATUS_NO_ERROR        On success.
+ * @retval M3U8_PREFETCH_STATUS_INVALID_ARG     If an argument is invalid or depth is
+ *                                              above M3U8_PREFETCH_MAX_DEPTH.
+ * @retval M3U8_PREFETCH_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ * @retval M3U8_PREFETCH_STATUS_INIT_ERROR      If the default transport fails.
+ */
+int m3u8_prefetch_create(m3u8_prefetch_t**             prefetch_ptr,
+                         m3u8_media_t*                 media,
+                         const char*                   base_uri,
+                         const m3u8_prefetch_config_t* config);
+
+/**
+ * @brief Starts downloading ahead of the given segment index.
+ *
+ * @param[in] prefetch Prefetcher handle.
+ * @param[in] cursor   Index of the first segment the consumer will acquire.
+ *
+ * @retval M3U8_PREFETCH_STATUS_NO_ERROR    On success.
+ * @retval M3U8_PREFETCH_STATUS_INVALID_ARG If the handle is NULL, already
+ *                                          started or cursor is out of range.
+ * @retval M3U8_PREFETCH_STATUS_INIT_ERROR  If the transport rejects a request.
+ */
+int m3u8_prefetch_start(m3u8_prefetch_t* prefetch, int cursor);
+
+/**
+ * @brief Waits for the segment under the cursor and hands its buffer out.
+ *
+ * @details Blocks only when the segment is still downloading. The cursor
+ *          advances when the buffer is released, which in turn frees a ring
+ *          slot for the next look-ahead download. Segments under an
+ *          EXT-X-KEY with METHOD=AES-128 are decrypted in place before being
+ *          handed out, their keys coming from the shared key cache.
+ *
+ * @param[in]  prefetch Prefetcher handle.
+ * @param[out] buffer   Address where the ready buffer will be stored.
+ *
+ * @retval M3U8_PREFETCH_STATUS_NO_ERROR    On success.
+ * @retval M3U8_PREFETCH_STATUS_INVALID_ARG If an argument is NULL or a buffer
+ *                                          is already held.
+ * @retval M3U8_PREFETCH_STATUS_FETCH_ERROR If the download or decryption failed.
+ * @retval M3U8_PREFETCH_STATUS_END         If no segments are left.
+ */
+int m3u8_prefetch_acquire(m3u8_prefetch_t* prefetch, m3u8_prefetch_buffer_t** buffer);
+
+/**
+ * @brief Returns a buffer to the ring and advances the cursor.
+ *
+ * @param[in] prefetch Prefetcher handle.
+ * @param[in] buffer   Buffer obtained from m3u8_prefetch_acquire.
+ *
+ * @retval M3U8_PREFETCH_STATUS_NO_ERROR    On success.
+ * @retval M3U8_PREFETCH_STATUS_INVALID_ARG If buffer is not the held one.
+ */
+int m3u8_prefetch_release(m3u8_prefetch_t* prefetch, m3u8_prefetch_buffer_t* buffer);
+
+/**
+ * @brief Aborts pending downloads, waits for them and frees the ring.
+ *
+ * @param[in] prefetch Prefetcher handle.
+ *
+ * @retval M3U8_PREFETCH_STATUS_NO_ERROR    On success.
+ * @retval M3U8_PREFETCH_STATUS_INVALID_ARG If prefetch is NULL.
+ */
+int m3u8_prefetch_destroy(m3u8_prefetch_t* prefetch);
+
+#endif  // __H_M3U8_PREFETCH__
@@ -0,0 +1,171 @@
+/**
+ * @file range.c
+ * @brief Byte range parsing and coalescing of adjacent segment ranges.
+ */
+
+#include "range.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+
+/**
+ * @brief Parses a run of decimal digits, rejecting empty runs and overflow.
+ */
+static const char* __m3u8_range_number(const char* pivot, size_t* number) {
+  size_t value = 0;
+
+  if (*pivot < '0' || *pivot > '9') {
+    return NULL;
+  }
+
+  while (*pivot >= '0' && *pivot <= '9') {
+    if (value > ((size_t)-1 - (size_t)(*pivot - '0')) / 10) {
+      return NULL;
+    }
+
+    value = value * 10 + (size_t)(*pivot - '0');
+    pivot++;
+  }
+
+  *number = value;
+
+  return pivot;
+}
+
+int m3u8_range_parse(const char* value, const m3u8_byte_range_t* previous,
+                     m3u8_byte_range_t* range) {
+  int status = M3U8_RANGE_STATUS_NO_ERROR;
+
+  const char* pivot = NULL;
+  size_t      length = 0;
+  size_t      offset = 0;
+
+  if (value == NULL || range == NULL) {
+    RAISE(M3U8_RANGE_STATUS_INVALID_ARG, "Invalid arg value or range (null)");
+  }
+
+  if ((pivot = __m3u8_range_number(value, &length)) == NULL || length == 0) {
+    RAISE(M3U8_RANGE_STATUS_FORMAT_ERROR, "Invalid byte range length in %s", value);
+  }
+
+  if (*pivot == '@') {
+    if ((pivot = __m3u8_range_number(pivot + 1, &offset)) == NULL) {
+      RAISE(M3U8_RANGE_STATUS_FORMAT_ERROR, "Invalid byte range offset in %s", value);
+    }
+  } else if (previous != NULL && previous->length > 0) {
+    offset = previous->offset + previous->length;
+  } else {
+    RAISE(M3U8_RANGE_STATUS_FORMAT_ERROR, "Byte range %s has no offset to continue from", value);
+  }
+
+  if (*pivot != 0) {
+    RAISE(M3U8_RANGE_STATUS_FORMAT_ERROR, "Trailing characters in byte range %s", value);
+  }
+
+  range->offset = offset;
+  range->length = length;
+
+clean_up:
+  return status;
+}
+
+static bool __m3u8_range_same_uri(const m3u8_media_segment_t* previous, const m3u8_media_segment_t* next) {
+  if (previous->uri_template != 0 || next->uri_template != 0) {
+    return previous->uri_template == next->uri_template && previous->uri_number == next->uri_number;
+  }
+
+  return previous->uri != NULL && next->uri != NULL && strcmp(previous->uri, next->uri) == 0;
+}
+
+bool m3u8_range_is_mergeable(const m3u8_media_segment_t* previous,
+                             const m3u8_media_segment_t* next, size_t max_gap) {
+  size_t previous_end = 0;
+
+  if (previous == NULL || next == NULL) {
+    return false;
+  }
+
+  if (previous->byte_range.length == 0 || next->byte_range.length == 0) {
+    return false;
+  }
+
+  previous_end = previous->byte_range.offset + previous->byte_range.length;
+
+  return next->byte_range.offset >= previous_end &&
+         next->byte_range.offset - previous_end <= max_gap && __m3u8_range_same_uri(previous, next);
+}
+
+int m3u8_range_plan(const m3u8_media_t* media, int first, int count, size_t max_gap,
+                    size_t max_length, m3u8_range_request_t* requests, int* requests_s) {
+  int status = M3U8_RANGE_STATUS_NO_ERROR;
+
+  m3u8_range_request_t* request = NULL;
+
+  if (media == NULL || requests == NULL || requests_s == NULL) {
+    RAISE(M3U8_RANGE_STATUS_INVALID_ARG, "Invalid arg media, requests or requests_s (null)");
+  }
+
+  if (first < 0 || count < 0 || first + count > media->segments_count) {
+    RAISE(M3U8_RANGE_STATUS_INVALID_ARG, "Invalid span [%d, %d) of %d segments", first,
+          first + count, media->segments_count);
+  }
+
+  *requests_s = 0;
+
+  for (int i = first; i < first + count; i++) {
+    const m3u8_media_segment_t* segment = &media->segments[i];
+
+    if (request != NULL && m3u8_range_is_mergeable(&media->segments[i - 1], segment, max_gap)) {
+      size_t length = segment->byte_range.offset + segment->byte_range.length - request->offset;
+
+      if (max_length == 0 || length <= max_length) {
+        request->length = length;
+        request->count++;
+        continue;
+      }
+    }
+
+    request = &requests[(*requests_s)++];
+    request->uri = segment->uri;
+    request->offset = segment->byte_range.offset;
+    request->length = segment->byte_range.length;
+    request->first = i;
+    request->count = 1;
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_range_split(const m3u8_media_t* media, const m3u8_range_request_t* request,
+                     const char* body, size_t body_s, m3u8_range_view_t* views) {
+  int status = M3U8_RANGE_STATUS_NO_ERROR;
+
+  if (media == NULL || request == NULL || (body == NULL && body_s > 0) || views == NULL) {
+    RAISE(M3U8_RANGE_STATUS_INVALID_ARG, "Invalid arg media, request, body or views (null)");
+  }
+
+  if (request->length == 0) {
+    views[0].data = body;
+    views[0].size = body_s;
+    goto clean_up;
+  }
+
+  for (int i = 0; i < request->count; i++) {
+    const m3u8_byte_range_t* range = &media->segments[request->first + i].byte_range;
+    size_t                   start = range->offset - request->offset;
+
+    if (start + range->length > body_s) {
+      RAISE(M3U8_RANGE_STATUS_SHORT_BODY, "Merged body of %zu bytes ends inside segment %d",
+            body_s, request->first + i);
+    }
+
+    views[i].data = body + start;
+    views[i].size = range->length;
+  }
+
+clean_up:
+  return status;
+}
@@ -0,0 +1,134 @@
+/**
+ * @file range.h
+ * @brief Byte range parsing and coalescing of adjacent segment ranges.
+ */
+
+#ifndef __H_M3U8_RANGE__
+#define __H_M3U8_RANGE__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "m3u8.h"
+
+/**
+ * @brief Operation completed successfully.
+ *
+ * @details Returned when a function completes without error.
+ */
+#define M3U8_RANGE_STATUS_NO_ERROR     0x60000000
+
+/**
+ * @brief Invalid argument received.
+ *
+ * @details Returned when a parameter is NULL or otherwise invalid.
+ */
+#define M3U8_RANGE_STATUS_INVALID_ARG  (M3U8_RANGE_STATUS_NO_ERROR + 0x01)
+
+/**
+ * @brief Malformed byte range.
+ *
+ * @details Returned when a value is not <n>[@<o>], or when the offset is
+ *          omitted and there is no previous range to continue from.
+ */
+#define M3U8_RANGE_STATUS_FORMAT_ERROR (M3U8_RANGE_STATUS_NO_ERROR + 0x02)
+
+/**
+ * @brief Response does not cover the planned ranges.
+ *
+ * @details Returned by split when the merged body is shorter than planned.
+ */
+#define M3U8_RANGE_STATUS_SHORT_BODY   (M3U8_RANGE_STATUS_NO_ERROR + 0x03)
+
+/**
+ * @brief Unknown error occurred.
+ *
+ * @details Returned when an unexpected or undefined error occurs.
+ */
+#define M3U8_RANGE_STATUS_UNKNOWN_ERROR (M3U8_RANGE_STATUS_NO_ERROR + 0x99)
+
+/**
+ * @struct m3u8_range_request_t
+ * @brief One merged Range request covering consecutive segments.
+ */
+typedef struct {
+  const char* uri;    /**< resource shared by the segments, borrowed; NULL when
+                           templated, see m3u8_timeline_uri of first */
+  size_t      offset; /**< first byte requested */
+  size_t      length; /**< bytes requested, 0 for the whole resource */
+  int         first;  /**< index of the first segment served */
+  int         count;  /**< number of consecutive segments served */
+} m3u8_range_request_t;
+
+/**
+ * @struct m3u8_range_view_t
+ * @brief Segment bytes inside a merged response body, not owned.
+ */
+typedef struct {
+  const char* data; /**< first byte of the segment */
+  size_t      size; /**< bytes in the segment */
+} m3u8_range_view_t;
+
+/**
+ * @brief Parses an EXT-X-BYTERANGE value or a BYTERANGE attribute.
+ *
+ * @param[in]  value    Range as <n>[@<o>] (e.g., 75232@0).
+ * @param[in]  previous Range of the previous segment on the same resource,
+ *                      used when the offset is omitted; may be NULL.
+ * @param[out] range    Parsed range.
+ *
+ * @retval M3U8_RANGE_STATUS_NO_ERROR     On success.
+ * @retval M3U8_RANGE_STATUS_INVALID_ARG  If value or range is NULL.
+ * @retval M3U8_RANGE_STATUS_FORMAT_ERROR If the value is malformed.
+ */
+int m3u8_range_parse(const char* value, const m3u8_byte_range_t* previous,
+                     m3u8_byte_range_t* range);
+
+/**
+ * @brief Tells whether next can be fetched in the same request as previous.
+ *
+ * @param[in] previous Segment already in the request.
+ * @param[in] next     Segment that would extend it.
+ * @param[in] max_gap  Unwanted bytes tolerated between the two ranges.
+ *
+ * @return true when both are ranges of the same uri and next starts at most
+ *         max_gap bytes after previous ends.
+ */
+bool m3u8_range_is_mergeable(const m3u8_media_segment_t* previous,
+                             const m3u8_media_segment_t* next, size_t max_gap);
+
+/**
+ * @brief Groups consecutive segments into as few Range requests as possible.
+ *
+ * @param[in]  media      Parsed media playlist.
+ * @param[in]  first      Index of the first segment to plan.
+ * @param[in]  count      Number of segments to plan.
+ * @param[in]  max_gap    Unwanted bytes tolerated between merged ranges.
+ * @param[in]  max_length Upper bound of a merged request, 0 for none.
+ * @param[out] requests   Planned requests, room for count entries.
+ * @param[out] requests_s Number of planned requests.
+ *
+ * @retval M3U8_RANGE_STATUS_NO_ERROR    On success.
+ * @retval M3U8_RANGE_STATUS_INVALID_ARG If an argument is NULL or the span
+ *                                       is outside the playlist.
+ */
+int m3u8_range_plan(const m3u8_media_t* media, int first, int count, size_t max_gap,
+                    size_t max_length, m3u8_range_request_t* requests, int* requests_s);
+
+/**
+ * @brief Splits the body of a merged request into per-segment views.
+ *
+ * @param[in]  media   Parsed media playlist the request was planned from.
+ * @param[in]  request Planned request.
+ * @param[in]  body    Response body of the request.
+ * @param[in]  body_s  Bytes in body.
+ * @param[out] views   One view per segment of the request.
+ *
+ * @retval M3U8_RANGE_STATUS_NO_ERROR    On success.
+ * @retval M3U8_RANGE_STATUS_INVALID_ARG If an argument is NULL.
+ * @retval M3U8_RANGE_STATUS_SHORT_BODY  If body ends before a segment does.
+ */
+int m3u8_range_split(const m3u8_media_t* media, const m3u8_range_request_t* request,
+                     const char* body, size_t body_s, m3u8_range_view_t* views);
+
+#endif  // __H_M3U8_RANGE__
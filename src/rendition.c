@@ -0,0 +1,297 @@
+/**
+ * @file rendition.c
+ * @brief EXT-X-MEDIA renditions of a master playlist indexed by group.
+ */
+
+#include "rendition.h"
+
+#include <stdint.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "intern.h"
+#include "logger.h"
+
+#define M3U8_RENDITION_INITIAL_CAPACITY 8
+
+/**
+ * @brief FNV-1a of a GROUP-ID, seeded with the media type.
+ */
+static uint32_t __m3u8_rendition_hash(m3u8_media_type_e type, const char* group_id) {
+  uint32_t hash = 2166136261u ^ (uint32_t)type;
+
+  while (*group_id != 0) {
+    hash = (hash ^ (unsigned char)*group_id++) * 16777619u;
+  }
+
+  return hash;
+}
+
+/**
+ * @brief Finds the hash slot of a group, or the empty slot it would take.
+ */
+static int __m3u8_rendition_slot(const m3u8_t* m3u8_ptr, m3u8_media_type_e type, const char* group_id) {
+  int mask = m3u8_ptr->rendition_hash_s - 1;
+  int slot = (int)(__m3u8_rendition_hash(type, group_id) & mask);
+
+  while (m3u8_ptr->rendition_hash[slot] >= 0) {
+    const m3u8_rendition_group_t* group = &m3u8_ptr->rendition_groups[m3u8_ptr->rendition_hash[slot]];
+
+    // NOTE: interned group ids usually match by address
+    if (group->type == type && (group->group_id == group_id || strcmp(group->group_id, group_id) == 0)) {
+      break;
+    }
+
+    slot = (slot + 1) & mask;
+  }
+
+  return slot;
+}
+
+static int __m3u8_rendition_resolve(const m3u8_t* m3u8_ptr, m3u8_media_type_e type, const char* group_id) {
+  if (group_id == NULL || m3u8_ptr->rendition_hash == NULL) {
+    return -1;
+  }
+
+  return m3u8_ptr->rendition_hash[__m3u8_rendition_slot(m3u8_ptr, type, group_id)];
+}
+
+static void __m3u8_rendition_free(const m3u8_t* m3u8_ptr, char* string) {
+  if (m3u8_ptr->is_interned && string != NULL) {
+    m3u8_intern_release(string);
+  } else {
+    free(string);
+  }
+}
+
+static void __m3u8_rendition_drop_index(m3u8_t* m3u8_ptr) {
+  free(m3u8_ptr->rendition_groups);
+  free(m3u8_ptr->rendition_hash);
+  m3u8_ptr->rendition_groups = NULL;
+  m3u8_ptr->rendition_groups_count = 0;
+  m3u8_ptr->rendition_hash = NULL;
+  m3u8_ptr->rendition_hash_s = 0;
+}
+
+int m3u8_rendition_append(m3u8_t* m3u8_ptr, const ext_x_media_type_t* rendition) {
+  int status = M3U8_RENDITION_STATUS_NO_ERROR;
+
+  if (m3u8_ptr == NULL || rendition == NULL) {
+    RAISE(M3U8_RENDITION_STATUS_INVALID_ARG, "Invalid arg m3u8_ptr or rendition (null)");
+  }
+
+  if (m3u8_ptr->renditions_count == m3u8_ptr->renditions_capacity) {
+    int                 capacity = m3u8_ptr->renditions_capacity > 0 ? m3u8_ptr->renditions_capacity * 2
+                                                                     : M3U8_RENDITION_INITIAL_CAPACITY;
+    ext_x_media_type_t* grown = realloc(m3u8_ptr->renditions, capacity * sizeof(ext_x_media_type_t));
+
+    if (grown == NULL) {
+      RAISE(M3U8_RENDITION_STATUS_MEM_ALLOC_ERROR, "Unable to grow renditions to %d", capacity);
+    }
+
+    m3u8_ptr->renditions = grown;
+    m3u8_ptr->renditions_capacity = capacity;
+  }
+
+  m3u8_ptr->renditions[m3u8_ptr->renditions_count] = *rendition;
+
+  if (m3u8_ptr->is_interned) {
+    ext_x_media_type_t* stored = &m3u8_ptr->renditions[m3u8_ptr->renditions_count];
+    char** const        strings[] = {&stored->group_id, &stored->language, &stored->name,
+                                     &stored->instream_id, &stored->assoc_language, &stored->channels,
+                                     &stored->uri};
+
+    if (m3u8_intern_adopt(strings, sizeof(strings) / sizeof(strings[0])) != M3U8_INTERN_STATUS_NO_ERROR) {
+      RAISE(M3U8_RENDITION_STATUS_MEM_ALLOC_ERROR, "Unable to intern the rendition strings");
+    }
+  }
+
+  m3u8_ptr->renditions_count++;
+  __m3u8_rendition_drop_index(m3u8_ptr);
+
+clean_up:
+  return status;
+}
+
+int m3u8_rendition_index(m3u8_t* m3u8_ptr) {
+  int status = M3U8_RENDITION_STATUS_NO_ERROR;
+
+  int*                group_of = NULL;
+  int*                cursor = NULL;
+  ext_x_media_type_t* grouped = NULL;
+  int                 count = 0;
+
+  if (m3u8_ptr == NULL) {
+    RAISE(M3U8_RENDITION_STATUS_INVALID_ARG, "Invalid arg m3u8_ptr (null)");
+  }
+
+  __m3u8_rendition_drop_index(m3u8_ptr);
+  count = m3u8_ptr->renditions_count;
+
+  // NOTE: at most half full, so probes stay short
+  for (m3u8_ptr->rendition_hash_s = M3U8_RENDITION_INITIAL_CAPACITY;
+       m3u8_ptr->rendition_hash_s < 2 * count;) {
+    m3u8_ptr->rendition_hash_s *= 2;
+  }
+
+  if ((m3u8_ptr->rendition_hash = malloc(m3u8_ptr->rendition_hash_s * sizeof(int))) == NULL ||
+      (m3u8_ptr->rendition_groups = calloc(count + 1, sizeof(m3u8_rendition_group_t))) == NULL ||
+      (group_of = malloc((count + 1) * sizeof(int))) == NULL ||
+      (cursor = malloc((count + 1) * sizeof(int))) == NULL ||
+      (grouped = malloc((count + 1) * sizeof(ext_x_media_type_t))) == NULL) {
+    RAISE(M3U8_RENDITION_STATUS_MEM_ALLOC_ERROR, "Unable to allocate the group index");
+  }
+
+  memset(m3u8_ptr->rendition_hash, 0xff, m3u8_ptr->rendition_hash_s * sizeof(int));
+
+  for (int i = 0; i < count; i++) {
+    const ext_x_media_type_t* rendition = &m3u8_ptr->renditions[i];
+    const char*               group_id = rendition->group_id != NULL ? rendition->group_id : "";
+    int                       slot = __m3u8_rendition_slot(m3u8_ptr, rendition->type, group_id);
+
+    if (m3u8_ptr->rendition_hash[slot] < 0) {
+      m3u8_rendition_group_t* group = &m3u8_ptr->rendition_groups[m3u8_ptr->rendition_groups_count];
+
+      group->group_id = group_id;
+      group->type = rendition->type;
+      group->fallback = -1;
+      m3u8_ptr->rendition_hash[slot] = m3u8_ptr->rendition_groups_count++;
+    }
+
+    group_of[i] = m3u8_ptr->rendition_hash[slot];
+    m3u8_ptr->rendition_groups[group_of[i]].count++;
+  }
+
+  // NOTE: a stable counting sort makes every group contiguous
+  for (int g = 0, first = 0; g < m3u8_ptr->rendition_groups_count; g++) {
+    m3u8_ptr->rendition_groups[g].first = first;
+    cursor[g] = first;
+    first += m3u8_ptr->rendition_groups[g].count;
+  }
+
+  for (int i = 0; i < count; i++) {
+    m3u8_rendition_group_t* group = &m3u8_ptr->rendition_groups[group_of[i]];
+    int                     index = cursor[group_of[i]]++;
+
+    grouped[index] = m3u8_ptr->renditions[i];
+
+    if (group->fallback < 0 || (grouped[index].is_default && !grouped[group->fallback].is_default)) {
+      group->fallback = index;
+    }
+  }
+
+  free(m3u8_ptr->renditions);
+  m3u8_ptr->renditions = grouped;
+  m3u8_ptr->renditions_capacity = count + 1;
+  grouped = NULL;
+
+  for (int i = 0; i < m3u8_ptr->variants_count; i++) {
+    ext_x_stream_inf_t* variant = &m3u8_ptr->variants[i];
+
+    variant->audio_group = __m3u8_rendition_resolve(m3u8_ptr, AUDIO, variant->audio);
+    variant->video_group = __m3u8_rendition_resolve(m3u8_ptr, VIDEO, variant->video);
+    variant->subtitles_group = __m3u8_rendition_resolve(m3u8_ptr, SUBTITLES, variant->subtitles);
+    variant->closed_captions_group =
+        __m3u8_rendition_resolve(m3u8_ptr, CLOSED_CAPTIONS, variant->closed_captions);
+  }
+
+clean_up:
+  if (status != M3U8_RENDITION_STATUS_NO_ERROR && m3u8_ptr != NULL) {
+    __m3u8_rendition_drop_index(m3u8_ptr);
+  }
+
+  free(grouped);
+  free(cursor);
+  free(group_of);
+
+  return status;
+}
+
+int m3u8_rendition_group(const m3u8_t*                  m3u8_ptr,
+                         m3u8_media_type_e              type,
+                         const char*                    group_id,
+                         const m3u8_rendition_group_t** group) {
+  int status = M3U8_RENDITION_STATUS_NO_ERROR;
+
+  int index = -1;
+
+  if (m3u8_ptr == NULL || group_id == NULL || group == NULL) {
+    RAISE(M3U8_RENDITION_STATUS_INVALID_ARG, "Invalid arg m3u8_ptr, group_id or group (null)");
+  }
+
+  if ((index = __m3u8_rendition_resolve(m3u8_ptr, type, group_id)) < 0) {
+    status = M3U8_RENDITION_STATUS_NOT_FOUND;
+    goto clean_up;
+  }
+
+  *group = &m3u8_ptr->rendition_groups[index];
+
+clean_up:
+  return status;
+}
+
+int m3u8_rendition_default(const m3u8_t*              m3u8_ptr,
+                           int                        variant,
+                           m3u8_media_type_e          type,
+                           const ext_x_media_type_t** rendition) {
+  int status = M3U8_RENDITION_STATUS_NO_ERROR;
+
+  const ext_x_stream_inf_t* stream_inf = NULL;
+  int                       index = -1;
+
+  if (m3u8_ptr == NULL || rendition == NULL || variant < 0 || variant >= m3u8_ptr->variants_count) {
+    RAISE(M3U8_RENDITION_STATUS_INVALID_ARG, "Invalid arg m3u8_ptr, rendition or variant %d", variant);
+  }
+
+  if (m3u8_ptr->rendition_hash == NULL) {
+    RAISE(M3U8_RENDITION_STATUS_INVALID_ARG, "Group index not built, see m3u8_rendition_index");
+  }
+
+  stream_inf = &m3u8_ptr->variants[variant];
+
+  switch (type) {
+    case AUDIO: index = stream_inf->audio_group; break;
+    case VIDEO: index = stream_inf->video_group; break;
+    case SUBTITLES: index = stream_inf->subtitles_group; break;
+    case CLOSED_CAPTIONS: index = stream_inf->closed_captions_group; break;
+  }
+
+  if (index < 0) {
+    status = M3U8_RENDITION_STATUS_NOT_FOUND;
+    goto clean_up;
+  }
+
+  *rendition = &m3u8_ptr->renditions[m3u8_ptr->rendition_groups[index].fallback];
+
+clean_up:
+  return status;
+}
+
+int m3u8_rendition_clear(m3u8_t* m3u8_ptr) {
+  int status = M3U8_RENDITION_STATUS_NO_ERROR;
+
+  if (m3u8_ptr == NULL) {
+    RAISE(M3U8_RENDITION_STATUS_INVALID_ARG, "Invalid arg m3u8_ptr (null)");
+  }
+
+  for (int i = 0; i < m3u8_ptr->renditions_count; i++) {
+    ext_x_media_type_t* rendition = &m3u8_ptr->renditions[i];
+
+    __m3u8_rendition_free(m3u8_ptr, rendition->group_id);
+    __m3u8_rendition_free(m3u8_ptr, rendition->language);
+    __m3u8_rendition_free(m3u8_ptr, rendition->name);
+    __m3u8_rendition_free(m3u8_ptr, rendition->instream_id);
+    __m3u8_rendition_free(m3u8_ptr, rendition->assoc_language);
+    __m3u8_rendition_free(m3u8_ptr, rendition->channels);
+    __m3u8_rendition_free(m3u8_ptr, rendition->uri);
+  }
+
+  __m3u8_rendition_drop_index(m3u8_ptr);
+  free(m3u8_ptr->renditions);
+  m3u8_ptr->renditions = NULL;
+  m3u8_ptr->renditions_count = 0;
+  m3u8_ptr->renditions_capacity = 0;
+
+clean_up:
+  return status;
+}
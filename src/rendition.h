@@ -0,0 +1,129 @@
+/**
+ * @file rendition.h
+ * @brief EXT-X-MEDIA renditions of a master playlist indexed by group.
+ */
+
+#ifndef __H_M3U8_RENDITION__
+#define __H_M3U8_RENDITION__
+
+#include "m3u8.h"
+
+/**
+ * @brief Operation completed successfully.
+ *
+ * @details Returned when a function completes without error.
+ */
+#define M3U8_RENDITION_STATUS_NO_ERROR        0x04000000
+
+/**
+ * @brief Invalid argument received.
+ *
+ * @details Returned when a parameter is NULL, out of range or the index was
+ *          not built.
+ */
+#define M3U8_RENDITION_STATUS_INVALID_ARG     (M3U8_RENDITION_STATUS_NO_ERROR + 0x01)
+
+/**
+ * @brief Memory allocation failure.
+ *
+ * @details Returned when memory allocation or reallocation fails.
+ */
+#define M3U8_RENDITION_STATUS_MEM_ALLOC_ERROR (M3U8_RENDITION_STATUS_NO_ERROR + 0x02)
+
+/**
+ * @brief No such group or rendition.
+ *
+ * @details Returned when the group is not declared or the variant does not
+ *          refer to a group of that type.
+ */
+#define M3U8_RENDITION_STATUS_NOT_FOUND       (M3U8_RENDITION_STATUS_NO_ERROR + 0x03)
+
+/**
+ * @brief Unknown error occurred.
+ *
+ * @details Returned when an unexpected or undefined error occurs.
+ */
+#define M3U8_RENDITION_STATUS_UNKNOWN_ERROR   (M3U8_RENDITION_STATUS_NO_ERROR + 0x99)
+
+/**
+ * @brief Appends a rendition to a master playlist.
+ *
+ * @details Called by the parser for every EXT-X-MEDIA. The strings of
+ *          rendition are moved, not copied: the playlist owns them
+ *          afterwards. Appending drops the group index until
+ *          m3u8_rendition_index runs again.
+ *
+ * @param[in,out] m3u8_ptr  Master playlist.
+ * @param[in]     rendition Parsed rendition.
+ *
+ * @retval M3U8_RENDITION_STATUS_NO_ERROR        On success.
+ * @retval M3U8_RENDITION_STATUS_INVALID_ARG     If an argument is NULL.
+ * @retval M3U8_RENDITION_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_rendition_append(m3u8_t* m3u8_ptr, const ext_x_media_type_t* rendition);
+
+/**
+ * @brief Groups the renditions and resolves the groups of every variant.
+ *
+ * @details Called once by the parser after the last tag. Renditions are
+ *          reordered so that each group is contiguous, keeping the playlist
+ *          order inside a group, and the audio, video, subtitles and closed
+ *          captions group ids of each variant are turned into indexes of
+ *          m3u8_t.rendition_groups.
+ *
+ * @param[in,out] m3u8_ptr Master playlist.
+ *
+ * @retval M3U8_RENDITION_STATUS_NO_ERROR        On success.
+ * @retval M3U8_RENDITION_STATUS_INVALID_ARG     If m3u8_ptr is NULL.
+ * @retval M3U8_RENDITION_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_rendition_index(m3u8_t* m3u8_ptr);
+
+/**
+ * @brief Looks up a group by TYPE and GROUP-ID through the hash index.
+ *
+ * @param[in]  m3u8_ptr Indexed master playlist.
+ * @param[in]  type     Media type of the group.
+ * @param[in]  group_id GROUP-ID.
+ * @param[out] group    Group found.
+ *
+ * @retval M3U8_RENDITION_STATUS_NO_ERROR    On success.
+ * @retval M3U8_RENDITION_STATUS_INVALID_ARG If an argument is NULL.
+ * @retval M3U8_RENDITION_STATUS_NOT_FOUND   If no such group is declared.
+ */
+int m3u8_rendition_group(const m3u8_t*                  m3u8_ptr,
+                         m3u8_media_type_e              type,
+                         const char*                    group_id,
+                         const m3u8_rendition_group_t** group);
+
+/**
+ * @brief Returns the rendition a variant plays by default for a media type.
+ *
+ * @details Two array reads: the group index held by the variant, then the
+ *          fallback rendition of that group.
+ *
+ * @param[in]  m3u8_ptr  Indexed master playlist.
+ * @param[in]  variant   Index of the variant in m3u8_t.variants.
+ * @param[in]  type      Media type wanted.
+ * @param[out] rendition DEFAULT=YES rendition of the group, else its first.
+ *
+ * @retval M3U8_RENDITION_STATUS_NO_ERROR    On success.
+ * @retval M3U8_RENDITION_STATUS_INVALID_ARG If an argument is invalid.
+ * @retval M3U8_RENDITION_STATUS_NOT_FOUND   If the variant has no such group.
+ */
+int m3u8_rendition_default(const m3u8_t*              m3u8_ptr,
+                           int                        variant,
+                           m3u8_media_type_e          type,
+                           const ext_x_media_type_t** rendition);
+
+/**
+ * @brief Releases the renditions, their strings and the group index.
+ *
+ * @param[in,out] m3u8_ptr Playlist; left without renditions.
+ *
+ * @retval M3U8_RENDITION_STATUS_NO_ERROR    On success.
+ * @retval M3U8_RENDITION_STATUS_INVALID_ARG If m3u8_ptr is NULL.
+ */
+int m3u8_rendition_clear(m3u8_t* m3u8_ptr);
+
+#endif  // __H_M3U8_RENDITION__
@@ -0,0 +1,399 @@
+/**
+ * @file slab.c
+ * @brief Fixed size object pools carved from large chunks, with per-thread
+ *        caches.
+ */
+
+#include "slab.h"
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "list.h"
+#include "logger.h"
+
+#define M3U8_SLAB_CHUNK_SIZE    (16 * 1024)
+#define M3U8_SLAB_THREAD_CACHES 16
+
+/** @brief free object, linked through its first bytes */
+typedef struct m3u8_slab_object {
+  struct m3u8_slab_object* next; /**< next free object */
+} m3u8_slab_object_t;
+
+/** @brief chunk header, objects follow at M3U8_SLAB_ALIGNMENT */
+typedef struct m3u8_slab_chunk {
+  struct m3u8_slab_chunk* next; /**< chunk allocated before */
+} m3u8_slab_chunk_t;
+
+#define M3U8_SLAB_HEADER \
+  ((sizeof(m3u8_slab_chunk_t) + M3U8_SLAB_ALIGNMENT - 1) & ~(size_t)(M3U8_SLAB_ALIGNMENT - 1))
+
+struct m3u8_slab {
+  pthread_mutex_t     mutex;       /**< guards the free list and the chunks */
+  size_t              object_size; /**< bytes per object, rounded */
+  size_t              chunk_size;  /**< bytes per chunk, header included */
+  unsigned long       generation;  /**< identifies the slab to thread caches, changes on reset */
+  bool                is_class;    /**< process-wide size class, never destroyed */
+  m3u8_list_node_t    live;        /**< node on the list of live slabs */
+  m3u8_slab_object_t* free;        /**< objects given back by thread caches */
+  m3u8_slab_chunk_t*  chunks;      /**< every chunk, newest first */
+  size_t              chunks_count;/**< chunks allocated */
+  char*               cursor;      /**< next object never handed out, in the newest chunk */
+  char*               end;         /**< end of the newest chunk */
+};
+
+/** @brief free objects of one slab owned by a thread */
+typedef struct {
+  unsigned long       generation; /**< generation of the slab, 0 when unused */
+  m3u8_slab_t*        slab;       /**< slab the objects belong to, may be gone */
+  m3u8_slab_object_t* head;       /**< cached objects */
+  int                 count;      /**< objects on head */
+} m3u8_slab_cache_t;
+
+static unsigned long    __m3u8_slab_generation = 0;
+static m3u8_slab_t*     __m3u8_slab_classes[M3U8_SLAB_CLASSES];
+static pthread_mutex_t  __m3u8_slab_classes_mutex = PTHREAD_MUTEX_INITIALIZER;
+static m3u8_list_node_t __m3u8_slab_live = {&__m3u8_slab_live, &__m3u8_slab_live};
+static pthread_mutex_t  __m3u8_slab_live_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_once_t   __m3u8_slab_once = PTHREAD_ONCE_INIT;
+static pthread_key_t    __m3u8_slab_key;
+
+static __thread m3u8_slab_cache_t __m3u8_slab_caches[M3U8_SLAB_THREAD_CACHES];
+static __thread bool              __m3u8_slab_has_caches = false;
+
+static void __m3u8_slab_push(m3u8_slab_cache_t* cache, m3u8_slab_object_t* object) {
+  object->next = cache->head;
+  cache->head = object;
+  cache->count++;
+}
+
+/**
+ * @brief Gives the objects of a cache back to their slab when it is still
+ *        alive with the same generation, else drops them with the chunks
+ *        they came from, and leaves the cache unused.
+ */
+static void __m3u8_slab_evict(m3u8_slab_cache_t* cache) {
+  m3u8_slab_t*        slab = NULL;
+  m3u8_slab_object_t* last = cache->head;
+
+  if (cache->head != NULL) {
+    pthread_mutex_lock(&__m3u8_slab_live_mutex);
+
+    m3u8_list_foreach(slab, &__m3u8_slab_live, m3u8_slab_t, live) {
+      if (slab == cache->slab && slab->generation == cache->generation) {
+        while (last->next != NULL) {
+          last = last->next;
+        }
+
+        pthread_mutex_lock(&slab->mutex);
+        last->next = slab->free;
+        slab->free = cache->head;
+        pthread_mutex_unlock(&slab->mutex);
+        break;
+      }
+    }
+
+    pthread_mutex_unlock(&__m3u8_slab_live_mutex);
+  }
+
+  memset(cache, 0, sizeof(m3u8_slab_cache_t));
+}
+
+static void __m3u8_slab_thread_exit(void* caches) {
+  for (int i = 0; i < M3U8_SLAB_THREAD_CACHES; i++) {
+    __m3u8_slab_evict(&((m3u8_slab_cache_t*)caches)[i]);
+  }
+}
+
+static void __m3u8_slab_init(void) {
+  pthread_key_create(&__m3u8_slab_key, __m3u8_slab_thread_exit);
+}
+
+/**
+ * @brief Cache of slab in the calling thread, looked up by generation from
+ *        its preferred entry on. When every entry is taken, the preferred
+ *        one is evicted.
+ */
+static m3u8_slab_cache_t* __m3u8_slab_cache(m3u8_slab_t* slab) {
+  size_t             preferred = slab->generation % M3U8_SLAB_THREAD_CACHES;
+  m3u8_slab_cache_t* cache = &__m3u8_slab_caches[preferred];
+  m3u8_slab_cache_t* unused = NULL;
+
+  if (cache->generation == slab->generation) {
+    return cache;
+  }
+
+  // NOTE: the key only exists to give the caches back when the thread exits
+  if (!__m3u8_slab_has_caches) {
+    pthread_once(&__m3u8_slab_once, __m3u8_slab_init);
+    pthread_setspecific(__m3u8_slab_key, __m3u8_slab_caches);
+    __m3u8_slab_has_caches = true;
+  }
+
+  for (size_t i = 1; i < M3U8_SLAB_THREAD_CACHES; i++) {
+    m3u8_slab_cache_t* other = &__m3u8_slab_caches[(preferred + i) % M3U8_SLAB_THREAD_CACHES];
+
+    if (other->generation == slab->generation) {
+      return other;
+    }
+
+    if (unused == NULL && other->generation == 0) {
+      unused = other;
+    }
+  }
+
+  if (cache->generation != 0 && unused != NULL) {
+    cache = unused;
+  } else {
+    __m3u8_slab_evict(cache);
+  }
+
+  cache->generation = slab->generation;
+  cache->slab = slab;
+
+  return cache;
+}
+
+/**
+ * @brief Moves up to a batch of objects into an empty cache, from the free
+ *        list first, then from the newest chunk, then from a new chunk.
+ */
+static int __m3u8_slab_refill(m3u8_slab_t* slab, m3u8_slab_cache_t* cache) {
+  int status = M3U8_SLAB_STATUS_NO_ERROR;
+
+  m3u8_slab_chunk_t* chunk = NULL;
+
+  pthread_mutex_lock(&slab->mutex);
+
+  while (slab->free != NULL && cache->count < M3U8_SLAB_BATCH) {
+    m3u8_slab_object_t* object = slab->free;
+
+    slab->free = object->next;
+    __m3u8_slab_push(cache, object);
+  }
+
+  if (cache->count == 0 && slab->cursor == slab->end) {
+    if ((chunk = malloc(slab->chunk_size)) == NULL) {
+      RAISE(M3U8_SLAB_STATUS_MEM_ALLOC_ERROR, "Unable to allocate slab chunk of %zu bytes",
+            slab->chunk_size);
+    }
+
+    chunk->next = slab->chunks;
+    slab->chunks = chunk;
+    slab->chunks_count++;
+    slab->cursor = (char*)chunk + M3U8_SLAB_HEADER;
+    slab->end = slab->cursor +
+                (slab->chunk_size - M3U8_SLAB_HEADER) / slab->object_size * slab->object_size;
+  }
+
+  while (slab->cursor != slab->end && cache->count < M3U8_SLAB_BATCH) {
+    __m3u8_slab_push(cache, (m3u8_slab_object_t*)slab->cursor);
+    slab->cursor += slab->object_size;
+  }
+
+clean_up:
+  pthread_mutex_unlock(&slab->mutex);
+  return status;
+}
+
+/**
+ * @brief Gives a batch of a full cache back to the free list.
+ */
+static void __m3u8_slab_flush(m3u8_slab_t* slab, m3u8_slab_cache_t* cache) {
+  m3u8_slab_object_t* first = cache->head;
+  m3u8_slab_object_t* last = first;
+
+  for (int i = 1; i < M3U8_SLAB_BATCH; i++) {
+    last = last->next;
+  }
+
+  cache->head = last->next;
+  cache->count -= M3U8_SLAB_BATCH;
+
+  pthread_mutex_lock(&slab->mutex);
+  last->next = slab->free;
+  slab->free = first;
+  pthread_mutex_unlock(&slab->mutex);
+}
+
+static void __m3u8_slab_release_chunks(m3u8_slab_t* slab) {
+  while (slab->chunks != NULL) {
+    m3u8_slab_chunk_t* next = slab->chunks->next;
+
+    free(slab->chunks);
+    slab->chunks = next;
+  }
+
+  slab->chunks_count = 0;
+  slab->free = NULL;
+  slab->cursor = NULL;
+  slab->end = NULL;
+}
+
+int m3u8_slab_create(m3u8_slab_t** slab_ptr, size_t object_size) {
+  int status = M3U8_SLAB_STATUS_NO_ERROR;
+
+  m3u8_slab_t* slab = NULL;
+
+  if (slab_ptr == NULL || *slab_ptr != NULL || object_size == 0) {
+    RAISE(M3U8_SLAB_STATUS_INVALID_ARG, "Invalid arg slab_ptr, must point to NULL, or object_size 0");
+  }
+
+  if ((slab = calloc(1, sizeof(m3u8_slab_t))) == NULL) {
+    RAISE(M3U8_SLAB_STATUS_MEM_ALLOC_ERROR, "Unable to allocate slab");
+  }
+
+  pthread_mutex_init(&slab->mutex, NULL);
+  slab->object_size = (object_size + M3U8_SLAB_ALIGNMENT - 1) & ~(size_t)(M3U8_SLAB_ALIGNMENT - 1);
+  slab->chunk_size = M3U8_SLAB_HEADER + M3U8_SLAB_BATCH * slab->object_size;
+  slab->chunk_size = slab->chunk_size < M3U8_SLAB_CHUNK_SIZE ? M3U8_SLAB_CHUNK_SIZE : slab->chunk_size;
+  slab->generation = __atomic_add_fetch(&__m3u8_slab_generation, 1, __ATOMIC_RELAXED);
+
+  // NOTE: linked by hand, the slab must not depend on list errors (or mocks)
+  pthread_mutex_lock(&__m3u8_slab_live_mutex);
+  slab->live.next = &__m3u8_slab_live;
+  slab->live.prev = __m3u8_slab_live.prev;
+  __m3u8_slab_live.prev->next = &slab->live;
+  __m3u8_slab_live.prev = &slab->live;
+  pthread_mutex_unlock(&__m3u8_slab_live_mutex);
+
+  *slab_ptr = slab;
+
+clean_up:
+  return status;
+}
+
+m3u8_slab_t* m3u8_slab_class(size_t size) {
+  m3u8_slab_t* slab = NULL;
+  size_t       index = 0;
+
+  if (size == 0 || size > M3U8_SLAB_CLASSES * M3U8_SLAB_ALIGNMENT) {
+    return NULL;
+  }
+
+  index = (size - 1) / M3U8_SLAB_ALIGNMENT;
+
+  if ((slab = __atomic_load_n(&__m3u8_slab_classes[index], __ATOMIC_ACQUIRE)) != NULL) {
+    return slab;
+  }
+
+  pthread_mutex_lock(&__m3u8_slab_classes_mutex);
+
+  if ((slab = __m3u8_slab_classes[index]) == NULL &&
+      m3u8_slab_create(&slab, (index + 1) * M3U8_SLAB_ALIGNMENT) == M3U8_SLAB_STATUS_NO_ERROR) {
+    slab->is_class = true;
+    __atomic_store_n(&__m3u8_slab_classes[index], slab, __ATOMIC_RELEASE);
+  }
+
+  pthread_mutex_unlock(&__m3u8_slab_classes_mutex);
+
+  return slab;
+}
+
+int m3u8_slab_alloc(m3u8_slab_t* slab, void** object) {
+  int status = M3U8_SLAB_STATUS_NO_ERROR;
+
+  m3u8_slab_cache_t*  cache = NULL;
+  m3u8_slab_object_t* head = NULL;
+
+  if (slab == NULL || object == NULL) {
+    RAISE(M3U8_SLAB_STATUS_INVALID_ARG, "Invalid arg slab or object (null)");
+  }
+
+  cache = __m3u8_slab_cache(slab);
+
+  if (cache->head == NULL && (status = __m3u8_slab_refill(slab, cache)) != M3U8_SLAB_STATUS_NO_ERROR) {
+    goto clean_up;
+  }
+
+  head = cache->head;
+  cache->head = head->next;
+  cache->count--;
+
+  memset(head, 0, slab->object_size);
+  *object = head;
+
+clean_up:
+  return status;
+}
+
+int m3u8_slab_free(m3u8_slab_t* slab, void* object) {
+  int status = M3U8_SLAB_STATUS_NO_ERROR;
+
+  m3u8_slab_cache_t* cache = NULL;
+
+  if (slab == NULL || object == NULL) {
+    RAISE(M3U8_SLAB_STATUS_INVALID_ARG, "Invalid arg slab or object (null)");
+  }
+
+  cache = __m3u8_slab_cache(slab);
+  __m3u8_slab_push(cache, (m3u8_slab_object_t*)object);
+
+  if (cache->count > M3U8_SLAB_CACHE_SIZE) {
+    __m3u8_slab_flush(slab, cache);
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_slab_reset(m3u8_slab_t* slab) {
+  int status = M3U8_SLAB_STATUS_NO_ERROR;
+
+  if (slab == NULL) {
+    RAISE(M3U8_SLAB_STATUS_INVALID_ARG, "Invalid arg slab (null)");
+  }
+
+  // NOTE: same lock order as an eviction, live list first
+  pthread_mutex_lock(&__m3u8_slab_live_mutex);
+  pthread_mutex_lock(&slab->mutex);
+  __m3u8_slab_release_chunks(slab);
+
+  // NOTE: a new generation orphans what thread caches hold of the old chunks
+  slab->generation = __atomic_add_fetch(&__m3u8_slab_generation, 1, __ATOMIC_RELAXED);
+  pthread_mutex_unlock(&slab->mutex);
+  pthread_mutex_unlock(&__m3u8_slab_live_mutex);
+
+clean_up:
+  return status;
+}
+
+int m3u8_slab_stats(m3u8_slab_t* slab, m3u8_slab_stats_t* stats) {
+  int status = M3U8_SLAB_STATUS_NO_ERROR;
+
+  if (slab == NULL || stats == NULL) {
+    RAISE(M3U8_SLAB_STATUS_INVALID_ARG, "Invalid arg slab or stats (null)");
+  }
+
+  pthread_mutex_lock(&slab->mutex);
+  stats->object_size = slab->object_size;
+  stats->chunks = slab->chunks_count;
+  stats->bytes = slab->chunks_count * slab->chunk_size;
+  pthread_mutex_unlock(&slab->mutex);
+
+clean_up:
+  return status;
+}
+
+int m3u8_slab_destroy(m3u8_slab_t* slab) {
+  int status = M3U8_SLAB_STATUS_NO_ERROR;
+
+  if (slab == NULL || slab->is_class) {
+    RAISE(M3U8_SLAB_STATUS_INVALID_ARG, "Invalid arg slab, null or a size class");
+  }
+
+  // NOTE: once off the list, no exiting thread gives objects back to it
+  pthread_mutex_lock(&__m3u8_slab_live_mutex);
+  slab->live.prev->next = slab->live.next;
+  slab->live.next->prev = slab->live.prev;
+  pthread_mutex_unlock(&__m3u8_slab_live_mutex);
+
+  __m3u8_slab_release_chunks(slab);
+  pthread_mutex_destroy(&slab->mutex);
+  free(slab);
+
+clean_up:
+  return status;
+}
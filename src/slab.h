@@ -0,0 +1,149 @@
+/**
+ * @file slab.h
+ * @brief Fixed size object pools carved from large chunks, with per-thread
+ *        caches.
+ */
+
+#ifndef __H_M3U8_SLAB__
+#define __H_M3U8_SLAB__
+
+#include <stddef.h>
+
+/**
+ * @brief Operation completed successfully.
+ *
+ * @details Returned when a function completes without error.
+ */
+#define M3U8_SLAB_STATUS_NO_ERROR        0x0C000000
+
+/**
+ * @brief Invalid argument received.
+ *
+ * @details Returned when a parameter is NULL or otherwise invalid.
+ */
+#define M3U8_SLAB_STATUS_INVALID_ARG     (M3U8_SLAB_STATUS_NO_ERROR + 0x01)
+
+/**
+ * @brief Memory allocation error.
+ *
+ * @details Returned when a new chunk cannot be allocated.
+ */
+#define M3U8_SLAB_STATUS_MEM_ALLOC_ERROR (M3U8_SLAB_STATUS_NO_ERROR + 0x02)
+
+/**
+ * @brief Unknown error occurred.
+ *
+ * @details Returned when an unexpected or undefined error occurs.
+ */
+#define M3U8_SLAB_STATUS_UNKNOWN_ERROR   (M3U8_SLAB_STATUS_NO_ERROR + 0x99)
+
+/**
+ * @brief Object sizes are rounded up to a multiple of this.
+ */
+#define M3U8_SLAB_ALIGNMENT              16
+
+/**
+ * @brief Size classes served by m3u8_slab_class, one per M3U8_SLAB_ALIGNMENT
+ *        bytes up to M3U8_SLAB_CLASSES * M3U8_SLAB_ALIGNMENT.
+ */
+#define M3U8_SLAB_CLASSES                16
+
+/**
+ * @brief Free objects a thread keeps per slab before giving half back.
+ */
+#define M3U8_SLAB_CACHE_SIZE             64
+
+/**
+ * @brief Objects moved between a thread cache and the shared free list at once.
+ */
+#define M3U8_SLAB_BATCH                  32
+
+/**
+ * @brief Opaque pool of objects of one size.
+ *
+ * @details Objects are carved from chunks of at least 16 KiB. Each thread
+ *          allocates from and frees to its own cache, and takes the slab
+ *          lock once per M3U8_SLAB_BATCH objects. A thread gives its cached
+ *          objects back when it exits, or when it uses more slabs than it
+ *          has caches.
+ */
+typedef struct m3u8_slab m3u8_slab_t;
+
+/**
+ * @struct m3u8_slab_stats_t
+ * @brief Footprint of a slab.
+ */
+typedef struct {
+  size_t object_size; /**< bytes per object, after rounding */
+  size_t chunks;      /**< chunks allocated */
+  size_t bytes;       /**< bytes of the chunks */
+} m3u8_slab_stats_t;
+
+/**
+ * @brief Creates a slab for objects of object_size bytes.
+ *
+ * @param[out] slab_ptr    Receives the slab, must point to NULL.
+ * @param[in]  object_size Bytes per object, at least 1.
+ *
+ * @retval M3U8_SLAB_STATUS_NO_ERROR        On success.
+ * @retval M3U8_SLAB_STATUS_INVALID_ARG     If slab_ptr is NULL or points to a slab, or size is 0.
+ * @retval M3U8_SLAB_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_slab_create(m3u8_slab_t** slab_ptr, size_t object_size);
+
+/**
+ * @brief Process-wide slab of the size class holding size bytes.
+ *
+ * @details Created on first use and never destroyed, so objects of the
+ *          library can come from it without an owner to release it.
+ *
+ * @return The slab, or NULL when size is 0, above the largest class, or the
+ *         slab cannot be allocated.
+ */
+m3u8_slab_t* m3u8_slab_class(size_t size);
+
+/**
+ * @brief Takes a zero filled object.
+ *
+ * @retval M3U8_SLAB_STATUS_NO_ERROR        On success.
+ * @retval M3U8_SLAB_STATUS_INVALID_ARG     If slab or object is NULL.
+ * @retval M3U8_SLAB_STATUS_MEM_ALLOC_ERROR If a new chunk cannot be allocated.
+ */
+int m3u8_slab_alloc(m3u8_slab_t* slab, void** object);
+
+/**
+ * @brief Gives an object of slab back, from any thread.
+ *
+ * @retval M3U8_SLAB_STATUS_NO_ERROR    On success.
+ * @retval M3U8_SLAB_STATUS_INVALID_ARG If slab or object is NULL.
+ */
+int m3u8_slab_free(m3u8_slab_t* slab, void* object);
+
+/**
+ * @brief Releases every object of slab at once, in O(chunks).
+ *
+ * @details The slab stays usable. No thread may use the slab meanwhile and
+ *          objects handed out before are invalid afterwards.
+ *
+ * @retval M3U8_SLAB_STATUS_NO_ERROR    On success.
+ * @retval M3U8_SLAB_STATUS_INVALID_ARG If slab is NULL.
+ */
+int m3u8_slab_reset(m3u8_slab_t* slab);
+
+/**
+ * @brief Reports the footprint of slab.
+ *
+ * @retval M3U8_SLAB_STATUS_NO_ERROR    On success.
+ * @retval M3U8_SLAB_STATUS_INVALID_ARG If slab or stats is NULL.
+ */
+int m3u8_slab_stats(m3u8_slab_t* slab, m3u8_slab_stats_t* stats);
+
+/**
+ * @brief Frees slab and all its objects, in O(chunks).
+ *
+ * @retval M3U8_SLAB_STATUS_NO_ERROR    On success.
+ * @retval M3U8_SLAB_STATUS_INVALID_ARG If slab is NULL or a size class slab.
+ */
+int m3u8_slab_destroy(m3u8_slab_t* slab);
+
+#endif  // __H_M3U8_SLAB__
@@ -0,0 +1,246 @@
+/**
+ * @file snapshot.c
+ * @brief Immutable, reference counted playlist snapshots and their
+ *        lock-free publication.
+ */
+
+#include "snapshot.h"
+
+#include <pthread.h>
+#include <sched.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+#include "memory_usage.h"
+
+#define M3U8_PUBLISHER_CACHE_LINE 64
+
+struct m3u8_snapshot {
+  long                     refs;     /**< references, the publisher's included */
+  unsigned long            version;  /**< publication number, 0 before */
+  void*                    playlist; /**< read-only playlist */
+  m3u8_snapshot_destroy_fn destroy;  /**< releases playlist, may be NULL */
+};
+
+/** @brief readers inside acquire, by parity of the epoch they entered in */
+typedef struct {
+  long active[2];                                             /**< readers per parity */
+  char padding[M3U8_PUBLISHER_CACHE_LINE - 2 * sizeof(long)]; /**< one stripe per line */
+} m3u8_publisher_stripe_t;
+
+struct m3u8_publisher {
+  m3u8_publisher_stripe_t stripes[M3U8_PUBLISHER_STRIPES]; /**< reader counters */
+  m3u8_snapshot_t*        current;                         /**< swapped atomically */
+  unsigned long           epoch;                           /**< bumped by every publication */
+  unsigned long           version;                         /**< last version handed out */
+  pthread_mutex_t         writer;                          /**< serializes publications */
+};
+
+static int __m3u8_publisher_next_stripe = 0;
+
+static __thread int __m3u8_publisher_stripe = -1;
+
+/**
+ * @brief Stripe of the calling thread, assigned round robin on first use.
+ */
+static int __m3u8_publisher_thread_stripe(void) {
+  if (__m3u8_publisher_stripe < 0) {
+    __m3u8_publisher_stripe =
+        __atomic_fetch_add(&__m3u8_publisher_next_stripe, 1, __ATOMIC_RELAXED) % M3U8_PUBLISHER_STRIPES;
+  }
+
+  return __m3u8_publisher_stripe;
+}
+
+/**
+ * @brief Waits until no reader is inside acquire with the epoch being closed.
+ */
+static void __m3u8_publisher_synchronize(m3u8_publisher_t* publisher) {
+  unsigned long epoch = __atomic_fetch_add(&publisher->epoch, 1, __ATOMIC_SEQ_CST);
+
+  for (int i = 0; i < M3U8_PUBLISHER_STRIPES; i++) {
+    while (__atomic_load_n(&publisher->stripes[i].active[epoch & 1], __ATOMIC_SEQ_CST) != 0) {
+      sched_yield();
+    }
+  }
+}
+
+int m3u8_snapshot_create(m3u8_snapshot_t**        snapshot_ptr,
+                         void*                    playlist,
+                         m3u8_snapshot_destroy_fn destroy) {
+  int status = M3U8_SNAPSHOT_STATUS_NO_ERROR;
+
+  m3u8_snapshot_t* snapshot = NULL;
+
+  if (snapshot_ptr == NULL || *snapshot_ptr != NULL || playlist == NULL) {
+    RAISE(M3U8_SNAPSHOT_STATUS_INVALID_ARG, "Invalid arg snapshot_ptr, must point to NULL, or playlist");
+  }
+
+  if ((snapshot = calloc(1, sizeof(m3u8_snapshot_t))) == NULL) {
+    RAISE(M3U8_SNAPSHOT_STATUS_MEM_ALLOC_ERROR, "Unable to allocate snapshot");
+  }
+
+  m3u8_memory_count(M3U8_MEMORY_SNAPSHOT, 1);
+  snapshot->refs = 1;
+  snapshot->playlist = playlist;
+  snapshot->destroy = destroy;
+  *snapshot_ptr = snapshot;
+
+clean_up:
+  return status;
+}
+
+void m3u8_snapshot_destroy_m3u8(void* playlist) {
+  m3u8_destroy((m3u8_t*)playlist);
+}
+
+const void* m3u8_snapshot_playlist(const m3u8_snapshot_t* snapshot) {
+  return snapshot != NULL ? snapshot->playlist : NULL;
+}
+
+unsigned long m3u8_snapshot_version(const m3u8_snapshot_t* snapshot) {
+  return snapshot != NULL ? snapshot->version : 0;
+}
+
+int m3u8_snapshot_retain(m3u8_snapshot_t* snapshot) {
+  int status = M3U8_SNAPSHOT_STATUS_NO_ERROR;
+
+  if (snapshot == NULL) {
+    RAISE(M3U8_SNAPSHOT_STATUS_INVALID_ARG, "Invalid arg snapshot (null)");
+  }
+
+  __atomic_add_fetch(&snapshot->refs, 1, __ATOMIC_RELAXED);
+
+clean_up:
+  return status;
+}
+
+int m3u8_snapshot_release(m3u8_snapshot_t* snapshot) {
+  int status = M3U8_SNAPSHOT_STATUS_NO_ERROR;
+
+  if (snapshot == NULL) {
+    RAISE(M3U8_SNAPSHOT_STATUS_INVALID_ARG, "Invalid arg snapshot (null)");
+  }
+
+  // NOTE: acq_rel so every reader is done with the playlist before destroy
+  if (__atomic_sub_fetch(&snapshot->refs, 1, __ATOMIC_ACQ_REL) == 0) {
+    if (snapshot->destroy != NULL) {
+      snapshot->destroy(snapshot->playlist);
+    }
+
+    m3u8_memory_count(M3U8_MEMORY_SNAPSHOT, -1);
+    free(snapshot);
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_publisher_create(m3u8_publisher_t** publisher_ptr) {
+  int status = M3U8_SNAPSHOT_STATUS_NO_ERROR;
+
+  void* publisher = NULL;
+
+  if (publisher_ptr == NULL || *publisher_ptr != NULL) {
+    RAISE(M3U8_SNAPSHOT_STATUS_INVALID_ARG, "Invalid arg publisher_ptr, must point to NULL");
+  }
+
+  if (posix_memalign(&publisher, M3U8_PUBLISHER_CACHE_LINE, sizeof(m3u8_publisher_t)) != 0) {
+    RAISE(M3U8_SNAPSHOT_STATUS_MEM_ALLOC_ERROR, "Unable to allocate publisher");
+  }
+
+  m3u8_memory_count(M3U8_MEMORY_PUBLISHER, 1);
+  memset(publisher, 0, sizeof(m3u8_publisher_t));
+  pthread_mutex_init(&((m3u8_publisher_t*)publisher)->writer, NULL);
+  *publisher_ptr = publisher;
+
+clean_up:
+  return status;
+}
+
+int m3u8_publisher_publish(m3u8_publisher_t* publisher, m3u8_snapshot_t* snapshot) {
+  int status = M3U8_SNAPSHOT_STATUS_NO_ERROR;
+
+  m3u8_snapshot_t* previous = NULL;
+
+  if (publisher == NULL || snapshot == NULL || snapshot->version != 0) {
+    RAISE(M3U8_SNAPSHOT_STATUS_INVALID_ARG, "Invalid arg publisher or snapshot, already published");
+  }
+
+  pthread_mutex_lock(&publisher->writer);
+  snapshot->version = ++publisher->version;
+  previous = __atomic_exchange_n(&publisher->current, snapshot, __ATOMIC_SEQ_CST);
+
+  // NOTE: readers arriving from now on load the new pointer
+  __m3u8_publisher_synchronize(publisher);
+  pthread_mutex_unlock(&publisher->writer);
+
+  if (previous != NULL) {
+    m3u8_snapshot_release(previous);
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_publisher_acquire(m3u8_publisher_t* publisher, m3u8_snapshot_t** snapshot) {
+  int status = M3U8_SNAPSHOT_STATUS_NO_ERROR;
+
+  m3u8_publisher_stripe_t* stripe = NULL;
+  unsigned long            epoch = 0;
+  m3u8_snapshot_t*         current = NULL;
+
+  if (publisher == NULL || snapshot == NULL) {
+    RAISE(M3U8_SNAPSHOT_STATUS_INVALID_ARG, "Invalid arg publisher or snapshot (null)");
+  }
+
+  stripe = &publisher->stripes[__m3u8_publisher_thread_stripe()];
+
+  // NOTE: enter with a stable epoch, else a publication may not wait for us
+  for (;;) {
+    epoch = __atomic_load_n(&publisher->epoch, __ATOMIC_SEQ_CST);
+    __atomic_add_fetch(&stripe->active[epoch & 1], 1, __ATOMIC_SEQ_CST);
+
+    if (__atomic_load_n(&publisher->epoch, __ATOMIC_SEQ_CST) == epoch) {
+      break;
+    }
+
+    __atomic_sub_fetch(&stripe->active[epoch & 1], 1, __ATOMIC_RELEASE);
+  }
+
+  if ((current = __atomic_load_n(&publisher->current, __ATOMIC_ACQUIRE)) != NULL) {
+    __atomic_add_fetch(&current->refs, 1, __ATOMIC_RELAXED);
+  }
+
+  __atomic_sub_fetch(&stripe->active[epoch & 1], 1, __ATOMIC_RELEASE);
+
+  if (current == NULL) {
+    status = M3U8_SNAPSHOT_STATUS_NOT_FOUND;
+    goto clean_up;
+  }
+
+  *snapshot = current;
+
+clean_up:
+  return status;
+}
+
+int m3u8_publisher_destroy(m3u8_publisher_t* publisher) {
+  int status = M3U8_SNAPSHOT_STATUS_NO_ERROR;
+
+  if (publisher == NULL) {
+    RAISE(M3U8_SNAPSHOT_STATUS_INVALID_ARG, "Invalid arg publisher (null)");
+  }
+
+  if (publisher->current != NULL) {
+    m3u8_snapshot_release(publisher->current);
+  }
+
+  pthread_mutex_destroy(&publisher->writer);
+  m3u8_memory_count(M3U8_MEMORY_PUBLISHER, -1);
+  free(publisher);
+
+clean_up:
+  return status;
+}
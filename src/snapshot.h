@@ -0,0 +1,193 @@
+/**
+ * @file snapshot.h
+ * @brief Immutable, reference counted playlist snapshots and their
+ *        lock-free publication.
+ */
+
+#ifndef __H_M3U8_SNAPSHOT__
+#define __H_M3U8_SNAPSHOT__
+
+#include "m3u8.h"
+
+/**
+ * @brief Operation completed successfully.
+ *
+ * @details Returned when a function completes without error.
+ */
+#define M3U8_SNAPSHOT_STATUS_NO_ERROR        0x08000000
+
+/**
+ * @brief Invalid argument received.
+ *
+ * @details Returned when a parameter is NULL or otherwise invalid.
+ */
+#define M3U8_SNAPSHOT_STATUS_INVALID_ARG     (M3U8_SNAPSHOT_STATUS_NO_ERROR + 0x01)
+
+/**
+ * @brief Memory allocation failure.
+ *
+ * @details Returned when memory allocation fails.
+ */
+#define M3U8_SNAPSHOT_STATUS_MEM_ALLOC_ERROR (M3U8_SNAPSHOT_STATUS_NO_ERROR + 0x02)
+
+/**
+ * @brief Nothing published yet.
+ *
+ * @details Returned when acquiring from a publisher before the first
+ *          m3u8_publisher_publish.
+ */
+#define M3U8_SNAPSHOT_STATUS_NOT_FOUND       (M3U8_SNAPSHOT_STATUS_NO_ERROR + 0x03)
+
+/**
+ * @brief Unknown error occurred.
+ *
+ * @details Returned when an unexpected or undefined error occurs.
+ */
+#define M3U8_SNAPSHOT_STATUS_UNKNOWN_ERROR   (M3U8_SNAPSHOT_STATUS_NO_ERROR + 0x99)
+
+/**
+ * @def M3U8_PUBLISHER_STRIPES
+ * @brief Reader counters of a publisher, each on its own cache line, so
+ *        readers on different cores do not contend.
+ */
+#define M3U8_PUBLISHER_STRIPES               16
+
+/**
+ * @brief Releases the playlist of a snapshot once the last reference goes.
+ */
+typedef void (*m3u8_snapshot_destroy_fn)(void* playlist);
+
+/**
+ * @struct m3u8_snapshot_t
+ * @brief Opaque, reference counted holder of a playlist nobody modifies
+ *        any more.
+ */
+typedef struct m3u8_snapshot m3u8_snapshot_t;
+
+/**
+ * @struct m3u8_publisher_t
+ * @brief Opaque slot holding the latest snapshot of a playlist.
+ *
+ * @details One writer (e.g., the thread reloading a live playlist)
+ *          publishes snapshots; any number of readers acquire the current
+ *          one without taking a lock. A replaced snapshot is reclaimed when
+ *          its last reader releases it.
+ */
+typedef struct m3u8_publisher m3u8_publisher_t;
+
+/**
+ * @brief Wraps a playlist into a snapshot holding one reference.
+ *
+ * @param[out] snapshot_ptr Address where the snapshot will be stored. Must
+ *                          point to NULL.
+ * @param[in]  playlist     Playlist, read-only from now on.
+ * @param[in]  destroy      Called with playlist after the last release, NULL
+ *                          to keep it (e.g., m3u8_snapshot_destroy_m3u8).
+ *
+ * @retval M3U8_SNAPSHOT_STATUS_NO_ERROR        On success.
+ * @retval M3U8_SNAPSHOT_STATUS_INVALID_ARG     If an argument is invalid.
+ * @retval M3U8_SNAPSHOT_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_snapshot_create(m3u8_snapshot_t**        snapshot_ptr,
+                         void*                    playlist,
+                         m3u8_snapshot_destroy_fn destroy);
+
+/**
+ * @brief Destroy callback for snapshots of an m3u8_t.
+ *
+ * @param[in] playlist m3u8_t to destroy.
+ */
+void m3u8_snapshot_destroy_m3u8(void* playlist);
+
+/**
+ * @brief Returns the playlist of a snapshot.
+ *
+ * @param[in] snapshot Snapshot.
+ *
+ * @return the playlist, valid while a reference is held; NULL if snapshot is NULL.
+ */
+const void* m3u8_snapshot_playlist(const m3u8_snapshot_t* snapshot);
+
+/**
+ * @brief Returns the publication number of a snapshot.
+ *
+ * @param[in] snapshot Snapshot.
+ *
+ * @return 0 before publication, then 1 for the first snapshot of a
+ *         publisher, 2 for the next and so on.
+ */
+unsigned long m3u8_snapshot_version(const m3u8_snapshot_t* snapshot);
+
+/**
+ * @brief Takes one more reference on a snapshot.
+ *
+ * @param[in] snapshot Snapshot the caller holds a reference on.
+ *
+ * @retval M3U8_SNAPSHOT_STATUS_NO_ERROR    On success.
+ * @retval M3U8_SNAPSHOT_STATUS_INVALID_ARG If snapshot is NULL.
+ */
+int m3u8_snapshot_retain(m3u8_snapshot_t* snapshot);
+
+/**
+ * @brief Gives back a reference; the last one destroys the snapshot.
+ *
+ * @param[in] snapshot Snapshot.
+ *
+ * @retval M3U8_SNAPSHOT_STATUS_NO_ERROR    On success.
+ * @retval M3U8_SNAPSHOT_STATUS_INVALID_ARG If snapshot is NULL.
+ */
+int m3u8_snapshot_release(m3u8_snapshot_t* snapshot);
+
+/**
+ * @brief Creates an empty publisher.
+ *
+ * @param[out] publisher_ptr Address where the publisher will be stored.
+ *                           Must point to NULL.
+ *
+ * @retval M3U8_SNAPSHOT_STATUS_NO_ERROR        On success.
+ * @retval M3U8_SNAPSHOT_STATUS_INVALID_ARG     If publisher_ptr is invalid.
+ * @retval M3U8_SNAPSHOT_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_publisher_create(m3u8_publisher_t** publisher_ptr);
+
+/**
+ * @brief Makes a snapshot the current one.
+ *
+ * @details Takes over the reference of the caller. The pointer swap is
+ *          atomic; the writer then waits for the readers caught between
+ *          loading the old pointer and counting their reference (a few
+ *          instructions) before dropping the publisher's reference on the
+ *          old snapshot. Readers holding it keep it alive.
+ *
+ * @param[in] publisher Publisher.
+ * @param[in] snapshot  Unpublished snapshot.
+ *
+ * @retval M3U8_SNAPSHOT_STATUS_NO_ERROR    On success.
+ * @retval M3U8_SNAPSHOT_STATUS_INVALID_ARG If an argument is invalid.
+ */
+int m3u8_publisher_publish(m3u8_publisher_t* publisher, m3u8_snapshot_t* snapshot);
+
+/**
+ * @brief Takes a reference on the current snapshot, without locking.
+ *
+ * @param[in]  publisher Publisher.
+ * @param[out] snapshot  Current snapshot; give it back with
+ *                       m3u8_snapshot_release.
+ *
+ * @retval M3U8_SNAPSHOT_STATUS_NO_ERROR    On success.
+ * @retval M3U8_SNAPSHOT_STATUS_INVALID_ARG If an argument is NULL.
+ * @retval M3U8_SNAPSHOT_STATUS_NOT_FOUND   If nothing was published yet.
+ */
+int m3u8_publisher_acquire(m3u8_publisher_t* publisher, m3u8_snapshot_t** snapshot);
+
+/**
+ * @brief Releases a publisher and its reference on the current snapshot.
+ *
+ * @param[in] publisher Publisher nobody acquires from any more.
+ *
+ * @retval M3U8_SNAPSHOT_STATUS_NO_ERROR    On success.
+ * @retval M3U8_SNAPSHOT_STATUS_INVALID_ARG If publisher is NULL.
+ */
+int m3u8_publisher_destroy(m3u8_publisher_t* publisher);
+
+#endif  // __H_M3U8_SNAPSHOT__
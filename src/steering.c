@@ -0,0 +1,871 @@
+/**
+ * @file steering.c
+ * @brief Content steering (EXT-X-CONTENT-STEERING) and pathway selection.
+ */
+
+#include "steering.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+#include "attr.h"
+#include "logger.h"
+
+#define M3U8_STEERING_URI_SIZE       2048
+#define M3U8_STEERING_LATENCY_ALPHA  0.3  /**< weight of a new latency sample */
+#define M3U8_STEERING_ERROR_ALPHA    0.5  /**< weight of a new success or failure */
+#define M3U8_STEERING_ERROR_WEIGHT   4.0  /**< score inflation of a always failing pathway */
+#define M3U8_STEERING_RANK_WEIGHT    0.25 /**< score inflation per priority position */
+
+/** @brief score of one pathway */
+typedef struct {
+  char*                     id;          /**< PATHWAY-ID, "." for variants without one */
+  int                       rank;        /**< position in PATHWAY-PRIORITY, -1 when excluded */
+  double                    latency_ms;  /**< moving average of successful response times */
+  bool                      has_latency; /**< latency_ms holds at least one sample */
+  double                    errors;      /**< moving average of failures, 0 to 1 */
+  long                      benched_ms;  /**< skipped until this monotonic time */
+  const ext_x_stream_inf_t* copy;        /**< copy of the variant being picked, scratch */
+} m3u8_steering_pathway_t;
+
+struct m3u8_steering {
+  pthread_mutex_t          mutex;         /**< guards everything below */
+  m3u8_transport_t*        transport;     /**< transport used for every fetch */
+  m3u8_steering_clock_fn   clock;         /**< monotonic milliseconds */
+  const m3u8_t*            master;        /**< master playlist, not owned */
+  char*                    base_uri;      /**< uri of the master playlist */
+  char*                    manifest_uri;  /**< next manifest to load, NULL without a tag */
+  long                     expires_ms;    /**< monotonic time the manifest expires */
+  long                     ttl_ms;        /**< TTL of the last manifest */
+  bool                     is_refreshing; /**< a reload is in flight */
+  const char*              current;       /**< pathway of the last successful fetch */
+  m3u8_steering_pathway_t* pathways;      /**< pathways offered by the master playlist */
+  int                      pathways_s;    /**< number of entries in pathways */
+};
+
+static long __m3u8_steering_now_ms(void) {
+  struct timespec ts;
+
+  clock_gettime(CLOCK_MONOTONIC, &ts);
+
+  return ts.tv_sec * 1000L + ts.tv_nsec / 1000000L;
+}
+
+/**
+ * @brief Percent-encodes value into out, keeping the RFC 3986 unreserved
+ *        characters.
+ *
+ * @return false when value does not fit in out.
+ */
+static bool __m3u8_steering_encode(const char* value, char* out, size_t out_s) {
+  static const char hex[] = "0123456789ABCDEF";
+
+  size_t n = 0;
+
+  for (; *value != '\0'; value++) {
+    unsigned char c = (unsigned char)*value;
+
+    if ((c >= 'a' && c <= 'z') || (c >= 'A' && c <= 'Z') || (c >= '0' && c <= '9') || c == '-' ||
+        c == '.' || c == '_' || c == '~') {
+      if (n + 1 >= out_s) {
+        return false;
+      }
+
+      out[n++] = (char)c;
+    } else {
+      if (n + 3 >= out_s) {
+        return false;
+      }
+
+      out[n++] = '%';
+      out[n++] = hex[c >> 4];
+      out[n++] = hex[c & 0x0f];
+    }
+  }
+
+  out[n] = '\0';
+
+  return true;
+}
+
+static const char* __m3u8_steering_pathway_of(const ext_x_stream_inf_t* variant) {
+  return variant->pathway_id != NULL ? variant->pathway_id : M3U8_STEERING_DEFAULT_PATHWAY;
+}
+
+static bool __m3u8_steering_streq(const char* a, const char* b) {
+  return a == b || (a != NULL && b != NULL && strcmp(a, b) == 0);
+}
+
+/**
+ * @brief Tells whether two variants are copies of one rendition on
+ *        different pathways, which only differ by uri and PATHWAY-ID.
+ */
+static bool __m3u8_steering_is_copy(const ext_x_stream_inf_t* a, const ext_x_stream_inf_t* b) {
+  return a->bandwidth == b->bandwidth && a->average_bandwidth == b->average_bandwidth &&
+         __m3u8_steering_streq(a->resolution, b->resolution) &&
+         __m3u8_steering_streq(a->codecs, b->codecs);
+}
+
+/**
+ * @brief Looks up an attribute of a tag, unquoted and owned by the caller.
+ *
+ * @return M3U8_STEERING_STATUS_NO_ERROR with *value NULL when absent.
+ */
+static int __m3u8_steering_attribute(const char* attributes, m3u8_attr_key_e key, char** value) {
+  int status = M3U8_STEERING_STATUS_NO_ERROR;
+
+  m3u8_attrs_t attrs;
+  const char*  found = NULL;
+
+  memset(&attrs, 0, sizeof(m3u8_attrs_t));
+  *value = NULL;
+
+  if (m3u8_attrs_parse(attributes, &attrs) != M3U8_ATTR_STATUS_NO_ERROR) {
+    RAISE(M3U8_STEERING_STATUS_MEM_ALLOC_ERROR, "Unable to parse tag attributes");
+  }
+
+  if (m3u8_attrs_get(&attrs, key, &found) == M3U8_ATTR_STATUS_NO_ERROR &&
+      (*value = strdup(found)) == NULL) {
+    RAISE(M3U8_STEERING_STATUS_MEM_ALLOC_ERROR, "Unable to copy attribute %s", m3u8_attr_key_name(key));
+  }
+
+clean_up:
+  m3u8_attrs_destroy(&attrs);
+
+  return status;
+}
+
+static const char* __m3u8_json_space(const char* pivot) {
+  while (*pivot == ' ' || *pivot == '\t' || *pivot == '\r' || *pivot == '\n') {
+    pivot++;
+  }
+
+  return pivot;
+}
+
+/**
+ * @brief Reads a JSON string, decoding escapes into an owned copy.
+ *
+ * @details Escaped code points outside ASCII are replaced by '?', steering
+ *          manifests only carry uris and pathway ids.
+ *
+ * @param pivot first character, must be '"';
+ * @param out   decoded copy, NULL to skip the string.
+ *
+ * @return the character after the closing quote, NULL when malformed.
+ */
+static const char* __m3u8_json_string(const char* pivot, char** out) {
+  const char* end = NULL;
+  char*       cursor = NULL;
+
+  if (*pivot++ != '"') {
+    return NULL;
+  }
+
+  for (end = pivot; *end != '"'; end++) {
+    if (*end == 0 || (*end == '\\' && *++end == 0)) {
+      return NULL;
+    }
+  }
+
+  if (out == NULL) {
+    return end + 1;
+  }
+
+  if ((*out = cursor = malloc(end - pivot + 1)) == NULL) {
+    return NULL;
+  }
+
+  while (pivot < end) {
+    char escaped = 0;
+
+    if (*pivot != '\\') {
+      *cursor++ = *pivot++;
+      continue;
+    }
+
+    switch ((escaped = pivot[1])) {
+      case 'n': *cursor++ = '\n'; break;
+      case 't': *cursor++ = '\t'; break;
+      case 'r': *cursor++ = '\r'; break;
+      case 'b': *cursor++ = '\b'; break;
+      case 'f': *cursor++ = '\f'; break;
+      case 'u': {
+        unsigned int point = 0;
+
+        if (sscanf(pivot + 2, "%4x", &point) != 1) {
+          free(*out);
+          *out = NULL;
+          return NULL;
+        }
+
+        *cursor++ = point < 0x80 ? (char)point : '?';
+        pivot += 4;
+        break;
+      }
+      default: *cursor++ = escaped; break;
+    }
+
+    pivot += 2;
+  }
+
+  *cursor = 0;
+
+  return end + 1;
+}
+
+/**
+ * @brief Skips any JSON value, nested objects and arrays included.
+ *
+ * @return the character after the value, NULL when malformed.
+ */
+static const char* __m3u8_json_skip(const char* pivot) {
+  int depth = 0;
+
+  do {
+    pivot = __m3u8_json_space(pivot);
+
+    if (*pivot == '"') {
+      pivot = __m3u8_json_string(pivot, NULL);
+    } else if (*pivot == '{' || *pivot == '[') {
+      depth++;
+      pivot++;
+    } else if (*pivot == '}' || *pivot == ']') {
+      depth--;
+      pivot++;
+    } else if (*pivot == ',' || *pivot == ':') {
+      pivot++;
+    } else if (*pivot != 0) {
+      pivot += strcspn(pivot, ",:{}[]\" \t\r\n");
+    } else {
+      return NULL;
+    }
+  } while (pivot != NULL && depth > 0);
+
+  return depth < 0 ? NULL : pivot;
+}
+
+/**
+ * @brief Reads the PATHWAY-PRIORITY array of strings.
+ */
+static const char* __m3u8_json_pathways(const char* pivot, m3u8_steering_manifest_t* manifest) {
+  if (*pivot++ != '[') {
+    return NULL;
+  }
+
+  for (pivot = __m3u8_json_space(pivot); *pivot != ']';) {
+    char** grown = realloc(manifest->pathways, (manifest->pathways_s + 1) * sizeof(char*));
+
+    if (grown == NULL) {
+      return NULL;
+    }
+
+    manifest->pathways = grown;
+
+    if ((pivot = __m3u8_json_string(pivot, &manifest->pathways[manifest->pathways_s])) == NULL) {
+      return NULL;
+    }
+
+    manifest->pathways_s++;
+    pivot = __m3u8_json_space(pivot);
+
+    if (*pivot == ',') {
+      pivot = __m3u8_json_space(pivot + 1);
+    } else if (*pivot != ']') {
+      return NULL;
+    }
+  }
+
+  return pivot + 1;
+}
+
+int m3u8_steering_parse_tag(const char* attributes, ext_x_content_steering_t* steering) {
+  int status = M3U8_STEERING_STATUS_NO_ERROR;
+
+  if (attributes == NULL || steering == NULL) {
+    RAISE(M3U8_STEERING_STATUS_INVALID_ARG, "Invalid arg attributes or steering (null)");
+  }
+
+  memset(steering, 0, sizeof(ext_x_content_steering_t));
+
+  if ((status = __m3u8_steering_attribute(attributes, M3U8_ATTR_KEY_SERVER_URI,
+                                           &steering->server_uri)) != M3U8_STEERING_STATUS_NO_ERROR ||
+      (status = __m3u8_steering_attribute(attributes, M3U8_ATTR_KEY_PATHWAY_ID,
+                                           &steering->pathway_id)) != M3U8_STEERING_STATUS_NO_ERROR) {
+    goto clean_up;
+  }
+
+  if (steering->server_uri == NULL) {
+    RAISE(M3U8_STEERING_STATUS_FORMAT_ERROR, "EXT-X-CONTENT-STEERING without SERVER-URI");
+  }
+
+clean_up:
+  if (status != M3U8_STEERING_STATUS_NO_ERROR && status != M3U8_STEERING_STATUS_INVALID_ARG) {
+    m3u8_steering_tag_destroy(steering);
+  }
+
+  return status;
+}
+
+int m3u8_steering_parse_pathway(const char* attributes, char** pathway_id) {
+  int status = M3U8_STEERING_STATUS_NO_ERROR;
+
+  if (attributes == NULL || pathway_id == NULL) {
+    RAISE(M3U8_STEERING_STATUS_INVALID_ARG, "Invalid arg attributes or pathway_id (null)");
+  }
+
+  status = __m3u8_steering_attribute(attributes, M3U8_ATTR_KEY_PATHWAY_ID, pathway_id);
+
+clean_up:
+  return status;
+}
+
+int m3u8_steering_tag_destroy(ext_x_content_steering_t* steering) {
+  int status = M3U8_STEERING_STATUS_NO_ERROR;
+
+  if (steering == NULL) {
+    RAISE(M3U8_STEERING_STATUS_INVALID_ARG, "Invalid arg steering (null)");
+  }
+
+  free(steering->server_uri);
+  free(steering->pathway_id);
+  memset(steering, 0, sizeof(ext_x_content_steering_t));
+
+clean_up:
+  return status;
+}
+
+int m3u8_steering_parse_manifest(const char* json, m3u8_steering_manifest_t* manifest) {
+  int status = M3U8_STEERING_STATUS_NO_ERROR;
+
+  const char* pivot = json;
+  bool        has_pathways = false;
+
+  if (json == NULL || manifest == NULL) {
+    RAISE(M3U8_STEERING_STATUS_INVALID_ARG, "Invalid arg json or manifest (null)");
+  }
+
+  memset(manifest, 0, sizeof(m3u8_steering_manifest_t));
+  manifest->ttl = M3U8_STEERING_DEFAULT_TTL;
+
+  if (*(pivot = __m3u8_json_space(pivot)) != '{') {
+    RAISE(M3U8_STEERING_STATUS_FORMAT_ERROR, "Steering manifest is not a JSON object");
+  }
+
+  for (pivot = __m3u8_json_space(pivot + 1); *pivot != '}';) {
+    char* key = NULL;
+
+    if ((pivot = __m3u8_json_string(pivot, &key)) == NULL) {
+      RAISE(M3U8_STEERING_STATUS_FORMAT_ERROR, "Malformed key in steering manifest");
+    }
+
+    if (*(pivot = __m3u8_json_space(pivot)) != ':') {
+      free(key);
+      RAISE(M3U8_STEERING_STATUS_FORMAT_ERROR, "Missing ':' in steering manifest");
+    }
+
+    pivot = __m3u8_json_space(pivot + 1);
+
+    if (strcmp(key, "VERSION") == 0) {
+      manifest->version = (int)strtol(pivot, (char**)&pivot, 10);
+    } else if (strcmp(key, "TTL") == 0) {
+      manifest->ttl = strtol(pivot, (char**)&pivot, 10);
+    } else if (strcmp(key, "RELOAD-URI") == 0 && manifest->reload_uri == NULL) {
+      pivot = __m3u8_json_string(pivot, &manifest->reload_uri);
+    } else if (strcmp(key, "PATHWAY-PRIORITY") == 0 && !has_pathways) {
+      pivot = __m3u8_json_pathways(pivot, manifest);
+      has_pathways = true;
+    } else {
+      pivot = __m3u8_json_skip(pivot);
+    }
+
+    free(key);
+
+    if (pivot == NULL) {
+      RAISE(M3U8_STEERING_STATUS_FORMAT_ERROR, "Malformed value in steering manifest");
+    }
+
+    if (*(pivot = __m3u8_json_space(pivot)) == ',') {
+      pivot = __m3u8_json_space(pivot + 1);
+    } else if (*pivot != '}') {
+      RAISE(M3U8_STEERING_STATUS_FORMAT_ERROR, "Missing ',' in steering manifest");
+    }
+  }
+
+  if (manifest->version != 1 || !has_pathways || manifest->ttl <= 0) {
+    RAISE(M3U8_STEERING_STATUS_FORMAT_ERROR, "Unsupported steering manifest (VERSION %d)",
+          manifest->version);
+  }
+
+clean_up:
+  if (status != M3U8_STEERING_STATUS_NO_ERROR && status != M3U8_STEERING_STATUS_INVALID_ARG) {
+    m3u8_steering_manifest_destroy(manifest);
+  }
+
+  return status;
+}
+
+int m3u8_steering_manifest_destroy(m3u8_steering_manifest_t* manifest) {
+  int status = M3U8_STEERING_STATUS_NO_ERROR;
+
+  if (manifest == NULL) {
+    RAISE(M3U8_STEERING_STATUS_INVALID_ARG, "Invalid arg manifest (null)");
+  }
+
+  for (int i = 0; i < manifest->pathways_s; i++) {
+    free(manifest->pathways[i]);
+  }
+
+  free(manifest->pathways);
+  free(manifest->reload_uri);
+  memset(manifest, 0, sizeof(m3u8_steering_manifest_t));
+
+clean_up:
+  return status;
+}
+
+static m3u8_steering_pathway_t* __m3u8_steering_find(m3u8_steering_t* steering, const char* id) {
+  for (int i = 0; i < steering->pathways_s; i++) {
+    if (strcmp(steering->pathways[i].id, id) == 0) {
+      return &steering->pathways[i];
+    }
+  }
+
+  return NULL;
+}
+
+int m3u8_steering_create(m3u8_steering_t** steering_ptr,
+                         m3u8_transport_t* transport,
+                         const m3u8_t*     master,
+                         const char*       base_uri) {
+  int status = M3U8_STEERING_STATUS_NO_ERROR;
+
+  m3u8_steering_t*          steering = NULL;
+  const ext_x_stream_inf_t* variant = NULL;
+  const char*               preferred = NULL;
+  char                      uri[M3U8_STEERING_URI_SIZE];
+
+  if (steering_ptr == NULL || *steering_ptr != NULL) {
+    RAISE(M3U8_STEERING_STATUS_INVALID_ARG, "Invalid arg steering_ptr, must point to NULL");
+  }
+
+  if (transport == NULL || master == NULL || base_uri == NULL) {
+    RAISE(M3U8_STEERING_STATUS_INVALID_ARG, "Invalid arg transport, master or base_uri (null)");
+  }
+
+  if ((steering = calloc(1, sizeof(m3u8_steering_t))) == NULL) {
+    RAISE(M3U8_STEERING_STATUS_MEM_ALLOC_ERROR, "Unable to allocate steering state");
+  }
+
+  pthread_mutex_init(&steering->mutex, NULL);
+  steering->transport = transport;
+  steering->clock = __m3u8_steering_now_ms;
+  steering->master = master;
+  steering->ttl_ms = M3U8_STEERING_DEFAULT_TTL * 1000L;
+
+  if ((steering->base_uri = strdup(base_uri)) == NULL) {
+    RAISE(M3U8_STEERING_STATUS_MEM_ALLOC_ERROR, "Unable to copy base_uri");
+  }
+
+  if (master->content_steering != NULL && master->content_steering->server_uri != NULL) {
+    if (m3u8_resolve_uri(base_uri, master->content_steering->server_uri, uri, sizeof(uri)) !=
+        M3U8_STATUS_NO_ERROR) {
+      RAISE(M3U8_STEERING_STATUS_INVALID_ARG, "Unable to resolve SERVER-URI");
+    }
+
+    if ((steering->manifest_uri = strdup(uri)) == NULL) {
+      RAISE(M3U8_STEERING_STATUS_MEM_ALLOC_ERROR, "Unable to copy SERVER-URI");
+    }
+
+    preferred = master->content_steering->pathway_id;
+  }
+
+  for (variant = master->x_stream_inf; variant != NULL; variant = variant->__next) {
+    const char*              id = __m3u8_steering_pathway_of(variant);
+    m3u8_steering_pathway_t* grown = NULL;
+
+    if (__m3u8_steering_find(steering, id) != NULL) {
+      continue;
+    }
+
+    grown = realloc(steering->pathways, (steering->pathways_s + 1) * sizeof(*grown));
+
+    if (grown == NULL) {
+      RAISE(M3U8_STEERING_STATUS_MEM_ALLOC_ERROR, "Unable to allocate pathway");
+    }
+
+    steering->pathways = grown;
+    memset(&grown[steering->pathways_s], 0, sizeof(*grown));
+
+    if ((grown[steering->pathways_s].id = strdup(id)) == NULL) {
+      RAISE(M3U8_STEERING_STATUS_MEM_ALLOC_ERROR, "Unable to copy pathway id");
+    }
+
+    // NOTE: until a manifest arrives, PATHWAY-ID of the tag comes first and
+    // the others follow in playlist order
+    grown[steering->pathways_s].rank = steering->pathways_s + 1;
+    steering->pathways_s++;
+  }
+
+  if (preferred != NULL && __m3u8_steering_find(steering, preferred) != NULL) {
+    __m3u8_steering_find(steering, preferred)->rank = 0;
+  }
+
+  *steering_ptr = steering;
+
+clean_up:
+  if (status != M3U8_STEERING_STATUS_NO_ERROR && steering != NULL) {
+    m3u8_steering_destroy(steering);
+  }
+
+  return status;
+}
+
+/**
+ * @brief Applies a decoded manifest; called with the mutex held.
+ */
+static int __m3u8_steering_apply(m3u8_steering_t*          steering,
+                                 m3u8_steering_manifest_t* manifest,
+                                 const char*               loaded_uri) {
+  int status = M3U8_STEERING_STATUS_NO_ERROR;
+
+  char uri[M3U8_STEERING_URI_SIZE];
+
+  if (manifest->reload_uri != NULL) {
+    if (m3u8_resolve_uri(loaded_uri, manifest->reload_uri, uri, sizeof(uri)) !=
+        M3U8_STATUS_NO_ERROR) {
+      RAISE(M3U8_STEERING_STATUS_FORMAT_ERROR, "Unable to resolve RELOAD-URI");
+    }
+
+    free(steering->manifest_uri);
+
+    if ((steering->manifest_uri = strdup(uri)) == NULL) {
+      RAISE(M3U8_STEERING_STATUS_MEM_ALLOC_ERROR, "Unable to copy RELOAD-URI");
+    }
+  }
+
+  for (int i = 0; i < steering->pathways_s; i++) {
+    steering->pathways[i].rank = -1;
+  }
+
+  for (int i = manifest->pathways_s - 1; i >= 0; i--) {
+    m3u8_steering_pathway_t* pathway = __m3u8_steering_find(steering, manifest->pathways[i]);
+
+    if (pathway != NULL) {
+      pathway->rank = i;
+    }
+  }
+
+  steering->ttl_ms = manifest->ttl * 1000L;
+
+clean_up:
+  return status;
+}
+
+int m3u8_steering_set_clock(m3u8_steering_t* steering, m3u8_steering_clock_fn clock) {
+  int status = M3U8_STEERING_STATUS_NO_ERROR;
+
+  if (steering == NULL) {
+    RAISE(M3U8_STEERING_STATUS_INVALID_ARG, "Invalid arg steering (null)");
+  }
+
+  steering->clock = clock != NULL ? clock : __m3u8_steering_now_ms;
+
+clean_up:
+  return status;
+}
+
+int m3u8_steering_refresh(m3u8_steering_t* steering, const m3u8_fetch_options_t* options) {
+  int status = M3U8_STEERING_STATUS_NO_ERROR;
+
+  m3u8_steering_manifest_t manifest = {0};
+  char                     uri[M3U8_STEERING_URI_SIZE];
+  char                     pathway[M3U8_STEERING_URI_SIZE];
+  char*                    body = NULL;
+  size_t                   body_s = 0;
+  int                      result = M3U8_FETCH_STATUS_NO_ERROR;
+  int                      uri_s = 0;
+
+  if (steering == NULL) {
+    RAISE(M3U8_STEERING_STATUS_INVALID_ARG, "Invalid arg steering (null)");
+  }
+
+  pthread_mutex_lock(&steering->mutex);
+
+  if (steering->manifest_uri == NULL || steering->is_refreshing ||
+      steering->clock() < steering->expires_ms) {
+    pthread_mutex_unlock(&steering->mutex);
+    goto clean_up;
+  }
+
+  // NOTE: the server learns the pathway in use through _HLS_pathway, an id
+  // from the playlist may hold characters with a meaning in a query
+  if (steering->current == NULL) {
+    uri_s = snprintf(uri, sizeof(uri), "%s", steering->manifest_uri);
+  } else if (__m3u8_steering_encode(steering->current, pathway, sizeof(pathway))) {
+    uri_s = snprintf(uri, sizeof(uri), "%s%c_HLS_pathway=%s", steering->manifest_uri,
+                     strchr(steering->manifest_uri, '?') != NULL ? '&' : '?', pathway);
+  } else {
+    uri_s = -1;
+  }
+
+  // NOTE: a truncated uri would ask the server for another manifest or
+  // pathway; wait for the next TTL like after a failed fetch
+  if (uri_s < 0 || (size_t)uri_s >= sizeof(uri)) {
+    steering->expires_ms = steering->clock() + steering->ttl_ms;
+    pthread_mutex_unlock(&steering->mutex);
+    RAISE(M3U8_STEERING_STATUS_FORMAT_ERROR, "Steering manifest uri of %s does not fit in %d bytes",
+          steering->manifest_uri, M3U8_STEERING_URI_SIZE);
+  }
+
+  steering->is_refreshing = true;
+  pthread_mutex_unlock(&steering->mutex);
+
+  if ((result = m3u8_fetch(steering->transport, uri, options, &body, &body_s)) !=
+      M3U8_FETCH_STATUS_NO_ERROR) {
+    status = M3U8_STEERING_STATUS_FETCH_ERROR;
+  } else {
+    status = m3u8_steering_parse_manifest(body, &manifest);
+  }
+
+  pthread_mutex_lock(&steering->mutex);
+
+  if (status == M3U8_STEERING_STATUS_NO_ERROR) {
+    status = __m3u8_steering_apply(steering, &manifest, uri);
+  }
+
+  steering->expires_ms = steering->clock() + steering->ttl_ms;
+  steering->is_refreshing = false;
+  pthread_mutex_unlock(&steering->mutex);
+
+  if (status != M3U8_STEERING_STATUS_NO_ERROR) {
+    ERROR("Steering manifest %s not applied (0x%x), keeping the previous priority", uri, status);
+  }
+
+clean_up:
+  if (manifest.pathways != NULL || manifest.reload_uri != NULL) {
+    m3u8_steering_manifest_destroy(&manifest);
+  }
+
+  free(body);
+
+  return status;
+}
+
+int m3u8_steering_report(m3u8_steering_t* steering, const char* pathway_id, bool is_ok,
+                         long elapsed_ms) {
+  int status = M3U8_STEERING_STATUS_NO_ERROR;
+
+  m3u8_steering_pathway_t* pathway = NULL;
+
+  if (steering == NULL || pathway_id == NULL) {
+    RAISE(M3U8_STEERING_STATUS_INVALID_ARG, "Invalid arg steering or pathway_id (null)");
+  }
+
+  pthread_mutex_lock(&steering->mutex);
+
+  if ((pathway = __m3u8_steering_find(steering, pathway_id)) == NULL) {
+    pthread_mutex_unlock(&steering->mutex);
+    RAISE(M3U8_STEERING_STATUS_NOT_FOUND, "Unknown pathway %s", pathway_id);
+  }
+
+  if (is_ok) {
+    pathway->latency_ms = pathway->has_latency
+                              ? pathway->latency_ms +
+                                    M3U8_STEERING_LATENCY_ALPHA * (elapsed_ms - pathway->latency_ms)
+                              : elapsed_ms;
+    pathway->has_latency = true;
+    pathway->errors -= M3U8_STEERING_ERROR_ALPHA * pathway->errors;
+    pathway->benched_ms = 0;
+    steering->current = pathway->id;
+  } else {
+    pathway->errors += M3U8_STEERING_ERROR_ALPHA * (1.0 - pathway->errors);
+    pathway->benched_ms = steering->clock() + M3U8_STEERING_PENALTY_MS;
+  }
+
+  pthread_mutex_unlock(&steering->mutex);
+
+clean_up:
+  return status;
+}
+
+/**
+ * @brief Picks the best copy of variant among untried pathways; called with
+ *        the mutex held, which also guards the copy scratch of each pathway.
+ *
+ * @param tried pathways already tried by the caller, indexed like pathways.
+ *
+ * @return index of the pathway, -1 when none carries the variant.
+ */
+static int __m3u8_steering_pick(m3u8_steering_t*           steering,
+                                const ext_x_stream_inf_t*  variant,
+                                const bool*                tried,
+                                const ext_x_stream_inf_t** chosen) {
+  long                      now_ms = steering->clock();
+  double                    fastest = -1;
+  double                    best_score = 0;
+  int                       best = -1;
+  bool                      best_benched = true;
+
+  for (int i = 0; i < steering->pathways_s; i++) {
+    steering->pathways[i].copy = NULL;
+
+    if (steering->pathways[i].has_latency &&
+        (fastest < 0 || steering->pathways[i].latency_ms < fastest)) {
+      fastest = steering->pathways[i].latency_ms;
+    }
+  }
+
+  for (const ext_x_stream_inf_t* copy = steering->master->x_stream_inf; copy != NULL;
+       copy = copy->__next) {
+    m3u8_steering_pathway_t* pathway = __m3u8_steering_find(steering, __m3u8_steering_pathway_of(copy));
+
+    if (pathway != NULL && pathway->copy == NULL && __m3u8_steering_is_copy(copy, variant)) {
+      pathway->copy = copy;
+    }
+  }
+
+  for (int i = 0; i < steering->pathways_s; i++) {
+    m3u8_steering_pathway_t* pathway = &steering->pathways[i];
+    bool                     is_benched = pathway->benched_ms > now_ms;
+    double                   latency = pathway->has_latency ? pathway->latency_ms : fastest;
+    double                   score = 0;
+
+    if (pathway->copy == NULL || pathway->rank < 0 || (tried != NULL && tried[i])) {
+      continue;
+    }
+
+    score = (1.0 + (latency > 0 ? latency : 0)) *
+            (1.0 + M3U8_STEERING_ERROR_WEIGHT * pathway->errors) *
+            (1.0 + M3U8_STEERING_RANK_WEIGHT * pathway->rank);
+
+    // NOTE: a benched pathway only wins when every other one is benched too
+    if (best < 0 || (best_benched && !is_benched) ||
+        (best_benched == is_benched && score < best_score)) {
+      best = i;
+      best_score = score;
+      best_benched = is_benched;
+    }
+  }
+
+  if (best >= 0) {
+    *chosen = steering->pathways[best].copy;
+  }
+
+  return best;
+}
+
+int m3u8_steering_select(m3u8_steering_t*          steering,
+                         const ext_x_stream_inf_t* variant,
+                         const ext_x_stream_inf_t** chosen) {
+  int status = M3U8_STEERING_STATUS_NO_ERROR;
+
+  if (steering == NULL || variant == NULL || chosen == NULL) {
+    RAISE(M3U8_STEERING_STATUS_INVALID_ARG, "Invalid arg steering, variant or chosen (null)");
+  }
+
+  pthread_mutex_lock(&steering->mutex);
+
+  if (__m3u8_steering_pick(steering, variant, NULL, chosen) < 0) {
+    status = M3U8_STEERING_STATUS_NOT_FOUND;
+  }
+
+  pthread_mutex_unlock(&steering->mutex);
+
+clean_up:
+  return status;
+}
+
+int m3u8_steering_fetch(m3u8_steering_t*            steering,
+                        const ext_x_stream_inf_t*   variant,
+                        const m3u8_fetch_options_t* options,
+                        char**                      body,
+                        size_t*                     body_s) {
+  int status = M3U8_STEERING_STATUS_NOT_FOUND;
+
+  const ext_x_stream_inf_t* chosen = NULL;
+  bool*                     tried = NULL;
+  char                      uri[M3U8_STEERING_URI_SIZE];
+  int                       result = M3U8_FETCH_STATUS_NO_ERROR;
+
+  if (steering == NULL || variant == NULL || body == NULL || body_s == NULL) {
+    RAISE(M3U8_STEERING_STATUS_INVALID_ARG, "Invalid arg steering, variant, body or body_s (null)");
+  }
+
+  if ((tried = calloc(steering->pathways_s + 1, sizeof(bool))) == NULL) {
+    RAISE(M3U8_STEERING_STATUS_MEM_ALLOC_ERROR, "Unable to allocate tried pathways");
+  }
+
+  m3u8_steering_refresh(steering, options);  // NOTE: a stale priority still routes
+
+  for (;;) {
+    long started_ms = 0;
+    int  index = -1;
+
+    pthread_mutex_lock(&steering->mutex);
+    index = __m3u8_steering_pick(steering, variant, tried, &chosen);
+    pthread_mutex_unlock(&steering->mutex);
+
+    if (index < 0) {
+      break;
+    }
+
+    tried[index] = true;
+
+    if (chosen->uri == NULL ||
+        m3u8_resolve_uri(steering->base_uri, chosen->uri, uri, sizeof(uri)) != M3U8_STATUS_NO_ERROR) {
+      m3u8_steering_report(steering, steering->pathways[index].id, false, 0);
+      status = M3U8_STEERING_STATUS_FETCH_ERROR;
+      continue;
+    }
+
+    started_ms = steering->clock();
+    result = m3u8_fetch(steering->transport, uri, options, body, body_s);
+
+    if (result == M3U8_FETCH_STATUS_CANCELLED) {
+      status = M3U8_STEERING_STATUS_CANCELLED;
+      break;
+    }
+
+    m3u8_steering_report(steering, steering->pathways[index].id,
+                         result == M3U8_FETCH_STATUS_NO_ERROR,
+                         steering->clock() - started_ms);
+
+    if (result == M3U8_FETCH_STATUS_NO_ERROR) {
+      status = M3U8_STEERING_STATUS_NO_ERROR;
+      break;
+    }
+
+    WARN("Pathway %s failed (0x%x), failing over", steering->pathways[index].id, result);
+    status = M3U8_STEERING_STATUS_FETCH_ERROR;
+  }
+
+clean_up:
+  free(tried);
+
+  return status;
+}
+
+int m3u8_steering_destroy(m3u8_steering_t* steering) {
+  int status = M3U8_STEERING_STATUS_NO_ERROR;
+
+  if (steering == NULL) {
+    RAISE(M3U8_STEERING_STATUS_INVALID_ARG, "Invalid arg steering (null)");
+  }
+
+  for (int i = 0; i < steering->pathways_s; i++) {
+    free(steering->pathways[i].id);
+  }
+
+  pthread_mutex_destroy(&steering->mutex);
+  free(steering->pathways);
+  free(steering->manifest_uri);
+  free(steering->base_uri);
+  free(steering);
+
+clean_up:
+  return status;
+}
@@ -0,0 +1,303 @@
+/**
+ * @file steering.h
+ * @brief Content steering (EXT-X-CONTENT-STEERING) and pathway selection.
+ */
+
+#ifndef __H_M3U8_STEERING__
+#define __H_M3U8_STEERING__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+#include "fetch.h"
+#include "m3u8.h"
+#include "transport.h"
+
+/**
+ * @brief Operation completed successfully.
+ *
+ * @details Returned when a function completes without error.
+ */
+#define M3U8_STEERING_STATUS_NO_ERROR        0x01000000
+
+/**
+ * @brief Invalid argument received.
+ *
+ * @details Returned when a parameter is NULL or otherwise invalid.
+ */
+#define M3U8_STEERING_STATUS_INVALID_ARG     (M3U8_STEERING_STATUS_NO_ERROR + 0x01)
+
+/**
+ * @brief Memory allocation failure.
+ *
+ * @details Returned when memory allocation or reallocation fails.
+ */
+#define M3U8_STEERING_STATUS_MEM_ALLOC_ERROR (M3U8_STEERING_STATUS_NO_ERROR + 0x02)
+
+/**
+ * @brief Malformed tag attributes or steering manifest.
+ *
+ * @details Returned when SERVER-URI is missing, the manifest is not a
+ *          JSON object with a PATHWAY-PRIORITY array, or the manifest uri
+ *          with its _HLS_pathway query is too long to request.
+ */
+#define M3U8_STEERING_STATUS_FORMAT_ERROR    (M3U8_STEERING_STATUS_NO_ERROR + 0x03)
+
+/**
+ * @brief The steering manifest or a variant could not be fetched.
+ *
+ * @details Returned when every pathway carrying the variant failed.
+ */
+#define M3U8_STEERING_STATUS_FETCH_ERROR     (M3U8_STEERING_STATUS_NO_ERROR + 0x04)
+
+/**
+ * @brief No pathway carries the requested variant.
+ *
+ * @details Returned when the steering manifest excludes every pathway the
+ *          variant is offered on.
+ */
+#define M3U8_STEERING_STATUS_NOT_FOUND       (M3U8_STEERING_STATUS_NO_ERROR + 0x05)
+
+/**
+ * @brief The cancellation token of the fetch was triggered.
+ *
+ * @details Returned without failing over to another pathway.
+ */
+#define M3U8_STEERING_STATUS_CANCELLED       (M3U8_STEERING_STATUS_NO_ERROR + 0x06)
+
+/**
+ * @brief Unknown error occurred.
+ *
+ * @details Returned when an unexpected or undefined error occurs.
+ */
+#define M3U8_STEERING_STATUS_UNKNOWN_ERROR   (M3U8_STEERING_STATUS_NO_ERROR + 0x99)
+
+/**
+ * @def M3U8_STEERING_DEFAULT_PATHWAY
+ * @brief Pathway of variants without a PATHWAY-ID attribute.
+ */
+#define M3U8_STEERING_DEFAULT_PATHWAY        "."
+
+/**
+ * @def M3U8_STEERING_DEFAULT_TTL
+ * @brief Seconds a steering manifest is cached when it has no TTL.
+ */
+#define M3U8_STEERING_DEFAULT_TTL            300
+
+/**
+ * @def M3U8_STEERING_PENALTY_MS
+ * @brief Milliseconds a pathway is skipped after a failed fetch.
+ */
+#define M3U8_STEERING_PENALTY_MS             10000
+
+/**
+ * @struct m3u8_steering_manifest_t
+ * @brief Decoded steering manifest.
+ *
+ * @details PATHWAY-CLONES is not supported and skipped.
+ */
+typedef struct {
+  int    version;     /**< VERSION, must be 1 */
+  long   ttl;         /**< TTL in seconds */
+  char*  reload_uri;  /**< RELOAD-URI, NULL when absent */
+  char** pathways;    /**< PATHWAY-PRIORITY, most preferred first */
+  int    pathways_s;  /**< number of entries in pathways */
+} m3u8_steering_manifest_t;
+
+/**
+ * @struct m3u8_steering_t
+ * @brief Opaque per-session steering state, thread safe.
+ */
+typedef struct m3u8_steering m3u8_steering_t;
+
+/**
+ * @brief Source of monotonic milliseconds used for TTLs and pathway scores.
+ */
+typedef long (*m3u8_steering_clock_fn)(void);
+
+/**
+ * @brief Parses the attribute list of an EXT-X-CONTENT-STEERING tag.
+ *
+ * @param[in]  attributes Attribute list (e.g., SERVER-URI="/steer",PATHWAY-ID="A").
+ * @param[out] steering   Tag with owned, unquoted strings; release it with
+ *                        m3u8_steering_tag_destroy.
+ *
+ * @retval M3U8_STEERING_STATUS_NO_ERROR        On success.
+ * @retval M3U8_STEERING_STATUS_INVALID_ARG     If an argument is NULL.
+ * @retval M3U8_STEERING_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ * @retval M3U8_STEERING_STATUS_FORMAT_ERROR    If SERVER-URI is missing.
+ */
+int m3u8_steering_parse_tag(const char* attributes, ext_x_content_steering_t* steering);
+
+/**
+ * @brief Reads the PATHWAY-ID attribute of an EXT-X-STREAM-INF tag.
+ *
+ * @param[in]  attributes Attribute list of the tag.
+ * @param[out] pathway_id Owned, unquoted pathway, NULL when absent.
+ *
+ * @retval M3U8_STEERING_STATUS_NO_ERROR        On success.
+ * @retval M3U8_STEERING_STATUS_INVALID_ARG     If an argument is NULL.
+ * @retval M3U8_STEERING_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_steering_parse_pathway(const char* attributes, char** pathway_id);
+
+/**
+ * @brief Releases the strings of a tag filled by m3u8_steering_parse_tag.
+ *
+ * @param[in] steering Tag to release.
+ *
+ * @retval M3U8_STEERING_STATUS_NO_ERROR    On success.
+ * @retval M3U8_STEERING_STATUS_INVALID_ARG If steering is NULL.
+ */
+int m3u8_steering_tag_destroy(ext_x_content_steering_t* steering);
+
+/**
+ * @brief Decodes a JSON steering manifest.
+ *
+ * @param[in]  json     NUL terminated manifest.
+ * @param[out] manifest Decoded manifest; release it with
+ *                      m3u8_steering_manifest_destroy.
+ *
+ * @retval M3U8_STEERING_STATUS_NO_ERROR        On success.
+ * @retval M3U8_STEERING_STATUS_INVALID_ARG     If an argument is NULL.
+ * @retval M3U8_STEERING_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ * @retval M3U8_STEERING_STATUS_FORMAT_ERROR    If the manifest is malformed.
+ */
+int m3u8_steering_parse_manifest(const char* json, m3u8_steering_manifest_t* manifest);
+
+/**
+ * @brief Releases the contents of a decoded steering manifest.
+ *
+ * @param[in] manifest Manifest to release.
+ *
+ * @retval M3U8_STEERING_STATUS_NO_ERROR    On success.
+ * @retval M3U8_STEERING_STATUS_INVALID_ARG If manifest is NULL.
+ */
+int m3u8_steering_manifest_destroy(m3u8_steering_manifest_t* manifest);
+
+/**
+ * @brief Creates the steering state of a playback session.
+ *
+ * @param[out] steering_ptr Address where the handle will be stored. Must
+ *                          point to NULL.
+ * @param[in]  transport    Transport manifests and variants are fetched with.
+ * @param[in]  master       Parsed master playlist; must outlive the handle.
+ * @param[in]  base_uri     Uri the master playlist was loaded from.
+ *
+ * @retval M3U8_STEERING_STATUS_NO_ERROR        On success.
+ * @retval M3U8_STEERING_STATUS_INVALID_ARG     If an argument is NULL.
+ * @retval M3U8_STEERING_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_steering_create(m3u8_steering_t** steering_ptr,
+                         m3u8_transport_t* transport,
+                         const m3u8_t*     master,
+                         const char*       base_uri);
+
+/**
+ * @brief Replaces the clock of a steering handle.
+ *
+ * @details Lets tests expire a manifest or a benched pathway without
+ *          sleeping. Set it before the handle is shared.
+ *
+ * @param[in] steering Steering handle.
+ * @param[in] clock    Clock to use, NULL for CLOCK_MONOTONIC.
+ *
+ * @retval M3U8_STEERING_STATUS_NO_ERROR    On success.
+ * @retval M3U8_STEERING_STATUS_INVALID_ARG If steering is NULL.
+ */
+int m3u8_steering_set_clock(m3u8_steering_t* steering, m3u8_steering_clock_fn clock);
+
+/**
+ * @brief Reloads the steering manifest once its TTL expired.
+ *
+ * @details A failed reload keeps the previous pathway priority and is
+ *          retried after another TTL, as the steering server may be down
+ *          while every CDN is healthy.
+ *
+ * @param[in] steering Steering handle.
+ * @param[in] options  Limits of the manifest fetch, NULL for none.
+ *
+ * @retval M3U8_STEERING_STATUS_NO_ERROR     On success or when still cached.
+ * @retval M3U8_STEERING_STATUS_INVALID_ARG  If steering is NULL.
+ * @retval M3U8_STEERING_STATUS_FETCH_ERROR  If the manifest could not be fetched.
+ * @retval M3U8_STEERING_STATUS_FORMAT_ERROR If the manifest is malformed or its uri too long.
+ */
+int m3u8_steering_refresh(m3u8_steering_t* steering, const m3u8_fetch_options_t* options);
+
+/**
+ * @brief Feeds the outcome of a fetch into the score of a pathway.
+ *
+ * @details Latencies and errors are tracked as exponentially weighted
+ *          moving averages; a failure also benches the pathway for
+ *          M3U8_STEERING_PENALTY_MS.
+ *
+ * @param[in] steering   Steering handle.
+ * @param[in] pathway_id Pathway the fetch went to.
+ * @param[in] is_ok      Whether the fetch succeeded.
+ * @param[in] elapsed_ms Response time of a successful fetch.
+ *
+ * @retval M3U8_STEERING_STATUS_NO_ERROR    On success.
+ * @retval M3U8_STEERING_STATUS_INVALID_ARG If an argument is NULL.
+ * @retval M3U8_STEERING_STATUS_NOT_FOUND   If the pathway is unknown.
+ */
+int m3u8_steering_report(m3u8_steering_t* steering, const char* pathway_id, bool is_ok,
+                         long elapsed_ms);
+
+/**
+ * @brief Picks the best pathway carrying a variant.
+ *
+ * @details Pathways excluded by the manifest or benched after a failure are
+ *          skipped unless nothing else is left. The others are ranked by
+ *          their latency average, inflated by their error average and by
+ *          their position in PATHWAY-PRIORITY; a pathway never measured is
+ *          assumed as fast as the fastest measured one, so the priority
+ *          decides until measurements say otherwise.
+ *
+ * @param[in]  steering Steering handle.
+ * @param[in]  variant  Any copy of the wanted variant in the master playlist.
+ * @param[out] chosen   Copy of the variant on the best pathway.
+ *
+ * @retval M3U8_STEERING_STATUS_NO_ERROR    On success.
+ * @retval M3U8_STEERING_STATUS_INVALID_ARG If an argument is NULL.
+ * @retval M3U8_STEERING_STATUS_NOT_FOUND   If no allowed pathway carries it.
+ */
+int m3u8_steering_select(m3u8_steering_t*          steering,
+                         const ext_x_stream_inf_t* variant,
+                         const ext_x_stream_inf_t** chosen);
+
+/**
+ * @brief Fetches a variant playlist over the best pathway, failing over.
+ *
+ * @details Reloads an expired steering manifest first, then tries every
+ *          pathway carrying the variant in the order of
+ *          m3u8_steering_select, reporting each outcome.
+ *
+ * @param[in]  steering Steering handle.
+ * @param[in]  variant  Any copy of the wanted variant in the master playlist.
+ * @param[in]  options  Limits applied to each attempt, NULL for none.
+ * @param[out] body     NUL terminated playlist, to be released with free.
+ * @param[out] body_s   Bytes in body, without the NUL.
+ *
+ * @retval M3U8_STEERING_STATUS_NO_ERROR        On success.
+ * @retval M3U8_STEERING_STATUS_INVALID_ARG     If an argument is NULL.
+ * @retval M3U8_STEERING_STATUS_NOT_FOUND       If no allowed pathway carries it.
+ * @retval M3U8_STEERING_STATUS_FETCH_ERROR     If every pathway failed.
+ * @retval M3U8_STEERING_STATUS_CANCELLED       If the token was triggered.
+ */
+int m3u8_steering_fetch(m3u8_steering_t*            steering,
+                        const ext_x_stream_inf_t*   variant,
+                        const m3u8_fetch_options_t* options,
+                        char**                      body,
+                        size_t*                     body_s);
+
+/**
+ * @brief Releases the steering state.
+ *
+ * @param[in] steering Steering handle.
+ *
+ * @retval M3U8_STEERING_STATUS_NO_ERROR    On success.
+ * @retval M3U8_STEERING_STATUS_INVALID_ARG If steering is NULL.
+ */
+int m3u8_steering_destroy(m3u8_steering_t* steering);
+
+#endif  // __H_M3U8_STEERING__
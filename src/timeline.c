@@ -0,0 +1,560 @@
+/**
+ * @file timeline.c
+ * @brief Segment timeline of a media playlist: seek by offset and by
+ *        program-date-time.
+ */
+
+#include "timeline.h"
+
+#include <ctype.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "logger.h"
+
+#define M3U8_TIMELINE_INITIAL_CAPACITY 8
+#define M3U8_TIMELINE_URI_DIGITS       19
+
+/**
+ * @brief Places segment i on the timeline, after segments [0, i).
+ */
+static int __m3u8_timeline_account(m3u8_media_t* media, int i) {
+  int status = M3U8_TIMELINE_STATUS_NO_ERROR;
+
+  const m3u8_media_segment_t* segment = &media->segments[i];
+  m3u8_timeline_anchor_t*     last = media->anchors_count > 0 ? &media->anchors[media->anchors_count - 1] : NULL;
+  int                         sequence = media->media_sequence + i;
+
+  media->starts[i] = i > 0 ? media->starts[i - 1] + media->segments[i - 1].duration : 0;
+
+  if (segment->program_date_time > 0) {
+    if (media->anchors_count == media->anchors_capacity) {
+      int                     capacity = media->anchors_capacity > 0 ? media->anchors_capacity * 2
+                                                                     : M3U8_TIMELINE_INITIAL_CAPACITY;
+      m3u8_timeline_anchor_t* grown = realloc(media->anchors, capacity * sizeof(m3u8_timeline_anchor_t));
+
+      if (grown == NULL) {
+        RAISE(M3U8_TIMELINE_STATUS_MEM_ALLOC_ERROR, "Unable to grow anchors to %d", capacity);
+      }
+
+      media->anchors = grown;
+      media->anchors_capacity = capacity;
+    }
+
+    media->anchors[media->anchors_count++] = (m3u8_timeline_anchor_t){
+        .first = sequence,
+        .end = sequence + 1,
+        .start = media->starts[i],
+        .wallclock = segment->program_date_time,
+    };
+  } else if (last != NULL && last->end == sequence && !segment->is_discontinuity) {
+    // NOTE: without a new tag the clock runs on until a discontinuity
+    last->end++;
+  }
+
+clean_up:
+  return status;
+}
+
+/**
+ * @brief Reads digits[0, length) as the number of a template of width.
+ *
+ * @details Fails unless printing the number back with that width gives the
+ *          same digits: exactly width digits when padded, no leading zero
+ *          otherwise.
+ */
+static bool __m3u8_timeline_number(const char* digits, size_t length, int width, unsigned long long* number) {
+  if (length == 0 || length > M3U8_TIMELINE_URI_DIGITS) {
+    return false;
+  }
+
+  if (width > 0 ? length != (size_t)width : length > 1 && digits[0] == '0') {
+    return false;
+  }
+
+  *number = 0;
+
+  for (size_t i = 0; i < length; i++) {
+    if (!isdigit((unsigned char)digits[i])) {
+      return false;
+    }
+
+    *number = *number * 10 + (digits[i] - '0');
+  }
+
+  return true;
+}
+
+static bool __m3u8_timeline_match(const m3u8_uri_template_t* pattern, const char* uri, size_t length,
+                                  unsigned long long* number) {
+  size_t prefix = strlen(pattern->prefix);
+  size_t suffix = strlen(pattern->suffix);
+
+  if (length <= prefix + suffix || memcmp(uri, pattern->prefix, prefix) != 0 ||
+      memcmp(uri + length - suffix, pattern->suffix, suffix) != 0) {
+    return false;
+  }
+
+  return __m3u8_timeline_number(uri + prefix, length - prefix - suffix, pattern->width, number);
+}
+
+/**
+ * @brief Index of the template made of uri[0, prefix), a number of width
+ *        and uri + suffix, added if new; -1 when it cannot be allocated.
+ */
+static int __m3u8_timeline_template(m3u8_media_t* media, const char* uri, size_t prefix, size_t suffix,
+                                    int width) {
+  m3u8_uri_template_t* pattern = NULL;
+
+  for (int i = 0; i < media->uri_templates_count; i++) {
+    pattern = &media->uri_templates[i];
+
+    if (pattern->width == width && strlen(pattern->prefix) == prefix &&
+        strncmp(pattern->prefix, uri, prefix) == 0 && strcmp(pattern->suffix, uri + suffix) == 0) {
+      return i;
+    }
+  }
+
+  if (media->uri_templates_count == media->uri_templates_capacity) {
+    int                  capacity = media->uri_templates_capacity > 0 ? media->uri_templates_capacity * 2
+                                                                      : M3U8_TIMELINE_INITIAL_CAPACITY;
+    m3u8_uri_template_t* grown = realloc(media->uri_templates, capacity * sizeof(m3u8_uri_template_t));
+
+    if (grown == NULL) {
+      return -1;
+    }
+
+    media->uri_templates = grown;
+    media->uri_templates_capacity = capacity;
+  }
+
+  pattern = &media->uri_templates[media->uri_templates_count];
+  pattern->prefix = strndup(uri, prefix);
+  pattern->suffix = strdup(uri + suffix);
+  pattern->width = width;
+
+  if (pattern->prefix == NULL || pattern->suffix == NULL) {
+    free(pattern->prefix);
+    free(pattern->suffix);
+    return -1;
+  }
+
+  return media->uri_templates_count++;
+}
+
+static void __m3u8_timeline_templated(m3u8_media_segment_t* segment, int pattern, unsigned long long number) {
+  free(segment->uri);
+  segment->uri = NULL;
+  segment->uri_template = pattern + 1;
+  segment->uri_number = number;
+}
+
+/**
+ * @brief Stores the uri of segment i as a template and a number when it
+ *        follows the template of segment i - 1, or differs from its literal
+ *        uri only by a number. Otherwise, or without memory for a new
+ *        template, the uri stays literal.
+ */
+static void __m3u8_timeline_compress(m3u8_media_t* media, int i) {
+  m3u8_media_segment_t* segment = &media->segments[i];
+  m3u8_media_segment_t* previous = i > 0 ? &media->segments[i - 1] : NULL;
+  const char*           uri = segment->uri;
+  const char*           other = NULL;
+  size_t                length = 0;
+  size_t                other_length = 0;
+  size_t                start = 0;
+  size_t                tail = 0;
+  size_t                end = 0;
+  int                   width = 0;
+  int                   pattern = -1;
+  unsigned long long    number = 0;
+  unsigned long long    other_number = 0;
+
+  if (uri == NULL || segment->uri_template != 0 || previous == NULL) {
+    return;
+  }
+
+  length = strlen(uri);
+
+  if (previous->uri_template != 0) {
+    if (__m3u8_timeline_match(&media->uri_templates[previous->uri_template - 1], uri, length, &number)) {
+      __m3u8_timeline_templated(segment, previous->uri_template - 1, number);
+    }
+
+    return;
+  }
+
+  if (previous->uri == NULL) {
+    return;
+  }
+
+  other = previous->uri;
+  other_length = strlen(other);
+
+  // NOTE: the differing span of both uris, widened to the digits around it
+  while (start < length && start < other_length && uri[start] == other[start]) {
+    start++;
+  }
+
+  while (tail < length - start && tail < other_length - start &&
+         uri[length - 1 - tail] == other[other_length - 1 - tail]) {
+    tail++;
+  }
+
+  if (start == length && start == other_length) {
+    return;
+  }
+
+  while (start > 0 && isdigit((unsigned char)uri[start - 1])) {
+    start--;
+  }
+
+  for (end = length - tail; end < length && isdigit((unsigned char)uri[end]);) {
+    end++;
+  }
+
+  tail = length - end;
+
+  if (other_length < start + tail) {
+    return;
+  }
+
+  if (end - start == other_length - tail - start && (uri[start] == '0' || other[start] == '0')) {
+    width = (int)(end - start);
+  }
+
+  if (!__m3u8_timeline_number(uri + start, end - start, width, &number) ||
+      !__m3u8_timeline_number(other + start, other_length - tail - start, width, &other_number)) {
+    return;
+  }
+
+  if ((pattern = __m3u8_timeline_template(media, uri, start, end, width)) < 0) {
+    return;
+  }
+
+  __m3u8_timeline_templated(previous, pattern, other_number);
+  __m3u8_timeline_templated(segment, pattern, number);
+}
+
+/**
+ * @brief Index of the last anchor whose key is at most value, -1 if none.
+ */
+static int __m3u8_timeline_anchor_at(const m3u8_media_t* media, double value, bool is_wallclock) {
+  int low = 0;
+  int high = media->anchors_count;
+
+  while (low < high) {
+    int    middle = low + (high - low) / 2;
+    double key = is_wallclock ? media->anchors[middle].wallclock : media->anchors[middle].first;
+
+    if (key <= value) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  return low - 1;
+}
+
+/**
+ * @brief Index of the last segment of [low, high) starting at or before position.
+ */
+static int __m3u8_timeline_segment_at(const m3u8_media_t* media, double position, int low, int high) {
+  int first = low;
+
+  while (low < high) {
+    int middle = low + (high - low) / 2;
+
+    if (media->starts[middle] <= position) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  return low > first ? low - 1 : first;
+}
+
+static double __m3u8_timeline_end(const m3u8_media_t* media) {
+  int last = media->segments_count - 1;
+
+  return media->starts[last] + media->segments[last].duration;
+}
+
+int m3u8_timeline_index(m3u8_media_t* media) {
+  int status = M3U8_TIMELINE_STATUS_NO_ERROR;
+
+  double* starts = NULL;
+
+  if (media == NULL || (media->segments == NULL && media->segments_count > 0)) {
+    RAISE(M3U8_TIMELINE_STATUS_INVALID_ARG, "Invalid arg media (null) or its segments");
+  }
+
+  if (media->segments_capacity < media->segments_count) {
+    media->segments_capacity = media->segments_count;
+  }
+
+  if (media->segments_capacity > 0 &&
+      (starts = realloc(media->starts, media->segments_capacity * sizeof(double))) == NULL) {
+    RAISE(M3U8_TIMELINE_STATUS_MEM_ALLOC_ERROR, "Unable to allocate %d starts", media->segments_capacity);
+  }
+
+  media->starts = starts != NULL ? starts : media->starts;
+  media->anchors_count = 0;
+
+  for (int i = 0; i < media->segments_count; i++) {
+    if ((status = __m3u8_timeline_account(media, i)) != M3U8_TIMELINE_STATUS_NO_ERROR) {
+      goto clean_up;
+    }
+
+    __m3u8_timeline_compress(media, i);
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_timeline_append(m3u8_media_t* media, const m3u8_media_segment_t* segment) {
+  int status = M3U8_TIMELINE_STATUS_NO_ERROR;
+
+  if (media == NULL || segment == NULL) {
+    RAISE(M3U8_TIMELINE_STATUS_INVALID_ARG, "Invalid arg media or segment (null)");
+  }
+
+  if (media->segments_count > 0 && media->starts == NULL) {
+    RAISE(M3U8_TIMELINE_STATUS_INVALID_ARG, "Timeline not built, see m3u8_timeline_index");
+  }
+
+  if (media->segments_count >= media->segments_capacity || media->starts == NULL) {
+    int                   capacity = media->segments_count > 0 ? media->segments_count * 2
+                                                               : M3U8_TIMELINE_INITIAL_CAPACITY;
+    m3u8_media_segment_t* segments = realloc(media->segments, capacity * sizeof(m3u8_media_segment_t));
+    double*               starts = NULL;
+
+    if (segments == NULL) {
+      RAISE(M3U8_TIMELINE_STATUS_MEM_ALLOC_ERROR, "Unable to grow segments to %d", capacity);
+    }
+
+    media->segments = segments;
+
+    if ((starts = realloc(media->starts, capacity * sizeof(double))) == NULL) {
+      RAISE(M3U8_TIMELINE_STATUS_MEM_ALLOC_ERROR, "Unable to grow starts to %d", capacity);
+    }
+
+    media->starts = starts;
+    media->segments_capacity = capacity;
+  }
+
+  media->segments[media->segments_count] = *segment;
+
+  if ((status = __m3u8_timeline_account(media, media->segments_count)) != M3U8_TIMELINE_STATUS_NO_ERROR) {
+    goto clean_up;
+  }
+
+  __m3u8_timeline_compress(media, media->segments_count);
+  media->segments_count++;
+
+clean_up:
+  return status;
+}
+
+int m3u8_timeline_drop(m3u8_media_t* media, int count) {
+  int status = M3U8_TIMELINE_STATUS_NO_ERROR;
+
+  int kept = 0;
+
+  if (media == NULL || count < 0 || count > media->segments_count) {
+    RAISE(M3U8_TIMELINE_STATUS_INVALID_ARG, "Invalid arg media (null) or count %d", count);
+  }
+
+  for (int i = 0; i < count; i++) {
+    free(media->segments[i].title);
+    free(media->segments[i].uri);
+  }
+
+  media->segments_count -= count;
+  media->media_sequence += count;
+  memmove(media->segments, media->segments + count, media->segments_count * sizeof(m3u8_media_segment_t));
+
+  if (media->starts != NULL) {
+    memmove(media->starts, media->starts + count, media->segments_count * sizeof(double));
+  }
+
+  // NOTE: an anchor whose run reaches into the window still maps it
+  while (kept < media->anchors_count && media->anchors[kept].end <= media->media_sequence) {
+    kept++;
+  }
+
+  media->anchors_count -= kept;
+  memmove(media->anchors, media->anchors + kept, media->anchors_count * sizeof(m3u8_timeline_anchor_t));
+
+clean_up:
+  return status;
+}
+
+int m3u8_timeline_seek(const m3u8_media_t* media, double offset, int* index) {
+  int status = M3U8_TIMELINE_STATUS_NO_ERROR;
+
+  double position = 0;
+
+  if (media == NULL || index == NULL || offset < 0) {
+    RAISE(M3U8_TIMELINE_STATUS_INVALID_ARG, "Invalid arg media, index or offset");
+  }
+
+  if (media->segments_count > 0 && media->starts == NULL) {
+    RAISE(M3U8_TIMELINE_STATUS_INVALID_ARG, "Timeline not built, see m3u8_timeline_index");
+  }
+
+  if (media->segments_count == 0 || (position = media->starts[0] + offset) >= __m3u8_timeline_end(media)) {
+    status = M3U8_TIMELINE_STATUS_NOT_FOUND;
+    goto clean_up;
+  }
+
+  *index = __m3u8_timeline_segment_at(media, position, 0, media->segments_count);
+
+clean_up:
+  return status;
+}
+
+int m3u8_timeline_seek_wallclock(const m3u8_media_t* media, double wallclock, int* index) {
+  int status = M3U8_TIMELINE_STATUS_NO_ERROR;
+
+  const m3u8_timeline_anchor_t* anchor = NULL;
+  int                           anchor_at = -1;
+  int                           first = 0;
+  int                           end = 0;
+  double                        position = 0;
+
+  if (media == NULL || index == NULL) {
+    RAISE(M3U8_TIMELINE_STATUS_INVALID_ARG, "Invalid arg media or index (null)");
+  }
+
+  if (media->segments_count > 0 && media->starts == NULL) {
+    RAISE(M3U8_TIMELINE_STATUS_INVALID_ARG, "Timeline not built, see m3u8_timeline_index");
+  }
+
+  if ((anchor_at = __m3u8_timeline_anchor_at(media, wallclock, true)) < 0) {
+    status = M3U8_TIMELINE_STATUS_NOT_FOUND;
+    goto clean_up;
+  }
+
+  // NOTE: the run may have started before the window, clamp it to the window
+  anchor = &media->anchors[anchor_at];
+  first = anchor->first - media->media_sequence;
+  first = first > 0 ? first : 0;
+  end = anchor->end - media->media_sequence;
+  end = end < media->segments_count ? end : media->segments_count;
+  position = anchor->start + (wallclock - anchor->wallclock);
+
+  if (first >= end || position < media->starts[first] ||
+      position >= media->starts[end - 1] + media->segments[end - 1].duration) {
+    status = M3U8_TIMELINE_STATUS_NOT_FOUND;
+    goto clean_up;
+  }
+
+  *index = __m3u8_timeline_segment_at(media, position, first, end);
+
+clean_up:
+  return status;
+}
+
+int m3u8_timeline_wallclock(const m3u8_media_t* media, int index, double* wallclock) {
+  int status = M3U8_TIMELINE_STATUS_NO_ERROR;
+
+  int                           sequence = 0;
+  int                           anchor_at = -1;
+  const m3u8_timeline_anchor_t* anchor = NULL;
+
+  if (media == NULL || wallclock == NULL || index < 0 || index >= media->segments_count) {
+    RAISE(M3U8_TIMELINE_STATUS_INVALID_ARG, "Invalid arg media, wallclock or index %d", index);
+  }
+
+  if (media->starts == NULL) {
+    RAISE(M3U8_TIMELINE_STATUS_INVALID_ARG, "Timeline not built, see m3u8_timeline_index");
+  }
+
+  sequence = media->media_sequence + index;
+
+  if ((anchor_at = __m3u8_timeline_anchor_at(media, sequence, false)) < 0 ||
+      (anchor = &media->anchors[anchor_at])->end <= sequence) {
+    status = M3U8_TIMELINE_STATUS_NOT_FOUND;
+    goto clean_up;
+  }
+
+  *wallclock = anchor->wallclock + (media->starts[index] - anchor->start);
+
+clean_up:
+  return status;
+}
+
+int m3u8_timeline_uri(const m3u8_media_t* media, int index, char* output, size_t size) {
+  int status = M3U8_TIMELINE_STATUS_NO_ERROR;
+
+  const m3u8_media_segment_t* segment = NULL;
+  const m3u8_uri_template_t*  pattern = NULL;
+  int                         written = 0;
+
+  if (media == NULL || output == NULL || index < 0 || index >= media->segments_count) {
+    RAISE(M3U8_TIMELINE_STATUS_INVALID_ARG, "Invalid arg media, output (null) or index %d", index);
+  }
+
+  segment = &media->segments[index];
+
+  if (segment->uri_template == 0) {
+    if (segment->uri == NULL) {
+      RAISE(M3U8_TIMELINE_STATUS_INVALID_ARG, "Segment %d has no uri", index);
+    }
+
+    written = snprintf(output, size, "%s", segment->uri);
+  } else {
+    pattern = &media->uri_templates[segment->uri_template - 1];
+    written = snprintf(output, size, "%s%0*llu%s", pattern->prefix, pattern->width, segment->uri_number,
+                       pattern->suffix);
+  }
+
+  if (written < 0 || (size_t)written >= size) {
+    RAISE(M3U8_TIMELINE_STATUS_INVALID_ARG, "Output of %zu bytes too small for the uri of segment %d",
+          size, index);
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_timeline_clear(m3u8_media_t* media) {
+  int status = M3U8_TIMELINE_STATUS_NO_ERROR;
+
+  if (media == NULL) {
+    RAISE(M3U8_TIMELINE_STATUS_INVALID_ARG, "Invalid arg media (null)");
+  }
+
+  for (int i = 0; i < media->segments_count; i++) {
+    free(media->segments[i].title);
+    free(media->segments[i].uri);
+  }
+
+  for (int i = 0; i < media->uri_templates_count; i++) {
+    free(media->uri_templates[i].prefix);
+    free(media->uri_templates[i].suffix);
+  }
+
+  free(media->segments);
+  free(media->starts);
+  free(media->anchors);
+  free(media->uri_templates);
+  media->segments = NULL;
+  media->segments_count = 0;
+  media->segments_capacity = 0;
+  media->starts = NULL;
+  media->anchors = NULL;
+  media->anchors_count = 0;
+  media->anchors_capacity = 0;
+  media->uri_templates = NULL;
+  media->uri_templates_count = 0;
+  media->uri_templates_capacity = 0;
+
+clean_up:
+  return status;
+}
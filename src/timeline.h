@@ -0,0 +1,167 @@
+/**
+ * @file timeline.h
+ * @brief Segment timeline of a media playlist: seek by offset and by
+ *        program-date-time.
+ */
+
+#ifndef __H_M3U8_TIMELINE__
+#define __H_M3U8_TIMELINE__
+
+#include "m3u8.h"
+
+/**
+ * @brief Operation completed successfully.
+ *
+ * @details Returned when a function completes without error.
+ */
+#define M3U8_TIMELINE_STATUS_NO_ERROR        0x05000000
+
+/**
+ * @brief Invalid argument received.
+ *
+ * @details Returned when a parameter is NULL, out of range or the timeline
+ *          was not built.
+ */
+#define M3U8_TIMELINE_STATUS_INVALID_ARG     (M3U8_TIMELINE_STATUS_NO_ERROR + 0x01)
+
+/**
+ * @brief Memory allocation failure.
+ *
+ * @details Returned when memory allocation or reallocation fails.
+ */
+#define M3U8_TIMELINE_STATUS_MEM_ALLOC_ERROR (M3U8_TIMELINE_STATUS_NO_ERROR + 0x02)
+
+/**
+ * @brief Time outside of the playlist.
+ *
+ * @details Returned when an offset is past the last segment or a wall-clock
+ *          time is not covered by any program-date-time run.
+ */
+#define M3U8_TIMELINE_STATUS_NOT_FOUND       (M3U8_TIMELINE_STATUS_NO_ERROR + 0x03)
+
+/**
+ * @brief Unknown error occurred.
+ *
+ * @details Returned when an unexpected or undefined error occurs.
+ */
+#define M3U8_TIMELINE_STATUS_UNKNOWN_ERROR   (M3U8_TIMELINE_STATUS_NO_ERROR + 0x99)
+
+/**
+ * @brief Builds the timeline of the segments already in a media playlist.
+ *
+ * @details Called by the parser after the last segment of a playlist read
+ *          in one go. m3u8_media_t.starts becomes the prefix sum of the
+ *          segment durations and every EXT-X-PROGRAM-DATE-TIME starts an
+ *          anchor that extends over the following segments up to the next
+ *          discontinuity. Segment uris that follow a numbered pattern are
+ *          stored as a template and a number, see m3u8_timeline_uri.
+ *
+ * @param[in,out] media Media playlist.
+ *
+ * @retval M3U8_TIMELINE_STATUS_NO_ERROR        On success.
+ * @retval M3U8_TIMELINE_STATUS_INVALID_ARG     If media is NULL.
+ * @retval M3U8_TIMELINE_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_timeline_index(m3u8_media_t* media);
+
+/**
+ * @brief Appends a live segment and extends the timeline.
+ *
+ * @details The strings of segment are moved, not copied: the playlist owns
+ *          them afterwards. A uri differing from the previous one only by a
+ *          decimal number (e.g., segment4561.m4s after segment4560.m4s) is
+ *          freed and kept as a template and that number. Costs amortized
+ *          O(1).
+ *
+ * @param[in,out] media   Media playlist with a timeline.
+ * @param[in]     segment Parsed segment.
+ *
+ * @retval M3U8_TIMELINE_STATUS_NO_ERROR        On success.
+ * @retval M3U8_TIMELINE_STATUS_INVALID_ARG     If an argument is NULL.
+ * @retval M3U8_TIMELINE_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_timeline_append(m3u8_media_t* media, const m3u8_media_segment_t* segment);
+
+/**
+ * @brief Drops the oldest segments of a live window.
+ *
+ * @details Releases their title and uri and advances media_sequence.
+ *          Timeline positions of the remaining segments do not change, so
+ *          a player position stays valid across playlist reloads.
+ *
+ * @param[in,out] media Media playlist with a timeline.
+ * @param[in]     count Number of segments to drop.
+ *
+ * @retval M3U8_TIMELINE_STATUS_NO_ERROR    On success.
+ * @retval M3U8_TIMELINE_STATUS_INVALID_ARG If media is NULL or count is out of range.
+ */
+int m3u8_timeline_drop(m3u8_media_t* media, int count);
+
+/**
+ * @brief Finds the segment playing at an offset from the start of the window.
+ *
+ * @param[in]  media  Media playlist with a timeline.
+ * @param[in]  offset Seconds from the start of the first segment.
+ * @param[out] index  Index of the segment in m3u8_media_t.segments.
+ *
+ * @retval M3U8_TIMELINE_STATUS_NO_ERROR    On success.
+ * @retval M3U8_TIMELINE_STATUS_INVALID_ARG If an argument is invalid.
+ * @retval M3U8_TIMELINE_STATUS_NOT_FOUND   If offset is past the last segment.
+ */
+int m3u8_timeline_seek(const m3u8_media_t* media, double offset, int* index);
+
+/**
+ * @brief Finds the segment playing at a wall-clock time.
+ *
+ * @details A binary search over the anchors, then one over the segment
+ *          starts of the anchor found.
+ *
+ * @param[in]  media     Media playlist with a timeline.
+ * @param[in]  wallclock Seconds since the epoch.
+ * @param[out] index     Index of the segment in m3u8_media_t.segments.
+ *
+ * @retval M3U8_TIMELINE_STATUS_NO_ERROR    On success.
+ * @retval M3U8_TIMELINE_STATUS_INVALID_ARG If an argument is invalid.
+ * @retval M3U8_TIMELINE_STATUS_NOT_FOUND   If no segment plays at wallclock.
+ */
+int m3u8_timeline_seek_wallclock(const m3u8_media_t* media, double wallclock, int* index);
+
+/**
+ * @brief Returns the wall-clock time at which a segment starts.
+ *
+ * @param[in]  media     Media playlist with a timeline.
+ * @param[in]  index     Index of the segment in m3u8_media_t.segments.
+ * @param[out] wallclock Seconds since the epoch.
+ *
+ * @retval M3U8_TIMELINE_STATUS_NO_ERROR    On success.
+ * @retval M3U8_TIMELINE_STATUS_INVALID_ARG If an argument is invalid.
+ * @retval M3U8_TIMELINE_STATUS_NOT_FOUND   If no program-date-time covers the segment.
+ */
+int m3u8_timeline_wallclock(const m3u8_media_t* media, int index, double* wallclock);
+
+/**
+ * @brief Writes the uri of a segment, literal or templated.
+ *
+ * @param[in]  media  Media playlist.
+ * @param[in]  index  Index of the segment in m3u8_media_t.segments.
+ * @param[out] output Buffer where the uri will be written.
+ * @param[in]  size   Size of output.
+ *
+ * @retval M3U8_TIMELINE_STATUS_NO_ERROR    On success.
+ * @retval M3U8_TIMELINE_STATUS_INVALID_ARG If an argument is invalid, the
+ *                                          segment has no uri or output is too
+ *                                          small.
+ */
+int m3u8_timeline_uri(const m3u8_media_t* media, int index, char* output, size_t size);
+
+/**
+ * @brief Releases the segments appended, their strings and the timeline.
+ *
+ * @param[in,out] media Media playlist; left without segments.
+ *
+ * @retval M3U8_TIMELINE_STATUS_NO_ERROR    On success.
+ * @retval M3U8_TIMELINE_STATUS_INVALID_ARG If media is NULL.
+ */
+int m3u8_timeline_clear(m3u8_media_t* media);
+
+#endif  // __H_M3U8_TIMELINE__
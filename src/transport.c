@@ -0,0 +1,580 @@
+/**
+ * @file transport.c
+ * @brief Transport dispatch plus the file and in-memory backends.
+ */
+
+#include "transport.h"
+
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/stat.h>
+
+#include "list.h"
+#include "logger.h"
+#include "memory_usage.h"
+
+#define M3U8_TRANSPORT_FILE_SCHEME "file://"
+#define M3U8_TRANSPORT_FILE_CHUNK  (64 * 1024) /**< bytes read per write callback */
+
+/** @brief single-chunk handle shared by the file and in-memory backends */
+typedef struct {
+  const char* data;          /**< body start */
+  size_t      size;          /**< body size */
+  bool        is_owned;      /**< data was allocated by the backend */
+  bool        is_exhausted;  /**< the chunk was already returned */
+} m3u8_transport_chunk_t;
+
+/** @brief region registered in the in-memory backend */
+typedef struct {
+  char*            uri;           /**< uri the region is served under */
+  const char*      data;          /**< region start, not owned */
+  size_t           size;          /**< region size */
+  bool             is_terminated; /**< data[size] is a readable NUL */
+  m3u8_list_node_t list;          /**< node in the backend region list */
+} m3u8_transport_region_t;
+
+/** @brief in-memory backend context */
+typedef struct {
+  pthread_mutex_t  mutex;   /**< guards regions */
+  m3u8_list_node_t regions; /**< registered m3u8_transport_region_t */
+} m3u8_transport_memory_t;
+
+static m3u8_transport_t* __m3u8_transport_default = NULL;
+static pthread_once_t    __m3u8_transport_default_once = PTHREAD_ONCE_INIT;
+
+static int __m3u8_transport_chunk_read(void* handle, const char** chunk, size_t* size) {
+  m3u8_transport_chunk_t* body = (m3u8_transport_chunk_t*)handle;
+
+  *chunk = body->data;
+  *size = body->is_exhausted ? 0 : body->size;
+  body->is_exhausted = true;
+
+  return M3U8_TRANSPORT_STATUS_NO_ERROR;
+}
+
+static int __m3u8_transport_chunk_close(void* handle) {
+  m3u8_transport_chunk_t* body = (m3u8_transport_chunk_t*)handle;
+
+  if (body->is_owned) {
+    free((char*)body->data);
+  }
+
+  free(body);
+
+  return M3U8_TRANSPORT_STATUS_NO_ERROR;
+}
+
+/**
+ * @brief Opens a file path or file:// uri, loading it with a NUL terminator.
+ */
+static int __m3u8_transport_file_open(void* ctx, const char* uri, m3u8_transport_stream_t* stream) {
+  int status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  FILE*                   file = NULL;
+  char*                   data = NULL;
+  struct stat             info;
+  m3u8_transport_chunk_t* body = NULL;
+  size_t                  scheme_s = strlen(M3U8_TRANSPORT_FILE_SCHEME);
+
+  (void)ctx;
+
+  if (strncmp(uri, M3U8_TRANSPORT_FILE_SCHEME, scheme_s) == 0) {
+    uri += scheme_s;
+  }
+
+  if ((file = fopen(uri, "rb")) == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_NOT_FOUND, "Unable to open %s", uri);
+  }
+
+  if (fstat(fileno(file), &info) != 0 || !S_ISREG(info.st_mode)) {
+    RAISE(M3U8_TRANSPORT_STATUS_IO_ERROR, "Unable to stat %s", uri);
+  }
+
+  body = calloc(1, sizeof(m3u8_transport_chunk_t));
+  data = malloc(info.st_size + 1);
+
+  if (body == NULL || data == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_MEM_ALLOC_ERROR, "Unable to allocate %s", uri);
+  }
+
+  if (fread(data, 1, info.st_size, file) != (size_t)info.st_size) {
+    RAISE(M3U8_TRANSPORT_STATUS_IO_ERROR, "Short read on %s", uri);
+  }
+
+  data[info.st_size] = 0;
+
+  body->data = data;
+  body->size = info.st_size;
+  body->is_owned = true;
+
+  stream->handle = body;
+  stream->is_terminated = true;
+  stream->is_writable = true;
+
+clean_up:
+  if (file != NULL) {
+    fclose(file);
+  }
+
+  if (status != M3U8_TRANSPORT_STATUS_NO_ERROR) {
+    free(data);
+    free(body);
+  }
+
+  return status;
+}
+
+/**
+ * @brief Completes a request from a file, seeking to its range window and
+ *        reading only the bytes it asked for, chunk by chunk.
+ */
+static int __m3u8_transport_file_submit(void* ctx, m3u8_transport_request_t* request) {
+  int status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  FILE*       file = NULL;
+  char*       chunk = NULL;
+  struct stat info;
+  const char* path = request->uri;
+  size_t      remaining = 0;
+  size_t      scheme_s = strlen(M3U8_TRANSPORT_FILE_SCHEME);
+
+  (void)ctx;
+
+  if (strncmp(path, M3U8_TRANSPORT_FILE_SCHEME, scheme_s) == 0) {
+    path += scheme_s;
+  }
+
+  if ((file = fopen(path, "rb")) == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_NOT_FOUND, "Unable to open %s", path);
+  }
+
+  if (fstat(fileno(file), &info) != 0 || !S_ISREG(info.st_mode)) {
+    RAISE(M3U8_TRANSPORT_STATUS_IO_ERROR, "Unable to stat %s", path);
+  }
+
+  if (request->range_length == 0) {
+    remaining = info.st_size;
+  } else if (request->range_offset + request->range_length <= (size_t)info.st_size) {
+    remaining = request->range_length;
+  } else {
+    RAISE(M3U8_TRANSPORT_STATUS_IO_ERROR, "Range %zu@%zu is past the end of %s",
+          request->range_length, request->range_offset, path);
+  }
+
+  // NOTE: like the other backends, range_offset means nothing without a length
+  if (request->range_length > 0 && fseeko(file, (off_t)request->range_offset, SEEK_SET) != 0) {
+    RAISE(M3U8_TRANSPORT_STATUS_IO_ERROR, "Unable to seek %s to %zu", path, request->range_offset);
+  }
+
+  if ((chunk = malloc(M3U8_TRANSPORT_FILE_CHUNK)) == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_MEM_ALLOC_ERROR, "Unable to allocate a read buffer");
+  }
+
+  while (remaining > 0) {
+    size_t wanted = remaining < M3U8_TRANSPORT_FILE_CHUNK ? remaining : M3U8_TRANSPORT_FILE_CHUNK;
+
+    if (fread(chunk, 1, wanted, file) != wanted) {
+      RAISE(M3U8_TRANSPORT_STATUS_IO_ERROR, "Short read on %s", path);
+    }
+
+    if (request->write != NULL && request->write(chunk, wanted, request->userdata) != 0) {
+      RAISE(M3U8_TRANSPORT_STATUS_IO_ERROR, "Sink refused %zu bytes of %s", wanted, path);
+    }
+
+    remaining -= wanted;
+  }
+
+clean_up:
+  if (file != NULL) {
+    fclose(file);
+  }
+
+  free(chunk);
+
+  // NOTE: the outcome is reported through done, submit itself succeeded
+  request->done(request, status, request->userdata);
+
+  return M3U8_TRANSPORT_STATUS_NO_ERROR;
+}
+
+static int __m3u8_transport_memory_open(void*                    ctx,
+                                        const char*              uri,
+                                        m3u8_transport_stream_t* stream) {
+  int status = M3U8_TRANSPORT_STATUS_NOT_FOUND;
+
+  m3u8_transport_memory_t* memory = (m3u8_transport_memory_t*)ctx;
+  m3u8_transport_region_t* region = NULL;
+  m3u8_transport_chunk_t*  body = NULL;
+
+  pthread_mutex_lock(&memory->mutex);
+
+  m3u8_list_foreach(region, &memory->regions, m3u8_transport_region_t, list) {
+    if (strcmp(region->uri, uri) != 0) {
+      continue;
+    }
+
+    if ((body = calloc(1, sizeof(m3u8_transport_chunk_t))) == NULL) {
+      status = M3U8_TRANSPORT_STATUS_MEM_ALLOC_ERROR;
+      break;
+    }
+
+    body->data = region->data;
+    body->size = region->size;
+
+    stream->handle = body;
+    stream->is_terminated = region->is_terminated;
+
+    status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+    break;
+  }
+
+  pthread_mutex_unlock(&memory->mutex);
+
+  return status;
+}
+
+static void __m3u8_transport_memory_destroy(void* ctx) {
+  m3u8_transport_memory_t* memory = (m3u8_transport_memory_t*)ctx;
+  m3u8_list_node_t*        pivot = memory->regions.next;
+
+  while (pivot != &memory->regions) {
+    m3u8_list_node_t*        next = pivot->next;
+    m3u8_transport_region_t* region = m3u8_list_container_of(pivot, m3u8_transport_region_t, list);
+
+    free(region->uri);
+    free(region);
+
+    pivot = next;
+  }
+
+  pthread_mutex_destroy(&memory->mutex);
+  free(memory);
+}
+
+static const m3u8_transport_ops_t __m3u8_transport_file_ops = {
+  .name = "file",
+  .open = __m3u8_transport_file_open,
+  .read = __m3u8_transport_chunk_read,
+  .close = __m3u8_transport_chunk_close,
+  .submit = __m3u8_transport_file_submit,
+};
+
+static const m3u8_transport_ops_t __m3u8_transport_memory_ops = {
+  .name = "memory",
+  .open = __m3u8_transport_memory_open,
+  .read = __m3u8_transport_chunk_read,
+  .close = __m3u8_transport_chunk_close,
+  .destroy = __m3u8_transport_memory_destroy,
+};
+
+static void __m3u8_transport_default_init(void) {
+  m3u8_transport_curl_create(&__m3u8_transport_default);
+}
+
+int m3u8_transport_create(m3u8_transport_t**          transport_ptr,
+                          const m3u8_transport_ops_t* ops,
+                          void*                       ctx) {
+  int status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  if (transport_ptr == NULL || *transport_ptr != NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_INVALID_ARG, "Invalid arg transport_ptr, must point to NULL");
+  }
+
+  if (ops == NULL || ops->open == NULL || ops->read == NULL || ops->close == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_INVALID_ARG, "Invalid arg ops, open, read and close are required");
+  }
+
+  if ((*transport_ptr = malloc(sizeof(m3u8_transport_t))) == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_MEM_ALLOC_ERROR, "Unable to allocate transport");
+  }
+
+  m3u8_memory_count(M3U8_MEMORY_TRANSPORT, 1);
+
+  (*transport_ptr)->ops = ops;
+  (*transport_ptr)->ctx = ctx;
+
+clean_up:
+  return status;
+}
+
+int m3u8_transport_file_create(m3u8_transport_t** transport_ptr) {
+  return m3u8_transport_create(transport_ptr, &__m3u8_transport_file_ops, NULL);
+}
+
+int m3u8_transport_memory_create(m3u8_transport_t** transport_ptr) {
+  int status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  m3u8_transport_memory_t* memory = NULL;
+
+  if ((memory = calloc(1, sizeof(m3u8_transport_memory_t))) == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_MEM_ALLOC_ERROR, "Unable to allocate memory backend");
+  }
+
+  pthread_mutex_init(&memory->mutex, NULL);
+  m3u8_list_init(&memory->regions);
+
+  status = m3u8_transport_create(transport_ptr, &__m3u8_transport_memory_ops, memory);
+
+clean_up:
+  if (status != M3U8_TRANSPORT_STATUS_NO_ERROR && memory != NULL) {
+    __m3u8_transport_memory_destroy(memory);
+  }
+
+  return status;
+}
+
+int m3u8_transport_memory_put(m3u8_transport_t* transport,
+                              const char*       uri,
+                              const char*       data,
+                              size_t            size,
+                              bool              is_terminated) {
+  int status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  m3u8_transport_memory_t* memory = NULL;
+  m3u8_transport_region_t* region = NULL;
+  m3u8_transport_region_t* entry = NULL;
+
+  if (transport == NULL || transport->ops != &__m3u8_transport_memory_ops) {
+    RAISE(M3U8_TRANSPORT_STATUS_INVALID_ARG, "Invalid arg transport, not an in-memory transport");
+  }
+
+  if (uri == NULL || (data == NULL && size > 0)) {
+    RAISE(M3U8_TRANSPORT_STATUS_INVALID_ARG, "Invalid arg uri or data (null)");
+  }
+
+  memory = (m3u8_transport_memory_t*)transport->ctx;
+
+  pthread_mutex_lock(&memory->mutex);
+
+  m3u8_list_foreach(entry, &memory->regions, m3u8_transport_region_t, list) {
+    if (strcmp(entry->uri, uri) == 0) {
+      region = entry;
+      break;
+    }
+  }
+
+  if (region == NULL && (region = calloc(1, sizeof(m3u8_transport_region_t))) != NULL) {
+    if ((region->uri = strdup(uri)) == NULL) {
+      free(region);
+      region = NULL;
+    } else {
+      m3u8_list_inb(&memory->regions, &region->list);
+    }
+  }
+
+  if (region != NULL) {
+    region->data = data;
+    region->size = size;
+    region->is_terminated = is_terminated;
+  }
+
+  pthread_mutex_unlock(&memory->mutex);
+
+  if (region == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_MEM_ALLOC_ERROR, "Unable to register %s", uri);
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_transport_default(m3u8_transport_t** transport_ptr) {
+  int status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  if (transport_ptr == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_INVALID_ARG, "Invalid arg transport_ptr (null)");
+  }
+
+  pthread_once(&__m3u8_transport_default_once, __m3u8_transport_default_init);
+
+  if (__m3u8_transport_default == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_INIT_ERROR, "Unable to create the default transport");
+  }
+
+  *transport_ptr = __m3u8_transport_default;
+
+clean_up:
+  return status;
+}
+
+int m3u8_transport_open(m3u8_transport_t*        transport,
+                        const char*              uri,
+                        m3u8_transport_stream_t* stream) {
+  int status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  if (transport == NULL || uri == NULL || stream == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_INVALID_ARG, "Invalid arg transport, uri or stream (null)");
+  }
+
+  memset(stream, 0, sizeof(m3u8_transport_stream_t));
+
+  if ((status = transport->ops->open(transport->ctx, uri, stream)) ==
+      M3U8_TRANSPORT_STATUS_NO_ERROR) {
+    stream->transport = transport;
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_transport_read(m3u8_transport_stream_t* stream, const char** chunk, size_t* size) {
+  int status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  if (stream == NULL || stream->transport == NULL || chunk == NULL || size == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_INVALID_ARG, "Invalid arg stream, chunk or size (null)");
+  }
+
+  status = stream->transport->ops->read(stream->handle, chunk, size);
+
+clean_up:
+  return status;
+}
+
+int m3u8_transport_header(m3u8_transport_stream_t* stream, const char* name, const char** value) {
+  int status = M3U8_TRANSPORT_STATUS_NOT_FOUND;
+
+  if (stream == NULL || stream->transport == NULL || name == NULL || value == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_INVALID_ARG, "Invalid arg stream, name or value (null)");
+  }
+
+  if (stream->transport->ops->header != NULL) {
+    status = stream->transport->ops->header(stream->handle, name, value);
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_transport_close(m3u8_transport_stream_t* stream) {
+  int status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  if (stream == NULL || stream->transport == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_INVALID_ARG, "Invalid arg stream, not open");
+  }
+
+  status = stream->transport->ops->close(stream->handle);
+
+  stream->transport = NULL;
+  stream->handle = NULL;
+
+clean_up:
+  return status;
+}
+
+int m3u8_transport_deliver(m3u8_transport_request_t* request, size_t* position, const char* data,
+                           size_t size) {
+  size_t start = *position;
+  size_t end = start + size;
+  size_t window_end = request->range_offset + request->range_length;
+
+  *position = end;
+
+  if (request->range_length == 0) {
+    return request->write != NULL ? request->write(data, size, request->userdata) : 0;
+  }
+
+  if (end <= request->range_offset || start >= window_end) {
+    return 0;
+  }
+
+  if (start < request->range_offset) {
+    data += request->range_offset - start;
+    start = request->range_offset;
+  }
+
+  if (end > window_end) {
+    end = window_end;
+  }
+
+  return request->write != NULL ? request->write(data, end - start, request->userdata) : 0;
+}
+
+bool m3u8_transport_is_complete(const m3u8_transport_request_t* request, size_t position) {
+  return request->range_length == 0 || position >= request->range_offset + request->range_length;
+}
+
+int m3u8_transport_submit(m3u8_transport_t* transport, m3u8_transport_request_t* request) {
+  int status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  m3u8_transport_stream_t stream = {.transport = NULL, .handle = NULL};
+  const char*             chunk = NULL;
+  size_t                  size = 0;
+  size_t                  position = 0;
+  int                     result = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  if (transport == NULL || request == NULL || request->uri == NULL || request->done == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_INVALID_ARG, "Invalid arg transport or request");
+  }
+
+  if (transport->ops->submit != NULL) {
+    status = transport->ops->submit(transport->ctx, request);
+    goto clean_up;
+  }
+
+  // NOTE: synchronous backends complete the request before returning, the
+  // window is cut out of the whole body; the file backend seeks in submit
+  result = m3u8_transport_open(transport, request->uri, &stream);
+
+  while (result == M3U8_TRANSPORT_STATUS_NO_ERROR) {
+    if ((result = m3u8_transport_read(&stream, &chunk, &size)) != M3U8_TRANSPORT_STATUS_NO_ERROR ||
+        size == 0) {
+      break;
+    }
+
+    if (m3u8_transport_deliver(request, &position, chunk, size) != 0) {
+      result = M3U8_TRANSPORT_STATUS_IO_ERROR;
+    }
+  }
+
+  if (result == M3U8_TRANSPORT_STATUS_NO_ERROR && !m3u8_transport_is_complete(request, position)) {
+    result = M3U8_TRANSPORT_STATUS_IO_ERROR;
+  }
+
+  if (stream.transport != NULL) {
+    m3u8_transport_close(&stream);
+  }
+
+  request->done(request, result, request->userdata);
+
+clean_up:
+  return status;
+}
+
+int m3u8_transport_cancel(m3u8_transport_t* transport, m3u8_transport_request_t* request) {
+  int status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  if (transport == NULL || request == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_INVALID_ARG, "Invalid arg transport or request (null)");
+  }
+
+  if (transport->ops->cancel != NULL) {
+    status = transport->ops->cancel(transport->ctx, request);
+  }
+
+clean_up:
+  return status;
+}
+
+int m3u8_transport_destroy(m3u8_transport_t* transport) {
+  int status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  if (transport == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_INVALID_ARG, "Invalid arg transport (null)");
+  }
+
+  if (transport == __m3u8_transport_default) {
+    goto clean_up;
+  }
+
+  if (transport->ops->destroy != NULL) {
+    transport->ops->destroy(transport->ctx);
+  }
+
+  m3u8_memory_count(M3U8_MEMORY_TRANSPORT, -1);
+  free(transport);
+
+clean_up:
+  return status;
+}
@@ -0,0 +1,455 @@
+/**
+ * @file transport.h
+ * @brief Pluggable fetch transports (libcurl, file and in-memory backends).
+ */
+
+#ifndef __H_M3U8_TRANSPORT__
+#define __H_M3U8_TRANSPORT__
+
+#include <stdbool.h>
+#include <stddef.h>
+
+/**
+ * @brief Operation completed successfully.
+ *
+ * @details Returned when a function completes without error.
+ */
+#define M3U8_TRANSPORT_STATUS_NO_ERROR        0x30000000
+
+/**
+ * @brief Invalid argument received.
+ *
+ * @details Returned when a parameter is NULL or otherwise invalid.
+ */
+#define M3U8_TRANSPORT_STATUS_INVALID_ARG     (M3U8_TRANSPORT_STATUS_NO_ERROR + 0x01)
+
+/**
+ * @brief Memory allocation failure.
+ *
+ * @details Returned when memory allocation or reallocation fails.
+ */
+#define M3U8_TRANSPORT_STATUS_MEM_ALLOC_ERROR (M3U8_TRANSPORT_STATUS_NO_ERROR + 0x02)
+
+/**
+ * @brief The backend could not be initialized.
+ *
+ * @details Returned when a backend fails to create its handles or threads.
+ */
+#define M3U8_TRANSPORT_STATUS_INIT_ERROR      (M3U8_TRANSPORT_STATUS_NO_ERROR + 0x03)
+
+/**
+ * @brief The transfer failed.
+ *
+ * @details Returned when the resource could not be read, the remote answered
+ *          with an error or the write sink aborted the transfer.
+ */
+#define M3U8_TRANSPORT_STATUS_IO_ERROR        (M3U8_TRANSPORT_STATUS_NO_ERROR + 0x04)
+
+/**
+ * @brief The resource or header does not exist.
+ *
+ * @details Returned when a uri is unknown to the backend or a response
+ *          header is missing.
+ */
+#define M3U8_TRANSPORT_STATUS_NOT_FOUND       (M3U8_TRANSPORT_STATUS_NO_ERROR + 0x05)
+
+/**
+ * @brief The transfer ran out of time.
+ *
+ * @details Passed to done when a request outlived its timeout_ms.
+ */
+#define M3U8_TRANSPORT_STATUS_TIMEOUT         (M3U8_TRANSPORT_STATUS_NO_ERROR + 0x06)
+
+/**
+ * @brief The transfer was cancelled.
+ *
+ * @details Passed to done when m3u8_transport_cancel aborted the request.
+ */
+#define M3U8_TRANSPORT_STATUS_CANCELLED       (M3U8_TRANSPORT_STATUS_NO_ERROR + 0x07)
+
+/**
+ * @brief Unknown error occurred.
+ *
+ * @details Returned when an unexpected or undefined error occurs.
+ */
+#define M3U8_TRANSPORT_STATUS_UNKNOWN_ERROR   (M3U8_TRANSPORT_STATUS_NO_ERROR + 0x99)
+
+typedef struct m3u8_transport         m3u8_transport_t;
+typedef struct m3u8_transport_request m3u8_transport_request_t;
+
+/**
+ * @typedef m3u8_transport_write_fn
+ * @brief Receives response body bytes as they arrive.
+ *
+ * @return 0 to continue the transfer, any other value aborts it.
+ */
+typedef int (*m3u8_transport_write_fn)(const char* data, size_t size, void* userdata);
+
+/**
+ * @typedef m3u8_transport_header_fn
+ * @brief Receives every response header line, without its line break.
+ */
+typedef void (*m3u8_transport_header_fn)(const char* line, size_t size, void* userdata);
+
+/**
+ * @typedef m3u8_transport_done_fn
+ * @brief Called exactly once when a submitted request ends.
+ *
+ * @details May run on the backend worker thread or, for synchronous
+ *          backends, inside m3u8_transport_submit itself.
+ */
+typedef void (*m3u8_transport_done_fn)(m3u8_transport_request_t* request, int status,
+                                       void* userdata);
+
+/**
+ * @struct m3u8_transport_request
+ * @brief Asynchronous request handed to m3u8_transport_submit.
+ *
+ * @details The request and the uri must stay valid until done is called.
+ *          A nonzero range_length restricts the body to that byte window;
+ *          backends deliver only the window even when the origin ignores
+ *          the Range header and answers with the whole resource.
+ */
+struct m3u8_transport_request {
+  const char*              uri;          /**< resource to fetch */
+  size_t                   range_offset; /**< first byte wanted */
+  size_t                   range_length; /**< bytes wanted, 0 for everything */
+  long                     timeout_ms;   /**< gives up after this long, 0 for never */
+  m3u8_transport_write_fn  write;        /**< body sink, called for every chunk */
+  m3u8_transport_header_fn header;       /**< optional response header sink */
+  m3u8_transport_done_fn   done;         /**< completion callback */
+  void*                    userdata;     /**< passed to every callback */
+};
+
+/**
+ * @struct m3u8_transport_stream_t
+ * @brief Pull-style handle returned by m3u8_transport_open.
+ */
+typedef struct {
+  m3u8_transport_t* transport;     /**< transport the stream was opened on */
+  void*             handle;        /**< backend private state */
+  bool              is_terminated; /**< every chunk is followed by a NUL byte */
+  bool              is_writable;   /**< chunks are private to the stream and stay valid
+                                        until close, the reader may modify them */
+} m3u8_transport_stream_t;
+
+/**
+ * @struct m3u8_transport_ops_t
+ * @brief Backend vtable.
+ *
+ * @details open, read and close are mandatory. When submit is NULL requests
+ *          are served synchronously through open, read and close.
+ */
+typedef struct {
+  const char* name; /**< backend name, for logging */
+
+  /** opens uri and fills stream->handle, stream->is_terminated and stream->is_writable */
+  int (*open)(void* ctx, const char* uri, m3u8_transport_stream_t* stream);
+
+  /** returns the next chunk, valid until the next read or close; size 0 on end */
+  int (*read)(void* handle, const char** chunk, size_t* size);
+
+  /** looks up a response header, valid until close */
+  int (*header)(void* handle, const char* name, const char** value);
+
+  /** aborts the transfer if needed and releases the handle */
+  int (*close)(void* handle);
+
+  /** starts an asynchronous request and returns without waiting for it */
+  int (*submit)(void* ctx, m3u8_transport_request_t* request);
+
+  /** releases the backend context */
+  void (*destroy)(void* ctx);
+
+  /** aborts a submitted request, which then completes with CANCELLED; ignores
+   *  requests it no longer runs */
+  int (*cancel)(void* ctx, m3u8_transport_request_t* request);
+} m3u8_transport_ops_t;
+
+/**
+ * @struct m3u8_transport
+ * @brief A backend vtable bound to its context.
+ */
+struct m3u8_transport {
+  const m3u8_transport_ops_t* ops; /**< backend operations */
+  void*                       ctx; /**< backend context */
+};
+
+/**
+ * @def M3U8_TRANSPORT_CURL_MAX_STREAMS
+ * @brief Default cap of concurrent HTTP/2 streams on one connection.
+ */
+#define M3U8_TRANSPORT_CURL_MAX_STREAMS          100
+
+/**
+ * @def M3U8_TRANSPORT_CURL_MAX_HOST_CONNECTIONS
+ * @brief Default cap of connections to one host, the HTTP/1.1 pool size.
+ */
+#define M3U8_TRANSPORT_CURL_MAX_HOST_CONNECTIONS 6
+
+/**
+ * @struct m3u8_transport_curl_config_t
+ * @brief Connection limits of the libcurl backend, zero initialized for
+ *        defaults.
+ *
+ * @details Renditions and segments of one origin are multiplexed as streams
+ *          of a single HTTP/2 connection when the origin negotiates it over
+ *          TLS; otherwise they share a pool of HTTP/1.1 keep-alive
+ *          connections and queue once it is exhausted.
+ */
+typedef struct {
+  long max_streams;          /**< concurrent streams per HTTP/2 connection */
+  long max_host_connections; /**< connections per host */
+  bool is_http1_only;        /**< never negotiate HTTP/2 */
+} m3u8_transport_curl_config_t;
+
+/**
+ * @struct m3u8_transport_curl_stats_t
+ * @brief How finished transfers of a libcurl backend got their connection.
+ */
+typedef struct {
+  unsigned long requests;    /**< finished http(s) transfers */
+  unsigned long multiplexed; /**< ran as a stream of an open HTTP/2 connection */
+  unsigned long reused;      /**< reused an idle HTTP/1.x keep-alive connection */
+  unsigned long connections; /**< had to open a new connection */
+} m3u8_transport_curl_stats_t;
+
+/**
+ * @brief Wraps a custom backend into a transport.
+ *
+ * @param[out] transport_ptr Address where the new transport will be stored.
+ *                           Must point to NULL.
+ * @param[in]  ops           Backend operations, must outlive the transport.
+ * @param[in]  ctx           Backend context passed to ops, released through
+ *                           ops->destroy.
+ *
+ * @retval M3U8_TRANSPORT_STATUS_NO_ERROR        On success.
+ * @retval M3U8_TRANSPORT_STATUS_INVALID_ARG     If a mandatory op is missing.
+ * @retval M3U8_TRANSPORT_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_transport_create(m3u8_transport_t**          transport_ptr,
+                          const m3u8_transport_ops_t* ops,
+                          void*                       ctx);
+
+/**
+ * @brief Creates the libcurl backend.
+ *
+ * @details Transfers are driven by a single multi handle on a worker thread,
+ *          so connections are shared by every request made through it.
+ *
+ * @param[out] transport_ptr Address where the new transport will be stored.
+ *
+ * @retval M3U8_TRANSPORT_STATUS_NO_ERROR        On success.
+ * @retval M3U8_TRANSPORT_STATUS_INVALID_ARG     If transport_ptr is invalid.
+ * @retval M3U8_TRANSPORT_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ * @retval M3U8_TRANSPORT_STATUS_INIT_ERROR      If libcurl setup fails.
+ */
+int m3u8_transport_curl_create(m3u8_transport_t** transport_ptr);
+
+/**
+ * @brief Creates the libcurl backend with explicit connection limits.
+ *
+ * @param[out] transport_ptr Address where the new transport will be stored.
+ * @param[in]  config        Limits, copied by the call; NULL for defaults.
+ *
+ * @retval M3U8_TRANSPORT_STATUS_NO_ERROR        On success.
+ * @retval M3U8_TRANSPORT_STATUS_INVALID_ARG     If transport_ptr is invalid.
+ * @retval M3U8_TRANSPORT_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ * @retval M3U8_TRANSPORT_STATUS_INIT_ERROR      If libcurl setup fails.
+ */
+int m3u8_transport_curl_create_with(m3u8_transport_t**                  transport_ptr,
+                                    const m3u8_transport_curl_config_t* config);
+
+/**
+ * @brief Reads the connection usage of a libcurl backend.
+ *
+ * @details Only http(s) transfers are counted, whatever their outcome.
+ *
+ * @param[in]  transport Transport created by m3u8_transport_curl_create.
+ * @param[out] stats     Counters since the transport was created.
+ *
+ * @retval M3U8_TRANSPORT_STATUS_NO_ERROR    On success.
+ * @retval M3U8_TRANSPORT_STATUS_INVALID_ARG If transport is not a curl one.
+ */
+int m3u8_transport_curl_stats(m3u8_transport_t* transport, m3u8_transport_curl_stats_t* stats);
+
+/**
+ * @brief Creates the file backend, accepting paths and file:// uris.
+ *
+ * @param[out] transport_ptr Address where the new transport will be stored.
+ *
+ * @retval M3U8_TRANSPORT_STATUS_NO_ERROR        On success.
+ * @retval M3U8_TRANSPORT_STATUS_INVALID_ARG     If transport_ptr is invalid.
+ * @retval M3U8_TRANSPORT_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_transport_file_create(m3u8_transport_t** transport_ptr);
+
+/**
+ * @brief Creates the in-memory backend, serving regions registered by uri.
+ *
+ * @param[out] transport_ptr Address where the new transport will be stored.
+ *
+ * @retval M3U8_TRANSPORT_STATUS_NO_ERROR        On success.
+ * @retval M3U8_TRANSPORT_STATUS_INVALID_ARG     If transport_ptr is invalid.
+ * @retval M3U8_TRANSPORT_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_transport_memory_create(m3u8_transport_t** transport_ptr);
+
+/**
+ * @brief Registers a memory region under a uri of an in-memory transport.
+ *
+ * @details The region is not copied: it is handed to readers as a single
+ *          chunk and must stay valid and unchanged while it is registered.
+ *          Streams never mark it writable, so readers do not modify it.
+ *          Registering an existing uri replaces its region.
+ *
+ * @param[in] transport     Transport created by m3u8_transport_memory_create.
+ * @param[in] uri           Uri the region is served under.
+ * @param[in] data          Region start.
+ * @param[in] size          Region size in bytes.
+ * @param[in] is_terminated Whether data[size] is a readable NUL byte.
+ *
+ * @retval M3U8_TRANSPORT_STATUS_NO_ERROR        On success.
+ * @retval M3U8_TRANSPORT_STATUS_INVALID_ARG     If an argument is invalid.
+ * @retval M3U8_TRANSPORT_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_transport_memory_put(m3u8_transport_t* transport,
+                              const char*       uri,
+                              const char*       data,
+                              size_t            size,
+                              bool              is_terminated);
+
+/**
+ * @brief Returns the process-wide libcurl transport, creating it on first use.
+ *
+ * @param[out] transport_ptr Address where the shared transport is stored.
+ *
+ * @retval M3U8_TRANSPORT_STATUS_NO_ERROR   On success.
+ * @retval M3U8_TRANSPORT_STATUS_INIT_ERROR If it could not be created.
+ */
+int m3u8_transport_default(m3u8_transport_t** transport_ptr);
+
+/**
+ * @brief Opens a uri for pull-style reading.
+ *
+ * @param[in]  transport Transport to use.
+ * @param[in]  uri       Resource to open.
+ * @param[out] stream    Stream to initialize.
+ *
+ * @retval M3U8_TRANSPORT_STATUS_NO_ERROR    On success.
+ * @retval M3U8_TRANSPORT_STATUS_INVALID_ARG If an argument is NULL.
+ * @retval M3U8_TRANSPORT_STATUS_NOT_FOUND   If the resource does not exist.
+ * @retval M3U8_TRANSPORT_STATUS_IO_ERROR    If it cannot be opened.
+ */
+int m3u8_transport_open(m3u8_transport_t*        transport,
+                        const char*              uri,
+                        m3u8_transport_stream_t* stream);
+
+/**
+ * @brief Reads the next chunk of a stream without copying it.
+ *
+ * @param[in]  stream Open stream.
+ * @param[out] chunk  Chunk start, valid until the next read or close.
+ * @param[out] size   Chunk size, 0 once the body is exhausted.
+ *
+ * @retval M3U8_TRANSPORT_STATUS_NO_ERROR    On success.
+ * @retval M3U8_TRANSPORT_STATUS_INVALID_ARG If an argument is NULL.
+ * @retval M3U8_TRANSPORT_STATUS_IO_ERROR    If the transfer failed.
+ */
+int m3u8_transport_read(m3u8_transport_stream_t* stream, const char** chunk, size_t* size);
+
+/**
+ * @brief Looks up a response header of a stream (case-insensitive).
+ *
+ * @param[in]  stream Open stream.
+ * @param[in]  name   Header name (e.g., "ETag").
+ * @param[out] value  Header value, valid until close.
+ *
+ * @retval M3U8_TRANSPORT_STATUS_NO_ERROR    On success.
+ * @retval M3U8_TRANSPORT_STATUS_INVALID_ARG If an argument is NULL.
+ * @retval M3U8_TRANSPORT_STATUS_NOT_FOUND   If the header is missing or the
+ *                                           backend has no headers.
+ */
+int m3u8_transport_header(m3u8_transport_stream_t* stream, const char* name, const char** value);
+
+/**
+ * @brief Closes a stream, aborting the transfer if it is still running.
+ *
+ * @param[in] stream Open stream.
+ *
+ * @retval M3U8_TRANSPORT_STATUS_NO_ERROR    On success.
+ * @retval M3U8_TRANSPORT_STATUS_INVALID_ARG If stream is NULL or not open.
+ */
+int m3u8_transport_close(m3u8_transport_stream_t* stream);
+
+/**
+ * @brief Forwards body bytes to a request sink, clipped to its range window.
+ *
+ * @details Helper for backends. position counts the resource bytes seen so
+ *          far and must start at 0 for a whole body or at range_offset when
+ *          the origin already answered with the window only.
+ *
+ * @param[in]     request  Request being served.
+ * @param[in,out] position Resource offset of data, advanced by size.
+ * @param[in]     data     Body bytes.
+ * @param[in]     size     Bytes in data.
+ *
+ * @return 0 to continue, the nonzero value of request->write otherwise.
+ */
+int m3u8_transport_deliver(m3u8_transport_request_t* request, size_t* position, const char* data,
+                           size_t size);
+
+/**
+ * @brief Tells whether a request received every byte of its range window.
+ *
+ * @param[in] request  Request being served.
+ * @param[in] position Final value of the position passed to deliver.
+ *
+ * @return true when the request has no range or the window was filled.
+ */
+bool m3u8_transport_is_complete(const m3u8_transport_request_t* request, size_t position);
+
+/**
+ * @brief Starts an asynchronous request.
+ *
+ * @details request->done is called exactly once when the call succeeds, and
+ *          never when it fails.
+ *
+ * @param[in] transport Transport to use.
+ * @param[in] request   Request to run.
+ *
+ * @retval M3U8_TRANSPORT_STATUS_NO_ERROR    On success.
+ * @retval M3U8_TRANSPORT_STATUS_INVALID_ARG If an argument is NULL or the
+ *                                           request has no done callback.
+ */
+int m3u8_transport_submit(m3u8_transport_t* transport, m3u8_transport_request_t* request);
+
+/**
+ * @brief Aborts a submitted request.
+ *
+ * @details The request still completes through done, with
+ *          M3U8_TRANSPORT_STATUS_CANCELLED unless it finished first. A
+ *          request that already completed, and was not submitted again, is
+ *          left alone. Backends without a cancel op serve requests
+ *          synchronously and have nothing left to abort.
+ *
+ * @param[in] transport Transport the request was submitted to.
+ * @param[in] request   Request to abort.
+ *
+ * @retval M3U8_TRANSPORT_STATUS_NO_ERROR    On success.
+ * @retval M3U8_TRANSPORT_STATUS_INVALID_ARG If an argument is NULL.
+ */
+int m3u8_transport_cancel(m3u8_transport_t* transport, m3u8_transport_request_t* request);
+
+/**
+ * @brief Releases a transport and its backend context.
+ *
+ * @param[in] transport Transport to release; the default transport is
+ *                      never released.
+ *
+ * @retval M3U8_TRANSPORT_STATUS_NO_ERROR    On success.
+ * @retval M3U8_TRANSPORT_STATUS_INVALID_ARG If transport is NULL.
+ */
+int m3u8_transport_destroy(m3u8_transport_t* transport);
+
+#endif  // __H_M3U8_TRANSPORT__
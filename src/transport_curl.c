@@ -0,0 +1,728 @@
+/**
+ * @file transport_curl.c
+ * @brief libcurl transport backend driven by a single multi handle.
+ */
+
+#include <curl/curl.h>
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <strings.h>
+
+#include "list.h"
+#include "logger.h"
+#include "transport.h"
+
+#define M3U8_CURL_POLL_MS 1000
+
+/** @brief growable byte buffer, always followed by a NUL byte */
+typedef struct {
+  char*  data;     /**< buffer bytes */
+  size_t size;     /**< bytes in use */
+  size_t capacity; /**< bytes allocated */
+} m3u8_curl_buffer_t;
+
+/** @brief easy handle bound to the request it is serving */
+typedef struct {
+  CURL*                     easy;          /**< reusable easy handle */
+  m3u8_transport_request_t* request;       /**< request being served */
+  size_t                    position;      /**< resource offset of the next body byte */
+  bool                      is_positioned; /**< position was set from the response */
+  bool                      is_cancelled;  /**< worker must abort the transfer */
+  m3u8_list_node_t          list;          /**< node in pending, active or idle */
+} m3u8_curl_transfer_t;
+
+/** @brief libcurl backend context */
+typedef struct {
+  CURLM*                       multi;       /**< drives every transfer */
+  pthread_t                    worker;      /**< thread running the multi handle */
+  pthread_mutex_t              mutex;       /**< guards the lists, is_stopping and stats */
+  m3u8_list_node_t             pending;     /**< submitted, not yet added to multi */
+  m3u8_list_node_t             active;      /**< added to multi */
+  m3u8_list_node_t             idle;        /**< recycled transfers */
+  bool                         is_stopping; /**< worker must exit */
+  bool                         has_cancels; /**< an active transfer is flagged is_cancelled */
+  m3u8_transport_curl_config_t config;      /**< limits the backend was created with */
+  m3u8_transport_curl_stats_t  stats;       /**< connection usage of finished transfers */
+} m3u8_curl_t;
+
+/** @brief pull-style stream built on top of an asynchronous request */
+typedef struct {
+  m3u8_transport_request_t request;  /**< request feeding the stream */
+  char*                    uri;      /**< owned copy of the uri */
+  pthread_mutex_t          mutex;    /**< guards everything below */
+  pthread_cond_t           cond;     /**< signaled on data and completion */
+  m3u8_curl_buffer_t       pending;  /**< bytes received, not yet read */
+  m3u8_curl_buffer_t       reading;  /**< chunk handed to the reader */
+  m3u8_curl_buffer_t       headers;  /**< NUL separated header lines */
+  bool                     has_body; /**< first body byte arrived */
+  bool                     is_done;  /**< request completed */
+  bool                     is_closed; /**< reader gave up, abort */
+  int                      status;   /**< completion status */
+} m3u8_curl_stream_t;
+
+static pthread_once_t __m3u8_curl_global_once = PTHREAD_ONCE_INIT;
+
+static void __m3u8_curl_global_init(void) {
+  curl_global_init(CURL_GLOBAL_DEFAULT);
+}
+
+static int __m3u8_curl_buffer_append(m3u8_curl_buffer_t* buffer, const char* data, size_t size) {
+  if (buffer->size + size + 1 > buffer->capacity) {
+    size_t capacity = buffer->capacity > 0 ? buffer->capacity : 4096;
+    char*  grown = NULL;
+
+    while (capacity < buffer->size + size + 1) {
+      capacity *= 2;
+    }
+
+    if ((grown = realloc(buffer->data, capacity)) == NULL) {
+      return M3U8_TRANSPORT_STATUS_MEM_ALLOC_ERROR;
+    }
+
+    buffer->data = grown;
+    buffer->capacity = capacity;
+  }
+
+  memcpy(buffer->data + buffer->size, data, size);
+  buffer->size += size;
+  buffer->data[buffer->size] = 0;
+
+  return M3U8_TRANSPORT_STATUS_NO_ERROR;
+}
+
+static size_t __m3u8_curl_write(void* contents, size_t size, size_t nmemb, void* userp) {
+  size_t                    total_size = size * nmemb;
+  m3u8_curl_transfer_t*     transfer = (m3u8_curl_transfer_t*)userp;
+  m3u8_transport_request_t* request = transfer->request;
+  long                      code = 0;
+
+  // NOTE: a 200 carries the whole resource because the origin ignored Range
+  if (!transfer->is_positioned) {
+    curl_easy_getinfo(transfer->easy, CURLINFO_RESPONSE_CODE, &code);
+    transfer->position = code == 200 ? 0 : request->range_offset;
+    transfer->is_positioned = true;
+  }
+
+  if (m3u8_transport_deliver(request, &transfer->position, contents, total_size) != 0) {
+    return 0;
+  }
+
+  return total_size;
+}
+
+static size_t __m3u8_curl_header(char* contents, size_t size, size_t nitems, void* userp) {
+  size_t                    total_size = size * nitems;
+  size_t                    line_s = total_size;
+  m3u8_curl_transfer_t*     transfer = (m3u8_curl_transfer_t*)userp;
+  m3u8_transport_request_t* request = transfer->request;
+
+  while (line_s > 0 && (contents[line_s - 1] == '\r' || contents[line_s - 1] == '\n')) {
+    line_s--;
+  }
+
+  if (request->header != NULL && line_s > 0) {
+    request->header(contents, line_s, request->userdata);
+  }
+
+  return total_size;
+}
+
+/**
+ * @brief Maps a finished easy handle result to a transport status.
+ */
+static int __m3u8_curl_status(CURL* easy, CURLcode result) {
+  long code = 0;
+
+  if (result == CURLE_OK) {
+    return M3U8_TRANSPORT_STATUS_NO_ERROR;
+  }
+
+  curl_easy_getinfo(easy, CURLINFO_RESPONSE_CODE, &code);
+
+  if (result == CURLE_FILE_COULDNT_READ_FILE || code == 404 || code == 410) {
+    return M3U8_TRANSPORT_STATUS_NOT_FOUND;
+  }
+
+  if (result == CURLE_OPERATION_TIMEDOUT) {
+    return M3U8_TRANSPORT_STATUS_TIMEOUT;
+  }
+
+  return M3U8_TRANSPORT_STATUS_IO_ERROR;
+}
+
+/**
+ * @brief Tells how a finished http(s) transfer got its connection.
+ *
+ * @details Called on the worker with the mutex held. A transfer that did not
+ *          connect rode an existing connection, either as an HTTP/2 stream
+ *          next to others or as the next request of an HTTP/1.x keep-alive.
+ */
+static void __m3u8_curl_account(m3u8_curl_t* curl, CURL* easy) {
+  long  connects = 0;
+  long  version = 0;
+  char* scheme = NULL;
+
+  curl_easy_getinfo(easy, CURLINFO_SCHEME, &scheme);
+
+  if (scheme == NULL || strncasecmp(scheme, "http", 4) != 0) {
+    return;
+  }
+
+  curl_easy_getinfo(easy, CURLINFO_NUM_CONNECTS, &connects);
+  curl_easy_getinfo(easy, CURLINFO_HTTP_VERSION, &version);
+
+  curl->stats.requests++;
+
+  if (connects > 0) {
+    curl->stats.connections++;
+  } else if (version >= CURL_HTTP_VERSION_2_0) {
+    curl->stats.multiplexed++;
+  } else {
+    curl->stats.reused++;
+  }
+}
+
+/**
+ * @brief Pulls the transfers flagged by cancel out of the multi handle.
+ *
+ * @details Runs on the worker, the only thread touching the multi handle.
+ */
+static void __m3u8_curl_reap_cancelled(m3u8_curl_t* curl) {
+  m3u8_list_node_t cancelled;
+
+  m3u8_list_init(&cancelled);
+  pthread_mutex_lock(&curl->mutex);
+
+  for (m3u8_list_node_t* node = curl->active.next; curl->has_cancels && node != &curl->active;) {
+    m3u8_curl_transfer_t* transfer = m3u8_list_container_of(node, m3u8_curl_transfer_t, list);
+
+    node = node->next;
+
+    if (transfer->is_cancelled) {
+      m3u8_list_remove(&transfer->list);
+      m3u8_list_inb(&cancelled, &transfer->list);
+    }
+  }
+
+  curl->has_cancels = false;
+  pthread_mutex_unlock(&curl->mutex);
+
+  while (cancelled.next != &cancelled) {
+    m3u8_curl_transfer_t*     transfer = m3u8_list_container_of(cancelled.next, m3u8_curl_transfer_t, list);
+    m3u8_transport_request_t* request = transfer->request;
+
+    curl_multi_remove_handle(curl->multi, transfer->easy);
+
+    pthread_mutex_lock(&curl->mutex);
+    transfer->request = NULL;
+    m3u8_list_remove(&transfer->list);
+    m3u8_list_inb(&curl->idle, &transfer->list);
+    pthread_mutex_unlock(&curl->mutex);
+
+    request->done(request, M3U8_TRANSPORT_STATUS_CANCELLED, request->userdata);
+  }
+}
+
+static void* __m3u8_curl_worker(void* vargs) {
+  m3u8_curl_t* curl = (m3u8_curl_t*)vargs;
+
+  int      running = 0;
+  int      queued = 0;
+  CURLMsg* message = NULL;
+
+  for (;;) {
+    pthread_mutex_lock(&curl->mutex);
+
+    if (curl->is_stopping) {
+      pthread_mutex_unlock(&curl->mutex);
+      break;
+    }
+
+    while (curl->pending.next != &curl->pending) {
+      m3u8_list_node_t*     node = curl->pending.next;
+      m3u8_curl_transfer_t* transfer = m3u8_list_container_of(node, m3u8_curl_transfer_t, list);
+
+      m3u8_list_remove(node);
+      m3u8_list_inb(&curl->active, node);
+      curl_multi_add_handle(curl->multi, transfer->easy);
+    }
+
+    pthread_mutex_unlock(&curl->mutex);
+
+    curl_multi_perform(curl->multi, &running);
+
+    while ((message = curl_multi_info_read(curl->multi, &queued)) != NULL) {
+      m3u8_curl_transfer_t*     transfer = NULL;
+      m3u8_transport_request_t* request = NULL;
+      int                       status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+      if (message->msg != CURLMSG_DONE) {
+        continue;
+      }
+
+      curl_easy_getinfo(message->easy_handle, CURLINFO_PRIVATE, (char**)&transfer);
+      status = __m3u8_curl_status(message->easy_handle, message->data.result);
+      curl_multi_remove_handle(curl->multi, message->easy_handle);
+
+      request = transfer->request;
+
+      if (status == M3U8_TRANSPORT_STATUS_NO_ERROR &&
+          !m3u8_transport_is_complete(request, transfer->position)) {
+        status = M3U8_TRANSPORT_STATUS_IO_ERROR;
+      }
+
+      // NOTE: written under the mutex, __m3u8_curl_cancel reads it while scanning active
+      pthread_mutex_lock(&curl->mutex);
+      transfer->request = NULL;
+      __m3u8_curl_account(curl, message->easy_handle);
+      m3u8_list_remove(&transfer->list);
+      m3u8_list_inb(&curl->idle, &transfer->list);
+      pthread_mutex_unlock(&curl->mutex);
+
+      request->done(request, status, request->userdata);
+    }
+
+    __m3u8_curl_reap_cancelled(curl);
+    curl_multi_poll(curl->multi, NULL, 0, M3U8_CURL_POLL_MS, NULL);
+  }
+
+  return NULL;
+}
+
+static int __m3u8_curl_submit(void* ctx, m3u8_transport_request_t* request) {
+  int status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  m3u8_curl_t*          curl = (m3u8_curl_t*)ctx;
+  m3u8_curl_transfer_t* transfer = NULL;
+
+  pthread_mutex_lock(&curl->mutex);
+
+  if (curl->idle.next != &curl->idle) {
+    transfer = m3u8_list_container_of(curl->idle.next, m3u8_curl_transfer_t, list);
+    m3u8_list_remove(&transfer->list);
+  }
+
+  pthread_mutex_unlock(&curl->mutex);
+
+  if (transfer == NULL) {
+    if ((transfer = calloc(1, sizeof(m3u8_curl_transfer_t))) == NULL) {
+      RAISE(M3U8_TRANSPORT_STATUS_MEM_ALLOC_ERROR, "Unable to allocate transfer");
+    }
+
+    if ((transfer->easy = curl_easy_init()) == NULL) {
+      free(transfer);
+      RAISE(M3U8_TRANSPORT_STATUS_INIT_ERROR, "Curl was bad initialized with curl_easy_init");
+    }
+
+    curl_easy_setopt(transfer->easy, CURLOPT_FAILONERROR, 1L);
+    curl_easy_setopt(transfer->easy, CURLOPT_FOLLOWLOCATION, 1L);
+    curl_easy_setopt(transfer->easy, CURLOPT_NOSIGNAL, 1L);
+    curl_easy_setopt(transfer->easy, CURLOPT_ACCEPT_ENCODING, "");
+    curl_easy_setopt(transfer->easy, CURLOPT_WRITEFUNCTION, __m3u8_curl_write);
+    curl_easy_setopt(transfer->easy, CURLOPT_WRITEDATA, (void*)transfer);
+    curl_easy_setopt(transfer->easy, CURLOPT_HEADERFUNCTION, __m3u8_curl_header);
+    curl_easy_setopt(transfer->easy, CURLOPT_HEADERDATA, (void*)transfer);
+    curl_easy_setopt(transfer->easy, CURLOPT_PRIVATE, (void*)transfer);
+
+    // NOTE: h2 is negotiated through ALPN on https, cleartext stays HTTP/1.1;
+    // PIPEWAIT queues a request behind a connection still negotiating instead
+    // of opening another one, so concurrent fetches to a host share it
+    if (curl->config.is_http1_only) {
+      curl_easy_setopt(transfer->easy, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_1_1);
+    } else {
+      curl_easy_setopt(transfer->easy, CURLOPT_HTTP_VERSION, (long)CURL_HTTP_VERSION_2TLS);
+      curl_easy_setopt(transfer->easy, CURLOPT_PIPEWAIT, 1L);
+    }
+  }
+
+  transfer->request = request;
+  transfer->position = 0;
+  transfer->is_positioned = false;
+  transfer->is_cancelled = false;
+  curl_easy_setopt(transfer->easy, CURLOPT_URL, request->uri);
+  curl_easy_setopt(transfer->easy, CURLOPT_TIMEOUT_MS, request->timeout_ms);
+
+  if (request->range_length > 0) {
+    char range[64];
+
+    snprintf(range, sizeof(range), "%zu-%zu", request->range_offset,
+             request->range_offset + request->range_length - 1);
+    curl_easy_setopt(transfer->easy, CURLOPT_RANGE, range);
+  } else {
+    curl_easy_setopt(transfer->easy, CURLOPT_RANGE, NULL);
+  }
+
+  pthread_mutex_lock(&curl->mutex);
+  m3u8_list_inb(&curl->pending, &transfer->list);
+  pthread_mutex_unlock(&curl->mutex);
+
+  curl_multi_wakeup(curl->multi);
+
+clean_up:
+  return status;
+}
+
+static int __m3u8_curl_cancel(void* ctx, m3u8_transport_request_t* request) {
+  m3u8_curl_t*          curl = (m3u8_curl_t*)ctx;
+  m3u8_curl_transfer_t* queued = NULL;
+  m3u8_curl_transfer_t* transfer = NULL;
+
+  pthread_mutex_lock(&curl->mutex);
+
+  m3u8_list_foreach(transfer, &curl->pending, m3u8_curl_transfer_t, list) {
+    if (transfer->request == request) {
+      queued = transfer;
+      break;
+    }
+  }
+
+  // NOTE: a queued transfer never reached the multi handle and ends right here
+  if (queued != NULL) {
+    queued->request = NULL;
+    m3u8_list_remove(&queued->list);
+    m3u8_list_inb(&curl->idle, &queued->list);
+  } else {
+    m3u8_list_foreach(transfer, &curl->active, m3u8_curl_transfer_t, list) {
+      if (transfer->request == request) {
+        transfer->is_cancelled = true;
+        curl->has_cancels = true;
+        break;
+      }
+    }
+  }
+
+  pthread_mutex_unlock(&curl->mutex);
+
+  if (queued != NULL) {
+    request->done(request, M3U8_TRANSPORT_STATUS_CANCELLED, request->userdata);
+  } else {
+    curl_multi_wakeup(curl->multi);
+  }
+
+  return M3U8_TRANSPORT_STATUS_NO_ERROR;
+}
+
+static int __m3u8_curl_stream_write(const char* data, size_t size, void* userdata) {
+  int                 result = 0;
+  m3u8_curl_stream_t* stream = (m3u8_curl_stream_t*)userdata;
+
+  pthread_mutex_lock(&stream->mutex);
+
+  if (stream->is_closed ||
+      __m3u8_curl_buffer_append(&stream->pending, data, size) != M3U8_TRANSPORT_STATUS_NO_ERROR) {
+    result = 1;
+  }
+
+  stream->has_body = true;
+  pthread_cond_broadcast(&stream->cond);
+  pthread_mutex_unlock(&stream->mutex);
+
+  return result;
+}
+
+static void __m3u8_curl_stream_header(const char* line, size_t size, void* userdata) {
+  m3u8_curl_stream_t* stream = (m3u8_curl_stream_t*)userdata;
+
+  pthread_mutex_lock(&stream->mutex);
+
+  // NOTE: a new status line starts the headers of a redirect target over
+  if (size > 5 && strncmp(line, "HTTP/", 5) == 0) {
+    stream->headers.size = 0;
+  }
+
+  __m3u8_curl_buffer_append(&stream->headers, line, size);
+  stream->headers.size++;  // keeps the NUL written by append as separator
+
+  pthread_mutex_unlock(&stream->mutex);
+}
+
+static void __m3u8_curl_stream_done(m3u8_transport_request_t* request, int status, void* userdata) {
+  m3u8_curl_stream_t* stream = (m3u8_curl_stream_t*)userdata;
+
+  (void)request;
+
+  pthread_mutex_lock(&stream->mutex);
+  stream->status = status;
+  stream->is_done = true;
+  pthread_cond_broadcast(&stream->cond);
+  pthread_mutex_unlock(&stream->mutex);
+}
+
+static void __m3u8_curl_stream_free(m3u8_curl_stream_t* stream) {
+  pthread_cond_destroy(&stream->cond);
+  pthread_mutex_destroy(&stream->mutex);
+  free(stream->pending.data);
+  free(stream->reading.data);
+  free(stream->headers.data);
+  free(stream->uri);
+  free(stream);
+}
+
+static int __m3u8_curl_open(void* ctx, const char* uri, m3u8_transport_stream_t* handle) {
+  int status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  m3u8_curl_stream_t* stream = NULL;
+
+  if ((stream = calloc(1, sizeof(m3u8_curl_stream_t))) == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_MEM_ALLOC_ERROR, "Unable to allocate stream");
+  }
+
+  pthread_mutex_init(&stream->mutex, NULL);
+  pthread_cond_init(&stream->cond, NULL);
+
+  if ((stream->uri = strdup(uri)) == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_MEM_ALLOC_ERROR, "Unable to allocate stream uri");
+  }
+
+  stream->request.uri = stream->uri;
+  stream->request.write = __m3u8_curl_stream_write;
+  stream->request.header = __m3u8_curl_stream_header;
+  stream->request.done = __m3u8_curl_stream_done;
+  stream->request.userdata = stream;
+
+  if ((status = __m3u8_curl_submit(ctx, &stream->request)) != M3U8_TRANSPORT_STATUS_NO_ERROR) {
+    goto clean_up;
+  }
+
+  handle->handle = stream;
+  handle->is_terminated = true;
+
+clean_up:
+  if (status != M3U8_TRANSPORT_STATUS_NO_ERROR && stream != NULL) {
+    __m3u8_curl_stream_free(stream);
+  }
+
+  return status;
+}
+
+static int __m3u8_curl_read(void* handle, const char** chunk, size_t* size) {
+  int status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  m3u8_curl_stream_t* stream = (m3u8_curl_stream_t*)handle;
+  m3u8_curl_buffer_t  swap;
+
+  pthread_mutex_lock(&stream->mutex);
+
+  while (stream->pending.size == 0 && !stream->is_done) {
+    pthread_cond_wait(&stream->cond, &stream->mutex);
+  }
+
+  if (stream->pending.size == 0) {
+    *chunk = NULL;
+    *size = 0;
+    status = stream->status;
+  } else {
+    swap = stream->reading;
+    stream->reading = stream->pending;
+    stream->pending = swap;
+    stream->pending.size = 0;
+
+    *chunk = stream->reading.data;
+    *size = stream->reading.size;
+  }
+
+  pthread_mutex_unlock(&stream->mutex);
+
+  return status;
+}
+
+static int __m3u8_curl_header_lookup(void* handle, const char* name, const char** value) {
+  int status = M3U8_TRANSPORT_STATUS_NOT_FOUND;
+
+  m3u8_curl_stream_t* stream = (m3u8_curl_stream_t*)handle;
+  size_t              name_s = strlen(name);
+  size_t              offset = 0;
+
+  pthread_mutex_lock(&stream->mutex);
+
+  while (!stream->has_body && !stream->is_done) {
+    pthread_cond_wait(&stream->cond, &stream->mutex);
+  }
+
+  while (offset < stream->headers.size) {
+    const char* line = stream->headers.data + offset;
+
+    if (strncasecmp(line, name, name_s) == 0 && line[name_s] == ':') {
+      line += name_s + 1;
+
+      while (*line == ' ' || *line == '\t') {
+        line++;
+      }
+
+      *value = line;
+      status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+      break;
+    }
+
+    offset += strlen(line) + 1;
+  }
+
+  pthread_mutex_unlock(&stream->mutex);
+
+  return status;
+}
+
+static int __m3u8_curl_close(void* handle) {
+  m3u8_curl_stream_t* stream = (m3u8_curl_stream_t*)handle;
+
+  pthread_mutex_lock(&stream->mutex);
+  stream->is_closed = true;
+
+  while (!stream->is_done) {
+    pthread_cond_wait(&stream->cond, &stream->mutex);
+  }
+
+  pthread_mutex_unlock(&stream->mutex);
+
+  __m3u8_curl_stream_free(stream);
+
+  return M3U8_TRANSPORT_STATUS_NO_ERROR;
+}
+
+static void __m3u8_curl_fail_all(m3u8_curl_t* curl, m3u8_list_node_t* head) {
+  while (head->next != head) {
+    m3u8_curl_transfer_t*     transfer = m3u8_list_container_of(head->next, m3u8_curl_transfer_t, list);
+    m3u8_transport_request_t* request = transfer->request;
+
+    curl_multi_remove_handle(curl->multi, transfer->easy);
+    m3u8_list_remove(&transfer->list);
+    m3u8_list_inb(&curl->idle, &transfer->list);
+
+    request->done(request, M3U8_TRANSPORT_STATUS_IO_ERROR, request->userdata);
+  }
+}
+
+static void __m3u8_curl_destroy(void* ctx) {
+  m3u8_curl_t* curl = (m3u8_curl_t*)ctx;
+
+  pthread_mutex_lock(&curl->mutex);
+  curl->is_stopping = true;
+  pthread_mutex_unlock(&curl->mutex);
+
+  curl_multi_wakeup(curl->multi);
+  pthread_join(curl->worker, NULL);
+
+  __m3u8_curl_fail_all(curl, &curl->active);
+  __m3u8_curl_fail_all(curl, &curl->pending);
+
+  while (curl->idle.next != &curl->idle) {
+    m3u8_curl_transfer_t* transfer = m3u8_list_container_of(curl->idle.next, m3u8_curl_transfer_t, list);
+
+    m3u8_list_remove(&transfer->list);
+    curl_easy_cleanup(transfer->easy);
+    free(transfer);
+  }
+
+  curl_multi_cleanup(curl->multi);
+  pthread_mutex_destroy(&curl->mutex);
+  free(curl);
+}
+
+static const m3u8_transport_ops_t __m3u8_transport_curl_ops = {
+  .name = "curl",
+  .open = __m3u8_curl_open,
+  .read = __m3u8_curl_read,
+  .header = __m3u8_curl_header_lookup,
+  .close = __m3u8_curl_close,
+  .submit = __m3u8_curl_submit,
+  .destroy = __m3u8_curl_destroy,
+  .cancel = __m3u8_curl_cancel,
+};
+
+int m3u8_transport_curl_create(m3u8_transport_t** transport_ptr) {
+  return m3u8_transport_curl_create_with(transport_ptr, NULL);
+}
+
+int m3u8_transport_curl_create_with(m3u8_transport_t**                  transport_ptr,
+                                    const m3u8_transport_curl_config_t* config) {
+  int status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  m3u8_curl_t* curl = NULL;
+  bool         is_started = false;
+
+  if (transport_ptr == NULL || *transport_ptr != NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_INVALID_ARG, "Invalid arg transport_ptr, must point to NULL");
+  }
+
+  pthread_once(&__m3u8_curl_global_once, __m3u8_curl_global_init);
+
+  if ((curl = calloc(1, sizeof(m3u8_curl_t))) == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_MEM_ALLOC_ERROR, "Unable to allocate curl backend");
+  }
+
+  pthread_mutex_init(&curl->mutex, NULL);
+  m3u8_list_init(&curl->pending);
+  m3u8_list_init(&curl->active);
+  m3u8_list_init(&curl->idle);
+
+  if (config != NULL) {
+    curl->config = *config;
+  }
+
+  if (curl->config.max_streams <= 0) {
+    curl->config.max_streams = M3U8_TRANSPORT_CURL_MAX_STREAMS;
+  }
+
+  if (curl->config.max_host_connections <= 0) {
+    curl->config.max_host_connections = M3U8_TRANSPORT_CURL_MAX_HOST_CONNECTIONS;
+  }
+
+  if ((curl->multi = curl_multi_init()) == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_INIT_ERROR, "Curl was bad initialized with curl_multi_init");
+  }
+
+  // NOTE: past max_host_connections transfers wait in the multi handle for a
+  // connection to free up, which is how HTTP/1.1 origins get pooled
+  curl_multi_setopt(curl->multi, CURLMOPT_PIPELINING,
+                    curl->config.is_http1_only ? CURLPIPE_NOTHING : CURLPIPE_MULTIPLEX);
+  curl_multi_setopt(curl->multi, CURLMOPT_MAX_HOST_CONNECTIONS, curl->config.max_host_connections);
+#if LIBCURL_VERSION_NUM >= 0x074300
+  curl_multi_setopt(curl->multi, CURLMOPT_MAX_CONCURRENT_STREAMS, curl->config.max_streams);
+#endif
+
+  if (pthread_create(&curl->worker, NULL, __m3u8_curl_worker, curl) != 0) {
+    RAISE(M3U8_TRANSPORT_STATUS_INIT_ERROR, "Unable to start the curl worker");
+  }
+
+  is_started = true;
+
+  status = m3u8_transport_create(transport_ptr, &__m3u8_transport_curl_ops, curl);
+
+clean_up:
+  if (status != M3U8_TRANSPORT_STATUS_NO_ERROR && curl != NULL) {
+    if (is_started) {
+      __m3u8_curl_destroy(curl);
+    } else {
+      if (curl->multi != NULL) {
+        curl_multi_cleanup(curl->multi);
+      }
+
+      pthread_mutex_destroy(&curl->mutex);
+      free(curl);
+    }
+  }
+
+  return status;
+}
+
+int m3u8_transport_curl_stats(m3u8_transport_t* transport, m3u8_transport_curl_stats_t* stats) {
+  int status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  m3u8_curl_t* curl = NULL;
+
+  if (transport == NULL || transport->ops != &__m3u8_transport_curl_ops || stats == NULL) {
+    RAISE(M3U8_TRANSPORT_STATUS_INVALID_ARG, "Invalid arg transport, not a curl transport");
+  }
+
+  curl = (m3u8_curl_t*)transport->ctx;
+
+  pthread_mutex_lock(&curl->mutex);
+  *stats = curl->stats;
+  pthread_mutex_unlock(&curl->mutex);
+
+clean_up:
+  return status;
+}
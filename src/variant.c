@@ -0,0 +1,209 @@
+/**
+ * @file variant.c
+ * @brief Contiguous variant storage of a master playlist and its bandwidth index.
+ */
+
+#include "variant.h"
+
+#include <stdlib.h>
+#include <string.h>
+
+#include "intern.h"
+#include "logger.h"
+
+#define M3U8_VARIANT_INITIAL_CAPACITY 8
+
+static int __m3u8_variant_compare(const void* a, const void* b) {
+  const m3u8_variant_rank_t* left = (const m3u8_variant_rank_t*)a;
+  const m3u8_variant_rank_t* right = (const m3u8_variant_rank_t*)b;
+
+  if (left->bandwidth != right->bandwidth) {
+    return left->bandwidth < right->bandwidth ? -1 : 1;
+  }
+
+  return left->index - right->index;
+}
+
+static void __m3u8_variant_free(const m3u8_t* m3u8_ptr, char* string) {
+  if (m3u8_ptr->is_interned && string != NULL) {
+    m3u8_intern_release(string);
+  } else {
+    free(string);
+  }
+}
+
+int m3u8_variant_append(m3u8_t* m3u8_ptr, const ext_x_stream_inf_t* variant) {
+  int status = M3U8_VARIANT_STATUS_NO_ERROR;
+
+  if (m3u8_ptr == NULL || variant == NULL) {
+    RAISE(M3U8_VARIANT_STATUS_INVALID_ARG, "Invalid arg m3u8_ptr or variant (null)");
+  }
+
+  if (m3u8_ptr->variants_count == m3u8_ptr->variants_capacity) {
+    int                 capacity = m3u8_ptr->variants_capacity > 0 ? m3u8_ptr->variants_capacity * 2
+                                                                   : M3U8_VARIANT_INITIAL_CAPACITY;
+    ext_x_stream_inf_t* grown = realloc(m3u8_ptr->variants, capacity * sizeof(ext_x_stream_inf_t));
+
+    if (grown == NULL) {
+      RAISE(M3U8_VARIANT_STATUS_MEM_ALLOC_ERROR, "Unable to grow variants to %d", capacity);
+    }
+
+    m3u8_ptr->variants = grown;
+    m3u8_ptr->variants_capacity = capacity;
+  }
+
+  m3u8_ptr->variants[m3u8_ptr->variants_count] = *variant;
+
+  if (m3u8_ptr->is_interned) {
+    ext_x_stream_inf_t* stored = &m3u8_ptr->variants[m3u8_ptr->variants_count];
+    char** const        strings[] = {&stored->audio, &stored->subtitles, &stored->closed_captions,
+                                     &stored->resolution, &stored->codecs, &stored->video,
+                                     &stored->hdcp_level, &stored->pathway_id, &stored->uri};
+
+    if (m3u8_intern_adopt(strings, sizeof(strings) / sizeof(strings[0])) != M3U8_INTERN_STATUS_NO_ERROR) {
+      RAISE(M3U8_VARIANT_STATUS_MEM_ALLOC_ERROR, "Unable to intern the variant strings");
+    }
+  }
+
+  m3u8_ptr->variants[m3u8_ptr->variants_count].__next = NULL;
+  m3u8_ptr->variants[m3u8_ptr->variants_count].audio_group = -1;
+  m3u8_ptr->variants[m3u8_ptr->variants_count].video_group = -1;
+  m3u8_ptr->variants[m3u8_ptr->variants_count].subtitles_group = -1;
+  m3u8_ptr->variants[m3u8_ptr->variants_count].closed_captions_group = -1;
+  m3u8_ptr->variants_count++;
+
+  // NOTE: the array may have moved, views are rebuilt by m3u8_variant_index
+  free(m3u8_ptr->by_bandwidth);
+  m3u8_ptr->by_bandwidth = NULL;
+  m3u8_ptr->x_stream_inf = NULL;
+
+clean_up:
+  return status;
+}
+
+int m3u8_variant_index(m3u8_t* m3u8_ptr) {
+  int status = M3U8_VARIANT_STATUS_NO_ERROR;
+
+  m3u8_variant_rank_t* ranks = NULL;
+
+  if (m3u8_ptr == NULL) {
+    RAISE(M3U8_VARIANT_STATUS_INVALID_ARG, "Invalid arg m3u8_ptr (null)");
+  }
+
+  if (m3u8_ptr->variants_count == 0) {
+    goto clean_up;
+  }
+
+  if ((ranks = malloc(m3u8_ptr->variants_count * sizeof(m3u8_variant_rank_t))) == NULL) {
+    RAISE(M3U8_VARIANT_STATUS_MEM_ALLOC_ERROR, "Unable to allocate the bandwidth index");
+  }
+
+  for (int i = 0; i < m3u8_ptr->variants_count; i++) {
+    ranks[i].bandwidth = m3u8_ptr->variants[i].bandwidth;
+    ranks[i].index = i;
+    m3u8_ptr->variants[i].__next =
+        i + 1 < m3u8_ptr->variants_count ? &m3u8_ptr->variants[i + 1] : NULL;
+  }
+
+  qsort(ranks, m3u8_ptr->variants_count, sizeof(m3u8_variant_rank_t), __m3u8_variant_compare);
+
+  free(m3u8_ptr->by_bandwidth);
+  m3u8_ptr->by_bandwidth = ranks;
+  m3u8_ptr->x_stream_inf = m3u8_ptr->variants;
+
+clean_up:
+  return status;
+}
+
+int m3u8_variant_at_most(const m3u8_t*              m3u8_ptr,
+                         int                        bandwidth,
+                         const ext_x_stream_inf_t** variant) {
+  int status = M3U8_VARIANT_STATUS_NO_ERROR;
+
+  int low = 0;
+  int high = 0;
+
+  if (m3u8_ptr == NULL || variant == NULL) {
+    RAISE(M3U8_VARIANT_STATUS_INVALID_ARG, "Invalid arg m3u8_ptr or variant (null)");
+  }
+
+  if (m3u8_ptr->variants_count > 0 && m3u8_ptr->by_bandwidth == NULL) {
+    RAISE(M3U8_VARIANT_STATUS_INVALID_ARG, "Bandwidth index not built, see m3u8_variant_index");
+  }
+
+  // NOTE: upper bound, the first rank above the budget
+  for (high = m3u8_ptr->variants_count; low < high;) {
+    int middle = low + (high - low) / 2;
+
+    if (m3u8_ptr->by_bandwidth[middle].bandwidth <= bandwidth) {
+      low = middle + 1;
+    } else {
+      high = middle;
+    }
+  }
+
+  if (low == 0) {
+    status = M3U8_VARIANT_STATUS_NOT_FOUND;
+    goto clean_up;
+  }
+
+  *variant = &m3u8_ptr->variants[m3u8_ptr->by_bandwidth[low - 1].index];
+
+clean_up:
+  return status;
+}
+
+int m3u8_variant_lowest(const m3u8_t* m3u8_ptr, const ext_x_stream_inf_t** variant) {
+  int status = M3U8_VARIANT_STATUS_NO_ERROR;
+
+  if (m3u8_ptr == NULL || variant == NULL) {
+    RAISE(M3U8_VARIANT_STATUS_INVALID_ARG, "Invalid arg m3u8_ptr or variant (null)");
+  }
+
+  if (m3u8_ptr->variants_count == 0) {
+    status = M3U8_VARIANT_STATUS_NOT_FOUND;
+    goto clean_up;
+  }
+
+  if (m3u8_ptr->by_bandwidth == NULL) {
+    RAISE(M3U8_VARIANT_STATUS_INVALID_ARG, "Bandwidth index not built, see m3u8_variant_index");
+  }
+
+  *variant = &m3u8_ptr->variants[m3u8_ptr->by_bandwidth[0].index];
+
+clean_up:
+  return status;
+}
+
+int m3u8_variant_clear(m3u8_t* m3u8_ptr) {
+  int status = M3U8_VARIANT_STATUS_NO_ERROR;
+
+  if (m3u8_ptr == NULL) {
+    RAISE(M3U8_VARIANT_STATUS_INVALID_ARG, "Invalid arg m3u8_ptr (null)");
+  }
+
+  for (int i = 0; i < m3u8_ptr->variants_count; i++) {
+    ext_x_stream_inf_t* variant = &m3u8_ptr->variants[i];
+
+    __m3u8_variant_free(m3u8_ptr, variant->audio);
+    __m3u8_variant_free(m3u8_ptr, variant->subtitles);
+    __m3u8_variant_free(m3u8_ptr, variant->closed_captions);
+    __m3u8_variant_free(m3u8_ptr, variant->resolution);
+    __m3u8_variant_free(m3u8_ptr, variant->codecs);
+    __m3u8_variant_free(m3u8_ptr, variant->video);
+    __m3u8_variant_free(m3u8_ptr, variant->hdcp_level);
+    __m3u8_variant_free(m3u8_ptr, variant->pathway_id);
+    __m3u8_variant_free(m3u8_ptr, variant->uri);
+  }
+
+  free(m3u8_ptr->variants);
+  free(m3u8_ptr->by_bandwidth);
+  m3u8_ptr->variants = NULL;
+  m3u8_ptr->variants_count = 0;
+  m3u8_ptr->variants_capacity = 0;
+  m3u8_ptr->by_bandwidth = NULL;
+  m3u8_ptr->x_stream_inf = NULL;
+
+clean_up:
+  return status;
+}
@@ -0,0 +1,120 @@
+/**
+ * @file variant.h
+ * @brief Contiguous variant storage of a master playlist and its bandwidth index.
+ */
+
+#ifndef __H_M3U8_VARIANT__
+#define __H_M3U8_VARIANT__
+
+#include "m3u8.h"
+
+/**
+ * @brief Operation completed successfully.
+ *
+ * @details Returned when a function completes without error.
+ */
+#define M3U8_VARIANT_STATUS_NO_ERROR        0x02000000
+
+/**
+ * @brief Invalid argument received.
+ *
+ * @details Returned when a parameter is NULL or the index was not built.
+ */
+#define M3U8_VARIANT_STATUS_INVALID_ARG     (M3U8_VARIANT_STATUS_NO_ERROR + 0x01)
+
+/**
+ * @brief Memory allocation failure.
+ *
+ * @details Returned when memory allocation or reallocation fails.
+ */
+#define M3U8_VARIANT_STATUS_MEM_ALLOC_ERROR (M3U8_VARIANT_STATUS_NO_ERROR + 0x02)
+
+/**
+ * @brief No variant matches.
+ *
+ * @details Returned when the playlist has no variant or every variant needs
+ *          more bandwidth than allowed.
+ */
+#define M3U8_VARIANT_STATUS_NOT_FOUND       (M3U8_VARIANT_STATUS_NO_ERROR + 0x03)
+
+/**
+ * @brief Unknown error occurred.
+ *
+ * @details Returned when an unexpected or undefined error occurs.
+ */
+#define M3U8_VARIANT_STATUS_UNKNOWN_ERROR   (M3U8_VARIANT_STATUS_NO_ERROR + 0x99)
+
+/**
+ * @brief Appends a variant to the contiguous array of a master playlist.
+ *
+ * @details Called by the parser for every EXT-X-STREAM-INF. The strings of
+ *          variant are moved, not copied: the playlist owns them afterwards.
+ *          Growing the array moves the variants, so pointers into it and
+ *          the bandwidth index are only valid once m3u8_variant_index ran.
+ *
+ * @param[in,out] m3u8_ptr Master playlist.
+ * @param[in]     variant  Parsed variant, __next is ignored.
+ *
+ * @retval M3U8_VARIANT_STATUS_NO_ERROR        On success.
+ * @retval M3U8_VARIANT_STATUS_INVALID_ARG     If an argument is NULL.
+ * @retval M3U8_VARIANT_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_variant_append(m3u8_t* m3u8_ptr, const ext_x_stream_inf_t* variant);
+
+/**
+ * @brief Builds the bandwidth index and links the x_stream_inf list view.
+ *
+ * @details Called once by the parser after the last variant. Variants of
+ *          equal bandwidth keep their playlist order in the index.
+ *
+ * @param[in,out] m3u8_ptr Master playlist.
+ *
+ * @retval M3U8_VARIANT_STATUS_NO_ERROR        On success.
+ * @retval M3U8_VARIANT_STATUS_INVALID_ARG     If m3u8_ptr is NULL.
+ * @retval M3U8_VARIANT_STATUS_MEM_ALLOC_ERROR If memory allocation fails.
+ */
+int m3u8_variant_index(m3u8_t* m3u8_ptr);
+
+/**
+ * @brief Finds the highest bandwidth variant fitting a budget.
+ *
+ * @details A binary search over the bandwidth index; on ties the last
+ *          variant of the playlist wins.
+ *
+ * @param[in]  m3u8_ptr  Indexed master playlist.
+ * @param[in]  bandwidth Budget in bits per second.
+ * @param[out] variant   Variant with the highest BANDWIDTH <= budget.
+ *
+ * @retval M3U8_VARIANT_STATUS_NO_ERROR    On success.
+ * @retval M3U8_VARIANT_STATUS_INVALID_ARG If an argument is NULL or the
+ *                                         index was not built.
+ * @retval M3U8_VARIANT_STATUS_NOT_FOUND   If no variant fits the budget.
+ */
+int m3u8_variant_at_most(const m3u8_t*              m3u8_ptr,
+                         int                        bandwidth,
+                         const ext_x_stream_inf_t** variant);
+
+/**
+ * @brief Finds the lowest bandwidth variant, the fallback of every budget.
+ *
+ * @param[in]  m3u8_ptr Indexed master playlist.
+ * @param[out] variant  Variant with the lowest BANDWIDTH.
+ *
+ * @retval M3U8_VARIANT_STATUS_NO_ERROR    On success.
+ * @retval M3U8_VARIANT_STATUS_INVALID_ARG If an argument is NULL or the
+ *                                         index was not built.
+ * @retval M3U8_VARIANT_STATUS_NOT_FOUND   If the playlist has no variant.
+ */
+int m3u8_variant_lowest(const m3u8_t* m3u8_ptr, const ext_x_stream_inf_t** variant);
+
+/**
+ * @brief Releases the variants, their strings and the index.
+ *
+ * @param[in,out] m3u8_ptr Playlist; left without variants.
+ *
+ * @retval M3U8_VARIANT_STATUS_NO_ERROR    On success.
+ * @retval M3U8_VARIANT_STATUS_INVALID_ARG If m3u8_ptr is NULL.
+ */
+int m3u8_variant_clear(m3u8_t* m3u8_ptr);
+
+#endif  // __H_M3U8_VARIANT__
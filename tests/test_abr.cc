@@ -0,0 +1,175 @@
+#include <gtest/gtest.h>
+#include <string.h>
+
+extern "C" {
+#include "../src/abr.h"
+#include "../src/variant.h"
+}
+
+class m3u8_abr_test : public ::testing::Test {
+ protected:
+  m3u8_t*            m3u8_ptr = NULL;
+  m3u8_abr_ladder_t* ladder = NULL;
+
+  void SetUp() override {
+    ASSERT_EQ(m3u8_create(&m3u8_ptr), M3U8_STATUS_NO_ERROR);
+
+    append(6000000, "3840x2160", 60.0, "hvc1.2.4.L153.B0,mp4a.40.2", "TYPE-1", "2160p.m3u8");
+    append(800000, "640x360", 30.0, "avc1.4d401e,mp4a.40.2", NULL, "360p.m3u8");
+    append(4500000, "1920x1080", 60.0, "avc1.640028,mp4a.40.2", "TYPE-0", "1080p60.m3u8");
+    append(3000000, "1920x1080", 30.0, "avc1.640028,mp4a.40.2", "TYPE-0", "1080p.m3u8");
+    append(1500000, "1280x720", 30.0, "avc1.4d401f,mp4a.40.2", "NONE", "720p.m3u8");
+
+    ASSERT_EQ(m3u8_variant_index(m3u8_ptr), M3U8_VARIANT_STATUS_NO_ERROR);
+  }
+
+  void TearDown() override {
+    if (ladder != NULL) {
+      EXPECT_EQ(m3u8_abr_ladder_destroy(ladder), M3U8_ABR_STATUS_NO_ERROR);
+    }
+
+    EXPECT_EQ(m3u8_destroy(m3u8_ptr), M3U8_STATUS_NO_ERROR);
+  }
+
+  void append(int bandwidth, const char* resolution, double frame_rate, const char* codecs,
+              const char* hdcp_level, const char* uri) {
+    ext_x_stream_inf_t variant = {};
+
+    variant.bandwidth = bandwidth;
+    variant.resolution = strdup(resolution);
+    variant.frame_rate = frame_rate;
+    variant.codecs = strdup(codecs);
+    variant.hdcp_level = hdcp_level != NULL ? strdup(hdcp_level) : NULL;
+    variant.uri = strdup(uri);
+    ASSERT_EQ(m3u8_variant_append(m3u8_ptr, &variant), M3U8_VARIANT_STATUS_NO_ERROR);
+  }
+
+  const char* pick(double estimate_bps) {
+    int rung = -1;
+
+    EXPECT_EQ(m3u8_abr_select(ladder, estimate_bps, &rung), M3U8_ABR_STATUS_NO_ERROR);
+
+    return m3u8_abr_ladder_rung(ladder, rung)->uri;
+  }
+};
+
+// ----------- m3u8_abr_estimate -----------
+
+TEST_F(m3u8_abr_test, given_no_sample_returns_default) {
+  m3u8_abr_estimator_t estimator;
+
+  ASSERT_EQ(m3u8_abr_estimator_init(&estimator, 0, 1000000), M3U8_ABR_STATUS_NO_ERROR);
+  EXPECT_DOUBLE_EQ(m3u8_abr_estimate(&estimator), 1000000);
+  EXPECT_EQ(m3u8_abr_sample(&estimator, 0, 10), M3U8_ABR_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_abr_estimator_init(NULL, 0, 0), M3U8_ABR_STATUS_INVALID_ARG);
+}
+
+TEST_F(m3u8_abr_test, given_steady_samples_converges_to_throughput) {
+  m3u8_abr_estimator_t estimator;
+
+  ASSERT_EQ(m3u8_abr_estimator_init(&estimator, 0, 0), M3U8_ABR_STATUS_NO_ERROR);
+
+  // 500 KB in 1 s is 4 Mbps, from the first sample thanks to the bias correction
+  ASSERT_EQ(m3u8_abr_sample(&estimator, 500000, 1000), M3U8_ABR_STATUS_NO_ERROR);
+  EXPECT_NEAR(m3u8_abr_estimate(&estimator), 4000000, 1);
+
+  for (int i = 0; i < 20; i++) {
+    m3u8_abr_sample(&estimator, 500000, 1000);
+  }
+
+  EXPECT_NEAR(m3u8_abr_estimate(&estimator), 4000000, 1);
+}
+
+TEST_F(m3u8_abr_test, given_spike_keeps_estimate_conservative) {
+  m3u8_abr_estimator_t estimator;
+
+  ASSERT_EQ(m3u8_abr_estimator_init(&estimator, 0, 0), M3U8_ABR_STATUS_NO_ERROR);
+
+  for (int i = 0; i < M3U8_ABR_WINDOW; i++) {
+    m3u8_abr_sample(&estimator, 250000, 1000);
+  }
+
+  // one 40 Mbps burst barely moves the harmonic mean
+  m3u8_abr_sample(&estimator, 5000000, 1000);
+  EXPECT_LT(m3u8_abr_estimate(&estimator), 2400000);
+
+  // a collapse shows up right away
+  for (int i = 0; i < M3U8_ABR_WINDOW; i++) {
+    m3u8_abr_sample(&estimator, 250000, 1000);
+  }
+
+  m3u8_abr_sample(&estimator, 25000, 1000);
+  EXPECT_LT(m3u8_abr_estimate(&estimator), 1500000);
+}
+
+// ----------- m3u8_abr_select -----------
+
+TEST_F(m3u8_abr_test, given_no_constraint_picks_highest_fitting_rung) {
+  ASSERT_EQ(m3u8_abr_ladder_create(&ladder, m3u8_ptr, NULL), M3U8_ABR_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_abr_ladder_size(ladder), 5);
+
+  EXPECT_STREQ(pick(100000), "360p.m3u8");
+  EXPECT_STREQ(pick(2000000), "720p.m3u8");
+  EXPECT_STREQ(pick(3000000), "720p.m3u8");  // 0.85 * 3 Mbps does not fit 1080p
+  EXPECT_STREQ(pick(3600000), "1080p.m3u8");
+  EXPECT_STREQ(pick(100000000), "2160p.m3u8");
+  EXPECT_EQ(m3u8_abr_ladder_rung(ladder, 5), nullptr);
+}
+
+TEST_F(m3u8_abr_test, given_device_constraints_filters_ladder) {
+  const char* const      codecs[] = {"avc1", "mp4a", NULL};
+  m3u8_abr_constraints_t constraints = {};
+
+  constraints.max_height = 1080;
+  constraints.max_frame_rate = 30;
+  constraints.max_hdcp = M3U8_ABR_HDCP_TYPE_0;
+  constraints.codecs = codecs;
+  constraints.safety = 1.0;
+
+  ASSERT_EQ(m3u8_abr_ladder_create(&ladder, m3u8_ptr, &constraints), M3U8_ABR_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_abr_ladder_size(ladder), 3);
+  EXPECT_STREQ(pick(100000000), "1080p.m3u8");
+  EXPECT_STREQ(pick(3000000), "1080p.m3u8");
+
+  m3u8_abr_ladder_destroy(ladder);
+  ladder = NULL;
+
+  // no HDCP output leaves the clear variants only
+  constraints.max_hdcp = M3U8_ABR_HDCP_NONE;
+  ASSERT_EQ(m3u8_abr_ladder_create(&ladder, m3u8_ptr, &constraints), M3U8_ABR_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_abr_ladder_size(ladder), 2);
+  EXPECT_STREQ(pick(100000000), "720p.m3u8");
+
+  m3u8_abr_ladder_destroy(ladder);
+  ladder = NULL;
+
+  constraints.max_height = 240;
+  EXPECT_EQ(m3u8_abr_ladder_create(&ladder, m3u8_ptr, &constraints), M3U8_ABR_STATUS_NOT_FOUND);
+  EXPECT_EQ(ladder, nullptr);
+}
+
+TEST_F(m3u8_abr_test, given_unknown_hdcp_level_needs_an_unconstrained_output) {
+  m3u8_abr_constraints_t constraints = {};
+
+  append(9000000, "3840x2160", 30.0, "avc1.640033,mp4a.40.2", "TYPE-2", "2160p-type2.m3u8");
+  ASSERT_EQ(m3u8_variant_index(m3u8_ptr), M3U8_VARIANT_STATUS_NO_ERROR);
+
+  // NOTE: the strictest known output still leaves the unknown level out
+  constraints.max_hdcp = M3U8_ABR_HDCP_TYPE_1;
+  ASSERT_EQ(m3u8_abr_ladder_create(&ladder, m3u8_ptr, &constraints), M3U8_ABR_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_abr_ladder_size(ladder), 5);
+  EXPECT_STREQ(pick(100000000), "2160p.m3u8");
+
+  m3u8_abr_ladder_destroy(ladder);
+  ladder = NULL;
+
+  constraints.max_hdcp = M3U8_ABR_HDCP_ANY;
+  ASSERT_EQ(m3u8_abr_ladder_create(&ladder, m3u8_ptr, &constraints), M3U8_ABR_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_abr_ladder_size(ladder), 6);
+  EXPECT_STREQ(pick(100000000), "2160p-type2.m3u8");
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
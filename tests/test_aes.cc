@@ -0,0 +1,203 @@
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "../src/aes.h"
+}
+
+// NIST SP 800-38A F.2.2, followed by the PKCS#7 padding block
+static const char* MOCK_NIST_KEY = "2b7e151628aed2a6abf7158809cf4f3c";
+static const char* MOCK_NIST_IV = "000102030405060708090a0b0c0d0e0f";
+static const char* MOCK_NIST_PLAIN =
+    "6bc1bee22e409f96e93d7e117393172aae2d8a571e03ac9c9eb76fac45af8e51"
+    "30c81c46a35ce411e5fbc1191a0a52eff69f2445df4f9b17ad2b417be66c3710";
+static const char* MOCK_NIST_CIPHER =
+    "7649abac8119b246cee98e9b12e9197d5086cb9b507219ee95db113a917678b2"
+    "73bed6b8e3c1743b7116e69e222295163ff1caa1681fac09120eca307586e1a7"
+    "8cb82807230e1321d3fae00d18cc2012";
+
+// 100 bytes of (i * 7) & 0xff under the NIST key and IV
+static const char* MOCK_PATTERN_CIPHER =
+    "7f807b311707f722e7e237b65a78a537b527ff950cafb2b093d2d2052cf27fd4"
+    "9d481d5ef9b116b36e7b5b1253e8c49cf6e2333bbe8160bdb1f55df6aa8b415a"
+    "6cfefc86152e49740ab054b204dc276bda613bc737f333c2fe1a200855b92ce4"
+    "3a25e51104bc32fef0d27def3a01299f";
+
+static std::vector<unsigned char> from_hex(const char* hex) {
+  std::vector<unsigned char> bytes;
+
+  for (size_t i = 0; hex[i] != 0 && hex[i + 1] != 0; i += 2) {
+    bytes.push_back((unsigned char)std::stoi(std::string(hex + i, 2), nullptr, 16));
+  }
+
+  return bytes;
+}
+
+static std::vector<unsigned char> pattern(size_t size) {
+  std::vector<unsigned char> bytes(size);
+
+  for (size_t i = 0; i < size; i++) {
+    bytes[i] = (unsigned char)((i * 7) & 0xff);
+  }
+
+  return bytes;
+}
+
+class m3u8_aes_test : public ::testing::TestWithParam<bool> {
+ protected:
+  std::vector<unsigned char> key = from_hex(MOCK_NIST_KEY);
+  std::vector<unsigned char> iv = from_hex(MOCK_NIST_IV);
+
+  void init(m3u8_aes_t* aes) {
+    ASSERT_EQ(m3u8_aes_init(aes, key.data(), iv.data()), M3U8_AES_STATUS_NO_ERROR);
+
+    if (!GetParam()) {
+      aes->is_accelerated = false;
+    } else if (!aes->is_accelerated) {
+      GTEST_SKIP() << "AES-NI is not available";
+    }
+  }
+
+  std::vector<unsigned char> stream(const std::vector<unsigned char>& cipher, size_t chunk,
+                                    int* status) {
+    m3u8_aes_t                 aes;
+    std::vector<unsigned char> plain(cipher.size() + 2 * M3U8_AES_BLOCK_SIZE);
+    size_t                     plain_s = 0;
+    size_t                     out_s = 0;
+
+    init(&aes);
+
+    for (size_t offset = 0; offset < cipher.size(); offset += chunk) {
+      size_t size = std::min(chunk, cipher.size() - offset);
+
+      EXPECT_EQ(m3u8_aes_update(&aes, cipher.data() + offset, size, plain.data() + plain_s, &out_s),
+                M3U8_AES_STATUS_NO_ERROR);
+      EXPECT_LE(out_s, size + M3U8_AES_BLOCK_SIZE);
+      plain_s += out_s;
+    }
+
+    *status = m3u8_aes_final(&aes, plain.data() + plain_s, &out_s);
+    plain.resize(plain_s + out_s);
+
+    return plain;
+  }
+};
+
+// ----------- m3u8_aes_init -----------
+
+TEST_P(m3u8_aes_test, given_invalid_args_returns_error) {
+  m3u8_aes_t    aes;
+  unsigned char out[M3U8_AES_BLOCK_SIZE];
+  size_t        out_s = 0;
+
+  EXPECT_EQ(m3u8_aes_init(NULL, key.data(), iv.data()), M3U8_AES_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_aes_init(&aes, NULL, iv.data()), M3U8_AES_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_aes_init(&aes, key.data(), NULL), M3U8_AES_STATUS_INVALID_ARG);
+
+  init(&aes);
+  EXPECT_EQ(m3u8_aes_update(&aes, NULL, 1, out, &out_s), M3U8_AES_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_aes_final(&aes, out, &out_s), M3U8_AES_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_aes_decrypt(key.data(), iv.data(), out, 15, &out_s), M3U8_AES_STATUS_INVALID_ARG);
+}
+
+// ----------- m3u8_aes_update -----------
+
+TEST_P(m3u8_aes_test, given_nist_vector_decrypts_every_block) {
+  std::vector<unsigned char> cipher = from_hex(MOCK_NIST_CIPHER);
+  int                        status = 0;
+
+  for (size_t chunk : {1, 7, 16, 33, 80}) {
+    EXPECT_EQ(stream(cipher, chunk, &status), from_hex(MOCK_NIST_PLAIN)) << "chunk " << chunk;
+    EXPECT_EQ(status, M3U8_AES_STATUS_NO_ERROR);
+  }
+}
+
+TEST_P(m3u8_aes_test, given_partial_last_block_strips_padding) {
+  std::vector<unsigned char> cipher = from_hex(MOCK_PATTERN_CIPHER);
+  int                        status = 0;
+
+  for (size_t chunk : {3, 16, 64, 112}) {
+    EXPECT_EQ(stream(cipher, chunk, &status), pattern(100)) << "chunk " << chunk;
+    EXPECT_EQ(status, M3U8_AES_STATUS_NO_ERROR);
+  }
+}
+
+TEST_P(m3u8_aes_test, given_one_buffer_decrypts_in_place) {
+  std::vector<unsigned char> cipher = from_hex(MOCK_PATTERN_CIPHER);
+
+  for (size_t chunk : {3, 7, 16, 33, 112}) {
+    m3u8_aes_t                 aes;
+    std::vector<unsigned char> plain;
+    std::vector<unsigned char> buffer(chunk + M3U8_AES_BLOCK_SIZE);
+    size_t                     out_s = 0;
+
+    init(&aes);
+
+    // NOTE: every chunk is read from and written to the same buffer
+    for (size_t offset = 0; offset < cipher.size(); offset += chunk) {
+      size_t size = std::min(chunk, cipher.size() - offset);
+
+      memcpy(buffer.data(), cipher.data() + offset, size);
+      ASSERT_EQ(m3u8_aes_update(&aes, buffer.data(), size, buffer.data(), &out_s),
+                M3U8_AES_STATUS_NO_ERROR);
+      plain.insert(plain.end(), buffer.begin(), buffer.begin() + out_s);
+    }
+
+    ASSERT_EQ(m3u8_aes_final(&aes, buffer.data(), &out_s), M3U8_AES_STATUS_NO_ERROR);
+    plain.insert(plain.end(), buffer.begin(), buffer.begin() + out_s);
+
+    EXPECT_EQ(plain, pattern(100)) << "chunk " << chunk;
+  }
+}
+
+// ----------- m3u8_aes_final -----------
+
+TEST_P(m3u8_aes_test, given_wrong_key_reports_bad_padding) {
+  std::vector<unsigned char> cipher = from_hex(MOCK_PATTERN_CIPHER);
+  int                        status = 0;
+
+  key[0] ^= 0xff;
+
+  stream(cipher, 16, &status);
+  EXPECT_EQ(status, M3U8_AES_STATUS_PADDING_ERROR);
+}
+
+TEST_P(m3u8_aes_test, given_truncated_cipher_reports_misalignment) {
+  std::vector<unsigned char> cipher = from_hex(MOCK_PATTERN_CIPHER);
+  int                        status = 0;
+
+  cipher.resize(cipher.size() - 5);
+
+  stream(cipher, 16, &status);
+  EXPECT_EQ(status, M3U8_AES_STATUS_INVALID_ARG);
+}
+
+// ----------- m3u8_aes_decrypt -----------
+
+TEST_P(m3u8_aes_test, given_whole_segment_decrypts_in_place) {
+  std::vector<unsigned char> data = from_hex(MOCK_PATTERN_CIPHER);
+  size_t                     data_s = 0;
+
+  if (GetParam() && !m3u8_aes_is_accelerated()) {
+    GTEST_SKIP() << "AES-NI is not available";
+  }
+
+  // NOTE: the one-shot call always takes the fastest path available
+  ASSERT_EQ(m3u8_aes_decrypt(key.data(), iv.data(), data.data(), data.size(), &data_s),
+            M3U8_AES_STATUS_NO_ERROR);
+  data.resize(data_s);
+  EXPECT_EQ(data, pattern(100));
+}
+
+INSTANTIATE_TEST_SUITE_P(paths, m3u8_aes_test, ::testing::Values(false, true),
+                         [](const ::testing::TestParamInfo<bool>& info) {
+                           return std::string(info.param ? "accelerated" : "portable");
+                         });
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
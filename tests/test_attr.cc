@@ -1,6 +1,7 @@
 #include <gtest/gtest.h>
 #include <cstddef>
 #include <cstring>
+#include <string>
 
 extern "C" {
 #include "../src/attr.h"
@@ -184,6 +185,95 @@ TEST(m3u8_attr_destroy_test, given_null_pointer_returns_error) {
   EXPECT_EQ(m3u8_attr_destroy(nullptr), M3U8_ATTR_STATUS_INVALID_ARG);
 }
 
+// ----------- m3u8_attrs_parse -----------
+
+TEST(m3u8_attrs_parse_test, given_known_keys_looks_them_up_by_id) {
+  m3u8_attrs_t attrs;
+  const char*  value = NULL;
+
+  ASSERT_EQ(m3u8_attrs_parse(MOCK_EXT_X_STREAM, &attrs), M3U8_ATTR_STATUS_NO_ERROR);
+  EXPECT_EQ(attrs.count, 7);
+  EXPECT_NE(attrs.present & (1ULL << M3U8_ATTR_KEY_BANDWIDTH), 0u);
+  EXPECT_EQ(attrs.present & (1ULL << M3U8_ATTR_KEY_URI), 0u);
+
+  EXPECT_EQ(m3u8_attrs_get(&attrs, M3U8_ATTR_KEY_BANDWIDTH, &value), M3U8_ATTR_STATUS_NO_ERROR);
+  EXPECT_STREQ(value, "800000");
+  EXPECT_EQ(m3u8_attrs_get(&attrs, M3U8_ATTR_KEY_CODECS, &value), M3U8_ATTR_STATUS_NO_ERROR);
+  EXPECT_STREQ(value, "avc1.4d401f,mp4a.40.2");
+  EXPECT_TRUE(attrs.entries[2].is_quoted);
+  EXPECT_EQ(m3u8_attrs_get(&attrs, M3U8_ATTR_KEY_URI, &value), M3U8_ATTR_STATUS_NOT_FOUND);
+  EXPECT_EQ(m3u8_attrs_get(&attrs, M3U8_ATTR_KEY_UNKNOWN, &value), M3U8_ATTR_STATUS_INVALID_ARG);
+
+  EXPECT_EQ(m3u8_attrs_find(&attrs, "FRAME-RATE", &value), M3U8_ATTR_STATUS_NO_ERROR);
+  EXPECT_STREQ(value, "30.000");
+  EXPECT_STREQ(m3u8_attrs_key(&attrs, 6), "SUBTITLES");
+  EXPECT_EQ(m3u8_attrs_key(&attrs, 7), nullptr);
+
+  EXPECT_EQ(m3u8_attrs_destroy(&attrs), M3U8_ATTR_STATUS_NO_ERROR);
+}
+
+TEST(m3u8_attrs_parse_test, given_unknown_and_long_values_spills_to_heap) {
+  m3u8_attrs_t attrs;
+  const char*  value = NULL;
+  char*        taken = NULL;
+  std::string  uri(100, 'u');
+  std::string  buffer = "#EXT-X-KEY:METHOD=AES-128,X-CUSTOM=\"a,b\",URI=\"" + uri + "\"";
+
+  for (int i = 0; i < 10; i++) {
+    buffer += ",X-" + std::to_string(i) + "=" + std::to_string(i);
+  }
+
+  ASSERT_EQ(m3u8_attrs_parse(buffer.c_str(), &attrs), M3U8_ATTR_STATUS_NO_ERROR);
+  EXPECT_EQ(attrs.count, 13);
+  EXPECT_NE(attrs.entries, attrs.local);
+
+  EXPECT_EQ(m3u8_attrs_find(&attrs, "X-CUSTOM", &value), M3U8_ATTR_STATUS_NO_ERROR);
+  EXPECT_STREQ(value, "a,b");
+  EXPECT_EQ(m3u8_attrs_find(&attrs, "X-9", &value), M3U8_ATTR_STATUS_NO_ERROR);
+  EXPECT_STREQ(value, "9");
+  EXPECT_EQ(m3u8_attrs_find(&attrs, "X-10", &value), M3U8_ATTR_STATUS_NOT_FOUND);
+
+  EXPECT_STREQ(m3u8_attrs_value(&attrs, 2), uri.c_str());
+  EXPECT_EQ(m3u8_attrs_take(&attrs, 2, &taken), M3U8_ATTR_STATUS_NO_ERROR);
+  EXPECT_EQ(std::string(taken), uri);
+  EXPECT_STREQ(m3u8_attrs_value(&attrs, 2), "");
+  free(taken);
+
+  EXPECT_EQ(m3u8_attrs_destroy(&attrs), M3U8_ATTR_STATUS_NO_ERROR);
+  EXPECT_EQ(attrs.count, 0);
+}
+
+TEST(m3u8_attrs_parse_test, given_odd_syntax_matches_the_list_parser) {
+  m3u8_attrs_t attrs;
+
+  ASSERT_EQ(m3u8_attrs_parse("TAG:A=,B=\"x\"y,C=\"open,D=1", &attrs), M3U8_ATTR_STATUS_NO_ERROR);
+  ASSERT_EQ(attrs.count, 3);
+  EXPECT_STREQ(m3u8_attrs_key(&attrs, 0), "B");
+  EXPECT_STREQ(m3u8_attrs_value(&attrs, 0), "\"x\"y");
+  EXPECT_FALSE(attrs.entries[0].is_quoted);
+  EXPECT_STREQ(m3u8_attrs_value(&attrs, 1), "\"open");
+  EXPECT_STREQ(m3u8_attrs_value(&attrs, 2), "1");
+  EXPECT_EQ(m3u8_attrs_destroy(&attrs), M3U8_ATTR_STATUS_NO_ERROR);
+
+  EXPECT_EQ(m3u8_attrs_parse(nullptr, &attrs), M3U8_ATTR_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_attrs_parse("A=1", nullptr), M3U8_ATTR_STATUS_INVALID_ARG);
+}
+
+// ----------- m3u8_attr_key_lookup -----------
+
+TEST(m3u8_attr_key_lookup_test, given_every_known_name_returns_its_key) {
+  for (int i = 0; i < M3U8_ATTR_KEY_UNKNOWN; i++) {
+    const char* name = m3u8_attr_key_name((m3u8_attr_key_e)i);
+
+    ASSERT_NE(name, nullptr);
+    EXPECT_EQ(m3u8_attr_key_lookup(name, strlen(name)), i) << name;
+  }
+
+  EXPECT_EQ(m3u8_attr_key_lookup("BANDWIDTHX", 10), M3U8_ATTR_KEY_UNKNOWN);
+  EXPECT_EQ(m3u8_attr_key_lookup("VIDEO-RANGE", 5), M3U8_ATTR_KEY_VIDEO);
+  EXPECT_EQ(m3u8_attr_key_name(M3U8_ATTR_KEY_UNKNOWN), nullptr);
+}
+
 // ----------- main -----------
 
 int main(int argc, char** argv) {
@@ -0,0 +1,160 @@
+#include <gtest/gtest.h>
+#include <math.h>
+#include <string.h>
+
+extern "C" {
+#include "../src/daterange.h"
+}
+
+#define T0 1747746000.0  // 2025-05-20T13:00:00Z
+
+class m3u8_daterange_test : public ::testing::Test {
+ protected:
+  m3u8_media_t media;
+
+  void SetUp() override {
+    memset(&media, 0, sizeof(m3u8_media_t));
+  }
+
+  void TearDown() override {
+    EXPECT_EQ(m3u8_daterange_clear(&media), M3U8_DATERANGE_STATUS_NO_ERROR);
+  }
+
+  void update(const char* attributes) {
+    ext_x_daterange_t daterange;
+
+    ASSERT_EQ(m3u8_daterange_parse(attributes, &daterange), M3U8_DATERANGE_STATUS_NO_ERROR);
+    ASSERT_EQ(m3u8_daterange_update(&media, &daterange), M3U8_DATERANGE_STATUS_NO_ERROR);
+  }
+
+  void add(const char* id, double start, double duration) {
+    ext_x_daterange_t daterange = {};
+
+    daterange.id = strdup(id);
+    daterange.start_date = start;
+    daterange.duration = duration;
+    daterange.planned_duration = -1;
+    ASSERT_EQ(m3u8_daterange_update(&media, &daterange), M3U8_DATERANGE_STATUS_NO_ERROR);
+  }
+
+  int overlaps(double from, double to) {
+    int count = -1;
+
+    EXPECT_EQ(m3u8_daterange_query(&media, from, to, NULL, 0, &count), M3U8_DATERANGE_STATUS_NO_ERROR);
+
+    return count;
+  }
+};
+
+// ----------- m3u8_daterange_parse -----------
+
+TEST_F(m3u8_daterange_test, given_ad_break_parses_fields) {
+  ext_x_daterange_t daterange;
+
+  ASSERT_EQ(m3u8_daterange_parse("ID=\"ad1\",CLASS=\"com.advertisement\",START-DATE=\"2025-05-20T13:00:00Z\","
+                                 "DURATION=15.0,SCTE35-OUT=0xFC002F0000,X-AD-ID=\"42\"",
+                                 &daterange),
+            M3U8_DATERANGE_STATUS_NO_ERROR);
+
+  EXPECT_STREQ(daterange.id, "ad1");
+  EXPECT_STREQ(daterange.class_name, "com.advertisement");
+  EXPECT_DOUBLE_EQ(daterange.start_date, T0);
+  EXPECT_DOUBLE_EQ(daterange.duration, 15.0);
+  EXPECT_DOUBLE_EQ(daterange.planned_duration, -1);
+  EXPECT_STREQ(daterange.scte35_out, "0xFC002F0000");
+  EXPECT_EQ(daterange.scte35_in, nullptr);
+  EXPECT_DOUBLE_EQ(daterange.end, T0 + 15.0);
+  EXPECT_EQ(m3u8_daterange_destroy(&daterange), M3U8_DATERANGE_STATUS_NO_ERROR);
+
+  ASSERT_EQ(m3u8_daterange_parse("ID=\"live-event\",CLASS=\"event\",START-DATE=\"2025-05-20T14:00:00Z\","
+                                 "PLANNED-DURATION=3600.0",
+                                 &daterange),
+            M3U8_DATERANGE_STATUS_NO_ERROR);
+  EXPECT_DOUBLE_EQ(daterange.end, T0 + 7200.0);
+  EXPECT_EQ(m3u8_daterange_destroy(&daterange), M3U8_DATERANGE_STATUS_NO_ERROR);
+}
+
+TEST_F(m3u8_daterange_test, given_malformed_tags_fails) {
+  ext_x_daterange_t daterange;
+
+  EXPECT_EQ(m3u8_daterange_parse("CLASS=\"x\",START-DATE=\"2025-05-20T13:00:00Z\"", &daterange),
+            M3U8_DATERANGE_STATUS_FORMAT_ERROR);
+  EXPECT_EQ(m3u8_daterange_parse("ID=\"a\",START-DATE=\"tomorrow\"", &daterange),
+            M3U8_DATERANGE_STATUS_FORMAT_ERROR);
+  EXPECT_EQ(m3u8_daterange_parse("ID=\"a\",START-DATE=\"2025-05-20T13:00:00Z\",DURATION=-1", &daterange),
+            M3U8_DATERANGE_STATUS_FORMAT_ERROR);
+  EXPECT_EQ(m3u8_daterange_parse("ID=\"a\",START-DATE=\"2025-05-20T13:00:00Z\",END-ON-NEXT=YES", &daterange),
+            M3U8_DATERANGE_STATUS_FORMAT_ERROR);
+  EXPECT_EQ(m3u8_daterange_parse(NULL, &daterange), M3U8_DATERANGE_STATUS_INVALID_ARG);
+}
+
+// ----------- m3u8_daterange_query -----------
+
+TEST_F(m3u8_daterange_test, given_many_ranges_matches_brute_force) {
+  const ext_x_daterange_t* found[8];
+  int                      count = 0;
+
+  // NOTE: out of order starts exercise the rebuild, in order ones the incremental path
+  for (int i = 0; i < 200; i++) {
+    char id[16];
+    int  start = (i * 37) % 200 * 10;
+
+    snprintf(id, sizeof(id), "r%d", i);
+    add(id, T0 + start, (i % 7) * 15.0);
+  }
+
+  for (double from = 0; from < 2100; from += 13) {
+    int expected = 0;
+
+    for (int i = 0; i < media.dateranges_count; i++) {
+      expected += media.dateranges[i].start_date <= T0 + from + 25 && media.dateranges[i].end >= T0 + from;
+    }
+
+    EXPECT_EQ(overlaps(T0 + from, T0 + from + 25), expected) << "from " << from;
+  }
+
+  ASSERT_EQ(m3u8_daterange_query(&media, T0 + 100, T0 + 125, found, 8, &count), M3U8_DATERANGE_STATUS_NO_ERROR);
+  ASSERT_GT(count, 0);
+
+  for (int i = 1; i < count && i < 8; i++) {
+    EXPECT_LE(found[i - 1]->start_date, found[i]->start_date);
+  }
+}
+
+// ----------- m3u8_daterange_update -----------
+
+TEST_F(m3u8_daterange_test, given_live_refresh_completes_known_range) {
+  const ext_x_daterange_t* found[2];
+  int                      count = 0;
+
+  update("ID=\"break\",CLASS=\"ad\",START-DATE=\"2025-05-20T13:00:00Z\",PLANNED-DURATION=30,"
+         "SCTE35-OUT=0xFC01");
+  EXPECT_EQ(overlaps(T0 + 40, T0 + 50), 0);
+
+  // the next reload carries the actual end of the break
+  update("ID=\"break\",CLASS=\"ad\",START-DATE=\"2025-05-20T13:00:00Z\",DURATION=45,SCTE35-IN=0xFC02");
+  ASSERT_EQ(media.dateranges_count, 1);
+  EXPECT_STREQ(media.dateranges[0].scte35_out, "0xFC01");
+  EXPECT_STREQ(media.dateranges[0].scte35_in, "0xFC02");
+  EXPECT_EQ(overlaps(T0 + 40, T0 + 50), 1);
+
+  update("ID=\"chapter1\",CLASS=\"chapter\",START-DATE=\"2025-05-20T13:01:00Z\",END-ON-NEXT=YES");
+  EXPECT_EQ(overlaps(T0 + 3600, T0 + 3600), 1);
+
+  update("ID=\"chapter2\",CLASS=\"chapter\",START-DATE=\"2025-05-20T13:05:00Z\",END-ON-NEXT=YES");
+  ASSERT_EQ(m3u8_daterange_query(&media, T0 + 3600, T0 + 3600, found, 2, &count),
+            M3U8_DATERANGE_STATUS_NO_ERROR);
+  ASSERT_EQ(count, 1);
+  EXPECT_STREQ(found[0]->id, "chapter2");
+  EXPECT_DOUBLE_EQ(media.dateranges[1].end, T0 + 300);
+
+  ASSERT_EQ(m3u8_daterange_expire(&media, T0 + 200), M3U8_DATERANGE_STATUS_NO_ERROR);
+  ASSERT_EQ(media.dateranges_count, 2);
+  EXPECT_EQ(overlaps(T0, T0 + 100), 1);
+  EXPECT_TRUE(isinf(media.dateranges[1].end));
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,111 @@
+#include <gtest/gtest.h>
+#include <string.h>
+
+extern "C" {
+#include "../src/decode.h"
+}
+
+// ----------- m3u8_decode -----------
+
+TEST(m3u8_decode_test, given_stream_inf_writes_typed_fields) {
+  ext_x_stream_inf_t variant = {};
+
+  ASSERT_EQ(m3u8_decode(&m3u8_decode_stream_inf,
+                        "BANDWIDTH=1280000,AVERAGE-BANDWIDTH=1000000,RESOLUTION=1280x720,"
+                        "FRAME-RATE=29.970,CODECS=\"avc1.4d401f,mp4a.40.2\",AUDIO=\"aac\","
+                        "CLOSED-CAPTIONS=NONE",
+                        &variant, NULL),
+            M3U8_DECODE_STATUS_NO_ERROR);
+
+  EXPECT_EQ(variant.bandwidth, 1280000);
+  EXPECT_EQ(variant.average_bandwidth, 1000000);
+  EXPECT_STREQ(variant.resolution, "1280x720");
+  EXPECT_DOUBLE_EQ(variant.frame_rate, 29.970);
+  EXPECT_STREQ(variant.codecs, "avc1.4d401f,mp4a.40.2");
+  EXPECT_STREQ(variant.audio, "aac");
+  EXPECT_STREQ(variant.closed_captions, "NONE");
+  EXPECT_EQ(variant.video, nullptr);
+
+  EXPECT_EQ(m3u8_decode_release(&m3u8_decode_stream_inf, &variant), M3U8_DECODE_STATUS_NO_ERROR);
+  EXPECT_EQ(variant.codecs, nullptr);
+}
+
+TEST(m3u8_decode_test, given_media_decodes_enums_and_booleans) {
+  ext_x_media_type_t rendition = {};
+
+  ASSERT_EQ(m3u8_decode(&m3u8_decode_media,
+                        "TYPE=SUBTITLES,GROUP-ID=\"subs\",NAME=\"English\",DEFAULT=YES,"
+                        "AUTOSELECT=NO,FORCED=YES,LANGUAGE=\"en\",URI=\"en.m3u8\"",
+                        &rendition, NULL),
+            M3U8_DECODE_STATUS_NO_ERROR);
+
+  EXPECT_EQ(rendition.type, SUBTITLES);
+  EXPECT_STREQ(rendition.group_id, "subs");
+  EXPECT_STREQ(rendition.name, "English");
+  EXPECT_TRUE(rendition.is_default);
+  EXPECT_FALSE(rendition.is_autoselect);
+  EXPECT_TRUE(rendition.is_forced);
+  EXPECT_STREQ(rendition.uri, "en.m3u8");
+
+  EXPECT_EQ(m3u8_decode_release(&m3u8_decode_media, &rendition), M3U8_DECODE_STATUS_NO_ERROR);
+}
+
+TEST(m3u8_decode_test, given_key_decodes_hex_iv_and_retains_unknown_attributes) {
+  ext_x_key    key = {};
+  m3u8_attrs_t unknown;
+  const char*  value = NULL;
+
+  ASSERT_EQ(m3u8_decode(&m3u8_decode_key,
+                        "METHOD=AES-128,URI=\"k.bin\",IV=0x000102030405060708090A0B0C0D0E0F,"
+                        "X-VENDOR=\"acme\"",
+                        &key, &unknown),
+            M3U8_DECODE_STATUS_NO_ERROR);
+
+  EXPECT_STREQ(key.method, "AES-128");
+  EXPECT_STREQ(key.uri, "k.bin");
+  EXPECT_TRUE(key.has_iv);
+  for (int i = 0; i < 16; i++) {
+    EXPECT_EQ(key.iv[i], i);
+  }
+
+  ASSERT_EQ(unknown.count, 1);
+  EXPECT_EQ(m3u8_attrs_find(&unknown, "X-VENDOR", &value), M3U8_ATTR_STATUS_NO_ERROR);
+  EXPECT_STREQ(value, "acme");
+
+  EXPECT_EQ(m3u8_attrs_destroy(&unknown), M3U8_ATTR_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_decode_release(&m3u8_decode_key, &key), M3U8_DECODE_STATUS_NO_ERROR);
+}
+
+TEST(m3u8_decode_test, given_malformed_values_returns_format_error) {
+  ext_x_stream_inf_t variant = {};
+  ext_x_media_type_t rendition = {};
+  ext_x_key          key = {};
+  ext_x_start_t      start = {};
+
+  EXPECT_EQ(m3u8_decode(&m3u8_decode_stream_inf, "CODECS=\"avc1\",BANDWIDTH=\"1\"", &variant, NULL),
+            M3U8_DECODE_STATUS_FORMAT_ERROR);
+  EXPECT_EQ(variant.codecs, nullptr);
+  EXPECT_EQ(m3u8_decode(&m3u8_decode_stream_inf, "BANDWIDTH=99999999999", &variant, NULL),
+            M3U8_DECODE_STATUS_FORMAT_ERROR);
+  EXPECT_EQ(m3u8_decode(&m3u8_decode_stream_inf, "RESOLUTION=1280x", &variant, NULL),
+            M3U8_DECODE_STATUS_FORMAT_ERROR);
+  EXPECT_EQ(m3u8_decode(&m3u8_decode_media, "TYPE=DATA", &rendition, NULL),
+            M3U8_DECODE_STATUS_FORMAT_ERROR);
+  EXPECT_EQ(m3u8_decode(&m3u8_decode_media, "DEFAULT=yes", &rendition, NULL),
+            M3U8_DECODE_STATUS_FORMAT_ERROR);
+  EXPECT_EQ(m3u8_decode(&m3u8_decode_key, "IV=0x0102", &key, NULL), M3U8_DECODE_STATUS_FORMAT_ERROR);
+  EXPECT_FALSE(key.has_iv);
+
+  EXPECT_EQ(m3u8_decode(&m3u8_decode_start, "TIME-OFFSET=-12.5,PRECISE=YES", &start, NULL),
+            M3U8_DECODE_STATUS_NO_ERROR);
+  EXPECT_DOUBLE_EQ(start.time_offset, -12.5);
+  EXPECT_TRUE(start.precise);
+
+  EXPECT_EQ(m3u8_decode(NULL, "A=1", &start, NULL), M3U8_DECODE_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_decode(&m3u8_decode_start, NULL, &start, NULL), M3U8_DECODE_STATUS_INVALID_ARG);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
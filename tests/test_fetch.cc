@@ -0,0 +1,274 @@
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <algorithm>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <thread>
+#include <vector>
+
+extern "C" {
+#include "../src/fetch.h"
+}
+
+#define MOCK_URI       "https://edge1.example.com/live/index.m3u8"
+#define MOCK_HEDGE_URI "https://edge2.example.com/live/index.m3u8"
+#define MOCK_PLAYLIST  "#EXTM3U\n#EXT-X-TARGETDURATION:6\n"
+
+// transport parking every submitted request until the test or a cancel ends it
+static std::mutex                             mock_mutex;
+static std::vector<m3u8_transport_request_t*> mock_parked;
+static std::vector<std::string>               mock_uris;
+static int                                    mock_cancelled = 0;
+
+static int mock_open(void*, const char*, m3u8_transport_stream_t*) {
+  return M3U8_TRANSPORT_STATUS_NOT_FOUND;
+}
+
+static int mock_read(void*, const char**, size_t*) {
+  return M3U8_TRANSPORT_STATUS_IO_ERROR;
+}
+
+static int mock_close(void*) {
+  return M3U8_TRANSPORT_STATUS_NO_ERROR;
+}
+
+static int mock_submit(void*, m3u8_transport_request_t* request) {
+  std::lock_guard<std::mutex> lock(mock_mutex);
+
+  mock_parked.push_back(request);
+  mock_uris.push_back(request->uri);
+
+  return M3U8_TRANSPORT_STATUS_NO_ERROR;
+}
+
+static m3u8_transport_request_t* mock_take(m3u8_transport_request_t* request) {
+  std::lock_guard<std::mutex> lock(mock_mutex);
+  auto                        it = std::find(mock_parked.begin(), mock_parked.end(), request);
+
+  if (it == mock_parked.end()) {
+    return NULL;
+  }
+
+  mock_parked.erase(it);
+
+  return request;
+}
+
+static int mock_cancel(void*, m3u8_transport_request_t* request) {
+  if (mock_take(request) != NULL) {
+    mock_cancelled++;
+    request->done(request, M3U8_TRANSPORT_STATUS_CANCELLED, request->userdata);
+  }
+
+  return M3U8_TRANSPORT_STATUS_NO_ERROR;
+}
+
+static const m3u8_transport_ops_t mock_ops = {
+    "parking", mock_open, mock_read, NULL, mock_close, mock_submit, NULL, mock_cancel,
+};
+
+// waits until the fetch under test submitted count requests
+static m3u8_transport_request_t* mock_submitted(size_t count) {
+  for (int i = 0; i < 2000; i++) {
+    {
+      std::lock_guard<std::mutex> lock(mock_mutex);
+
+      if (mock_uris.size() >= count) {
+        return mock_parked.empty() ? NULL : mock_parked.back();
+      }
+    }
+
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+  }
+
+  return NULL;
+}
+
+static void mock_complete(m3u8_transport_request_t* request, const char* body, int status) {
+  ASSERT_EQ(mock_take(request), request);
+
+  if (body != NULL) {
+    request->write(body, strlen(body), request->userdata);
+  }
+
+  request->done(request, status, request->userdata);
+}
+
+class m3u8_fetch_test : public ::testing::Test {
+ protected:
+  m3u8_transport_t* transport = NULL;
+  char*             body = NULL;
+  size_t            body_s = 0;
+
+  void SetUp() override {
+    mock_parked.clear();
+    mock_uris.clear();
+    mock_cancelled = 0;
+    ASSERT_EQ(m3u8_transport_create(&transport, &mock_ops, NULL), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  }
+
+  void TearDown() override {
+    free(body);
+    m3u8_transport_destroy(transport);
+  }
+};
+
+// ----------- m3u8_fetch -----------
+
+TEST_F(m3u8_fetch_test, given_slow_origin_returns_timeout_at_deadline) {
+  m3u8_fetch_options_t options = {};
+  auto                 started = std::chrono::steady_clock::now();
+
+  options.deadline_ms = 50;
+
+  EXPECT_EQ(m3u8_fetch(transport, MOCK_URI, &options, &body, &body_s), M3U8_FETCH_STATUS_TIMEOUT);
+  EXPECT_GE(std::chrono::steady_clock::now() - started, std::chrono::milliseconds(49));
+  EXPECT_EQ(mock_cancelled, 1);
+  EXPECT_TRUE(mock_parked.empty());
+}
+
+TEST_F(m3u8_fetch_test, given_triggered_token_returns_cancelled) {
+  m3u8_cancel_t*       cancel = NULL;
+  m3u8_fetch_options_t options = {};
+  int                  status = -1;
+
+  ASSERT_EQ(m3u8_cancel_create(&cancel), M3U8_FETCH_STATUS_NO_ERROR);
+  options.cancel = cancel;
+
+  std::thread fetcher([&] { status = m3u8_fetch(transport, MOCK_URI, &options, &body, &body_s); });
+
+  ASSERT_NE(mock_submitted(1), nullptr);
+  EXPECT_EQ(m3u8_cancel_trigger(cancel), M3U8_FETCH_STATUS_NO_ERROR);
+  fetcher.join();
+
+  EXPECT_EQ(status, M3U8_FETCH_STATUS_CANCELLED);
+  EXPECT_TRUE(m3u8_cancel_is_triggered(cancel));
+  EXPECT_EQ(mock_cancelled, 1);
+
+  // a triggered token stops later fetches before anything is submitted
+  EXPECT_EQ(m3u8_fetch(transport, MOCK_URI, &options, &body, &body_s),
+            M3U8_FETCH_STATUS_CANCELLED);
+  EXPECT_EQ(mock_uris.size(), 1u);
+  EXPECT_EQ(m3u8_cancel_destroy(cancel), M3U8_FETCH_STATUS_NO_ERROR);
+}
+
+TEST_F(m3u8_fetch_test, given_slow_primary_hedge_wins_and_primary_is_cancelled) {
+  m3u8_fetch_options_t options = {};
+  int                  status = -1;
+
+  options.is_hedged = true;
+  options.hedge_delay_ms = 20;
+  options.hedge_uri = MOCK_HEDGE_URI;
+
+  std::thread fetcher([&] { status = m3u8_fetch(transport, MOCK_URI, &options, &body, &body_s); });
+
+  m3u8_transport_request_t* hedge = mock_submitted(2);
+
+  ASSERT_NE(hedge, nullptr);
+  EXPECT_EQ(mock_uris[0], MOCK_URI);
+  EXPECT_EQ(mock_uris[1], MOCK_HEDGE_URI);
+
+  mock_complete(hedge, MOCK_PLAYLIST, M3U8_TRANSPORT_STATUS_NO_ERROR);
+  fetcher.join();
+
+  ASSERT_EQ(status, M3U8_FETCH_STATUS_NO_ERROR);
+  EXPECT_EQ(std::string(body, body_s), MOCK_PLAYLIST);
+  EXPECT_EQ(body[body_s], 0);
+  EXPECT_EQ(mock_cancelled, 1);
+}
+
+TEST_F(m3u8_fetch_test, given_failed_primary_hedges_immediately) {
+  m3u8_fetch_options_t options = {};
+  int                  status = -1;
+
+  options.is_hedged = true;
+  options.hedge_delay_ms = 60000;
+
+  std::thread fetcher([&] { status = m3u8_fetch(transport, MOCK_URI, &options, &body, &body_s); });
+
+  mock_complete(mock_submitted(1), NULL, M3U8_TRANSPORT_STATUS_IO_ERROR);
+  mock_complete(mock_submitted(2), MOCK_PLAYLIST, M3U8_TRANSPORT_STATUS_NO_ERROR);
+  fetcher.join();
+
+  ASSERT_EQ(status, M3U8_FETCH_STATUS_NO_ERROR);
+  EXPECT_EQ(std::string(body, body_s), MOCK_PLAYLIST);
+  EXPECT_EQ(mock_uris[1], MOCK_URI);
+  EXPECT_EQ(mock_cancelled, 0);
+}
+
+TEST_F(m3u8_fetch_test, given_every_request_failing_returns_fetch_error) {
+  m3u8_fetch_options_t options = {};
+  int                  status = -1;
+
+  options.is_hedged = true;
+
+  std::thread fetcher([&] { status = m3u8_fetch(transport, MOCK_URI, &options, &body, &body_s); });
+
+  mock_complete(mock_submitted(1), NULL, M3U8_TRANSPORT_STATUS_NOT_FOUND);
+  mock_complete(mock_submitted(2), NULL, M3U8_TRANSPORT_STATUS_NOT_FOUND);
+  fetcher.join();
+
+  EXPECT_EQ(status, M3U8_FETCH_STATUS_FETCH_ERROR);
+  EXPECT_EQ(body, nullptr);
+}
+
+TEST_F(m3u8_fetch_test, given_synchronous_transport_completes_inline) {
+  m3u8_transport_t* memory = NULL;
+
+  ASSERT_EQ(m3u8_transport_memory_create(&memory), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_transport_memory_put(memory, MOCK_URI, MOCK_PLAYLIST, strlen(MOCK_PLAYLIST), true),
+            M3U8_TRANSPORT_STATUS_NO_ERROR);
+
+  ASSERT_EQ(m3u8_fetch(memory, MOCK_URI, NULL, &body, &body_s), M3U8_FETCH_STATUS_NO_ERROR);
+  EXPECT_EQ(std::string(body, body_s), MOCK_PLAYLIST);
+  EXPECT_EQ(m3u8_fetch(memory, NULL, NULL, &body, &body_s), M3U8_FETCH_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_transport_destroy(memory), M3U8_TRANSPORT_STATUS_NO_ERROR);
+}
+
+// ----------- m3u8_latency_percentile -----------
+
+TEST_F(m3u8_fetch_test, given_recorded_samples_computes_nearest_rank) {
+  m3u8_latency_t* latency = NULL;
+
+  ASSERT_EQ(m3u8_latency_create(&latency), M3U8_FETCH_STATUS_NO_ERROR);
+
+  for (long i = 1; i < M3U8_LATENCY_MIN_SAMPLES; i++) {
+    ASSERT_EQ(m3u8_latency_record(latency, i), M3U8_FETCH_STATUS_NO_ERROR);
+  }
+
+  EXPECT_EQ(m3u8_latency_percentile(latency, 95), -1);
+
+  for (long i = M3U8_LATENCY_MIN_SAMPLES; i <= 100; i++) {
+    ASSERT_EQ(m3u8_latency_record(latency, 101 - i + M3U8_LATENCY_MIN_SAMPLES - 1),
+              M3U8_FETCH_STATUS_NO_ERROR);
+  }
+
+  EXPECT_EQ(m3u8_latency_percentile(latency, 95), 95);
+  EXPECT_EQ(m3u8_latency_percentile(latency, 100), 100);
+  EXPECT_EQ(m3u8_latency_record(latency, -1), M3U8_FETCH_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_latency_destroy(latency), M3U8_FETCH_STATUS_NO_ERROR);
+}
+
+TEST_F(m3u8_fetch_test, given_window_overflow_keeps_recent_samples) {
+  m3u8_latency_t* latency = NULL;
+
+  ASSERT_EQ(m3u8_latency_create(&latency), M3U8_FETCH_STATUS_NO_ERROR);
+
+  for (int i = 0; i < M3U8_LATENCY_WINDOW; i++) {
+    m3u8_latency_record(latency, 5000);
+  }
+
+  for (int i = 0; i < M3U8_LATENCY_WINDOW; i++) {
+    m3u8_latency_record(latency, 40);
+  }
+
+  EXPECT_EQ(m3u8_latency_percentile(latency, 95), 40);
+  EXPECT_EQ(m3u8_latency_destroy(latency), M3U8_FETCH_STATUS_NO_ERROR);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,220 @@
+#include <gtest/gtest.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include <string>
+#include <unordered_map>
+
+extern "C" {
+#include "../src/hash.h"
+}
+
+/** @brief bump allocator standing in for a parser arena */
+typedef struct {
+  char   bytes[1 << 16];
+  size_t used;
+  int    frees;
+} test_arena_t;
+
+static void* test_arena_alloc(void* context, size_t size) {
+  test_arena_t* arena = (test_arena_t*)context;
+  void*         block = NULL;
+
+  size = (size + 15) & ~(size_t)15;
+
+  if (arena->used + size > sizeof(arena->bytes)) {
+    return NULL;
+  }
+
+  block = arena->bytes + arena->used;
+  arena->used += size;
+
+  return block;
+}
+
+static void test_arena_free(void* context, void* block) {
+  ((test_arena_t*)context)->frees++;
+}
+
+// ----------- m3u8_hash_create -----------
+
+TEST(m3u8_hash_create_test, given_null_pointer_returns_invalid_arg) {
+  m3u8_hash_t* hash = NULL;
+
+  EXPECT_EQ(m3u8_hash_create(NULL, NULL), M3U8_HASH_STATUS_INVALID_ARG);
+  ASSERT_EQ(m3u8_hash_create(&hash, NULL), M3U8_HASH_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_hash_create(&hash, NULL), M3U8_HASH_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_hash_destroy(hash), M3U8_HASH_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_hash_destroy(NULL), M3U8_HASH_STATUS_INVALID_ARG);
+}
+
+// ----------- m3u8_hash_put -----------
+
+TEST(m3u8_hash_put_test, given_spans_keys_them_by_bytes) {
+  m3u8_hash_t* hash = NULL;
+  const char*  line = "BANDWIDTH=800000,AUDIO=\"aac\"";
+  void*        value = NULL;
+  size_t       count = 0;
+  int          bandwidth = 1;
+  int          audio = 2;
+
+  ASSERT_EQ(m3u8_hash_create(&hash, NULL), M3U8_HASH_STATUS_NO_ERROR);
+
+  EXPECT_EQ(m3u8_hash_put(hash, line, 9, &bandwidth), M3U8_HASH_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_hash_put(hash, line + 17, 5, &audio), M3U8_HASH_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_hash_put(hash, "", 0, &audio), M3U8_HASH_STATUS_NO_ERROR);
+
+  EXPECT_EQ(m3u8_hash_get(hash, "BANDWIDTH", 9, &value), M3U8_HASH_STATUS_NO_ERROR);
+  EXPECT_EQ(value, &bandwidth);
+  EXPECT_EQ(m3u8_hash_get(hash, "AUDIO", 5, &value), M3U8_HASH_STATUS_NO_ERROR);
+  EXPECT_EQ(value, &audio);
+  EXPECT_EQ(m3u8_hash_get(hash, "BANDWIDTH", 4, &value), M3U8_HASH_STATUS_NOT_FOUND);
+  EXPECT_EQ(m3u8_hash_get(hash, NULL, 0, &value), M3U8_HASH_STATUS_NO_ERROR);
+
+  EXPECT_EQ(m3u8_hash_put(hash, "AUDIO", 5, &bandwidth), M3U8_HASH_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_hash_get(hash, "AUDIO", 5, &value), M3U8_HASH_STATUS_NO_ERROR);
+  EXPECT_EQ(value, &bandwidth);
+  EXPECT_EQ(m3u8_hash_count(hash, &count), M3U8_HASH_STATUS_NO_ERROR);
+  EXPECT_EQ(count, 3u);
+
+  EXPECT_EQ(m3u8_hash_put(NULL, "A", 1, NULL), M3U8_HASH_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_hash_put(hash, NULL, 1, NULL), M3U8_HASH_STATUS_INVALID_ARG);
+
+  EXPECT_EQ(m3u8_hash_destroy(hash), M3U8_HASH_STATUS_NO_ERROR);
+}
+
+TEST(m3u8_hash_put_test, given_copy_keys_outlives_the_caller_buffer) {
+  m3u8_hash_config_t config = {};
+  m3u8_hash_t*       hash = NULL;
+  void*              value = NULL;
+  char               key[16];
+
+  config.copy_keys = true;
+  ASSERT_EQ(m3u8_hash_create(&hash, &config), M3U8_HASH_STATUS_NO_ERROR);
+
+  strcpy(key, "group-audio");
+  EXPECT_EQ(m3u8_hash_put(hash, key, strlen(key), key), M3U8_HASH_STATUS_NO_ERROR);
+  memset(key, 'x', sizeof(key));
+
+  EXPECT_EQ(m3u8_hash_get(hash, "group-audio", 11, &value), M3U8_HASH_STATUS_NO_ERROR);
+  EXPECT_EQ(value, key);
+
+  EXPECT_EQ(m3u8_hash_destroy(hash), M3U8_HASH_STATUS_NO_ERROR);
+}
+
+// ----------- m3u8_hash_remove -----------
+
+TEST(m3u8_hash_remove_test, given_churn_matches_a_reference_map) {
+  m3u8_hash_config_t                   config = {};
+  m3u8_hash_t*                         hash = NULL;
+  std::unordered_map<std::string, int> reference;
+  std::string                          keys[512];
+  unsigned int                         seed = 7;
+  size_t                               count = 0;
+
+  config.copy_keys = true;
+  ASSERT_EQ(m3u8_hash_create(&hash, &config), M3U8_HASH_STATUS_NO_ERROR);
+
+  for (int i = 0; i < 512; i++) {
+    keys[i] = "segment" + std::to_string(i) + ".ts";
+  }
+
+  for (int i = 0; i < 100000; i++) {
+    const std::string& key = keys[(seed = seed * 1103515245u + 12345u) >> 16 & 511];
+    void*              value = NULL;
+
+    if (seed & 1) {
+      EXPECT_EQ(m3u8_hash_put(hash, key.data(), key.size(), (void*)(intptr_t)(i + 1)),
+                M3U8_HASH_STATUS_NO_ERROR);
+      reference[key] = i + 1;
+    } else {
+      EXPECT_EQ(m3u8_hash_remove(hash, key.data(), key.size(), &value),
+                reference.count(key) ? M3U8_HASH_STATUS_NO_ERROR : M3U8_HASH_STATUS_NOT_FOUND);
+
+      if (reference.count(key)) {
+        EXPECT_EQ((intptr_t)value, reference[key]);
+        reference.erase(key);
+      }
+    }
+  }
+
+  EXPECT_EQ(m3u8_hash_count(hash, &count), M3U8_HASH_STATUS_NO_ERROR);
+  EXPECT_EQ(count, reference.size());
+
+  for (const auto& pair : reference) {
+    void* value = NULL;
+
+    ASSERT_EQ(m3u8_hash_get(hash, pair.first.data(), pair.first.size(), &value),
+              M3U8_HASH_STATUS_NO_ERROR);
+    EXPECT_EQ((intptr_t)value, pair.second);
+  }
+
+  EXPECT_EQ(m3u8_hash_destroy(hash), M3U8_HASH_STATUS_NO_ERROR);
+}
+
+// ----------- m3u8_hash_next -----------
+
+TEST(m3u8_hash_next_test, given_entries_visits_each_once) {
+  m3u8_hash_t*             hash = NULL;
+  const m3u8_hash_entry_t* entry = NULL;
+  size_t                   cursor = 0;
+  int                      visits[100] = {0};
+  int                      values[100];
+
+  ASSERT_EQ(m3u8_hash_create(&hash, NULL), M3U8_HASH_STATUS_NO_ERROR);
+
+  for (int i = 0; i < 100; i++) {
+    values[i] = i;
+    ASSERT_EQ(m3u8_hash_put(hash, (const char*)&values[i], sizeof(int), &values[i]),
+              M3U8_HASH_STATUS_NO_ERROR);
+  }
+
+  while (m3u8_hash_next(hash, &cursor, &entry) == M3U8_HASH_STATUS_NO_ERROR) {
+    visits[*(int*)entry->value]++;
+  }
+
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(visits[i], 1);
+  }
+
+  EXPECT_EQ(m3u8_hash_destroy(hash), M3U8_HASH_STATUS_NO_ERROR);
+}
+
+// ----------- m3u8_hash_config_t -----------
+
+TEST(m3u8_hash_config_test, given_an_arena_allocates_from_it) {
+  test_arena_t*      arena = (test_arena_t*)calloc(1, sizeof(test_arena_t));
+  m3u8_hash_config_t config = {};
+  m3u8_hash_t*       hash = NULL;
+  void*              value = NULL;
+
+  config.capacity = 100;
+  config.copy_keys = true;
+  config.alloc = test_arena_alloc;
+  config.free = test_arena_free;
+  config.context = arena;
+
+  ASSERT_EQ(m3u8_hash_create(&hash, &config), M3U8_HASH_STATUS_NO_ERROR);
+  EXPECT_GE(arena->used, 128 * (1 + sizeof(m3u8_hash_entry_t)));
+
+  for (int i = 0; i < 100; i++) {
+    std::string key = "k" + std::to_string(i);
+
+    ASSERT_EQ(m3u8_hash_put(hash, key.data(), key.size(), arena), M3U8_HASH_STATUS_NO_ERROR);
+  }
+
+  // NOTE: sized up front, so nothing was released by a rehash
+  EXPECT_EQ(arena->frees, 0);
+  EXPECT_EQ(m3u8_hash_get(hash, "k42", 3, &value), M3U8_HASH_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_hash_destroy(hash), M3U8_HASH_STATUS_NO_ERROR);
+  EXPECT_EQ(arena->frees, 103);
+
+  free(arena);
+}
+
+// ----------- main -----------
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,174 @@
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <string.h>
+
+extern "C" {
+#include "../src/intern.h"
+#include "../src/rendition.h"
+#include "../src/variant.h"
+}
+
+#define CODECS "avc1.4d401f,mp4a.40.2"
+
+static void* mock_intern_worker(void* arg) {
+  int         id = *(int*)arg;
+  const char* held[64];
+
+  for (int round = 0; round < 200; round++) {
+    for (int i = 0; i < 64; i++) {
+      char string[32];
+
+      snprintf(string, sizeof(string), "group-%d", (i * 7 + id + round) % 50);
+      EXPECT_EQ(m3u8_intern(string, &held[i]), M3U8_INTERN_STATUS_NO_ERROR);
+      EXPECT_STREQ(held[i], string);
+    }
+
+    for (int i = 0; i < 64; i++) {
+      EXPECT_EQ(m3u8_intern_release(held[i]), M3U8_INTERN_STATUS_NO_ERROR);
+    }
+  }
+
+  return NULL;
+}
+
+class m3u8_intern_test : public ::testing::Test {
+ protected:
+  m3u8_intern_stats_t before;
+
+  void SetUp() override {
+    ASSERT_EQ(m3u8_intern_stats(&before), M3U8_INTERN_STATUS_NO_ERROR);
+  }
+
+  void TearDown() override {
+    m3u8_intern_stats_t after;
+
+    // every test gives back what it took
+    ASSERT_EQ(m3u8_intern_stats(&after), M3U8_INTERN_STATUS_NO_ERROR);
+    EXPECT_EQ(after.strings, before.strings);
+    EXPECT_EQ(after.references, before.references);
+    EXPECT_EQ(after.bytes, before.bytes);
+  }
+
+  void append(m3u8_t* m3u8_ptr, int bandwidth) {
+    ext_x_stream_inf_t variant = {};
+
+    variant.bandwidth = bandwidth;
+    variant.codecs = strdup(CODECS);
+    variant.audio = strdup("aac");
+    variant.uri = strdup("https://cdn.example.com/live/v.m3u8");
+    ASSERT_EQ(m3u8_variant_append(m3u8_ptr, &variant), M3U8_VARIANT_STATUS_NO_ERROR);
+  }
+};
+
+// ----------- m3u8_intern -----------
+
+TEST_F(m3u8_intern_test, given_equal_strings_shares_one_copy) {
+  char                buffer[] = CODECS;
+  const char*         a = NULL;
+  const char*         b = NULL;
+  const char*         c = NULL;
+  m3u8_intern_stats_t stats;
+
+  ASSERT_EQ(m3u8_intern(CODECS, &a), M3U8_INTERN_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_intern(buffer, &b), M3U8_INTERN_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_intern_n("avc1.4d401f", 4, &c), M3U8_INTERN_STATUS_NO_ERROR);
+  EXPECT_EQ(a, b);
+  EXPECT_NE(a, buffer);
+  EXPECT_STREQ(c, "avc1");
+
+  ASSERT_EQ(m3u8_intern_stats(&stats), M3U8_INTERN_STATUS_NO_ERROR);
+  EXPECT_EQ(stats.strings, before.strings + 2);
+  EXPECT_EQ(stats.references, before.references + 3);
+  EXPECT_EQ(stats.bytes, before.bytes + sizeof(CODECS) + 5);
+
+  ASSERT_EQ(m3u8_intern_retain(a), M3U8_INTERN_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_intern_release(a), M3U8_INTERN_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_intern_release(b), M3U8_INTERN_STATUS_NO_ERROR);
+
+  // still held once
+  ASSERT_EQ(m3u8_intern_stats(&stats), M3U8_INTERN_STATUS_NO_ERROR);
+  EXPECT_EQ(stats.strings, before.strings + 2);
+  EXPECT_STREQ(a, CODECS);
+
+  EXPECT_EQ(m3u8_intern_release(a), M3U8_INTERN_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_intern_release(c), M3U8_INTERN_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_intern_release(NULL), M3U8_INTERN_STATUS_INVALID_ARG);
+}
+
+TEST_F(m3u8_intern_test, given_many_strings_grows_and_shrinks_shards) {
+  const char* held[2000];
+
+  for (int i = 0; i < 2000; i++) {
+    char string[32];
+
+    snprintf(string, sizeof(string), "segment-%d.ts", i);
+    ASSERT_EQ(m3u8_intern(string, &held[i]), M3U8_INTERN_STATUS_NO_ERROR);
+  }
+
+  // release every other string, so removals shift probe chains
+  for (int i = 0; i < 2000; i += 2) {
+    ASSERT_EQ(m3u8_intern_release(held[i]), M3U8_INTERN_STATUS_NO_ERROR);
+  }
+
+  for (int i = 1; i < 2000; i += 2) {
+    char        string[32];
+    const char* again = NULL;
+
+    snprintf(string, sizeof(string), "segment-%d.ts", i);
+    ASSERT_EQ(m3u8_intern(string, &again), M3U8_INTERN_STATUS_NO_ERROR);
+    EXPECT_EQ(again, held[i]);
+    ASSERT_EQ(m3u8_intern_release(again), M3U8_INTERN_STATUS_NO_ERROR);
+    ASSERT_EQ(m3u8_intern_release(held[i]), M3U8_INTERN_STATUS_NO_ERROR);
+  }
+}
+
+TEST_F(m3u8_intern_test, given_concurrent_threads_keeps_counts) {
+  pthread_t threads[8];
+  int       ids[8];
+
+  for (int i = 0; i < 8; i++) {
+    ids[i] = i;
+    ASSERT_EQ(pthread_create(&threads[i], NULL, mock_intern_worker, &ids[i]), 0);
+  }
+
+  for (int i = 0; i < 8; i++) {
+    pthread_join(threads[i], NULL);
+  }
+}
+
+// ----------- m3u8_intern_playlist -----------
+
+TEST_F(m3u8_intern_test, given_two_playlists_shares_their_strings) {
+  m3u8_t* first = NULL;
+  m3u8_t* second = NULL;
+
+  ASSERT_EQ(m3u8_create(&first), M3U8_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_create(&second), M3U8_STATUS_NO_ERROR);
+  append(first, 800000);
+  append(second, 800000);
+
+  ASSERT_EQ(m3u8_intern_playlist(first), M3U8_INTERN_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_intern_playlist(second), M3U8_INTERN_STATUS_NO_ERROR);
+  EXPECT_TRUE(first->is_interned);
+  EXPECT_EQ(first->variants[0].codecs, second->variants[0].codecs);
+  EXPECT_EQ(first->variants[0].uri, second->variants[0].uri);
+
+  // appended after the conversion, interned on the way in
+  append(second, 1600000);
+  EXPECT_EQ(second->variants[1].codecs, first->variants[0].codecs);
+
+  ext_x_media_type_t rendition = {};
+  rendition.type = AUDIO;
+  rendition.group_id = strdup("aac");
+  rendition.name = strdup("English");
+  ASSERT_EQ(m3u8_rendition_append(second, &rendition), M3U8_RENDITION_STATUS_NO_ERROR);
+  EXPECT_EQ(second->renditions[0].group_id, second->variants[0].audio);
+
+  EXPECT_EQ(m3u8_destroy(first), M3U8_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_destroy(second), M3U8_STATUS_NO_ERROR);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
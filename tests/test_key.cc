@@ -0,0 +1,262 @@
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <vector>
+
+extern "C" {
+#include "../src/key.h"
+}
+
+#define MOCK_KEY_URI "https://keys.example.com/k1.key"
+#define MOCK_KEY     "0123456789abcdef"
+
+// transport parking every submitted request until the test completes it
+static std::vector<m3u8_transport_request_t*> mock_submitted;
+
+static int mock_open(void*, const char*, m3u8_transport_stream_t*) {
+  return M3U8_TRANSPORT_STATUS_NOT_FOUND;
+}
+
+static int mock_read(void*, const char**, size_t*) {
+  return M3U8_TRANSPORT_STATUS_IO_ERROR;
+}
+
+static int mock_close(void*) {
+  return M3U8_TRANSPORT_STATUS_NO_ERROR;
+}
+
+static int mock_submit(void*, m3u8_transport_request_t* request) {
+  mock_submitted.push_back(request);
+  return M3U8_TRANSPORT_STATUS_NO_ERROR;
+}
+
+static const m3u8_transport_ops_t mock_ops = {
+    "deferred", mock_open, mock_read, NULL, mock_close, mock_submit, NULL,
+};
+
+static void mock_complete(m3u8_transport_request_t* request, const char* body, int status) {
+  if (body != NULL) {
+    request->write(body, strlen(body), request->userdata);
+  }
+
+  request->done(request, status, request->userdata);
+}
+
+class m3u8_key_test : public ::testing::Test {
+ protected:
+  m3u8_transport_t* transport = NULL;
+
+  void SetUp() override {
+    mock_submitted.clear();
+    ASSERT_EQ(m3u8_transport_create(&transport, &mock_ops, NULL), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  }
+
+  void TearDown() override {
+    m3u8_key_cache_configure(M3U8_KEY_CACHE_CAPACITY, M3U8_KEY_CACHE_TTL_MS);
+    m3u8_key_cache_clear();
+    m3u8_transport_destroy(transport);
+  }
+};
+
+// ----------- m3u8_key_parse_iv -----------
+
+TEST_F(m3u8_key_test, given_hex_iv_parses_sixteen_bytes) {
+  unsigned char iv[M3U8_AES_BLOCK_SIZE];
+  unsigned char expected[M3U8_AES_BLOCK_SIZE] = {0x9c, 0x7d, 0xb8, 0x77, 0x85, 0x70, 0xd0, 0x5c,
+                                                 0x31, 0x77, 0xc3, 0x49, 0xfd, 0x92, 0x36, 0xaa};
+
+  ASSERT_EQ(m3u8_key_parse_iv("0x9c7db8778570d05c3177c349fd9236aa", iv), M3U8_KEY_STATUS_NO_ERROR);
+  EXPECT_EQ(memcmp(iv, expected, sizeof(iv)), 0);
+  ASSERT_EQ(m3u8_key_parse_iv("0X9C7DB8778570D05C3177C349FD9236AA", iv), M3U8_KEY_STATUS_NO_ERROR);
+  EXPECT_EQ(memcmp(iv, expected, sizeof(iv)), 0);
+}
+
+TEST_F(m3u8_key_test, given_malformed_iv_returns_format_error) {
+  unsigned char iv[M3U8_AES_BLOCK_SIZE];
+
+  EXPECT_EQ(m3u8_key_parse_iv(NULL, iv), M3U8_KEY_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_key_parse_iv("9c7db8778570d05c3177c349fd9236aa", iv), M3U8_KEY_STATUS_FORMAT_ERROR);
+  EXPECT_EQ(m3u8_key_parse_iv("0x9c7db8778570d05c3177c349fd9236", iv), M3U8_KEY_STATUS_FORMAT_ERROR);
+  EXPECT_EQ(m3u8_key_parse_iv("0x9c7db8778570d05c3177c349fd9236zz", iv),
+            M3U8_KEY_STATUS_FORMAT_ERROR);
+}
+
+// ----------- m3u8_key_segment_iv -----------
+
+TEST_F(m3u8_key_test, given_no_explicit_iv_uses_media_sequence) {
+  ext_x_key     key = {};
+  unsigned char iv[M3U8_AES_BLOCK_SIZE];
+  unsigned char expected[M3U8_AES_BLOCK_SIZE] = {0, 0, 0, 0, 0, 0, 0, 0,
+                                                 0, 0, 0, 0, 0, 0, 0x11, 0xd0};
+
+  ASSERT_EQ(m3u8_key_segment_iv(&key, 4560, iv), M3U8_KEY_STATUS_NO_ERROR);
+  EXPECT_EQ(memcmp(iv, expected, sizeof(iv)), 0);
+
+  key.has_iv = true;
+  memset(key.iv, 0xab, sizeof(key.iv));
+
+  ASSERT_EQ(m3u8_key_segment_iv(&key, 4560, iv), M3U8_KEY_STATUS_NO_ERROR);
+  EXPECT_EQ(memcmp(iv, key.iv, sizeof(iv)), 0);
+}
+
+// ----------- m3u8_key_fetch -----------
+
+TEST_F(m3u8_key_test, given_concurrent_requests_downloads_once) {
+  unsigned char key[M3U8_AES_BLOCK_SIZE];
+
+  ASSERT_EQ(m3u8_key_prefetch(transport, MOCK_KEY_URI), M3U8_KEY_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_key_prefetch(transport, MOCK_KEY_URI), M3U8_KEY_STATUS_NO_ERROR);
+  ASSERT_EQ(mock_submitted.size(), 1u);
+
+  mock_complete(mock_submitted[0], MOCK_KEY, M3U8_TRANSPORT_STATUS_NO_ERROR);
+
+  ASSERT_EQ(m3u8_key_fetch(transport, MOCK_KEY_URI, 0, NULL, key), M3U8_KEY_STATUS_NO_ERROR);
+  EXPECT_EQ(memcmp(key, MOCK_KEY, sizeof(key)), 0);
+  EXPECT_EQ(mock_submitted.size(), 1u);
+}
+
+TEST_F(m3u8_key_test, given_waiting_thread_wakes_on_completion) {
+  pthread_t     waiter;
+  unsigned char key[M3U8_AES_BLOCK_SIZE];
+  int           status = -1;
+
+  struct args_t {
+    m3u8_transport_t* transport;
+    unsigned char*    key;
+    int*              status;
+  } args = {transport, key, &status};
+
+  ASSERT_EQ(m3u8_key_prefetch(transport, MOCK_KEY_URI), M3U8_KEY_STATUS_NO_ERROR);
+  ASSERT_EQ(pthread_create(&waiter, NULL,
+                           [](void* vargs) -> void* {
+                             args_t* a = (args_t*)vargs;
+                             *a->status = m3u8_key_fetch(a->transport, MOCK_KEY_URI, 0, NULL, a->key);
+                             return NULL;
+                           },
+                           &args),
+            0);
+
+  mock_complete(mock_submitted[0], MOCK_KEY, M3U8_TRANSPORT_STATUS_NO_ERROR);
+  pthread_join(waiter, NULL);
+
+  EXPECT_EQ(status, M3U8_KEY_STATUS_NO_ERROR);
+  EXPECT_EQ(memcmp(key, MOCK_KEY, sizeof(key)), 0);
+  EXPECT_EQ(mock_submitted.size(), 1u);
+}
+
+TEST_F(m3u8_key_test, given_a_stuck_download_times_out_each_waiter) {
+  unsigned char key[M3U8_AES_BLOCK_SIZE];
+
+  ASSERT_EQ(m3u8_key_prefetch(transport, MOCK_KEY_URI), M3U8_KEY_STATUS_NO_ERROR);
+
+  EXPECT_EQ(m3u8_key_fetch(transport, MOCK_KEY_URI, 20, NULL, key), M3U8_KEY_STATUS_TIMEOUT);
+  EXPECT_EQ(m3u8_key_fetch(transport, MOCK_KEY_URI, -1, NULL, key), M3U8_KEY_STATUS_INVALID_ARG);
+  EXPECT_EQ(mock_submitted.size(), 1u);
+
+  // NOTE: the download kept running for whoever asks next
+  mock_complete(mock_submitted[0], MOCK_KEY, M3U8_TRANSPORT_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_key_fetch(transport, MOCK_KEY_URI, 20, NULL, key), M3U8_KEY_STATUS_NO_ERROR);
+  EXPECT_EQ(memcmp(key, MOCK_KEY, sizeof(key)), 0);
+}
+
+TEST_F(m3u8_key_test, given_a_triggered_token_cancels_the_wait) {
+  unsigned char  key[M3U8_AES_BLOCK_SIZE];
+  m3u8_cancel_t* cancel = NULL;
+
+  ASSERT_EQ(m3u8_cancel_create(&cancel), M3U8_FETCH_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_key_prefetch(transport, MOCK_KEY_URI), M3U8_KEY_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_cancel_trigger(cancel), M3U8_FETCH_STATUS_NO_ERROR);
+
+  EXPECT_EQ(m3u8_key_fetch(transport, MOCK_KEY_URI, 0, cancel, key), M3U8_KEY_STATUS_CANCELLED);
+
+  mock_complete(mock_submitted[0], MOCK_KEY, M3U8_TRANSPORT_STATUS_NO_ERROR);
+  m3u8_cancel_destroy(cancel);
+}
+
+TEST_F(m3u8_key_test, given_failed_download_retries_on_next_fetch) {
+  ASSERT_EQ(m3u8_key_prefetch(transport, MOCK_KEY_URI), M3U8_KEY_STATUS_NO_ERROR);
+  mock_complete(mock_submitted[0], "short", M3U8_TRANSPORT_STATUS_NO_ERROR);
+
+  ASSERT_EQ(m3u8_key_prefetch(transport, MOCK_KEY_URI), M3U8_KEY_STATUS_NO_ERROR);
+  ASSERT_EQ(mock_submitted.size(), 2u);
+  mock_complete(mock_submitted[1], NULL, M3U8_TRANSPORT_STATUS_NOT_FOUND);
+
+  ASSERT_EQ(m3u8_key_prefetch(transport, MOCK_KEY_URI), M3U8_KEY_STATUS_NO_ERROR);
+  EXPECT_EQ(mock_submitted.size(), 3u);
+  mock_complete(mock_submitted[2], MOCK_KEY, M3U8_TRANSPORT_STATUS_NO_ERROR);
+}
+
+// ----------- m3u8_key_cache_configure -----------
+
+TEST_F(m3u8_key_test, given_a_full_cache_evicts_the_least_recently_used) {
+  const char*   uris[] = {"https://keys.example.com/k1.key", "https://keys.example.com/k2.key",
+                          "https://keys.example.com/k3.key"};
+  unsigned char key[M3U8_AES_BLOCK_SIZE];
+
+  ASSERT_EQ(m3u8_key_cache_configure(2, 0), M3U8_KEY_STATUS_NO_ERROR);
+
+  for (int i = 0; i < 2; i++) {
+    ASSERT_EQ(m3u8_key_prefetch(transport, uris[i]), M3U8_KEY_STATUS_NO_ERROR);
+    mock_complete(mock_submitted[i], MOCK_KEY, M3U8_TRANSPORT_STATUS_NO_ERROR);
+  }
+
+  // NOTE: k1 is used again, leaving k2 the least recently used
+  ASSERT_EQ(m3u8_key_fetch(transport, uris[0], 0, NULL, key), M3U8_KEY_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_key_prefetch(transport, uris[2]), M3U8_KEY_STATUS_NO_ERROR);
+  mock_complete(mock_submitted[2], MOCK_KEY, M3U8_TRANSPORT_STATUS_NO_ERROR);
+
+  ASSERT_EQ(m3u8_key_prefetch(transport, uris[0]), M3U8_KEY_STATUS_NO_ERROR);
+  EXPECT_EQ(mock_submitted.size(), 3u);
+
+  ASSERT_EQ(m3u8_key_prefetch(transport, uris[1]), M3U8_KEY_STATUS_NO_ERROR);
+  ASSERT_EQ(mock_submitted.size(), 4u);
+  mock_complete(mock_submitted[3], MOCK_KEY, M3U8_TRANSPORT_STATUS_NO_ERROR);
+
+  EXPECT_EQ(m3u8_key_cache_configure(0, 0), M3U8_KEY_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_key_cache_configure(2, -1), M3U8_KEY_STATUS_INVALID_ARG);
+}
+
+TEST_F(m3u8_key_test, given_no_idle_entry_to_evict_keeps_the_one_looked_up) {
+  const char*   loading = "https://keys.example.com/k2.key";
+  unsigned char key[M3U8_AES_BLOCK_SIZE];
+
+  ASSERT_EQ(m3u8_key_prefetch(transport, MOCK_KEY_URI), M3U8_KEY_STATUS_NO_ERROR);
+  mock_complete(mock_submitted[0], MOCK_KEY, M3U8_TRANSPORT_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_key_prefetch(transport, loading), M3U8_KEY_STATUS_NO_ERROR);
+
+  // NOTE: shrinking evicts k1, the only idle entry; downloaded again, it is
+  // ready with no waiters while k2 keeps the cache over capacity
+  ASSERT_EQ(m3u8_key_cache_configure(1, 0), M3U8_KEY_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_key_prefetch(transport, MOCK_KEY_URI), M3U8_KEY_STATUS_NO_ERROR);
+  ASSERT_EQ(mock_submitted.size(), 3u);
+  mock_complete(mock_submitted[2], MOCK_KEY, M3U8_TRANSPORT_STATUS_NO_ERROR);
+
+  ASSERT_EQ(m3u8_key_fetch(transport, MOCK_KEY_URI, 0, NULL, key), M3U8_KEY_STATUS_NO_ERROR);
+  EXPECT_EQ(memcmp(key, MOCK_KEY, sizeof(key)), 0);
+  mock_complete(mock_submitted[1], MOCK_KEY, M3U8_TRANSPORT_STATUS_NO_ERROR);
+}
+
+TEST_F(m3u8_key_test, given_a_ttl_downloads_expired_keys_again) {
+  unsigned char key[M3U8_AES_BLOCK_SIZE];
+
+  ASSERT_EQ(m3u8_key_cache_configure(M3U8_KEY_CACHE_CAPACITY, 1), M3U8_KEY_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_key_prefetch(transport, MOCK_KEY_URI), M3U8_KEY_STATUS_NO_ERROR);
+  mock_complete(mock_submitted[0], MOCK_KEY, M3U8_TRANSPORT_STATUS_NO_ERROR);
+
+  usleep(2000);
+
+  ASSERT_EQ(m3u8_key_prefetch(transport, MOCK_KEY_URI), M3U8_KEY_STATUS_NO_ERROR);
+  ASSERT_EQ(mock_submitted.size(), 2u);
+  mock_complete(mock_submitted[1], MOCK_KEY, M3U8_TRANSPORT_STATUS_NO_ERROR);
+
+  ASSERT_EQ(m3u8_key_cache_configure(M3U8_KEY_CACHE_CAPACITY, 0), M3U8_KEY_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_key_fetch(transport, MOCK_KEY_URI, 0, NULL, key), M3U8_KEY_STATUS_NO_ERROR);
+  EXPECT_EQ(mock_submitted.size(), 2u);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -1,4 +1,5 @@
 #include <gtest/gtest.h>
+#include <pthread.h>
 #include <stdbool.h>
 #include <stdlib.h>
 
@@ -436,6 +437,136 @@ TEST(m3u8_list_prev_test, given_a_list_goto_previous) {
   }
 }
 
+// ----------- m3u8_list_mpsc -----------
+
+typedef struct {
+  int                   producer;
+  int                   sequence;
+  m3u8_list_mpsc_node_t node;
+} test_event_t;
+
+typedef struct {
+  m3u8_list_mpsc_t* queue;
+  int               producer;
+  int               events;
+} test_producer_t;
+
+static void* test_list_mpsc_producer(void* context) {
+  test_producer_t* producer = (test_producer_t*)context;
+
+  for (int i = 0; i < producer->events; i++) {
+    test_event_t* event = (test_event_t*)calloc(1, sizeof(test_event_t));
+
+    event->producer = producer->producer;
+    event->sequence = i;
+    m3u8_list_mpsc_push(producer->queue, &event->node);
+  }
+
+  return NULL;
+}
+
+TEST(m3u8_list_mpsc_test, given_pushes_pops_in_order) {
+  m3u8_list_mpsc_t       queue;
+  m3u8_list_mpsc_node_t* node = NULL;
+  test_event_t           events[3];
+
+  EXPECT_EQ(m3u8_list_mpsc_init(nullptr), M3U8_LIST_STATUS_INVALID_ARGS);
+  ASSERT_EQ(m3u8_list_mpsc_init(&queue), M3U8_LIST_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_list_mpsc_pop(&queue, &node), M3U8_LIST_STATUS_NOT_FOUND);
+
+  for (int i = 0; i < 3; i++) {
+    events[i].sequence = i;
+    EXPECT_EQ(m3u8_list_mpsc_push(&queue, &events[i].node), M3U8_LIST_STATUS_NO_ERROR);
+  }
+
+  // NOTE: the queue empties through the stub and fills again
+  for (int round = 0; round < 2; round++) {
+    for (int i = 0; i < 3; i++) {
+      ASSERT_EQ(m3u8_list_mpsc_pop(&queue, &node), M3U8_LIST_STATUS_NO_ERROR);
+      EXPECT_EQ(m3u8_list_container_of(node, test_event_t, node)->sequence, i);
+    }
+
+    EXPECT_EQ(m3u8_list_mpsc_pop(&queue, &node), M3U8_LIST_STATUS_NOT_FOUND);
+
+    for (int i = 0; round == 0 && i < 3; i++) {
+      EXPECT_EQ(m3u8_list_mpsc_push(&queue, &events[i].node), M3U8_LIST_STATUS_NO_ERROR);
+    }
+  }
+
+  EXPECT_EQ(m3u8_list_mpsc_push(&queue, nullptr), M3U8_LIST_STATUS_INVALID_ARGS);
+  EXPECT_EQ(m3u8_list_mpsc_pop(&queue, nullptr), M3U8_LIST_STATUS_INVALID_ARGS);
+}
+
+TEST(m3u8_list_mpsc_test, given_a_drain_walks_the_chain_freeing_entries) {
+  m3u8_list_mpsc_t       queue;
+  m3u8_list_mpsc_node_t* first = NULL;
+  test_event_t*          event = NULL;
+  int                    count = 0;
+  int                    expected = 0;
+
+  ASSERT_EQ(m3u8_list_mpsc_init(&queue), M3U8_LIST_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_list_mpsc_drain(&queue, &first, &count), M3U8_LIST_STATUS_NOT_FOUND);
+  EXPECT_EQ(first, nullptr);
+  EXPECT_EQ(count, 0);
+
+  for (int i = 0; i < 10; i++) {
+    event = (test_event_t*)calloc(1, sizeof(test_event_t));
+    event->sequence = i;
+    m3u8_list_mpsc_push(&queue, &event->node);
+  }
+
+  EXPECT_EQ(m3u8_list_mpsc_drain(&queue, &first, &count), M3U8_LIST_STATUS_NO_ERROR);
+  EXPECT_EQ(count, 10);
+
+  m3u8_list_mpsc_foreach(event, first, test_event_t, node) {
+    EXPECT_EQ(event->sequence, expected++);
+    free(event);
+  }
+
+  EXPECT_EQ(expected, 10);
+  EXPECT_EQ(m3u8_list_mpsc_drain(&queue, &first, NULL), M3U8_LIST_STATUS_NOT_FOUND);
+}
+
+TEST(m3u8_list_mpsc_test, given_concurrent_producers_keeps_each_order) {
+  m3u8_list_mpsc_t       queue;
+  m3u8_list_mpsc_node_t* first = NULL;
+  test_event_t*          event = NULL;
+  test_producer_t        producers[4];
+  pthread_t              threads[4];
+  int                    next[4] = {0};
+  int                    received = 0;
+  int                    count = 0;
+
+  ASSERT_EQ(m3u8_list_mpsc_init(&queue), M3U8_LIST_STATUS_NO_ERROR);
+
+  for (int i = 0; i < 4; i++) {
+    producers[i].queue = &queue;
+    producers[i].producer = i;
+    producers[i].events = 50000;
+    ASSERT_EQ(pthread_create(&threads[i], NULL, test_list_mpsc_producer, &producers[i]), 0);
+  }
+
+  while (received < 4 * 50000) {
+    if (m3u8_list_mpsc_drain(&queue, &first, &count) != M3U8_LIST_STATUS_NO_ERROR) {
+      continue;
+    }
+
+    m3u8_list_mpsc_foreach(event, first, test_event_t, node) {
+      EXPECT_EQ(event->sequence, next[event->producer]++);
+      free(event);
+    }
+
+    received += count;
+  }
+
+  for (int i = 0; i < 4; i++) {
+    pthread_join(threads[i], NULL);
+    EXPECT_EQ(next[i], 50000);
+  }
+
+  EXPECT_EQ(m3u8_list_mpsc_drain(&queue, &first, &count), M3U8_LIST_STATUS_NOT_FOUND);
+}
+
 // ----------- main -----------
 int main(int argc, char** argv) {
   testing::InitGoogleTest(&argc, argv);
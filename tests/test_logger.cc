@@ -0,0 +1,251 @@
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <string.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include <fstream>
+
+#include <string>
+#include <vector>
+
+// NOTE: VERBOSE is compiled out of this file only, the library keeps it
+#define M3U8_LOG_LEVEL 1
+
+extern "C" {
+#include "../src/logger.h"
+}
+
+/** @brief INFO for C++, which will not pass string literals as char* */
+#define TEST_LOG(message, ...) \
+  logger((char*)message, (char*)"tests/test_logger.cc", __LINE__, INFO, ##__VA_ARGS__)
+
+static pthread_mutex_t          test_mutex = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t           test_gate_cond = PTHREAD_COND_INITIALIZER;
+static bool                     test_gate_closed = false;
+static bool                     test_gate_reached = false;
+static std::vector<std::string> test_messages;
+
+/** @brief records events, held at the gate while it is closed */
+static void test_logger_handler(LogEvent event) {
+  pthread_mutex_lock(&test_mutex);
+  test_messages.push_back(event.msg);
+  test_gate_reached = true;
+  pthread_cond_broadcast(&test_gate_cond);
+
+  while (test_gate_closed) {
+    pthread_cond_wait(&test_gate_cond, &test_mutex);
+  }
+
+  pthread_mutex_unlock(&test_mutex);
+}
+
+static void test_logger_gate(bool closed) {
+  pthread_mutex_lock(&test_mutex);
+  test_gate_closed = closed;
+  test_gate_reached = false;
+  pthread_cond_broadcast(&test_gate_cond);
+  pthread_mutex_unlock(&test_mutex);
+}
+
+/** @brief waits until the worker is held by the gate */
+static void test_logger_wait_gate(void) {
+  pthread_mutex_lock(&test_mutex);
+
+  while (!test_gate_reached) {
+    pthread_cond_wait(&test_gate_cond, &test_mutex);
+  }
+
+  pthread_mutex_unlock(&test_mutex);
+}
+
+static void* test_logger_producer(void* context) {
+  for (int i = 0; i < 1000; i++) {
+    TEST_LOG("producer %d event %d", *(int*)context, i);
+  }
+
+  return NULL;
+}
+
+class LoggerTest : public ::testing::Test {
+ protected:
+  void SetUp() override {
+    logger_remove_log_handler((char*)"logger_write_stdout_handler");
+    logger_add_log_handler((char*)"test_logger_handler", test_logger_handler);
+    test_messages.clear();
+  }
+
+  void TearDown() override {
+    logger_flush();
+    logger_remove_log_handler((char*)"test_logger_handler");
+    logger_set_overflow(LOGGER_OVERFLOW_DROP_NEW);
+    logger_set_level(VERBOSE);
+  }
+};
+
+// ----------- logger -----------
+
+TEST_F(LoggerTest, given_events_hands_them_to_handlers_in_order) {
+  for (int i = 0; i < 100; i++) {
+    TEST_LOG("event %d", i);
+  }
+
+  logger_flush();
+
+  ASSERT_EQ(test_messages.size(), 100u);
+
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(test_messages[i], "event " + std::to_string(i));
+  }
+}
+
+TEST_F(LoggerTest, given_concurrent_producers_delivers_everything_under_block) {
+  pthread_t threads[4];
+  int       ids[4] = {0, 1, 2, 3};
+
+  ASSERT_EQ(logger_set_overflow(LOGGER_OVERFLOW_BLOCK), LOGGER_NO_ERROR);
+
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(pthread_create(&threads[i], NULL, test_logger_producer, &ids[i]), 0);
+  }
+
+  for (int i = 0; i < 4; i++) {
+    pthread_join(threads[i], NULL);
+  }
+
+  logger_flush();
+  EXPECT_EQ(test_messages.size(), 4000u);
+}
+
+// ----------- logger_set_level -----------
+
+TEST_F(LoggerTest, given_a_level_skips_lower_severities) {
+  int evaluated = 0;
+
+  ASSERT_EQ(logger_set_level(WARN), LOGGER_NO_ERROR);
+  EXPECT_FALSE(LOGGER_IS_ENABLED(INFO));
+  EXPECT_TRUE(LOGGER_IS_ENABLED(WARN));
+
+  if (LOGGER_IS_ENABLED(DEBUG)) {
+    evaluated++;
+  }
+
+  TEST_LOG("hidden");
+  logger((char*)"shown", (char*)"tests/test_logger.cc", __LINE__, ERROR);
+  logger_flush();
+
+  EXPECT_EQ(evaluated, 0);
+  ASSERT_EQ(test_messages.size(), 1u);
+  EXPECT_EQ(test_messages[0], "shown");
+
+  EXPECT_EQ(logger_set_level((LogSeverity)42), LOGGER_INVALID_ARG);
+}
+
+TEST_F(LoggerTest, given_a_compile_time_level_folds_lower_severities) {
+  ASSERT_EQ(logger_set_level(VERBOSE), LOGGER_NO_ERROR);
+  EXPECT_FALSE(LOGGER_IS_ENABLED(VERBOSE));
+  EXPECT_TRUE(LOGGER_IS_ENABLED(INFO));
+}
+
+// ----------- logger_set_overflow -----------
+
+TEST_F(LoggerTest, given_drop_new_keeps_the_oldest_events) {
+  unsigned long dropped = logger_dropped();
+
+  test_logger_gate(true);
+  TEST_LOG("held");
+  test_logger_wait_gate();
+
+  for (int i = 0; i < LOGGER_RING_SIZE + 10; i++) {
+    TEST_LOG("event %d", i);
+  }
+
+  EXPECT_EQ(logger_dropped() - dropped, 10u);
+  test_logger_gate(false);
+  logger_flush();
+
+  ASSERT_EQ(test_messages.size(), (size_t)LOGGER_RING_SIZE + 1);
+  EXPECT_EQ(test_messages[1], "event 0");
+  EXPECT_EQ(test_messages.back(), "event " + std::to_string(LOGGER_RING_SIZE - 1));
+}
+
+TEST_F(LoggerTest, given_drop_oldest_keeps_the_newest_events) {
+  unsigned long dropped = logger_dropped();
+
+  ASSERT_EQ(logger_set_overflow(LOGGER_OVERFLOW_DROP_OLDEST), LOGGER_NO_ERROR);
+  test_logger_gate(true);
+  TEST_LOG("held");
+  test_logger_wait_gate();
+
+  for (int i = 0; i < LOGGER_RING_SIZE + 10; i++) {
+    TEST_LOG("event %d", i);
+  }
+
+  EXPECT_EQ(logger_dropped() - dropped, 10u);
+  test_logger_gate(false);
+  logger_flush();
+
+  ASSERT_EQ(test_messages.size(), (size_t)LOGGER_RING_SIZE + 1);
+  EXPECT_EQ(test_messages[1], "event 10");
+  EXPECT_EQ(test_messages.back(), "event " + std::to_string(LOGGER_RING_SIZE + 9));
+}
+
+TEST_F(LoggerTest, given_unknown_policy_returns_invalid_arg) {
+  EXPECT_EQ(logger_set_overflow((LogOverflow)42), LOGGER_INVALID_ARG);
+}
+
+// ----------- logger_write_file_handler -----------
+
+TEST_F(LoggerTest, given_a_size_limit_rotates_into_bounded_files) {
+  std::string  path = "/tmp/m3u8_test_logger_" + std::to_string(getpid()) + ".log";
+  LogAttribute attr = {};
+  struct stat  st;
+  std::string  line;
+  std::string  last;
+
+  attr.path = (char*)path.c_str();
+  attr.max_file_size = 4096;
+  attr.max_files = 2;
+  ASSERT_EQ(logger_set_log_attribute(attr), LOGGER_NO_ERROR);
+  ASSERT_EQ(logger_set_overflow(LOGGER_OVERFLOW_BLOCK), LOGGER_NO_ERROR);
+
+  for (int i = 0; i < 1000; i++) {
+    TEST_LOG("segment %d of the rotation test", i);
+  }
+
+  logger_flush();
+
+  for (int i = 0; i <= 3; i++) {
+    std::string name = i == 0 ? path : path + "." + std::to_string(i);
+
+    if (i == 3) {
+      EXPECT_NE(stat(name.c_str(), &st), 0);
+      continue;
+    }
+
+    ASSERT_EQ(stat(name.c_str(), &st), 0);
+    EXPECT_LT(st.st_size, 4096 + 128);
+  }
+
+  // NOTE: the last line may have been the one filling path up
+  for (const std::string& name : {path + ".1", path}) {
+    std::ifstream file(name);
+
+    while (std::getline(file, line)) {
+      last = line;
+    }
+  }
+
+  EXPECT_NE(last.find("segment 999 of the rotation test"), std::string::npos);
+
+  for (int i = 0; i <= 2; i++) {
+    unlink((i == 0 ? path : path + "." + std::to_string(i)).c_str());
+  }
+}
+
+// ----------- main -----------
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,102 @@
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <string>
+
+extern "C" {
+#include "../src/m3u8.h"
+}
+
+#define MOCK_BASE_URI "http://a/b/c/d;p?q"
+
+static std::string resolve(const char* base, const char* reference) {
+  char output[256];
+
+  if (m3u8_resolve_uri(base, reference, output, sizeof(output)) != M3U8_STATUS_NO_ERROR) {
+    return "<error>";
+  }
+
+  return output;
+}
+
+// ----------- m3u8_create -----------
+
+// NOTE: allocating sizeof(m3u8_t*) instead of sizeof(m3u8_t) is reported by
+// the sanitizer build as a heap overflow of the memset below the malloc
+TEST(m3u8_create_test, given_new_playlist_zeroes_every_field) {
+  m3u8_t* m3u8_ptr = NULL;
+
+  ASSERT_EQ(m3u8_create(&m3u8_ptr), M3U8_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_ptr->x_stream_inf, nullptr);
+  EXPECT_EQ(m3u8_ptr->content_steering, nullptr);
+  EXPECT_FALSE(m3u8_ptr->is_interned);
+  EXPECT_EQ(m3u8_destroy(m3u8_ptr), M3U8_STATUS_NO_ERROR);
+}
+
+// ----------- m3u8_resolve_uri -----------
+
+// NOTE: expectations come from the examples of RFC 3986 section 5.4
+TEST(m3u8_resolve_uri_test, given_relative_path_replaces_the_last_segment) {
+  EXPECT_EQ(resolve(MOCK_BASE_URI, "g"), "http://a/b/c/g");
+  EXPECT_EQ(resolve(MOCK_BASE_URI, "./g"), "http://a/b/c/g");
+  EXPECT_EQ(resolve(MOCK_BASE_URI, "g/"), "http://a/b/c/g/");
+  EXPECT_EQ(resolve(MOCK_BASE_URI, "."), "http://a/b/c/");
+  EXPECT_EQ(resolve(MOCK_BASE_URI, ".."), "http://a/b/");
+  EXPECT_EQ(resolve(MOCK_BASE_URI, "../g"), "http://a/b/g");
+  EXPECT_EQ(resolve(MOCK_BASE_URI, "../../g"), "http://a/g");
+  EXPECT_EQ(resolve(MOCK_BASE_URI, "../../../g"), "http://a/g");
+  EXPECT_EQ(resolve(MOCK_BASE_URI, "g;x=1/../y"), "http://a/b/c/y");
+  EXPECT_EQ(resolve("https://cdn.example.com/live/master.m3u8", "hi/index.m3u8"),
+            "https://cdn.example.com/live/hi/index.m3u8");
+}
+
+TEST(m3u8_resolve_uri_test, given_authority_only_base_resolves_from_the_root) {
+  EXPECT_EQ(resolve("https://host", "a.m3u8"), "https://host/a.m3u8");
+  EXPECT_EQ(resolve("https://host?token=1", "a.m3u8"), "https://host/a.m3u8");
+}
+
+TEST(m3u8_resolve_uri_test, given_absolute_uri_copies_it) {
+  EXPECT_EQ(resolve(MOCK_BASE_URI, "g:h"), "g:h");
+  EXPECT_EQ(resolve(MOCK_BASE_URI, "https://b/x/../y.m3u8"), "https://b/y.m3u8");
+  EXPECT_EQ(resolve(MOCK_BASE_URI, "skd://key-id"), "skd://key-id");
+}
+
+TEST(m3u8_resolve_uri_test, given_absolute_path_keeps_scheme_and_authority) {
+  EXPECT_EQ(resolve(MOCK_BASE_URI, "/g"), "http://a/g");
+  EXPECT_EQ(resolve(MOCK_BASE_URI, "/./g"), "http://a/g");
+  EXPECT_EQ(resolve(MOCK_BASE_URI, "/../g"), "http://a/g");
+  EXPECT_EQ(resolve("file:///tmp/vod/index.m3u8", "/media/seg.ts"), "file:///media/seg.ts");
+}
+
+TEST(m3u8_resolve_uri_test, given_network_path_keeps_the_scheme) {
+  EXPECT_EQ(resolve(MOCK_BASE_URI, "//g"), "http://g");
+  EXPECT_EQ(resolve("https://a/x", "//b/y"), "https://b/y");
+  EXPECT_EQ(resolve("https://a/x", "//b/./y/../z?k=v"), "https://b/z?k=v");
+}
+
+TEST(m3u8_resolve_uri_test, given_query_or_fragment_keeps_what_the_reference_omits) {
+  EXPECT_EQ(resolve(MOCK_BASE_URI, ""), MOCK_BASE_URI);
+  EXPECT_EQ(resolve(MOCK_BASE_URI, "?y"), "http://a/b/c/d;p?y");
+  EXPECT_EQ(resolve(MOCK_BASE_URI, "g?y"), "http://a/b/c/g?y");
+  EXPECT_EQ(resolve(MOCK_BASE_URI, "#s"), "http://a/b/c/d;p?q#s");
+  EXPECT_EQ(resolve(MOCK_BASE_URI, "g?y#s"), "http://a/b/c/g?y#s");
+  EXPECT_EQ(resolve("https://a/live/index.m3u8?token=1", "seg.ts"), "https://a/live/seg.ts");
+}
+
+TEST(m3u8_resolve_uri_test, given_small_output_returns_invalid_arg) {
+  char output[16];
+
+  EXPECT_EQ(m3u8_resolve_uri(MOCK_BASE_URI, "g", output, strlen("http://a/b/c/g")),
+            M3U8_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_resolve_uri(MOCK_BASE_URI, "g", output, strlen("http://a/b/c/g") + 1),
+            M3U8_STATUS_NO_ERROR);
+  EXPECT_STREQ(output, "http://a/b/c/g");
+  EXPECT_EQ(m3u8_resolve_uri(NULL, "g", output, sizeof(output)), M3U8_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_resolve_uri(MOCK_BASE_URI, NULL, output, sizeof(output)),
+            M3U8_STATUS_INVALID_ARG);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,163 @@
+#include <gtest/gtest.h>
+#include <string.h>
+
+extern "C" {
+#include "../src/intern.h"
+#include "../src/memory_usage.h"
+#include "../src/rendition.h"
+#include "../src/snapshot.h"
+#include "../src/timeline.h"
+#include "../src/variant.h"
+}
+
+#define CODECS "avc1.4d401f,mp4a.40.2"
+#define URI    "https://cdn.example.com/live/v.m3u8"
+
+class m3u8_memory_usage_test : public ::testing::Test {
+ protected:
+  m3u8_t* m3u8_ptr = NULL;
+
+  void SetUp() override {
+    ASSERT_EQ(m3u8_create(&m3u8_ptr), M3U8_STATUS_NO_ERROR);
+  }
+
+  void TearDown() override {
+    EXPECT_EQ(m3u8_destroy(m3u8_ptr), M3U8_STATUS_NO_ERROR);
+  }
+
+  void append(int bandwidth) {
+    ext_x_stream_inf_t variant = {};
+
+    variant.bandwidth = bandwidth;
+    variant.codecs = strdup(CODECS);
+    variant.uri = strdup(URI);
+    ASSERT_EQ(m3u8_variant_append(m3u8_ptr, &variant), M3U8_VARIANT_STATUS_NO_ERROR);
+  }
+};
+
+static void expect_total(const m3u8_memory_usage_t& usage) {
+  EXPECT_EQ(usage.total,
+            usage.strings + usage.attributes + usage.variants + usage.renditions + usage.segments +
+                usage.overhead);
+}
+
+// ----------- m3u8_memory_usage -----------
+
+TEST_F(m3u8_memory_usage_test, given_variants_counts_arrays_by_capacity) {
+  m3u8_memory_usage_t empty;
+  m3u8_memory_usage_t usage;
+
+  ASSERT_EQ(m3u8_memory_usage(m3u8_ptr, &empty), M3U8_MEMORY_STATUS_NO_ERROR);
+  EXPECT_EQ(empty.strings, 0u);
+  EXPECT_EQ(empty.variants, 0u);
+  EXPECT_GE(empty.overhead, sizeof(m3u8_t));
+  expect_total(empty);
+
+  append(800000);
+  append(1600000);
+  ASSERT_EQ(m3u8_variant_index(m3u8_ptr), M3U8_VARIANT_STATUS_NO_ERROR);
+
+  ASSERT_EQ(m3u8_memory_usage(m3u8_ptr, &usage), M3U8_MEMORY_STATUS_NO_ERROR);
+  EXPECT_EQ(usage.strings, 2 * (sizeof(CODECS) + sizeof(URI)));
+  EXPECT_EQ(usage.variants, 8 * sizeof(ext_x_stream_inf_t));
+  EXPECT_GT(usage.overhead, empty.overhead + 2 * sizeof(m3u8_variant_rank_t));
+  EXPECT_EQ(usage.interned, 0u);
+  expect_total(usage);
+
+  EXPECT_EQ(m3u8_memory_usage(NULL, &usage), M3U8_MEMORY_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_memory_usage(m3u8_ptr, NULL), M3U8_MEMORY_STATUS_INVALID_ARG);
+}
+
+TEST_F(m3u8_memory_usage_test, given_renditions_charges_them_apart_from_variants) {
+  m3u8_memory_usage_t usage;
+  ext_x_media_type_t  rendition = {};
+
+  append(800000);
+  rendition.type = AUDIO;
+  rendition.group_id = strdup("aac");
+  ASSERT_EQ(m3u8_rendition_append(m3u8_ptr, &rendition), M3U8_RENDITION_STATUS_NO_ERROR);
+
+  ASSERT_EQ(m3u8_memory_usage(m3u8_ptr, &usage), M3U8_MEMORY_STATUS_NO_ERROR);
+  EXPECT_EQ(usage.variants, m3u8_ptr->variants_capacity * sizeof(ext_x_stream_inf_t));
+  EXPECT_EQ(usage.renditions, m3u8_ptr->renditions_capacity * sizeof(ext_x_media_type_t));
+  expect_total(usage);
+}
+
+TEST_F(m3u8_memory_usage_test, given_interned_playlist_reports_shared_strings_apart) {
+  m3u8_memory_usage_t usage;
+
+  append(800000);
+  ASSERT_EQ(m3u8_intern_playlist(m3u8_ptr), M3U8_INTERN_STATUS_NO_ERROR);
+
+  ASSERT_EQ(m3u8_memory_usage(m3u8_ptr, &usage), M3U8_MEMORY_STATUS_NO_ERROR);
+  EXPECT_EQ(usage.strings, 0u);
+  EXPECT_EQ(usage.interned, sizeof(CODECS) + sizeof(URI));
+  expect_total(usage);
+}
+
+// ----------- m3u8_memory_media_usage -----------
+
+TEST(m3u8_memory_media_usage_test, given_segments_counts_a_shared_key_once) {
+  m3u8_media_t        media;
+  m3u8_memory_usage_t usage;
+  ext_x_key           key = {};
+
+  memset(&media, 0, sizeof(m3u8_media_t));
+  key.method = (char*)"AES-128";
+  key.uri = (char*)"k.bin";
+
+  for (int i = 0; i < 3; i++) {
+    m3u8_media_segment_t segment = {};
+
+    segment.duration = 6.0;
+    segment.uri = strdup("s0.ts");
+    segment.key = &key;
+    ASSERT_EQ(m3u8_timeline_append(&media, &segment), M3U8_TIMELINE_STATUS_NO_ERROR);
+  }
+
+  ASSERT_EQ(m3u8_memory_media_usage(&media, &usage), M3U8_MEMORY_STATUS_NO_ERROR);
+  EXPECT_EQ(usage.strings, 3 * sizeof("s0.ts") + sizeof("AES-128") + sizeof("k.bin"));
+  EXPECT_EQ(usage.attributes, sizeof(ext_x_key));
+  EXPECT_GE(usage.segments, media.segments_capacity * (sizeof(m3u8_media_segment_t) + sizeof(double)));
+  expect_total(usage);
+
+  EXPECT_EQ(m3u8_timeline_clear(&media), M3U8_TIMELINE_STATUS_NO_ERROR);
+}
+
+// ----------- m3u8_memory_counters -----------
+
+TEST(m3u8_memory_counters_test, given_objects_counts_them_while_alive) {
+  m3u8_memory_counters_t before;
+  m3u8_memory_counters_t during;
+  m3u8_memory_counters_t after;
+  m3u8_t*                m3u8_ptr = NULL;
+  m3u8_snapshot_t*       snapshot = NULL;
+  const char*            interned = NULL;
+
+  ASSERT_EQ(m3u8_memory_counters(&before), M3U8_MEMORY_STATUS_NO_ERROR);
+
+  ASSERT_EQ(m3u8_create(&m3u8_ptr), M3U8_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_snapshot_create(&snapshot, m3u8_ptr, m3u8_snapshot_destroy_m3u8),
+            M3U8_SNAPSHOT_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_intern("memory-usage-test", &interned), M3U8_INTERN_STATUS_NO_ERROR);
+
+  ASSERT_EQ(m3u8_memory_counters(&during), M3U8_MEMORY_STATUS_NO_ERROR);
+  EXPECT_EQ(during.live[M3U8_MEMORY_PLAYLIST], before.live[M3U8_MEMORY_PLAYLIST] + 1);
+  EXPECT_EQ(during.live[M3U8_MEMORY_SNAPSHOT], before.live[M3U8_MEMORY_SNAPSHOT] + 1);
+  EXPECT_EQ(during.interned_strings, before.interned_strings + 1);
+  EXPECT_EQ(during.interned_bytes, before.interned_bytes + sizeof("memory-usage-test"));
+
+  EXPECT_EQ(m3u8_intern_release(interned), M3U8_INTERN_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_snapshot_release(snapshot), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+
+  ASSERT_EQ(m3u8_memory_counters(&after), M3U8_MEMORY_STATUS_NO_ERROR);
+  for (int i = 0; i < M3U8_MEMORY_OBJECTS; i++) {
+    EXPECT_EQ(after.live[i], before.live[i]);
+  }
+  EXPECT_EQ(after.interned_bytes, before.interned_bytes);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
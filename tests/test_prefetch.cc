@@ -0,0 +1,272 @@
+#include <gtest/gtest.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include <string>
+
+extern "C" {
+#include "../src/key.h"
+#include "../src/prefetch.h"
+}
+
+#define MOCK_SEGMENTS_COUNT 8
+
+class m3u8_prefetch_test : public ::testing::Test {
+ protected:
+  char                 directory[64];
+  char                 base_uri[128];
+  m3u8_media_t         media;
+  m3u8_media_segment_t segments[MOCK_SEGMENTS_COUNT];
+
+  void SetUp() override {
+    snprintf(directory, sizeof(directory), "/tmp/m3u8_prefetch_XXXXXX");
+    ASSERT_NE(mkdtemp(directory), nullptr);
+    snprintf(base_uri, sizeof(base_uri), "file://%s/index.m3u8", directory);
+
+    memset(&media, 0, sizeof(m3u8_media_t));
+    memset(segments, 0, sizeof(segments));
+
+    for (int i = 0; i < MOCK_SEGMENTS_COUNT; i++) {
+      std::string name = "segment" + std::to_string(4560 + i) + ".m4s";
+      std::string path = std::string(directory) + "/" + name;
+      FILE*       file = fopen(path.c_str(), "w");
+
+      ASSERT_NE(file, nullptr);
+      fprintf(file, "payload-%d", i);
+      fclose(file);
+
+      segments[i].duration = 5.994;
+      segments[i].uri = strdup(name.c_str());
+    }
+
+    media.segments = segments;
+    media.segments_count = MOCK_SEGMENTS_COUNT;
+  }
+
+  void TearDown() override {
+    for (int i = 0; i < MOCK_SEGMENTS_COUNT; i++) {
+      std::string path = std::string(directory) + "/" + segments[i].uri;
+      unlink(path.c_str());
+      free(segments[i].uri);
+    }
+
+    rmdir(directory);
+  }
+};
+
+// ----------- m3u8_prefetch_create -----------
+
+TEST_F(m3u8_prefetch_test, given_invalid_args_returns_error) {
+  m3u8_prefetch_t*       prefetch = NULL;
+  m3u8_prefetch_t*       not_null = (m3u8_prefetch_t*)0x1;
+  m3u8_prefetch_config_t config = {.depth = M3U8_PREFETCH_MAX_DEPTH + 1, .buffer_size = 0};
+
+  EXPECT_EQ(m3u8_prefetch_create(NULL, &media, base_uri, NULL),
+            M3U8_PREFETCH_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_prefetch_create(&not_null, &media, base_uri, NULL),
+            M3U8_PREFETCH_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_prefetch_create(&prefetch, NULL, base_uri, NULL),
+            M3U8_PREFETCH_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_prefetch_create(&prefetch, &media, NULL, NULL),
+            M3U8_PREFETCH_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_prefetch_create(&prefetch, &media, base_uri, &config),
+            M3U8_PREFETCH_STATUS_INVALID_ARG);
+  EXPECT_EQ(prefetch, nullptr);
+}
+
+// ----------- m3u8_prefetch_acquire -----------
+
+TEST_F(m3u8_prefetch_test, given_started_prefetch_delivers_segments_in_order) {
+  m3u8_prefetch_t*        prefetch = NULL;
+  m3u8_prefetch_buffer_t* buffer = NULL;
+  m3u8_prefetch_config_t  config = {.depth = 3, .buffer_size = 16};
+
+  ASSERT_EQ(m3u8_prefetch_create(&prefetch, &media, base_uri, &config),
+            M3U8_PREFETCH_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_prefetch_start(prefetch, 0), M3U8_PREFETCH_STATUS_NO_ERROR);
+
+  for (int i = 0; i < MOCK_SEGMENTS_COUNT; i++) {
+    std::string expected = "payload-" + std::to_string(i);
+
+    ASSERT_EQ(m3u8_prefetch_acquire(prefetch, &buffer),
+              M3U8_PREFETCH_STATUS_NO_ERROR);
+    EXPECT_EQ(buffer->index, i);
+    EXPECT_EQ(std::string(buffer->data, buffer->size), expected);
+    EXPECT_EQ(m3u8_prefetch_release(prefetch, buffer),
+              M3U8_PREFETCH_STATUS_NO_ERROR);
+  }
+
+  EXPECT_EQ(m3u8_prefetch_acquire(prefetch, &buffer), M3U8_PREFETCH_STATUS_END);
+  EXPECT_EQ(m3u8_prefetch_destroy(prefetch), M3U8_PREFETCH_STATUS_NO_ERROR);
+}
+
+TEST_F(m3u8_prefetch_test, given_depth_recycles_the_same_buffers) {
+  m3u8_prefetch_t*        prefetch = NULL;
+  m3u8_prefetch_buffer_t* buffer = NULL;
+  m3u8_prefetch_buffer_t* seen[MOCK_SEGMENTS_COUNT];
+  m3u8_prefetch_config_t  config = {.depth = 2, .buffer_size = 0};
+
+  ASSERT_EQ(m3u8_prefetch_create(&prefetch, &media, base_uri, &config),
+            M3U8_PREFETCH_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_prefetch_start(prefetch, 2), M3U8_PREFETCH_STATUS_NO_ERROR);
+
+  for (int i = 2; i < MOCK_SEGMENTS_COUNT; i++) {
+    ASSERT_EQ(m3u8_prefetch_acquire(prefetch, &buffer),
+              M3U8_PREFETCH_STATUS_NO_ERROR);
+    EXPECT_EQ(buffer->index, i);
+    seen[i] = buffer;
+    EXPECT_EQ(m3u8_prefetch_release(prefetch, buffer),
+              M3U8_PREFETCH_STATUS_NO_ERROR);
+  }
+
+  for (int i = 4; i < MOCK_SEGMENTS_COUNT; i++) {
+    EXPECT_EQ(seen[i], seen[i - 2]);
+  }
+
+  EXPECT_EQ(m3u8_prefetch_destroy(prefetch), M3U8_PREFETCH_STATUS_NO_ERROR);
+}
+
+TEST_F(m3u8_prefetch_test, given_missing_segment_returns_fetch_error) {
+  m3u8_prefetch_t*        prefetch = NULL;
+  m3u8_prefetch_buffer_t* buffer = NULL;
+  char*                   original = segments[1].uri;
+
+  segments[1].uri = strdup("missing.m4s");
+
+  ASSERT_EQ(m3u8_prefetch_create(&prefetch, &media, base_uri, NULL),
+            M3U8_PREFETCH_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_prefetch_start(prefetch, 0), M3U8_PREFETCH_STATUS_NO_ERROR);
+
+  EXPECT_EQ(m3u8_prefetch_acquire(prefetch, &buffer),
+            M3U8_PREFETCH_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_prefetch_release(prefetch, buffer),
+            M3U8_PREFETCH_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_prefetch_acquire(prefetch, &buffer),
+            M3U8_PREFETCH_STATUS_FETCH_ERROR);
+  EXPECT_EQ(buffer->index, 1);
+  EXPECT_EQ(m3u8_prefetch_release(prefetch, buffer),
+            M3U8_PREFETCH_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_prefetch_destroy(prefetch), M3U8_PREFETCH_STATUS_NO_ERROR);
+
+  free(segments[1].uri);
+  segments[1].uri = original;
+}
+
+TEST_F(m3u8_prefetch_test, given_double_acquire_returns_invalid_arg) {
+  m3u8_prefetch_t*        prefetch = NULL;
+  m3u8_prefetch_buffer_t* buffer = NULL;
+  m3u8_prefetch_buffer_t* other = NULL;
+
+  ASSERT_EQ(m3u8_prefetch_create(&prefetch, &media, base_uri, NULL),
+            M3U8_PREFETCH_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_prefetch_acquire(prefetch, &buffer),
+            M3U8_PREFETCH_STATUS_INVALID_ARG);
+  ASSERT_EQ(m3u8_prefetch_start(prefetch, 0), M3U8_PREFETCH_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_prefetch_acquire(prefetch, &buffer),
+            M3U8_PREFETCH_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_prefetch_acquire(prefetch, &other),
+            M3U8_PREFETCH_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_prefetch_release(prefetch, buffer),
+            M3U8_PREFETCH_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_prefetch_destroy(prefetch), M3U8_PREFETCH_STATUS_NO_ERROR);
+}
+
+TEST_F(m3u8_prefetch_test, given_transport_fetches_segments_through_it) {
+  m3u8_prefetch_t*        prefetch = NULL;
+  m3u8_prefetch_buffer_t* buffer = NULL;
+  m3u8_transport_t*       transport = NULL;
+  m3u8_prefetch_config_t  config = {.depth = 2, .buffer_size = 0, .transport = NULL};
+  std::string             bodies[MOCK_SEGMENTS_COUNT];
+
+  ASSERT_EQ(m3u8_transport_memory_create(&transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+
+  for (int i = 0; i < MOCK_SEGMENTS_COUNT; i++) {
+    std::string uri = "mem://live/" + std::string(segments[i].uri);
+
+    bodies[i] = "memory-" + std::to_string(i);
+    ASSERT_EQ(m3u8_transport_memory_put(transport, uri.c_str(), bodies[i].c_str(),
+                                        bodies[i].size(), true),
+              M3U8_TRANSPORT_STATUS_NO_ERROR);
+  }
+
+  config.transport = transport;
+
+  ASSERT_EQ(m3u8_prefetch_create(&prefetch, &media, "mem://live/index.m3u8", &config),
+            M3U8_PREFETCH_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_prefetch_start(prefetch, 0), M3U8_PREFETCH_STATUS_NO_ERROR);
+
+  for (int i = 0; i < MOCK_SEGMENTS_COUNT; i++) {
+    ASSERT_EQ(m3u8_prefetch_acquire(prefetch, &buffer),
+              M3U8_PREFETCH_STATUS_NO_ERROR);
+    EXPECT_EQ(std::string(buffer->data, buffer->size), bodies[i]);
+    EXPECT_EQ(m3u8_prefetch_release(prefetch, buffer),
+              M3U8_PREFETCH_STATUS_NO_ERROR);
+  }
+
+  EXPECT_EQ(m3u8_prefetch_destroy(prefetch), M3U8_PREFETCH_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_transport_destroy(transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+}
+
+TEST_F(m3u8_prefetch_test, given_aes_128_key_decrypts_segments) {
+  m3u8_prefetch_t*        prefetch = NULL;
+  m3u8_prefetch_buffer_t* buffer = NULL;
+  m3u8_transport_t*       transport = NULL;
+  m3u8_prefetch_config_t  config = {.depth = 2, .buffer_size = 0, .transport = NULL};
+  ext_x_key               key = {};
+  static const char       key_bytes[] = "\x00\x01\x02\x03\x04\x05\x06\x07"
+                                        "\x08\x09\x0a\x0b\x0c\x0d\x0e\x0f";
+  // "payload-<n>" under key_bytes with the IV of media sequence 5 + n
+  static const unsigned char ciphers[3][16] = {
+      {0xee, 0x4d, 0xba, 0xbd, 0x36, 0x9e, 0xcf, 0x0b, 0x55, 0x47, 0x84, 0x29, 0xa8, 0x7f, 0xd3, 0x64},
+      {0xd4, 0xfa, 0x41, 0x78, 0x88, 0x2b, 0xd3, 0x0a, 0xc0, 0x98, 0xf0, 0x40, 0xf1, 0x7b, 0x3e, 0xad},
+      {0x57, 0x3c, 0x32, 0xbb, 0x85, 0xae, 0xeb, 0xa0, 0x41, 0x28, 0xa0, 0xce, 0xe5, 0x2c, 0x63, 0x51},
+  };
+
+  key.method = (char*)"AES-128";
+  key.uri = (char*)"keys/k1.key";
+
+  ASSERT_EQ(m3u8_transport_memory_create(&transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_transport_memory_put(transport, "mem://vod/keys/k1.key", key_bytes, 16, false),
+            M3U8_TRANSPORT_STATUS_NO_ERROR);
+
+  for (int i = 0; i < 3; i++) {
+    std::string uri = "mem://vod/" + std::string(segments[i].uri);
+
+    segments[i].key = &key;
+    ASSERT_EQ(m3u8_transport_memory_put(transport, uri.c_str(), (const char*)ciphers[i], 16, false),
+              M3U8_TRANSPORT_STATUS_NO_ERROR);
+  }
+
+  media.media_sequence = 5;
+  media.segments_count = 3;
+  config.transport = transport;
+
+  ASSERT_EQ(m3u8_prefetch_create(&prefetch, &media, "mem://vod/index.m3u8", &config),
+            M3U8_PREFETCH_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_prefetch_start(prefetch, 0), M3U8_PREFETCH_STATUS_NO_ERROR);
+
+  for (int i = 0; i < 3; i++) {
+    std::string expected = "payload-" + std::to_string(i);
+
+    ASSERT_EQ(m3u8_prefetch_acquire(prefetch, &buffer),
+              M3U8_PREFETCH_STATUS_NO_ERROR);
+    EXPECT_EQ(std::string(buffer->data, buffer->size), expected);
+    EXPECT_EQ(m3u8_prefetch_release(prefetch, buffer),
+              M3U8_PREFETCH_STATUS_NO_ERROR);
+  }
+
+  EXPECT_EQ(m3u8_prefetch_destroy(prefetch), M3U8_PREFETCH_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_transport_destroy(transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  m3u8_key_cache_clear();
+
+  for (int i = 0; i < 3; i++) {
+    segments[i].key = NULL;
+  }
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,246 @@
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "../src/prefetch.h"
+#include "../src/range.h"
+}
+
+#define MOCK_SEGMENTS_COUNT 6
+#define MOCK_SEGMENT_SIZE   10
+#define MOCK_BASE_URI       "https://vod.example.com/asset/index.m3u8"
+
+// single-file asset: a ten byte header followed by segment i as "segment%03d"
+static std::string mock_body;
+
+// ranges requested from the origin, one entry per submitted request
+static std::vector<std::pair<size_t, size_t>> mock_ranges;
+
+static int mock_open(void*, const char*, m3u8_transport_stream_t*) {
+  return M3U8_TRANSPORT_STATUS_NOT_FOUND;
+}
+
+static int mock_read(void*, const char**, size_t*) {
+  return M3U8_TRANSPORT_STATUS_IO_ERROR;
+}
+
+static int mock_close(void*) {
+  return M3U8_TRANSPORT_STATUS_NO_ERROR;
+}
+
+// origin ignoring Range: the whole body is sent in small chunks and clipped
+static int mock_submit(void*, m3u8_transport_request_t* request) {
+  size_t position = 0;
+  int    status = M3U8_TRANSPORT_STATUS_NO_ERROR;
+
+  mock_ranges.push_back({request->range_offset, request->range_length});
+
+  for (size_t i = 0; i < mock_body.size() && status == M3U8_TRANSPORT_STATUS_NO_ERROR; i += 7) {
+    size_t size = mock_body.size() - i < 7 ? mock_body.size() - i : 7;
+
+    if (m3u8_transport_deliver(request, &position, mock_body.data() + i, size) != 0) {
+      status = M3U8_TRANSPORT_STATUS_IO_ERROR;
+    }
+  }
+
+  request->done(request, status, request->userdata);
+
+  return M3U8_TRANSPORT_STATUS_NO_ERROR;
+}
+
+static const m3u8_transport_ops_t mock_ops = {
+    "origin", mock_open, mock_read, NULL, mock_close, mock_submit, NULL,
+};
+
+class m3u8_range_test : public ::testing::Test {
+ protected:
+  m3u8_media_t         media;
+  m3u8_media_segment_t segments[MOCK_SEGMENTS_COUNT];
+  char                 uri[16] = "asset.mp4";
+  char                 other_uri[16] = "other.mp4";
+
+  void SetUp() override {
+    memset(&media, 0, sizeof(m3u8_media_t));
+    memset(segments, 0, sizeof(segments));
+    mock_ranges.clear();
+    mock_body = "ftypmoov..";
+
+    for (int i = 0; i < MOCK_SEGMENTS_COUNT; i++) {
+      char payload[MOCK_SEGMENT_SIZE + 1];
+
+      snprintf(payload, sizeof(payload), "segment%03d", i);
+      mock_body += payload;
+
+      segments[i].duration = 4.0;
+      segments[i].uri = uri;
+      segments[i].byte_range.offset = MOCK_SEGMENT_SIZE * (i + 1);
+      segments[i].byte_range.length = MOCK_SEGMENT_SIZE;
+    }
+
+    media.segments = segments;
+    media.segments_count = MOCK_SEGMENTS_COUNT;
+  }
+};
+
+// ----------- m3u8_range_parse -----------
+
+TEST_F(m3u8_range_test, given_length_and_offset_parses_both) {
+  m3u8_byte_range_t range = {};
+
+  ASSERT_EQ(m3u8_range_parse("75232@4560", NULL, &range), M3U8_RANGE_STATUS_NO_ERROR);
+  EXPECT_EQ(range.offset, 4560u);
+  EXPECT_EQ(range.length, 75232u);
+}
+
+TEST_F(m3u8_range_test, given_missing_offset_continues_previous_range) {
+  m3u8_byte_range_t previous = {.offset = 4560, .length = 100};
+  m3u8_byte_range_t range = {};
+
+  ASSERT_EQ(m3u8_range_parse("200", &previous, &range), M3U8_RANGE_STATUS_NO_ERROR);
+  EXPECT_EQ(range.offset, 4660u);
+  EXPECT_EQ(range.length, 200u);
+
+  EXPECT_EQ(m3u8_range_parse("200", NULL, &range), M3U8_RANGE_STATUS_FORMAT_ERROR);
+}
+
+TEST_F(m3u8_range_test, given_malformed_value_returns_format_error) {
+  m3u8_byte_range_t range = {};
+
+  EXPECT_EQ(m3u8_range_parse(NULL, NULL, &range), M3U8_RANGE_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_range_parse("", NULL, &range), M3U8_RANGE_STATUS_FORMAT_ERROR);
+  EXPECT_EQ(m3u8_range_parse("0@0", NULL, &range), M3U8_RANGE_STATUS_FORMAT_ERROR);
+  EXPECT_EQ(m3u8_range_parse("10@", NULL, &range), M3U8_RANGE_STATUS_FORMAT_ERROR);
+  EXPECT_EQ(m3u8_range_parse("10@5x", NULL, &range), M3U8_RANGE_STATUS_FORMAT_ERROR);
+  EXPECT_EQ(m3u8_range_parse("-10@5", NULL, &range), M3U8_RANGE_STATUS_FORMAT_ERROR);
+  EXPECT_EQ(m3u8_range_parse("99999999999999999999999@0", NULL, &range),
+            M3U8_RANGE_STATUS_FORMAT_ERROR);
+}
+
+// ----------- m3u8_range_plan -----------
+
+TEST_F(m3u8_range_test, given_adjacent_ranges_plans_one_request) {
+  m3u8_range_request_t requests[MOCK_SEGMENTS_COUNT];
+  int                  requests_s = 0;
+
+  ASSERT_EQ(m3u8_range_plan(&media, 1, 4, 0, 0, requests, &requests_s),
+            M3U8_RANGE_STATUS_NO_ERROR);
+  ASSERT_EQ(requests_s, 1);
+  EXPECT_STREQ(requests[0].uri, uri);
+  EXPECT_EQ(requests[0].offset, 20u);
+  EXPECT_EQ(requests[0].length, 40u);
+  EXPECT_EQ(requests[0].first, 1);
+  EXPECT_EQ(requests[0].count, 4);
+}
+
+TEST_F(m3u8_range_test, given_gap_uri_change_or_limit_splits_requests) {
+  m3u8_range_request_t requests[MOCK_SEGMENTS_COUNT];
+  int                  requests_s = 0;
+
+  segments[1].byte_range.length -= 4;
+  segments[4].uri = other_uri;
+
+  ASSERT_EQ(m3u8_range_plan(&media, 0, MOCK_SEGMENTS_COUNT, 0, 0, requests, &requests_s),
+            M3U8_RANGE_STATUS_NO_ERROR);
+  ASSERT_EQ(requests_s, 4);
+  EXPECT_EQ(requests[0].count, 2);
+  EXPECT_EQ(requests[1].count, 2);
+  EXPECT_EQ(requests[2].count, 1);
+  EXPECT_EQ(requests[3].count, 1);
+
+  ASSERT_EQ(m3u8_range_plan(&media, 0, 4, 4, 25, requests, &requests_s),
+            M3U8_RANGE_STATUS_NO_ERROR);
+  ASSERT_EQ(requests_s, 2);
+  EXPECT_EQ(requests[0].length, 16u);
+  EXPECT_EQ(requests[1].offset, 30u);
+  EXPECT_EQ(requests[1].length, 20u);
+  EXPECT_EQ(requests[1].count, 2);
+}
+
+TEST_F(m3u8_range_test, given_templated_uris_merges_equal_numbers) {
+  m3u8_range_request_t requests[MOCK_SEGMENTS_COUNT];
+  int                  requests_s = 0;
+
+  for (int i = 0; i < MOCK_SEGMENTS_COUNT; i++) {
+    segments[i].uri = NULL;
+    segments[i].uri_template = 1;
+    segments[i].uri_number = i < 3 ? 7 : 8;
+  }
+
+  ASSERT_EQ(m3u8_range_plan(&media, 0, MOCK_SEGMENTS_COUNT, 0, 0, requests, &requests_s),
+            M3U8_RANGE_STATUS_NO_ERROR);
+  ASSERT_EQ(requests_s, 2);
+  EXPECT_EQ(requests[0].count, 3);
+  EXPECT_EQ(requests[0].uri, nullptr);
+  EXPECT_FALSE(m3u8_range_is_mergeable(&segments[2], &segments[3], 0));
+}
+
+TEST_F(m3u8_range_test, given_span_outside_playlist_returns_invalid_arg) {
+  m3u8_range_request_t requests[MOCK_SEGMENTS_COUNT];
+  int                  requests_s = 0;
+
+  EXPECT_EQ(m3u8_range_plan(&media, 4, 3, 0, 0, requests, &requests_s),
+            M3U8_RANGE_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_range_plan(NULL, 0, 1, 0, 0, requests, &requests_s),
+            M3U8_RANGE_STATUS_INVALID_ARG);
+}
+
+// ----------- m3u8_range_split -----------
+
+TEST_F(m3u8_range_test, given_merged_body_splits_without_copying) {
+  m3u8_range_request_t requests[MOCK_SEGMENTS_COUNT];
+  m3u8_range_view_t    views[MOCK_SEGMENTS_COUNT];
+  int                  requests_s = 0;
+  const char*          body = mock_body.data() + 20;
+
+  ASSERT_EQ(m3u8_range_plan(&media, 1, 3, 0, 0, requests, &requests_s),
+            M3U8_RANGE_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_range_split(&media, &requests[0], body, 30, views), M3U8_RANGE_STATUS_NO_ERROR);
+
+  for (int i = 0; i < 3; i++) {
+    EXPECT_EQ(views[i].data, body + i * MOCK_SEGMENT_SIZE);
+    EXPECT_EQ(std::string(views[i].data, views[i].size), "segment00" + std::to_string(i + 1));
+  }
+
+  EXPECT_EQ(m3u8_range_split(&media, &requests[0], body, 29, views),
+            M3U8_RANGE_STATUS_SHORT_BODY);
+}
+
+// ----------- prefetch coalescing -----------
+
+TEST_F(m3u8_range_test, given_prefetch_merges_adjacent_segments) {
+  m3u8_transport_t*       transport = NULL;
+  m3u8_prefetch_t*        prefetch = NULL;
+  m3u8_prefetch_buffer_t* buffer = NULL;
+  m3u8_prefetch_config_t  config = {.depth = 3, .buffer_size = 0};
+
+  ASSERT_EQ(m3u8_transport_create(&transport, &mock_ops, NULL), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  config.transport = transport;
+
+  ASSERT_EQ(m3u8_prefetch_create(&prefetch, &media, MOCK_BASE_URI, &config),
+            M3U8_PREFETCH_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_prefetch_start(prefetch, 0), M3U8_PREFETCH_STATUS_NO_ERROR);
+
+  ASSERT_EQ(mock_ranges.size(), 1u);
+  EXPECT_EQ(mock_ranges[0].first, 10u);
+  EXPECT_EQ(mock_ranges[0].second, 30u);
+
+  for (int i = 0; i < MOCK_SEGMENTS_COUNT; i++) {
+    ASSERT_EQ(m3u8_prefetch_acquire(prefetch, &buffer), M3U8_PREFETCH_STATUS_NO_ERROR);
+    EXPECT_EQ(buffer->index, i);
+    EXPECT_EQ(std::string(buffer->data, buffer->size), "segment00" + std::to_string(i));
+    EXPECT_EQ(m3u8_prefetch_release(prefetch, buffer), M3U8_PREFETCH_STATUS_NO_ERROR);
+  }
+
+  // every release frees a single slot, so the refills go out one by one
+  EXPECT_EQ(mock_ranges.size(), 1u + MOCK_SEGMENTS_COUNT - 3);
+  EXPECT_EQ(m3u8_prefetch_destroy(prefetch), M3U8_PREFETCH_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_transport_destroy(transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
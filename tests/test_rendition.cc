@@ -0,0 +1,137 @@
+#include <gtest/gtest.h>
+#include <string.h>
+
+extern "C" {
+#include "../src/rendition.h"
+#include "../src/variant.h"
+}
+
+class m3u8_rendition_test : public ::testing::Test {
+ protected:
+  m3u8_t* m3u8_ptr = NULL;
+
+  void SetUp() override {
+    ASSERT_EQ(m3u8_create(&m3u8_ptr), M3U8_STATUS_NO_ERROR);
+  }
+
+  void TearDown() override {
+    EXPECT_EQ(m3u8_destroy(m3u8_ptr), M3U8_STATUS_NO_ERROR);
+  }
+
+  void append(m3u8_media_type_e type, const char* group_id, const char* name, bool is_default) {
+    ext_x_media_type_t rendition = {};
+
+    rendition.type = type;
+    rendition.group_id = strdup(group_id);
+    rendition.name = strdup(name);
+    rendition.is_default = is_default;
+    ASSERT_EQ(m3u8_rendition_append(m3u8_ptr, &rendition), M3U8_RENDITION_STATUS_NO_ERROR);
+  }
+
+  void variant(const char* audio, const char* subtitles) {
+    ext_x_stream_inf_t variant = {};
+
+    variant.bandwidth = 1000000;
+    variant.audio = audio != NULL ? strdup(audio) : NULL;
+    variant.subtitles = subtitles != NULL ? strdup(subtitles) : NULL;
+    variant.uri = strdup("v.m3u8");
+    ASSERT_EQ(m3u8_variant_append(m3u8_ptr, &variant), M3U8_VARIANT_STATUS_NO_ERROR);
+  }
+};
+
+// ----------- m3u8_rendition_index -----------
+
+TEST_F(m3u8_rendition_test, given_interleaved_renditions_makes_groups_contiguous) {
+  const m3u8_rendition_group_t* group = NULL;
+
+  append(AUDIO, "aac", "en", false);
+  append(SUBTITLES, "subs", "en", false);
+  append(AUDIO, "ac3", "en", false);
+  append(AUDIO, "aac", "fr", true);
+  append(SUBTITLES, "subs", "fr", false);
+  ASSERT_EQ(m3u8_rendition_index(m3u8_ptr), M3U8_RENDITION_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_ptr->rendition_groups_count, 3);
+
+  ASSERT_EQ(m3u8_rendition_group(m3u8_ptr, AUDIO, "aac", &group), M3U8_RENDITION_STATUS_NO_ERROR);
+  ASSERT_EQ(group->count, 2);
+  EXPECT_STREQ(m3u8_ptr->renditions[group->first].name, "en");
+  EXPECT_STREQ(m3u8_ptr->renditions[group->first + 1].name, "fr");
+  EXPECT_STREQ(m3u8_ptr->renditions[group->fallback].name, "fr");
+
+  ASSERT_EQ(m3u8_rendition_group(m3u8_ptr, SUBTITLES, "subs", &group), M3U8_RENDITION_STATUS_NO_ERROR);
+  ASSERT_EQ(group->count, 2);
+  EXPECT_STREQ(m3u8_ptr->renditions[group->fallback].name, "en");
+
+  EXPECT_EQ(m3u8_rendition_group(m3u8_ptr, AUDIO, "dts", &group), M3U8_RENDITION_STATUS_NOT_FOUND);
+}
+
+TEST_F(m3u8_rendition_test, given_same_group_id_for_two_types_keeps_them_apart) {
+  const m3u8_rendition_group_t* audio = NULL;
+  const m3u8_rendition_group_t* subtitles = NULL;
+
+  append(AUDIO, "main", "stereo", false);
+  append(SUBTITLES, "main", "captions", false);
+  ASSERT_EQ(m3u8_rendition_index(m3u8_ptr), M3U8_RENDITION_STATUS_NO_ERROR);
+
+  ASSERT_EQ(m3u8_rendition_group(m3u8_ptr, AUDIO, "main", &audio), M3U8_RENDITION_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_rendition_group(m3u8_ptr, SUBTITLES, "main", &subtitles), M3U8_RENDITION_STATUS_NO_ERROR);
+  EXPECT_NE(audio, subtitles);
+  EXPECT_STREQ(m3u8_ptr->renditions[audio->first].name, "stereo");
+  EXPECT_STREQ(m3u8_ptr->renditions[subtitles->first].name, "captions");
+}
+
+// ----------- m3u8_rendition_default -----------
+
+TEST_F(m3u8_rendition_test, given_many_languages_resolves_variant_defaults) {
+  const ext_x_media_type_t* rendition = NULL;
+  char                      group_id[16];
+  char                      name[16];
+
+  // NOTE: 4 audio groups and 2 subtitle groups of 8 languages each
+  for (int language = 0; language < 8; language++) {
+    for (int g = 0; g < 6; g++) {
+      snprintf(group_id, sizeof(group_id), "g%d", g);
+      snprintf(name, sizeof(name), "%s-l%d", group_id, language);
+      append(g < 4 ? AUDIO : SUBTITLES, group_id, name, language == g);
+    }
+  }
+
+  variant("g2", "g5");
+  variant("g3", NULL);
+  variant("missing", NULL);
+  ASSERT_EQ(m3u8_rendition_index(m3u8_ptr), M3U8_RENDITION_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_ptr->renditions_count, 48);
+  ASSERT_EQ(m3u8_ptr->rendition_groups_count, 6);
+
+  ASSERT_EQ(m3u8_rendition_default(m3u8_ptr, 0, AUDIO, &rendition), M3U8_RENDITION_STATUS_NO_ERROR);
+  EXPECT_STREQ(rendition->name, "g2-l2");
+  ASSERT_EQ(m3u8_rendition_default(m3u8_ptr, 0, SUBTITLES, &rendition), M3U8_RENDITION_STATUS_NO_ERROR);
+  EXPECT_STREQ(rendition->name, "g5-l5");
+  ASSERT_EQ(m3u8_rendition_default(m3u8_ptr, 1, AUDIO, &rendition), M3U8_RENDITION_STATUS_NO_ERROR);
+  EXPECT_STREQ(rendition->name, "g3-l3");
+
+  EXPECT_EQ(m3u8_rendition_default(m3u8_ptr, 1, SUBTITLES, &rendition), M3U8_RENDITION_STATUS_NOT_FOUND);
+  EXPECT_EQ(m3u8_rendition_default(m3u8_ptr, 2, AUDIO, &rendition), M3U8_RENDITION_STATUS_NOT_FOUND);
+  EXPECT_EQ(m3u8_rendition_default(m3u8_ptr, 3, AUDIO, &rendition), M3U8_RENDITION_STATUS_INVALID_ARG);
+}
+
+TEST_F(m3u8_rendition_test, given_append_after_index_requires_reindex) {
+  const ext_x_media_type_t* rendition = NULL;
+
+  append(AUDIO, "aac", "en", false);
+  variant("aac", NULL);
+  ASSERT_EQ(m3u8_rendition_index(m3u8_ptr), M3U8_RENDITION_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_rendition_default(m3u8_ptr, 0, AUDIO, &rendition), M3U8_RENDITION_STATUS_NO_ERROR);
+
+  append(AUDIO, "aac", "fr", true);
+  EXPECT_EQ(m3u8_rendition_default(m3u8_ptr, 0, AUDIO, &rendition), M3U8_RENDITION_STATUS_INVALID_ARG);
+
+  ASSERT_EQ(m3u8_rendition_index(m3u8_ptr), M3U8_RENDITION_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_rendition_default(m3u8_ptr, 0, AUDIO, &rendition), M3U8_RENDITION_STATUS_NO_ERROR);
+  EXPECT_STREQ(rendition->name, "fr");
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,209 @@
+#include <gtest/gtest.h>
+#include <pthread.h>
+#include <stdint.h>
+#include <string.h>
+
+extern "C" {
+#include "../src/slab.h"
+}
+
+/** @brief object embedding a node, like the attribute and segment lists */
+typedef struct {
+  char  name[24];
+  void* next;
+  void* prev;
+} test_object_t;
+
+static void* test_slab_worker(void* context) {
+  m3u8_slab_t*   slab = (m3u8_slab_t*)context;
+  test_object_t* objects[200] = {NULL};
+
+  for (int round = 0; round < 200; round++) {
+    for (int i = 0; i < 200; i++) {
+      if (m3u8_slab_alloc(slab, (void**)&objects[i]) != M3U8_SLAB_STATUS_NO_ERROR ||
+          objects[i]->next != NULL) {
+        return (void*)1;
+      }
+
+      objects[i]->next = objects[i];
+    }
+
+    for (int i = 0; i < 200; i++) {
+      m3u8_slab_free(slab, objects[i]);
+    }
+  }
+
+  return NULL;
+}
+
+// ----------- m3u8_slab_create -----------
+
+TEST(m3u8_slab_create_test, given_invalid_args_returns_invalid_arg) {
+  m3u8_slab_t* slab = NULL;
+
+  EXPECT_EQ(m3u8_slab_create(NULL, 8), M3U8_SLAB_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_slab_create(&slab, 0), M3U8_SLAB_STATUS_INVALID_ARG);
+  ASSERT_EQ(m3u8_slab_create(&slab, 8), M3U8_SLAB_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_slab_create(&slab, 8), M3U8_SLAB_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_slab_destroy(slab), M3U8_SLAB_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_slab_destroy(NULL), M3U8_SLAB_STATUS_INVALID_ARG);
+}
+
+// ----------- m3u8_slab_alloc -----------
+
+TEST(m3u8_slab_alloc_test, given_a_freed_object_reuses_it_zero_filled) {
+  m3u8_slab_t*   slab = NULL;
+  test_object_t* first = NULL;
+  test_object_t* second = NULL;
+
+  ASSERT_EQ(m3u8_slab_create(&slab, sizeof(test_object_t)), M3U8_SLAB_STATUS_NO_ERROR);
+
+  ASSERT_EQ(m3u8_slab_alloc(slab, (void**)&first), M3U8_SLAB_STATUS_NO_ERROR);
+  EXPECT_EQ((uintptr_t)first % M3U8_SLAB_ALIGNMENT, 0u);
+  strcpy(first->name, "group-audio");
+  first->next = first;
+
+  EXPECT_EQ(m3u8_slab_free(slab, first), M3U8_SLAB_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_slab_alloc(slab, (void**)&second), M3U8_SLAB_STATUS_NO_ERROR);
+  EXPECT_EQ(second, first);
+  EXPECT_EQ(second->name[0], '\0');
+  EXPECT_EQ(second->next, nullptr);
+
+  EXPECT_EQ(m3u8_slab_alloc(NULL, (void**)&second), M3U8_SLAB_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_slab_alloc(slab, NULL), M3U8_SLAB_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_slab_free(slab, NULL), M3U8_SLAB_STATUS_INVALID_ARG);
+
+  EXPECT_EQ(m3u8_slab_destroy(slab), M3U8_SLAB_STATUS_NO_ERROR);
+}
+
+TEST(m3u8_slab_alloc_test, given_many_objects_spans_chunks_without_overlap) {
+  m3u8_slab_t*      slab = NULL;
+  m3u8_slab_stats_t stats;
+  test_object_t*    objects[2000] = {NULL};
+
+  ASSERT_EQ(m3u8_slab_create(&slab, sizeof(test_object_t)), M3U8_SLAB_STATUS_NO_ERROR);
+
+  for (int i = 0; i < 2000; i++) {
+    ASSERT_EQ(m3u8_slab_alloc(slab, (void**)&objects[i]), M3U8_SLAB_STATUS_NO_ERROR);
+    snprintf(objects[i]->name, sizeof(objects[i]->name), "segment%d.ts", i);
+  }
+
+  for (int i = 0; i < 2000; i++) {
+    char name[24];
+
+    snprintf(name, sizeof(name), "segment%d.ts", i);
+    EXPECT_STREQ(objects[i]->name, name);
+  }
+
+  EXPECT_EQ(m3u8_slab_stats(slab, &stats), M3U8_SLAB_STATUS_NO_ERROR);
+  EXPECT_EQ(stats.object_size, 48u);
+  EXPECT_GE(stats.chunks, 2000 * 48 / (16 * 1024) + 1);
+  EXPECT_EQ(stats.bytes % (16 * 1024), 0u);
+
+  for (int i = 0; i < 2000; i++) {
+    EXPECT_EQ(m3u8_slab_free(slab, objects[i]), M3U8_SLAB_STATUS_NO_ERROR);
+  }
+
+  // NOTE: freed objects are handed out again before any new chunk
+  for (int i = 0; i < 2000; i++) {
+    ASSERT_EQ(m3u8_slab_alloc(slab, (void**)&objects[i]), M3U8_SLAB_STATUS_NO_ERROR);
+  }
+
+  EXPECT_EQ(m3u8_slab_stats(slab, &stats), M3U8_SLAB_STATUS_NO_ERROR);
+  EXPECT_LE(stats.chunks, 2000 * 48 / (16 * 1024) + 1);
+
+  EXPECT_EQ(m3u8_slab_destroy(slab), M3U8_SLAB_STATUS_NO_ERROR);
+}
+
+TEST(m3u8_slab_alloc_test, given_threads_hands_out_each_object_once) {
+  m3u8_slab_t* slab = NULL;
+  pthread_t    threads[4];
+  void*        result = NULL;
+
+  ASSERT_EQ(m3u8_slab_create(&slab, sizeof(test_object_t)), M3U8_SLAB_STATUS_NO_ERROR);
+
+  for (int i = 0; i < 4; i++) {
+    ASSERT_EQ(pthread_create(&threads[i], NULL, test_slab_worker, slab), 0);
+  }
+
+  for (int i = 0; i < 4; i++) {
+    pthread_join(threads[i], &result);
+    EXPECT_EQ(result, nullptr);
+  }
+
+  EXPECT_EQ(m3u8_slab_destroy(slab), M3U8_SLAB_STATUS_NO_ERROR);
+}
+
+TEST(m3u8_slab_alloc_test, given_more_slabs_than_caches_keeps_the_footprint) {
+  m3u8_slab_t*      slabs[20] = {NULL};
+  m3u8_slab_stats_t stats;
+  void*             object = NULL;
+
+  for (int i = 0; i < 20; i++) {
+    ASSERT_EQ(m3u8_slab_create(&slabs[i], 32), M3U8_SLAB_STATUS_NO_ERROR);
+  }
+
+  // NOTE: evicted caches go back to their slab instead of being dropped
+  for (int round = 0; round < 1000; round++) {
+    for (int i = 0; i < 20; i++) {
+      ASSERT_EQ(m3u8_slab_alloc(slabs[i], &object), M3U8_SLAB_STATUS_NO_ERROR);
+      ASSERT_EQ(m3u8_slab_free(slabs[i], object), M3U8_SLAB_STATUS_NO_ERROR);
+    }
+  }
+
+  for (int i = 0; i < 20; i++) {
+    EXPECT_EQ(m3u8_slab_stats(slabs[i], &stats), M3U8_SLAB_STATUS_NO_ERROR);
+    EXPECT_EQ(stats.chunks, 1u);
+    EXPECT_EQ(m3u8_slab_destroy(slabs[i]), M3U8_SLAB_STATUS_NO_ERROR);
+  }
+}
+
+// ----------- m3u8_slab_reset -----------
+
+TEST(m3u8_slab_reset_test, given_objects_releases_every_chunk) {
+  m3u8_slab_t*      slab = NULL;
+  m3u8_slab_stats_t stats;
+  void*             object = NULL;
+
+  ASSERT_EQ(m3u8_slab_create(&slab, 100), M3U8_SLAB_STATUS_NO_ERROR);
+
+  for (int i = 0; i < 1000; i++) {
+    ASSERT_EQ(m3u8_slab_alloc(slab, &object), M3U8_SLAB_STATUS_NO_ERROR);
+  }
+
+  EXPECT_EQ(m3u8_slab_reset(slab), M3U8_SLAB_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_slab_stats(slab, &stats), M3U8_SLAB_STATUS_NO_ERROR);
+  EXPECT_EQ(stats.object_size, 112u);
+  EXPECT_EQ(stats.chunks, 0u);
+  EXPECT_EQ(stats.bytes, 0u);
+
+  ASSERT_EQ(m3u8_slab_alloc(slab, &object), M3U8_SLAB_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_slab_stats(slab, &stats), M3U8_SLAB_STATUS_NO_ERROR);
+  EXPECT_EQ(stats.chunks, 1u);
+
+  EXPECT_EQ(m3u8_slab_reset(NULL), M3U8_SLAB_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_slab_destroy(slab), M3U8_SLAB_STATUS_NO_ERROR);
+}
+
+// ----------- m3u8_slab_class -----------
+
+TEST(m3u8_slab_class_test, given_sizes_shares_one_slab_per_class) {
+  m3u8_slab_stats_t stats;
+
+  EXPECT_EQ(m3u8_slab_class(0), nullptr);
+  EXPECT_EQ(m3u8_slab_class(M3U8_SLAB_CLASSES * M3U8_SLAB_ALIGNMENT + 1), nullptr);
+  ASSERT_NE(m3u8_slab_class(17), nullptr);
+  EXPECT_EQ(m3u8_slab_class(17), m3u8_slab_class(32));
+  EXPECT_NE(m3u8_slab_class(16), m3u8_slab_class(17));
+
+  EXPECT_EQ(m3u8_slab_stats(m3u8_slab_class(17), &stats), M3U8_SLAB_STATUS_NO_ERROR);
+  EXPECT_EQ(stats.object_size, 32u);
+  EXPECT_EQ(m3u8_slab_destroy(m3u8_slab_class(17)), M3U8_SLAB_STATUS_INVALID_ARG);
+}
+
+// ----------- main -----------
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
@@ -0,0 +1,153 @@
+#include <gtest/gtest.h>
+#include <pthread.h>
+
+extern "C" {
+#include "../src/snapshot.h"
+#include "../src/variant.h"
+}
+
+typedef struct {
+  unsigned long first;
+  unsigned long second;
+} mock_playlist_t;
+
+static long mock_destroyed = 0;
+
+static void mock_destroy(void* playlist) {
+  __atomic_add_fetch(&mock_destroyed, 1, __ATOMIC_RELAXED);
+  delete (mock_playlist_t*)playlist;
+}
+
+static m3u8_snapshot_t* mock_snapshot(unsigned long value) {
+  m3u8_snapshot_t* snapshot = NULL;
+  mock_playlist_t* playlist = new mock_playlist_t{value, value};
+
+  EXPECT_EQ(m3u8_snapshot_create(&snapshot, playlist, mock_destroy), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+  return snapshot;
+}
+
+static void* mock_reader(void* arg) {
+  m3u8_publisher_t* publisher = (m3u8_publisher_t*)arg;
+  unsigned long     last = 0;
+
+  for (int i = 0; i < 20000; i++) {
+    m3u8_snapshot_t* snapshot = NULL;
+
+    EXPECT_EQ(m3u8_publisher_acquire(publisher, &snapshot), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+
+    // published before the readers start, and never torn
+    const mock_playlist_t* playlist = (const mock_playlist_t*)m3u8_snapshot_playlist(snapshot);
+    EXPECT_EQ(playlist->first, playlist->second);
+    EXPECT_GE(m3u8_snapshot_version(snapshot), last);
+    last = m3u8_snapshot_version(snapshot);
+
+    EXPECT_EQ(m3u8_snapshot_release(snapshot), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+  }
+
+  return NULL;
+}
+
+class m3u8_snapshot_test : public ::testing::Test {
+ protected:
+  m3u8_publisher_t* publisher = NULL;
+
+  void SetUp() override {
+    mock_destroyed = 0;
+    ASSERT_EQ(m3u8_publisher_create(&publisher), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+  }
+
+  void TearDown() override {
+    EXPECT_EQ(m3u8_publisher_destroy(publisher), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+  }
+};
+
+// ----------- m3u8_publisher_acquire -----------
+
+TEST_F(m3u8_snapshot_test, given_publications_acquires_the_latest) {
+  m3u8_snapshot_t* snapshot = NULL;
+
+  EXPECT_EQ(m3u8_publisher_acquire(publisher, &snapshot), M3U8_SNAPSHOT_STATUS_NOT_FOUND);
+  EXPECT_EQ(m3u8_publisher_acquire(NULL, &snapshot), M3U8_SNAPSHOT_STATUS_INVALID_ARG);
+
+  ASSERT_EQ(m3u8_publisher_publish(publisher, mock_snapshot(1)), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_publisher_publish(publisher, mock_snapshot(2)), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+  EXPECT_EQ(mock_destroyed, 1);
+
+  ASSERT_EQ(m3u8_publisher_acquire(publisher, &snapshot), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_snapshot_version(snapshot), 2);
+  EXPECT_EQ(((const mock_playlist_t*)m3u8_snapshot_playlist(snapshot))->first, 2);
+
+  // published twice
+  EXPECT_EQ(m3u8_publisher_publish(publisher, snapshot), M3U8_SNAPSHOT_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_snapshot_release(snapshot), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+}
+
+TEST_F(m3u8_snapshot_test, given_held_snapshot_outlives_its_replacement) {
+  m3u8_snapshot_t* held = NULL;
+  m3u8_snapshot_t* again = NULL;
+
+  ASSERT_EQ(m3u8_publisher_publish(publisher, mock_snapshot(1)), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_publisher_acquire(publisher, &held), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_snapshot_retain(held), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+
+  ASSERT_EQ(m3u8_publisher_publish(publisher, mock_snapshot(2)), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+  EXPECT_EQ(mock_destroyed, 0);
+  EXPECT_EQ(((const mock_playlist_t*)m3u8_snapshot_playlist(held))->first, 1);
+
+  ASSERT_EQ(m3u8_publisher_acquire(publisher, &again), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+  EXPECT_NE(again, held);
+  EXPECT_EQ(m3u8_snapshot_release(again), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+
+  EXPECT_EQ(m3u8_snapshot_release(held), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+  EXPECT_EQ(mock_destroyed, 0);
+  EXPECT_EQ(m3u8_snapshot_release(held), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+  EXPECT_EQ(mock_destroyed, 1);
+}
+
+TEST_F(m3u8_snapshot_test, given_concurrent_readers_reclaims_every_snapshot) {
+  pthread_t readers[8];
+
+  ASSERT_EQ(m3u8_publisher_publish(publisher, mock_snapshot(0)), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+
+  for (int i = 0; i < 8; i++) {
+    ASSERT_EQ(pthread_create(&readers[i], NULL, mock_reader, publisher), 0);
+  }
+
+  for (unsigned long value = 1; value <= 2000; value++) {
+    ASSERT_EQ(m3u8_publisher_publish(publisher, mock_snapshot(value)), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+  }
+
+  for (int i = 0; i < 8; i++) {
+    pthread_join(readers[i], NULL);
+  }
+
+  // all but the current one
+  EXPECT_EQ(mock_destroyed, 2000);
+}
+
+// ----------- m3u8_snapshot_destroy_m3u8 -----------
+
+TEST_F(m3u8_snapshot_test, given_m3u8_destroys_it_with_the_last_reference) {
+  m3u8_t*            m3u8_ptr = NULL;
+  m3u8_snapshot_t*   snapshot = NULL;
+  ext_x_stream_inf_t variant = {};
+
+  ASSERT_EQ(m3u8_create(&m3u8_ptr), M3U8_STATUS_NO_ERROR);
+  variant.bandwidth = 800000;
+  variant.uri = strdup("low.m3u8");
+  ASSERT_EQ(m3u8_variant_append(m3u8_ptr, &variant), M3U8_VARIANT_STATUS_NO_ERROR);
+
+  EXPECT_EQ(m3u8_snapshot_create(&snapshot, NULL, NULL), M3U8_SNAPSHOT_STATUS_INVALID_ARG);
+  ASSERT_EQ(m3u8_snapshot_create(&snapshot, m3u8_ptr, m3u8_snapshot_destroy_m3u8),
+            M3U8_SNAPSHOT_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_snapshot_version(snapshot), 0);
+
+  // released by the publisher in TearDown, leak checked by the sanitizer
+  ASSERT_EQ(m3u8_publisher_publish(publisher, snapshot), M3U8_SNAPSHOT_STATUS_NO_ERROR);
+  EXPECT_EQ(((const m3u8_t*)m3u8_snapshot_playlist(snapshot))->variants[0].bandwidth, 800000);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
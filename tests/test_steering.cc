@@ -0,0 +1,383 @@
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <map>
+#include <string>
+#include <vector>
+
+extern "C" {
+#include "../src/steering.h"
+}
+
+#define MOCK_BASE_URI "https://origin.example.com/live/master.m3u8"
+#define MOCK_STEERING "https://steer.example.com/v1/steer.json"
+#define MOCK_PLAYLIST "#EXTM3U\n#EXT-X-TARGETDURATION:6\n"
+
+// synchronous stand-in for a steering server and its CDNs, keyed by uri
+// without query; unknown uris answer NOT_FOUND
+static std::map<std::string, std::string> mock_bodies;
+static std::vector<std::string>           mock_uris;
+
+// clock the tests move forward instead of sleeping through a TTL
+static long mock_now_ms;
+
+static long mock_clock(void) {
+  return mock_now_ms;
+}
+
+typedef struct {
+  std::string body;
+  bool        is_read;
+} mock_handle_t;
+
+static int mock_open(void*, const char* uri, m3u8_transport_stream_t* stream) {
+  std::string key(uri);
+
+  mock_uris.push_back(uri);
+  key = key.substr(0, key.find('?'));
+
+  if (mock_bodies.count(key) == 0) {
+    return M3U8_TRANSPORT_STATUS_NOT_FOUND;
+  }
+
+  stream->handle = new mock_handle_t{mock_bodies[key], false};
+  stream->is_terminated = true;
+
+  return M3U8_TRANSPORT_STATUS_NO_ERROR;
+}
+
+static int mock_read(void* handle, const char** chunk, size_t* size) {
+  mock_handle_t* mock = (mock_handle_t*)handle;
+
+  *chunk = mock->body.c_str();
+  *size = mock->is_read ? 0 : mock->body.size();
+  mock->is_read = true;
+
+  return M3U8_TRANSPORT_STATUS_NO_ERROR;
+}
+
+static int mock_close(void* handle) {
+  delete (mock_handle_t*)handle;
+
+  return M3U8_TRANSPORT_STATUS_NO_ERROR;
+}
+
+static const m3u8_transport_ops_t mock_ops = {
+    "steering", mock_open, mock_read, NULL, mock_close, NULL, NULL, NULL,
+};
+
+class m3u8_steering_test : public ::testing::Test {
+ protected:
+  m3u8_transport_t*        transport = NULL;
+  m3u8_steering_t*         steering = NULL;
+  ext_x_content_steering_t tag = {(char*)MOCK_STEERING, (char*)"A"};
+  ext_x_stream_inf_t       variants[4] = {};
+  m3u8_t                   master = {};
+  char*                    body = NULL;
+  size_t                   body_s = 0;
+
+  void SetUp() override {
+    const char* pathways[] = {"A", "B", "A", "B"};
+    const char* uris[] = {"https://a.example.com/hi.m3u8", "https://b.example.com/hi.m3u8",
+                          "https://a.example.com/lo.m3u8", "https://b.example.com/lo.m3u8"};
+
+    for (int i = 0; i < 4; i++) {
+      variants[i].bandwidth = i < 2 ? 5000000 : 800000;
+      variants[i].resolution = (char*)(i < 2 ? "1920x1080" : "640x360");
+      variants[i].pathway_id = (char*)pathways[i];
+      variants[i].uri = (char*)uris[i];
+      variants[i].__next = i < 3 ? &variants[i + 1] : NULL;
+    }
+
+    master.x_stream_inf = variants;
+    master.content_steering = &tag;
+    mock_bodies.clear();
+    mock_uris.clear();
+    mock_now_ms = 1000;
+    mock_bodies["https://a.example.com/hi.m3u8"] = MOCK_PLAYLIST "#A\n";
+    mock_bodies["https://b.example.com/hi.m3u8"] = MOCK_PLAYLIST "#B\n";
+
+    ASSERT_EQ(m3u8_transport_create(&transport, &mock_ops, NULL), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  }
+
+  void TearDown() override {
+    free(body);
+
+    if (steering != NULL) {
+      EXPECT_EQ(m3u8_steering_destroy(steering), M3U8_STEERING_STATUS_NO_ERROR);
+    }
+
+    m3u8_transport_destroy(transport);
+  }
+};
+
+// ----------- m3u8_steering_parse_tag -----------
+
+TEST_F(m3u8_steering_test, given_tag_attributes_parses_unquoted_values) {
+  ext_x_content_steering_t parsed = {};
+  char*                    pathway = NULL;
+
+  ASSERT_EQ(m3u8_steering_parse_tag("SERVER-URI=\"/steer?video=00012\",PATHWAY-ID=\"CDN-A\"",
+                                    &parsed),
+            M3U8_STEERING_STATUS_NO_ERROR);
+  EXPECT_STREQ(parsed.server_uri, "/steer?video=00012");
+  EXPECT_STREQ(parsed.pathway_id, "CDN-A");
+  EXPECT_EQ(m3u8_steering_tag_destroy(&parsed), M3U8_STEERING_STATUS_NO_ERROR);
+
+  EXPECT_EQ(m3u8_steering_parse_tag("PATHWAY-ID=\"CDN-A\"", &parsed),
+            M3U8_STEERING_STATUS_FORMAT_ERROR);
+
+  ASSERT_EQ(m3u8_steering_parse_pathway("BANDWIDTH=1280000,PATHWAY-ID=\"CDN-B\"", &pathway),
+            M3U8_STEERING_STATUS_NO_ERROR);
+  EXPECT_STREQ(pathway, "CDN-B");
+  free(pathway);
+
+  ASSERT_EQ(m3u8_steering_parse_pathway("BANDWIDTH=1280000", &pathway),
+            M3U8_STEERING_STATUS_NO_ERROR);
+  EXPECT_EQ(pathway, nullptr);
+}
+
+TEST_F(m3u8_steering_test, given_a_playlist_tag_is_released_by_m3u8_destroy) {
+  m3u8_t* m3u8_ptr = NULL;
+
+  ASSERT_EQ(m3u8_create(&m3u8_ptr), M3U8_STATUS_NO_ERROR);
+  ASSERT_NE(m3u8_ptr->content_steering =
+                (ext_x_content_steering_t*)calloc(1, sizeof(ext_x_content_steering_t)),
+            nullptr);
+  ASSERT_EQ(m3u8_steering_parse_tag("SERVER-URI=\"/steer\",PATHWAY-ID=\"CDN-A\"",
+                                    m3u8_ptr->content_steering),
+            M3U8_STEERING_STATUS_NO_ERROR);
+
+  // NOTE: leaks of the tag or its strings are caught by the sanitizer build
+  EXPECT_EQ(m3u8_destroy(m3u8_ptr), M3U8_STATUS_NO_ERROR);
+}
+
+// ----------- m3u8_steering_parse_manifest -----------
+
+TEST_F(m3u8_steering_test, given_manifest_parses_priority_and_skips_clones) {
+  m3u8_steering_manifest_t manifest = {};
+
+  ASSERT_EQ(m3u8_steering_parse_manifest(
+                "{ \"VERSION\": 1, \"TTL\": 30, \"RELOAD-URI\": \"next\\/steer.json\",\n"
+                "  \"PATHWAY-CLONES\": [{\"ID\": \"C\", \"URI-REPLACEMENT\": {\"HOST\": \"[c]\"}}],\n"
+                "  \"PATHWAY-PRIORITY\": [\"B\", \"A\"] }",
+                &manifest),
+            M3U8_STEERING_STATUS_NO_ERROR);
+  EXPECT_EQ(manifest.version, 1);
+  EXPECT_EQ(manifest.ttl, 30);
+  EXPECT_STREQ(manifest.reload_uri, "next/steer.json");
+  ASSERT_EQ(manifest.pathways_s, 2);
+  EXPECT_STREQ(manifest.pathways[0], "B");
+  EXPECT_STREQ(manifest.pathways[1], "A");
+  EXPECT_EQ(m3u8_steering_manifest_destroy(&manifest), M3U8_STEERING_STATUS_NO_ERROR);
+
+  ASSERT_EQ(m3u8_steering_parse_manifest("{\"VERSION\":1,\"PATHWAY-PRIORITY\":[]}", &manifest),
+            M3U8_STEERING_STATUS_NO_ERROR);
+  EXPECT_EQ(manifest.ttl, M3U8_STEERING_DEFAULT_TTL);
+  EXPECT_EQ(m3u8_steering_manifest_destroy(&manifest), M3U8_STEERING_STATUS_NO_ERROR);
+
+  EXPECT_EQ(m3u8_steering_parse_manifest("{\"VERSION\":1,\"TTL\":30}", &manifest),
+            M3U8_STEERING_STATUS_FORMAT_ERROR);
+  EXPECT_EQ(m3u8_steering_parse_manifest("{\"VERSION\":2,\"PATHWAY-PRIORITY\":[\"A\"]}", &manifest),
+            M3U8_STEERING_STATUS_FORMAT_ERROR);
+  EXPECT_EQ(m3u8_steering_parse_manifest("{\"VERSION\":1,\"PATHWAY-PRIORITY\":[\"A\"", &manifest),
+            M3U8_STEERING_STATUS_FORMAT_ERROR);
+}
+
+// ----------- m3u8_steering_select -----------
+
+TEST_F(m3u8_steering_test, given_no_measurement_follows_priority) {
+  const ext_x_stream_inf_t* chosen = NULL;
+
+  ASSERT_EQ(m3u8_steering_create(&steering, transport, &master, MOCK_BASE_URI),
+            M3U8_STEERING_STATUS_NO_ERROR);
+
+  // PATHWAY-ID of the tag first, then the manifest takes over
+  ASSERT_EQ(m3u8_steering_select(steering, &variants[3], &chosen), M3U8_STEERING_STATUS_NO_ERROR);
+  EXPECT_EQ(chosen, &variants[2]);
+
+  mock_bodies[MOCK_STEERING] = "{\"VERSION\":1,\"TTL\":300,\"PATHWAY-PRIORITY\":[\"B\",\"A\"]}";
+  ASSERT_EQ(m3u8_steering_refresh(steering, NULL), M3U8_STEERING_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_steering_select(steering, &variants[2], &chosen), M3U8_STEERING_STATUS_NO_ERROR);
+  EXPECT_EQ(chosen, &variants[3]);
+
+  // a pathway left out of the manifest is never used
+  mock_bodies[MOCK_STEERING] = "{\"VERSION\":1,\"TTL\":300,\"PATHWAY-PRIORITY\":[\"A\"]}";
+  m3u8_steering_destroy(steering);
+  steering = NULL;
+  ASSERT_EQ(m3u8_steering_create(&steering, transport, &master, MOCK_BASE_URI),
+            M3U8_STEERING_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_steering_refresh(steering, NULL), M3U8_STEERING_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_steering_report(steering, "A", false, 0), M3U8_STEERING_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_steering_select(steering, &variants[1], &chosen), M3U8_STEERING_STATUS_NO_ERROR);
+  EXPECT_EQ(chosen, &variants[0]);
+  EXPECT_EQ(m3u8_steering_report(steering, "Z", true, 10), M3U8_STEERING_STATUS_NOT_FOUND);
+}
+
+TEST_F(m3u8_steering_test, given_faster_pathway_prefers_it_over_priority) {
+  const ext_x_stream_inf_t* chosen = NULL;
+
+  ASSERT_EQ(m3u8_steering_create(&steering, transport, &master, MOCK_BASE_URI),
+            M3U8_STEERING_STATUS_NO_ERROR);
+
+  for (int i = 0; i < 4; i++) {
+    m3u8_steering_report(steering, "A", true, 400);
+    m3u8_steering_report(steering, "B", true, 40);
+  }
+
+  ASSERT_EQ(m3u8_steering_select(steering, &variants[0], &chosen), M3U8_STEERING_STATUS_NO_ERROR);
+  EXPECT_EQ(chosen, &variants[1]);
+
+  // comparable latencies leave the decision to the priority
+  for (int i = 0; i < 16; i++) {
+    m3u8_steering_report(steering, "A", true, 42);
+  }
+
+  ASSERT_EQ(m3u8_steering_select(steering, &variants[1], &chosen), M3U8_STEERING_STATUS_NO_ERROR);
+  EXPECT_EQ(chosen, &variants[0]);
+}
+
+TEST_F(m3u8_steering_test, given_master_without_variants_finds_no_pathway) {
+  const ext_x_stream_inf_t* chosen = NULL;
+
+  master.x_stream_inf = NULL;
+  ASSERT_EQ(m3u8_steering_create(&steering, transport, &master, MOCK_BASE_URI),
+            M3U8_STEERING_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_steering_select(steering, &variants[0], &chosen), M3U8_STEERING_STATUS_NOT_FOUND);
+  EXPECT_EQ(m3u8_steering_fetch(steering, &variants[0], NULL, &body, &body_s),
+            M3U8_STEERING_STATUS_NOT_FOUND);
+}
+
+// ----------- m3u8_steering_fetch -----------
+
+TEST_F(m3u8_steering_test, given_failing_pathway_fails_over_and_benches_it) {
+  ASSERT_EQ(m3u8_steering_create(&steering, transport, &master, MOCK_BASE_URI),
+            M3U8_STEERING_STATUS_NO_ERROR);
+  mock_bodies.erase("https://a.example.com/hi.m3u8");
+
+  ASSERT_EQ(m3u8_steering_fetch(steering, &variants[0], NULL, &body, &body_s),
+            M3U8_STEERING_STATUS_NO_ERROR);
+  EXPECT_EQ(std::string(body, body_s), MOCK_PLAYLIST "#B\n");
+  ASSERT_EQ(mock_uris.size(), 3u);
+  EXPECT_EQ(mock_uris[1], "https://a.example.com/hi.m3u8");
+  EXPECT_EQ(mock_uris[2], "https://b.example.com/hi.m3u8");
+  free(body);
+  body = NULL;
+
+  // the benched pathway is not retried on the next fetch
+  ASSERT_EQ(m3u8_steering_fetch(steering, &variants[0], NULL, &body, &body_s),
+            M3U8_STEERING_STATUS_NO_ERROR);
+  EXPECT_EQ(mock_uris.back(), "https://b.example.com/hi.m3u8");
+  EXPECT_EQ(mock_uris.size(), 4u);
+  free(body);
+  body = NULL;
+
+  mock_bodies.erase("https://b.example.com/hi.m3u8");
+  EXPECT_EQ(m3u8_steering_fetch(steering, &variants[0], NULL, &body, &body_s),
+            M3U8_STEERING_STATUS_FETCH_ERROR);
+}
+
+TEST_F(m3u8_steering_test, given_fresh_manifest_reuses_it_until_ttl) {
+  mock_bodies[MOCK_STEERING] =
+      "{\"VERSION\":1,\"TTL\":300,\"RELOAD-URI\":\"steer2.json\",\"PATHWAY-PRIORITY\":[\"B\",\"A\"]}";
+  ASSERT_EQ(m3u8_steering_create(&steering, transport, &master, MOCK_BASE_URI),
+            M3U8_STEERING_STATUS_NO_ERROR);
+
+  for (int i = 0; i < 3; i++) {
+    ASSERT_EQ(m3u8_steering_fetch(steering, &variants[0], NULL, &body, &body_s),
+              M3U8_STEERING_STATUS_NO_ERROR);
+    EXPECT_EQ(std::string(body, body_s), MOCK_PLAYLIST "#B\n");
+    free(body);
+    body = NULL;
+  }
+
+  // one manifest load, then one playlist per fetch
+  ASSERT_EQ(mock_uris.size(), 4u);
+  EXPECT_EQ(mock_uris[0], MOCK_STEERING);
+  EXPECT_EQ(m3u8_steering_refresh(steering, NULL), M3U8_STEERING_STATUS_NO_ERROR);
+  EXPECT_EQ(mock_uris.size(), 4u);
+}
+
+TEST_F(m3u8_steering_test, given_expired_manifest_reloads_with_current_pathway) {
+  mock_bodies[MOCK_STEERING] =
+      "{\"VERSION\":1,\"TTL\":1,\"RELOAD-URI\":\"steer2.json?session=7\","
+      "\"PATHWAY-PRIORITY\":[\"B\",\"A\"]}";
+  ASSERT_EQ(m3u8_steering_create(&steering, transport, &master, MOCK_BASE_URI),
+            M3U8_STEERING_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_steering_set_clock(steering, mock_clock), M3U8_STEERING_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_steering_fetch(steering, &variants[0], NULL, &body, &body_s),
+            M3U8_STEERING_STATUS_NO_ERROR);
+
+  mock_now_ms += 999;
+  EXPECT_EQ(m3u8_steering_refresh(steering, NULL), M3U8_STEERING_STATUS_NO_ERROR);
+  EXPECT_EQ(mock_uris.size(), 2u);
+
+  mock_now_ms += 1;
+
+  // the reload target is missing: the previous priority stays in force
+  EXPECT_EQ(m3u8_steering_refresh(steering, NULL), M3U8_STEERING_STATUS_FETCH_ERROR);
+  EXPECT_EQ(mock_uris.back(), "https://steer.example.com/v1/steer2.json?session=7&_HLS_pathway=B");
+  EXPECT_EQ(m3u8_steering_refresh(steering, NULL), M3U8_STEERING_STATUS_NO_ERROR);
+}
+
+TEST_F(m3u8_steering_test, given_reserved_characters_encodes_the_pathway) {
+  const char* pathways[] = {"CDN A&b=1", "B", "CDN A&b=1", "B"};
+
+  for (int i = 0; i < 4; i++) {
+    variants[i].pathway_id = (char*)pathways[i];
+  }
+
+  mock_bodies[MOCK_STEERING] = "{\"VERSION\":1,\"TTL\":1,\"PATHWAY-PRIORITY\":[\"CDN A&b=1\"]}";
+  mock_bodies["https://a.example.com/hi.m3u8"] = MOCK_PLAYLIST "#A\n";
+  ASSERT_EQ(m3u8_steering_create(&steering, transport, &master, MOCK_BASE_URI),
+            M3U8_STEERING_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_steering_set_clock(steering, mock_clock), M3U8_STEERING_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_steering_fetch(steering, &variants[0], NULL, &body, &body_s),
+            M3U8_STEERING_STATUS_NO_ERROR);
+
+  mock_now_ms += 1000;
+  EXPECT_EQ(m3u8_steering_refresh(steering, NULL), M3U8_STEERING_STATUS_NO_ERROR);
+  EXPECT_EQ(mock_uris.back(), MOCK_STEERING "?_HLS_pathway=CDN%20A%26b%3D1");
+}
+
+TEST_F(m3u8_steering_test, given_pathway_too_long_for_the_uri_skips_the_reload) {
+  std::string long_id(1000, ' ');
+  const char* pathways[] = {long_id.c_str(), "B", long_id.c_str(), "B"};
+  size_t      requested = 0;
+
+  for (int i = 0; i < 4; i++) {
+    variants[i].pathway_id = (char*)pathways[i];
+  }
+
+  mock_bodies[MOCK_STEERING] =
+      "{\"VERSION\":1,\"TTL\":1,\"PATHWAY-PRIORITY\":[\"" + long_id + "\"]}";
+  ASSERT_EQ(m3u8_steering_create(&steering, transport, &master, MOCK_BASE_URI),
+            M3U8_STEERING_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_steering_set_clock(steering, mock_clock), M3U8_STEERING_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_steering_fetch(steering, &variants[0], NULL, &body, &body_s),
+            M3U8_STEERING_STATUS_NO_ERROR);
+  requested = mock_uris.size();
+
+  // NOTE: 1000 encoded spaces take 3000 bytes, the request is not sent truncated
+  mock_now_ms += 1000;
+  EXPECT_EQ(m3u8_steering_refresh(steering, NULL), M3U8_STEERING_STATUS_FORMAT_ERROR);
+  EXPECT_EQ(mock_uris.size(), requested);
+  EXPECT_EQ(m3u8_steering_refresh(steering, NULL), M3U8_STEERING_STATUS_NO_ERROR);
+}
+
+TEST_F(m3u8_steering_test, given_invalid_args_returns_invalid_arg) {
+  const ext_x_stream_inf_t* chosen = NULL;
+
+  EXPECT_EQ(m3u8_steering_create(&steering, NULL, &master, MOCK_BASE_URI),
+            M3U8_STEERING_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_steering_select(NULL, &variants[0], &chosen), M3U8_STEERING_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_steering_fetch(NULL, &variants[0], NULL, &body, &body_s),
+            M3U8_STEERING_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_steering_parse_tag(NULL, &tag), M3U8_STEERING_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_steering_set_clock(NULL, mock_clock), M3U8_STEERING_STATUS_INVALID_ARG);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
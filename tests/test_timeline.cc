@@ -0,0 +1,244 @@
+#include <gtest/gtest.h>
+#include <string.h>
+
+#include <string>
+
+extern "C" {
+#include "../src/conate.h"
+#include "../src/timeline.h"
+}
+
+#define PDT_BASE 1700000000.0
+
+class m3u8_timeline_test : public ::testing::Test {
+ protected:
+  m3u8_media_t media;
+
+  void SetUp() override {
+    memset(&media, 0, sizeof(m3u8_media_t));
+  }
+
+  void TearDown() override {
+    EXPECT_EQ(m3u8_timeline_clear(&media), M3U8_TIMELINE_STATUS_NO_ERROR);
+  }
+
+  void append(double duration, double program_date_time = 0, bool is_discontinuity = false) {
+    m3u8_media_segment_t segment = {};
+    char                 uri[32];
+
+    snprintf(uri, sizeof(uri), "s%d.ts", media.media_sequence + media.segments_count);
+    segment.duration = duration;
+    segment.uri = strdup(uri);
+    segment.program_date_time = program_date_time;
+    segment.is_discontinuity = is_discontinuity;
+    ASSERT_EQ(m3u8_timeline_append(&media, &segment), M3U8_TIMELINE_STATUS_NO_ERROR);
+  }
+
+  void append_uri(const char* uri) {
+    m3u8_media_segment_t segment = {};
+
+    segment.duration = 4.0;
+    segment.uri = strdup(uri);
+    ASSERT_EQ(m3u8_timeline_append(&media, &segment), M3U8_TIMELINE_STATUS_NO_ERROR);
+  }
+
+  std::string uri(int index) {
+    char buffer[128];
+
+    EXPECT_EQ(m3u8_timeline_uri(&media, index, buffer, sizeof(buffer)), M3U8_TIMELINE_STATUS_NO_ERROR);
+    return buffer;
+  }
+};
+
+// ----------- conate_parse_iso8601 -----------
+
+TEST(conate_test, given_program_date_time_parses_epoch_seconds) {
+  double epoch = 0;
+
+  ASSERT_EQ(conate_parse_iso8601("2023-11-14T22:13:20Z", &epoch), CONATE_NO_ERROR);
+  EXPECT_DOUBLE_EQ(epoch, PDT_BASE);
+  ASSERT_EQ(conate_parse_iso8601("2023-11-14T22:13:20.250+00:00", &epoch), CONATE_NO_ERROR);
+  EXPECT_DOUBLE_EQ(epoch, PDT_BASE + 0.25);
+  ASSERT_EQ(conate_parse_iso8601("2023-11-15T00:13:20.5+0200", &epoch), CONATE_NO_ERROR);
+  EXPECT_DOUBLE_EQ(epoch, PDT_BASE + 0.5);
+  ASSERT_EQ(conate_parse_iso8601("1969-12-31T23:59:59Z", &epoch), CONATE_NO_ERROR);
+  EXPECT_DOUBLE_EQ(epoch, -1);
+
+  EXPECT_EQ(conate_parse_iso8601("2023-13-14T22:13:20Z", &epoch), CONATE_TIME_ERROR);
+  EXPECT_EQ(conate_parse_iso8601("2023-11-14T22:13:20Zjunk", &epoch), CONATE_TIME_ERROR);
+  EXPECT_EQ(conate_parse_iso8601("yesterday", &epoch), CONATE_TIME_ERROR);
+}
+
+// ----------- m3u8_timeline_seek -----------
+
+TEST_F(m3u8_timeline_test, given_offsets_finds_segments) {
+  int index = -1;
+
+  append(6.0);
+  append(6.0);
+  append(4.5);
+  append(6.0);
+
+  ASSERT_EQ(m3u8_timeline_seek(&media, 0, &index), M3U8_TIMELINE_STATUS_NO_ERROR);
+  EXPECT_EQ(index, 0);
+  ASSERT_EQ(m3u8_timeline_seek(&media, 12.0, &index), M3U8_TIMELINE_STATUS_NO_ERROR);
+  EXPECT_EQ(index, 2);
+  ASSERT_EQ(m3u8_timeline_seek(&media, 16.4, &index), M3U8_TIMELINE_STATUS_NO_ERROR);
+  EXPECT_EQ(index, 2);
+  ASSERT_EQ(m3u8_timeline_seek(&media, 16.5, &index), M3U8_TIMELINE_STATUS_NO_ERROR);
+  EXPECT_EQ(index, 3);
+
+  EXPECT_EQ(m3u8_timeline_seek(&media, 22.5, &index), M3U8_TIMELINE_STATUS_NOT_FOUND);
+  EXPECT_EQ(m3u8_timeline_seek(&media, -1, &index), M3U8_TIMELINE_STATUS_INVALID_ARG);
+}
+
+TEST_F(m3u8_timeline_test, given_live_window_keeps_offsets_relative_to_window) {
+  int    index = -1;
+  double wallclock = 0;
+
+  for (int i = 0; i < 10; i++) {
+    append(2.0, i == 0 ? PDT_BASE : 0);
+  }
+
+  ASSERT_EQ(m3u8_timeline_drop(&media, 4), M3U8_TIMELINE_STATUS_NO_ERROR);
+  append(2.0);
+  ASSERT_EQ(media.segments_count, 7);
+  EXPECT_EQ(media.media_sequence, 4);
+  EXPECT_STREQ(uri(0).c_str(), "s4.ts");
+
+  ASSERT_EQ(m3u8_timeline_seek(&media, 3.0, &index), M3U8_TIMELINE_STATUS_NO_ERROR);
+  EXPECT_STREQ(uri(index).c_str(), "s5.ts");
+
+  // the run tagged on the dropped first segment still maps the window
+  ASSERT_EQ(m3u8_timeline_wallclock(&media, 6, &wallclock), M3U8_TIMELINE_STATUS_NO_ERROR);
+  EXPECT_DOUBLE_EQ(wallclock, PDT_BASE + 20.0);
+  ASSERT_EQ(m3u8_timeline_seek_wallclock(&media, PDT_BASE + 9.0, &index), M3U8_TIMELINE_STATUS_NO_ERROR);
+  EXPECT_STREQ(uri(index).c_str(), "s4.ts");
+  EXPECT_EQ(m3u8_timeline_seek_wallclock(&media, PDT_BASE + 7.0, &index), M3U8_TIMELINE_STATUS_NOT_FOUND);
+}
+
+// ----------- m3u8_timeline_seek_wallclock -----------
+
+TEST_F(m3u8_timeline_test, given_discontinuities_maps_wallclock_per_run) {
+  int    index = -1;
+  double wallclock = 0;
+
+  append(4.0, PDT_BASE);
+  append(4.0);
+  append(4.0, 0, true);        // ad break without a program-date-time
+  append(4.0);
+  append(4.0, PDT_BASE + 3600, true);
+  append(4.0);
+
+  ASSERT_EQ(media.anchors_count, 2);
+
+  ASSERT_EQ(m3u8_timeline_seek_wallclock(&media, PDT_BASE + 5.0, &index), M3U8_TIMELINE_STATUS_NO_ERROR);
+  EXPECT_EQ(index, 1);
+  ASSERT_EQ(m3u8_timeline_seek_wallclock(&media, PDT_BASE + 3605.0, &index), M3U8_TIMELINE_STATUS_NO_ERROR);
+  EXPECT_EQ(index, 5);
+
+  // the ad break has no wall-clock time
+  EXPECT_EQ(m3u8_timeline_seek_wallclock(&media, PDT_BASE + 9.0, &index), M3U8_TIMELINE_STATUS_NOT_FOUND);
+  EXPECT_EQ(m3u8_timeline_wallclock(&media, 3, &wallclock), M3U8_TIMELINE_STATUS_NOT_FOUND);
+  EXPECT_EQ(m3u8_timeline_seek_wallclock(&media, PDT_BASE - 1.0, &index), M3U8_TIMELINE_STATUS_NOT_FOUND);
+
+  ASSERT_EQ(m3u8_timeline_wallclock(&media, 5, &wallclock), M3U8_TIMELINE_STATUS_NO_ERROR);
+  EXPECT_DOUBLE_EQ(wallclock, PDT_BASE + 3604.0);
+}
+
+// ----------- m3u8_timeline_index -----------
+
+TEST_F(m3u8_timeline_test, given_parsed_segments_builds_same_timeline) {
+  int index = -1;
+
+  media.segments = (m3u8_media_segment_t*)calloc(3, sizeof(m3u8_media_segment_t));
+  media.segments_count = 3;
+
+  for (int i = 0; i < 3; i++) {
+    media.segments[i].duration = 10.0;
+    media.segments[i].uri = strdup("s.ts");
+  }
+
+  media.segments[1].program_date_time = PDT_BASE;
+
+  EXPECT_EQ(m3u8_timeline_seek(&media, 0, &index), M3U8_TIMELINE_STATUS_INVALID_ARG);
+  ASSERT_EQ(m3u8_timeline_index(&media), M3U8_TIMELINE_STATUS_NO_ERROR);
+  EXPECT_DOUBLE_EQ(media.starts[2], 20.0);
+
+  ASSERT_EQ(m3u8_timeline_seek_wallclock(&media, PDT_BASE + 15.0, &index), M3U8_TIMELINE_STATUS_NO_ERROR);
+  EXPECT_EQ(index, 2);
+
+  // appending after the index reuses it
+  append(5.0);
+  ASSERT_EQ(m3u8_timeline_seek(&media, 32.0, &index), M3U8_TIMELINE_STATUS_NO_ERROR);
+  EXPECT_EQ(index, 3);
+}
+
+// ----------- m3u8_timeline_uri -----------
+
+TEST_F(m3u8_timeline_test, given_numbered_uris_stores_templates) {
+  const char* uris[] = {"segment4559.m4s", "segment4560.m4s", "segment4561.m4s", "seg_0098.ts",
+                        "seg_0099.ts",     "seg_0100.ts",     "seg_099.ts",      "ad-break.ts",
+                        "segment9.m4s",    "segment10.m4s",   "segment010.m4s"};
+  int         count = sizeof(uris) / sizeof(uris[0]);
+  char        small[8];
+
+  for (int i = 0; i < count; i++) {
+    append_uri(uris[i]);
+  }
+
+  for (int i = 0; i < count; i++) {
+    EXPECT_STREQ(uri(i).c_str(), uris[i]);
+  }
+
+  // two templates, the zero padded one keeps its width
+  ASSERT_EQ(media.uri_templates_count, 2);
+  EXPECT_STREQ(media.uri_templates[0].prefix, "segment");
+  EXPECT_STREQ(media.uri_templates[0].suffix, ".m4s");
+  EXPECT_EQ(media.uri_templates[1].width, 4);
+  EXPECT_EQ(media.segments[0].uri, nullptr);
+  EXPECT_EQ(media.segments[9].uri_template, 1);
+  EXPECT_EQ(media.segments[9].uri_number, 10u);
+
+  // padding or text that a template cannot reproduce stays literal
+  EXPECT_STREQ(media.segments[6].uri, "seg_099.ts");
+  EXPECT_STREQ(media.segments[7].uri, "ad-break.ts");
+  EXPECT_STREQ(media.segments[10].uri, "segment010.m4s");
+
+  EXPECT_EQ(m3u8_timeline_uri(&media, 0, small, sizeof(small)), M3U8_TIMELINE_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_timeline_uri(&media, count, small, sizeof(small)), M3U8_TIMELINE_STATUS_INVALID_ARG);
+}
+
+TEST_F(m3u8_timeline_test, given_parsed_numbered_uris_compresses_on_index) {
+  media.segments = (m3u8_media_segment_t*)calloc(100, sizeof(m3u8_media_segment_t));
+  media.segments_count = 100;
+
+  for (int i = 0; i < 100; i++) {
+    char name[64];
+
+    snprintf(name, sizeof(name), "https://cdn.example.com/live/%d.ts", 1000 + i);
+    media.segments[i].duration = 2.0;
+    media.segments[i].uri = strdup(name);
+  }
+
+  ASSERT_EQ(m3u8_timeline_index(&media), M3U8_TIMELINE_STATUS_NO_ERROR);
+  ASSERT_EQ(media.uri_templates_count, 1);
+  EXPECT_STREQ(media.uri_templates[0].prefix, "https://cdn.example.com/live/");
+
+  for (int i = 0; i < 100; i++) {
+    EXPECT_EQ(media.segments[i].uri, nullptr);
+  }
+
+  EXPECT_STREQ(uri(57).c_str(), "https://cdn.example.com/live/1057.ts");
+
+  // dropped segments leave the template to the following ones
+  ASSERT_EQ(m3u8_timeline_drop(&media, 99), M3U8_TIMELINE_STATUS_NO_ERROR);
+  append_uri("https://cdn.example.com/live/1100.ts");
+  EXPECT_EQ(media.segments[1].uri_template, 1);
+  EXPECT_STREQ(uri(1).c_str(), "https://cdn.example.com/live/1100.ts");
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
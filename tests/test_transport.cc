@@ -0,0 +1,366 @@
+#include <arpa/inet.h>
+#include <gtest/gtest.h>
+#include <netinet/in.h>
+#include <pthread.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+#include <string>
+
+extern "C" {
+#include "../src/transport.h"
+}
+
+#define MOCK_PLAYLIST "#EXTM3U\n#EXT-X-VERSION:7\n#EXT-X-ENDLIST\n"
+
+typedef struct {
+  pthread_mutex_t mutex;
+  pthread_cond_t  cond;
+  std::string     body;
+  int             status;
+  bool            is_done;
+} mock_request_t;
+
+static int mock_write(const char* data, size_t size, void* userdata) {
+  mock_request_t* mock = (mock_request_t*)userdata;
+
+  mock->body.append(data, size);
+
+  return 0;
+}
+
+static void mock_done(m3u8_transport_request_t* request, int status, void* userdata) {
+  mock_request_t* mock = (mock_request_t*)userdata;
+
+  (void)request;
+
+  pthread_mutex_lock(&mock->mutex);
+  mock->status = status;
+  mock->is_done = true;
+  pthread_cond_broadcast(&mock->cond);
+  pthread_mutex_unlock(&mock->mutex);
+}
+
+// single connection HTTP/1.1 keep-alive origin answering every request with
+// MOCK_PLAYLIST until the client hangs up
+typedef struct {
+  int       listener;
+  int       port;
+  int       accepted;
+  pthread_t thread;
+} mock_origin_t;
+
+static void* mock_origin_serve(void* vargs) {
+  mock_origin_t* origin = (mock_origin_t*)vargs;
+  int            fd = -1;
+
+  while ((fd = accept(origin->listener, NULL, NULL)) >= 0) {
+    char        request[4096];
+    std::string pending;
+    ssize_t     received = 0;
+
+    origin->accepted++;
+
+    while ((received = read(fd, request, sizeof(request))) > 0) {
+      size_t end = 0;
+
+      pending.append(request, received);
+
+      while ((end = pending.find("\r\n\r\n")) != std::string::npos) {
+        char response[256];
+        int  response_s = snprintf(response, sizeof(response),
+                                   "HTTP/1.1 200 OK\r\nContent-Length: %zu\r\n\r\n%s",
+                                   strlen(MOCK_PLAYLIST), MOCK_PLAYLIST);
+
+        pending.erase(0, end + 4);
+        EXPECT_EQ(write(fd, response, response_s), response_s);
+      }
+    }
+
+    close(fd);
+  }
+
+  return NULL;
+}
+
+static void mock_origin_start(mock_origin_t* origin) {
+  struct sockaddr_in address = {};
+  socklen_t          address_s = sizeof(address);
+
+  address.sin_family = AF_INET;
+  address.sin_addr.s_addr = htonl(INADDR_LOOPBACK);
+
+  origin->accepted = 0;
+  ASSERT_GE(origin->listener = socket(AF_INET, SOCK_STREAM, 0), 0);
+  ASSERT_EQ(bind(origin->listener, (struct sockaddr*)&address, sizeof(address)), 0);
+  ASSERT_EQ(listen(origin->listener, 8), 0);
+  ASSERT_EQ(getsockname(origin->listener, (struct sockaddr*)&address, &address_s), 0);
+  origin->port = ntohs(address.sin_port);
+  ASSERT_EQ(pthread_create(&origin->thread, NULL, mock_origin_serve, origin), 0);
+}
+
+static void mock_origin_stop(mock_origin_t* origin) {
+  shutdown(origin->listener, SHUT_RDWR);
+  close(origin->listener);
+  pthread_join(origin->thread, NULL);
+}
+
+class m3u8_transport_test : public ::testing::Test {
+ protected:
+  char           path[64];
+  char           uri[128];
+  mock_request_t mock;
+
+  void SetUp() override {
+    int fd = -1;
+
+    snprintf(path, sizeof(path), "/tmp/m3u8_transport_XXXXXX");
+    ASSERT_NE(fd = mkstemp(path), -1);
+    ASSERT_EQ(write(fd, MOCK_PLAYLIST, strlen(MOCK_PLAYLIST)), (ssize_t)strlen(MOCK_PLAYLIST));
+    close(fd);
+
+    snprintf(uri, sizeof(uri), "file://%s", path);
+
+    pthread_mutex_init(&mock.mutex, NULL);
+    pthread_cond_init(&mock.cond, NULL);
+    mock.status = -1;
+    mock.is_done = false;
+  }
+
+  void TearDown() override {
+    pthread_cond_destroy(&mock.cond);
+    pthread_mutex_destroy(&mock.mutex);
+    unlink(path);
+  }
+
+  void wait_done() {
+    pthread_mutex_lock(&mock.mutex);
+
+    while (!mock.is_done) {
+      pthread_cond_wait(&mock.cond, &mock.mutex);
+    }
+
+    pthread_mutex_unlock(&mock.mutex);
+  }
+
+  std::string read_all(m3u8_transport_stream_t* stream) {
+    std::string body;
+    const char* chunk = NULL;
+    size_t      size = 0;
+
+    while (m3u8_transport_read(stream, &chunk, &size) == M3U8_TRANSPORT_STATUS_NO_ERROR &&
+           size > 0) {
+      body.append(chunk, size);
+    }
+
+    return body;
+  }
+};
+
+// ----------- m3u8_transport_create -----------
+
+TEST_F(m3u8_transport_test, given_invalid_args_returns_error) {
+  m3u8_transport_t*        transport = NULL;
+  m3u8_transport_t*        not_null = (m3u8_transport_t*)0x1;
+  m3u8_transport_ops_t     ops = {};
+  m3u8_transport_stream_t  stream = {};
+  m3u8_transport_request_t request = {};
+
+  EXPECT_EQ(m3u8_transport_create(NULL, &ops, NULL), M3U8_TRANSPORT_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_transport_create(&not_null, &ops, NULL), M3U8_TRANSPORT_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_transport_create(&transport, &ops, NULL), M3U8_TRANSPORT_STATUS_INVALID_ARG);
+  EXPECT_EQ(transport, nullptr);
+
+  ASSERT_EQ(m3u8_transport_file_create(&transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_transport_open(transport, NULL, &stream), M3U8_TRANSPORT_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_transport_read(&stream, NULL, NULL), M3U8_TRANSPORT_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_transport_submit(transport, &request), M3U8_TRANSPORT_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_transport_memory_put(transport, "a", "b", 1, false),
+            M3U8_TRANSPORT_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_transport_destroy(transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_transport_destroy(NULL), M3U8_TRANSPORT_STATUS_INVALID_ARG);
+}
+
+// ----------- m3u8_transport_open -----------
+
+TEST_F(m3u8_transport_test, given_memory_region_reads_it_without_copy) {
+  m3u8_transport_t*       transport = NULL;
+  m3u8_transport_stream_t stream = {};
+  const char*             chunk = NULL;
+  size_t                  size = 0;
+  static const char       region[] = MOCK_PLAYLIST;
+
+  ASSERT_EQ(m3u8_transport_memory_create(&transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_transport_memory_put(transport, "mem://index.m3u8", region, strlen(region), true),
+            M3U8_TRANSPORT_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_transport_open(transport, "mem://index.m3u8", &stream),
+            M3U8_TRANSPORT_STATUS_NO_ERROR);
+
+  EXPECT_TRUE(stream.is_terminated);
+  EXPECT_FALSE(stream.is_writable);
+  EXPECT_EQ(m3u8_transport_read(&stream, &chunk, &size), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  EXPECT_EQ(chunk, region);
+  EXPECT_EQ(size, strlen(region));
+  EXPECT_EQ(m3u8_transport_read(&stream, &chunk, &size), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  EXPECT_EQ(size, 0u);
+  EXPECT_EQ(m3u8_transport_close(&stream), M3U8_TRANSPORT_STATUS_NO_ERROR);
+
+  EXPECT_EQ(m3u8_transport_open(transport, "mem://missing.m3u8", &stream),
+            M3U8_TRANSPORT_STATUS_NOT_FOUND);
+  EXPECT_EQ(m3u8_transport_destroy(transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+}
+
+TEST_F(m3u8_transport_test, given_file_uri_reads_terminated_body) {
+  m3u8_transport_t*       transport = NULL;
+  m3u8_transport_stream_t stream = {};
+
+  ASSERT_EQ(m3u8_transport_file_create(&transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_transport_open(transport, uri, &stream), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  EXPECT_TRUE(stream.is_terminated);
+  EXPECT_TRUE(stream.is_writable);
+  EXPECT_EQ(read_all(&stream), MOCK_PLAYLIST);
+  EXPECT_EQ(m3u8_transport_close(&stream), M3U8_TRANSPORT_STATUS_NO_ERROR);
+
+  EXPECT_EQ(m3u8_transport_open(transport, "file:///tmp/m3u8_transport_missing", &stream),
+            M3U8_TRANSPORT_STATUS_NOT_FOUND);
+  EXPECT_EQ(m3u8_transport_destroy(transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+}
+
+TEST_F(m3u8_transport_test, given_curl_transport_streams_the_body) {
+  m3u8_transport_t*       transport = NULL;
+  m3u8_transport_stream_t stream = {};
+
+  ASSERT_EQ(m3u8_transport_curl_create(&transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_transport_open(transport, uri, &stream), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  EXPECT_EQ(read_all(&stream), MOCK_PLAYLIST);
+  EXPECT_EQ(m3u8_transport_close(&stream), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  EXPECT_EQ(m3u8_transport_destroy(transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+}
+
+// ----------- m3u8_transport_submit -----------
+
+TEST_F(m3u8_transport_test, given_synchronous_backend_submit_completes_inline) {
+  m3u8_transport_t*        transport = NULL;
+  m3u8_transport_request_t request = {};
+
+  request.uri = uri;
+  request.write = mock_write;
+  request.done = mock_done;
+  request.userdata = &mock;
+
+  ASSERT_EQ(m3u8_transport_file_create(&transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_transport_submit(transport, &request), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  EXPECT_TRUE(mock.is_done);
+  EXPECT_EQ(mock.status, M3U8_TRANSPORT_STATUS_NO_ERROR);
+  EXPECT_EQ(mock.body, MOCK_PLAYLIST);
+  EXPECT_EQ(m3u8_transport_destroy(transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+}
+
+TEST_F(m3u8_transport_test, given_file_range_reads_only_the_window) {
+  m3u8_transport_t*        transport = NULL;
+  m3u8_transport_request_t request = {};
+
+  request.uri = uri;
+  request.range_offset = strlen("#EXTM3U\n");
+  request.range_length = strlen("#EXT-X-VERSION:7");
+  request.write = mock_write;
+  request.done = mock_done;
+  request.userdata = &mock;
+
+  ASSERT_EQ(m3u8_transport_file_create(&transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_transport_submit(transport, &request), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  EXPECT_EQ(mock.status, M3U8_TRANSPORT_STATUS_NO_ERROR);
+  EXPECT_EQ(mock.body, "#EXT-X-VERSION:7");
+
+  // an offset without a length asks for the whole file
+  mock.body.clear();
+  request.range_length = 0;
+  ASSERT_EQ(m3u8_transport_submit(transport, &request), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  EXPECT_EQ(mock.status, M3U8_TRANSPORT_STATUS_NO_ERROR);
+  EXPECT_EQ(mock.body, MOCK_PLAYLIST);
+
+  // a window running past the end of the file is an incomplete body
+  mock.body.clear();
+  request.range_length = strlen(MOCK_PLAYLIST);
+  ASSERT_EQ(m3u8_transport_submit(transport, &request), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  EXPECT_EQ(mock.status, M3U8_TRANSPORT_STATUS_IO_ERROR);
+  EXPECT_EQ(mock.body, "");
+
+  request.uri = "file:///tmp/m3u8_transport_missing";
+  ASSERT_EQ(m3u8_transport_submit(transport, &request), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  EXPECT_EQ(mock.status, M3U8_TRANSPORT_STATUS_NOT_FOUND);
+  EXPECT_EQ(m3u8_transport_destroy(transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+}
+
+TEST_F(m3u8_transport_test, given_curl_backend_submit_completes_asynchronously) {
+  m3u8_transport_t*        transport = NULL;
+  m3u8_transport_request_t request = {};
+
+  request.uri = uri;
+  request.write = mock_write;
+  request.done = mock_done;
+  request.userdata = &mock;
+
+  ASSERT_EQ(m3u8_transport_curl_create(&transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_transport_submit(transport, &request), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  wait_done();
+  EXPECT_EQ(mock.status, M3U8_TRANSPORT_STATUS_NO_ERROR);
+  EXPECT_EQ(mock.body, MOCK_PLAYLIST);
+
+  mock.is_done = false;
+  mock.body.clear();
+  request.uri = "file:///tmp/m3u8_transport_missing";
+
+  ASSERT_EQ(m3u8_transport_submit(transport, &request), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  wait_done();
+  EXPECT_EQ(mock.status, M3U8_TRANSPORT_STATUS_NOT_FOUND);
+  EXPECT_EQ(m3u8_transport_destroy(transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+}
+
+TEST_F(m3u8_transport_test, given_http1_origin_reuses_pooled_connection) {
+  m3u8_transport_t*            transport = NULL;
+  m3u8_transport_request_t     request = {};
+  m3u8_transport_curl_stats_t  stats = {};
+  m3u8_transport_curl_config_t config = {};
+  mock_origin_t                origin;
+  char                         http_uri[128];
+
+  mock_origin_start(&origin);
+  snprintf(http_uri, sizeof(http_uri), "http://127.0.0.1:%d/live/index.m3u8", origin.port);
+
+  request.uri = http_uri;
+  request.write = mock_write;
+  request.done = mock_done;
+  request.userdata = &mock;
+  config.max_host_connections = 1;
+
+  ASSERT_EQ(m3u8_transport_curl_create_with(&transport, &config), M3U8_TRANSPORT_STATUS_NO_ERROR);
+
+  for (int i = 0; i < 3; i++) {
+    mock.is_done = false;
+    mock.body.clear();
+    ASSERT_EQ(m3u8_transport_submit(transport, &request), M3U8_TRANSPORT_STATUS_NO_ERROR);
+    wait_done();
+    EXPECT_EQ(mock.status, M3U8_TRANSPORT_STATUS_NO_ERROR);
+    EXPECT_EQ(mock.body, MOCK_PLAYLIST);
+  }
+
+  // cleartext never negotiates h2: one connection, then keep-alive reuse
+  ASSERT_EQ(m3u8_transport_curl_stats(transport, &stats), M3U8_TRANSPORT_STATUS_NO_ERROR);
+  EXPECT_EQ(stats.requests, 3u);
+  EXPECT_EQ(stats.connections, 1u);
+  EXPECT_EQ(stats.reused, 2u);
+  EXPECT_EQ(stats.multiplexed, 0u);
+  EXPECT_EQ(m3u8_transport_destroy(transport), M3U8_TRANSPORT_STATUS_NO_ERROR);
+
+  mock_origin_stop(&origin);
+  EXPECT_EQ(origin.accepted, 1);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}
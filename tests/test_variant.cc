@@ -0,0 +1,112 @@
+#include <gtest/gtest.h>
+#include <string.h>
+
+extern "C" {
+#include "../src/variant.h"
+}
+
+class m3u8_variant_test : public ::testing::Test {
+ protected:
+  m3u8_t* m3u8_ptr = NULL;
+
+  void SetUp() override {
+    ASSERT_EQ(m3u8_create(&m3u8_ptr), M3U8_STATUS_NO_ERROR);
+  }
+
+  void TearDown() override {
+    EXPECT_EQ(m3u8_destroy(m3u8_ptr), M3U8_STATUS_NO_ERROR);
+  }
+
+  void append(int bandwidth, const char* uri) {
+    ext_x_stream_inf_t variant = {};
+
+    variant.bandwidth = bandwidth;
+    variant.uri = strdup(uri);
+    ASSERT_EQ(m3u8_variant_append(m3u8_ptr, &variant), M3U8_VARIANT_STATUS_NO_ERROR);
+  }
+};
+
+// ----------- m3u8_variant_index -----------
+
+TEST_F(m3u8_variant_test, given_unsorted_ladder_indexes_by_bandwidth) {
+  const int bandwidths[] = {2500000, 800000, 5000000, 1200000, 800000};
+
+  for (int i = 0; i < 5; i++) {
+    char uri[32];
+
+    snprintf(uri, sizeof(uri), "v%d.m3u8", i);
+    append(bandwidths[i], uri);
+  }
+
+  ASSERT_EQ(m3u8_variant_index(m3u8_ptr), M3U8_VARIANT_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_ptr->variants_count, 5);
+
+  for (int i = 1; i < 5; i++) {
+    EXPECT_LE(m3u8_ptr->by_bandwidth[i - 1].bandwidth, m3u8_ptr->by_bandwidth[i].bandwidth);
+  }
+
+  // ties keep the playlist order
+  EXPECT_EQ(m3u8_ptr->by_bandwidth[0].index, 1);
+  EXPECT_EQ(m3u8_ptr->by_bandwidth[1].index, 4);
+
+  // the list view walks the array in playlist order
+  int count = 0;
+
+  for (ext_x_stream_inf_t* it = m3u8_ptr->x_stream_inf; it != NULL; it = it->__next, count++) {
+    EXPECT_EQ(it, &m3u8_ptr->variants[count]);
+  }
+
+  EXPECT_EQ(count, 5);
+}
+
+// ----------- m3u8_variant_at_most -----------
+
+TEST_F(m3u8_variant_test, given_budget_finds_best_fitting_variant) {
+  const ext_x_stream_inf_t* variant = NULL;
+
+  append(2500000, "mid.m3u8");
+  append(800000, "low.m3u8");
+  append(5000000, "high.m3u8");
+  ASSERT_EQ(m3u8_variant_index(m3u8_ptr), M3U8_VARIANT_STATUS_NO_ERROR);
+
+  ASSERT_EQ(m3u8_variant_at_most(m3u8_ptr, 3000000, &variant), M3U8_VARIANT_STATUS_NO_ERROR);
+  EXPECT_STREQ(variant->uri, "mid.m3u8");
+  ASSERT_EQ(m3u8_variant_at_most(m3u8_ptr, 2500000, &variant), M3U8_VARIANT_STATUS_NO_ERROR);
+  EXPECT_STREQ(variant->uri, "mid.m3u8");
+  ASSERT_EQ(m3u8_variant_at_most(m3u8_ptr, 100000000, &variant), M3U8_VARIANT_STATUS_NO_ERROR);
+  EXPECT_STREQ(variant->uri, "high.m3u8");
+  EXPECT_EQ(m3u8_variant_at_most(m3u8_ptr, 799999, &variant), M3U8_VARIANT_STATUS_NOT_FOUND);
+
+  ASSERT_EQ(m3u8_variant_lowest(m3u8_ptr, &variant), M3U8_VARIANT_STATUS_NO_ERROR);
+  EXPECT_STREQ(variant->uri, "low.m3u8");
+}
+
+TEST_F(m3u8_variant_test, given_stale_index_returns_invalid_arg) {
+  const ext_x_stream_inf_t* variant = NULL;
+
+  EXPECT_EQ(m3u8_variant_lowest(m3u8_ptr, &variant), M3U8_VARIANT_STATUS_NOT_FOUND);
+  EXPECT_EQ(m3u8_variant_at_most(m3u8_ptr, 1000, &variant), M3U8_VARIANT_STATUS_NOT_FOUND);
+
+  append(800000, "low.m3u8");
+  EXPECT_EQ(m3u8_variant_at_most(m3u8_ptr, 1000000, &variant), M3U8_VARIANT_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_variant_append(m3u8_ptr, NULL), M3U8_VARIANT_STATUS_INVALID_ARG);
+  EXPECT_EQ(m3u8_variant_index(NULL), M3U8_VARIANT_STATUS_INVALID_ARG);
+}
+
+TEST_F(m3u8_variant_test, given_many_variants_grows_array) {
+  const ext_x_stream_inf_t* variant = NULL;
+
+  for (int i = 0; i < 100; i++) {
+    append((100 - i) * 10000, "v.m3u8");
+  }
+
+  ASSERT_EQ(m3u8_variant_index(m3u8_ptr), M3U8_VARIANT_STATUS_NO_ERROR);
+  ASSERT_EQ(m3u8_variant_at_most(m3u8_ptr, 505000, &variant), M3U8_VARIANT_STATUS_NO_ERROR);
+  EXPECT_EQ(variant->bandwidth, 500000);
+  EXPECT_EQ(variant - m3u8_ptr->variants, 50);
+}
+
+int main(int argc, char** argv) {
+  ::testing::InitGoogleTest(&argc, argv);
+  return RUN_ALL_TESTS();
+}